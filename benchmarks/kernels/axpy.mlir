@@ -0,0 +1,14 @@
+// Unit-stride streaming kernel: y = a * x + y over one million elements.
+// Memory-bound; sensitive to vectorization and to any change in the lowering
+// of perfectly nested elementwise loops.
+func @axpy(%x : memref<1048576xf32>, %y : memref<1048576xf32>) {
+  %a = constant 2.0 : f32
+  affine.for %i = 0 to 1048576 {
+    %0 = load %x[%i] : memref<1048576xf32>
+    %1 = load %y[%i] : memref<1048576xf32>
+    %2 = mulf %a, %0 : f32
+    %3 = addf %2, %1 : f32
+    store %3, %y[%i] : memref<1048576xf32>
+  }
+  return
+}
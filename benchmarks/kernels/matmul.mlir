@@ -0,0 +1,18 @@
+// Square matrix multiplication, the canonical target of the tiling and
+// interchange heuristics: 128x128x128 in f32, accumulating in C.
+func @matmul(%A : memref<128x128xf32>, %B : memref<128x128xf32>,
+             %C : memref<128x128xf32>) {
+  affine.for %i = 0 to 128 {
+    affine.for %j = 0 to 128 {
+      affine.for %k = 0 to 128 {
+        %a = load %A[%i, %k] : memref<128x128xf32>
+        %b = load %B[%k, %j] : memref<128x128xf32>
+        %c = load %C[%i, %j] : memref<128x128xf32>
+        %p = mulf %a, %b : f32
+        %s = addf %c, %p : f32
+        store %s, %C[%i, %j] : memref<128x128xf32>
+      }
+    }
+  }
+  return
+}
@@ -0,0 +1,27 @@
+// Sum reduction of one million elements into a single cell, via two stages of
+// producer/consumer loops over a partial-sums buffer. Exercises loop fusion,
+// store-to-load forwarding, and the reduction handling of -affine-parallelize.
+func @reduction(%x : memref<1048576xf32>, %sum : memref<1xf32>) {
+  %c0 = constant 0 : index
+  %zero = constant 0.0 : f32
+  %partial = alloc() : memref<1024xf32>
+  affine.for %i = 0 to 1024 {
+    store %zero, %partial[%i] : memref<1024xf32>
+    affine.for %j = 0 to 1024 {
+      %idx = affine.apply (d0, d1) -> (d0 * 1024 + d1)(%i, %j)
+      %0 = load %x[%idx] : memref<1048576xf32>
+      %1 = load %partial[%i] : memref<1024xf32>
+      %2 = addf %1, %0 : f32
+      store %2, %partial[%i] : memref<1024xf32>
+    }
+  }
+  store %zero, %sum[%c0] : memref<1xf32>
+  affine.for %i = 0 to 1024 {
+    %0 = load %partial[%i] : memref<1024xf32>
+    %1 = load %sum[%c0] : memref<1xf32>
+    %2 = addf %1, %0 : f32
+    store %2, %sum[%c0] : memref<1xf32>
+  }
+  dealloc %partial : memref<1024xf32>
+  return
+}
@@ -0,0 +1,26 @@
+// Five-point Jacobi stencil over a 512x512 grid, writing the interior of the
+// output. Exercises multi-operand affine subscripts and the locality
+// heuristics for loops with neighboring accesses.
+func @stencil2d(%in : memref<512x512xf32>, %out : memref<512x512xf32>) {
+  %c = constant 0.2 : f32
+  affine.for %i = 1 to 511 {
+    affine.for %j = 1 to 511 {
+      %im1 = affine.apply (d0) -> (d0 - 1)(%i)
+      %ip1 = affine.apply (d0) -> (d0 + 1)(%i)
+      %jm1 = affine.apply (d0) -> (d0 - 1)(%j)
+      %jp1 = affine.apply (d0) -> (d0 + 1)(%j)
+      %0 = load %in[%i, %j] : memref<512x512xf32>
+      %1 = load %in[%im1, %j] : memref<512x512xf32>
+      %2 = load %in[%ip1, %j] : memref<512x512xf32>
+      %3 = load %in[%i, %jm1] : memref<512x512xf32>
+      %4 = load %in[%i, %jp1] : memref<512x512xf32>
+      %5 = addf %0, %1 : f32
+      %6 = addf %5, %2 : f32
+      %7 = addf %6, %3 : f32
+      %8 = addf %7, %4 : f32
+      %9 = mulf %c, %8 : f32
+      store %9, %out[%i, %j] : memref<512x512xf32>
+    }
+  }
+  return
+}
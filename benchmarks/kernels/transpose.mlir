@@ -0,0 +1,12 @@
+// Out-of-place 1024x1024 transpose: one stride-1 and one stride-4096 stream.
+// The classic victim of cache-line and TLB-unfriendly access orders, and the
+// kernel that most benefits from tiling.
+func @transpose(%in : memref<1024x1024xf32>, %out : memref<1024x1024xf32>) {
+  affine.for %i = 0 to 1024 {
+    affine.for %j = 0 to 1024 {
+      %0 = load %in[%i, %j] : memref<1024x1024xf32>
+      store %0, %out[%j, %i] : memref<1024x1024xf32>
+    }
+  }
+  return
+}
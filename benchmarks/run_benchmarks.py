@@ -0,0 +1,218 @@
+#!/usr/bin/env python3
+# Copyright 2019 The MLIR Authors.
+#
+# Licensed under the Apache License, Version 2.0 (the "License");
+# you may not use this file except in compliance with the License.
+# You may obtain a copy of the License at
+#
+#   http://www.apache.org/licenses/LICENSE-2.0
+#
+# Unless required by applicable law or agreed to in writing, software
+# distributed under the License is distributed on an "AS IS" BASIS,
+# WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+# See the License for the specific language governing permissions and
+# limitations under the License.
+"""Execution-benchmark harness for the kernel corpus in benchmarks/kernels.
+
+Each kernel is run through mlir-opt under a set of named pass pipelines and
+then executed with the benchmarking mode of mlir-cpu-runner. For every
+(kernel, pipeline) pair the harness records the median wall time reported by
+the runner, the peak resident set size of the runner process, and the median
+retired instruction count when perf counters are available.
+
+Results can be written to a JSON baseline with --record and gated against an
+earlier baseline with --check: the harness exits non-zero if any metric
+regresses by more than --tolerance relative to the baseline, so it can run in
+pre-merge automation. This is the execution-time sibling of the compile-time
+suite driven by tools/mlir-bench.
+
+Example:
+  run_benchmarks.py --bin-dir build/bin --record baseline.json
+  run_benchmarks.py --bin-dir build/bin --check baseline.json
+"""
+
+import argparse
+import json
+import os
+import re
+import subprocess
+import sys
+import tempfile
+
+# The named pre-execution pipelines; the runner itself always appends
+# canonicalize, cse, and the lowering to the LLVM IR dialect.
+PIPELINES = {
+    "baseline": [],
+    "tiled": ["-loop-tile"],
+    "fused": ["-loop-fusion"],
+    "parallel": ["-affine-parallelize"],
+}
+
+
+def run_with_rusage(command):
+    """Runs `command`, returning (exit code, stdout+stderr, peak RSS in KiB).
+
+    subprocess cannot report the child's rusage, so the child is reaped with
+    os.wait4; RUSAGE_CHILDREN would report the maximum over all previous
+    children instead of this one.
+    """
+    with tempfile.TemporaryFile() as output:
+        process = subprocess.Popen(command, stdout=output, stderr=output)
+        _, status, rusage = os.wait4(process.pid, 0)
+        exit_code = os.WEXITSTATUS(status) if os.WIFEXITED(status) else -1
+        # Popen must not wait for the already-reaped child on cleanup.
+        process.returncode = exit_code
+        output.seek(0)
+        text = output.read().decode("utf-8", errors="replace")
+    return exit_code, text, rusage.ru_maxrss
+
+
+def parse_median(output, label):
+    """Extracts 'median <value>' for the given label from the runner output."""
+    match = re.search(r"^%s: median ([0-9.eE+-]+)" % re.escape(label), output,
+                      re.MULTILINE)
+    return float(match.group(1)) if match else None
+
+
+def run_benchmark(args, kernel_path, pipeline):
+    """Runs one (kernel, pipeline) pair and returns its metrics dict."""
+    entry = os.path.splitext(os.path.basename(kernel_path))[0]
+    with tempfile.NamedTemporaryFile(suffix=".mlir") as transformed:
+        opt_command = [os.path.join(args.bin_dir, "mlir-opt"), kernel_path,
+                       "-o", transformed.name] + PIPELINES[pipeline]
+        subprocess.check_call(opt_command)
+
+        runner_command = [
+            os.path.join(args.bin_dir, "mlir-cpu-runner"), transformed.name,
+            "-e", entry, "-O3",
+            "-bench-iterations=%d" % args.iterations,
+            "-bench-warmup=%d" % args.warmup,
+            "-bench-random-init=%d" % args.seed,
+            "-bench-perf-counters",
+        ]
+        exit_code, output, max_rss_kb = run_with_rusage(runner_command)
+    if exit_code != 0:
+        sys.stderr.write(output)
+        raise RuntimeError("%s/%s: mlir-cpu-runner failed" % (entry, pipeline))
+
+    wall_time_ms = parse_median(output, "wall time")
+    if wall_time_ms is None:
+        sys.stderr.write(output)
+        raise RuntimeError("%s/%s: no timing in runner output" %
+                           (entry, pipeline))
+    return {
+        "wall_time_ms": wall_time_ms,
+        "max_rss_kb": max_rss_kb,
+        # None when perf counters are unavailable on the host.
+        "instructions": parse_median(output, "instructions"),
+    }
+
+
+def check_against_baseline(results, baseline, tolerance):
+    """Returns the list of regressions of `results` against `baseline`.
+
+    Wall time and RSS may only grow by `tolerance` relative to the baseline;
+    instruction counts, being nearly noise-free, are gated the same way and
+    are the most reliable signal. Pairs missing from either side are skipped
+    (new kernels have no baseline; baselines may predate a kernel's removal).
+    """
+    regressions = []
+    for name, metrics in sorted(results.items()):
+        base = baseline.get(name)
+        if base is None:
+            continue
+        for metric in ("wall_time_ms", "max_rss_kb", "instructions"):
+            new_value, old_value = metrics.get(metric), base.get(metric)
+            if new_value is None or not old_value:
+                continue
+            if new_value > old_value * (1.0 + tolerance):
+                regressions.append("%s %s: %.6g -> %.6g (+%.1f%%)" %
+                                   (name, metric, old_value, new_value,
+                                    100.0 * (new_value / old_value - 1.0)))
+    return regressions
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    parser.add_argument("--bin-dir", required=True,
+                        help="directory containing mlir-opt and "
+                             "mlir-cpu-runner")
+    parser.add_argument("--kernels-dir",
+                        default=os.path.join(os.path.dirname(__file__),
+                                             "kernels"),
+                        help="directory with the kernel .mlir corpus")
+    parser.add_argument("--kernels", default="",
+                        help="comma-separated kernel names to run "
+                             "(default: all)")
+    parser.add_argument("--pipelines", default=",".join(sorted(PIPELINES)),
+                        help="comma-separated pipeline names to run")
+    parser.add_argument("--iterations", type=int, default=10,
+                        help="timed iterations per run")
+    parser.add_argument("--warmup", type=int, default=2,
+                        help="untimed warmup iterations per run")
+    parser.add_argument("--seed", type=int, default=42,
+                        help="seed for -bench-random-init")
+    parser.add_argument("--record", metavar="FILE",
+                        help="write the results as a JSON baseline")
+    parser.add_argument("--check", metavar="FILE",
+                        help="gate the results against a JSON baseline")
+    parser.add_argument("--tolerance", type=float, default=0.10,
+                        help="allowed relative growth per metric when "
+                             "checking (default 0.10)")
+    args = parser.parse_args()
+
+    pipelines = args.pipelines.split(",")
+    for pipeline in pipelines:
+        if pipeline not in PIPELINES:
+            parser.error("unknown pipeline '%s'; known: %s" %
+                         (pipeline, ", ".join(sorted(PIPELINES))))
+
+    kernel_filter = set(filter(None, args.kernels.split(",")))
+    kernel_paths = sorted(
+        os.path.join(args.kernels_dir, f)
+        for f in os.listdir(args.kernels_dir) if f.endswith(".mlir"))
+    if kernel_filter:
+        kernel_paths = [p for p in kernel_paths
+                        if os.path.splitext(os.path.basename(p))[0]
+                        in kernel_filter]
+    if not kernel_paths:
+        parser.error("no kernels to run in " + args.kernels_dir)
+
+    results = {}
+    for kernel_path in kernel_paths:
+        kernel = os.path.splitext(os.path.basename(kernel_path))[0]
+        for pipeline in pipelines:
+            name = "%s/%s" % (kernel, pipeline)
+            metrics = run_benchmark(args, kernel_path, pipeline)
+            results[name] = metrics
+            instructions = ("%.0f" % metrics["instructions"]
+                            if metrics["instructions"] is not None else "n/a")
+            print("%-28s wall %10.3f ms   rss %8d KiB   insns %s" %
+                  (name, metrics["wall_time_ms"], metrics["max_rss_kb"],
+                   instructions))
+
+    if args.record:
+        with open(args.record, "w") as baseline_file:
+            json.dump({"version": 1, "iterations": args.iterations,
+                       "seed": args.seed, "results": results},
+                      baseline_file, indent=2, sort_keys=True)
+            baseline_file.write("\n")
+        print("baseline written to " + args.record)
+
+    if args.check:
+        with open(args.check) as baseline_file:
+            baseline = json.load(baseline_file)
+        regressions = check_against_baseline(results, baseline["results"],
+                                             args.tolerance)
+        if regressions:
+            print("regressions against %s (tolerance %.0f%%):" %
+                  (args.check, 100.0 * args.tolerance))
+            for regression in regressions:
+                print("  " + regression)
+            return 1
+        print("no regressions against " + args.check)
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
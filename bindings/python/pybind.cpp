@@ -32,6 +32,7 @@
 #include "mlir/IR/Attributes.h"
 #include "mlir/IR/Function.h"
 #include "mlir/IR/Module.h"
+#include "mlir/IR/StandardTypes.h"
 #include "mlir/IR/Types.h"
 #include "mlir/Pass/Pass.h"
 #include "mlir/Pass/PassManager.h"
@@ -187,6 +188,10 @@ struct PythonMLIRModule {
   // Create a boolean attribute.
   PythonAttribute boolAttr(bool value);
 
+  // Create a dense elements attribute of the given shaped type that
+  // references the contents of a Python buffer object without copying them.
+  PythonAttribute denseElementsAttr(PythonType type, py::buffer buffer);
+
   void compile() {
     PassManager manager;
     manager.addPass(mlir::createCanonicalizerPass());
@@ -233,6 +238,9 @@ private:
   // One single module in a python-exposed MLIRContext for now.
   std::unique_ptr<mlir::Module> module;
   std::unique_ptr<mlir::ExecutionEngine> engine;
+  // Buffer objects whose storage is referenced by zero-copy attributes; they
+  // must stay alive as long as the context.
+  std::vector<py::object> retainedBuffers;
 };
 
 struct PythonFunctionContext {
@@ -612,6 +620,31 @@ PythonAttribute PythonMLIRModule::boolAttr(bool value) {
   return PythonAttribute(::makeBoolAttr(&mlirContext, value));
 }
 
+PythonAttribute PythonMLIRModule::denseElementsAttr(PythonType type,
+                                                    py::buffer buffer) {
+  auto shapedType =
+      Type::getFromOpaquePointer(type.type).dyn_cast<ShapedType>();
+  if (!shapedType || !shapedType.hasStaticShape())
+    throw std::runtime_error("expected a statically shaped type");
+
+  // Require a C-contiguous buffer: the attribute aliases the raw storage.
+  py::buffer_info info = buffer.request();
+  ssize_t expectedStride = info.itemsize;
+  for (ssize_t i = info.ndim - 1; i >= 0; --i) {
+    if (info.strides[i] != expectedStride)
+      throw std::runtime_error("expected a C-contiguous buffer");
+    expectedStride *= info.shape[i];
+  }
+
+  // The attribute references the buffer storage directly instead of copying
+  // it into the context; retain the buffer for the lifetime of the module.
+  retainedBuffers.push_back(buffer);
+  auto attr = DenseElementsAttr::getFromBuffer(
+      shapedType, ArrayRef<char>(static_cast<const char *>(info.ptr),
+                                 info.size * info.itemsize));
+  return PythonAttribute(attr.getAsOpaquePointer());
+}
+
 PYBIND11_MODULE(pybind, m) {
   m.doc() =
       "Python bindings for MLIR Embedded Domain-Specific Components (EDSCs)";
@@ -718,6 +751,84 @@ PYBIND11_MODULE(pybind, m) {
 
           return ValueHandle::create(name, operandHandles, types, attrs);
         });
+  m.def(
+      "op_batch",
+      [](const std::vector<std::string> &names,
+         const std::vector<int> &operandCounts,
+         const std::vector<int64_t> &operandIndices,
+         const std::vector<int> &resultCounts,
+         const std::vector<PythonType> &resultTypes,
+         const std::vector<PythonValueHandle> &arguments,
+         const py::list &attributes) -> std::vector<PythonValueHandle> {
+        if (names.size() != operandCounts.size() ||
+            names.size() != resultCounts.size())
+          throw std::runtime_error(
+              "expected per-op operand and result counts");
+        if (!attributes.empty() && attributes.size() != names.size())
+          throw std::runtime_error(
+              "expected one attribute dict per op when provided");
+
+        std::vector<Value *> argumentValues;
+        argumentValues.reserve(arguments.size());
+        for (const auto &arg : arguments)
+          argumentValues.push_back(arg.value.getValue());
+
+        auto &builder = ScopedContext::getBuilder();
+        auto loc = ScopedContext::getLocation();
+        std::vector<Value *> results;
+        size_t operandPos = 0, resultPos = 0;
+        for (size_t i = 0, e = names.size(); i < e; ++i) {
+          OperationState state(loc, names[i]);
+          SmallVector<Value *, 8> operands;
+          operands.reserve(operandCounts[i]);
+          for (int j = 0; j < operandCounts[i]; ++j) {
+            auto index = operandIndices[operandPos++];
+            // Indices below the number of arguments select an argument;
+            // the rest select results of earlier ops in the batch.
+            auto numArguments = static_cast<int64_t>(argumentValues.size());
+            if (index < 0 ||
+                index >= numArguments + static_cast<int64_t>(results.size()))
+              throw std::runtime_error("operand index out of range");
+            operands.push_back(index < numArguments
+                                   ? argumentValues[index]
+                                   : results[index - numArguments]);
+          }
+          state.addOperands(operands);
+          for (int j = 0; j < resultCounts[i]; ++j)
+            state.addTypes(
+                Type::getFromOpaquePointer(resultTypes[resultPos++].type));
+          if (!attributes.empty()) {
+            for (const auto &a : attributes[i].cast<py::dict>()) {
+              auto pyAttr = a.second.cast<PythonAttribute>();
+              state.addAttribute(
+                  Identifier::get(a.first.cast<std::string>(),
+                                  ScopedContext::getContext()),
+                  Attribute::getFromOpaquePointer(pyAttr.attr));
+            }
+          }
+          Operation *op = builder.createOperation(state);
+          for (unsigned r = 0, numResults = op->getNumResults();
+               r < numResults; ++r)
+            results.push_back(op->getResult(r));
+        }
+
+        std::vector<PythonValueHandle> resultHandles;
+        resultHandles.reserve(results.size());
+        for (Value *result : results)
+          resultHandles.push_back(ValueHandle(result));
+        return resultHandles;
+      },
+      py::arg("names"), py::arg("operand_counts"), py::arg("operand_indices"),
+      py::arg("result_counts"), py::arg("result_types"),
+      py::arg("arguments") = std::vector<PythonValueHandle>(),
+      py::arg("attributes") = py::list(),
+      "Creates a batch of custom operations with a single call, amortizing "
+      "the Python/C++ boundary crossing over the whole batch. Ops are "
+      "described in flattened form: per-op names, operand and result counts, "
+      "flattened operand indices (an index below len(arguments) selects an "
+      "argument, larger indices select results of earlier ops in the batch), "
+      "flattened result types and, optionally, one attribute dict per op. "
+      "Returns the flattened list of all op results in creation order.");
 
   py::class_<PythonFunction>(m, "Function",
                              "Wrapping class for mlir::Function.")
@@ -768,6 +879,11 @@ PYBIND11_MODULE(pybind, m) {
           "integerAttr", &PythonMLIRModule::integerAttr,
           "Creates an mlir::IntegerAttr of the given type with the given value "
           "in the context associated with this MLIR module.")
+      .def("dense_elements_attr", &PythonMLIRModule::denseElementsAttr,
+           "Creates an mlir::DenseElementsAttr of the given statically shaped "
+           "type that references the contents of a C-contiguous buffer object "
+           "(e.g. a numpy array) without copying them. The module retains the "
+           "buffer for the lifetime of the context.")
       .def("declare_function", &PythonMLIRModule::declareFunction,
            "Declares a new mlir::Function in the current mlir::Module.  The "
            "function arguments can have attributes.  The function has no "
@@ -396,8 +396,21 @@ public:
 ///     ...
 ///   }
 ///
+/// A for operation may additionally carry a list of loop-carried values
+/// through its iterations. The initial values are passed after the
+/// "iter_args" keyword, the body block receives one extra argument per
+/// carried value holding its value for the current iteration, the
+/// terminator carries the values for the next iteration, and the operation
+/// returns the final values as results:
+///
+///   %sum = affine.for %i = 0 to 10 iter_args(%acc = %init) -> (f32) {
+///     %next = addf %acc, %v : f32
+///     "affine.terminator"(%next) : (f32) -> ()
+///   }
+///
 class AffineForOp
-    : public Op<AffineForOp, OpTrait::VariadicOperands, OpTrait::ZeroResult> {
+    : public Op<AffineForOp, OpTrait::VariadicOperands,
+                OpTrait::VariadicResults> {
 public:
   using Op::Op;
 
@@ -405,7 +418,7 @@ public:
   static void build(Builder *builder, OperationState *result,
                     ArrayRef<Value *> lbOperands, AffineMap lbMap,
                     ArrayRef<Value *> ubOperands, AffineMap ubMap,
-                    int64_t step = 1);
+                    int64_t step = 1, ArrayRef<Value *> iterOperands = {});
   static void build(Builder *builder, OperationState *result, int64_t lb,
                     int64_t ub, int64_t step = 1);
   LogicalResult verify();
@@ -433,6 +446,27 @@ public:
   /// Returns the induction variable for this loop.
   Value *getInductionVar();
 
+  //===--------------------------------------------------------------------===//
+  // Loop-carried values
+  //===--------------------------------------------------------------------===//
+
+  /// Returns the number of loop-carried values.
+  unsigned getNumIterOperands();
+
+  /// Returns the initial values of the loop-carried values, in result order.
+  operand_range getIterOperands();
+
+  /// Returns the initial value of the loop-carried value at 'idx'.
+  Value *getIterOperand(unsigned idx) {
+    return getOperand(getNumOperands() - getNumIterOperands() + idx);
+  }
+
+  /// Returns the body block arguments holding the current values of the
+  /// loop-carried values, one per result of the operation.
+  ArrayRef<BlockArgument *> getRegionIterArgs() {
+    return getBody()->getArguments().drop_front();
+  }
+
   //===--------------------------------------------------------------------===//
   // Bounds and step
   //===--------------------------------------------------------------------===//
@@ -610,17 +644,22 @@ public:
 
 /// Affine terminator is a special terminator operation for blocks inside affine
 /// loops and branches. It unconditionally transmits the control flow to the
-/// successor of the operation enclosing the region.
+/// successor of the operation enclosing the region. Its operands carry the
+/// values of the loop-carried values for the next iteration of an enclosing
+/// "affine.for" and must match the result types of that operation.
 ///
 /// This operation does _not_ have a custom syntax. However, affine control
 /// operations omit the terminator in their custom syntax for brevity.
 class AffineTerminatorOp
-    : public Op<AffineTerminatorOp, OpTrait::ZeroOperands, OpTrait::ZeroResult,
-                OpTrait::IsTerminator> {
+    : public Op<AffineTerminatorOp, OpTrait::VariadicOperands,
+                OpTrait::ZeroResult, OpTrait::IsTerminator> {
 public:
   using Op::Op;
 
-  static void build(Builder *, OperationState *) {}
+  static void build(Builder *, OperationState *result,
+                    ArrayRef<Value *> operands = {}) {
+    result->addOperands(operands);
+  }
 
   static StringRef getOperationName() { return "affine.terminator"; }
 };
@@ -0,0 +1,89 @@
+//===- AliasAnalysis.h - MemRef alias analysis ------------------*- C++ -*-===//
+//
+// Copyright 2019 The MLIR Authors.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+// =============================================================================
+//
+// This file defines an alias analysis for memref values based on provenance
+// tracking: a memref is followed through the operations that forward its
+// storage to the allocation, function argument, or opaque value it originates
+// from, and two memrefs with provably distinct origins do not alias.
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef MLIR_ANALYSIS_ALIASANALYSIS_H
+#define MLIR_ANALYSIS_ALIASANALYSIS_H
+
+#include "mlir/Support/LLVM.h"
+#include "llvm/ADT/DenseMap.h"
+#include "llvm/ADT/SmallPtrSet.h"
+
+namespace mlir {
+
+class Function;
+class Value;
+
+/// The result of an alias query: the two memrefs are proven to reference
+/// disjoint memory, proven to reference exactly the same memory, or neither.
+enum class AliasResult { NoAlias, MayAlias, MustAlias };
+
+/// Follows the chain of operations that forward a memref's storage unchanged
+/// (currently 'memref_cast') to the value it originates from: an alloc, a
+/// function argument, or a value the analysis cannot see through such as a
+/// call result.
+Value *getUnderlyingMemRef(Value *memref);
+
+/// Alias analysis over the memref values of one function. Aliasing is decided
+/// from provenance: values with the same origin must alias (the forwarding
+/// operations are whole-object views), distinct allocations are disjoint, a
+/// fresh allocation is disjoint from every memref bound before it runs, and
+/// function arguments the frontend annotated 'noalias' are disjoint from
+/// everything not derived from them. Query results are memoized; fetch the
+/// analysis through the pass analysis manager so the cache is shared between
+/// passes that preserve it.
+class AliasAnalysis {
+public:
+  explicit AliasAnalysis(Function *function);
+
+  /// Returns the relation between the memory referenced by the two memref
+  /// values.
+  AliasResult alias(Value *a, Value *b);
+
+  /// Returns true unless 'a' and 'b' are proven not to alias.
+  bool mayAlias(Value *a, Value *b) {
+    return alias(a, b) != AliasResult::NoAlias;
+  }
+
+private:
+  AliasResult aliasImpl(Value *a, Value *b);
+
+  /// Returns true if 'value' is an entry block argument of the function with
+  /// a truthful 'noalias' attribute.
+  bool isNoAliasArgument(Value *value);
+
+  /// The function this analysis was built for.
+  Function *function;
+
+  /// Allocations whose memref is passed to a call, returned, or used by an
+  /// operation the analysis does not understand; their storage may be
+  /// reachable through values with unknown provenance.
+  llvm::SmallPtrSet<Value *, 8> escapedAllocs;
+
+  /// Memoized query results, keyed on the pointer-ordered value pair.
+  llvm::DenseMap<std::pair<Value *, Value *>, AliasResult> cache;
+};
+
+} // end namespace mlir
+
+#endif // MLIR_ANALYSIS_ALIASANALYSIS_H
@@ -0,0 +1,98 @@
+//===- CallGraphIndex.h - Module-level function use index -------*- C++ -*-===//
+//
+// Copyright 2019 The MLIR Authors.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+// =============================================================================
+//
+// This file defines an index of function references within a module. Functions
+// are referenced by name through function attributes (e.g. the callee of a
+// call operation), so finding the uses of a function otherwise requires
+// scanning every operation in the module. The index performs that scan once
+// and is then kept current by the transformation mutating the IR.
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef MLIR_ANALYSIS_CALLGRAPHINDEX_H
+#define MLIR_ANALYSIS_CALLGRAPHINDEX_H
+
+#include "mlir/Support/LLVM.h"
+#include "llvm/ADT/DenseMap.h"
+#include <vector>
+
+namespace mlir {
+
+class Function;
+class Module;
+class Operation;
+
+/// An index from each function in a module to the operations that reference
+/// it, together with the caller/callee views derived from those references.
+/// Construction scans every operation's attributes for function references;
+/// afterwards, lookups are constant time in the module size. The index has no
+/// hooks into IR mutation, so a transformation keeps it current by reporting
+/// the operations and functions it creates and erases.
+class CallGraphIndex {
+public:
+  explicit CallGraphIndex(Module &module);
+
+  /// Returns the operations whose attributes reference 'func'. The order is
+  /// the order in which the uses were discovered or reported.
+  ArrayRef<Operation *> getUses(Function *func) const;
+
+  /// Returns true if no operation references 'func'.
+  bool hasNoUses(Function *func) const { return getUses(func).empty(); }
+
+  /// Returns the distinct functions referenced from the body of 'func', i.e.
+  /// its callees in the call graph.
+  SmallVector<Function *, 8> getCallees(Function *func) const;
+
+  /// Returns the distinct functions whose bodies reference 'func', i.e. its
+  /// callers in the reverse call graph.
+  SmallVector<Function *, 8> getCallers(Function *func) const;
+
+  /// Records the function references made by a newly created operation. The
+  /// operation must be attached to a function in the indexed module.
+  void notifyAdded(Operation *op);
+
+  /// Removes the function references made by 'op' from the index. Must be
+  /// called before the operation is erased or its attributes are mutated.
+  void notifyRemoved(Operation *op);
+
+  /// Scans the body of a newly added function and records its references.
+  void notifyAdded(Function *func);
+
+  /// Removes the references made from the body of 'func' and forgets the
+  /// function itself. Must be called before the function is erased, and any
+  /// uses of 'func' from other functions must already have been removed.
+  void notifyRemoved(Function *func);
+
+private:
+  /// Appends the functions referenced by the attributes of 'op' to 'refs'.
+  void resolveReferences(Operation *op, SmallVectorImpl<Function *> &refs);
+
+  /// The module this index describes.
+  Module &module;
+
+  /// For each function, the operations referencing it by name.
+  llvm::DenseMap<Function *, std::vector<Operation *>> uses;
+
+  /// For each function, the functions referenced from its body, one entry per
+  /// use. This is the forward view used to answer callee queries without
+  /// rescanning the body.
+  llvm::DenseMap<Function *, std::vector<Function *>> referencedFunctions;
+};
+
+} // end namespace mlir
+
+#endif // MLIR_ANALYSIS_CALLGRAPHINDEX_H
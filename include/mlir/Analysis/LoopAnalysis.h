@@ -22,8 +22,10 @@
 #ifndef MLIR_ANALYSIS_LOOP_ANALYSIS_H
 #define MLIR_ANALYSIS_LOOP_ANALYSIS_H
 
+#include "mlir/IR/AffineMap.h"
 #include "mlir/Support/LLVM.h"
 #include "llvm/ADT/ArrayRef.h"
+#include "llvm/ADT/DenseMap.h"
 #include "llvm/ADT/Optional.h"
 
 namespace mlir {
@@ -31,6 +33,7 @@ namespace mlir {
 class AffineExpr;
 class AffineForOp;
 class AffineMap;
+class Function;
 class Operation;
 class MemRefType;
 class Value;
@@ -56,6 +59,57 @@ llvm::Optional<uint64_t> getConstantTripCount(AffineForOp forOp);
 /// this method is thus able to determine non-trivial divisors.
 uint64_t getLargestDivisorOfTripCount(AffineForOp forOp);
 
+/// A memo of per-loop trip count facts for passes that query the same loops
+/// repeatedly. The first query against a loop derives its trip count map once
+/// and records the constant trip count and largest known trip count divisor;
+/// subsequent queries are a hash lookup. A record remembers the bound maps and
+/// step it was derived from and is recomputed transparently when they change,
+/// so setLowerBound/setUpperBound/setStep need no bookkeeping; callers that
+/// mutate a cached loop's bound *operands*, or erase a cached loop, must call
+/// invalidate() for it.
+class AffineForTripCountCache {
+public:
+  /// Memoized equivalent of mlir::getConstantTripCount.
+  llvm::Optional<uint64_t> getConstantTripCount(AffineForOp forOp);
+
+  /// Memoized equivalent of mlir::getLargestDivisorOfTripCount.
+  uint64_t getLargestDivisorOfTripCount(AffineForOp forOp);
+
+  /// Drops the record for 'forOp'.
+  void invalidate(AffineForOp forOp);
+
+  /// Drops all records.
+  void clear() { records.clear(); }
+
+private:
+  struct Record {
+    /// The bound maps and step the facts below were derived from; a record is
+    /// stale when these no longer match the loop.
+    AffineMap lbMap;
+    AffineMap ubMap;
+    int64_t step;
+    llvm::Optional<uint64_t> constantTripCount;
+    uint64_t largestDivisor;
+  };
+
+  /// Returns a valid record for 'forOp', computing or refreshing it if needed.
+  const Record &getRecord(AffineForOp forOp);
+
+  llvm::DenseMap<Operation *, Record> records;
+};
+
+/// Returns a rough estimate of the code size of one iteration of this loop's
+/// body in units of target operations: ops are counted with weights reflecting
+/// what they lower to (affine.apply and load/store expand to address
+/// arithmetic, nested loops add control overhead, terminators are free). Used
+/// to guide unrolling decisions.
+uint64_t getApproximateBodyOpCount(AffineForOp forOp);
+
+/// Returns a rough estimate of the code size of the body of `func` using the
+/// same per-op weights as getApproximateBodyOpCount. Used to bound code growth
+/// in interprocedural transformations such as inlining.
+uint64_t getApproximateOpCount(Function &func);
+
 /// Given an induction variable `iv` of type AffineForOp and an `index` of type
 /// IndexType, returns `true` if `index` is independent of `iv` and false
 /// otherwise.
@@ -0,0 +1,111 @@
+//===- LoopNestCostModel.h - Loop nest memory cost model --------*- C++ -*-===//
+//
+// Copyright 2019 The MLIR Authors.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+// =============================================================================
+//
+// This file defines a memory cost model for affine loop nests, shared by the
+// loop transformation passes. From the flattened access maps of the loads and
+// stores in a nest it estimates the memory footprint, the cache line traffic
+// per level of a parameterizable memory hierarchy, and the TLB page working
+// set, accounting for reuse carried by the enclosing loops.
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef MLIR_ANALYSIS_LOOPNESTCOSTMODEL_H
+#define MLIR_ANALYSIS_LOOPNESTCOSTMODEL_H
+
+#include "mlir/Support/LLVM.h"
+#include "llvm/ADT/DenseMap.h"
+#include "llvm/ADT/Optional.h"
+#include "llvm/ADT/SmallVector.h"
+
+namespace mlir {
+
+class AffineForOp;
+class Function;
+class Operation;
+
+/// The memory hierarchy the cost model evaluates loop nests against. The
+/// defaults approximate one core of a contemporary x86 server; passes tuning
+/// for a specific target can override the fields.
+//  TODO(mlir-team): derive this from target data when we have it.
+struct MachineModel {
+  struct CacheLevel {
+    /// Capacity of this level in bytes.
+    uint64_t sizeBytes;
+    /// Cache line size of this level in bytes.
+    uint64_t lineSizeBytes;
+  };
+
+  /// The cache levels ordered from closest to the core outwards.
+  SmallVector<CacheLevel, 4> cacheLevels;
+
+  /// Virtual memory page size in bytes.
+  uint64_t pageSizeBytes;
+
+  /// Number of data TLB entries. The TLB is modeled as one more cache level
+  /// whose block size is 'pageSizeBytes' and whose capacity is 'tlbEntries'
+  /// pages.
+  uint64_t tlbEntries;
+
+  /// Returns the default machine model: 32 KiB L1, 1 MiB L2, and 8 MiB L3
+  /// with 64-byte lines, 4 KiB pages, and a 64-entry TLB.
+  static MachineModel getDefault();
+};
+
+/// The estimated memory behavior of one execution of a loop nest. All counts
+/// are summed per access: two accesses touching the same data are counted
+/// twice, so these are estimates of traffic, not of distinct working set.
+struct LoopNestCost {
+  /// Number of distinct bytes each access sweeps over the full nest, summed
+  /// over the accesses.
+  uint64_t footprintBytes;
+
+  /// For each level of MachineModel::cacheLevels, the estimated number of
+  /// cache lines fetched into that level, assuming loop-carried reuse is
+  /// realized whenever the bytes touched between reuses fit in the level.
+  SmallVector<uint64_t, 4> cacheLinesAccessed;
+
+  /// The estimated number of page translations performed, modeled the same
+  /// way against the TLB capacity.
+  uint64_t tlbPagesAccessed;
+};
+
+/// A function analysis that evaluates the memory cost of affine loop nests.
+/// Results are memoized per nest root; like the other function analyses, the
+/// cached results are only valid as long as the function is not modified.
+class LoopNestCostModel {
+public:
+  explicit LoopNestCostModel(Function *function);
+
+  /// The machine the nests are evaluated against; defaults to
+  /// MachineModel::getDefault(). Callers overriding it should do so before
+  /// the first query.
+  MachineModel machine;
+
+  /// Returns the estimated cost of the nest rooted at 'root', or nullptr if
+  /// the nest is not analyzable: an accessed memref has a dynamic shape or a
+  /// non-identity layout, a subscript is semi-affine or uses mod/div, or an
+  /// enclosing loop has a non-constant trip count.
+  const LoopNestCost *getCost(AffineForOp root);
+
+private:
+  /// Memoized per-root results; None records that a nest was unanalyzable.
+  llvm::DenseMap<Operation *, Optional<LoopNestCost>> costs;
+};
+
+} // end namespace mlir
+
+#endif // MLIR_ANALYSIS_LOOPNESTCOSTMODEL_H
@@ -100,11 +100,26 @@ inline bool defaultFilterFunction(Operation &) { return true; }
 struct NestedPattern {
   NestedPattern(ArrayRef<NestedPattern> nested,
                 FilterFunctionType filter = defaultFilterFunction);
+
+  /// Builds a pattern that only matches operations named `kindName`. The kind
+  /// is tested with a cheap name comparison before the custom filter function
+  /// is invoked, and lets function-level matching walk only the operations of
+  /// that kind instead of the whole function.
+  NestedPattern(ArrayRef<NestedPattern> nested, StringRef kindName,
+                FilterFunctionType filter = defaultFilterFunction);
+
   NestedPattern(const NestedPattern &) = default;
   NestedPattern &operator=(const NestedPattern &) = default;
 
-  /// Returns all the top-level matches in `func`.
+  /// Returns all the top-level matches in `func`. When this pattern is
+  /// constrained to an operation kind, only the operations of that kind are
+  /// visited, via the per-function kind index behind Function::walk(name).
   void match(Function *func, SmallVectorImpl<NestedMatch> *matches) {
+    if (!kindName.empty()) {
+      func->walk(OperationName(kindName, func->getContext()),
+                 [&](Operation *op) { matchOne(op, matches); });
+      return;
+    }
     func->walk([&](Operation *op) { matchOne(op, matches); });
   }
 
@@ -131,6 +146,11 @@ private:
   /// Nested patterns to be matched.
   ArrayRef<NestedPattern> nestedPatterns;
 
+  /// If non-empty, the name of the only operation kind this pattern can
+  /// match. Checked before `filter` so mismatched operations never pay for a
+  /// std::function invocation.
+  StringRef kindName;
+
   /// Extra filter function to apply to prune patterns as the IR is walked.
   FilterFunctionType filter;
 
@@ -166,6 +186,13 @@ struct NestedPatternContext {
     NestedMatch::allocator() = nullptr;
     NestedPattern::allocator() = nullptr;
   }
+
+  /// Releases all pattern and match storage back to the allocator so the
+  /// context can be reused for another round of matching without
+  /// re-requesting memory from the system. All patterns and matches built so
+  /// far are invalidated.
+  void clear() { allocator.Reset(); }
+
   llvm::BumpPtrAllocator allocator;
 };
 
@@ -38,6 +38,14 @@ FunctionPassBase *createTestMemRefDependenceCheckPass();
 /// Creates a pass to test parallelism detection; emits note for parallel loops.
 FunctionPassBase *createParallelismDetectionTestPass();
 
+/// Creates a pass to test alias analysis; emits a remark per pair of memref
+/// accesses with their alias relation.
+FunctionPassBase *createTestAliasAnalysisPass();
+
+/// Creates a pass to test the loop nest cost model; emits a remark with the
+/// estimates for each outermost loop nest.
+FunctionPassBase *createTestLoopNestCostModelPass();
+
 } // end namespace mlir
 
 #endif // MLIR_ANALYSIS_PASSES_H
@@ -30,6 +30,7 @@
 #include "mlir/IR/Block.h"
 #include "mlir/IR/Location.h"
 #include "mlir/Support/LLVM.h"
+#include "llvm/ADT/DenseMap.h"
 #include "llvm/ADT/SmallVector.h"
 #include <memory>
 
@@ -99,6 +100,9 @@ struct ComputationSliceState {
 /// of loop IVs and symbols of the loop nest surrounding 'depSourceAccess' at
 /// 'loopDepth'.
 /// The slice loop bounds and associated operands are returned in 'sliceState'.
+/// Computed bounds are interned per (op pair, depth, direction) and reused
+/// until the enclosing function is modified; when a cached result is reused,
+/// 'dependenceConstraints' is left unmodified.
 //
 //  Backward slice example:
 //
@@ -277,6 +281,46 @@ struct MemRefRegion {
   FlatAffineConstraints cst;
 };
 
+/// Memoizes MemRefRegion::compute across accesses that share the same
+/// footprint shape. Unrolled and fused code often contains many accesses with
+/// identical access maps over the same memref under the same surrounding
+/// loops; recomputing the constraint construction and projection for each of
+/// them is wasteful. The key is the access map together with its operands,
+/// the accessed memref, and the enclosing loops the region remains symbolic
+/// in - since maps and values are uniqued, key comparison is a handful of
+/// pointer compares. Only queries without a computation slice are memoized.
+/// The memoized constraint systems are keyed on IR values; clear the cache
+/// before mutating the IR it was queried on.
+class MemRefRegionCache {
+public:
+  /// Computes the region for 'op' the way MemRefRegion::compute does, reusing
+  /// the memoized constraint system when an access with the same shape has
+  /// already been computed through this cache.
+  LogicalResult compute(MemRefRegion *region, Operation *op, unsigned loopDepth,
+                        bool addMemRefDimBounds = true);
+
+  /// Drops all memoized regions.
+  void clear() { entries.clear(); }
+
+private:
+  struct Entry {
+    // Access map operands followed by the enclosing loop IVs up to the query
+    // depth; distinguishes accesses sharing the same (map, memref) bucket.
+    SmallVector<Value *, 8> keyValues;
+    unsigned loopDepth;
+    bool addMemRefDimBounds;
+    // The memoized region constraint system.
+    FlatAffineConstraints cst;
+  };
+
+  // Buckets keyed on (access map, memref); an entry within a bucket is
+  // identified by its operands, enclosing loops, and query parameters.
+  llvm::DenseMap<std::pair<AffineMap, Value *>, SmallVector<Entry, 2>> entries;
+};
+
+/// Returns the size of one element of the given memref type in bytes.
+unsigned getMemRefEltSizeInBytes(MemRefType memRefType);
+
 /// Returns the size of memref data in bytes if it's statically shaped, None
 /// otherwise.
 Optional<uint64_t> getMemRefSizeInBytes(MemRefType memRefType);
@@ -296,8 +340,26 @@ unsigned getNumCommonSurroundingLoops(Operation &A, Operation &B);
 Optional<int64_t> getMemoryFootprintBytes(AffineForOp forOp,
                                           int memorySpace = -1);
 
-/// Returns true if `forOp' is a parallel loop.
-bool isLoopParallel(AffineForOp forOp);
+/// A description of one recognized reduction over a loop-carried value of an
+/// 'affine.for' operation.
+struct LoopReduction {
+  /// The kind of combining operation performed each iteration.
+  enum class Kind { AddF, MulF, AddI, MulI };
+  Kind kind;
+
+  /// The position of the reduced value in the loop's carried values and
+  /// results.
+  unsigned position;
+};
+
+/// Returns true if `forOp' is a parallel loop. If 'parallelReductions' is
+/// provided, loop-carried values whose per-iteration update is a chain of one
+/// supported associative and commutative operation kind are accepted and
+/// described in the vector; otherwise any loop-carried value makes the loop
+/// sequential.
+bool isLoopParallel(AffineForOp forOp,
+                    SmallVectorImpl<LoopReduction> *parallelReductions =
+                        nullptr);
 
 } // end namespace mlir
 
@@ -34,6 +34,18 @@ struct LogicalResult;
 LogicalResult convertAffineLoopNestToGPULaunch(AffineForOp forOp,
                                                unsigned numBlockDims,
                                                unsigned numThreadDims);
+
+/// Interchange the perfectly nested loops rooted at `forOp` so that the loop
+/// along whose induction variable the nest's memory accesses are contiguous
+/// ends up at depth `numBlockDims`, i.e. mapped to the x thread dimension by
+/// the conversion above.  Adjacent threads then access adjacent memory
+/// locations and the accesses coalesce.  The interchange is only performed
+/// when it does not violate the dependences of the nest.  Returns the root of
+/// the resulting loop nest; the nest is left unchanged when no profitable
+/// legal interchange exists.
+AffineForOp interchangeForGPUCoalescing(AffineForOp forOp,
+                                        unsigned numBlockDims,
+                                        unsigned numThreadDims);
 } // namespace mlir
 
 #endif // MLIR_CONVERSION_AFFINETOGPU_AFFINETOGPU_H_
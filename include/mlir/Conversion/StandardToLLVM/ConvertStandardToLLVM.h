@@ -25,6 +25,7 @@
 #define MLIR_CONVERSION_STANDARDTOLLVM_CONVERTSTANDARDTOLLVM_H
 
 #include "mlir/Transforms/DialectConversion.h"
+#include "llvm/ADT/DenseMap.h"
 
 namespace llvm {
 class IntegerType;
@@ -47,9 +48,18 @@ public:
   LLVMTypeConverter(MLIRContext *ctx);
 
   /// Convert types to LLVM IR.  This calls `convertAdditionalType` to convert
-  /// non-standard or non-builtin types.
+  /// non-standard or non-builtin types.  Successful conversions are memoized
+  /// for the lifetime of the converter, so repeated occurrences of the same
+  /// uniqued source type cost a hash lookup instead of a re-conversion.
   Type convertType(Type t) override;
 
+  /// Eagerly convert the types appearing in the signatures of all functions in
+  /// `m`, populating the conversion cache so that the subsequent pattern-driven
+  /// body conversion finds its function and memref types pre-converted.  A
+  /// type that fails to convert is simply not cached; the actual conversion
+  /// retries it and fails the pass as usual.
+  void preconvertSignatureTypes(Module &m);
+
   /// Convert a non-empty list of types to be returned from a function into a
   /// supported LLVM IR type.  In particular, if more than one values is
   /// returned, create an LLVM IR structure type with elements that correspond
@@ -115,6 +125,10 @@ private:
 
   // Extract an LLVM IR dialect type.
   LLVM::LLVMType unwrap(Type type);
+
+  // Memoized results of successful type conversions. Source types are uniqued
+  // in the MLIRContext, so the source Type itself is the key.
+  llvm::DenseMap<Type, Type> conversionCache;
 };
 
 /// Base class for operation conversions targeting the LLVM IR dialect. Provides
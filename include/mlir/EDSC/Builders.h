@@ -27,6 +27,7 @@
 #include "mlir/IR/Builders.h"
 #include "mlir/StandardOps/Ops.h"
 #include "mlir/VectorOps/VectorOps.h"
+#include "llvm/Support/Allocator.h"
 
 namespace mlir {
 
@@ -74,6 +75,17 @@ private:
 
   static ScopedContext *&getCurrentScopedContext();
 
+  /// Creates a ScopedContext for a NestedBuilder body out of the outermost
+  /// scope's arena, recycling the slot of a previously exited scope when one
+  /// is available.
+  static ScopedContext *createNestedScope(OpBuilder &builder,
+                                          OpBuilder::InsertPoint newInsertPt,
+                                          Location location);
+
+  /// Destroys a scope obtained from createNestedScope and parks its slot for
+  /// reuse.
+  static void destroyNestedScope(ScopedContext *scope);
+
   /// Top level OpBuilder.
   OpBuilder &builder;
   /// The previous insertion point of the builder.
@@ -85,6 +97,13 @@ private:
   /// Defensively keeps track of the current NestedBuilder to ensure proper
   /// scoping usage.
   NestedBuilder *nestedBuilder;
+  /// Arena backing the scopes that NestedBuilders enter for loop and block
+  /// bodies. Scope lifetimes nest strictly, so exited scopes park their slot
+  /// on freeScopeSlots for reuse and all memory is reclaimed wholesale when
+  /// the owning scope exits. Only the outermost ScopedContext's arena is ever
+  /// used, so emitting a snippet incurs no per-scope malloc.
+  llvm::BumpPtrAllocator scopeArena;
+  SmallVector<void *, 8> freeScopeSlots;
 
   // TODO: Implement scoping of ValueHandles. To do this we need a proper data
   // structure to hold ValueHandle objects. We can emulate one but there should
@@ -116,24 +135,25 @@ protected:
   /// Enter an mlir::Block and setup a ScopedContext to insert operations at
   /// the end of it. Since we cannot use c++ language-level scoping to implement
   /// scoping itself, we use enter/exit pairs of operations.
-  /// As a consequence we must allocate a new OpBuilder + ScopedContext and
-  /// let the escape.
+  /// As a consequence we must create a new ScopedContext that escapes the
+  /// enter call; it lives in the outermost scope's arena so that entering a
+  /// scope does not allocate.
   /// Step back "prev" times from the end of the block to set up the insertion
   /// point, which is useful for non-empty blocks.
   void enter(mlir::Block *block, int prev = 0) {
-    bodyScope = new ScopedContext(
+    bodyScope = ScopedContext::createNestedScope(
         ScopedContext::getBuilder(),
         OpBuilder::InsertPoint(block, std::prev(block->end(), prev)),
         ScopedContext::getLocation());
     bodyScope->nestedBuilder = this;
   }
 
-  /// Exit the current mlir::Block by explicitly deleting the dynamically
-  /// allocated OpBuilder and ScopedContext.
+  /// Exit the current mlir::Block by explicitly destroying the dynamically
+  /// created ScopedContext.
   void exit() {
     // Reclaim now to exit the scope.
     bodyScope->nestedBuilder = nullptr;
-    delete bodyScope;
+    ScopedContext::destroyNestedScope(bodyScope);
     bodyScope = nullptr;
   }
 
@@ -92,8 +92,9 @@ public:
     values.append(vals.begin(), vals.end());
   }
   ValueHandleArray(ArrayRef<index_t> vals) {
-    llvm::SmallVector<IndexHandle, 8> tmp(vals.begin(), vals.end());
-    values.append(tmp.begin(), tmp.end());
+    values.reserve(vals.size());
+    for (index_t v : vals)
+      values.push_back(IndexHandle(v));
   }
   operator ArrayRef<Value *>() { return values; }
 
@@ -23,11 +23,17 @@
 #define MLIR_EXECUTIONENGINE_EXECUTIONENGINE_H_
 
 #include "mlir/Support/LLVM.h"
+#include "llvm/ADT/SmallVector.h"
+#include "llvm/ADT/StringMap.h"
+#include "llvm/ADT/StringSet.h"
 #include "llvm/IR/LLVMContext.h"
 #include "llvm/Support/Error.h"
+#include "llvm/Support/Mutex.h"
 
+#include <atomic>
 #include <functional>
 #include <memory>
+#include <thread>
 
 namespace llvm {
 template <typename T> class Expected;
@@ -61,14 +67,45 @@ public:
   /// can be used, e.g., for reporting or optimization.
   /// If `sharedLibPaths` are provided, the underlying JIT-compilation will open
   /// and link the shared libraries for symbol resolution.
+  /// If `objectCacheDir` is provided, compiled objects are stored in that
+  /// directory keyed by a content hash of the module's textual form; when a
+  /// byte-identical module is seen again (including across processes), the
+  /// cached object is loaded and translation, optimization and codegen are
+  /// skipped entirely.
+  /// If `enableLazyCompilation` is set, functions are compiled on demand when
+  /// first looked up rather than all at once on the first lookup into the
+  /// module.
+  /// If `tieredRecompileThreshold` is non-zero, the engine starts in a fast
+  /// tier that skips `transformer` and uses quick codegen, minimizing
+  /// cold-start latency. Once any function has been invoked that many times,
+  /// the captured module is recompiled with `transformer` and full codegen on
+  /// a background thread, and lookups switch to the optimized code when it is
+  /// ready. Callers that cache the function pointer returned by `lookup` keep
+  /// running fast-tier code; `invoke` always uses the best available tier.
+  /// If `enablePerfMap` is set, the load addresses of JIT'd functions are
+  /// appended to /tmp/perf-<pid>.map so perf(1) can symbolize their frames.
+  /// If `enableProfileCounters` is set, every function is instrumented with
+  /// invocation and cycle counters readable through `getInvocationCount` and
+  /// `getCycleCount`.
   static llvm::Expected<std::unique_ptr<ExecutionEngine>>
   create(Module *m, std::function<llvm::Error(llvm::Module *)> transformer = {},
-         ArrayRef<StringRef> sharedLibPaths = {});
+         ArrayRef<StringRef> sharedLibPaths = {}, StringRef objectCacheDir = "",
+         bool enableLazyCompilation = false,
+         unsigned tieredRecompileThreshold = 0, bool enablePerfMap = false,
+         bool enableProfileCounters = false);
 
   /// Looks up a packed-argument function with the given name and returns a
   /// pointer to it.  Propagates errors in case of failure.
   llvm::Expected<void (*)(void **)> lookup(StringRef name) const;
 
+  /// Asynchronous version of `lookup`: runs the lookup (and therefore any
+  /// compilation it triggers) on a background thread and invokes `callback`
+  /// with the result once the function is ready. Outstanding callbacks are
+  /// waited on when the engine is destroyed.
+  void lookupAsync(
+      StringRef name,
+      std::function<void(llvm::Expected<void (*)(void **)>)> callback);
+
   /// Invokes the function with the given name passing it the list of arguments.
   /// The arguments are accepted by lvalue-reference since the packed function
   /// interface expects a list of non-null pointers.
@@ -80,29 +117,119 @@ public:
   /// the templated `invoke`.
   llvm::Error invoke(StringRef name, MutableArrayRef<void *> args);
 
+  /// A function resolved once together with a pre-packed argument array.
+  /// `invoke` resolves the symbol and packs the arguments on every call;
+  /// callers in a hot serving loop prepare the call once, keep the bound
+  /// argument memory (e.g. MemRef descriptors) alive and rewrite it in place
+  /// between calls, and pay only the indirect call per invocation.
+  class PreparedCall {
+  public:
+    /// Re-binds argument slot 'index' to point at different argument storage.
+    void bindArgument(unsigned index, void *arg) {
+      assert(index < args.size() && "argument slot out of range");
+      args[index] = arg;
+    }
+
+    /// Invokes the prepared function over the bound arguments.
+    void invoke() { (*fptr)(args.data()); }
+
+    /// Invokes the prepared function once per packed argument set in
+    /// 'argSets', amortizing the call into the engine over the whole batch.
+    /// Each set must hold one pointer per argument slot and is passed to the
+    /// function directly, without touching the bound arguments.
+    void invokeBatch(ArrayRef<MutableArrayRef<void *>> argSets);
+
+  private:
+    friend class ExecutionEngine;
+    PreparedCall(void (*fptr)(void **), ArrayRef<void *> args)
+        : fptr(fptr), args(args.begin(), args.end()) {}
+
+    void (*fptr)(void **);
+    llvm::SmallVector<void *, 8> args;
+  };
+
+  /// Adds the functions of another MLIR module to the running engine without
+  /// recompiling anything added before. The new module may call functions
+  /// defined by the creation module and by modules added earlier; its own
+  /// definitions shadow earlier ones of the same name in subsequent lookups,
+  /// which is how an updated kernel is hot-swapped. Orc cannot unload
+  /// materialized code, so a superseded definition stays resident until the
+  /// engine is destroyed, and cached function pointers and prepared calls
+  /// keep targeting the code they resolved against.
+  llvm::Error addModule(Module *m);
+
+  /// Resolves the function with the given name once and packs 'args' into a
+  /// reusable call handle. The handle caches the function pointer of the tier
+  /// that is live at preparation time: it keeps working when the optimized
+  /// tier is published later, but does not switch to it, and its invocations
+  /// do not advance the tiered recompilation counters. Prepare after warmup
+  /// (or with tiering disabled) to run optimized code.
+  llvm::Expected<PreparedCall> prepare(StringRef name,
+                                       ArrayRef<void *> args = {});
+
+  /// Returns the number of times the named function has been invoked, or the
+  /// number of cycles spent in it, respectively. Only available when the
+  /// engine was created with `enableProfileCounters`; fails otherwise. The
+  /// counters are updated without atomics and are statistical under
+  /// concurrent callers.
+  llvm::Expected<uint64_t> getInvocationCount(StringRef name) const;
+  llvm::Expected<uint64_t> getCycleCount(StringRef name) const;
+
   /// Set the target triple on the module. This is implicitly done when creating
   /// the engine.
   static bool setupTargetTriple(llvm::Module *llvmModule);
 
 private:
+  /// Count an invocation of the named function and start the background
+  /// recompilation at full optimization once the configured threshold is
+  /// crossed. No-op when tiered compilation is disabled.
+  void recordInvocation(StringRef name);
+
+  /// Build the optimized tier from the captured bitcode. Runs on a background
+  /// thread; on success, publishes the new JIT for use by subsequent lookups.
+  void buildOptimizedTier();
+
+  /// Read the value of an injected profile counter global with the given
+  /// symbol name from the active tier.
+  llvm::Expected<uint64_t> readProfileCounter(StringRef symbol) const;
+
   // Ordering of llvmContext and jit is important for destruction purposes: the
   // jit must be destroyed before the context.
   llvm::LLVMContext llvmContext;
   // Private implementation of the JIT (PIMPL)
   std::unique_ptr<impl::OrcJIT> jit;
+  // Threads running asynchronous lookups; joined in the destructor before the
+  // JIT they use is torn down.
+  llvm::SmallVector<std::thread, 4> asyncLookupThreads;
+
+  // Tiered compilation state. Unused when tieredRecompileThreshold is zero.
+  // The bitcode of the unoptimized module is captured at creation time so the
+  // optimized tier can be rebuilt without the MLIR module, which the caller
+  // may have destroyed by then.
+  unsigned tieredRecompileThreshold = 0;
+  std::function<llvm::Error(llvm::Module *)> optimizedTransformer;
+  std::string tieredBitcode;
+  std::vector<std::string> tieredSharedLibPaths;
+  // Per-function invocation counts used to trigger the recompile. Guarded by
+  // invocationCountMutex.
+  llvm::StringMap<uint64_t> invocationCounts;
+  llvm::sys::SmartMutex<true> invocationCountMutex;
+  // Names of functions defined by incrementally added modules. Lookups of
+  // these skip the optimized tier, which was built from the creation module
+  // and would resolve to the superseded definition. Guarded by
+  // incrementalNamesMutex.
+  llvm::StringSet<> incrementalNames;
+  mutable llvm::sys::SmartMutex<true> incrementalNamesMutex;
+  std::atomic<bool> recompileStarted{false};
+  std::atomic<bool> optimizedReady{false};
+  std::unique_ptr<impl::OrcJIT> optimizedJit;
+  std::thread recompileThread;
 };
 
 template <typename... Args>
 llvm::Error ExecutionEngine::invoke(StringRef name, Args &... args) {
-  auto expectedFPtr = lookup(name);
-  if (!expectedFPtr)
-    return expectedFPtr.takeError();
-  auto fptr = *expectedFPtr;
-
   llvm::SmallVector<void *, 8> packedArgs{static_cast<void *>(&args)...};
-  (*fptr)(packedArgs.data());
-
-  return llvm::Error::success();
+  return invoke(name, packedArgs);
 }
 
 } // end namespace mlir
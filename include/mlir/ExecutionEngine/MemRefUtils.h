@@ -50,6 +50,49 @@ allocateMemRefArguments(Function *func, float initialValue = 0.0);
 /// element type f32.
 void freeMemRefArguments(ArrayRef<void *> args);
 
+/// Given an MLIR function that takes only statically-shaped memrefs with
+/// element type f32, build a descriptor per argument that aliases the
+/// corresponding caller-owned, contiguous data buffer — no allocation or
+/// copy of the data itself is made — and allocate result descriptors as
+/// allocateMemRefArguments does. `buffers` must contain one pointer per
+/// function argument and each buffer must outlive the descriptors.
+llvm::Expected<SmallVector<void *, 8>>
+bindMemRefArguments(Function *func, ArrayRef<float *> buffers);
+
+/// Free a list of descriptors created by bindMemRefArguments without
+/// touching the externally owned data they alias.
+void freeMemRefDescriptors(ArrayRef<void *> args);
+
+/// A reusable argument pack for repeated invocations of the same JIT-compiled
+/// function. The descriptors are built once, aliasing caller-owned buffers,
+/// and can be rebound to new buffers between calls so that per-call
+/// marshalling costs nothing beyond the pointer stores.
+class MemRefArgumentPack {
+public:
+  /// Builds a pack for `func` with its arguments bound to `buffers`, as in
+  /// bindMemRefArguments.
+  static llvm::Expected<MemRefArgumentPack> create(Function *func,
+                                                   ArrayRef<float *> buffers);
+
+  MemRefArgumentPack(MemRefArgumentPack &&other) : args(std::move(other.args)) {
+    other.args.clear();
+  }
+  MemRefArgumentPack(const MemRefArgumentPack &) = delete;
+  MemRefArgumentPack &operator=(const MemRefArgumentPack &) = delete;
+  ~MemRefArgumentPack();
+
+  /// Rebinds the data buffer aliased by the descriptor at `index`.
+  void rebind(unsigned index, float *buffer);
+
+  /// Returns the type-erased descriptor pointers to pass to the invocation.
+  MutableArrayRef<void *> getArguments() { return args; }
+
+private:
+  MemRefArgumentPack() = default;
+
+  SmallVector<void *, 8> args;
+};
+
 } // namespace mlir
 
 #endif // MLIR_EXECUTIONENGINE_MEMREFUTILS_H_
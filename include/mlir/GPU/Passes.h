@@ -24,10 +24,13 @@
 
 namespace mlir {
 
+class FunctionPassBase;
 class ModulePassBase;
 
 ModulePassBase *createGpuKernelOutliningPass();
 
+FunctionPassBase *createGpuSharedMemoryStagingPass();
+
 } // namespace mlir
 
 #endif // MLIR_GPU_PASSES_H_
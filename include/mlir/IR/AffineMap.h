@@ -92,6 +92,11 @@ public:
   ArrayRef<AffineExpr> getResults() const;
   AffineExpr getResult(unsigned idx) const;
 
+  /// Returns the hash of this map's uniquing key, precomputed at creation
+  /// time. This is an implementation detail of the context's uniquing table;
+  /// use hash_value to hash maps by identity.
+  unsigned getUniquingHash() const;
+
   /// Walk all of the AffineExpr's in this mapping. Each node in an expression
   /// tree is visited in postorder.
   void walkExprs(std::function<void(AffineExpr)> callback) const;
@@ -411,6 +411,12 @@ public:
   /// Get an instance of a StringAttr with the given string and Type.
   static StringAttr get(StringRef bytes, Type type);
 
+  /// Get an instance of a StringAttr holding the string of the given
+  /// identifier. This is a fast path for callers that already hold an
+  /// Identifier: the attribute references the identifier's context-interned
+  /// string in place instead of copying it into the attribute allocator.
+  static StringAttr getInterned(Identifier str, MLIRContext *context);
+
   StringRef getValue() const;
 
   /// Methods for support type inquiry through isa, cast, and dyn_cast.
@@ -547,6 +553,32 @@ public:
     return get(type, ArrayRef<T>(list));
   }
 
+  /// Constructs a dense elements attribute that references the provided raw
+  /// data buffer directly instead of copying it into the context. The buffer
+  /// must use the same element layout as context-owned storage, and the
+  /// caller must guarantee that it outlives the MLIRContext, e.g. an mmap'd
+  /// region. The data is still hashed once for uniquing, but no copy or
+  /// allocation proportional to its size is made.
+  static DenseElementsAttr getFromBuffer(ShapedType type, ArrayRef<char> data);
+
+  /// Constructs a dense elements attribute by copying the provided raw data
+  /// buffer into the context. 'rawBuffer' must use the dense storage layout
+  /// of the element type of 'type' and hold either one entry per element or
+  /// a single entry for a splat; see isValidRawBuffer. This is the entry
+  /// point for deserializing hex-encoded literals without any per-element
+  /// processing.
+  static DenseElementsAttr getFromRawBuffer(ShapedType type,
+                                            ArrayRef<char> rawBuffer);
+
+  /// Returns true if 'rawBuffer' has the size expected for the dense storage
+  /// of 'type': one storage-width entry per element, or a single entry
+  /// encoding a splat.
+  static bool isValidRawBuffer(ShapedType type, ArrayRef<char> rawBuffer);
+
+  /// Return the raw storage data held by this attribute. For a splat, this is
+  /// the storage of the single repeated element.
+  ArrayRef<char> getRawData() const;
+
   //===--------------------------------------------------------------------===//
   // Iterators
   //===--------------------------------------------------------------------===//
@@ -686,9 +718,6 @@ public:
             llvm::function_ref<APInt(const APFloat &)> mapping) const;
 
 protected:
-  /// Return the raw storage data held by this attribute.
-  ArrayRef<char> getRawData() const;
-
   /// Get iterators to the raw APInt values for each element in this attribute.
   IntElementIterator raw_int_begin() const {
     return IntElementIterator(*this, 0);
@@ -880,8 +909,9 @@ inline ::llvm::hash_code hash_value(Attribute arg) {
 /// within a DictionaryAttr.
 ///
 /// We assume there will be relatively few attributes on a given operation
-/// (maybe a dozen or so, but not hundreds or thousands) so we use linear
-/// searches for everything.
+/// (maybe a dozen or so, but not hundreds or thousands). Lookups scan small
+/// lists linearly and binary search larger ones through the sorted dictionary
+/// storage; mutation rebuilds the uniqued dictionary.
 class NamedAttributeList {
 public:
   NamedAttributeList(DictionaryAttr attrs = nullptr)
@@ -24,6 +24,7 @@
 
 #include "mlir/IR/Value.h"
 #include "llvm/ADT/PointerUnion.h"
+#include "llvm/ADT/SmallVector.h"
 #include "llvm/ADT/ilist.h"
 #include "llvm/ADT/ilist_node.h"
 
@@ -139,6 +140,13 @@ public:
   /// terminators of each predecessor to this block.
   void eraseArgument(unsigned index, bool updatePredTerms = true);
 
+  /// Erase 'num' arguments starting at 'start' in a single batch, avoiding
+  /// the per-argument list shift of repeated eraseArgument calls. If
+  /// 'updatePredTerms' is set to true, the arguments are also removed from the
+  /// terminators of each predecessor to this block.
+  void eraseArguments(unsigned start, unsigned num,
+                      bool updatePredTerms = true);
+
   unsigned getNumArguments() { return arguments.size(); }
   BlockArgument *getArgument(unsigned i) { return arguments[i]; }
 
@@ -196,6 +204,15 @@ public:
   /// Recomputes the ordering of child operations within the block.
   void recomputeInstOrder();
 
+  /// Reassigns order indices to a local neighborhood of operations around the
+  /// inclusive range ['first', 'last'], growing the window until the index
+  /// range bounded by the operations just outside of it leaves a gap between
+  /// every pair of neighbors. Falls back to recomputing the order of the
+  /// whole block when no sparse-enough window exists. This keeps order
+  /// maintenance amortized constant time instead of renumbering the entire
+  /// block every time a gap is exhausted.
+  void redistributeInstOrder(Operation *first, Operation *last);
+
   //===--------------------------------------------------------------------===//
   // Terminator management
   //===--------------------------------------------------------------------===//
@@ -296,8 +313,10 @@ private:
   /// This is the list of operations in the block.
   InstListType operations;
 
-  /// This is the list of arguments to the block.
-  std::vector<BlockArgument *> arguments;
+  /// This is the list of arguments to the block. Lowered CFG-style code is
+  /// dominated by blocks with one or two arguments, so keep that many inline
+  /// before spilling to the heap.
+  SmallVector<BlockArgument *, 2> arguments;
 
   Block(Block &) = delete;
   void operator=(Block &) = delete;
@@ -36,14 +36,28 @@ class BlockAndValueMapping {
 public:
   /// Inserts a new mapping for 'from' to 'to'. If there is an existing mapping,
   /// it is overwritten.
-  void map(Block *from, Block *to) { valueMap[from] = to; }
-  void map(Value *from, Value *to) { valueMap[from] = to; }
+  void map(Block *from, Block *to) { mapImpl(from, to); }
+  void map(Value *from, Value *to) { mapImpl(from, to); }
 
   /// Erases a mapping for 'from'.
-  void erase(IRObjectWithUseList *from) { valueMap.erase(from); }
+  void erase(IRObjectWithUseList *from) {
+    if (!denseIndex.empty()) {
+      auto it = denseIndex.find(from);
+      if (it != denseIndex.end()) {
+        denseTargets[it->second] = nullptr;
+        return;
+      }
+    }
+    valueMap.erase(from);
+  }
 
   /// Checks to see if a mapping for 'from' exists.
   bool contains(IRObjectWithUseList *from) const {
+    if (!denseIndex.empty()) {
+      auto it = denseIndex.find(from);
+      if (it != denseIndex.end())
+        return denseTargets[it->second] != nullptr;
+    }
     return valueMap.count(from);
   }
 
@@ -73,19 +87,81 @@ public:
     return result;
   }
 
-  /// Clears all mappings held by the mapper.
-  void clear() { valueMap.clear(); }
+  /// Clears all mappings held by the mapper, including any dense source
+  /// numbering.
+  void clear() {
+    valueMap.clear();
+    denseIndex.clear();
+    denseTargets.clear();
+  }
+
+  /// Returns true if no mappings are held by the mapper. A mapper with a dense
+  /// source numbering is conservatively considered non-empty.
+  bool empty() const { return valueMap.empty() && denseIndex.empty(); }
+
+  /// Pre-allocate space for at least 'capacity' mappings, so that inserting
+  /// them does not trigger incremental re-hashing.
+  void reserve(unsigned capacity) { valueMap.reserve(capacity); }
+
+  /// Number every value defined within 'block' - its arguments, the results of
+  /// its operations, and the blocks and values of any nested regions - as
+  /// dense sources. Mappings from dense sources are stored in a flat vector
+  /// indexed by the numbering rather than in the hash map, and
+  /// resetDenseMappings() drops them without releasing memory. Callers that
+  /// clone the same source region many times (e.g. loop unrolling) number the
+  /// source once and reuse a single mapper for every copy. This must be called
+  /// before any mappings are inserted.
+  void numberDenseSources(Block *block);
+
+  /// Clears all mappings while keeping the dense source numbering, so that the
+  /// mapper can be reused for another clone of the same source region.
+  void resetDenseMappings() {
+    denseTargets.assign(denseTargets.size(), nullptr);
+    valueMap.clear();
+  }
 
 private:
   /// Utility lookupOrValue that looks up an existing key or returns the
   /// provided value. This function assumes that if a mapping does exist, then
   /// it is of 'T' type.
   template <typename T> T *lookupOrValue(T *from, T *value) const {
+    if (!denseIndex.empty()) {
+      auto denseIt = denseIndex.find(from);
+      if (denseIt != denseIndex.end()) {
+        auto *to = denseTargets[denseIt->second];
+        return to ? static_cast<T *>(to) : value;
+      }
+    }
     auto it = valueMap.find(from);
     return it != valueMap.end() ? static_cast<T *>(it->second) : value;
   }
 
+  /// Record a mapping for 'from', routing it to the flat dense table if 'from'
+  /// is a numbered dense source.
+  void mapImpl(IRObjectWithUseList *from, IRObjectWithUseList *to) {
+    if (!denseIndex.empty()) {
+      auto it = denseIndex.find(from);
+      if (it != denseIndex.end()) {
+        denseTargets[it->second] = to;
+        return;
+      }
+    }
+    valueMap[from] = to;
+  }
+
+  /// Assign 'from' the next dense index if it does not already have one.
+  void numberDenseSource(IRObjectWithUseList *from) {
+    if (denseIndex.insert({from, unsigned(denseTargets.size())}).second)
+      denseTargets.push_back(nullptr);
+  }
+
   llvm::DenseMap<IRObjectWithUseList *, IRObjectWithUseList *> valueMap;
+
+  /// One-time numbering of dense sources, and the flat per-clone target table
+  /// it indexes into. The numbering is read-only after numberDenseSources, so
+  /// lookups never re-hash, and target insertion is a plain vector store.
+  llvm::DenseMap<IRObjectWithUseList *, unsigned> denseIndex;
+  llvm::SmallVector<IRObjectWithUseList *, 8> denseTargets;
 };
 
 } // end namespace mlir
@@ -20,6 +20,7 @@
 
 #include "mlir/IR/Function.h"
 #include "mlir/IR/OpDefinition.h"
+#include "mlir/Support/STLExtras.h"
 
 namespace mlir {
 
@@ -181,6 +182,15 @@ protected:
 
 /// This class helps build Operations. Operations that are created are
 /// automatically inserted at an insertion point. The builder is copyable.
+namespace detail {
+/// Detects whether 'OpTy' provides a generated 'directBuild' overload
+/// callable with the given argument types.
+template <typename OpTy, typename... Args>
+using has_direct_build_t = decltype(OpTy::directBuild(
+    std::declval<Builder *>(), std::declval<Location>(),
+    std::declval<Args>()...));
+} // namespace detail
+
 class OpBuilder : public Builder {
 public:
   /// Create a builder and set the insertion point to the start of the region.
@@ -292,12 +302,37 @@ public:
   /// Returns the current block of the builder.
   Block *getBlock() const { return block; }
 
-  /// Creates an operation given the fields represented as an OperationState.
-  virtual Operation *createOperation(const OperationState &state);
+  /// Inserts the given operation, which must not yet be in a block, at the
+  /// current insertion point. This is the hook rewriters override to observe
+  /// newly created operations; every builder creation path funnels through
+  /// it.
+  virtual Operation *insert(Operation *op);
+
+  /// Creates an operation given the fields represented as an OperationState
+  /// and inserts it at the current insertion point.
+  Operation *createOperation(const OperationState &state);
 
   /// Create an operation of specific op type at the current insertion point.
+  /// Ops with a fixed number of operands and results and no attributes
+  /// provide a generated 'directBuild' method that constructs the operation
+  /// in place; when the call matches its signature the OperationState staging
+  /// step is skipped entirely.
+  template <typename OpTy, typename... Args>
+  typename std::enable_if<
+      is_detected<detail::has_direct_build_t, OpTy, Args...>::value,
+      OpTy>::type
+  create(Location location, Args... args) {
+    auto *op = insert(OpTy::directBuild(this, location, args...));
+    auto result = dyn_cast<OpTy>(op);
+    assert(result && "Builder didn't return the right type");
+    return result;
+  }
+
   template <typename OpTy, typename... Args>
-  OpTy create(Location location, Args... args) {
+  typename std::enable_if<
+      !is_detected<detail::has_direct_build_t, OpTy, Args...>::value,
+      OpTy>::type
+  create(Location location, Args... args) {
     OperationState state(location, OpTy::getOperationName());
     OpTy::build(this, &state, args...);
     auto *op = createOperation(state);
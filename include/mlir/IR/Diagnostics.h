@@ -24,6 +24,7 @@
 
 #include "mlir/IR/Location.h"
 #include "mlir/Support/STLExtras.h"
+#include "llvm/Support/Allocator.h"
 #include <functional>
 
 namespace llvm {
@@ -305,9 +306,10 @@ private:
   /// The current list of arguments.
   SmallVector<DiagnosticArgument, 4> arguments;
 
-  /// A list of string values used as arguments. This is used to guarantee the
-  /// liveness of non-constant strings used in diagnostics.
-  std::vector<std::unique_ptr<char[]>> strings;
+  /// An arena holding copies of non-constant strings used as arguments, to
+  /// guarantee their liveness until the diagnostic is sunk. Using one arena
+  /// keeps streaming many fragments from costing an allocation each.
+  llvm::BumpPtrAllocator strings;
 
   /// A list of attached notes.
   NoteVector notes;
@@ -488,6 +490,35 @@ InFlightDiagnostic emitWarning(Location loc, const Twine &message);
 InFlightDiagnostic emitRemark(Location loc);
 InFlightDiagnostic emitRemark(Location loc, const Twine &message);
 
+//===----------------------------------------------------------------------===//
+// OptRemark
+//===----------------------------------------------------------------------===//
+
+/// Utility for transformation passes to report why an optimization was applied
+/// or missed, built on the diagnostic engine's remark severity. Remarks are
+/// disabled by default; '-mlir-remarks' emits them through the context's
+/// diagnostic handler (optionally restricted with '-mlir-remarks-filter'), and
+/// '-mlir-remarks-file' additionally appends them as machine-readable YAML
+/// records. Callers must guard emission with isEnabled() so that formatting
+/// remark arguments costs nothing when remarks are off.
+class OptRemark {
+public:
+  /// Returns true if remarks are enabled for the given pass name. This is a
+  /// flag test plus a substring match against the remark filter, cheap enough
+  /// to query on transformation decision paths.
+  static bool isEnabled(StringRef passName);
+
+  /// Report that 'passName' applied the transformation 'remarkName' at 'loc'.
+  static void passed(Location loc, StringRef passName, StringRef remarkName,
+                     const Twine &message);
+
+  /// Report that 'passName' did not apply the transformation 'remarkName' at
+  /// 'loc', with the reason in 'message', e.g. a blocking dependence or a
+  /// cost model decision.
+  static void missed(Location loc, StringRef passName, StringRef remarkName,
+                     const Twine &message);
+};
+
 //===----------------------------------------------------------------------===//
 // SourceMgrDiagnosticHandler
 //===----------------------------------------------------------------------===//
@@ -522,9 +553,13 @@ protected:
   llvm::raw_ostream &os;
 
 private:
-  /// Convert a location into the given memory buffer into an SMLoc.
+  /// Convert a location into the given memory buffer into an SMLoc. The
+  /// result is memoized per location.
   llvm::SMLoc convertLocToSMLoc(FileLineColLoc loc);
 
+  /// Compute the SMLoc for the given location on a cache miss.
+  llvm::SMLoc computeLocToSMLoc(FileLineColLoc loc);
+
   /// The maximum depth that a call stack will be printed.
   /// TODO(riverriddle) This should be a tunable flag.
   unsigned callStackLimit = 10;
@@ -35,6 +35,15 @@ using DialectConstantFoldHook = std::function<LogicalResult(
 using DialectExtractElementHook =
     std::function<Attribute(const OpaqueElementsAttr, ArrayRef<uint64_t>)>;
 
+/// A bulk constant folding kernel registered by a dialect for one operation
+/// and element type. The kernel receives the raw storage of the two dense
+/// elements operands and writes the folded elements into 'result', which has
+/// the same size as the inputs. All three buffers use the dense storage
+/// layout of the element type, so a kernel is typically a single loop over
+/// native host values that the compiler can vectorize.
+using DialectDenseFoldKernel = std::function<void(
+    ArrayRef<char> lhs, ArrayRef<char> rhs, MutableArrayRef<char> result)>;
+
 /// Dialects are groups of MLIR operations and behavior associated with the
 /// entire group.  For example, hooks into other systems for constant folding,
 /// default named types for asm printing, etc.
@@ -91,6 +100,22 @@ public:
         return Attribute();
       };
 
+  /// Registers a bulk folding kernel for the binary operation 'opName' over
+  /// dense elements constants with the given element type. The kernel is
+  /// consulted by Operation::fold before the elementwise fold hooks whenever
+  /// both operands are non-splat dense elements attributes of a matching
+  /// type, and must compute exactly what an elementwise fold of the operation
+  /// would. Splat operands are deliberately excluded: folding them over the
+  /// single stored element is already cheap.
+  void addDenseFoldKernel(StringRef opName, Type elementType,
+                          DialectDenseFoldKernel kernel);
+
+  /// Attempts to fold the binary operation 'opName' with the given dense
+  /// elements operands through a registered bulk folding kernel. Returns the
+  /// folded attribute, or null if no kernel applies.
+  Attribute foldDenseElements(OperationName opName, DenseElementsAttr lhs,
+                              DenseElementsAttr rhs);
+
   /// Registered hook to materialize a single constant operation from a given
   /// attribute value with the desired resultant type. This method should use
   /// the provided builder to create the operation without changing the
@@ -251,6 +276,10 @@ private:
   /// operations prefixed with the dialect namespace but not registered with
   /// addOperation.
   bool allowUnknownOps;
+
+  /// Bulk constant folding kernels, keyed by operation name and element type.
+  llvm::DenseMap<std::pair<OperationName, Type>, DialectDenseFoldKernel>
+      denseFoldKernels;
 };
 
 using DialectAllocatorFunction = std::function<void(MLIRContext *)>;
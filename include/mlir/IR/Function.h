@@ -25,6 +25,9 @@
 #include "mlir/IR/Block.h"
 #include "mlir/IR/OpDefinition.h"
 #include "llvm/ADT/SmallString.h"
+#include "llvm/ADT/StringSet.h"
+#include <atomic>
+#include <vector>
 
 namespace mlir {
 class BlockAndValueMapping;
@@ -32,6 +35,33 @@ class FunctionType;
 class MLIRContext;
 class Module;
 
+namespace detail {
+/// The SSA value and block numbering computed by the asm printer for a
+/// function. This is cached on the function so that repeatedly printing
+/// unchanged IR, e.g. when snapshotting the IR between passes, does not
+/// recompute the numbering each time. Only the printer reads or writes this.
+struct FunctionPrintNumbering {
+  /// The value ID for each SSA value in the function. An ID of ~0U means the
+  /// value is named and has an entry in valueNames instead.
+  llvm::DenseMap<Value *, unsigned> valueIDs;
+  llvm::DenseMap<Value *, StringRef> valueNames;
+
+  /// The block ID for each block in the function.
+  llvm::DenseMap<Block *, unsigned> blockIDs;
+
+  /// Storage for the non-numeric names referenced by valueNames.
+  llvm::StringSet<> usedNames;
+};
+
+/// A lazily built index from operation name to the operations with that name
+/// in a function body, in postorder. This backs the filtered walk, see
+/// Function::walk(OperationName), so passes that only visit a single kind of
+/// operation do not traverse the rest of the body.
+struct FunctionOpKindIndex {
+  llvm::DenseMap<OperationName, std::vector<Operation *>> opsByName;
+};
+} // end namespace detail
+
 /// This is the base class for all of the MLIR function types.
 class Function : public llvm::ilist_node_with_parent<Function, Module> {
 public:
@@ -75,35 +105,137 @@ public:
   /// Unlink this function from its module and delete it.
   void erase();
 
-  /// Returns true if this function is external, i.e. it has no body.
+  /// Returns true if this function is external, i.e. it has no body. A
+  /// function with an unmaterialized lazy body is not external.
   bool isExternal() { return empty(); }
 
   //===--------------------------------------------------------------------===//
   // Body Handling
   //===--------------------------------------------------------------------===//
 
-  Region &getBody() { return body; }
-  void eraseBody() { body.getBlocks().clear(); }
+  Region &getBody() {
+    materializeBody();
+    return body;
+  }
+  void eraseBody() {
+    lazyBodySource = nullptr;
+    body.getBlocks().clear();
+  }
+
+  /// Set a callback from which the body of this function is materialized on
+  /// first access. The function must currently have no body. This is used
+  /// when deserializing a module lazily: the body stays an unparsed byte
+  /// range until a pass or analysis actually visits the function.
+  void setLazyBodySource(std::function<void(Function *)> source) {
+    assert(body.empty() && "function already has a body");
+    lazyBodySource = std::move(source);
+  }
+
+  /// If the body of this function has a lazy source, materialize it now. The
+  /// source is dropped once it has run.
+  void materializeBody() {
+    if (LLVM_UNLIKELY(lazyBodySource != nullptr)) {
+      auto source = std::move(lazyBodySource);
+      lazyBodySource = nullptr;
+      source(this);
+    }
+  }
 
   /// This is the list of blocks in the function.
   using RegionType = Region::RegionType;
-  RegionType &getBlocks() { return body.getBlocks(); }
+  RegionType &getBlocks() { return getBody().getBlocks(); }
 
   // Iteration over the block in the function.
   using iterator = RegionType::iterator;
   using reverse_iterator = RegionType::reverse_iterator;
 
-  iterator begin() { return body.begin(); }
-  iterator end() { return body.end(); }
-  reverse_iterator rbegin() { return body.rbegin(); }
-  reverse_iterator rend() { return body.rend(); }
+  iterator begin() { return getBody().begin(); }
+  iterator end() { return getBody().end(); }
+  reverse_iterator rbegin() { return getBody().rbegin(); }
+  reverse_iterator rend() { return getBody().rend(); }
 
-  bool empty() { return body.empty(); }
-  void push_back(Block *block) { body.push_back(block); }
-  void push_front(Block *block) { body.push_front(block); }
+  bool empty() { return body.empty() && !lazyBodySource; }
+  void push_back(Block *block) { getBody().push_back(block); }
+  void push_front(Block *block) { getBody().push_front(block); }
+
+  Block &back() { return getBody().back(); }
+  Block &front() { return getBody().front(); }
 
-  Block &back() { return body.back(); }
-  Block &front() { return body.front(); }
+  //===--------------------------------------------------------------------===//
+  // Verification caching
+  //===--------------------------------------------------------------------===//
+
+  /// Record that the body of this function has been mutated, invalidating any
+  /// cached verification result. Structural mutations (operation and block
+  /// list changes, use-list rewrites, operand list updates) call this
+  /// automatically through the IR infrastructure; code mutating operations
+  /// through lower-level means must call it explicitly to keep incremental
+  /// verification sound.
+  void markBodyModified() { ++modificationCount; }
+
+  /// Returns the current value of the body modification counter. Analyses can
+  /// use this to detect whether the body changed between two points in time.
+  uint64_t getBodyModificationCount() { return modificationCount; }
+
+  /// Returns true if the body has not changed since it last passed
+  /// verification.
+  bool isBodyVerified() { return verifiedCount == modificationCount; }
+
+  /// Returns the number of operations in the body. The count is computed with
+  /// a walk the first time it is requested and cached until the body is
+  /// modified, so repeated queries on an unchanged function are free.
+  uint64_t getCachedOpCount();
+
+  /// Returns a flattened snapshot of every operation in the body, in the same
+  /// postorder as walk(). The snapshot is stored contiguously and is rebuilt
+  /// only when the body has been modified since it was last requested, so
+  /// read-only traversals can iterate it instead of chasing block list
+  /// pointers. The body must not be mutated while the returned array is in
+  /// use.
+  ArrayRef<Operation *> getWalkSnapshot();
+
+  /// Returns a structural fingerprint of the function: a hash of the
+  /// signature, operation names, uniqued attribute and result type
+  /// identities, and operand and successor topology expressed through a local
+  /// value numbering. Locations are ignored. The fingerprint is computed once
+  /// and cached until the body is modified, so repeated queries on an
+  /// unchanged function are free. It identifies IR within a single process
+  /// only, as it hashes uniqued pointers rather than printed text.
+  uint64_t getFingerprint();
+
+  /// Record that the body passed verification in its current state.
+  void markBodyVerified() { verifiedCount = modificationCount; }
+
+  /// Record that a greedy pattern rewrite using the pattern set identified by
+  /// `patternFingerprint` converged on the current body.
+  void markGreedyRewriteConverged(uint64_t patternFingerprint) {
+    greedyRewriteFingerprint = patternFingerprint;
+    greedyRewriteModCount = modificationCount;
+  }
+
+  /// Returns true if a greedy pattern rewrite using the pattern set identified
+  /// by `patternFingerprint` already converged on the body in its current
+  /// state, i.e. re-running it cannot match anything.
+  bool hasGreedyRewriteConverged(uint64_t patternFingerprint) {
+    return greedyRewriteFingerprint == patternFingerprint &&
+           greedyRewriteModCount == modificationCount;
+  }
+
+  /// Record that the function pass pipeline identified by
+  /// `pipelineFingerprint` ran to completion on the current body without
+  /// modifying it.
+  void markPipelineConverged(uint64_t pipelineFingerprint) {
+    this->pipelineFingerprint = pipelineFingerprint;
+    pipelineModCount = modificationCount;
+  }
+
+  /// Returns true if the function pass pipeline identified by
+  /// `pipelineFingerprint` already ran on the body in its current state
+  /// without modifying it, i.e. re-running it cannot change anything.
+  bool hasPipelineConverged(uint64_t pipelineFingerprint) {
+    return this->pipelineFingerprint == pipelineFingerprint &&
+           pipelineModCount == modificationCount;
+  }
 
   //===--------------------------------------------------------------------===//
   // Operation Walkers
@@ -121,6 +253,22 @@ public:
     });
   }
 
+  /// Walk only the operations with the given name, in the same postorder as
+  /// walk(). This is backed by a per-function operation kind index that is
+  /// built lazily on the first filtered walk and invalidated when the body is
+  /// modified, so repeated filtered walks do not re-traverse unrelated
+  /// operations. The callback may erase the operation it is visiting, but
+  /// must not erase other operations in this function.
+  void walk(OperationName name,
+            const std::function<void(Operation *)> &callback);
+
+  /// Specialization of the filtered walk that visits each operation of the
+  /// registered op class 'OpTy'.
+  template <typename OpTy> void walkOps(std::function<void(OpTy)> callback) {
+    walk(OperationName(OpTy::getOperationName(), getContext()),
+         [&](Operation *opInst) { callback(cast<OpTy>(opInst)); });
+  }
+
   //===--------------------------------------------------------------------===//
   // Arguments
   //===--------------------------------------------------------------------===//
@@ -254,6 +402,21 @@ public:
   void print(raw_ostream &os);
   void dump();
 
+  /// Returns the cached printer numbering if it is still valid for the current
+  /// state of the body, or nullptr if it must be recomputed.
+  detail::FunctionPrintNumbering *getValidPrintNumbering() {
+    return printNumberingCount == modificationCount ? printNumbering.get()
+                                                    : nullptr;
+  }
+
+  /// Installs a printer numbering computed for the current state of the body,
+  /// replacing any stale cache.
+  void setPrintNumbering(
+      std::unique_ptr<detail::FunctionPrintNumbering> numbering) {
+    printNumbering = std::move(numbering);
+    printNumberingCount = modificationCount;
+  }
+
   /// Emit an error about fatal conditions with this function, reporting up to
   /// any diagnostic handlers that may be listening.
   InFlightDiagnostic emitError();
@@ -314,6 +477,57 @@ private:
   /// The body of the function.
   Region body;
 
+  /// If non-null, a callback that materializes the body of this function on
+  /// first access.
+  std::function<void(Function *)> lazyBodySource;
+
+  /// A counter bumped on every known mutation of the function body, and the
+  /// value the counter had when the body last passed verification. The
+  /// verifier skips re-walking the body when the two match. The counter is
+  /// atomic since utilities such as the parallel pattern rewrite driver mutate
+  /// disjoint parts of one function from several threads.
+  std::atomic<uint64_t> modificationCount{1};
+  uint64_t verifiedCount = 0;
+
+  /// The cached printer numbering for the body, and the modification count at
+  /// which it was computed. The cache is ignored once the counts diverge.
+  std::unique_ptr<detail::FunctionPrintNumbering> printNumbering;
+  uint64_t printNumberingCount = 0;
+
+  /// The cached operation kind index for the body, and the modification count
+  /// at which it was built. The index is rebuilt once the counts diverge.
+  std::unique_ptr<detail::FunctionOpKindIndex> opKindIndex;
+  uint64_t opKindIndexCount = 0;
+
+  /// The cached operation count of the body, and the modification count at
+  /// which it was computed. The count is recomputed once the counts diverge.
+  uint64_t cachedOpCount = 0;
+  uint64_t cachedOpCountModCount = 0;
+
+  /// A contiguous postorder snapshot of the operations in the body, and the
+  /// modification count at which it was built. The snapshot is rebuilt once
+  /// the counts diverge. See getWalkSnapshot().
+  std::vector<Operation *> walkSnapshot;
+  uint64_t walkSnapshotModCount = 0;
+
+  /// The cached structural fingerprint of the function, and the modification
+  /// count at which it was computed. The fingerprint is recomputed once the
+  /// counts diverge. See getFingerprint().
+  uint64_t cachedFingerprint = 0;
+  uint64_t fingerprintModCount = 0;
+
+  /// The fingerprint of the last pattern set whose greedy rewrite converged on
+  /// the body, and the modification count at which it converged. A fingerprint
+  /// of zero means no rewrite has converged yet.
+  uint64_t greedyRewriteFingerprint = 0;
+  uint64_t greedyRewriteModCount = 0;
+
+  /// The fingerprint of the last function pass pipeline that ran to
+  /// completion on the body without modifying it, and the modification count
+  /// at which it ran. A fingerprint of zero means no such pipeline has run.
+  uint64_t pipelineFingerprint = 0;
+  uint64_t pipelineModCount = 0;
+
   void operator=(Function &) = delete;
   friend struct llvm::ilist_traits<Function>;
 
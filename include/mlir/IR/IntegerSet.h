@@ -86,6 +86,11 @@ public:
 
   AffineExpr getConstraint(unsigned idx) const;
 
+  /// Returns the hash of this set's uniquing key, precomputed at creation
+  /// time. This is an implementation detail of the context's uniquing table;
+  /// use hash_value to hash sets by identity.
+  unsigned getUniquingHash() const;
+
   /// Returns the equality bits, which specify whether each of the constraints
   /// is an equality or inequality.
   ArrayRef<bool> getEqFlags() const;
@@ -19,16 +19,20 @@
 #define MLIR_IR_MLIRCONTEXT_H
 
 #include "mlir/Support/LLVM.h"
+#include <cstdint>
 #include <functional>
 #include <memory>
 #include <vector>
 
 namespace mlir {
 class AbstractOperation;
+class AffineExpr;
+class Attribute;
 class DiagnosticEngine;
 class Dialect;
 class InFlightDiagnostic;
 class Location;
+class LocationAttr;
 class MLIRContextImpl;
 class StorageUniquer;
 
@@ -73,6 +77,31 @@ public:
   /// Returns the storage uniquer used for creating affine constructs.
   StorageUniquer &getAffineUniquer();
 
+  /// Returns the memoized result of simplifying 'expr' with the given
+  /// dimension and symbol counts, or a null expression if no result has been
+  /// cached yet. See simplifyAffineExpr.
+  AffineExpr lookupSimplifiedAffineExpr(AffineExpr expr, unsigned numDims,
+                                        unsigned numSymbols);
+
+  /// Memoizes 'simplified' as the result of simplifying 'expr' with the given
+  /// dimension and symbol counts.
+  void cacheSimplifiedAffineExpr(AffineExpr expr, unsigned numDims,
+                                 unsigned numSymbols, AffineExpr simplified);
+
+  /// Fills 'row' with the memoized flattened coefficient row of 'expr' for
+  /// the given dimension and symbol counts and returns true, or returns false
+  /// if no row has been cached. Only expressions that flatten without
+  /// introducing local identifiers are cached, so a memoized row always has
+  /// the layout [dims, symbols, constant].
+  bool lookupFlattenedAffineExpr(AffineExpr expr, unsigned numDims,
+                                 unsigned numSymbols,
+                                 SmallVectorImpl<int64_t> &row);
+
+  /// Memoizes 'row' as the local-free flattened form of 'expr' with the given
+  /// dimension and symbol counts.
+  void cacheFlattenedAffineExpr(AffineExpr expr, unsigned numDims,
+                                unsigned numSymbols, ArrayRef<int64_t> row);
+
   /// Returns the storage uniquer used for constructing type storage instances.
   /// This should not be used directly.
   StorageUniquer &getTypeUniquer();
@@ -81,6 +110,44 @@ public:
   /// instances. This should not be used directly.
   StorageUniquer &getAttributeUniquer();
 
+  /// Returns the memoized result of fusing the raw location list 'locs' with
+  /// 'metadata', or a null attribute if no result has been cached yet. See
+  /// FusedLoc::get.
+  LocationAttr lookupFusedLocation(ArrayRef<Location> locs,
+                                   Attribute metadata);
+
+  /// Memoizes 'fused' as the result of fusing 'locs' with 'metadata'.
+  void cacheFusedLocation(ArrayRef<Location> locs, Attribute metadata,
+                          Location fused);
+
+  /// When set, newly constructed call site, file/line/column, name, and fused
+  /// locations collapse to UnknownLoc, making location construction near-free
+  /// for clients that do not need debug fidelity. This is expected to be
+  /// toggled before the context is shared across threads.
+  void setDiscardLocations(bool discard);
+  bool shouldDiscardLocations();
+
+  /// Returns an identifier for this context that is unique within the process
+  /// lifetime. Caches that key on uniqued IR objects and outlive a context can
+  /// include this value in their keys so that entries from a destroyed context
+  /// never alias the objects of a later context allocated at the same
+  /// addresses.
+  uint64_t getContextID();
+
+  /// Prints statistics about the memory held by this context to 'os':
+  /// instance counts and allocator byte totals for the uniqued types,
+  /// attributes, affine structures, and identifiers, attributed to the
+  /// dialect symbol range that defines each kind, plus per-dialect operation
+  /// memory when -mlir-track-op-memory is set. This is intended for tracking
+  /// down context memory consumption; the output format is not stable.
+  void printStorageStatistics(raw_ostream &os);
+
+  /// Adjusts the number of operation bytes attributed to the dialect with the
+  /// given namespace; negative values record freed operations. This is called
+  /// by Operation::create and Operation::destroy and should not be used
+  /// directly.
+  void recordOperationMemory(StringRef dialectNamespace, int64_t bytes);
+
 private:
   const std::unique_ptr<MLIRContextImpl> impl;
 
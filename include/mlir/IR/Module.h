@@ -66,6 +66,13 @@ public:
   /// and returns failure.
   LogicalResult verify();
 
+  /// Returns a structural fingerprint of the module, combining the
+  /// fingerprints of all functions in order. Function fingerprints are
+  /// computed in parallel when multi-threading is enabled, and are cached on
+  /// each function until its body changes. See Function::getFingerprint() for
+  /// what the hash covers.
+  uint64_t getFingerprint();
+
   void print(raw_ostream &os);
   void dump();
 
@@ -83,6 +83,10 @@ public:
   /// Return an attribute with the specified name.
   Attribute getAttr(StringRef name) { return state->getAttr(name); }
 
+  /// Return the specified attribute if present, null otherwise. Looking up an
+  /// interned identifier compares uniqued pointers rather than strings.
+  Attribute getAttr(Identifier name) { return state->getAttr(name); }
+
   /// If the operation has an attribute of the specified type, return it.
   template <typename AttrClass> AttrClass getAttrOfType(StringRef name) {
     return getAttr(name).dyn_cast_or_null<AttrClass>();
@@ -757,6 +761,11 @@ public:
   /// the subclass of Base.
   ///
   static bool classof(Operation *op) {
+    // Registered operations record the identity of their implementing op
+    // class, so the match reduces to a pointer comparison; only unregistered
+    // operations fall back to comparing the name string.
+    if (auto *abstractOp = op->getAbstractOperation())
+      return abstractOp->classID == ClassID::getID<ConcreteType>();
     return op->getName().getStringRef() == ConcreteType::getOperationName();
   }
 
@@ -70,6 +70,14 @@ public:
   /// Create a new Operation from the fields stored in `state`.
   static Operation *create(const OperationState &state);
 
+  /// The largest result, successor and region counts an operation can hold;
+  /// the counts are stored in packed bitfields. Producers of operations with
+  /// counts outside the compiler's control (e.g. the parser) must reject
+  /// anything larger; Operation::create only asserts that the counts fit.
+  static constexpr unsigned kMaxResults = (1u << 16) - 1;
+  static constexpr unsigned kMaxSuccessors = (1u << 8) - 1;
+  static constexpr unsigned kMaxRegions = (1u << 8) - 1;
+
   /// The name of an operation is the key identifier for it.
   OperationName getName() { return name; }
 
@@ -130,6 +138,12 @@ public:
   /// Returns nullptr if the operation is unlinked.
   Function *getFunction();
 
+  /// Record on the enclosing function, if any, that its body was mutated
+  /// through this operation, invalidating cached verification results and
+  /// analyses keyed on the body modification count. Called automatically by
+  /// the operand and attribute mutation paths.
+  void markFunctionModified();
+
   /// Replace any uses of 'from' with 'to' within this operation.
   void replaceUsesOfWith(Value *from, Value *to);
 
@@ -263,7 +277,10 @@ public:
   /// Set the attribute list on this operation.
   /// Using a NamedAttributeList is more efficient as it does not require new
   /// uniquing in the MLIRContext.
-  void setAttrList(NamedAttributeList newAttrs) { attrs = newAttrs; }
+  void setAttrList(NamedAttributeList newAttrs) {
+    attrs = newAttrs;
+    markFunctionModified();
+  }
 
   /// Return the specified attribute if present, null otherwise.
   Attribute getAttr(Identifier name) { return attrs.get(name); }
@@ -279,7 +296,10 @@ public:
 
   /// If the an attribute exists with the specified name, change it to the new
   /// value.  Otherwise, add a new attribute with the specified name/value.
-  void setAttr(Identifier name, Attribute value) { attrs.set(name, value); }
+  void setAttr(Identifier name, Attribute value) {
+    attrs.set(name, value);
+    markFunctionModified();
+  }
   void setAttr(StringRef name, Attribute value) {
     setAttr(Identifier::get(name, getContext()), value);
   }
@@ -287,7 +307,10 @@ public:
   /// Remove the attribute with the specified name if it exists.  The return
   /// value indicates whether the attribute was present or not.
   NamedAttributeList::RemoveResult removeAttr(Identifier name) {
-    return attrs.remove(name);
+    auto result = attrs.remove(name);
+    if (result == NamedAttributeList::RemoveResult::Removed)
+      markFunctionModified();
+    return result;
   }
 
   //===--------------------------------------------------------------------===//
@@ -352,10 +375,28 @@ public:
     --getTrailingObjects<unsigned>()[succIndex];
   }
 
+  /// Erase 'count' operands starting at 'opIndex' from the operand list of
+  /// the successor at 'succIndex' in a single batch.
+  void eraseSuccessorOperands(unsigned succIndex, unsigned opIndex,
+                              unsigned count) {
+    assert(succIndex < getNumSuccessors());
+    assert(opIndex + count <= getNumSuccessorOperands(succIndex));
+    getOperandStorage().eraseOperands(
+        getSuccessorOperandIndex(succIndex) + opIndex, count);
+    getTrailingObjects<unsigned>()[succIndex] -= count;
+  }
+
   /// Get the index of the first operand of the successor at the provided
-  /// index.
+  /// index. Note that this walks the successor operand count table; when
+  /// visiting every successor of an operand-heavy terminator, prefer
+  /// 'getSuccessorOperandIndices' which computes all of the offsets in one
+  /// pass.
   unsigned getSuccessorOperandIndex(unsigned index);
 
+  /// Fill 'offsets' with the index of the first operand of each successor,
+  /// computed in a single pass over the successor operand count table.
+  void getSuccessorOperandIndices(SmallVectorImpl<unsigned> &offsets);
+
   //===--------------------------------------------------------------------===//
   // Accessors for various properties of operations
   //===--------------------------------------------------------------------===//
@@ -479,11 +520,36 @@ private:
   /// or derived from.
   Location location;
 
+  /// Returns true if the order index of this operation is valid within its
+  /// parent block.
+  bool hasValidOrder() { return orderIndex != kInvalidOrderIdx; }
+
+  /// Update the order index of this operation within its parent block, trying
+  /// to fit it between the indices of its neighbors. Falls back to recomputing
+  /// the order of the whole block if no gap is available.
+  void updateOrderIfNecessary();
+
+  /// A sentinel order index for operations that have been inserted into a
+  /// block but not yet assigned a position in its ordering.
+  static constexpr unsigned kInvalidOrderIdx = -1u;
+
+  /// The stride left between order indices when the block ordering is
+  /// recomputed, leaving gaps that newly inserted operations can claim without
+  /// invalidating the order of the whole block.
+  static constexpr unsigned kOrderStride = 5;
+
   /// Relative order of this operation in its parent block. Used for
   /// O(1) local dominance checks between operations.
   mutable unsigned orderIndex = 0;
 
-  const unsigned numResults, numSuccs, numRegions;
+  /// The result, successor and region counts, packed into one word: virtually
+  /// all operations have at most a handful of each, and at millions of live
+  /// operations every saved word is megabytes of traversal working set.
+  /// The kMaxResults/kMaxSuccessors/kMaxRegions constants above give the
+  /// largest counts the packed fields can represent.
+  const unsigned numResults : 16;
+  const unsigned numSuccs : 8;
+  const unsigned numRegions : 8;
 
   /// This holds the name of the operation.
   OperationName name;
@@ -29,6 +29,7 @@
 #include "mlir/IR/Types.h"
 #include "mlir/IR/Value.h"
 #include "mlir/Support/LogicalResult.h"
+#include "mlir/Support/STLExtras.h"
 #include "llvm/ADT/PointerUnion.h"
 #include "llvm/Support/TrailingObjects.h"
 #include <memory>
@@ -96,6 +97,11 @@ public:
   /// This is the dialect that this operation belongs to.
   Dialect &dialect;
 
+  /// The unique identifier of the C++ op class implementing this operation.
+  /// isa/dyn_cast queries on registered operations compare this identity
+  /// instead of the operation name string.
+  const ClassID *const classID;
+
   /// Return true if this "op class" can match against the specified operation.
   bool (&classof)(Operation *op);
 
@@ -151,15 +157,15 @@ public:
   /// operations they contain.
   template <typename T> static AbstractOperation get(Dialect &dialect) {
     return AbstractOperation(
-        T::getOperationName(), dialect, T::getOperationProperties(), T::classof,
-        T::parseAssembly, T::printAssembly, T::verifyInvariants, T::foldHook,
-        T::getCanonicalizationPatterns);
+        T::getOperationName(), dialect, T::getOperationProperties(),
+        ClassID::getID<T>(), T::classof, T::parseAssembly, T::printAssembly,
+        T::verifyInvariants, T::foldHook, T::getCanonicalizationPatterns);
   }
 
 private:
   AbstractOperation(
       StringRef name, Dialect &dialect, OperationProperties opProperties,
-      bool (&classof)(Operation *op),
+      const ClassID *classID, bool (&classof)(Operation *op),
       ParseResult (&parseAssembly)(OpAsmParser *parser, OperationState *result),
       void (&printAssembly)(Operation *op, OpAsmPrinter *p),
       LogicalResult (&verifyInvariants)(Operation *op),
@@ -167,7 +173,7 @@ private:
                                 SmallVectorImpl<OpFoldResult> &results),
       void (&getCanonicalizationPatterns)(OwningRewritePatternList &results,
                                           MLIRContext *context))
-      : name(name), dialect(dialect), classof(classof),
+      : name(name), dialect(dialect), classID(classID), classof(classof),
         parseAssembly(parseAssembly), printAssembly(printAssembly),
         verifyInvariants(verifyInvariants), foldHook(foldHook),
         getCanonicalizationPatterns(getCanonicalizationPatterns),
@@ -352,10 +358,12 @@ class OperandStorage final
 public:
   OperandStorage(unsigned numOperands, bool resizable)
       : numOperands(numOperands), resizable(resizable) {
-    // Initialize the resizable storage.
+    // Initialize the resizable storage, including any extra inline capacity
+    // allocated beyond the initial operand count.
     if (resizable) {
-      new (&getResizableStorage())
-          ResizableStorage(getTrailingObjects<OpOperand>(), numOperands);
+      new (&getResizableStorage()) ResizableStorage(
+          getTrailingObjects<OpOperand>(),
+          computeAllocCapacity(numOperands, resizable));
     }
   }
 
@@ -376,6 +384,10 @@ public:
   /// Erase an operand held by the storage.
   void eraseOperand(unsigned index);
 
+  /// Erase 'count' contiguous operands starting at 'index', shifting the
+  /// remaining operands down once.
+  void eraseOperands(unsigned index, unsigned count);
+
   /// Get the operation operands held by the storage.
   MutableArrayRef<OpOperand> getOperands() {
     return {getRawOperands(), size()};
@@ -386,8 +398,16 @@ public:
 
   /// Returns the additional size necessary for allocating this object.
   static size_t additionalAllocSize(unsigned numOperands, bool resizable) {
-    return additionalSizeToAlloc<ResizableStorage, OpOperand>(resizable ? 1 : 0,
-                                                              numOperands);
+    return additionalSizeToAlloc<ResizableStorage, OpOperand>(
+        resizable ? 1 : 0, computeAllocCapacity(numOperands, resizable));
+  }
+
+  /// Returns the inline operand capacity to allocate for the given operand
+  /// count. Resizable operand lists are rounded up to a small multiple so
+  /// that patterns growing an operand list by a few elements do not
+  /// immediately force a dynamic reallocation.
+  static unsigned computeAllocCapacity(unsigned numOperands, bool resizable) {
+    return resizable ? (numOperands + 3) & ~3u : numOperands;
   }
 
   /// Returns if this storage is resizable.
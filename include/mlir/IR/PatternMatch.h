@@ -268,18 +268,6 @@ template <typename SourceOp> struct OpRewritePattern : public RewritePattern {
 ///
 class PatternRewriter : public OpBuilder {
 public:
-  /// Create operation of specific op type at the current insertion point
-  /// without verifying to see if it is valid.
-  template <typename OpTy, typename... Args>
-  OpTy create(Location location, Args... args) {
-    OperationState state(location, OpTy::getOperationName());
-    OpTy::build(this, &state, args...);
-    auto *op = createOperation(state);
-    auto result = dyn_cast<OpTy>(op);
-    assert(result && "Builder didn't return the right type");
-    return result;
-  }
-
   /// Creates an operation of specific op type at the current insertion point.
   /// If the result is an invalid op (the verifier hook fails), emit an error
   /// and return null.
@@ -344,6 +332,15 @@ public:
     return block->splitBlock(before);
   }
 
+  /// Create a new block and set the insertion point to the end of it. This
+  /// shadows the builder method so that rewriters tracking IR mutations are
+  /// notified of the new block.
+  Block *createBlock(Block *insertBefore = nullptr) {
+    Block *block = OpBuilder::createBlock(insertBefore);
+    notifyBlockCreated(block);
+    return block;
+  }
+
   /// This method is used as the final notification hook for patterns that end
   /// up modifying the pattern root in place, by changing its operands.  This is
   /// a minor efficiency win (it avoids creating a new operation and removing
@@ -362,14 +359,20 @@ protected:
   // These are the callback methods that subclasses can choose to implement if
   // they would like to be notified about certain types of mutations.
 
-  /// This is implemented to create the specified operations and serves as a
+  /// This is implemented to insert the specified operations and serves as a
   /// notification hook for rewriters that want to know about new operations.
-  virtual Operation *createOperation(const OperationState &state) = 0;
+  /// Every builder creation path, including the direct-construction fast path
+  /// for fixed-arity ops, funnels through this hook.
+  Operation *insert(Operation *op) override = 0;
 
   /// Notify the pattern rewriter that the specified operation has been mutated
   /// in place.  This is called after the mutation is done.
   virtual void notifyRootUpdated(Operation *op) {}
 
+  /// Notify the pattern rewriter that the specified block was created via
+  /// createBlock.
+  virtual void notifyBlockCreated(Block *block) {}
+
   /// Notify the pattern rewriter that the specified operation is about to be
   /// replaced with another set of operations.  This is called before the uses
   /// of the operation have been changed.
@@ -407,6 +410,21 @@ public:
   /// true if any pattern matches.
   bool matchAndRewrite(Operation *op, PatternRewriter &rewriter);
 
+  /// Returns a non-zero fingerprint identifying this set of patterns. Two
+  /// matchers built from the same pattern list produce the same value, so
+  /// drivers can recognize repeated invocations of the same rewrite.
+  uint64_t getFingerprint() const { return fingerprint; }
+
+  /// Returns the highest benefit among the patterns rooted at the given
+  /// operation kind, or zero when no pattern can match that kind. Drivers can
+  /// use this to prioritize operations whose rewrites are the most valuable.
+  unsigned short getMaxBenefit(OperationName op) const {
+    auto it = patternsByRootKind.find(op);
+    return it == patternsByRootKind.end()
+               ? 0
+               : it->second.front()->getBenefit().getBenefit();
+  }
+
 private:
   RewritePatternMatcher(const RewritePatternMatcher &) = delete;
   void operator=(const RewritePatternMatcher &) = delete;
@@ -414,6 +432,15 @@ private:
   /// The group of patterns that are matched for optimization through this
   /// matcher.
   OwningRewritePatternList patterns;
+
+  /// An index from the root operation kind of a pattern to the patterns with
+  /// that root, sorted by decreasing benefit. This avoids scanning the entire
+  /// pattern list for every operation during matching.
+  llvm::DenseMap<OperationName, llvm::SmallVector<RewritePattern *, 2>>
+      patternsByRootKind;
+
+  /// The fingerprint of the pattern set. See getFingerprint().
+  uint64_t fingerprint;
 };
 
 /// Rewrite the specified function by repeatedly applying the highest benefit
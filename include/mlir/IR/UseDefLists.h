@@ -98,11 +98,16 @@ public:
 
   /// Set the current value being used by this operand.
   void set(IRObjectWithUseList *newValue) {
-    // It isn't worth optimizing for the case of switching operands on a single
-    // value.
+    // Rewrite-driven code frequently re-sets an operand to the value it
+    // already uses; leave the use list untouched in that case.
+    if (value == newValue)
+      return;
     removeFromCurrent();
     value = newValue;
     insertIntoCurrent();
+    // Operand updates can change dominance relationships; invalidate any
+    // cached verification result of the owner's function.
+    notifyOwnerBodyModified();
   }
 
   /// Return the owner of this operand.
@@ -142,6 +147,13 @@ public:
   }
 
 private:
+  /// Allow IRObjectWithUseList to splice entire use chains.
+  friend IRObjectWithUseList;
+
+  /// Record on the function containing the owner, if any, that its body was
+  /// mutated. Out of line since Operation is incomplete here.
+  void notifyOwnerBodyModified();
+
   /// The value used as this operand.  This can be null when in a
   /// "dropAllUses" state.
   IRObjectWithUseList *value = nullptr;
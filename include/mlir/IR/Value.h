@@ -67,9 +67,14 @@ public:
   /// Replace all uses of 'this' value with the new value, updating anything in
   /// the IR that uses 'this' to use the other value instead.  When this returns
   /// there are zero uses of 'this'.
-  void replaceAllUsesWith(Value *newValue) {
-    IRObjectWithUseList::replaceAllUsesWith(newValue);
-  }
+  void replaceAllUsesWith(Value *newValue);
+
+  /// Replace all uses of each value in 'replacements' with its paired
+  /// replacement value, processing the pairs in order. This is semantically
+  /// equivalent to calling replaceAllUsesWith on each pair, but amortizes the
+  /// per-value bookkeeping, e.g. cache invalidation of the containing
+  /// function, over the whole batch.
+  static void replaceAllUses(ArrayRef<std::pair<Value *, Value *>> replacements);
 
   /// Return the function that this Value is defined in.
   Function *getFunction();
@@ -37,6 +37,10 @@ public:
   /// Returns true if v1 and v2 alias.
   bool alias(Value *v1, Value *v2) { return find(v1) == find(v2); }
 
+  /// Returns the base buffer or block argument into which the view `v`
+  /// aliases. Views with different bases never alias.
+  Value *getBase(Value *v) { return find(v); }
+
 private:
   /// Returns the base buffer or block argument into which the view `v` aliases.
   /// This lazily records the new aliases discovered while walking back the
@@ -130,6 +134,15 @@ private:
   Aliases &aliases;
   SmallVector<Operation *, 8> linalgOps;
   DenseMap<Operation *, unsigned> linalgOpPositions;
+
+  /// Memoized results of findOperationsWithCoveringDependences, keyed by the
+  /// (src, dst) pair, the restricting view and the queried dependence type
+  /// mask. Fusion drivers re-query the same pairs while weighing candidates,
+  /// and the graph is never updated after construction so the results stay
+  /// valid.
+  using CoveringKey =
+      std::pair<std::pair<Operation *, Operation *>, std::pair<Value *, unsigned>>;
+  DenseMap<CoveringKey, SmallVector<Operation *, 8>> coveringDependences;
 };
 } // namespace linalg
 } // namespace mlir
@@ -86,11 +86,18 @@ struct TiledLinalgOp {
   SmallVector<ForOp, 8> loops;
 };
 
+/// Tiles `op` by the given `tileSizes`, a zero size meaning the corresponding
+/// loop is not tiled. If `promoteViews` is set, the tiled views are promoted
+/// into tile-local buffers, with copy-in/copy-out around the tile body; the
+/// buffers are allocated before the tile loop nest and reused across tile
+/// iterations.
 llvm::Optional<TiledLinalgOp>
-tileLinalgOp(LinalgOp op, ArrayRef<Value *> tileSizes, OperationFolder &state);
+tileLinalgOp(LinalgOp op, ArrayRef<Value *> tileSizes, OperationFolder &state,
+             bool promoteViews = false);
 
 llvm::Optional<TiledLinalgOp>
-tileLinalgOp(LinalgOp op, ArrayRef<int64_t> tileSizes, OperationFolder &state);
+tileLinalgOp(LinalgOp op, ArrayRef<int64_t> tileSizes, OperationFolder &state,
+             bool promoteViews = false);
 
 } // namespace linalg
 } // namespace mlir
@@ -147,6 +147,11 @@ public:
     return pass->getKind() == Kind::ModulePass;
   }
 
+  /// Returns true if this pass only inspects the module and never mutates it.
+  /// Read-only passes must also preserve all analyses, as the pass manager may
+  /// schedule adjacent read-only passes concurrently over the same module.
+  virtual bool isReadOnly() const { return false; }
+
 protected:
   explicit ModulePassBase(const PassID *id) : Pass(id, Kind::ModulePass) {}
 
@@ -93,10 +93,18 @@ public:
   ///   IR should be printed or not.
   /// * 'printModuleScope' signals if the module IR should be printed, even for
   ///   non module passes.
+  /// * 'printDiffOnly' signals that only the functions whose IR changed during
+  ///   pass execution should be printed after the pass.
+  /// * 'functionFilter', if non-empty, restricts printing to functions with
+  ///   the given names.
+  /// * 'opFilter', if non-empty, restricts printing to functions containing at
+  ///   least one operation with one of the given names.
   /// * 'out' corresponds to the stream to output the printed IR to.
   void enableIRPrinting(std::function<bool(Pass *)> shouldPrintBeforePass,
                         std::function<bool(Pass *)> shouldPrintAfterPass,
-                        bool printModuleScope, raw_ostream &out);
+                        bool printModuleScope, bool printDiffOnly,
+                        ArrayRef<std::string> functionFilter,
+                        ArrayRef<std::string> opFilter, raw_ostream &out);
 
   /// Add an instrumentation to time the execution of passes and the computation
   /// of analyses.
@@ -106,6 +114,19 @@ public:
   void enableTiming(
       PassTimingDisplayMode displayMode = PassTimingDisplayMode::Pipeline);
 
+  /// Add an instrumentation that writes a chrome://tracing compatible JSON
+  /// trace to `traceFilePath`, with one complete event per pass and analysis
+  /// execution. Events carry the id of the thread they ran on and the name of
+  /// the function being transformed, making per-function attribution and
+  /// thread utilization of the asynchronous executors visible.
+  void enableChromeTracing(StringRef traceFilePath);
+
+  /// Add an instrumentation that records how many operations each pass added
+  /// or removed from the IR it ran on, and prints a per-pass delta report when
+  /// the pass manager is destroyed. Op counts are cached per function and only
+  /// recomputed after mutations, so the measurement itself is cheap.
+  void enableIRSizeStats();
+
 private:
   /// A stack of nested pass executors on sub-module IR units, e.g. function.
   llvm::SmallVector<detail::PassExecutor *, 1> nestedExecutorStack;
@@ -25,10 +25,12 @@
 
 #include "mlir/Support/LLVM.h"
 #include "mlir/Support/STLExtras.h"
+#include "llvm/ADT/Optional.h"
 #include "llvm/ADT/StringRef.h"
 #include "llvm/Support/CommandLine.h"
 #include "llvm/Support/Compiler.h"
 #include <functional>
+#include <vector>
 
 namespace mlir {
 class Pass;
@@ -61,6 +63,9 @@ public:
   /// Returns a description for the pass, this never returns null.
   StringRef getPassDescription() const { return description; }
 
+  /// Returns the function that adds this entry's passes to a pipeline.
+  const PassRegistryFunction &getPipelineBuilder() const { return builder; }
+
 protected:
   PassRegistryEntry(StringRef arg, StringRef description,
                     PassRegistryFunction builder)
@@ -94,6 +99,41 @@ public:
            PassAllocatorFunction allocator);
 };
 
+/// A pipeline resolved against the pass registries once and instantiable into
+/// any number of pass managers. Compiling validates the entries up front and
+/// flattens them into their builder functions, so drivers that run the same
+/// pipeline over many buffers or processes pay only for the pass allocations
+/// themselves on each run, and those happen lazily when `populate` is called.
+/// The descriptor is a compact textual form (the comma-separated pass
+/// arguments) that can be cached externally and recompiled in another process
+/// with the same passes registered.
+class CompiledPassPipeline {
+public:
+  /// Compiles the pipeline formed by the given registry entries, in order.
+  explicit CompiledPassPipeline(ArrayRef<const PassRegistryEntry *> entries);
+
+  /// Recreates a compiled pipeline from a descriptor previously produced by
+  /// getDescriptor(). Returns None if the descriptor names a pass or pass
+  /// pipeline that is not registered in this process.
+  static llvm::Optional<CompiledPassPipeline> fromDescriptor(
+      StringRef descriptor);
+
+  /// Returns the compact textual descriptor of this pipeline.
+  std::string getDescriptor() const;
+
+  /// Instantiates the pipeline's passes into 'pm'.
+  void populate(PassManager &pm) const;
+
+private:
+  CompiledPassPipeline() = default;
+
+  /// The builder function of each entry, in pipeline order.
+  std::vector<PassRegistryFunction> builders;
+
+  /// The pass argument of each entry, in pipeline order.
+  std::vector<StringRef> args;
+};
+
 /// Register a specific dialect pipeline registry function with the system,
 /// typically used through the PassPipelineRegistration template.
 void registerPassPipeline(StringRef arg, StringRef description,
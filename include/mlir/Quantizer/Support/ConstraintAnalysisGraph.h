@@ -32,6 +32,7 @@
 #include "mlir/IR/Operation.h"
 #include "mlir/IR/Types.h"
 #include "mlir/Quantizer/Support/Metadata.h"
+#include "mlir/Support/LogicalResult.h"
 #include "llvm/ADT/DenseMap.h"
 
 namespace mlir {
@@ -342,6 +343,17 @@ public:
   /// required.
   unsigned propagate(const TargetConfiguration &config);
 
+  /// Propagates to fixpoint, running up to maxRounds rounds of propagation
+  /// per weakly-connected component of the slice. Constraints never cross
+  /// component boundaries, so each component is solved independently (and,
+  /// if enabled, concurrently). Components with no dirty node are skipped
+  /// entirely, making a re-solve after marking a subset of anchors dirty
+  /// (e.g. because only their statistics changed) proportional to the
+  /// affected components rather than the whole graph.
+  /// Returns failure if any component did not converge within maxRounds.
+  LogicalResult propagateToFixpoint(const TargetConfiguration &config,
+                                    unsigned maxRounds);
+
 private:
   /// Adds a node to the graph.
   /// The node should be a subclass of TransformNode.
@@ -354,6 +366,13 @@ private:
     return unownedNode;
   }
 
+  /// Runs propagation rounds over just the nodes of one weakly-connected
+  /// component until it is clean, returning whether it converged within
+  /// maxRounds.
+  bool propagateComponentToFixpoint(const node_vector &component,
+                                    const TargetConfiguration &config,
+                                    unsigned maxRounds);
+
   SolverContext &context;
   std::vector<CAGNode *> allNodes;
   llvm::DenseMap<std::pair<Operation *, unsigned>, CAGOperandAnchor *>
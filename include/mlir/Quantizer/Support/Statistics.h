@@ -23,6 +23,8 @@
 #ifndef MLIR_QUANTIZER_SUPPORT_STATISTICS_H
 #define MLIR_QUANTIZER_SUPPORT_STATISTICS_H
 
+#include <limits>
+
 #include "mlir/IR/Attributes.h"
 
 namespace mlir {
@@ -44,6 +46,45 @@ struct TensorAxisStatistics {
   void clear() { *this = TensorAxisStatistics(); }
 };
 
+/// Accumulates statistics over a stream of tensor values.
+/// Mean and variance are maintained with the online (Welford) update, so a
+/// whole calibration dataset never needs to be materialized, and accumulators
+/// computed over independent shards of the data (or on separate threads) can
+/// be merged losslessly.
+class TensorStatisticsAccumulator {
+public:
+  /// Accumulates a single value.
+  void observe(double value);
+
+  /// Accumulates a contiguous buffer of values.
+  void observe(ArrayRef<float> values);
+  void observe(ArrayRef<double> values);
+
+  /// Accumulates all values of an attribute of the kinds accepted by
+  /// AttributeTensorStatistics. Dense float attributes are read through the
+  /// bulk typed accessors where the element type permits. Returns false
+  /// (leaving the accumulator unchanged) for unsupported attributes.
+  bool observe(Attribute attr);
+
+  /// Merges the samples observed by another accumulator into this one.
+  void merge(const TensorStatisticsAccumulator &other);
+
+  /// Populates stats from the samples observed so far.
+  /// Returns true if any samples have been observed.
+  bool get(TensorAxisStatistics &stats) const;
+
+private:
+  /// Accumulates `count` repetitions of the same value (i.e. a splat).
+  void observeSplat(double value, int64_t count);
+
+  int64_t sampleSize = 0;
+  double minValue = std::numeric_limits<double>::infinity();
+  double maxValue = -std::numeric_limits<double>::infinity();
+  double mean = 0;
+  /// Sum of squared deviations from the current mean.
+  double m2 = 0;
+};
+
 /// Base class for querying statistics about a tensor.
 class AbstractTensorStatistics {
 public:
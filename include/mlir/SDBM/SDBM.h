@@ -25,6 +25,7 @@
 
 #include "mlir/Support/LLVM.h"
 #include "llvm/ADT/DenseMap.h"
+#include "llvm/ADT/SmallVector.h"
 
 namespace mlir {
 
@@ -115,6 +116,13 @@ public:
                           SmallVectorImpl<SDBMExpr> &inequalities,
                           SmallVectorImpl<SDBMExpr> &equalities);
 
+  /// Tighten all difference bounds to their canonical form by computing the
+  /// min-plus transitive closure of the matrix (Floyd-Warshall).  After the
+  /// closure, every entry holds the tightest bound implied by the whole
+  /// system, and a negative value on the diagonal indicates that the set is
+  /// empty.
+  void closure();
+
   void print(llvm::raw_ostream &os);
   void dump();
 
@@ -190,7 +198,10 @@ private:
   ///
   /// is trivially true.  Negated values at symmetric positions in the matrix
   /// allow one to couple two inequalities into a single equality.
-  std::vector<IntInfty> matrix;
+  ///
+  /// The inline capacity covers systems of up to eight variables including
+  /// the constant, so small matrices never heap-allocate.
+  SmallVector<IntInfty, 64> matrix;
 
   /// The mapping between the indices of variables in the DBM and the stripe
   /// expressions they are equal to.  These expressions are stored as they
@@ -30,12 +30,41 @@ public:
 
   static StringRef getDialectNamespace() { return "sdbm"; }
 
-  /// Get the uniquer for SDBM expressions. This should not be used directly.
-  StorageUniquer &getUniquer() { return uniquer; }
+  /// Get the uniquer for SDBM expressions, preferring the thread-local arena
+  /// installed by an active SDBMLocalUniquingScope over the shared
+  /// context-lifetime uniquer. This should not be used directly.
+  StorageUniquer &getUniquer();
 
 private:
   StorageUniquer uniquer;
 };
+
+/// An RAII object that redirects all SDBM expression uniquing performed on
+/// the current thread into a private arena for the duration of its lifetime.
+/// Analyses that build many short-lived SDBMs can install a scope to avoid
+/// contending on the shared uniquer of the dialect and to avoid accumulating
+/// per-query expressions in context-lifetime memory: the arena is bulk-freed
+/// when the scope is destroyed.
+///
+/// Expressions created within a scope are uniqued only against each other and
+/// must not outlive the scope or be mixed with expressions created outside of
+/// it, as pointer equality no longer holds across arenas. Scopes may nest;
+/// destruction restores the previously active arena of the thread.
+class SDBMLocalUniquingScope {
+public:
+  SDBMLocalUniquingScope();
+  ~SDBMLocalUniquingScope();
+
+  SDBMLocalUniquingScope(const SDBMLocalUniquingScope &) = delete;
+  SDBMLocalUniquingScope &operator=(const SDBMLocalUniquingScope &) = delete;
+
+private:
+  /// The arena backing the expressions created within this scope.
+  StorageUniquer arena;
+
+  /// The arena that was active on this thread when the scope was installed.
+  StorageUniquer *previousUniquer;
+};
 } // namespace mlir
 
 #endif // MLIR_SDBM_SDBMDIALECT_H
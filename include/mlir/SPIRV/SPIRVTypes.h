@@ -61,6 +61,12 @@ public:
   Type getElementType();
 
   int64_t getElementCount();
+
+  /// Returns the number of bytes this array occupies assuming tight scalar
+  /// packing, or -1 if the element type has no static size. The size is
+  /// computed once when the type is uniqued and cached on its storage, so
+  /// querying deeply nested arrays does not recompute inner layouts.
+  int64_t getSizeInBytes();
 };
 
 // SPIR-V pointer type
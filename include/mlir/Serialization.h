@@ -0,0 +1,70 @@
+//===- Serialization.h - MLIR Binary Module Format --------------*- C++ -*-===//
+//
+// Copyright 2019 The MLIR Authors.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+// =============================================================================
+//
+// This file contains the interface to the binary module container format,
+// which is used for caching intermediate pipeline stages. The container
+// stores each function of a module as an independent length-prefixed record
+// so that a reader can seek directly to (and materialize only) the functions
+// it needs, instead of re-lexing the whole module.
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef MLIR_SERIALIZATION_H
+#define MLIR_SERIALIZATION_H
+
+namespace llvm {
+class MemoryBuffer;
+class StringRef;
+class raw_ostream;
+} // end namespace llvm
+
+namespace mlir {
+class MLIRContext;
+class Module;
+
+/// Writes the given module to 'os' in the binary container format.
+void writeBinaryModule(Module *module, llvm::raw_ostream &os);
+
+/// Returns true if the given buffer starts with the magic number of the
+/// binary container format.
+bool isBinaryModuleBuffer(llvm::StringRef buffer);
+
+/// Parses a module from the binary container held in 'buffer'. On error, a
+/// diagnostic is emitted through the context and nullptr is returned. The
+/// buffer must outlive the returned module.
+Module *parseBinaryBuffer(llvm::StringRef buffer, MLIRContext *context);
+
+/// Parses a module from the binary container in the file named 'filename'.
+/// On error, a diagnostic is emitted through the context and nullptr is
+/// returned.
+Module *parseBinaryFile(llvm::StringRef filename, MLIRContext *context);
+
+/// Parses a module from the binary container held in 'buffer', materializing
+/// only the function signatures eagerly. Function bodies stay unparsed byte
+/// ranges within the buffer until they are first accessed, e.g. by a pass
+/// visiting the function. The buffer is shared with the unmaterialized
+/// functions and released once no longer referenced.
+Module *parseBinaryBufferLazily(std::unique_ptr<llvm::MemoryBuffer> buffer,
+                                MLIRContext *context);
+
+/// Lazily parses a module from the binary container in the file named
+/// 'filename'. See parseBinaryBufferLazily for the materialization contract.
+Module *parseBinaryFileLazily(llvm::StringRef filename, MLIRContext *context);
+
+} // end namespace mlir
+
+#endif // MLIR_SERIALIZATION_H
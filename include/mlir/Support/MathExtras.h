@@ -24,6 +24,7 @@
 
 #include "mlir/Support/LLVM.h"
 #include "llvm/ADT/APInt.h"
+#include "llvm/Support/MathExtras.h"
 
 namespace mlir {
 
@@ -31,6 +32,11 @@ namespace mlir {
 /// expected to be positive.
 inline int64_t ceilDiv(int64_t lhs, int64_t rhs) {
   assert(rhs >= 1);
+  // Divisors in affine expressions are overwhelmingly powers of two (tile
+  // sizes, vector widths), where the ceildiv reduces to a shift rounded up by
+  // the masked remainder.
+  if (llvm::isPowerOf2_64(rhs))
+    return (lhs >> llvm::Log2_64(rhs)) + ((lhs & (rhs - 1)) != 0);
   // C/C++'s integer division rounds towards 0.
   return lhs % rhs > 0 ? lhs / rhs + 1 : lhs / rhs;
 }
@@ -39,6 +45,10 @@ inline int64_t ceilDiv(int64_t lhs, int64_t rhs) {
 /// expected to be positive.
 inline int64_t floorDiv(int64_t lhs, int64_t rhs) {
   assert(rhs >= 1);
+  // An arithmetic right shift rounds towards negative infinity, which is
+  // exactly floordiv, so power-of-two divisors reduce to a shift.
+  if (llvm::isPowerOf2_64(rhs))
+    return lhs >> llvm::Log2_64(rhs);
   // C/C++'s integer division rounds towards 0.
   return lhs % rhs < 0 ? lhs / rhs - 1 : lhs / rhs;
 }
@@ -49,6 +59,10 @@ inline int64_t floorDiv(int64_t lhs, int64_t rhs) {
 /// is always non-negative.
 inline int64_t mod(int64_t lhs, int64_t rhs) {
   assert(rhs >= 1);
+  // In two's complement the masked low bits are the non-negative Euclidean
+  // remainder for power-of-two divisors, for negative values as well.
+  if (llvm::isPowerOf2_64(rhs))
+    return lhs & (rhs - 1);
   return lhs % rhs < 0 ? lhs % rhs + rhs : lhs % rhs;
 }
 
@@ -121,6 +121,9 @@ public:
       return allocator.Allocate(size, alignment);
     }
 
+    /// Returns the total number of bytes held by this allocator.
+    size_t getAllocatedBytes() const { return allocator.getBytesAllocated(); }
+
   private:
     /// The raw allocator for type storage objects.
     llvm::BumpPtrAllocator allocator;
@@ -174,6 +177,14 @@ public:
     return static_cast<Storage *>(getImpl(kind, ctorFn));
   }
 
+  /// Accumulates uniquing statistics into the provided outputs: the number of
+  /// uniqued storage instances and allocator bytes held for each storage
+  /// kind, and the total number of bytes held by the storage allocators.
+  /// Counts are added to any existing entries of the maps.
+  void getStatistics(llvm::DenseMap<unsigned, unsigned> &numInstancesByKind,
+                     llvm::DenseMap<unsigned, size_t> &bytesByKind,
+                     size_t &allocatedBytes);
+
   /// Erases a uniqued instance of 'Storage'. This function is used for derived
   /// types that have complex storage or uniquing constraints.
   template <typename Storage, typename Arg, typename... Args>
@@ -32,6 +32,8 @@
 #include "llvm/IR/IRBuilder.h"
 #include "llvm/IR/Value.h"
 
+#include <vector>
+
 namespace mlir {
 class Attribute;
 class Location;
@@ -76,6 +78,11 @@ private:
   void connectPHINodes(Function &func);
   bool convertBlock(Block &bb, bool ignoreArguments);
 
+  /// Number every value defined within 'func' - its arguments, then the
+  /// results of its operations in block order - and size the flat translated
+  /// value table accordingly.
+  void numberValuesInFunction(Function &func);
+
   template <typename Range>
   SmallVector<llvm::Value *, 8> lookupValues(Range &&values);
 
@@ -87,9 +94,31 @@ private:
   std::unique_ptr<llvm::Module> llvmModule;
 
 protected:
-  // Mappings between original and translated values, used for lookups.
+  /// Returns the slot of the translated value table that corresponds to the
+  /// given function-local value, to be assigned when translating its defining
+  /// operation.
+  llvm::Value *&mapValue(Value *v) {
+    auto it = valueNumbering.find(v);
+    assert(it != valueNumbering.end() && "mapped value was not numbered");
+    return valueTable[it->second];
+  }
+
+  /// Looks up the translated value for the given function-local value.
+  llvm::Value *lookupValue(Value *v) const {
+    auto it = valueNumbering.find(v);
+    assert(it != valueNumbering.end() && "referenced value was not numbered");
+    return valueTable[it->second];
+  }
+
+  // Mappings between original and translated values, used for lookups. Values
+  // are function-local: they are numbered densely up front by
+  // numberValuesInFunction and the translated values live in a flat vector
+  // indexed by that numbering, so body emission fills and reads a fixed-size
+  // table rather than growing a hash map per instruction. Only functions,
+  // which can be referenced across function boundaries, stay in a map.
   llvm::StringMap<llvm::Function *> functionMapping;
-  llvm::DenseMap<Value *, llvm::Value *> valueMapping;
+  llvm::DenseMap<Value *, unsigned> valueNumbering;
+  std::vector<llvm::Value *> valueTable;
   llvm::DenseMap<Block *, llvm::BasicBlock *> blockMapping;
 };
 
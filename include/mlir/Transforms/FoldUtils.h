@@ -25,6 +25,7 @@
 
 #include "mlir/IR/Builders.h"
 #include "mlir/IR/Dialect.h"
+#include "llvm/Support/Mutex.h"
 
 namespace mlir {
 class Function;
@@ -35,6 +36,17 @@ class Value;
 /// generated along the way.
 class OperationFolder {
 public:
+  /// Creates an operation folder. When `constructionMode` is set, the folder
+  /// assumes it only ever folds freshly built IR that is emitted in
+  /// topological order: constants are materialized immediately before the
+  /// operation being folded and uniqued per block, instead of being hoisted
+  /// into the entry block of the enclosing isolated region. This skips the
+  /// parent walk that finds the insertion region as well as the entry-block
+  /// prepends, which invalidate the block's operation order and force later
+  /// dominance queries to recompute it.
+  explicit OperationFolder(bool constructionMode = false)
+      : constructionMode(constructionMode) {}
+
   /// Tries to perform folding on the given `op`, including unifying
   /// deduplicated constants. If successful, replaces `op`'s uses with
   /// folded results, and returns success. `preReplaceAction` is invoked on `op`
@@ -53,6 +65,14 @@ public:
   /// externally to this OperationFolder. `op` must be a constant op.
   void notifyRemoval(Operation *op);
 
+  /// Sets a lock that is held while constants are materialized into the
+  /// insertion region's entry block. This must be set when several folders
+  /// concurrently rewrite disjoint parts of one function, since the entry
+  /// block is shared between them.
+  void setInsertionLock(llvm::sys::SmartMutex<true> *lock) {
+    insertionLock = lock;
+  }
+
   /// Create an operation of specific op type with the given builder,
   /// and immediately try to fold it. This function populates 'results' with
   /// the results after folding the operation.
@@ -111,12 +131,24 @@ private:
                                     Attribute value, Type type, Location loc);
 
   /// A mapping between an insertion region and the constants that have been
-  /// created within it.
+  /// created within it. Unused in construction mode.
   DenseMap<Region *, ConstantMap> foldScopes;
 
+  /// A mapping between a block and the constants that have been created
+  /// within it. Only used in construction mode, where a constant is known to
+  /// dominate everything emitted after it in its block but nothing else.
+  DenseMap<Block *, ConstantMap> constructionScopes;
+
   /// This map tracks all of the dialects that an operation is referenced by;
   /// given that many dialects may generate the same constant.
   DenseMap<Operation *, SmallVector<Dialect *, 2>> referencedDialects;
+
+  /// An optional lock guarding constant insertion into shared entry blocks.
+  llvm::sys::SmartMutex<true> *insertionLock = nullptr;
+
+  /// Whether this folder only ever folds freshly built, topologically
+  /// ordered IR, see the constructor.
+  bool constructionMode;
 };
 
 } // end namespace mlir
@@ -90,11 +90,24 @@ LLVM_NODISCARD
 LogicalResult instBodySkew(AffineForOp forOp, ArrayRef<uint64_t> shifts,
                            bool unrollPrologueEpilogue = false);
 
+/// Overlaps the DMA transfers in the body of `forOp` with the computation in
+/// it: double buffers the fast memory buffers and their tags, and shifts all
+/// operations other than the incoming DMA starts by one iteration, replacing
+/// `forOp` by a prologue, a pipelined steady-state loop, and an epilogue.
+/// Returns failure if the loop cannot be pipelined (unknown trip count, no
+/// matching DMA start/wait pairs, or fast buffers live out of the loop), in
+/// which case the IR is left unchanged and in a valid state.
+LLVM_NODISCARD
+LogicalResult pipelineDmaTransfer(AffineForOp forOp);
+
 /// Tiles the specified band of perfectly nested loops creating tile-space loops
-/// and intra-tile loops. A band is a contiguous set of loops.
+/// and intra-tile loops. A band is a contiguous set of loops. If 'tiledNest'
+/// is non-null, it is populated with the new loops from outermost to innermost
+/// (tile-space loops followed by intra-tile loops).
 LLVM_NODISCARD
 LogicalResult tileCodeGen(MutableArrayRef<AffineForOp> band,
-                          ArrayRef<unsigned> tileSizes);
+                          ArrayRef<unsigned> tileSizes,
+                          SmallVectorImpl<AffineForOp> *tiledNest = nullptr);
 
 /// Performs loop interchange on 'forOpA' and 'forOpB'. Requires that 'forOpA'
 /// and 'forOpB' are part of a perfectly nested sequence of loops.
@@ -123,6 +136,16 @@ AffineForOp sinkSequentialLoops(AffineForOp forOp);
 /// 'loopDepth' AffineForOps consecutively nested under it.
 void sinkLoop(AffineForOp forOp, unsigned loopDepth);
 
+/// Skews the perfectly nested two-loop nest rooted at 'outerForOp' into
+/// wavefront form: the new outer loop runs over w = skewFactor * i + j and the
+/// new inner loop over i, with j recovered as w - skewFactor * i. A dependence
+/// with distance (di, dj) has distance (skewFactor * di + dj, di) in the
+/// skewed nest, so a factor making all wavefront components positive makes the
+/// inner loop parallel. Requires constant bounds and unit steps on both loops;
+/// returns failure without modifying the nest otherwise.
+LLVM_NODISCARD
+LogicalResult loopSkewByFactor(AffineForOp outerForOp, uint64_t skewFactor);
+
 /// Performs tiling fo imperfectly nested loops (with interchange) by
 /// strip-mining the `forOps` by `sizes` and sinking them, in their order of
 /// occurrence in `forOps`, under each of the `targets`.
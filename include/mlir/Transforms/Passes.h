@@ -45,6 +45,35 @@ FunctionPassBase *createCanonicalizerPass();
 /// Creates a pass to perform common sub expression elimination.
 FunctionPassBase *createCSEPass();
 
+/// Creates a pass that simplifies the control flow graph of functions by
+/// merging trivially linked blocks, forwarding branches through blocks that
+/// only re-branch, and erasing unreachable blocks. Intended to run after
+/// lowering passes that leave chains of single-purpose blocks behind.
+FunctionPassBase *createSimplifyControlFlowPass();
+
+/// Creates a module pass that pools duplicate elements-valued constants:
+/// within each function, one copy per unique value is hoisted to the entry
+/// block and the duplicates are forwarded to it.
+ModulePassBase *createConstantPoolingPass();
+
+/// Creates a module pass that inlines direct calls to small single-block
+/// functions, visiting the call graph bottom-up in strongly connected
+/// component order.
+ModulePassBase *createInlinerPass();
+
+/// Creates a module pass that clones functions per distinct static-shape
+/// signature observed at their call sites and rewrites the calls to target
+/// the clones.
+ModulePassBase *createFunctionSpecializationPass();
+
+/// Creates a pass that propagates static memref/tensor shapes forward
+/// through a function, rewriting types where provably static.
+FunctionPassBase *createShapeInferencePass();
+
+/// Creates a pass that shares the allocations of same-typed local memrefs
+/// with disjoint live ranges.
+FunctionPassBase *createBufferReusePass();
+
 /// Creates a pass to vectorize loops, operations and data types using a
 /// target-independent, n-D super-vector abstraction.
 FunctionPassBase *
@@ -91,13 +120,35 @@ FunctionPassBase *createLoopInvariantCodeMotionPass();
 /// memory hierarchy.
 FunctionPassBase *createPipelineDataTransferPass();
 
+/// Creates a pass that inserts prefetch ops for streaming memory accesses in
+/// innermost affine loops, a configurable number of iterations ahead of their
+/// use.
+FunctionPassBase *createPrefetchInsertionPass();
+
+/// Creates a module pass that outlines outermost parallel affine loops into
+/// body functions and replaces them with std.parallel_call dispatches to the
+/// thread-pool runtime.
+ModulePassBase *createAffineParallelizePass();
+
 /// Lowers affine control flow operations (ForStmt, IfStmt and AffineApplyOp)
 /// to equivalent lower-level constructs (flow of basic blocks and arithmetic
 /// primitives).
 FunctionPassBase *createLowerAffinePass();
 
-/// Creates a pass to perform tiling on loop nests.
-FunctionPassBase *createLoopTilingPass(uint64_t cacheSizeBytes);
+/// Creates a pass that skews two-deep affine loop nests with inner-carried
+/// dependences into wavefront form, making the inner loop parallel.
+FunctionPassBase *createLoopSkewingPass();
+
+/// Creates a pass that permutes perfectly nested affine loops so that loops
+/// with large memory strides run outermost and stride-1 loops innermost,
+/// subject to dependence legality.
+FunctionPassBase *createLoopInterchangePass();
+
+/// Creates a pass to perform tiling on loop nests. If 'l2CacheSizeBytes' is
+/// non-zero, each band is tiled at two levels: an outer level targeting the L2
+/// cache size and an inner level targeting 'cacheSizeBytes' (the L1 cache).
+FunctionPassBase *createLoopTilingPass(uint64_t cacheSizeBytes,
+                                       uint64_t l2CacheSizeBytes = 0);
 
 /// Promotes all accessed memref regions to the specified faster memory space
 /// while generating DMAs to move data.
@@ -113,6 +164,21 @@ FunctionPassBase *createLowerVectorTransfersPass();
 /// store to load forwarding, elimination of dead stores, and dead allocs.
 FunctionPassBase *createMemRefDataFlowOptPass();
 
+/// Creates a pass that promotes memref elements accessed in affine loops at
+/// loop-invariant indices to loop-carried SSA values, eliminating the
+/// per-iteration loads and stores.
+FunctionPassBase *createAffineScalarReplacementPass();
+
+/// Creates a pass that if-converts side-effect-free affine.if bodies into
+/// select-based straight-line code, removing the control flow that blocks
+/// vectorization of guarded loop nests.
+FunctionPassBase *createAffineIfConversionPass();
+
+/// Creates a pass that permutes and pads the layout of function-local memrefs
+/// so that the dominant accesses become stride-1 and rows avoid conflicting
+/// power-of-two strides.
+FunctionPassBase *createMemRefLayoutOptPass();
+
 /// Creates a pass to strip debug information from a function.
 FunctionPassBase *createStripDebugInfoPass();
 
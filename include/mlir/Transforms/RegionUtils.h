@@ -45,6 +45,54 @@ void replaceAllUsesInRegionWith(Value *orig, Value *replacement,
 void getUsedValuesDefinedAbove(Region &region, Region &limit,
                                llvm::SetVector<Value *> &values);
 
+/// Erase the blocks of `region` that are not reachable from its entry block.
+/// Returns true if any block was erased.
+bool eraseUnreachableBlocks(Region &region);
+
+/// A lightweight transaction over operations inserted at a fixed point in a
+/// block, for transformations that materialize IR speculatively (e.g. a loop
+/// nest slice built so a cost model can inspect it) and usually discard it.
+/// The transaction records only the neighbors of the insertion point at
+/// construction time, so tracking costs nothing per created operation;
+/// rollback() erases every top-level operation inserted into the window, in
+/// reverse order, together with anything nested in them. commit() keeps the
+/// inserted operations. A transaction that is neither rolled back nor
+/// committed rolls back on destruction.
+///
+/// The caller must not erase or move the operations adjacent to the insertion
+/// point, or move inserted operations out of the window, while the
+/// transaction is open; insertions elsewhere in the block are fine.
+class InsertionTransaction {
+public:
+  /// Begins a transaction covering operations inserted before
+  /// `insertionPoint` in `block`. A null insertion point means the end of the
+  /// block.
+  InsertionTransaction(Block *block, Operation *insertionPoint);
+  ~InsertionTransaction();
+
+  /// Erases all operations inserted into the window since the transaction
+  /// began.
+  void rollback();
+
+  /// Accepts the inserted operations and ends the transaction.
+  void commit();
+
+private:
+  Block *block;
+  /// The operation preceding the insertion window, or null if the window
+  /// starts at the beginning of the block. Neighbors are recorded instead of
+  /// iterators so that the window survives insertions elsewhere in the block.
+  Operation *prevOp;
+  /// The operation following the insertion window, or null if the window ends
+  /// at the end of the block.
+  Operation *nextOp;
+  /// Whether rollback() or commit() has already run.
+  bool resolved = false;
+
+  InsertionTransaction(const InsertionTransaction &) = delete;
+  void operator=(const InsertionTransaction &) = delete;
+};
+
 } // namespace mlir
 
 #endif // MLIR_TRANSFORMS_REGIONUTILS_H_
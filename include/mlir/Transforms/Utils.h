@@ -29,11 +29,13 @@
 #include "mlir/StandardOps/Ops.h"
 #include "llvm/ADT/ArrayRef.h"
 #include "llvm/ADT/DenseMap.h"
+#include "llvm/ADT/STLExtras.h"
 
 namespace mlir {
 
 class AffineApplyOp;
 class AffineForOp;
+class Function;
 class Location;
 class Module;
 class OpBuilder;
@@ -118,6 +120,37 @@ Operation *createComposedAffineApplyOp(OpBuilder &builder, Location loc,
 void createAffineComputationSlice(Operation *opInst,
                                   SmallVectorImpl<AffineApplyOp> *sliceOps);
 
+/// Rewrites the signature of 'fn' to 'newType' in place and batch-updates all
+/// of its direct std.call sites in the enclosing module, without cloning the
+/// function body. The first min(old, new) inputs correspond 1:1 to the
+/// original inputs and may change type; additional inputs of 'newType' are
+/// appended. The result counts must match, though result types may change
+/// 1:1.
+///
+/// 'materializeConversion' is invoked whenever a value of one type must be
+/// adapted to a corresponding value of a changed type: in the entry block it
+/// receives the retyped block argument and the original type, at call sites
+/// it receives the original operand (or new call result) and the type the
+/// other side now expects. It must return a value of the requested type, and
+/// is required whenever any 1:1 input or result type differs.
+///
+/// 'materializeExtraCallOperand' produces the value passed for each appended
+/// input at a given call site, and is required when 'newType' has more inputs
+/// than the current signature.
+///
+/// Entry block arguments are retyped in place and call sites are patched
+/// through their operand lists where possible, so function body storage is
+/// never duplicated; only call sites gaining operands are recreated. Returns
+/// failure without modifying the IR if the rewrite is not expressible (input
+/// count shrinks, result counts differ, a needed callback is missing, or the
+/// function is referenced by anything other than a direct std.call).
+LogicalResult rewriteFunctionSignature(
+    Function *fn, FunctionType newType,
+    llvm::function_ref<Value *(OpBuilder &, Location, Value *, Type)>
+        materializeConversion,
+    llvm::function_ref<Value *(OpBuilder &, Location, Type, Operation *)>
+        materializeExtraCallOperand = nullptr);
+
 } // end namespace mlir
 
 #endif // MLIR_TRANSFORMS_UTILS_H
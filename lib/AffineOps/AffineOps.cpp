@@ -470,26 +470,35 @@ AffineApplyNormalizer::AffineApplyNormalizer(AffineMap map,
     }
   } else {
     assert(numDimsBeforeRewrite <= operands.size());
-    // 2. Compose AffineApplyOps and dispatch dims or symbols.
+    // 2. Compose AffineApplyOps and dispatch dims or symbols. Memoize the
+    // renumbered map per defining operation: after unrolling the same
+    // affine.apply commonly feeds several operands, and renumbering it again
+    // would both redo the composition and concatenate its symbols twice.
+    llvm::SmallDenseMap<Operation *, AffineMap, 8> composedApplies;
     for (unsigned i = 0, e = operands.size(); i < e; ++i) {
       auto *t = operands[i];
       auto affineApply = dyn_cast_or_null<AffineApplyOp>(t->getDefiningOp());
       if (affineApply) {
         // a. Compose affine.apply operations.
-        LLVM_DEBUG(affineApply.getOperation()->print(
-            dbgs() << "\nCompose AffineApplyOp recursively: "));
-        AffineMap affineApplyMap = affineApply.getAffineMap();
-        SmallVector<Value *, 8> affineApplyOperands(
-            affineApply.getOperands().begin(), affineApply.getOperands().end());
-        AffineApplyNormalizer normalizer(affineApplyMap, affineApplyOperands);
-
-        LLVM_DEBUG(normalizer.affineMap.print(
-            dbgs() << "\nRenumber into current normalizer: "));
-
-        auto renumberedMap = renumber(normalizer);
-
-        LLVM_DEBUG(
-            renumberedMap.print(dbgs() << "\nRecursive composition yields: "));
+        AffineMap &renumberedMap = composedApplies[affineApply.getOperation()];
+        if (!renumberedMap) {
+          LLVM_DEBUG(affineApply.getOperation()->print(
+              dbgs() << "\nCompose AffineApplyOp recursively: "));
+          AffineMap affineApplyMap = affineApply.getAffineMap();
+          SmallVector<Value *, 8> affineApplyOperands(
+              affineApply.getOperands().begin(),
+              affineApply.getOperands().end());
+          AffineApplyNormalizer normalizer(affineApplyMap,
+                                           affineApplyOperands);
+
+          LLVM_DEBUG(normalizer.affineMap.print(
+              dbgs() << "\nRenumber into current normalizer: "));
+
+          renumberedMap = renumber(normalizer);
+
+          LLVM_DEBUG(renumberedMap.print(
+              dbgs() << "\nRecursive composition yields: "));
+        }
 
         auxiliaryExprs.push_back(renumberedMap.getResult(0));
       } else {
@@ -547,11 +556,22 @@ static void composeAffineMapAndOperands(AffineMap *map,
 
 void mlir::fullyComposeAffineMapAndOperands(
     AffineMap *map, SmallVectorImpl<Value *> *operands) {
+  // Each normalizer run peels one level of affine.apply operands off the
+  // chain, so iterate it to a fixpoint. Canonicalization does not affect
+  // which operands can be composed; running it once on the final form
+  // instead of once per level keeps deep chains from going quadratic.
+  bool composed = false;
   while (llvm::any_of(*operands, [](Value *v) {
     return isa_and_nonnull<AffineApplyOp>(v->getDefiningOp());
   })) {
-    composeAffineMapAndOperands(map, operands);
+    AffineApplyNormalizer normalizer(*map, *operands);
+    *map = normalizer.getAffineMap();
+    *operands = normalizer.getOperands();
+    assert(*map);
+    composed = true;
   }
+  if (composed)
+    canonicalizeMapAndOperands(map, operands);
 }
 
 AffineApplyOp mlir::makeComposedAffineApply(OpBuilder &b, Location loc,
@@ -937,7 +957,7 @@ static void ensureAffineTerminator(Region &region, Builder &builder,
 void AffineForOp::build(Builder *builder, OperationState *result,
                         ArrayRef<Value *> lbOperands, AffineMap lbMap,
                         ArrayRef<Value *> ubOperands, AffineMap ubMap,
-                        int64_t step) {
+                        int64_t step, ArrayRef<Value *> iterOperands) {
   assert(((!lbMap && lbOperands.empty()) ||
           lbOperands.size() == lbMap.getNumInputs()) &&
          "lower bound operand count does not match the affine map");
@@ -960,11 +980,20 @@ void AffineForOp::build(Builder *builder, OperationState *result,
                        builder->getAffineMapAttr(ubMap));
   result->addOperands(ubOperands);
 
-  // Create a region and a block for the body.  The argument of the region is
-  // the loop induction variable.
+  // Add the initial values of the loop-carried values; each one yields a
+  // result with the final value.
+  result->addOperands(iterOperands);
+  for (auto *operand : iterOperands)
+    result->addTypes(operand->getType());
+
+  // Create a region and a block for the body.  The arguments of the region
+  // are the loop induction variable followed by one argument per loop-carried
+  // value.
   Region *bodyRegion = result->addRegion();
   Block *body = new Block();
   body->addArgument(IndexType::get(builder->getContext()));
+  for (auto *operand : iterOperands)
+    body->addArgument(operand->getType());
   bodyRegion->push_back(body);
   ensureAffineTerminator(*bodyRegion, *builder, result->location);
 
@@ -986,24 +1015,44 @@ LogicalResult AffineForOp::verify() {
   if (bodyRegion.empty() || std::next(bodyRegion.begin()) != bodyRegion.end())
     return emitOpError("expected body region to have a single block");
 
-  // Check that the body defines as single block argument for the induction
-  // variable.
+  // Check that the body defines a single block argument for the induction
+  // variable, followed by one argument per loop-carried value.
   auto *body = getBody();
-  if (body->getNumArguments() != 1 ||
+  if (body->getNumArguments() != 1 + getNumResults() ||
       !body->getArgument(0)->getType().isIndex())
     return emitOpError("expected body to have a single index argument for the "
-                       "induction variable");
+                       "induction variable followed by one argument per "
+                       "loop-carried value");
+  for (unsigned i = 0, e = getNumResults(); i != e; ++i)
+    if (body->getArgument(1 + i)->getType() != getResult(i)->getType())
+      return emitOpError("expected loop-carried value argument ")
+             << (1 + i) << " to have the same type as the matching result";
 
   if (failed(checkHasAffineTerminator(*this, *body)))
     return failure();
 
-  // Verify that there are enough operands for the bounds.
+  // The terminator carries the values of the loop-carried values for the next
+  // iteration.
+  if (!body->empty()) {
+    auto terminator = cast<AffineTerminatorOp>(body->back());
+    if (terminator.getNumOperands() != getNumResults())
+      return emitOpError("expected terminator to have one operand per "
+                         "loop-carried value");
+    for (unsigned i = 0, e = getNumResults(); i != e; ++i)
+      if (terminator.getOperand(i)->getType() != getResult(i)->getType())
+        return emitOpError("expected terminator operand ")
+               << i << " to have the same type as the matching result";
+  }
+
+  // Verify that there are enough operands for the bounds and the loop-carried
+  // values.
   AffineMap lowerBoundMap = getLowerBoundMap(),
             upperBoundMap = getUpperBoundMap();
-  if (getNumOperands() !=
-      (lowerBoundMap.getNumInputs() + upperBoundMap.getNumInputs()))
+  if (getNumOperands() != (lowerBoundMap.getNumInputs() +
+                           upperBoundMap.getNumInputs() + getNumResults()))
     return emitOpError(
-        "operand count must match with affine map dimension and symbol count");
+        "operand count must match with affine map dimension and symbol count "
+        "plus the number of loop-carried values");
 
   // Verify that the bound operands are valid dimension/symbols.
   /// Lower bound.
@@ -1140,9 +1189,42 @@ ParseResult AffineForOp::parse(OpAsmParser *parser, OperationState *result) {
           "expected step to be representable as a positive signed integer");
   }
 
+  // Parse the optional initial values of the loop-carried values. The type of
+  // each carried value is spelled once, as a result type of the operation.
+  SmallVector<OpAsmParser::OperandType, 4> regionArgs(1, inductionVariable);
+  SmallVector<Type, 4> argTypes(1, builder.getIndexType());
+  if (!parser->parseOptionalKeyword("iter_args")) {
+    SmallVector<OpAsmParser::OperandType, 4> iterOperands;
+    if (parser->parseLParen())
+      return failure();
+    do {
+      OpAsmParser::OperandType regionArg, iterOperand;
+      if (parser->parseRegionArgument(regionArg) || parser->parseEqual() ||
+          parser->parseOperand(iterOperand))
+        return failure();
+      regionArgs.push_back(regionArg);
+      iterOperands.push_back(iterOperand);
+    } while (!parser->parseOptionalComma());
+    llvm::SMLoc typesLoc = parser->getCurrentLocation();
+    SmallVector<Type, 4> iterTypes;
+    if (parser->parseRParen() ||
+        parser->parseOptionalArrowTypeList(iterTypes))
+      return failure();
+    if (iterTypes.size() != iterOperands.size())
+      return parser->emitError(typesLoc,
+                               "expected as many result types as loop-carried "
+                               "values");
+    for (unsigned i = 0, e = iterOperands.size(); i != e; ++i)
+      if (parser->resolveOperand(iterOperands[i], iterTypes[i],
+                                 result->operands))
+        return failure();
+    result->addTypes(iterTypes);
+    argTypes.append(iterTypes.begin(), iterTypes.end());
+  }
+
   // Parse the body region.
   Region *body = result->addRegion();
-  if (parser->parseRegion(*body, inductionVariable, builder.getIndexType()))
+  if (parser->parseRegion(*body, regionArgs, argTypes))
     return failure();
 
   ensureAffineTerminator(*body, builder, result->location);
@@ -1207,9 +1289,29 @@ void AffineForOp::print(OpAsmPrinter *p) {
 
   if (getStep() != 1)
     *p << " step " << getStep();
+
+  // Print the initial values of the loop-carried values and the result types.
+  if (getNumIterOperands() > 0) {
+    *p << " iter_args(";
+    auto regionArgs = getRegionIterArgs();
+    for (unsigned i = 0, e = getNumIterOperands(); i != e; ++i) {
+      if (i != 0)
+        *p << ", ";
+      p->printOperand(regionArgs[i]);
+      *p << " = ";
+      p->printOperand(getIterOperand(i));
+    }
+    *p << ')';
+    SmallVector<Type, 4> resultTypes;
+    for (auto *res : getOperation()->getResults())
+      resultTypes.push_back(res->getType());
+    p->printOptionalArrowTypeList(resultTypes);
+  }
+
+  // The terminator is only elided when it carries no loop-carried values.
   p->printRegion(getRegion(),
                  /*printEntryBlockArgs=*/false,
-                 /*printBlockTerminators=*/false);
+                 /*printBlockTerminators=*/getNumResults() != 0);
   p->printOptionalAttrDict(getAttrs(),
                            /*elidedAttrs=*/{getLowerBoundAttrName(),
                                             getUpperBoundAttrName(),
@@ -1293,8 +1395,8 @@ AffineBound AffineForOp::getLowerBound() {
 AffineBound AffineForOp::getUpperBound() {
   auto lbMap = getLowerBoundMap();
   auto ubMap = getUpperBoundMap();
-  return AffineBound(AffineForOp(*this), lbMap.getNumInputs(), getNumOperands(),
-                     ubMap);
+  return AffineBound(AffineForOp(*this), lbMap.getNumInputs(),
+                     lbMap.getNumInputs() + ubMap.getNumInputs(), ubMap);
 }
 
 void AffineForOp::setLowerBound(ArrayRef<Value *> lbOperands, AffineMap map) {
@@ -1305,6 +1407,8 @@ void AffineForOp::setLowerBound(ArrayRef<Value *> lbOperands, AffineMap map) {
 
   auto ubOperands = getUpperBoundOperands();
   newOperands.append(ubOperands.begin(), ubOperands.end());
+  auto iterOperands = getIterOperands();
+  newOperands.append(iterOperands.begin(), iterOperands.end());
   getOperation()->setOperands(newOperands);
 
   setAttr(getLowerBoundAttrName(), AffineMapAttr::get(map));
@@ -1316,6 +1420,8 @@ void AffineForOp::setUpperBound(ArrayRef<Value *> ubOperands, AffineMap map) {
 
   SmallVector<Value *, 4> newOperands(getLowerBoundOperands());
   newOperands.append(ubOperands.begin(), ubOperands.end());
+  auto iterOperands = getIterOperands();
+  newOperands.append(iterOperands.begin(), iterOperands.end());
   getOperation()->setOperands(newOperands);
 
   setAttr(getUpperBoundAttrName(), AffineMapAttr::get(map));
@@ -1368,7 +1474,19 @@ AffineForOp::operand_range AffineForOp::getLowerBoundOperands() {
 }
 
 AffineForOp::operand_range AffineForOp::getUpperBoundOperands() {
-  return {operand_begin() + getLowerBoundMap().getNumInputs(), operand_end()};
+  return {operand_begin() + getLowerBoundMap().getNumInputs(),
+          operand_begin() + getLowerBoundMap().getNumInputs() +
+              getUpperBoundMap().getNumInputs()};
+}
+
+unsigned AffineForOp::getNumIterOperands() {
+  return getNumOperands() - getLowerBoundMap().getNumInputs() -
+         getUpperBoundMap().getNumInputs();
+}
+
+AffineForOp::operand_range AffineForOp::getIterOperands() {
+  return {operand_begin() + getNumOperands() - getNumIterOperands(),
+          operand_end()};
 }
 
 bool AffineForOp::matchingBoundOperandList() {
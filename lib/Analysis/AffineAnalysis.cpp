@@ -23,16 +23,20 @@
 #include "mlir/Analysis/AffineAnalysis.h"
 #include "mlir/AffineOps/AffineOps.h"
 #include "mlir/Analysis/AffineStructures.h"
+#include "mlir/Analysis/AliasAnalysis.h"
 #include "mlir/Analysis/Utils.h"
 #include "mlir/IR/AffineExprVisitor.h"
 #include "mlir/IR/Builders.h"
+#include "mlir/IR/Function.h"
 #include "mlir/IR/IntegerSet.h"
 #include "mlir/IR/Operation.h"
 #include "mlir/StandardOps/Ops.h"
 #include "mlir/Support/MathExtras.h"
 #include "mlir/Support/STLExtras.h"
 #include "llvm/ADT/DenseMap.h"
+#include "llvm/ADT/STLExtras.h"
 #include "llvm/Support/Debug.h"
+#include "llvm/Support/Mutex.h"
 #include "llvm/Support/raw_ostream.h"
 
 #define DEBUG_TYPE "affine-analysis"
@@ -41,6 +45,73 @@ using namespace mlir;
 
 using llvm::dbgs;
 
+namespace {
+/// A per-thread pool of constraint systems recycled across dependence checks.
+/// Each 'checkMemrefAccessDependence' call constructs several temporary
+/// FlatAffineConstraints whose row storage is grown on the heap; recycling
+/// them lets the O(accesses^2) query loops in the fusion passes reuse the
+/// buffers the first queries grew instead of reallocating them per call
+/// ('reset' clears a system's contents but keeps its reserved capacity).
+/// Systems are handed out through a scoped handle that returns them to the
+/// pool on destruction. The pool is thread-local, so concurrently running
+/// function passes never contend on it.
+class ConstraintSystemPool {
+public:
+  /// A scoped handle holding a pooled constraint system. The system is empty
+  /// on acquisition and is returned to the pool when the handle goes out of
+  /// scope.
+  class Scoped {
+  public:
+    Scoped() : cst(getPool().acquire()) {}
+    ~Scoped() { getPool().release(cst); }
+    Scoped(const Scoped &) = delete;
+    Scoped &operator=(const Scoped &) = delete;
+
+    FlatAffineConstraints &operator*() { return *cst; }
+    FlatAffineConstraints *operator->() { return cst; }
+    FlatAffineConstraints *get() { return cst; }
+
+  private:
+    FlatAffineConstraints *cst;
+  };
+
+private:
+  static ConstraintSystemPool &getPool() {
+    static thread_local ConstraintSystemPool pool;
+    return pool;
+  }
+
+  ~ConstraintSystemPool() {
+    for (auto *cst : freeList)
+      delete cst;
+  }
+
+  FlatAffineConstraints *acquire() {
+    if (freeList.empty())
+      return new FlatAffineConstraints();
+    auto *cst = freeList.pop_back_val();
+    // Drop any stale contents; this keeps the reserved storage.
+    cst->reset(/*numDims=*/0, /*numSymbols=*/0);
+    return cst;
+  }
+
+  void release(FlatAffineConstraints *cst) {
+    if (freeList.size() >= kMaxPooledSystems) {
+      delete cst;
+      return;
+    }
+    freeList.push_back(cst);
+  }
+
+  /// A cap on the number of idle systems retained, to bound the memory held
+  /// between queries. A single dependence check holds at most five systems
+  /// live at once.
+  enum { kMaxPooledSystems = 8 };
+
+  SmallVector<FlatAffineConstraints *, kMaxPooledSystems> freeList;
+};
+} // end anonymous namespace
+
 /// Returns the sequence of AffineApplyOp Operations operation in
 /// 'affineApplyOps', which are reachable via a search starting from 'operands',
 /// and ending at operands which are not defined by AffineApplyOps.
@@ -404,7 +475,9 @@ addMemRefAccessConstraints(const AffineValueMap &srcAccessMap,
 
   std::vector<SmallVector<int64_t, 8>> srcFlatExprs;
   std::vector<SmallVector<int64_t, 8>> destFlatExprs;
-  FlatAffineConstraints srcLocalVarCst, destLocalVarCst;
+  ConstraintSystemPool::Scoped srcLocalVarCstHandle, destLocalVarCstHandle;
+  FlatAffineConstraints &srcLocalVarCst = *srcLocalVarCstHandle;
+  FlatAffineConstraints &destLocalVarCst = *destLocalVarCstHandle;
   // Get flattened expressions for the source destination maps.
   if (failed(getFlattenedAffineExprs(srcMap, &srcFlatExprs, &srcLocalVarCst)) ||
       failed(getFlattenedAffineExprs(dstMap, &destFlatExprs, &destLocalVarCst)))
@@ -766,7 +839,7 @@ void MemRefAccess::getAccessMap(AffineValueMap *accessMap) const {
 //
 //
 // TODO(andydavis) Support AffineExprs mod/floordiv/ceildiv.
-DependenceResult mlir::checkMemrefAccessDependence(
+static DependenceResult checkMemrefAccessDependenceImpl(
     const MemRefAccess &srcAccess, const MemRefAccess &dstAccess,
     unsigned loopDepth, FlatAffineConstraints *dependenceConstraints,
     llvm::SmallVector<DependenceComponent, 2> *dependenceComponents,
@@ -777,7 +850,11 @@ DependenceResult mlir::checkMemrefAccessDependence(
   LLVM_DEBUG(dstAccess.opInst->dump(););
 
   // Return 'NoDependence' if these accesses do not access the same memref.
-  if (srcAccess.memref != dstAccess.memref)
+  // The comparison is on the underlying memrefs so that accesses through a
+  // 'memref_cast' of the same storage are still analyzed; the cast does not
+  // change the indexing.
+  if (getUnderlyingMemRef(srcAccess.memref) !=
+      getUnderlyingMemRef(dstAccess.memref))
     return DependenceResult::NoDependence;
 
   // Return 'NoDependence' if one of these accesses is not a StoreOp.
@@ -794,12 +871,14 @@ DependenceResult mlir::checkMemrefAccessDependence(
   dstAccess.getAccessMap(&dstAccessMap);
 
   // Get iteration domain for the 'srcAccess' operation.
-  FlatAffineConstraints srcDomain;
+  ConstraintSystemPool::Scoped srcDomainHandle;
+  FlatAffineConstraints &srcDomain = *srcDomainHandle;
   if (failed(getInstIndexSet(srcAccess.opInst, &srcDomain)))
     return DependenceResult::Failure;
 
   // Get iteration domain for 'dstAccess' operation.
-  FlatAffineConstraints dstDomain;
+  ConstraintSystemPool::Scoped dstDomainHandle;
+  FlatAffineConstraints &dstDomain = *dstDomainHandle;
   if (failed(getInstIndexSet(dstAccess.opInst, &dstDomain)))
     return DependenceResult::Failure;
 
@@ -858,6 +937,123 @@ DependenceResult mlir::checkMemrefAccessDependence(
   return DependenceResult::HasDependence;
 }
 
+namespace {
+/// A cache of memref access dependence check results. LoopFusion, LoopTiling
+/// and PipelineDataTransfer issue the same (access pair, depth) queries within
+/// one pipeline, each of which pays for a full Fourier-Motzkin based emptiness
+/// check. Entries are keyed on the access operations and additionally record
+/// the enclosing function and its body modification count, so any tracked
+/// mutation of the function invalidates them. Recording the function guards
+/// against operation addresses recycled into a different function whose
+/// modification count happens to coincide.
+struct DependenceCheckCache {
+  struct Entry {
+    unsigned loopDepth;
+    bool allowRAR;
+    Function *function;
+    uint64_t modificationCount;
+    DependenceResult::ResultEnum result;
+    /// The dependence constraint system; only valid when the result is not
+    /// Failure.
+    FlatAffineConstraints constraints;
+    /// The direction vector, if it was requested when the entry was computed.
+    Optional<SmallVector<DependenceComponent, 2>> components;
+  };
+
+  /// The entries for each (src, dst) access operation pair. The per-pair lists
+  /// stay small: one entry per queried depth.
+  DenseMap<std::pair<Operation *, Operation *>, SmallVector<Entry, 2>> entries;
+
+  /// Guards 'entries'; function passes may run dependence checks from multiple
+  /// threads.
+  llvm::sys::SmartMutex<true> mutex;
+
+  /// A size cap after which the cache is dropped wholesale, to bound the
+  /// memory held on behalf of functions that were long since processed.
+  enum { MaxNumCachedPairs = 2048 };
+};
+} // end anonymous namespace
+
+static DependenceCheckCache &getDependenceCheckCache() {
+  static DependenceCheckCache cache;
+  return cache;
+}
+
+DependenceResult mlir::checkMemrefAccessDependence(
+    const MemRefAccess &srcAccess, const MemRefAccess &dstAccess,
+    unsigned loopDepth, FlatAffineConstraints *dependenceConstraints,
+    llvm::SmallVector<DependenceComponent, 2> *dependenceComponents,
+    bool allowRAR) {
+  // Answer the cheap cases directly; they are not worth caching.
+  if (getUnderlyingMemRef(srcAccess.memref) !=
+      getUnderlyingMemRef(dstAccess.memref))
+    return DependenceResult::NoDependence;
+  Function *function = srcAccess.opInst->getFunction();
+  if (!function)
+    return checkMemrefAccessDependenceImpl(srcAccess, dstAccess, loopDepth,
+                                           dependenceConstraints,
+                                           dependenceComponents, allowRAR);
+
+  // Look for a cached result computed for the current state of the function.
+  auto &cache = getDependenceCheckCache();
+  uint64_t modificationCount = function->getBodyModificationCount();
+  auto key = std::make_pair(srcAccess.opInst, dstAccess.opInst);
+  {
+    llvm::sys::SmartScopedLock<true> lock(cache.mutex);
+    auto it = cache.entries.find(key);
+    if (it != cache.entries.end()) {
+      for (auto &entry : it->second) {
+        if (entry.loopDepth != loopDepth || entry.allowRAR != allowRAR ||
+            entry.function != function ||
+            entry.modificationCount != modificationCount)
+          continue;
+        // Recompute if the direction vector is wanted but wasn't requested
+        // when this entry was populated.
+        if (dependenceComponents &&
+            entry.result == DependenceResult::HasDependence &&
+            !entry.components)
+          break;
+        if (entry.result != DependenceResult::Failure && dependenceConstraints)
+          dependenceConstraints->clearAndCopyFrom(entry.constraints);
+        if (dependenceComponents && entry.components)
+          *dependenceComponents = *entry.components;
+        return entry.result;
+      }
+    }
+  }
+
+  // Compute the result and populate the cache.
+  DependenceResult result = checkMemrefAccessDependenceImpl(
+      srcAccess, dstAccess, loopDepth, dependenceConstraints,
+      dependenceComponents, allowRAR);
+
+  DependenceCheckCache::Entry entry;
+  entry.loopDepth = loopDepth;
+  entry.allowRAR = allowRAR;
+  entry.function = function;
+  entry.modificationCount = modificationCount;
+  entry.result = result.value;
+  if (result.value != DependenceResult::Failure && dependenceConstraints)
+    entry.constraints = *dependenceConstraints;
+  // The direction vector is only populated when a dependence exists.
+  if (dependenceComponents && result.value == DependenceResult::HasDependence)
+    entry.components = *dependenceComponents;
+  {
+    llvm::sys::SmartScopedLock<true> lock(cache.mutex);
+    if (cache.entries.size() >= DependenceCheckCache::MaxNumCachedPairs)
+      cache.entries.clear();
+    auto &pairEntries = cache.entries[key];
+    // Drop entries stale under the current modification count while here.
+    llvm::erase_if(pairEntries, [&](const DependenceCheckCache::Entry &e) {
+      return e.function != function ||
+             e.modificationCount != modificationCount ||
+             (e.loopDepth == loopDepth && e.allowRAR == allowRAR);
+    });
+    pairEntries.push_back(std::move(entry));
+  }
+  return result;
+}
+
 /// Gathers dependence components for dependences between all ops in loop nest
 /// rooted at 'forOp' at loop depths in range [1, maxLoopDepth].
 void mlir::getDependenceComponents(
@@ -879,12 +1075,12 @@ void mlir::getDependenceComponents(
         auto *dstOpInst = loadAndStoreOpInsts[j];
         MemRefAccess dstAccess(dstOpInst);
 
-        FlatAffineConstraints dependenceConstraints;
+        ConstraintSystemPool::Scoped dependenceConstraints;
         llvm::SmallVector<DependenceComponent, 2> depComps;
         // TODO(andydavis,bondhugula) Explore whether it would be profitable
         // to pre-compute and store deps instead of repeatedly checking.
         DependenceResult result = checkMemrefAccessDependence(
-            srcAccess, dstAccess, d, &dependenceConstraints, &depComps);
+            srcAccess, dstAccess, d, dependenceConstraints.get(), &depComps);
         if (hasDependence(result))
           depCompsVec->push_back(depComps);
       }
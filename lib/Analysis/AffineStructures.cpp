@@ -24,6 +24,7 @@
 #include "mlir/IR/AffineExprVisitor.h"
 #include "mlir/IR/AffineMap.h"
 #include "mlir/IR/IntegerSet.h"
+#include "mlir/IR/MLIRContext.h"
 #include "mlir/IR/Operation.h"
 #include "mlir/StandardOps/Ops.h"
 #include "mlir/Support/MathExtras.h"
@@ -31,6 +32,8 @@
 #include "llvm/ADT/SmallPtrSet.h"
 #include "llvm/Support/Debug.h"
 #include "llvm/Support/raw_ostream.h"
+#include <cstring>
+#include <limits>
 
 #define DEBUG_TYPE "affine-structures"
 
@@ -85,7 +88,30 @@ static LogicalResult getFlattenedAffineExprs(
     return success();
   }
 
-  AffineExprFlattener flattener(numDims, numSymbols, exprs[0].getContext());
+  // Fast path: when every expression has a memoized local-free row for this
+  // signature, the rows are independent of each other and there are no local
+  // variable constraints. Expressions are uniqued DAGs, so the subscripts
+  // shared across access maps after fusion hit the cache.
+  MLIRContext *context = exprs[0].getContext();
+  flattenedExprs->clear();
+  flattenedExprs->reserve(exprs.size());
+  bool allCached = true;
+  for (auto expr : exprs) {
+    SmallVector<int64_t, 8> row;
+    if (!context->lookupFlattenedAffineExpr(expr, numDims, numSymbols, row)) {
+      allCached = false;
+      break;
+    }
+    flattenedExprs->push_back(std::move(row));
+  }
+  if (allCached) {
+    if (localVarCst)
+      localVarCst->reset(numDims, numSymbols);
+    return success();
+  }
+  flattenedExprs->clear();
+
+  AffineExprFlattener flattener(numDims, numSymbols, context);
   // Use the same flattener to simplify each expression successively. This way
   // local identifiers / expressions are shared.
   for (auto expr : exprs) {
@@ -96,7 +122,6 @@ static LogicalResult getFlattenedAffineExprs(
   }
 
   assert(flattener.operandExprStack.size() == exprs.size());
-  flattenedExprs->clear();
   flattenedExprs->assign(flattener.operandExprStack.begin(),
                          flattener.operandExprStack.end());
 
@@ -104,6 +129,13 @@ static LogicalResult getFlattenedAffineExprs(
     localVarCst->clearAndCopyFrom(flattener.localVarCst);
   }
 
+  // Rows that involve local identifiers depend on the numbering introduced by
+  // this flattener instance, so only local-free flattenings are memoized.
+  if (flattener.localExprs.empty())
+    for (unsigned i = 0, e = exprs.size(); i != e; ++i)
+      context->cacheFlattenedAffineExpr(exprs[i], numDims, numSymbols,
+                                        (*flattenedExprs)[i]);
+
   return success();
 }
 
@@ -816,24 +848,22 @@ findConstraintWithNonZeroAt(const FlatAffineConstraints &constraints,
 
 // Normalizes the coefficient values across all columns in 'rowIDx' by their
 // GCD in equality or inequality contraints as specified by 'isEq'.
+// The row is processed through a contiguous pointer - the eq/ineq selection
+// happens once per row, not per element - so the reduction and the divide
+// sweep below stream over the row and the latter is open to vectorization.
 template <bool isEq>
 static void normalizeConstraintByGCD(FlatAffineConstraints *constraints,
                                      unsigned rowIdx) {
-  auto at = [&](unsigned colIdx) -> int64_t {
-    return isEq ? constraints->atEq(rowIdx, colIdx)
-                : constraints->atIneq(rowIdx, colIdx);
-  };
-  uint64_t gcd = std::abs(at(0));
-  for (unsigned j = 1, e = constraints->getNumCols(); j < e; ++j) {
-    gcd = llvm::GreatestCommonDivisor64(gcd, std::abs(at(j)));
-  }
-  if (gcd > 0 && gcd != 1) {
-    for (unsigned j = 0, e = constraints->getNumCols(); j < e; ++j) {
-      int64_t v = at(j) / static_cast<int64_t>(gcd);
-      isEq ? constraints->atEq(rowIdx, j) = v
-           : constraints->atIneq(rowIdx, j) = v;
-    }
-  }
+  unsigned numCols = constraints->getNumCols();
+  int64_t *row = isEq ? &constraints->atEq(rowIdx, 0)
+                      : &constraints->atIneq(rowIdx, 0);
+  uint64_t gcd = std::abs(row[0]);
+  for (unsigned j = 1; j < numCols && gcd != 1; ++j)
+    gcd = llvm::GreatestCommonDivisor64(gcd, std::abs(row[j]));
+  if (gcd == 0 || gcd == 1)
+    return;
+  for (unsigned j = 0; j < numCols; ++j)
+    row[j] /= static_cast<int64_t>(gcd);
 }
 
 void FlatAffineConstraints::normalizeConstraintsByGCD() {
@@ -904,10 +934,9 @@ static void eliminateFromConstraint(FlatAffineConstraints *constraints,
   // Skip if equality 'rowIdx' if same as 'pivotRow'.
   if (isEq && rowIdx == pivotRow)
     return;
-  auto at = [&](unsigned i, unsigned j) -> int64_t {
-    return isEq ? constraints->atEq(i, j) : constraints->atIneq(i, j);
-  };
-  int64_t leadCoeff = at(rowIdx, pivotCol);
+  int64_t *row = isEq ? &constraints->atEq(rowIdx, 0)
+                      : &constraints->atIneq(rowIdx, 0);
+  int64_t leadCoeff = row[pivotCol];
   // Skip if leading coefficient at 'rowIdx' is already zero.
   if (leadCoeff == 0)
     return;
@@ -917,16 +946,16 @@ static void eliminateFromConstraint(FlatAffineConstraints *constraints,
   int64_t pivotMultiplier = sign * (lcm / std::abs(pivotCoeff));
   int64_t rowMultiplier = lcm / std::abs(leadCoeff);
 
+  // Fused scale-add of the pivot row into 'row' over contiguous storage. The
+  // columns in [elimColStart, pivotCol) were just eliminated and are skipped
+  // by splitting the sweep, keeping both inner loops branch-free so that they
+  // vectorize.
+  const int64_t *pivotRowPtr = &constraints->atEq(pivotRow, 0);
   unsigned numCols = constraints->getNumCols();
-  for (unsigned j = 0; j < numCols; ++j) {
-    // Skip updating column 'j' if it was just eliminated.
-    if (j >= elimColStart && j < pivotCol)
-      continue;
-    int64_t v = pivotMultiplier * constraints->atEq(pivotRow, j) +
-                rowMultiplier * at(rowIdx, j);
-    isEq ? constraints->atEq(rowIdx, j) = v
-         : constraints->atIneq(rowIdx, j) = v;
-  }
+  for (unsigned j = 0, e = std::min(elimColStart, pivotCol); j < e; ++j)
+    row[j] = pivotMultiplier * pivotRowPtr[j] + rowMultiplier * row[j];
+  for (unsigned j = pivotCol; j < numCols; ++j)
+    row[j] = pivotMultiplier * pivotRowPtr[j] + rowMultiplier * row[j];
 }
 
 // Remove coefficients in column range [colStart, colLimit) in place.
@@ -942,15 +971,13 @@ static void shiftColumnsToLeft(FlatAffineConstraints *constraints,
   unsigned numCols = constraints->getNumCols();
   unsigned numRows = isEq ? constraints->getNumEqualities()
                           : constraints->getNumInequalities();
-  unsigned numToEliminate = colLimit - colStart;
+  // Each row is contiguous, so the surviving tail of the row moves left in a
+  // single overlapping copy instead of an element-wise loop.
   for (unsigned r = 0, e = numRows; r < e; ++r) {
-    for (unsigned c = colLimit; c < numCols; ++c) {
-      if (isEq) {
-        constraints->atEq(r, c - numToEliminate) = constraints->atEq(r, c);
-      } else {
-        constraints->atIneq(r, c - numToEliminate) = constraints->atIneq(r, c);
-      }
-    }
+    int64_t *row =
+        isEq ? &constraints->atEq(r, 0) : &constraints->atIneq(r, 0);
+    std::memmove(row + colStart, row + colLimit,
+                 (numCols - colLimit) * sizeof(int64_t));
   }
 }
 
@@ -1006,31 +1033,272 @@ static unsigned getBestIdToEliminate(const FlatAffineConstraints &cst,
                                      unsigned start, unsigned end) {
   assert(start < cst.getNumIds() && end < cst.getNumIds() + 1);
 
-  auto getProductOfNumLowerUpperBounds = [&](unsigned pos) {
+  // Returns the product of the number of lower and upper bounds on the
+  // identifier (the number of constraints its elimination generates), along
+  // with whether all of its coefficients are unit (+/-1). Eliminating a unit
+  // coefficient identifier is integer exact and does not grow the remaining
+  // coefficients, so it is preferred among candidates of equal cost.
+  auto getEliminationCost = [&](unsigned pos) {
     unsigned numLb = 0;
     unsigned numUb = 0;
+    bool allUnitCoeffs = true;
     for (unsigned r = 0, e = cst.getNumInequalities(); r < e; r++) {
-      if (cst.atIneq(r, pos) > 0) {
+      int64_t coeff = cst.atIneq(r, pos);
+      if (coeff > 0)
         ++numLb;
-      } else if (cst.atIneq(r, pos) < 0) {
+      else if (coeff < 0)
         ++numUb;
-      }
+      if (coeff != 0 && coeff != 1 && coeff != -1)
+        allUnitCoeffs = false;
     }
-    return numLb * numUb;
+    return std::make_pair(numLb * numUb, !allUnitCoeffs);
   };
 
   unsigned minLoc = start;
-  unsigned min = getProductOfNumLowerUpperBounds(start);
+  auto min = getEliminationCost(start);
   for (unsigned c = start + 1; c < end; c++) {
-    unsigned numLbUbProduct = getProductOfNumLowerUpperBounds(c);
-    if (numLbUbProduct < min) {
-      min = numLbUbProduct;
+    auto cost = getEliminationCost(c);
+    if (cost < min) {
+      min = cost;
       minLoc = c;
     }
   }
   return minLoc;
 }
 
+/// Cheap pre-check for emptiness: intersects the bounds of identifiers that
+/// appear in single-variable constraints. A row whose only nonzero
+/// coefficient belongs to one identifier pins that identifier to a half-line
+/// (or, for an equality, to a point), so a contradiction between the
+/// tightest integer lower and upper bound proves the system empty without
+/// running any elimination. Returns true if such a contradiction exists.
+static bool hasContradictorySingleVarBounds(const FlatAffineConstraints &cst) {
+  unsigned numIds = cst.getNumIds();
+  unsigned numCols = cst.getNumCols();
+  SmallVector<Optional<int64_t>, 8> lowerBound(numIds), upperBound(numIds);
+
+  // Returns the position of the single identifier with a nonzero coefficient
+  // in the given row, or None if there are zero or several.
+  auto getSingleVarPos =
+      [&](llvm::function_ref<int64_t(unsigned)> getCoeff) -> Optional<unsigned> {
+    Optional<unsigned> pos;
+    for (unsigned c = 0; c < numIds; ++c) {
+      if (getCoeff(c) == 0)
+        continue;
+      if (pos)
+        return None;
+      pos = c;
+    }
+    return pos;
+  };
+  auto tightenLower = [&](unsigned pos, int64_t bound) {
+    if (!lowerBound[pos] || bound > *lowerBound[pos])
+      lowerBound[pos] = bound;
+  };
+  auto tightenUpper = [&](unsigned pos, int64_t bound) {
+    if (!upperBound[pos] || bound < *upperBound[pos])
+      upperBound[pos] = bound;
+  };
+
+  // c*x + d >= 0 bounds x from below if c > 0 and from above otherwise.
+  for (unsigned r = 0, e = cst.getNumInequalities(); r < e; ++r) {
+    auto pos =
+        getSingleVarPos([&](unsigned c) { return cst.atIneq(r, c); });
+    if (!pos)
+      continue;
+    int64_t coeff = cst.atIneq(r, *pos);
+    int64_t constant = cst.atIneq(r, numCols - 1);
+    if (coeff > 0)
+      tightenLower(*pos, ceilDiv(-constant, coeff));
+    else
+      tightenUpper(*pos, floorDiv(constant, -coeff));
+  }
+
+  // c*x + d == 0 pins x to -d/c, or is infeasible if c does not divide d.
+  for (unsigned r = 0, e = cst.getNumEqualities(); r < e; ++r) {
+    auto pos = getSingleVarPos([&](unsigned c) { return cst.atEq(r, c); });
+    if (!pos)
+      continue;
+    int64_t coeff = cst.atEq(r, *pos);
+    int64_t constant = cst.atEq(r, numCols - 1);
+    if (constant % coeff != 0)
+      return true;
+    int64_t value = -constant / coeff;
+    tightenLower(*pos, value);
+    tightenUpper(*pos, value);
+  }
+
+  for (unsigned pos = 0; pos < numIds; ++pos)
+    if (lowerBound[pos] && upperBound[pos] &&
+        *lowerBound[pos] > *upperBound[pos])
+      return true;
+  return false;
+}
+
+/// Returns true if 'v' can be stored in the narrow coefficient type. The
+/// range is symmetric (the most negative value is excluded) so that any
+/// product of two in-range values and any sum of two such products fit in
+/// int64_t, keeping the combination arithmetic below overflow-free.
+template <typename CoeffT> static bool fitsInCoeff(int64_t v) {
+  return v >= -std::numeric_limits<CoeffT>::max() &&
+         v <= std::numeric_limits<CoeffT>::max();
+}
+
+/// Small-integer mode of the Fourier-Motzkin emptiness check. The inequality
+/// rows of 'cst' are copied into a dense row-major matrix of the narrow
+/// coefficient type 'CoeffT', halving the working set of the elimination
+/// relative to the int64_t storage of FlatAffineConstraints, and eliminated
+/// one identifier at a time. Returns true/false once emptiness is decided.
+/// Returns None - leaving the caller to redo the check in full width - if any
+/// coefficient of the input or of a combined row overflows 'CoeffT', if the
+/// system still carries equalities, or if the number of rows would exceed
+/// 'maxRows'.
+template <typename CoeffT>
+static Optional<bool> isEmptyByNarrowFM(const FlatAffineConstraints &cst,
+                                        unsigned maxRows) {
+  // Equalities would need the full Gaussian machinery; the caller eliminates
+  // them beforehand in the common case.
+  if (cst.getNumEqualities() != 0)
+    return None;
+  if (cst.getNumInequalities() == 0)
+    return false;
+
+  unsigned numCols = cst.getNumCols();
+  SmallVector<CoeffT, 64> rows;
+  rows.reserve(cst.getNumInequalities() * numCols);
+  for (unsigned r = 0, e = cst.getNumInequalities(); r < e; ++r) {
+    for (unsigned c = 0; c < numCols; ++c) {
+      int64_t v = cst.atIneq(r, c);
+      if (!fitsInCoeff<CoeffT>(v))
+        return None;
+      rows.push_back(static_cast<CoeffT>(v));
+    }
+  }
+
+  while (true) {
+    unsigned numRows = rows.size() / numCols;
+    // GCD-tighten every row, mirroring the GCDTightenInequalities step of the
+    // full-width elimination so that both modes prove the same systems empty.
+    for (unsigned r = 0; r < numRows; ++r) {
+      uint64_t gcd = 0;
+      for (unsigned c = 0; c + 1 < numCols; ++c)
+        gcd = llvm::GreatestCommonDivisor64(
+            gcd, std::abs(static_cast<int64_t>(rows[r * numCols + c])));
+      if (gcd > 1) {
+        for (unsigned c = 0; c + 1 < numCols; ++c)
+          rows[r * numCols + c] /= static_cast<CoeffT>(gcd);
+        rows[r * numCols + numCols - 1] = static_cast<CoeffT>(mlir::floorDiv(
+            rows[r * numCols + numCols - 1], static_cast<int64_t>(gcd)));
+      }
+    }
+    // Check for a trivially invalid row: all-zero coefficients with a
+    // negative constant.
+    for (unsigned r = 0; r < numRows; ++r) {
+      bool allZero = true;
+      for (unsigned c = 0; c + 1 < numCols; ++c) {
+        if (rows[r * numCols + c] != 0) {
+          allZero = false;
+          break;
+        }
+      }
+      if (allZero && rows[r * numCols + numCols - 1] < 0)
+        return true;
+    }
+    // Only the constant column is left; no contradiction was found.
+    if (numCols == 1)
+      return false;
+
+    // Pick the identifier whose elimination generates the fewest rows,
+    // preferring unit coefficients, as in getBestIdToEliminate.
+    unsigned pos = 0;
+    std::pair<unsigned, bool> best(std::numeric_limits<unsigned>::max(), true);
+    for (unsigned c = 0; c + 1 < numCols; ++c) {
+      unsigned numLb = 0, numUb = 0;
+      bool allUnitCoeffs = true;
+      for (unsigned r = 0; r < numRows; ++r) {
+        CoeffT coeff = rows[r * numCols + c];
+        if (coeff > 0)
+          ++numLb;
+        else if (coeff < 0)
+          ++numUb;
+        if (coeff != 0 && coeff != 1 && coeff != -1)
+          allUnitCoeffs = false;
+      }
+      auto cost = std::make_pair(numLb * numUb, !allUnitCoeffs);
+      if (cost < best) {
+        best = cost;
+        pos = c;
+      }
+    }
+
+    SmallVector<unsigned, 8> lbRows, ubRows, nbRows;
+    for (unsigned r = 0; r < numRows; ++r) {
+      CoeffT coeff = rows[r * numCols + pos];
+      if (coeff == 0)
+        nbRows.push_back(r);
+      else if (coeff > 0)
+        lbRows.push_back(r);
+      else
+        ubRows.push_back(r);
+    }
+    if (lbRows.size() * ubRows.size() + nbRows.size() > maxRows)
+      return None;
+
+    unsigned newNumCols = numCols - 1;
+    SmallVector<CoeffT, 64> newRows;
+    newRows.reserve(
+        (lbRows.size() * ubRows.size() + nbRows.size()) * newNumCols);
+
+    // Rows not involving the identifier carry over with the column removed.
+    for (unsigned r : nbRows)
+      for (unsigned c = 0; c < numCols; ++c)
+        if (c != pos)
+          newRows.push_back(rows[r * numCols + c]);
+
+    // Combine each lower bound with each upper bound, GCD-tightening the
+    // result. The references stored in 'addedRows' for duplicate elimination
+    // stay valid because 'newRows' was reserved for the worst case.
+    SmallDenseSet<ArrayRef<CoeffT>, 8> addedRows;
+    for (unsigned ubPos : ubRows) {
+      for (unsigned lbPos : lbRows) {
+        int64_t lbCoeff = rows[lbPos * numCols + pos];
+        int64_t ubCoeff = -rows[ubPos * numCols + pos];
+        int64_t lcm = mlir::lcm(lbCoeff, ubCoeff);
+        if (!fitsInCoeff<CoeffT>(lcm))
+          return None;
+        int64_t lbScale = lcm / lbCoeff, ubScale = lcm / ubCoeff;
+        unsigned base = newRows.size();
+        for (unsigned c = 0; c < numCols; ++c) {
+          if (c == pos)
+            continue;
+          int64_t v = rows[lbPos * numCols + c] * lbScale +
+                      rows[ubPos * numCols + c] * ubScale;
+          if (!fitsInCoeff<CoeffT>(v))
+            return None;
+          newRows.push_back(static_cast<CoeffT>(v));
+        }
+        uint64_t gcd = 0;
+        for (unsigned c = 0; c + 1 < newNumCols; ++c)
+          gcd = llvm::GreatestCommonDivisor64(
+              gcd, std::abs(static_cast<int64_t>(newRows[base + c])));
+        if (gcd > 1) {
+          for (unsigned c = 0; c + 1 < newNumCols; ++c)
+            newRows[base + c] /= static_cast<CoeffT>(gcd);
+          newRows[base + newNumCols - 1] = static_cast<CoeffT>(
+              mlir::floorDiv(newRows[base + newNumCols - 1],
+                             static_cast<int64_t>(gcd)));
+        }
+        ArrayRef<CoeffT> added(&newRows[base], newNumCols);
+        if (!addedRows.insert(added).second)
+          newRows.resize(base);
+      }
+    }
+
+    rows = std::move(newRows);
+    numCols = newNumCols;
+  }
+}
+
 // Checks for emptiness of the set by eliminating identifiers successively and
 // using the GCD test (on all equality constraints) and checking for trivially
 // invalid constraints. Returns 'true' if the constraint system is found to be
@@ -1039,6 +1307,13 @@ bool FlatAffineConstraints::isEmpty() const {
   if (isEmptyByGCDTest() || hasInvalidConstraint())
     return true;
 
+  // Intersect the bounds of identifiers pinned by single-variable
+  // constraints next: dependence queries between non-intersecting iteration
+  // ranges are decided right here by a bound contradiction, before any
+  // elimination runs.
+  if (hasContradictorySingleVarBounds(*this))
+    return true;
+
   // First, eliminate as many identifiers as possible using Gaussian
   // elimination.
   FlatAffineConstraints tmpCst(*this);
@@ -1050,10 +1325,20 @@ bool FlatAffineConstraints::isEmpty() const {
     // detect emptiness early. Since the checks isEmptyByGCDTest() and
     // hasInvalidConstraint() are linear time and single sweep on the constraint
     // buffer, this appears reasonable - but can optimize in the future.
-    if (tmpCst.hasInvalidConstraint() || tmpCst.isEmptyByGCDTest())
+    if (tmpCst.hasInvalidConstraint() || tmpCst.isEmptyByGCDTest() ||
+        hasContradictorySingleVarBounds(tmpCst))
       return true;
   }
 
+  // Try the remaining eliminations in small-integer mode first: constraint
+  // systems from dependence analysis rarely carry coefficients beyond 16
+  // bits, and int32 rows halve the working set of the elimination. Systems
+  // whose coefficients grow past the narrow range escape to the full-width
+  // elimination below.
+  if (auto empty = isEmptyByNarrowFM<int32_t>(
+          tmpCst, kExplosionFactor * getNumIds()))
+    return *empty;
+
   // Eliminate the remaining using FM.
   for (unsigned i = 0, e = tmpCst.getNumIds(); i < e; i++) {
     tmpCst.FourierMotzkinEliminate(
@@ -1069,8 +1354,10 @@ bool FlatAffineConstraints::isEmpty() const {
     }
 
     // FM wouldn't have modified the equalities in any way. So no need to again
-    // run GCD test. Check for trivial invalid constraints.
-    if (tmpCst.hasInvalidConstraint())
+    // run GCD test. Check for trivial invalid constraints and for bound
+    // contradictions among the single-variable rows FM just produced.
+    if (tmpCst.hasInvalidConstraint() ||
+        hasContradictorySingleVarBounds(tmpCst))
       return true;
   }
   return false;
@@ -2486,7 +2773,28 @@ void FlatAffineConstraints::FourierMotzkinEliminate(
   assert(newFac.getIds().size() == newFac.getNumIds());
 
   // This will be used to check if the elimination was integer exact.
-  unsigned lcmProducts = 1;
+  bool allLcmsAreOne = true;
+
+  // Precompute the nonzero columns of each bound row once. The combination
+  // step visits each lower bound row once per upper bound row, and the
+  // coefficient rows of typical dependence systems are sparse, so scattering
+  // only the nonzero entries avoids rescanning full rows for each of the
+  // lbIndices * ubIndices combinations.
+  DenseMap<unsigned, SmallVector<unsigned, 8>> nonZeroCols;
+  for (auto indices : {&lbIndices, &ubIndices}) {
+    for (auto rowPos : *indices) {
+      auto &cols = nonZeroCols[rowPos];
+      for (unsigned l = 0, e = getNumCols(); l < e; l++)
+        if (l != pos && atIneq(rowPos, l) != 0)
+          cols.push_back(l);
+    }
+  }
+
+  // Rows already added to the new system, used to drop the exact duplicates
+  // the pairwise combination commonly generates before they multiply the cost
+  // of the next elimination. The references point into newFac's storage, which
+  // was reserved upfront for the worst case and hence does not reallocate.
+  SmallDenseSet<ArrayRef<int64_t>, 8> addedRows;
 
   // Let x be the variable we are eliminating.
   // For each lower bound, lb <= c_l*x, and each upper bound c_u*x <= ub, (note
@@ -2498,39 +2806,44 @@ void FlatAffineConstraints::FourierMotzkinEliminate(
   // constraint correspond to integer points in the original system (i.e., they
   // have integer pre-images). Hence, if the lcm's are all 1, the elimination is
   // integer exact.
+  SmallVector<int64_t, 4> ineq(newFac.getNumCols());
   for (auto ubPos : ubIndices) {
     for (auto lbPos : lbIndices) {
-      SmallVector<int64_t, 4> ineq;
-      ineq.reserve(newFac.getNumCols());
       int64_t lbCoeff = atIneq(lbPos, pos);
       // Note that in the comments above, ubCoeff is the negation of the
       // coefficient in the canonical form as the view taken here is that of the
       // term being moved to the other size of '>='.
       int64_t ubCoeff = -atIneq(ubPos, pos);
-      // TODO(bondhugula): refactor this loop to avoid all branches inside.
-      for (unsigned l = 0, e = getNumCols(); l < e; l++) {
-        if (l == pos)
-          continue;
-        assert(lbCoeff >= 1 && ubCoeff >= 1 && "bounds wrongly identified");
-        int64_t lcm = mlir::lcm(lbCoeff, ubCoeff);
-        ineq.push_back(atIneq(ubPos, l) * (lcm / ubCoeff) +
-                       atIneq(lbPos, l) * (lcm / lbCoeff));
-        lcmProducts *= lcm;
-      }
+      assert(lbCoeff >= 1 && ubCoeff >= 1 && "bounds wrongly identified");
+      int64_t lcm = mlir::lcm(lbCoeff, ubCoeff);
+      int64_t lbScale = lcm / lbCoeff, ubScale = lcm / ubCoeff;
+      if (lcm != 1)
+        allLcmsAreOne = false;
+
+      // Scatter the scaled nonzeros of both rows into the output row; the
+      // eliminated column is skipped by shifting the trailing columns left.
+      std::fill(ineq.begin(), ineq.end(), 0);
+      for (auto l : nonZeroCols[ubPos])
+        ineq[l < pos ? l : l - 1] += atIneq(ubPos, l) * ubScale;
+      for (auto l : nonZeroCols[lbPos])
+        ineq[l < pos ? l : l - 1] += atIneq(lbPos, l) * lbScale;
       if (darkShadow) {
         // The dark shadow is a convex subset of the exact integer shadow. If
         // there is a point here, it proves the existence of a solution.
         ineq[ineq.size() - 1] += lbCoeff * ubCoeff - lbCoeff - ubCoeff + 1;
       }
-      // TODO: we need to have a way to add inequalities in-place in
-      // FlatAffineConstraints instead of creating and copying over.
-      newFac.addInequality(ineq);
+      if (!addedRows.count(ArrayRef<int64_t>(ineq))) {
+        // TODO: we need to have a way to add inequalities in-place in
+        // FlatAffineConstraints instead of creating and copying over.
+        newFac.addInequality(ineq);
+        addedRows.insert(newFac.getInequality(newFac.getNumInequalities() - 1));
+      }
     }
   }
 
-  LLVM_DEBUG(llvm::dbgs() << "FM isResultIntegerExact: " << (lcmProducts == 1)
+  LLVM_DEBUG(llvm::dbgs() << "FM isResultIntegerExact: " << allLcmsAreOne
                           << "\n");
-  if (lcmProducts == 1 && isResultIntegerExact)
+  if (allLcmsAreOne && isResultIntegerExact)
     *isResultIntegerExact = 1;
 
   // Copy over the constraints not involving this variable.
@@ -2545,7 +2858,7 @@ void FlatAffineConstraints::FourierMotzkinEliminate(
     newFac.addInequality(ineq);
   }
 
-  assert(newFac.getNumConstraints() ==
+  assert(newFac.getNumConstraints() <=
          lbIndices.size() * ubIndices.size() + nbIndices.size());
 
   // Copy over the equalities.
@@ -0,0 +1,134 @@
+//===- AliasAnalysis.cpp - MemRef alias analysis --------------------------===//
+//
+// Copyright 2019 The MLIR Authors.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+// =============================================================================
+//
+// This file implements the provenance-based alias analysis for memref values.
+//
+//===----------------------------------------------------------------------===//
+
+#include "mlir/Analysis/AliasAnalysis.h"
+#include "mlir/AffineOps/AffineOps.h"
+#include "mlir/IR/Function.h"
+#include "mlir/StandardOps/Ops.h"
+#include "llvm/ADT/SmallVector.h"
+
+using namespace mlir;
+
+Value *mlir::getUnderlyingMemRef(Value *memref) {
+  while (auto *defOp = memref->getDefiningOp()) {
+    auto castOp = dyn_cast<MemRefCastOp>(defOp);
+    if (!castOp)
+      break;
+    memref = castOp.getOperand();
+  }
+  return memref;
+}
+
+/// Returns true if 'user' only accesses the elements of its memref operands
+/// and does not retain or forward the memrefs themselves. The memref operand
+/// of any other operation - a call, a return, an unregistered operation - is
+/// considered to escape.
+static bool isAccessOnly(Operation *user) {
+  return isa<LoadOp>(user) || isa<StoreOp>(user) || isa<DeallocOp>(user) ||
+         isa<DmaStartOp>(user) || isa<DmaWaitOp>(user) ||
+         isa<AffineDmaStartOp>(user) || isa<AffineDmaWaitOp>(user);
+}
+
+/// Returns true if the storage of 'root' may become reachable through a value
+/// that does not derive from it, following the forwarding chains out of it.
+static bool mayEscape(Value *root) {
+  SmallVector<Value *, 4> worklist({root});
+  while (!worklist.empty()) {
+    Value *value = worklist.pop_back_val();
+    for (auto *user : value->getUsers()) {
+      if (isa<MemRefCastOp>(user)) {
+        worklist.push_back(user->getResult(0));
+        continue;
+      }
+      if (!isAccessOnly(user))
+        return true;
+    }
+  }
+  return false;
+}
+
+AliasAnalysis::AliasAnalysis(Function *function) : function(function) {
+  // Record up front which allocations escape; the per-query rules below may
+  // then treat the remaining ones as reachable only through their own
+  // forwarding chains.
+  function->walk<AllocOp>([&](AllocOp allocOp) {
+    if (mayEscape(allocOp.getResult()))
+      escapedAllocs.insert(allocOp.getResult());
+  });
+}
+
+bool AliasAnalysis::isNoAliasArgument(Value *value) {
+  auto *arg = dyn_cast<BlockArgument>(value);
+  if (!arg || arg->getOwner() != &function->front())
+    return false;
+  auto attr = function->getArgAttrOfType<BoolAttr>(arg->getArgNumber(),
+                                                   "noalias");
+  return attr && attr.getValue();
+}
+
+AliasResult AliasAnalysis::alias(Value *a, Value *b) {
+  auto key = a < b ? std::make_pair(a, b) : std::make_pair(b, a);
+  auto it = cache.find(key);
+  if (it != cache.end())
+    return it->second;
+  AliasResult result = aliasImpl(a, b);
+  cache.try_emplace(key, result);
+  return result;
+}
+
+AliasResult AliasAnalysis::aliasImpl(Value *a, Value *b) {
+  Value *underlyingA = getUnderlyingMemRef(a);
+  Value *underlyingB = getUnderlyingMemRef(b);
+
+  // The forwarding operations are whole-object views, so values with the
+  // same origin reference exactly the same memory.
+  if (underlyingA == underlyingB)
+    return AliasResult::MustAlias;
+
+  auto *defA = underlyingA->getDefiningOp();
+  auto *defB = underlyingB->getDefiningOp();
+  bool isAllocA = defA && isa<AllocOp>(defA);
+  bool isAllocB = defB && isa<AllocOp>(defB);
+  auto isFuncArgument = [&](Value *value) {
+    auto *arg = dyn_cast<BlockArgument>(value);
+    return arg && arg->getOwner() == &function->front();
+  };
+
+  // Two distinct allocations are disjoint, and an allocation is disjoint
+  // from any memref bound before it runs, such as a function argument.
+  if (isAllocA && (isAllocB || isFuncArgument(underlyingB)))
+    return AliasResult::NoAlias;
+  if (isAllocB && isFuncArgument(underlyingA))
+    return AliasResult::NoAlias;
+
+  // An allocation that does not escape cannot be reached through a value
+  // with unknown provenance either.
+  if ((isAllocA && !escapedAllocs.count(underlyingA)) ||
+      (isAllocB && !escapedAllocs.count(underlyingB)))
+    return AliasResult::NoAlias;
+
+  // Arguments the frontend annotated 'noalias' are not accessed through any
+  // value that does not derive from them.
+  if (isNoAliasArgument(underlyingA) || isNoAliasArgument(underlyingB))
+    return AliasResult::NoAlias;
+
+  return AliasResult::MayAlias;
+}
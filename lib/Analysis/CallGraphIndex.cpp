@@ -0,0 +1,128 @@
+//===- CallGraphIndex.cpp - Module-level function use index ---------------===//
+//
+// Copyright 2019 The MLIR Authors.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+// =============================================================================
+
+#include "mlir/Analysis/CallGraphIndex.h"
+#include "mlir/IR/Attributes.h"
+#include "mlir/IR/Function.h"
+#include "mlir/IR/Module.h"
+#include "llvm/ADT/SmallPtrSet.h"
+
+using namespace mlir;
+
+CallGraphIndex::CallGraphIndex(Module &module) : module(module) {
+  for (auto &func : module)
+    notifyAdded(&func);
+}
+
+/// Appends the functions referenced by the attributes of 'op' to 'refs'.
+void CallGraphIndex::resolveReferences(Operation *op,
+                                       SmallVectorImpl<Function *> &refs) {
+  // Resolves a single attribute, looking through one level of array
+  // aggregation. Function references are stored by name, so they are resolved
+  // through the module symbol table.
+  auto resolveAttr = [&](Attribute attr) {
+    if (auto fnAttr = attr.dyn_cast<FunctionAttr>())
+      if (auto *ref = module.getNamedFunction(fnAttr.getValue()))
+        refs.push_back(ref);
+  };
+  for (auto namedAttr : op->getAttrs()) {
+    if (auto arrayAttr = namedAttr.second.dyn_cast<ArrayAttr>()) {
+      for (auto elt : arrayAttr.getValue())
+        resolveAttr(elt);
+      continue;
+    }
+    resolveAttr(namedAttr.second);
+  }
+}
+
+ArrayRef<Operation *> CallGraphIndex::getUses(Function *func) const {
+  auto it = uses.find(func);
+  if (it == uses.end())
+    return llvm::None;
+  return it->second;
+}
+
+SmallVector<Function *, 8> CallGraphIndex::getCallees(Function *func) const {
+  SmallVector<Function *, 8> callees;
+  auto it = referencedFunctions.find(func);
+  if (it == referencedFunctions.end())
+    return callees;
+
+  llvm::SmallPtrSet<Function *, 8> seen;
+  for (auto *callee : it->second)
+    if (seen.insert(callee).second)
+      callees.push_back(callee);
+  return callees;
+}
+
+SmallVector<Function *, 8> CallGraphIndex::getCallers(Function *func) const {
+  SmallVector<Function *, 8> callers;
+  llvm::SmallPtrSet<Function *, 8> seen;
+  for (auto *use : getUses(func)) {
+    auto *caller = use->getFunction();
+    if (seen.insert(caller).second)
+      callers.push_back(caller);
+  }
+  return callers;
+}
+
+void CallGraphIndex::notifyAdded(Operation *op) {
+  SmallVector<Function *, 2> refs;
+  resolveReferences(op, refs);
+  if (refs.empty())
+    return;
+
+  auto &forward = referencedFunctions[op->getFunction()];
+  for (auto *ref : refs) {
+    uses[ref].push_back(op);
+    forward.push_back(ref);
+  }
+}
+
+void CallGraphIndex::notifyRemoved(Operation *op) {
+  SmallVector<Function *, 2> refs;
+  resolveReferences(op, refs);
+  if (refs.empty())
+    return;
+
+  // Remove one use and one forward entry per reference; an operation may
+  // reference the same function more than once.
+  auto &forward = referencedFunctions[op->getFunction()];
+  for (auto *ref : refs) {
+    auto &refUses = uses[ref];
+    auto useIt = std::find(refUses.begin(), refUses.end(), op);
+    assert(useIt != refUses.end() && "operation was not indexed");
+    refUses.erase(useIt);
+
+    auto fwdIt = std::find(forward.begin(), forward.end(), ref);
+    assert(fwdIt != forward.end() && "reference was not indexed");
+    forward.erase(fwdIt);
+  }
+}
+
+void CallGraphIndex::notifyAdded(Function *func) {
+  func->walk([&](Operation *op) { notifyAdded(op); });
+}
+
+void CallGraphIndex::notifyRemoved(Function *func) {
+  // Drop the references made from the body first, while the operations are
+  // still attached, then forget the function itself.
+  func->walk([&](Operation *op) { notifyRemoved(op); });
+  assert(getUses(func).empty() && "erased function still has uses");
+  uses.erase(func);
+  referencedFunctions.erase(func);
+}
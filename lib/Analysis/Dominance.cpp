@@ -43,6 +43,9 @@ void DominanceInfoBase<IsPostDom>::recalculate(Function *function) {
   // Build the top level function dominance.
   auto functionDominance = llvm::make_unique<base>();
   functionDominance->recalculate(function->getBody());
+  // Update the DFS in/out numbers eagerly so that dominance queries reduce to
+  // two integer compares instead of walking the tree.
+  functionDominance->updateDFSNumbers();
   dominanceInfos.try_emplace(&function->getBody(),
                              std::move(functionDominance));
 
@@ -54,6 +57,7 @@ void DominanceInfoBase<IsPostDom>::recalculate(Function *function) {
         continue;
       auto opDominance = llvm::make_unique<base>();
       opDominance->recalculate(region);
+      opDominance->updateDFSNumbers();
       dominanceInfos.try_emplace(&region, std::move(opDominance));
     }
   });
@@ -71,6 +75,7 @@ void DominanceInfoBase<IsPostDom>::recalculate(Operation *op) {
         continue;
       auto opDominance = llvm::make_unique<base>();
       opDominance->recalculate(region);
+      opDominance->updateDFSNumbers();
       dominanceInfos.try_emplace(&region, std::move(opDominance));
     }
   });
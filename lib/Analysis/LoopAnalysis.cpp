@@ -28,6 +28,7 @@
 #include "mlir/Analysis/VectorAnalysis.h"
 #include "mlir/IR/AffineMap.h"
 #include "mlir/IR/Builders.h"
+#include "mlir/IR/Function.h"
 #include "mlir/IR/Operation.h"
 #include "mlir/StandardOps/Ops.h"
 #include "mlir/Support/Functional.h"
@@ -106,21 +107,9 @@ void mlir::buildTripCountMapAndOperands(
     lb.erase();
 }
 
-/// Returns the trip count of the loop if it's a constant, None otherwise. This
-/// method uses affine expression analysis (in turn using getTripCount) and is
-/// able to determine constant trip count in non-trivial cases.
-// FIXME(mlir-team): this is really relying on buildTripCountMapAndOperands;
-// being an analysis utility, it shouldn't. Replace with a version that just
-// works with analysis structures (FlatAffineConstraints) and thus doesn't
-// update the IR.
-llvm::Optional<uint64_t> mlir::getConstantTripCount(AffineForOp forOp) {
-  SmallVector<Value *, 4> operands;
-  AffineMap map;
-  buildTripCountMapAndOperands(forOp, &map, &operands);
-
-  if (!map)
-    return None;
-
+/// Returns the constant trip count encoded by the given trip count map, or
+/// None if any of its results is non-constant. The map must be non-null.
+static Optional<uint64_t> getConstantTripCountFromMap(AffineMap map) {
   // Take the min if all trip counts are constant.
   Optional<uint64_t> tripCount;
   for (auto resultExpr : map.getResults()) {
@@ -136,17 +125,9 @@ llvm::Optional<uint64_t> mlir::getConstantTripCount(AffineForOp forOp) {
   return tripCount;
 }
 
-/// Returns the greatest known integral divisor of the trip count. Affine
-/// expression analysis is used (indirectly through getTripCount), and
-/// this method is thus able to determine non-trivial divisors.
-uint64_t mlir::getLargestDivisorOfTripCount(AffineForOp forOp) {
-  SmallVector<Value *, 4> operands;
-  AffineMap map;
-  buildTripCountMapAndOperands(forOp, &map, &operands);
-
-  if (!map)
-    return 1;
-
+/// Returns the greatest known integral divisor of the trip count encoded by
+/// the given trip count map. The map must be non-null.
+static uint64_t getLargestTripCountDivisorFromMap(AffineMap map) {
   // The largest divisor of the trip count is the GCD of the individual largest
   // divisors.
   assert(map.getNumResults() >= 1 && "expected one or more results");
@@ -174,6 +155,109 @@ uint64_t mlir::getLargestDivisorOfTripCount(AffineForOp forOp) {
   return gcd.getValue();
 }
 
+/// Returns the trip count of the loop if it's a constant, None otherwise. This
+/// method uses affine expression analysis (in turn using getTripCount) and is
+/// able to determine constant trip count in non-trivial cases.
+// FIXME(mlir-team): this is really relying on buildTripCountMapAndOperands;
+// being an analysis utility, it shouldn't. Replace with a version that just
+// works with analysis structures (FlatAffineConstraints) and thus doesn't
+// update the IR.
+llvm::Optional<uint64_t> mlir::getConstantTripCount(AffineForOp forOp) {
+  SmallVector<Value *, 4> operands;
+  AffineMap map;
+  buildTripCountMapAndOperands(forOp, &map, &operands);
+
+  if (!map)
+    return None;
+  return getConstantTripCountFromMap(map);
+}
+
+/// Returns the greatest known integral divisor of the trip count. Affine
+/// expression analysis is used (indirectly through getTripCount), and
+/// this method is thus able to determine non-trivial divisors.
+uint64_t mlir::getLargestDivisorOfTripCount(AffineForOp forOp) {
+  SmallVector<Value *, 4> operands;
+  AffineMap map;
+  buildTripCountMapAndOperands(forOp, &map, &operands);
+
+  if (!map)
+    return 1;
+  return getLargestTripCountDivisorFromMap(map);
+}
+
+const AffineForTripCountCache::Record &
+AffineForTripCountCache::getRecord(AffineForOp forOp) {
+  auto &record = records[forOp.getOperation()];
+  auto lbMap = forOp.getLowerBoundMap();
+  auto ubMap = forOp.getUpperBoundMap();
+  int64_t step = forOp.getStep();
+  // An existing record is reusable only if the bounds it was derived from are
+  // still in place; bound maps are uniqued so this is a pointer comparison.
+  if (record.lbMap == lbMap && record.ubMap == ubMap && record.step == step)
+    return record;
+
+  SmallVector<Value *, 4> operands;
+  AffineMap map;
+  buildTripCountMapAndOperands(forOp, &map, &operands);
+  record.lbMap = lbMap;
+  record.ubMap = ubMap;
+  record.step = step;
+  record.constantTripCount = map ? getConstantTripCountFromMap(map) : None;
+  record.largestDivisor = map ? getLargestTripCountDivisorFromMap(map) : 1;
+  return record;
+}
+
+llvm::Optional<uint64_t>
+AffineForTripCountCache::getConstantTripCount(AffineForOp forOp) {
+  return getRecord(forOp).constantTripCount;
+}
+
+uint64_t AffineForTripCountCache::getLargestDivisorOfTripCount(
+    AffineForOp forOp) {
+  return getRecord(forOp).largestDivisor;
+}
+
+void AffineForTripCountCache::invalidate(AffineForOp forOp) {
+  records.erase(forOp.getOperation());
+}
+
+/// Returns the estimated code size of `op` in units of target operations.
+/// Terminators generate no code; loads/stores lower to address arithmetic
+/// plus the access itself; an affine.apply expands to roughly one arithmetic
+/// op per map result node, approximated with a flat weight; loops add
+/// induction variable update, compare and branch.
+static uint64_t getApproximateOpWeight(Operation *op) {
+  if (isa<AffineTerminatorOp>(op))
+    return 0;
+  if (isa<LoadOp>(op) || isa<StoreOp>(op))
+    return 2;
+  if (isa<AffineApplyOp>(op))
+    return 2;
+  if (isa<AffineForOp>(op))
+    return 3;
+  return 1;
+}
+
+/// Returns a rough estimate of the code size of one iteration of this loop's
+/// body in units of target operations.
+uint64_t mlir::getApproximateBodyOpCount(AffineForOp forOp) {
+  uint64_t count = 0;
+  forOp.getOperation()->walk([&](Operation *op) {
+    // The loop itself isn't part of its body.
+    if (op != forOp.getOperation())
+      count += getApproximateOpWeight(op);
+  });
+  return count;
+}
+
+/// Returns a rough estimate of the code size of the body of `func` with the
+/// same per-op weights as getApproximateBodyOpCount.
+uint64_t mlir::getApproximateOpCount(Function &func) {
+  uint64_t count = 0;
+  func.walk([&](Operation *op) { count += getApproximateOpWeight(op); });
+  return count;
+}
+
 bool mlir::isAccessInvariant(Value *iv, Value *index) {
   assert(isForInductionVar(iv) && "iv must be a AffineForOp");
   assert(index->getType().isa<IndexType>() && "index must be of IndexType");
@@ -0,0 +1,247 @@
+//===- LoopNestCostModel.cpp - Loop nest memory cost model ----------------===//
+//
+// Copyright 2019 The MLIR Authors.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+// =============================================================================
+//
+// This file implements the memory cost model for affine loop nests. Each load
+// and store is summarized as its per-iteration byte stride along every
+// enclosing loop, derived from its flattened access map; footprints, cache
+// line traffic, and TLB page traffic are then computed from those stride
+// profiles alone.
+//
+//===----------------------------------------------------------------------===//
+
+#include "mlir/Analysis/LoopNestCostModel.h"
+#include "mlir/AffineOps/AffineOps.h"
+#include "mlir/Analysis/AffineAnalysis.h"
+#include "mlir/Analysis/AffineStructures.h"
+#include "mlir/Analysis/LoopAnalysis.h"
+#include "mlir/Analysis/Utils.h"
+#include "mlir/StandardOps/Ops.h"
+#include "llvm/Support/MathExtras.h"
+#include <cstdlib>
+
+#define DEBUG_TYPE "loop-nest-cost-model"
+
+using namespace mlir;
+
+MachineModel MachineModel::getDefault() {
+  MachineModel model;
+  model.cacheLevels.push_back({/*sizeBytes=*/32 * 1024,
+                               /*lineSizeBytes=*/64});
+  model.cacheLevels.push_back({/*sizeBytes=*/1024 * 1024,
+                               /*lineSizeBytes=*/64});
+  model.cacheLevels.push_back({/*sizeBytes=*/8 * 1024 * 1024,
+                               /*lineSizeBytes=*/64});
+  model.pageSizeBytes = 4096;
+  model.tlbEntries = 64;
+  return model;
+}
+
+namespace {
+
+/// One loop enclosing an access, with the constant trip count of the loop and
+/// the number of bytes the access's subscripts move per iteration of it.
+struct LoopStride {
+  Operation *loop;
+  uint64_t stride;
+  uint64_t trip;
+};
+
+/// The stride profile of one load or store in the nest.
+struct AccessProfile {
+  /// The loops from the nest root down to the access, outermost first.
+  SmallVector<LoopStride, 4> chain;
+  /// Size in bytes of one accessed element.
+  uint64_t eltSize;
+};
+
+} // end anonymous namespace
+
+/// Returns the number of distinct bytes the access sweeps when only the loops
+/// of its chain from position 'begin' inwards iterate. Zero-stride loops
+/// revisit the same bytes and contribute nothing; for the rest, processing
+/// strides in increasing order, a stride smaller than the bytes already
+/// spanned overlaps the span while a larger one replicates it.
+static uint64_t getDistinctBytes(const AccessProfile &profile, unsigned begin) {
+  SmallVector<std::pair<uint64_t, uint64_t>, 4> strides;
+  for (unsigned i = begin, e = profile.chain.size(); i != e; ++i)
+    if (profile.chain[i].stride != 0)
+      strides.push_back({profile.chain[i].stride, profile.chain[i].trip});
+  llvm::sort(strides);
+
+  uint64_t span = profile.eltSize;
+  for (const auto &st : strides)
+    span = st.first >= span ? st.second * span
+                            : span + (st.second - 1) * st.first;
+  return span;
+}
+
+/// Returns the number of blocks of 'blockSize' bytes fetched for the access
+/// by one execution of its chain, against a cache of 'capacityBytes'. Walking
+/// the chain from the innermost loop out: a loop the access is invariant to
+/// re-fetches the inner blocks each iteration only if the bytes its body
+/// touches exceed the capacity (the reuse distance of the loop-carried
+/// reuse); a loop striding a full block or more fetches fresh blocks every
+/// iteration; and a loop striding less than a block sweeps contiguously, so
+/// it fetches the swept bytes' worth of blocks.
+static uint64_t
+getBlocksAccessed(const AccessProfile &profile,
+                  const llvm::DenseMap<Operation *, uint64_t> &bodyBytes,
+                  uint64_t blockSize, uint64_t capacityBytes) {
+  uint64_t blocks = 1;
+  for (int i = profile.chain.size() - 1; i >= 0; --i) {
+    const LoopStride &ls = profile.chain[i];
+    if (ls.stride == 0) {
+      if (bodyBytes.lookup(ls.loop) > capacityBytes)
+        blocks *= ls.trip;
+    } else if (ls.stride >= blockSize) {
+      blocks *= ls.trip;
+    } else {
+      blocks =
+          std::max(blocks, llvm::divideCeil(ls.trip * ls.stride, blockSize));
+    }
+  }
+  return blocks;
+}
+
+/// Builds the stride profile of the access at 'opInst' relative to the nest
+/// rooted at 'root'. Returns None when the access is not analyzable: the
+/// memref has a dynamic shape or a non-identity layout, a subscript is
+/// semi-affine or uses mod/div, or an enclosing loop has a non-constant trip
+/// count.
+static Optional<AccessProfile> buildAccessProfile(Operation *opInst,
+                                                  AffineForOp root) {
+  MemRefAccess access(opInst);
+  auto memRefType = access.memref->getType().cast<MemRefType>();
+  if (!memRefType.hasStaticShape() || !memRefType.getAffineMaps().empty())
+    return None;
+
+  AccessProfile profile;
+  profile.eltSize = getMemRefEltSizeInBytes(memRefType);
+
+  // Row-major byte stride of each memref dimension.
+  unsigned rank = memRefType.getRank();
+  SmallVector<int64_t, 4> dimStrides(rank);
+  int64_t running = profile.eltSize;
+  for (int r = rank - 1; r >= 0; --r) {
+    dimStrides[r] = running;
+    running *= memRefType.getDimSize(r);
+  }
+
+  // The subscripts as an affine function of the surrounding IVs and symbols.
+  AffineValueMap accessMap;
+  access.getAccessMap(&accessMap);
+  std::vector<SmallVector<int64_t, 8>> flatExprs;
+  if (failed(getFlattenedAffineExprs(accessMap.getAffineMap(), &flatExprs)))
+    return None;
+  unsigned numDims = accessMap.getNumDims();
+  unsigned numSymbols = accessMap.getNumSymbols();
+  // Local identifiers stand for mod's and div's of the IVs; a subscript using
+  // one doesn't move by a fixed stride per loop iteration.
+  for (const auto &flatExpr : flatExprs)
+    for (unsigned i = numDims + numSymbols, e = flatExpr.size() - 1; i != e;
+         ++i)
+      if (flatExpr[i] != 0)
+        return None;
+
+  // The loops from the nest root down to the access.
+  SmallVector<AffineForOp, 4> loops;
+  getLoopIVs(*opInst, &loops);
+  unsigned rootPos = 0;
+  while (rootPos != loops.size() &&
+         loops[rootPos].getOperation() != root.getOperation())
+    ++rootPos;
+  assert(rootPos != loops.size() && "access not nested under the root");
+
+  for (unsigned i = rootPos, e = loops.size(); i != e; ++i) {
+    AffineForOp loop = loops[i];
+    Optional<uint64_t> trip = getConstantTripCount(loop);
+    if (!trip.hasValue())
+      return None;
+    // Accumulate the byte distance the subscripts move per iteration of this
+    // loop across the memref dimensions.
+    int64_t stride = 0;
+    for (unsigned d = 0; d != numDims; ++d) {
+      if (accessMap.getOperand(d) != loop.getInductionVar())
+        continue;
+      for (unsigned r = 0; r != rank; ++r)
+        stride += flatExprs[r][d] * dimStrides[r];
+    }
+    stride = std::abs(stride) * loop.getStep();
+    profile.chain.push_back(
+        {loop.getOperation(), static_cast<uint64_t>(stride), trip.getValue()});
+  }
+  return profile;
+}
+
+/// Evaluates the cost of the nest rooted at 'root' against 'machine'.
+static Optional<LoopNestCost> computeCost(AffineForOp root,
+                                          const MachineModel &machine) {
+  // Profile every load and store in the nest; a single unanalyzable access
+  // makes the whole nest unanalyzable.
+  SmallVector<AccessProfile, 8> profiles;
+  bool analyzable = true;
+  root.getOperation()->walk([&](Operation *opInst) {
+    if (!isa<LoadOp>(opInst) && !isa<StoreOp>(opInst))
+      return;
+    if (auto profile = buildAccessProfile(opInst, root))
+      profiles.push_back(std::move(profile.getValue()));
+    else
+      analyzable = false;
+  });
+  if (!analyzable)
+    return None;
+
+  // Bytes touched by one iteration of each loop's body: for every access
+  // under the loop, the distinct bytes the part of its chain strictly inside
+  // the loop sweeps. This is the reuse distance an access invariant to the
+  // loop has to survive for its loop-carried reuse to be realized.
+  llvm::DenseMap<Operation *, uint64_t> bodyBytes;
+  for (const auto &profile : profiles)
+    for (unsigned i = 0, e = profile.chain.size(); i != e; ++i)
+      bodyBytes[profile.chain[i].loop] += getDistinctBytes(profile, i + 1);
+
+  LoopNestCost cost;
+  cost.footprintBytes = 0;
+  for (const auto &profile : profiles)
+    cost.footprintBytes += getDistinctBytes(profile, /*begin=*/0);
+
+  for (const auto &level : machine.cacheLevels) {
+    uint64_t lines = 0;
+    for (const auto &profile : profiles)
+      lines += getBlocksAccessed(profile, bodyBytes, level.lineSizeBytes,
+                                 level.sizeBytes);
+    cost.cacheLinesAccessed.push_back(lines);
+  }
+
+  cost.tlbPagesAccessed = 0;
+  for (const auto &profile : profiles)
+    cost.tlbPagesAccessed +=
+        getBlocksAccessed(profile, bodyBytes, machine.pageSizeBytes,
+                          machine.tlbEntries * machine.pageSizeBytes);
+  return cost;
+}
+
+LoopNestCostModel::LoopNestCostModel(Function *)
+    : machine(MachineModel::getDefault()) {}
+
+const LoopNestCost *LoopNestCostModel::getCost(AffineForOp root) {
+  auto it = costs.find(root.getOperation());
+  if (it == costs.end())
+    it = costs.try_emplace(root.getOperation(), computeCost(root, machine))
+             .first;
+  return it->second.hasValue() ? it->second.getPointer() : nullptr;
+}
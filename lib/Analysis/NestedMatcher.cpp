@@ -50,7 +50,11 @@ llvm::BumpPtrAllocator *&NestedPattern::allocator() {
 
 NestedPattern::NestedPattern(ArrayRef<NestedPattern> nested,
                              FilterFunctionType filter)
-    : nestedPatterns(), filter(filter), skip(nullptr) {
+    : NestedPattern(nested, /*kindName=*/StringRef(), filter) {}
+
+NestedPattern::NestedPattern(ArrayRef<NestedPattern> nested,
+                             StringRef kindName, FilterFunctionType filter)
+    : nestedPatterns(), kindName(kindName), filter(filter), skip(nullptr) {
   if (!nested.empty()) {
     auto *newNested = allocator()->Allocate<NestedPattern>(nested.size());
     std::uninitialized_copy(nested.begin(), nested.end(), newNested);
@@ -84,6 +88,11 @@ void NestedPattern::matchOne(Operation *op,
   if (skip == op) {
     return;
   }
+  // Kind pre-filter; a plain name comparison is much cheaper than invoking
+  // the custom std::function filter below.
+  if (!kindName.empty() && op->getName().getStringRef() != kindName) {
+    return;
+  }
   // Local custom filter function
   if (!filter(*op)) {
     return;
@@ -110,10 +119,6 @@ void NestedPattern::matchOne(Operation *op,
   }
 }
 
-static bool isAffineForOp(Operation &op) { return isa<AffineForOp>(op); }
-
-static bool isAffineIfOp(Operation &op) { return isa<AffineIfOp>(op); }
-
 namespace mlir {
 namespace matcher {
 
@@ -122,35 +127,29 @@ NestedPattern Op(FilterFunctionType filter) {
 }
 
 NestedPattern If(NestedPattern child) {
-  return NestedPattern(child, isAffineIfOp);
+  return NestedPattern(child, AffineIfOp::getOperationName());
 }
 NestedPattern If(FilterFunctionType filter, NestedPattern child) {
-  return NestedPattern(child, [filter](Operation &op) {
-    return isAffineIfOp(op) && filter(op);
-  });
+  return NestedPattern(child, AffineIfOp::getOperationName(), filter);
 }
 NestedPattern If(ArrayRef<NestedPattern> nested) {
-  return NestedPattern(nested, isAffineIfOp);
+  return NestedPattern(nested, AffineIfOp::getOperationName());
 }
 NestedPattern If(FilterFunctionType filter, ArrayRef<NestedPattern> nested) {
-  return NestedPattern(nested, [filter](Operation &op) {
-    return isAffineIfOp(op) && filter(op);
-  });
+  return NestedPattern(nested, AffineIfOp::getOperationName(), filter);
 }
 
 NestedPattern For(NestedPattern child) {
-  return NestedPattern(child, isAffineForOp);
+  return NestedPattern(child, AffineForOp::getOperationName());
 }
 NestedPattern For(FilterFunctionType filter, NestedPattern child) {
-  return NestedPattern(
-      child, [=](Operation &op) { return isAffineForOp(op) && filter(op); });
+  return NestedPattern(child, AffineForOp::getOperationName(), filter);
 }
 NestedPattern For(ArrayRef<NestedPattern> nested) {
-  return NestedPattern(nested, isAffineForOp);
+  return NestedPattern(nested, AffineForOp::getOperationName());
 }
 NestedPattern For(FilterFunctionType filter, ArrayRef<NestedPattern> nested) {
-  return NestedPattern(
-      nested, [=](Operation &op) { return isAffineForOp(op) && filter(op); });
+  return NestedPattern(nested, AffineForOp::getOperationName(), filter);
 }
 
 bool isLoadOrStore(Operation &op) {
@@ -20,11 +20,18 @@
 #include "mlir/IR/OperationSupport.h"
 #include "mlir/Pass/Pass.h"
 #include "llvm/ADT/DenseMap.h"
+#include "llvm/Support/CommandLine.h"
 #include "llvm/Support/Format.h"
 #include "llvm/Support/raw_ostream.h"
 
 using namespace mlir;
 
+static llvm::cl::opt<unsigned> clOpStatsSampleRate(
+    "print-op-stats-sample-rate",
+    llvm::cl::desc("Only count the operations of every Nth block and "
+                   "extrapolate the totals (1 counts everything)"),
+    llvm::cl::init(1));
+
 namespace {
 struct PrintOpStatsPass : public ModulePass<PrintOpStatsPass> {
   explicit PrintOpStatsPass(llvm::raw_ostream &os = llvm::errs()) : os(os) {}
@@ -32,8 +39,15 @@ struct PrintOpStatsPass : public ModulePass<PrintOpStatsPass> {
   // Prints the resultant operation statistics post iterating over the module.
   void runOnModule() override;
 
+  // This pass only counts operations and never touches the IR.
+  bool isReadOnly() const override { return true; }
+
+  // Compute sampled operation statistics, counting every 'sampleRate'th block
+  // and scaling the counts by the fraction of blocks visited.
+  void computeSampled(unsigned sampleRate);
+
   // Print summary of op stats.
-  void printSummary();
+  void printSummary(unsigned sampleRate);
 
 private:
   llvm::StringMap<int64_t> opCount;
@@ -44,14 +58,58 @@ private:
 void PrintOpStatsPass::runOnModule() {
   opCount.clear();
 
-  // Compute the operation statistics for each function in the module.
+  unsigned sampleRate = std::max(1u, clOpStatsSampleRate.getValue());
+  if (sampleRate == 1) {
+    // Compute the operation statistics for each function in the module. This
+    // pass is read-only, so iterate the packed traversal snapshot instead of
+    // chasing the block lists.
+    for (auto &fn : getModule())
+      for (Operation *op : fn.getWalkSnapshot())
+        ++opCount[op->getName().getStringRef()];
+  } else {
+    computeSampled(sampleRate);
+  }
+  printSummary(sampleRate);
+  markAllAnalysesPreserved();
+}
+
+void PrintOpStatsPass::computeSampled(unsigned sampleRate) {
+  // Operations in skipped blocks are still traversed to discover their nested
+  // blocks, but skipping the histogram update is where most of the time goes
+  // on huge modules.
+  int64_t numBlocks = 0, numSampledBlocks = 0;
+  SmallVector<Block *, 32> worklist;
   for (auto &fn : getModule())
-    fn.walk([&](Operation *op) { ++opCount[op->getName().getStringRef()]; });
-  printSummary();
+    for (auto &block : fn.getBlocks())
+      worklist.push_back(&block);
+
+  while (!worklist.empty()) {
+    Block *block = worklist.pop_back_val();
+    bool isSampled = (numBlocks++ % sampleRate) == 0;
+    numSampledBlocks += isSampled;
+    for (auto &op : *block) {
+      if (isSampled)
+        ++opCount[op.getName().getStringRef()];
+      for (auto &region : op.getRegions())
+        for (auto &nested : region)
+          worklist.push_back(&nested);
+    }
+  }
+
+  // Extrapolate the sampled counts to the full module.
+  if (numSampledBlocks != 0 && numSampledBlocks != numBlocks) {
+    double scale = double(numBlocks) / double(numSampledBlocks);
+    for (auto &entry : opCount)
+      entry.second = static_cast<int64_t>(entry.second * scale + 0.5);
+  }
 }
 
-void PrintOpStatsPass::printSummary() {
-  os << "Operations encountered:\n";
+void PrintOpStatsPass::printSummary(unsigned sampleRate) {
+  if (sampleRate == 1)
+    os << "Operations encountered:\n";
+  else
+    os << "Operations encountered (extrapolated from 1/" << sampleRate
+       << " blocks):\n";
   os << "-----------------------\n";
   SmallVector<StringRef, 64> sorted(opCount.keys());
   llvm::sort(sorted);
@@ -0,0 +1,86 @@
+//===- TestAliasAnalysis.cpp - Test alias analysis ------------------------===//
+//
+// Copyright 2019 The MLIR Authors.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+// =============================================================================
+//
+// This file implements a pass to run pair-wise alias queries between the
+// memrefs accessed in a function.
+//
+//===----------------------------------------------------------------------===//
+
+#include "mlir/Analysis/AliasAnalysis.h"
+#include "mlir/Analysis/Passes.h"
+#include "mlir/Pass/Pass.h"
+#include "mlir/StandardOps/Ops.h"
+
+#define DEBUG_TYPE "test-alias-analysis"
+
+using namespace mlir;
+
+namespace {
+
+/// Queries the alias relation between the memrefs of all pairs of load and
+/// store operations in a function and emits the results as remarks.
+struct TestAliasAnalysis : public FunctionPass<TestAliasAnalysis> {
+  void runOnFunction() override;
+};
+
+} // end anonymous namespace
+
+FunctionPassBase *mlir::createTestAliasAnalysisPass() {
+  return new TestAliasAnalysis();
+}
+
+static StringRef getResultStr(AliasResult result) {
+  switch (result) {
+  case AliasResult::NoAlias:
+    return "NoAlias";
+  case AliasResult::MayAlias:
+    return "MayAlias";
+  case AliasResult::MustAlias:
+    return "MustAlias";
+  }
+  llvm_unreachable("unknown alias result");
+}
+
+void TestAliasAnalysis::runOnFunction() {
+  auto &aliasAnalysis = getAnalysis<AliasAnalysis>();
+
+  // Collect the loads and stores within the function.
+  SmallVector<Operation *, 8> loadsAndStores;
+  getFunction().walk([&](Operation *op) {
+    if (isa<LoadOp>(op) || isa<StoreOp>(op))
+      loadsAndStores.push_back(op);
+  });
+
+  auto getMemRef = [](Operation *op) {
+    if (auto loadOp = dyn_cast<LoadOp>(op))
+      return loadOp.getMemRef();
+    return cast<StoreOp>(op).getMemRef();
+  };
+
+  // Emit the result of the alias query between each pair of accesses as a
+  // remark on the first access.
+  for (unsigned i = 0, e = loadsAndStores.size(); i != e; ++i)
+    for (unsigned j = i + 1; j != e; ++j)
+      loadsAndStores[i]->emitRemark("alias from ")
+          << i << " to " << j << " = "
+          << getResultStr(aliasAnalysis.alias(getMemRef(loadsAndStores[i]),
+                                              getMemRef(loadsAndStores[j])));
+}
+
+static PassRegistration<TestAliasAnalysis>
+    pass("test-alias-analysis",
+         "Checks aliasing between all pairs of memref accesses.");
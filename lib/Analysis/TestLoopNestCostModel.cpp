@@ -0,0 +1,72 @@
+//===- TestLoopNestCostModel.cpp - Test loop nest cost model --------------===//
+//
+// Copyright 2019 The MLIR Authors.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+// =============================================================================
+//
+// This file implements a pass to run the loop nest cost model on the
+// outermost loop nests of a function and emit the results as remarks.
+//
+//===----------------------------------------------------------------------===//
+
+#include "mlir/AffineOps/AffineOps.h"
+#include "mlir/Analysis/LoopNestCostModel.h"
+#include "mlir/Analysis/Passes.h"
+#include "mlir/Analysis/Utils.h"
+#include "mlir/Pass/Pass.h"
+#include "llvm/Support/raw_ostream.h"
+
+#define DEBUG_TYPE "test-loop-nest-cost-model"
+
+using namespace mlir;
+
+namespace {
+
+/// Evaluates the cost model on each outermost loop nest and emits the
+/// estimates as a remark on the nest's root.
+struct TestLoopNestCostModel : public FunctionPass<TestLoopNestCostModel> {
+  void runOnFunction() override;
+};
+
+} // end anonymous namespace
+
+FunctionPassBase *mlir::createTestLoopNestCostModelPass() {
+  return new TestLoopNestCostModel();
+}
+
+void TestLoopNestCostModel::runOnFunction() {
+  auto &costModel = getAnalysis<LoopNestCostModel>();
+
+  getFunction().walk<AffineForOp>([&](AffineForOp forOp) {
+    if (getNestingDepth(*forOp.getOperation()) != 0)
+      return;
+    const LoopNestCost *cost = costModel.getCost(forOp);
+    if (!cost) {
+      forOp.emitRemark("unable to analyze loop nest");
+      return;
+    }
+    std::string str;
+    llvm::raw_string_ostream os(str);
+    os << "footprint = " << cost->footprintBytes
+       << " bytes, cache lines accessed = [";
+    for (unsigned i = 0, e = cost->cacheLinesAccessed.size(); i != e; ++i)
+      os << (i == 0 ? "" : ", ") << cost->cacheLinesAccessed[i];
+    os << "], tlb pages accessed = " << cost->tlbPagesAccessed;
+    forOp.emitRemark(os.str());
+  });
+}
+
+static PassRegistration<TestLoopNestCostModel>
+    pass("test-loop-nest-cost-model",
+         "Emit the cost model estimates for the outermost loop nests.");
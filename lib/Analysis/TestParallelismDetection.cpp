@@ -46,8 +46,13 @@ void TestParallelismDetection::runOnFunction() {
   Function &f = getFunction();
   OpBuilder b(f.getBody());
   f.walk<AffineForOp>([&](AffineForOp forOp) {
-    if (isLoopParallel(forOp))
+    SmallVector<LoopReduction, 2> reductions;
+    if (!isLoopParallel(forOp, &reductions))
+      return;
+    if (reductions.empty())
       forOp.emitRemark("parallel loop");
+    else
+      forOp.emitRemark("parallel loop with reduction");
   });
 }
 
@@ -26,10 +26,13 @@
 #include "mlir/Analysis/AffineAnalysis.h"
 #include "mlir/Analysis/AffineStructures.h"
 #include "mlir/IR/Builders.h"
+#include "mlir/IR/Function.h"
 #include "mlir/StandardOps/Ops.h"
 #include "llvm/ADT/DenseMap.h"
+#include "llvm/ADT/STLExtras.h"
 #include "llvm/ADT/SmallPtrSet.h"
 #include "llvm/Support/Debug.h"
+#include "llvm/Support/Mutex.h"
 #include "llvm/Support/raw_ostream.h"
 
 #define DEBUG_TYPE "analysis-utils"
@@ -319,8 +322,59 @@ LogicalResult MemRefRegion::compute(Operation *op, unsigned loopDepth,
   return success();
 }
 
+LogicalResult MemRefRegionCache::compute(MemRefRegion *region, Operation *op,
+                                         unsigned loopDepth,
+                                         bool addMemRefDimBounds) {
+  MemRefAccess access(op);
+
+  // Rank 0 regions are trivial to build; don't memoize them.
+  if (access.getRank() == 0)
+    return region->compute(op, loopDepth, /*sliceState=*/nullptr,
+                           addMemRefDimBounds);
+
+  AffineValueMap accessValueMap;
+  access.getAccessMap(&accessValueMap);
+
+  // Two accesses produce the same constraint system iff they share the access
+  // map, its operands, and the enclosing loops the region is symbolic in -
+  // the loop domains added by compute() are reachable from those values.
+  SmallVector<Value *, 8> keyValues;
+  keyValues.reserve(accessValueMap.getNumOperands() + loopDepth);
+  for (unsigned i = 0, e = accessValueMap.getNumOperands(); i < e; ++i)
+    keyValues.push_back(accessValueMap.getOperand(i));
+  SmallVector<AffineForOp, 4> enclosingIVs;
+  getLoopIVs(*op, &enclosingIVs);
+  assert(loopDepth <= enclosingIVs.size() && "invalid loop depth");
+  enclosingIVs.resize(loopDepth);
+  for (auto forOp : enclosingIVs)
+    keyValues.push_back(forOp.getInductionVar());
+
+  auto &bucket =
+      entries[std::make_pair(accessValueMap.getAffineMap(), access.memref)];
+  for (auto &entry : bucket) {
+    if (entry.loopDepth != loopDepth ||
+        entry.addMemRefDimBounds != addMemRefDimBounds ||
+        entry.keyValues != keyValues)
+      continue;
+    // Rebuild the region from the memoized constraint system. Whether the
+    // region is a write depends only on this op.
+    region->memref = access.memref;
+    region->write = access.isStore();
+    region->cst.clearAndCopyFrom(entry.cst);
+    return success();
+  }
+
+  // Miss: compute the region and memoize the result on success.
+  if (failed(region->compute(op, loopDepth, /*sliceState=*/nullptr,
+                             addMemRefDimBounds)))
+    return failure();
+  bucket.push_back(
+      {std::move(keyValues), loopDepth, addMemRefDimBounds, region->cst});
+  return success();
+}
+
 //  TODO(mlir-team): improve/complete this when we have target data.
-static unsigned getMemRefEltSizeInBytes(MemRefType memRefType) {
+unsigned mlir::getMemRefEltSizeInBytes(MemRefType memRefType) {
   auto elementType = memRefType.getElementType();
 
   unsigned sizeInBits;
@@ -694,7 +748,7 @@ const char *const kSliceFusionBarrierAttrName = "slice_fusion_barrier";
 // 'dependenceConstraints' at depth greater than 'loopDepth', and computes slice
 // bounds in 'sliceState' which represent the one loop nest's IVs in terms of
 // the other loop nest's IVs, symbols and constants (using 'isBackwardsSlice').
-void mlir::getComputationSliceState(
+static void getComputationSliceStateImpl(
     Operation *depSourceOp, Operation *depSinkOp,
     FlatAffineConstraints *dependenceConstraints, unsigned loopDepth,
     bool isBackwardSlice, ComputationSliceState *sliceState) {
@@ -778,6 +832,98 @@ void mlir::getComputationSliceState(
   }
 }
 
+namespace {
+/// A cache interning computed computation-slice bounds. LoopFusion's
+/// profitability analysis unions the slices of one producer against every
+/// consumer load at every candidate destination depth, then re-derives the
+/// slice for the chosen depth in canFuseLoops; with multiple consumers the
+/// same (source op, sink op, depth) bounds are recomputed many times over.
+/// Entries record the body modification count of the enclosing function, so
+/// any tracked mutation of the function invalidates them.
+struct ComputationSliceCache {
+  struct Entry {
+    unsigned loopDepth;
+    bool isBackwardSlice;
+    uint64_t modificationCount;
+    ComputationSliceState sliceState;
+  };
+
+  /// The entries for each (source, sink) operation pair. The per-pair lists
+  /// stay small: one entry per queried depth and direction.
+  DenseMap<std::pair<Operation *, Operation *>, SmallVector<Entry, 2>> entries;
+
+  /// Guards 'entries'; function passes may compute slices from multiple
+  /// threads.
+  llvm::sys::SmartMutex<true> mutex;
+
+  /// A size cap after which the cache is dropped wholesale, to bound the
+  /// memory held on behalf of functions that were long since processed.
+  enum { MaxNumCachedPairs = 1024 };
+};
+} // end anonymous namespace
+
+static ComputationSliceCache &getComputationSliceCache() {
+  static ComputationSliceCache cache;
+  return cache;
+}
+
+/// Interning wrapper around the slice bound computation above. Note that on a
+/// cache hit 'dependenceConstraints' is left untouched; callers must not rely
+/// on the projection the underlying computation performs on it.
+void mlir::getComputationSliceState(
+    Operation *depSourceOp, Operation *depSinkOp,
+    FlatAffineConstraints *dependenceConstraints, unsigned loopDepth,
+    bool isBackwardSlice, ComputationSliceState *sliceState) {
+  Function *function = depSourceOp->getFunction();
+  if (!function) {
+    getComputationSliceStateImpl(depSourceOp, depSinkOp, dependenceConstraints,
+                                 loopDepth, isBackwardSlice, sliceState);
+    return;
+  }
+
+  // Look for cached bounds computed for the current state of the function.
+  auto &cache = getComputationSliceCache();
+  uint64_t modificationCount = function->getBodyModificationCount();
+  auto key = std::make_pair(depSourceOp, depSinkOp);
+  {
+    llvm::sys::SmartScopedLock<true> lock(cache.mutex);
+    auto it = cache.entries.find(key);
+    if (it != cache.entries.end()) {
+      for (auto &entry : it->second) {
+        if (entry.loopDepth != loopDepth ||
+            entry.isBackwardSlice != isBackwardSlice ||
+            entry.modificationCount != modificationCount)
+          continue;
+        *sliceState = entry.sliceState;
+        return;
+      }
+    }
+  }
+
+  // Compute the bounds and populate the cache.
+  getComputationSliceStateImpl(depSourceOp, depSinkOp, dependenceConstraints,
+                               loopDepth, isBackwardSlice, sliceState);
+
+  ComputationSliceCache::Entry entry;
+  entry.loopDepth = loopDepth;
+  entry.isBackwardSlice = isBackwardSlice;
+  entry.modificationCount = modificationCount;
+  entry.sliceState = *sliceState;
+  {
+    llvm::sys::SmartScopedLock<true> lock(cache.mutex);
+    if (cache.entries.size() >= ComputationSliceCache::MaxNumCachedPairs)
+      cache.entries.clear();
+    auto &pairEntries = cache.entries[key];
+    // Drop entries stale under the current modification count while here.
+    llvm::erase_if(pairEntries, [&](const ComputationSliceCache::Entry &e) {
+      return e.modificationCount != modificationCount ||
+             (e.loopDepth == loopDepth &&
+              e.isBackwardSlice == isBackwardSlice);
+    });
+    pairEntries.push_back(std::move(entry));
+  }
+}
+
 /// Creates a computation slice of the loop nest surrounding 'srcOpInst',
 /// updates the slice loop bounds with any non-null bound maps specified in
 /// 'sliceState', and inserts this slice into the loop nest surrounding
@@ -910,6 +1056,7 @@ static Optional<int64_t> getMemoryFootprintBytes(Block &block,
                                                  Block::iterator end,
                                                  int memorySpace) {
   SmallDenseMap<Value *, std::unique_ptr<MemRefRegion>, 4> regions;
+  MemRefRegionCache regionCache;
 
   // Walk this 'affine.for' operation to gather all memory regions.
   bool error = false;
@@ -921,9 +1068,9 @@ static Optional<int64_t> getMemoryFootprintBytes(Block &block,
 
     // Compute the memref region symbolic in any IVs enclosing this block.
     auto region = llvm::make_unique<MemRefRegion>(opInst->getLoc());
-    if (failed(
-            region->compute(opInst,
-                            /*loopDepth=*/getNestingDepth(*block.begin())))) {
+    if (failed(regionCache.compute(
+            region.get(), opInst,
+            /*loopDepth=*/getNestingDepth(*block.begin())))) {
       opInst->emitError("Error obtaining memory region\n");
       error = true;
       return;
@@ -972,8 +1119,67 @@ void mlir::getSequentialLoops(
   });
 }
 
+/// Classifies 'op' as a supported reduction combiner, if it is one.
+static Optional<LoopReduction::Kind> getReductionKind(Operation *op) {
+  if (isa<AddFOp>(op))
+    return LoopReduction::Kind::AddF;
+  if (isa<MulFOp>(op))
+    return LoopReduction::Kind::MulF;
+  if (isa<AddIOp>(op))
+    return LoopReduction::Kind::AddI;
+  if (isa<MulIOp>(op))
+    return LoopReduction::Kind::MulI;
+  return None;
+}
+
+/// Returns a descriptor for the loop-carried value at position 'pos' of
+/// 'forOp' if its per-iteration update is a chain of operations of one
+/// supported associative and commutative kind, with every link of the chain
+/// used exactly once. Such a value can be computed as partial results over
+/// disjoint chunks of the iteration space that are combined afterwards.
+static Optional<LoopReduction> getSupportedReduction(AffineForOp forOp,
+                                                     unsigned pos) {
+  Value *arg = forOp.getRegionIterArgs()[pos];
+  Operation *terminator = forOp.getBody()->getTerminator();
+  Value *next = terminator->getOperand(pos);
+  if (next == arg)
+    return None;
+
+  // Follow the single-use chain of combining operations from the carried
+  // argument to the value handed to the terminator; a second use of any link
+  // would observe a partial result that chunked execution does not produce.
+  Optional<LoopReduction::Kind> kind;
+  Value *value = arg;
+  while (value != next) {
+    if (!value->hasOneUse())
+      return None;
+    Operation *user = value->use_begin()->getOwner();
+    auto userKind = getReductionKind(user);
+    if (!userKind || (kind && *userKind != *kind))
+      return None;
+    kind = userKind;
+    value = user->getResult(0);
+  }
+  if (!next->hasOneUse() || next->use_begin()->getOwner() != terminator)
+    return None;
+  return LoopReduction{*kind, pos};
+}
+
 /// Returns true if 'forOp' is parallel.
-bool mlir::isLoopParallel(AffineForOp forOp) {
+bool mlir::isLoopParallel(AffineForOp forOp,
+                          SmallVectorImpl<LoopReduction> *parallelReductions) {
+  // Loop-carried values are cross-iteration dependences; they are only
+  // acceptable when the caller can handle them as reductions.
+  unsigned numIterArgs = forOp.getNumIterOperands();
+  if (numIterArgs > 0 && !parallelReductions)
+    return false;
+  for (unsigned i = 0; i < numIterArgs; ++i) {
+    auto reduction = getSupportedReduction(forOp, i);
+    if (!reduction.hasValue())
+      return false;
+    parallelReductions->push_back(reduction.getValue());
+  }
+
   // Collect all load and store ops in loop nest rooted at 'forOp'.
   SmallVector<Operation *, 8> loadAndStoreOpInsts;
   forOp.getOperation()->walk([&](Operation *opInst) {
@@ -352,8 +352,18 @@ LogicalResult Function::verify() {
       return emitError("type of argument #")
              << i << " must match corresponding argument in function signature";
 
+  // Skip re-walking the body if it has not changed since it last passed
+  // verification; the signature and attribute checks above are cheap and are
+  // always re-run. This keeps per-pass verification affordable in pipelines
+  // where most passes leave most functions untouched.
+  if (isBodyVerified())
+    return success();
+
   // Finally, verify the body of the function.
-  return opVerifier.verify(*this);
+  if (failed(opVerifier.verify(*this)))
+    return failure();
+  markBodyVerified();
+  return success();
 }
 
 /// Perform (potentially expensive) checks of invariants, used to detect
@@ -23,10 +23,12 @@
 
 #include "mlir/Conversion/AffineToGPU/AffineToGPU.h"
 #include "mlir/AffineOps/AffineOps.h"
+#include "mlir/Analysis/LoopAnalysis.h"
 #include "mlir/GPU/GPUDialect.h"
 #include "mlir/IR/AffineExpr.h"
 #include "mlir/IR/Builders.h"
 #include "mlir/StandardOps/Ops.h"
+#include "mlir/Transforms/LoopUtils.h"
 #include "mlir/Transforms/LowerAffine.h"
 #include "mlir/Transforms/RegionUtils.h"
 
@@ -51,6 +53,90 @@ static Value *getDim3Value(const gpu::KernelDim3 &dim3, unsigned pos) {
   return nullptr;
 }
 
+/// Returns true if the access performed by `memoryOp` is contiguous along
+/// `iv`: the innermost subscript varies with `iv` while all other subscripts
+/// are invariant in it.  Strides are not checked, mirroring the vectorizer's
+/// contiguity analysis.
+template <typename LoadOrStoreOp>
+static bool isContiguousAlongIv(Value *iv, LoadOrStoreOp memoryOp) {
+  auto indices = memoryOp.getIndices();
+  unsigned numIndices = llvm::size(indices);
+  bool innermostVaries = false;
+  unsigned dim = 0;
+  for (auto *index : indices) {
+    bool invariant = isAccessInvariant(iv, index);
+    if (dim++ == numIndices - 1)
+      innermostVaries = !invariant;
+    else if (!invariant)
+      return false;
+  }
+  return innermostVaries;
+}
+
+AffineForOp mlir::interchangeForGPUCoalescing(AffineForOp forOp,
+                                              unsigned numBlockDims,
+                                              unsigned numThreadDims) {
+  if (numBlockDims < 1 || numThreadDims < 1)
+    return forOp;
+
+  SmallVector<AffineForOp, 6> loops;
+  getPerfectlyNestedLoops(loops, forOp);
+  if (loops.size() < numBlockDims + numThreadDims)
+    return forOp;
+
+  // Loops carrying values cannot be interchanged.
+  for (AffineForOp loop : loops)
+    if (loop.getNumIterOperands() != 0)
+      return forOp;
+
+  // Score each loop of the perfect nest by the number of memory accesses in
+  // the nest that are contiguous along its induction variable.  Coalescing is
+  // maximized when the loop with the highest score is mapped to the x thread
+  // dimension.
+  SmallVector<unsigned, 6> scores(loops.size(), 0);
+  forOp.getOperation()->walk([&](Operation *op) {
+    for (auto en : llvm::enumerate(loops)) {
+      auto *iv = en.value().getInductionVar();
+      if (auto loadOp = dyn_cast<LoadOp>(op)) {
+        if (isContiguousAlongIv(iv, loadOp))
+          ++scores[en.index()];
+      } else if (auto storeOp = dyn_cast<StoreOp>(op)) {
+        if (isContiguousAlongIv(iv, storeOp))
+          ++scores[en.index()];
+      }
+    }
+  });
+
+  // The conversion maps the loop at depth 'numBlockDims' to the x thread
+  // dimension.
+  unsigned threadXPos = numBlockDims;
+  unsigned best = threadXPos;
+  for (unsigned i = 0, e = loops.size(); i < e; ++i)
+    if (scores[i] > scores[best])
+      best = i;
+  if (best == threadXPos || scores[best] == 0)
+    return forOp;
+
+  // Rotate the best loop into the x thread position, preserving the relative
+  // order of the other loops, unless dependences veto the interchange.
+  SmallVector<unsigned, 6> perm(loops.size());
+  for (unsigned i = 0, e = loops.size(); i < e; ++i)
+    perm[i] = i;
+  perm[best] = threadXPos;
+  if (best > threadXPos) {
+    for (unsigned i = threadXPos; i < best; ++i)
+      perm[i] = i + 1;
+  } else {
+    for (unsigned i = best + 1; i <= threadXPos; ++i)
+      perm[i] = i - 1;
+  }
+  if (!isValidLoopInterchangePermutation(loops, perm))
+    return forOp;
+
+  unsigned rootIndex = interchangeLoops(loops, perm);
+  return loops[rootIndex];
+}
+
 LogicalResult mlir::convertAffineLoopNestToGPULaunch(AffineForOp forOp,
                                                      unsigned numBlockDims,
                                                      unsigned numThreadDims) {
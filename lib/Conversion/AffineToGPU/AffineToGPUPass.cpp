@@ -34,6 +34,12 @@ static llvm::cl::opt<unsigned> clNumThreadDims(
     "gpu-thread-dims",
     llvm::cl::desc("Number of GPU thread dimensions for mapping"),
     llvm::cl::cat(clOptionsCategory), llvm::cl::init(1u));
+static llvm::cl::opt<bool> clCoalescingInterchange(
+    "gpu-coalescing-interchange",
+    llvm::cl::desc("Interchange mapped loops when legal so that the loop with "
+                   "contiguous memory accesses is mapped to the x thread "
+                   "dimension"),
+    llvm::cl::cat(clOptionsCategory), llvm::cl::init(false));
 
 namespace {
 // A pass that traverses top-level loops in the function and converts them to
@@ -43,11 +49,16 @@ struct AffineForGPUMapper : public FunctionPass<AffineForGPUMapper> {
   void runOnFunction() override {
     for (Block &block : getFunction())
       for (Operation &op : llvm::make_early_inc_range(block))
-        if (auto forOp = dyn_cast<AffineForOp>(&op))
+        if (auto forOp = dyn_cast<AffineForOp>(&op)) {
+          if (clCoalescingInterchange)
+            forOp = interchangeForGPUCoalescing(forOp,
+                                                clNumBlockDims.getValue(),
+                                                clNumThreadDims.getValue());
           if (failed(convertAffineLoopNestToGPULaunch(
                   forOp, clNumBlockDims.getValue(),
                   clNumThreadDims.getValue())))
             signalPassFailure();
+        }
   }
 };
 } // namespace
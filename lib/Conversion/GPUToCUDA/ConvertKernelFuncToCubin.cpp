@@ -34,21 +34,52 @@
 #include "mlir/Target/NVVMIR.h"
 
 #include "llvm/ADT/Optional.h"
+#include "llvm/ADT/SmallString.h"
 #include "llvm/ADT/Twine.h"
 #include "llvm/IR/Constants.h"
 #include "llvm/IR/LegacyPassManager.h"
 #include "llvm/IR/Module.h"
+#include "llvm/Support/CommandLine.h"
 #include "llvm/Support/Error.h"
+#include "llvm/Support/FileSystem.h"
+#include "llvm/Support/MD5.h"
+#include "llvm/Support/MemoryBuffer.h"
+#include "llvm/Support/Path.h"
 #include "llvm/Support/TargetRegistry.h"
 #include "llvm/Support/TargetSelect.h"
+#include "llvm/Support/ThreadPool.h"
 #include "llvm/Target/TargetMachine.h"
 
 using namespace mlir;
 
+static llvm::cl::opt<std::string> clCubinCacheDir(
+    "cubin-cache-dir", llvm::cl::init(""),
+    llvm::cl::desc("Directory caching compiled cubins keyed by the hash of "
+                   "their PTX; kernels whose PTX is unchanged skip the cubin "
+                   "generator (default: no caching)"));
+
+static llvm::cl::opt<bool> clParallelCubin(
+    "mlir-parallel-cubin", llvm::cl::init(false),
+    llvm::cl::desc("Compile the PTX of independent kernel functions to cubin "
+                   "on multiple threads; requires a thread-safe cubin "
+                   "generator"));
+
 namespace {
 // TODO(herhut): Move to shared location.
 static constexpr const char *kCubinAnnotation = "nvvm.cubin";
 
+/// State of one kernel function's compilation down to a cubin blob.
+struct KernelCompilation {
+  Function *function;
+  std::string ptx;
+  /// Path of this kernel's entry in the on-disk cubin cache; empty if caching
+  /// is disabled.
+  std::string cachePath;
+  /// Whether `cubin` was read back from the cache instead of compiled.
+  bool fromCache = false;
+  OwnedCubin cubin;
+};
+
 /// A pass converting tagged kernel functions to cubin blobs.
 class GpuKernelToCubinPass : public ModulePass<GpuKernelToCubinPass> {
 public:
@@ -64,12 +95,64 @@ public:
     LLVMInitializeNVPTXTargetMC();
     LLVMInitializeNVPTXAsmPrinter();
 
+    if (!clCubinCacheDir.empty())
+      llvm::sys::fs::create_directories(clCubinCacheDir);
+
+    // Lower each kernel function to PTX and satisfy what we can from the
+    // cubin cache. PTX generation has to stay serial: the translated LLVM
+    // modules all share the LLVM dialect's LLVMContext.
+    std::vector<KernelCompilation> compilations;
     for (auto &function : getModule()) {
       if (!gpu::GPUDialect::isKernel(&function) || function.isExternal()) {
         continue;
       }
-      if (failed(translateGpuKernelToCubinAnnotation(function)))
+      KernelCompilation compilation;
+      compilation.function = &function;
+      if (failed(translateGpuKernelToPtx(function, compilation.ptx))) {
+        signalPassFailure();
+        continue;
+      }
+      if (!clCubinCacheDir.empty()) {
+        compilation.cachePath =
+            getCachedCubinPath(clCubinCacheDir, compilation.ptx);
+        compilation.cubin = readCachedCubin(compilation.cachePath);
+        compilation.fromCache = compilation.cubin != nullptr;
+      }
+      compilations.push_back(std::move(compilation));
+    }
+
+    // Compile the PTX of the kernels the cache could not provide. The
+    // PTX-to-cubin step is independent across kernels and is by far the most
+    // expensive one, so it is the one worth running concurrently.
+    SmallVector<KernelCompilation *, 8> pending;
+    for (auto &compilation : compilations)
+      if (!compilation.cubin)
+        pending.push_back(&compilation);
+    if (clParallelCubin && pending.size() > 1) {
+      llvm::ThreadPool pool;
+      for (auto *compilation : pending)
+        pool.async([this, compilation] {
+          compilation->cubin =
+              cubinGenerator(compilation->ptx, *compilation->function);
+        });
+      pool.wait();
+    } else {
+      for (auto *compilation : pending)
+        compilation->cubin =
+            cubinGenerator(compilation->ptx, *compilation->function);
+    }
+
+    // Attach the cubins to the kernels and populate the cache, serially
+    // again since this mutates the IR.
+    for (auto &compilation : compilations) {
+      if (!compilation.cubin) {
+        compilation.function->emitError("Translation to CUDA binary failed.");
         signalPassFailure();
+        continue;
+      }
+      if (!compilation.cachePath.empty() && !compilation.fromCache)
+        writeCachedCubin(compilation.cachePath, *compilation.cubin);
+      annotateGpuKernelWithCubin(*compilation.function, *compilation.cubin);
     }
   }
 
@@ -77,10 +160,19 @@ private:
   static OwnedCubin compilePtxToCubinForTesting(const std::string &ptx,
                                                 Function &function);
 
+  /// Returns the path of the cache entry for a kernel with the given PTX.
+  static std::string getCachedCubinPath(StringRef cacheDir, StringRef ptx);
+  /// Reads a cached cubin back; returns null if there is no usable entry.
+  static OwnedCubin readCachedCubin(StringRef path);
+  /// Writes a compiled cubin to its cache entry; best effort, the cache is
+  /// only ever a shortcut.
+  static void writeCachedCubin(StringRef path, const std::vector<char> &cubin);
+
   std::string translateModuleToPtx(llvm::Module &module,
                                    llvm::TargetMachine &target_machine);
-  OwnedCubin convertModuleToCubin(llvm::Module &llvmModule, Function &function);
-  LogicalResult translateGpuKernelToCubinAnnotation(Function &function);
+  LogicalResult translateGpuKernelToPtx(Function &function, std::string &ptx);
+  void annotateGpuKernelWithCubin(Function &function,
+                                  const std::vector<char> &cubin);
 
   CubinGenerator cubinGenerator;
 };
@@ -109,8 +201,60 @@ GpuKernelToCubinPass::compilePtxToCubinForTesting(const std::string &ptx,
   return llvm::make_unique<std::vector<char>>(data, data + sizeof(data) - 1);
 }
 
-OwnedCubin GpuKernelToCubinPass::convertModuleToCubin(llvm::Module &llvmModule,
-                                                      Function &function) {
+std::string GpuKernelToCubinPass::getCachedCubinPath(StringRef cacheDir,
+                                                     StringRef ptx) {
+  // The key is a content hash of the PTX: any change to the kernel, the
+  // lowering or the codegen options shows up in the PTX and misses the cache.
+  llvm::MD5 hash;
+  hash.update(ptx);
+  llvm::MD5::MD5Result result;
+  hash.final(result);
+
+  llvm::SmallString<32> digest = result.digest();
+  llvm::SmallString<128> path(cacheDir);
+  llvm::sys::path::append(path, StringRef(digest));
+  path += ".cubin";
+  return std::string(path.str());
+}
+
+OwnedCubin GpuKernelToCubinPass::readCachedCubin(StringRef path) {
+  auto buffer = llvm::MemoryBuffer::getFile(path, /*FileSize=*/-1,
+                                            /*RequiresNullTerminator=*/false);
+  if (!buffer)
+    return {};
+  return llvm::make_unique<std::vector<char>>((*buffer)->getBufferStart(),
+                                              (*buffer)->getBufferEnd());
+}
+
+void GpuKernelToCubinPass::writeCachedCubin(StringRef path,
+                                            const std::vector<char> &cubin) {
+  // Write to a unique temporary and rename it into place so that concurrent
+  // compilations never observe a partially written entry.
+  int fd;
+  llvm::SmallString<128> tmpPath;
+  if (llvm::sys::fs::createUniqueFile(llvm::Twine(path) + ".tmp%%%%%%", fd,
+                                      tmpPath))
+    return;
+  {
+    llvm::raw_fd_ostream os(fd, /*shouldClose=*/true);
+    os.write(cubin.data(), cubin.size());
+  }
+  if (llvm::sys::fs::rename(tmpPath, path))
+    llvm::sys::fs::remove(tmpPath);
+}
+
+LogicalResult
+GpuKernelToCubinPass::translateGpuKernelToPtx(Function &function,
+                                              std::string &ptx) {
+  Builder builder(function.getContext());
+
+  std::unique_ptr<Module> module(builder.createModule());
+
+  // TODO(herhut): Also handle called functions.
+  module->getFunctions().push_back(function.clone());
+
+  auto llvmModule = translateModuleToNVVMIR(*module);
+
   std::unique_ptr<llvm::TargetMachine> targetMachine;
   {
     std::string error;
@@ -119,47 +263,30 @@ OwnedCubin GpuKernelToCubinPass::convertModuleToCubin(llvm::Module &llvmModule,
     llvm::Triple triple(cudaTriple);
     const llvm::Target *target =
         llvm::TargetRegistry::lookupTarget("", triple, error);
-    if (target == nullptr) {
-      function.emitError("Cannot initialize target triple");
-      return {};
-    }
+    if (target == nullptr)
+      return function.emitError("Cannot initialize target triple");
     targetMachine.reset(
         target->createTargetMachine(triple.str(), "sm_75", "+ptx60", {}, {}));
   }
 
   // Set the data layout of the llvm module to match what the ptx target needs.
-  llvmModule.setDataLayout(targetMachine->createDataLayout());
-
-  auto ptx = translateModuleToPtx(llvmModule, *targetMachine);
+  llvmModule->setDataLayout(targetMachine->createDataLayout());
 
-  return cubinGenerator(ptx, function);
+  ptx = translateModuleToPtx(*llvmModule, *targetMachine);
+  return success();
 }
 
-LogicalResult
-GpuKernelToCubinPass::translateGpuKernelToCubinAnnotation(Function &function) {
+void GpuKernelToCubinPass::annotateGpuKernelWithCubin(
+    Function &function, const std::vector<char> &cubin) {
   Builder builder(function.getContext());
-
-  std::unique_ptr<Module> module(builder.createModule());
-
-  // TODO(herhut): Also handle called functions.
-  module->getFunctions().push_back(function.clone());
-
-  auto llvmModule = translateModuleToNVVMIR(*module);
-  auto cubin = convertModuleToCubin(*llvmModule, function);
-
-  if (!cubin)
-    return function.emitError("Translation to CUDA binary failed.");
-
   function.setAttr(kCubinAnnotation,
-                   builder.getStringAttr({cubin->data(), cubin->size()}));
+                   builder.getStringAttr({cubin.data(), cubin.size()}));
 
   // Remove the body of the kernel function now that it has been translated.
   // The main reason to do this is so that the resulting module no longer
   // contains the NVVM instructions (typically contained in the kernel bodies)
   // and hence can be compiled into host code by a separate pass.
   function.eraseBody();
-
-  return success();
 }
 
 ModulePassBase *
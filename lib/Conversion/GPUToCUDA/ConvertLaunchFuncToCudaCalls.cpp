@@ -33,12 +33,15 @@
 #include "mlir/LLVMIR/LLVMDialect.h"
 #include "mlir/Pass/Pass.h"
 
+#include "llvm/ADT/DenseMap.h"
 #include "llvm/ADT/STLExtras.h"
 #include "llvm/IR/DataLayout.h"
 #include "llvm/IR/DerivedTypes.h"
 #include "llvm/IR/Module.h"
 #include "llvm/IR/Type.h"
+#include "llvm/Support/CommandLine.h"
 #include "llvm/Support/Error.h"
+#include "llvm/Support/MathExtras.h"
 
 using namespace mlir;
 
@@ -49,6 +52,54 @@ static constexpr const char *cuLaunchKernelName = "mcuLaunchKernel";
 static constexpr const char *cuGetStreamHelperName = "mcuGetStreamHelper";
 static constexpr const char *cuStreamSynchronizeName = "mcuStreamSynchronize";
 
+// Caching variants of the helpers above: the runtime loads the module and
+// resolves the function handle on first use and reuses them afterwards, hands
+// out a stream that is reused across launches, and owns a pinned parameter
+// buffer that is reused across launches instead of stack allocations.
+static constexpr const char *cuModuleGetFunctionCachedName =
+    "mcuModuleGetFunctionCached";
+static constexpr const char *cuGetPooledStreamHelperName =
+    "mcuGetPooledStreamHelper";
+static constexpr const char *cuGetPooledParamsBufferName =
+    "mcuGetPooledParamsBuffer";
+
+static llvm::cl::opt<bool> clPooledLaunchResources(
+    "cuda-pooled-launch-resources",
+    llvm::cl::desc("Emit launch sequences that reuse module/function handles, "
+                   "the stream, and a pinned parameter buffer through caching "
+                   "runtime helpers instead of recreating them on every call"),
+    llvm::cl::init(false));
+
+// Multi-stream variants: the runtime hands out one stream per index so that
+// independent launches can overlap, and orders dependent launches across
+// streams by recording an event on the producing stream and making the
+// consuming stream wait for it.
+static constexpr const char *cuGetStreamForIndexHelperName =
+    "mcuGetStreamForIndexHelper";
+static constexpr const char *cuStreamWaitStreamName =
+    "mcuStreamWaitStreamHelper";
+
+// Returns a pinned staging buffer of at least the given number of bytes that
+// is reused across launches. Staging all arguments of a launch in one pinned
+// buffer lets the runtime move them to the device in a single transfer
+// instead of one small copy per argument.
+static constexpr const char *cuGetPooledArgBufferName = "mcuGetPooledArgBuffer";
+
+static llvm::cl::opt<bool> clBatchedArgStaging(
+    "cuda-batched-arg-staging",
+    llvm::cl::desc("Stage all kernel arguments of a launch at their natural "
+                   "alignments in one pinned buffer from the runtime pool "
+                   "instead of one stack allocation per argument"),
+    llvm::cl::init(false));
+
+static llvm::cl::opt<bool> clMultiStreamLaunches(
+    "cuda-multi-stream",
+    llvm::cl::desc("Launch adjacent kernels that share no operands on "
+                   "separate CUDA streams, ordering dependent launches with "
+                   "events and synchronizing once after each launch sequence "
+                   "instead of after every launch"),
+    llvm::cl::init(false));
+
 static constexpr const char *kCubinGetterAnnotation = "nvvm.cubingetter";
 
 namespace {
@@ -120,7 +171,11 @@ private:
   Value *setupParamsArray(gpu::LaunchFuncOp launchOp, OpBuilder &builder);
   Value *generateKernelNameConstant(Function *kernelFunction, Location &loc,
                                     OpBuilder &builder);
-  void translateGpuLaunchCalls(mlir::gpu::LaunchFuncOp launchOp);
+  void translateGpuLaunchCalls(mlir::gpu::LaunchFuncOp launchOp,
+                               Value *cuStreamOverride = nullptr,
+                               bool syncStream = true);
+  void translateBlockMultiStream(Block &block);
+  void translateMultiStreamRun(MutableArrayRef<mlir::gpu::LaunchFuncOp> run);
 
 public:
   // Run the dialect converter on the module.
@@ -131,8 +186,13 @@ public:
     initializeCachedTypes();
 
     for (auto &func : getModule()) {
-      func.walk<mlir::gpu::LaunchFuncOp>(
-          [this](mlir::gpu::LaunchFuncOp op) { translateGpuLaunchCalls(op); });
+      if (!clMultiStreamLaunches) {
+        func.walk<mlir::gpu::LaunchFuncOp>(
+            [this](mlir::gpu::LaunchFuncOp op) { translateGpuLaunchCalls(op); });
+        continue;
+      }
+      for (auto &block : func.getBody())
+        translateBlockMultiStream(block);
     }
   }
 
@@ -216,6 +276,75 @@ void GpuLaunchFuncToCudaCallsPass::declareCudaFunctions(Location loc) {
                          },
                          getCUResultType())));
   }
+  if (clBatchedArgStaging &&
+      !module.getNamedFunction(cuGetPooledArgBufferName)) {
+    // Returns a pinned staging buffer of at least the given number of bytes
+    // that is reused across launches.
+    module.getFunctions().push_back(
+        new Function(loc, cuGetPooledArgBufferName,
+                     builder.getFunctionType(
+                         {
+                             getInt32Type() /* int numBytes */
+                         },
+                         getPointerType() /* void *buffer */)));
+  }
+  if (clMultiStreamLaunches) {
+    if (!module.getNamedFunction(cuGetStreamForIndexHelperName)) {
+      // Returns the stream for the given index, creating it on first use and
+      // reusing it afterwards.
+      module.getFunctions().push_back(
+          new Function(loc, cuGetStreamForIndexHelperName,
+                       builder.getFunctionType(
+                           {
+                               getInt32Type() /* int index */
+                           },
+                           getPointerType() /* void *stream */)));
+    }
+    if (!module.getNamedFunction(cuStreamWaitStreamName)) {
+      // Makes the first stream wait for the work currently enqueued on the
+      // second by recording an event on it and inserting a wait.
+      module.getFunctions().push_back(
+          new Function(loc, cuStreamWaitStreamName,
+                       builder.getFunctionType(
+                           {
+                               getPointerType(), /* CUstream waiter */
+                               getPointerType()  /* CUstream waitee */
+                           },
+                           getCUResultType())));
+    }
+  }
+  if (!clPooledLaunchResources)
+    return;
+  if (!module.getNamedFunction(cuModuleGetFunctionCachedName)) {
+    // Loads the module for 'cubin' and resolves 'name' in it on first use and
+    // serves both handles from a cache afterwards.
+    module.getFunctions().push_back(
+        new Function(loc, cuModuleGetFunctionCachedName,
+                     builder.getFunctionType(
+                         {
+                             getPointerPointerType(), /* void **function */
+                             getPointerType(),        /* void *cubin */
+                             getPointerType()         /* char *name */
+                         },
+                         getCUResultType())));
+  }
+  if (!module.getNamedFunction(cuGetPooledStreamHelperName)) {
+    // Returns a stream that is reused across launches.
+    module.getFunctions().push_back(new Function(
+        loc, cuGetPooledStreamHelperName,
+        builder.getFunctionType({}, getPointerType() /* void *stream */)));
+  }
+  if (!module.getNamedFunction(cuGetPooledParamsBufferName)) {
+    // Returns a pinned buffer of at least the given number of parameter slots
+    // that is reused across launches.
+    module.getFunctions().push_back(
+        new Function(loc, cuGetPooledParamsBufferName,
+                     builder.getFunctionType(
+                         {
+                             getInt32Type() /* int numParams */
+                         },
+                         getPointerPointerType() /* void **buffer */)));
+  }
 }
 
 // Generates a parameters array to be used with a CUDA kernel launch call. The
@@ -230,13 +359,73 @@ Value *
 GpuLaunchFuncToCudaCallsPass::setupParamsArray(gpu::LaunchFuncOp launchOp,
                                                OpBuilder &builder) {
   Location loc = launchOp.getLoc();
-  auto one = builder.create<LLVM::ConstantOp>(loc, getInt32Type(),
-                                              builder.getI32IntegerAttr(1));
   auto arraySize = builder.create<LLVM::ConstantOp>(
       loc, getInt32Type(),
       builder.getI32IntegerAttr(launchOp.getNumKernelOperands()));
-  auto array =
-      builder.create<LLVM::AllocaOp>(loc, getPointerPointerType(), arraySize);
+  Value *array;
+  if (clPooledLaunchResources) {
+    // Fill a pinned buffer owned and reused by the runtime instead of a fresh
+    // stack allocation on every call.
+    Function *getParamsBuffer =
+        getModule().getNamedFunction(cuGetPooledParamsBufferName);
+    array = builder
+                .create<LLVM::CallOp>(loc,
+                                      ArrayRef<Type>{getPointerPointerType()},
+                                      builder.getFunctionAttr(getParamsBuffer),
+                                      ArrayRef<Value *>{arraySize})
+                .getResult(0);
+  } else {
+    array =
+        builder.create<LLVM::AllocaOp>(loc, getPointerPointerType(), arraySize);
+  }
+  if (clBatchedArgStaging) {
+    // Lay the arguments out at their natural alignments in one pinned staging
+    // buffer from the runtime pool. One buffer serves all arguments of the
+    // launch, so the runtime stages them to the device in a single transfer
+    // instead of one small copy per argument.
+    const llvm::DataLayout &dataLayout =
+        getLLVMDialect()->getLLVMModule().getDataLayout();
+    SmallVector<uint64_t, 8> offsets;
+    uint64_t totalSize = 0;
+    for (int idx = 0, e = launchOp.getNumKernelOperands(); idx < e; ++idx) {
+      llvm::Type *type = launchOp.getKernelOperand(idx)
+                             ->getType()
+                             .cast<LLVM::LLVMType>()
+                             .getUnderlyingType();
+      totalSize = llvm::alignTo(totalSize, dataLayout.getABITypeAlignment(type));
+      offsets.push_back(totalSize);
+      totalSize += dataLayout.getTypeAllocSize(type);
+    }
+    auto bufferSize = builder.create<LLVM::ConstantOp>(
+        loc, getInt32Type(), builder.getI32IntegerAttr(totalSize));
+    Function *getArgBuffer =
+        getModule().getNamedFunction(cuGetPooledArgBufferName);
+    Value *staging = builder
+                         .create<LLVM::CallOp>(
+                             loc, ArrayRef<Type>{getPointerType()},
+                             builder.getFunctionAttr(getArgBuffer),
+                             ArrayRef<Value *>{bufferSize})
+                         .getResult(0);
+    for (int idx = 0, e = launchOp.getNumKernelOperands(); idx < e; ++idx) {
+      auto operand = launchOp.getKernelOperand(idx);
+      auto llvmType = operand->getType().cast<LLVM::LLVMType>();
+      auto offset = builder.create<LLVM::ConstantOp>(
+          loc, getInt32Type(), builder.getI32IntegerAttr(offsets[idx]));
+      auto slot = builder.create<LLVM::GEPOp>(loc, getPointerType(), staging,
+                                              ArrayRef<Value *>{offset});
+      auto typedSlot =
+          builder.create<LLVM::BitcastOp>(loc, llvmType.getPointerTo(), slot);
+      builder.create<LLVM::StoreOp>(loc, operand, typedSlot);
+      auto index = builder.create<LLVM::ConstantOp>(
+          loc, getInt32Type(), builder.getI32IntegerAttr(idx));
+      auto gep = builder.create<LLVM::GEPOp>(loc, getPointerPointerType(),
+                                             array, ArrayRef<Value *>{index});
+      builder.create<LLVM::StoreOp>(loc, slot, gep);
+    }
+    return array;
+  }
+  auto one = builder.create<LLVM::ConstantOp>(loc, getInt32Type(),
+                                              builder.getI32IntegerAttr(1));
   for (int idx = 0, e = launchOp.getNumKernelOperands(); idx < e; ++idx) {
     auto operand = launchOp.getKernelOperand(idx);
     auto llvmType = operand->getType().cast<LLVM::LLVMType>();
@@ -313,8 +502,15 @@ Value *GpuLaunchFuncToCudaCallsPass::generateKernelNameConstant(
 // %7 = <see setupParamsArray>
 // call %mcuLaunchKernel(%6, <launchOp operands 0..5>, 0, %5, %7, nullptr)
 // call %mcuStreamSynchronize(%5)
+//
+// Under -cuda-pooled-launch-resources, the module load, function resolution,
+// stream creation, and parameter array allocation are replaced by calls to
+// caching runtime helpers (mcuModuleGetFunctionCached, mcuGetPooledStreamHelper
+// and mcuGetPooledParamsBuffer) so that only the first execution of a launch
+// site pays for them.
 void GpuLaunchFuncToCudaCallsPass::translateGpuLaunchCalls(
-    mlir::gpu::LaunchFuncOp launchOp) {
+    mlir::gpu::LaunchFuncOp launchOp, Value *cuStreamOverride,
+    bool syncStream) {
   OpBuilder builder(launchOp);
   Location loc = launchOp.getLoc();
   declareCudaFunctions(loc);
@@ -334,35 +530,72 @@ void GpuLaunchFuncToCudaCallsPass::translateGpuLaunchCalls(
   }
   auto data = builder.create<LLVM::CallOp>(
       loc, ArrayRef<Type>{getPointerType()}, cubinGetter, ArrayRef<Value *>{});
-  // Emit the load module call to load the module data. Error checking is done
-  // in the called helper function.
-  auto cuModule = allocatePointer(builder, loc);
-  Function *cuModuleLoad = getModule().getNamedFunction(cuModuleLoadName);
-  builder.create<LLVM::CallOp>(loc, ArrayRef<Type>{getCUResultType()},
-                               builder.getFunctionAttr(cuModuleLoad),
-                               ArrayRef<Value *>{cuModule, data.getResult(0)});
-  // Get the function from the module. The name corresponds to the name of
-  // the kernel function.
-  auto cuModuleRef =
-      builder.create<LLVM::LoadOp>(loc, getPointerType(), cuModule);
-  auto kernelName = generateKernelNameConstant(kernelFunction, loc, builder);
-  auto cuFunction = allocatePointer(builder, loc);
-  Function *cuModuleGetFunction =
-      getModule().getNamedFunction(cuModuleGetFunctionName);
-  builder.create<LLVM::CallOp>(
-      loc, ArrayRef<Type>{getCUResultType()},
-      builder.getFunctionAttr(cuModuleGetFunction),
-      ArrayRef<Value *>{cuFunction, cuModuleRef, kernelName});
-  // Grab the global stream needed for execution.
-  Function *cuGetStreamHelper =
-      getModule().getNamedFunction(cuGetStreamHelperName);
-  auto cuStream = builder.create<LLVM::CallOp>(
-      loc, ArrayRef<Type>{getPointerType()},
-      builder.getFunctionAttr(cuGetStreamHelper), ArrayRef<Value *>{});
+  Value *cuFunctionRef;
+  Value *cuStream = cuStreamOverride;
+  if (clPooledLaunchResources) {
+    // Resolve the function handle through the caching helper; the module is
+    // loaded and the function resolved once at first use, every subsequent
+    // call is a cache hit in the runtime.
+    auto kernelName = generateKernelNameConstant(kernelFunction, loc, builder);
+    auto cuFunction = allocatePointer(builder, loc);
+    Function *cuModuleGetFunctionCached =
+        getModule().getNamedFunction(cuModuleGetFunctionCachedName);
+    builder.create<LLVM::CallOp>(
+        loc, ArrayRef<Type>{getCUResultType()},
+        builder.getFunctionAttr(cuModuleGetFunctionCached),
+        ArrayRef<Value *>{cuFunction, data.getResult(0), kernelName});
+    cuFunctionRef =
+        builder.create<LLVM::LoadOp>(loc, getPointerType(), cuFunction);
+    // Grab the stream that the runtime reuses across launches, unless the
+    // caller already picked one.
+    if (!cuStream) {
+      Function *cuGetPooledStreamHelper =
+          getModule().getNamedFunction(cuGetPooledStreamHelperName);
+      cuStream = builder
+                     .create<LLVM::CallOp>(
+                         loc, ArrayRef<Type>{getPointerType()},
+                         builder.getFunctionAttr(cuGetPooledStreamHelper),
+                         ArrayRef<Value *>{})
+                     .getResult(0);
+    }
+  } else {
+    // Emit the load module call to load the module data. Error checking is
+    // done in the called helper function.
+    auto cuModule = allocatePointer(builder, loc);
+    Function *cuModuleLoad = getModule().getNamedFunction(cuModuleLoadName);
+    builder.create<LLVM::CallOp>(
+        loc, ArrayRef<Type>{getCUResultType()},
+        builder.getFunctionAttr(cuModuleLoad),
+        ArrayRef<Value *>{cuModule, data.getResult(0)});
+    // Get the function from the module. The name corresponds to the name of
+    // the kernel function.
+    auto cuModuleRef =
+        builder.create<LLVM::LoadOp>(loc, getPointerType(), cuModule);
+    auto kernelName = generateKernelNameConstant(kernelFunction, loc, builder);
+    auto cuFunction = allocatePointer(builder, loc);
+    Function *cuModuleGetFunction =
+        getModule().getNamedFunction(cuModuleGetFunctionName);
+    builder.create<LLVM::CallOp>(
+        loc, ArrayRef<Type>{getCUResultType()},
+        builder.getFunctionAttr(cuModuleGetFunction),
+        ArrayRef<Value *>{cuFunction, cuModuleRef, kernelName});
+    // Grab the global stream needed for execution, unless the caller already
+    // picked one.
+    if (!cuStream) {
+      Function *cuGetStreamHelper =
+          getModule().getNamedFunction(cuGetStreamHelperName);
+      cuStream = builder
+                     .create<LLVM::CallOp>(
+                         loc, ArrayRef<Type>{getPointerType()},
+                         builder.getFunctionAttr(cuGetStreamHelper),
+                         ArrayRef<Value *>{})
+                     .getResult(0);
+    }
+    cuFunctionRef =
+        builder.create<LLVM::LoadOp>(loc, getPointerType(), cuFunction);
+  }
   // Invoke the function with required arguments.
   auto cuLaunchKernel = getModule().getNamedFunction(cuLaunchKernelName);
-  auto cuFunctionRef =
-      builder.create<LLVM::LoadOp>(loc, getPointerType(), cuFunction);
   auto paramsArray = setupParamsArray(launchOp, builder);
   auto nullpointer =
       builder.create<LLVM::IntToPtrOp>(loc, getPointerPointerType(), zero);
@@ -373,17 +606,136 @@ void GpuLaunchFuncToCudaCallsPass::translateGpuLaunchCalls(
                         launchOp.getOperand(1), launchOp.getOperand(2),
                         launchOp.getOperand(3), launchOp.getOperand(4),
                         launchOp.getOperand(5), zero, /* sharedMemBytes */
-                        cuStream.getResult(0),        /* stream */
+                        cuStream,                     /* stream */
                         paramsArray,                  /* kernel params */
                         nullpointer /* extra */});
-  // Sync on the stream to make it synchronous.
-  auto cuStreamSync = getModule().getNamedFunction(cuStreamSynchronizeName);
-  builder.create<LLVM::CallOp>(loc, ArrayRef<Type>{getCUResultType()},
-                               builder.getFunctionAttr(cuStreamSync),
-                               ArrayRef<Value *>(cuStream.getResult(0)));
+  // Sync on the stream to make it synchronous, unless the caller defers the
+  // synchronization to the end of a multi-stream launch sequence.
+  if (syncStream) {
+    auto cuStreamSync = getModule().getNamedFunction(cuStreamSynchronizeName);
+    builder.create<LLVM::CallOp>(loc, ArrayRef<Type>{getCUResultType()},
+                                 builder.getFunctionAttr(cuStreamSync),
+                                 ArrayRef<Value *>(cuStream));
+  }
   launchOp.erase();
 }
 
+// Translates the launches of a block under -cuda-multi-stream: maximal runs of
+// adjacent gpu.launch_func operations are lowered together so that independent
+// launches within a run can overlap on separate streams. Launches separated by
+// other host code keep the synchronous single-stream lowering, as that code
+// may observe the effects of the preceding kernel.
+void GpuLaunchFuncToCudaCallsPass::translateBlockMultiStream(Block &block) {
+  SmallVector<mlir::gpu::LaunchFuncOp, 4> run;
+  auto flushRun = [&] {
+    if (run.size() < 2) {
+      for (auto launchOp : run)
+        translateGpuLaunchCalls(launchOp);
+    } else {
+      translateMultiStreamRun(run);
+    }
+    run.clear();
+  };
+  for (auto &op : block) {
+    for (auto &region : op.getRegions())
+      for (auto &nested : region)
+        translateBlockMultiStream(nested);
+    if (auto launchOp = dyn_cast<mlir::gpu::LaunchFuncOp>(&op))
+      run.push_back(launchOp);
+    else
+      flushRun();
+  }
+  flushRun();
+}
+
+// Lowers a run of adjacent launches onto multiple streams. Kernels only access
+// memory reachable from their arguments, so launches that share no kernel
+// operand are independent and go to separate streams. A launch whose operand
+// was last enqueued on another stream waits on that stream through an event
+// before it is enqueued. Every stream the run used is synchronized once after
+// the last launch, where the single-stream lowering synchronizes after each.
+void GpuLaunchFuncToCudaCallsPass::translateMultiStreamRun(
+    MutableArrayRef<mlir::gpu::LaunchFuncOp> run) {
+  Block *block = run.back().getOperation()->getBlock();
+  Location loc = run.back().getLoc();
+  // Remember where the ops following the run start, so that the final
+  // synchronization can be emitted there once the launches are rewritten.
+  Block::iterator syncPoint =
+      std::next(Block::iterator(run.back().getOperation()));
+
+  Function *getStreamForIndex =
+      getModule().getNamedFunction(cuGetStreamForIndexHelperName);
+  Function *streamWaitStream =
+      getModule().getNamedFunction(cuStreamWaitStreamName);
+
+  // The handle for each stream index, created at its first use. A handle is
+  // always created at or before the launch that uses it, so it dominates all
+  // later uses within the run.
+  SmallVector<Value *, 4> streamHandles;
+  auto getStreamHandle = [&](unsigned index, OpBuilder &builder,
+                             Location loc) -> Value * {
+    if (index == streamHandles.size()) {
+      auto indexValue = builder.create<LLVM::ConstantOp>(
+          loc, getInt32Type(), builder.getI32IntegerAttr(index));
+      streamHandles.push_back(
+          builder
+              .create<LLVM::CallOp>(loc, ArrayRef<Type>{getPointerType()},
+                                    builder.getFunctionAttr(getStreamForIndex),
+                                    ArrayRef<Value *>{indexValue})
+              .getResult(0));
+    }
+    return streamHandles[index];
+  };
+
+  // Maps each kernel operand to the stream its last user was enqueued on.
+  llvm::DenseMap<Value *, unsigned> streamForValue;
+  for (auto launchOp : run) {
+    OpBuilder builder(launchOp);
+    Location launchLoc = launchOp.getLoc();
+
+    // Assign the launch to the stream of the first operand with a recorded
+    // stream, or to a fresh stream if all of its operands are unseen. Record
+    // any other streams its operands were last used on; those carry work this
+    // launch must wait for.
+    int streamIndex = -1;
+    SmallVector<unsigned, 2> waitOn;
+    for (unsigned i = 0, e = launchOp.getNumKernelOperands(); i != e; ++i) {
+      auto it = streamForValue.find(launchOp.getKernelOperand(i));
+      if (it == streamForValue.end())
+        continue;
+      if (streamIndex < 0)
+        streamIndex = it->second;
+      else if (unsigned(streamIndex) != it->second &&
+               !llvm::is_contained(waitOn, it->second))
+        waitOn.push_back(it->second);
+    }
+    if (streamIndex < 0)
+      streamIndex = streamHandles.size();
+    Value *cuStream = getStreamHandle(streamIndex, builder, launchLoc);
+
+    // Order this launch after the work enqueued on the other streams.
+    for (unsigned other : waitOn)
+      builder.create<LLVM::CallOp>(
+          launchLoc, ArrayRef<Type>{getCUResultType()},
+          builder.getFunctionAttr(streamWaitStream),
+          ArrayRef<Value *>{cuStream, getStreamHandle(other, builder,
+                                                      launchLoc)});
+
+    for (unsigned i = 0, e = launchOp.getNumKernelOperands(); i != e; ++i)
+      streamForValue[launchOp.getKernelOperand(i)] = streamIndex;
+
+    translateGpuLaunchCalls(launchOp, cuStream, /*syncStream=*/false);
+  }
+
+  // Synchronize every stream the run used.
+  OpBuilder builder(block, syncPoint);
+  auto cuStreamSync = getModule().getNamedFunction(cuStreamSynchronizeName);
+  for (auto *cuStream : streamHandles)
+    builder.create<LLVM::CallOp>(loc, ArrayRef<Type>{getCUResultType()},
+                                 builder.getFunctionAttr(cuStreamSync),
+                                 ArrayRef<Value *>(cuStream));
+}
+
 mlir::ModulePassBase *mlir::createConvertGpuLaunchFuncToCudaCallsPass() {
   return new GpuLaunchFuncToCudaCallsPass();
 }
@@ -37,6 +37,7 @@
 #include "llvm/IR/DerivedTypes.h"
 #include "llvm/IR/IRBuilder.h"
 #include "llvm/IR/Type.h"
+#include "llvm/Support/CommandLine.h"
 
 using namespace mlir;
 
@@ -386,6 +387,54 @@ static bool isSupportedMemRefType(MemRefType type) {
   return true;
 }
 
+static llvm::cl::opt<unsigned> clPromoteAllocMaxBytes(
+    "std-to-llvm-promote-alloc-bytes",
+    llvm::cl::desc(
+        "Lower non-escaping statically shaped allocs of at most this many "
+        "bytes to llvm.alloca in the entry block (0 disables promotion)"),
+    llvm::cl::init(0));
+
+// Returns the size in bytes of a statically shaped memref.
+static uint64_t getStaticSizeInBytes(MemRefType type) {
+  auto elementType = type.getElementType();
+  uint64_t elementSize = 0;
+  if (auto vectorType = elementType.dyn_cast<VectorType>())
+    elementSize = vectorType.getNumElements() *
+                  llvm::divideCeil(vectorType.getElementTypeBitWidth(), 8);
+  else
+    elementSize = llvm::divideCeil(elementType.getIntOrFloatBitWidth(), 8);
+  uint64_t numElements = type.getRank() == 0 ? 1 : type.getNumElements();
+  return numElements * elementSize;
+}
+
+// Returns true if 'alloc' should become a stack allocation: promotion is
+// enabled, the memref is statically shaped and within the size bound, and
+// the buffer does not escape - it is only ever addressed by loads and stores
+// and freed by dealloc. The same predicate drives the alloc and the dealloc
+// lowering so that promoted buffers are not passed to `free`.
+static bool shouldPromoteToStack(AllocOp alloc) {
+  if (clPromoteAllocMaxBytes == 0)
+    return false;
+  // llvm.alloca cannot carry an alignment request; leave aligned buffers on
+  // the heap where aligned_alloc honors it.
+  if (alloc.getAlignment() != 0)
+    return false;
+  auto type = alloc.getType();
+  if (!isSupportedMemRefType(type) || !type.hasStaticShape() ||
+      getStaticSizeInBytes(type) > clPromoteAllocMaxBytes)
+    return false;
+  for (auto &use : alloc.getResult()->getUses()) {
+    Operation *owner = use.getOwner();
+    if (isa<DeallocOp>(owner) || isa<LoadOp>(owner))
+      continue;
+    // A store must address the buffer, not store the memref value itself.
+    if (isa<StoreOp>(owner) && use.getOperandNumber() == 1)
+      continue;
+    return false;
+  }
+  return true;
+}
+
 // An `alloc` is converted into a definition of a memref descriptor value and
 // a call to `malloc` to allocate the underlying data buffer.  The memref
 // descriptor is of the LLVM structure type where the first element is a pointer
@@ -404,6 +453,24 @@ struct AllocOpLowering : public LLVMLegalizationPattern<AllocOp> {
     auto allocOp = cast<AllocOp>(op);
     MemRefType type = allocOp.getType();
 
+    // Promote small non-escaping buffers to the stack instead of calling
+    // malloc. The alloca goes into the entry block so that buffers allocated
+    // in already-lowered loop bodies do not grow the stack per iteration.
+    if (shouldPromoteToStack(allocOp)) {
+      auto elementPtrType = lowering.convertType(type.getElementType())
+                                .cast<LLVM::LLVMType>()
+                                .getPointerTo();
+      auto savedIp = rewriter.saveInsertionPoint();
+      rewriter.setInsertionPointToStart(&op->getFunction()->front());
+      Value *numElements = createIndexConstant(
+          rewriter, op->getLoc(),
+          type.getRank() == 0 ? 1 : type.getNumElements());
+      Value *allocated = rewriter.create<LLVM::AllocaOp>(
+          op->getLoc(), elementPtrType, numElements);
+      rewriter.restoreInsertionPoint(savedIp);
+      return rewriter.replaceOp(op, allocated);
+    }
+
     // Get actual sizes of the memref as values: static sizes are constant
     // values and dynamic sizes are passed to 'alloc' as operands.  In case of
     // zero-dimensional memref, assume a scalar (size 1).
@@ -440,14 +507,44 @@ struct AllocOpLowering : public LLVMLegalizationPattern<AllocOp> {
             cumulativeSize,
             createIndexConstant(rewriter, op->getLoc(), elementSize)});
 
-    // Insert the `malloc` declaration if it is not already present.
-    Function *mallocFunc =
-        op->getFunction()->getModule()->getNamedFunction("malloc");
-    if (!mallocFunc) {
-      auto mallocType =
-          rewriter.getFunctionType(getIndexType(), getVoidPtrType());
-      mallocFunc = new Function(rewriter.getUnknownLoc(), "malloc", mallocType);
-      op->getFunction()->getModule()->getFunctions().push_back(mallocFunc);
+    // Insert the declaration of the allocator if it is not already present.
+    // Allocs carrying an alignment request go to `aligned_alloc` instead of
+    // `malloc`.
+    uint64_t alignment = allocOp.getAlignment();
+    StringRef allocatorName = alignment ? "aligned_alloc" : "malloc";
+    Module *module = op->getFunction()->getModule();
+    Function *allocFunc = module->getNamedFunction(allocatorName);
+    if (!allocFunc) {
+      auto allocatorType =
+          alignment ? rewriter.getFunctionType(
+                          ArrayRef<Type>{getIndexType(), getIndexType()},
+                          getVoidPtrType())
+                    : rewriter.getFunctionType(getIndexType(),
+                                               getVoidPtrType());
+      allocFunc =
+          new Function(rewriter.getUnknownLoc(), allocatorName, allocatorType);
+      module->getFunctions().push_back(allocFunc);
+    }
+
+    SmallVector<Value *, 2> allocArgs;
+    if (alignment) {
+      // aligned_alloc requires the size to be a multiple of the alignment;
+      // round it up.
+      Value *alignmentValue =
+          createIndexConstant(rewriter, op->getLoc(), alignment);
+      Value *bumped = rewriter.create<LLVM::AddOp>(
+          op->getLoc(), getIndexType(),
+          ArrayRef<Value *>{cumulativeSize,
+                            createIndexConstant(rewriter, op->getLoc(),
+                                                alignment - 1)});
+      Value *rem = rewriter.create<LLVM::URemOp>(
+          op->getLoc(), getIndexType(),
+          ArrayRef<Value *>{bumped, alignmentValue});
+      Value *roundedSize = rewriter.create<LLVM::SubOp>(
+          op->getLoc(), getIndexType(), ArrayRef<Value *>{bumped, rem});
+      allocArgs.assign({alignmentValue, roundedSize});
+    } else {
+      allocArgs.push_back(cumulativeSize);
     }
 
     // Allocate the underlying buffer and store a pointer to it in the MemRef
@@ -455,8 +552,8 @@ struct AllocOpLowering : public LLVMLegalizationPattern<AllocOp> {
     Value *allocated =
         rewriter
             .create<LLVM::CallOp>(op->getLoc(), getVoidPtrType(),
-                                  rewriter.getFunctionAttr(mallocFunc),
-                                  cumulativeSize)
+                                  rewriter.getFunctionAttr(allocFunc),
+                                  allocArgs)
             .getResult(0);
     auto structElementType = lowering.convertType(elementType);
     auto elementPtrType =
@@ -501,6 +598,14 @@ struct DeallocOpLowering : public LLVMLegalizationPattern<DeallocOp> {
     assert(operands.size() == 1 && "dealloc takes one operand");
     OperandAdaptor<DeallocOp> transformed(operands);
 
+    // Stack-promoted buffers are reclaimed automatically on return.
+    auto *sourceOp = op->getOperand(0)->getDefiningOp();
+    if (sourceOp && isa<AllocOp>(sourceOp) &&
+        shouldPromoteToStack(cast<AllocOp>(sourceOp))) {
+      rewriter.replaceOp(op, llvm::None);
+      return matchSuccess();
+    }
+
     // Insert the `free` declaration if it is not already present.
     Function *freeFunc =
         op->getFunction()->getModule()->getNamedFunction("free");
@@ -524,6 +629,84 @@ struct DeallocOpLowering : public LLVMLegalizationPattern<DeallocOp> {
   }
 };
 
+// A `parallel_call` is converted into a call to the `mlir_parallel_for`
+// runtime entry point. The callee address and the captured operands are
+// passed through a generic (i8*, index, index, index, index*) signature -
+// operands are widened to machine words and stored into a stack array - so a
+// single runtime symbol serves callees of any arity.
+struct ParallelCallOpLowering : public LLVMLegalizationPattern<ParallelCallOp> {
+  using LLVMLegalizationPattern<ParallelCallOp>::LLVMLegalizationPattern;
+
+  PatternMatchResult matchAndRewrite(Operation *op, ArrayRef<Value *> operands,
+                                     PatternRewriter &rewriter) const override {
+    auto parallelCallOp = cast<ParallelCallOp>(op);
+    auto loc = op->getLoc();
+    Module *module = op->getFunction()->getModule();
+    Function *callee = module->getNamedFunction(parallelCallOp.getCallee());
+    if (!callee)
+      return matchFailure();
+
+    auto indexType = getIndexType();
+    auto wordPtrType = indexType.getPointerTo();
+
+    // Insert the declaration of the runtime dispatcher if it is not already
+    // present.
+    Function *runtimeFunc = module->getNamedFunction("mlir_parallel_for");
+    if (!runtimeFunc) {
+      auto runtimeType = rewriter.getFunctionType(
+          ArrayRef<Type>{getVoidPtrType(), indexType, indexType, indexType,
+                         wordPtrType},
+          {});
+      runtimeFunc = new Function(rewriter.getUnknownLoc(), "mlir_parallel_for",
+                                 runtimeType);
+      module->getFunctions().push_back(runtimeFunc);
+    }
+
+    // Take the address of the outlined body and erase its type.
+    Value *fnPtr = rewriter.create<LLVM::ConstantOp>(
+        loc, lowering.convertType(callee->getType()),
+        rewriter.getFunctionAttr(callee));
+    Value *rawFnPtr = rewriter.create<LLVM::BitcastOp>(
+        loc, getVoidPtrType(), ArrayRef<Value *>(fnPtr));
+
+    // Pack the captured operands into a word array. The alloca goes into the
+    // entry block so that dispatches inside already-lowered loops do not grow
+    // the stack per iteration.
+    unsigned numCaptures = operands.size() - 2;
+    auto savedIp = rewriter.saveInsertionPoint();
+    rewriter.setInsertionPointToStart(&op->getFunction()->front());
+    Value *arraySize =
+        createIndexConstant(rewriter, loc, numCaptures ? numCaptures : 1);
+    Value *argsArray =
+        rewriter.create<LLVM::AllocaOp>(loc, wordPtrType, arraySize);
+    rewriter.restoreInsertionPoint(savedIp);
+    for (unsigned i = 0; i != numCaptures; ++i) {
+      Value *value = operands[2 + i];
+      auto valueType = value->getType().cast<LLVM::LLVMType>();
+      if (valueType.getUnderlyingType()->isPointerTy())
+        value = rewriter.create<LLVM::PtrToIntOp>(loc, indexType,
+                                                  ArrayRef<Value *>(value));
+      else if (valueType.getUnderlyingType() !=
+               indexType.getUnderlyingType())
+        value = rewriter.create<LLVM::ZExtOp>(loc, indexType,
+                                              ArrayRef<Value *>(value));
+      Value *slot = rewriter.create<LLVM::GEPOp>(
+          loc, wordPtrType,
+          ArrayRef<Value *>{argsArray, createIndexConstant(rewriter, loc, i)},
+          ArrayRef<NamedAttribute>{});
+      rewriter.create<LLVM::StoreOp>(loc, value, slot);
+    }
+
+    Value *numArgs = createIndexConstant(rewriter, loc, numCaptures);
+    rewriter.create<LLVM::CallOp>(
+        loc, ArrayRef<Type>(), rewriter.getFunctionAttr(runtimeFunc),
+        ArrayRef<Value *>{rawFnPtr, operands[0], operands[1], numArgs,
+                          argsArray});
+    rewriter.replaceOp(op, llvm::None);
+    return matchSuccess();
+  }
+};
+
 struct MemRefCastOpLowering : public LLVMLegalizationPattern<MemRefCastOp> {
   using LLVMLegalizationPattern<MemRefCastOp>::LLVMLegalizationPattern;
 
@@ -790,6 +973,41 @@ struct StoreOpLowering : public LoadStoreOpLowering<StoreOp> {
   }
 };
 
+// Prefetch operation is lowered to obtaining a pointer to the indexed element
+// and passing it to the llvm.prefetch intrinsic along with the read/write and
+// locality attributes as i32 immediates.
+struct PrefetchOpLowering : public LoadStoreOpLowering<PrefetchOp> {
+  using Base::Base;
+
+  PatternMatchResult matchAndRewrite(Operation *op, ArrayRef<Value *> operands,
+                                     PatternRewriter &rewriter) const override {
+    auto prefetchOp = cast<PrefetchOp>(op);
+    OperandAdaptor<PrefetchOp> transformed(operands);
+    auto type = prefetchOp.getMemRefType();
+    auto loc = op->getLoc();
+
+    Value *dataPtr = getDataPtr(loc, type, transformed.memref(),
+                                transformed.indices(), rewriter, getModule());
+    Value *bytePtr = rewriter.create<LLVM::BitcastOp>(
+        loc, getVoidPtrType(), ArrayRef<Value *>(dataPtr));
+
+    auto i32Type = LLVM::LLVMType::getInt32Ty(&getDialect());
+    auto createI32Constant = [&](int32_t value) -> Value * {
+      return rewriter.create<LLVM::ConstantOp>(
+          loc, i32Type, rewriter.getI32IntegerAttr(value));
+    };
+    Value *isWrite = createI32Constant(prefetchOp.isWrite());
+    Value *localityHint = createI32Constant(prefetchOp.getLocalityHint());
+    // The last intrinsic operand distinguishes instruction (0) from data (1)
+    // cache prefetches; memref accesses always target the data cache.
+    Value *isData = createI32Constant(1);
+
+    rewriter.replaceOpWithNewOp<LLVM::PrefetchOp>(op, bytePtr, isWrite,
+                                                  localityHint, isData);
+    return matchSuccess();
+  }
+};
+
 // The lowering of index_cast becomes an integer conversion since index becomes
 // an integer.  If the bit width of the source and target integer types is the
 // same, just erase the cast.  If the target type is wider, sign-extend the
@@ -929,9 +1147,8 @@ static void ensureDistinctSuccessors(Block &bb) {
           terminator->getSuccessorOperands(*position));
       builder.create<BranchOp>(terminator->getLoc(), successor.first, operands);
       terminator->setSuccessor(dummyBlock, *position);
-      for (int i = 0, e = terminator->getNumSuccessorOperands(*position); i < e;
-           ++i)
-        terminator->eraseSuccessorOperand(*position, i);
+      terminator->eraseSuccessorOperands(
+          *position, 0, terminator->getNumSuccessorOperands(*position));
     }
   }
 }
@@ -954,14 +1171,33 @@ void mlir::populateStdToLLVMConversionPatterns(
       CondBranchOpLowering, ConstLLVMOpLowering, DeallocOpLowering,
       DimOpLowering, DivISOpLowering, DivIUOpLowering, DivFOpLowering,
       IndexCastOpLowering, LoadOpLowering, MemRefCastOpLowering, MulFOpLowering,
-      MulIOpLowering, OrOpLowering, RemISOpLowering, RemIUOpLowering,
-      RemFOpLowering, ReturnOpLowering, SelectOpLowering, StoreOpLowering,
+      MulIOpLowering, OrOpLowering, ParallelCallOpLowering, PrefetchOpLowering,
+      RemISOpLowering,
+      RemIUOpLowering, RemFOpLowering, ReturnOpLowering, SelectOpLowering,
+      StoreOpLowering,
       SubFOpLowering, SubIOpLowering,
       XOrOpLowering>::build(patterns, *converter.getDialect(), converter);
 }
 
-// Convert types using the stored LLVM IR module.
-Type LLVMTypeConverter::convertType(Type t) { return convertStandardType(t); }
+// Convert types using the stored LLVM IR module. Memoizes successful
+// conversions; with uniqued source types this collapses the repeated
+// conversion of identical memref and function types to a hash lookup.
+Type LLVMTypeConverter::convertType(Type t) {
+  auto cached = conversionCache.find(t);
+  if (cached != conversionCache.end())
+    return cached->second;
+  Type converted = convertStandardType(t);
+  if (converted)
+    conversionCache.insert({t, converted});
+  return converted;
+}
+
+// Warm the conversion cache with every type appearing in a function signature
+// in the module, including the element types reached recursively.
+void LLVMTypeConverter::preconvertSignatureTypes(Module &m) {
+  for (auto &func : m)
+    convertType(func.getType());
+}
 
 // Create an LLVM IR structure type if there is more than one result.
 Type LLVMTypeConverter::packFunctionResults(ArrayRef<Type> types) {
@@ -1014,6 +1250,10 @@ struct LLVMLoweringPass : public ModulePass<LLVMLoweringPass> {
     LLVM::ensureDistinctSuccessors(&m);
 
     LLVMTypeConverter converter(&getContext());
+    // Convert all signature types up front so the pattern-driven conversion
+    // below hits the conversion cache for function and memref types.
+    converter.preconvertSignatureTypes(m);
+
     OwningRewritePatternList patterns;
     populateStdToLLVMConversionPatterns(converter, patterns);
 
@@ -58,6 +58,30 @@ ScopedContext *&mlir::edsc::ScopedContext::getCurrentScopedContext() {
   return context;
 }
 
+ScopedContext *mlir::edsc::ScopedContext::createNestedScope(
+    OpBuilder &builder, OpBuilder::InsertPoint newInsertPt, Location location) {
+  ScopedContext *root = getCurrentScopedContext();
+  assert(root && "Unexpected Null ScopedContext");
+  while (root->enclosingScopedContext)
+    root = root->enclosingScopedContext;
+  void *slot = root->freeScopeSlots.empty()
+                   ? root->scopeArena.Allocate(sizeof(ScopedContext),
+                                               alignof(ScopedContext))
+                   : root->freeScopeSlots.pop_back_val();
+  return new (slot) ScopedContext(builder, newInsertPt, location);
+}
+
+void mlir::edsc::ScopedContext::destroyNestedScope(ScopedContext *scope) {
+  // Find the arena owner before running the destructor; the outermost scope
+  // is never itself arena-allocated.
+  ScopedContext *root = scope;
+  while (root->enclosingScopedContext)
+    root = root->enclosingScopedContext;
+  assert(root != scope && "Expected an arena-allocated nested scope");
+  scope->~ScopedContext();
+  root->freeScopeSlots.push_back(scope);
+}
+
 OpBuilder &mlir::edsc::ScopedContext::getBuilder() {
   assert(ScopedContext::getCurrentScopedContext() &&
          "Unexpected Null ScopedContext");
@@ -24,15 +24,29 @@
 #include "mlir/IR/Module.h"
 #include "mlir/Target/LLVMIR.h"
 
+#include "llvm/ExecutionEngine/Orc/CompileOnDemandLayer.h"
 #include "llvm/ExecutionEngine/Orc/CompileUtils.h"
 #include "llvm/ExecutionEngine/Orc/ExecutionUtils.h"
 #include "llvm/ExecutionEngine/Orc/IRCompileLayer.h"
 #include "llvm/ExecutionEngine/Orc/IRTransformLayer.h"
+#include "llvm/ExecutionEngine/Orc/IndirectionUtils.h"
 #include "llvm/ExecutionEngine/Orc/JITTargetMachineBuilder.h"
+#include "llvm/ExecutionEngine/Orc/LazyReexports.h"
 #include "llvm/ExecutionEngine/Orc/RTDyldObjectLinkingLayer.h"
 #include "llvm/ExecutionEngine/SectionMemoryManager.h"
+#include "llvm/Bitcode/BitcodeReader.h"
+#include "llvm/Bitcode/BitcodeWriter.h"
 #include "llvm/IR/IRBuilder.h"
+#include "llvm/IR/Intrinsics.h"
+#include "llvm/Object/SymbolSize.h"
+#include "llvm/Support/CodeGen.h"
 #include "llvm/Support/Error.h"
+#include "llvm/Support/FileSystem.h"
+#include "llvm/Support/Format.h"
+#include "llvm/Support/MD5.h"
+#include "llvm/Support/Mutex.h"
+#include "llvm/Support/Path.h"
+#include "llvm/Support/Process.h"
 #include "llvm/Support/TargetRegistry.h"
 
 using namespace mlir;
@@ -67,6 +81,67 @@ public:
 private:
   llvm::orc::ExecutionSession &session;
 };
+
+// Called from a lazy call-through stub when the function it stands in for
+// failed to compile.  At that point the stub has no caller to report the error
+// to, so terminate the process.
+static void handleLazyCompileFailure() {
+  llvm::errs() << "lazy compilation error: could not materialize function\n";
+  exit(1);
+}
+
+// Append one "<start> <size> <name>" line per function symbol of the freshly
+// loaded object to /tmp/perf-<pid>.map, the format perf uses to symbolize
+// anonymous executable mappings. The file is shared by all engines in the
+// process, so serialize writers.
+static void writePerfMapEntries(
+    const llvm::object::ObjectFile &obj,
+    const llvm::RuntimeDyld::LoadedObjectInfo &loadedObjInfo) {
+  static llvm::sys::SmartMutex<true> perfMapMutex;
+  llvm::sys::SmartScopedLock<true> lock(perfMapMutex);
+
+  llvm::SmallString<64> path;
+  llvm::raw_svector_ostream(path)
+      << "/tmp/perf-" << llvm::sys::Process::getProcessId() << ".map";
+  std::error_code ec;
+  llvm::raw_fd_ostream os(path, ec, llvm::sys::fs::F_Append);
+  if (ec) {
+    llvm::errs() << "Could not write perf map " << path << ": " << ec.message()
+                 << "\n";
+    return;
+  }
+
+  for (const auto &symSize : llvm::object::computeSymbolSizes(obj)) {
+    const llvm::object::SymbolRef &sym = symSize.first;
+    auto type = sym.getType();
+    if (!type || *type != llvm::object::SymbolRef::ST_Function) {
+      if (!type)
+        llvm::consumeError(type.takeError());
+      continue;
+    }
+    auto name = sym.getName();
+    auto addr = sym.getAddress();
+    auto section = sym.getSection();
+    if (!name || !addr || !section || *section == obj.section_end()) {
+      if (!name)
+        llvm::consumeError(name.takeError());
+      if (!addr)
+        llvm::consumeError(addr.takeError());
+      if (!section)
+        llvm::consumeError(section.takeError());
+      continue;
+    }
+
+    // Translate the symbol's file address into its loaded address.
+    uint64_t sectionLoadAddr = loadedObjInfo.getSectionLoadAddress(**section);
+    if (sectionLoadAddr == 0)
+      continue;
+    uint64_t loadAddr = sectionLoadAddr + (*addr - (*section)->getAddress());
+    os << llvm::format("%llx %llx ", (unsigned long long)loadAddr,
+                       (unsigned long long)symSize.second)
+       << *name << "\n";
+  }
+}
 } // end anonymous namespace
 
 namespace mlir {
@@ -126,50 +201,119 @@ public:
   // using the data layout provided as `dataLayout`.
   // Setup the object layer to use our custom memory manager in order to
   // resolve calls to library functions present in the process.
+  // If `lazyCompilation` is set, modules are added behind a
+  // compile-on-demand layer so each function is only compiled when first
+  // called or looked up.
+  // If `perfMapNotifications` is set, loaded objects are reported to the
+  // perf(1) map file of this process so JIT'd frames can be symbolized.
   OrcJIT(llvm::orc::JITTargetMachineBuilder machineBuilder,
          llvm::DataLayout layout, IRTransformer transform,
-         ArrayRef<StringRef> sharedLibPaths)
-      : irTransformer(transform),
+         ArrayRef<StringRef> sharedLibPaths, StringRef cacheObjectPath,
+         bool lazyCompilation, bool perfMapNotifications)
+      : irTransformer(transform), cacheObjectPath(cacheObjectPath),
+        targetTriple(machineBuilder.getTargetTriple()),
         objectLayer(
             session,
             [this]() { return llvm::make_unique<MemoryManager>(session); }),
-        compileLayer(
-            session, objectLayer,
-            llvm::orc::ConcurrentIRCompiler(std::move(machineBuilder))),
+        compileLayer(session, objectLayer,
+                     makeCachingCompileFunction(std::move(machineBuilder))),
         transformLayer(session, compileLayer, makeIRTransformFunction()),
         dataLayout(layout), mangler(session, this->dataLayout),
         threadSafeCtx(llvm::make_unique<llvm::LLVMContext>()) {
     session.getMainJITDylib().setGenerator(
         SearchGenerator(layout.getGlobalPrefix()));
+    if (perfMapNotifications)
+      objectLayer.setNotifyLoaded(
+          [](llvm::orc::VModuleKey, const llvm::object::ObjectFile &obj,
+             const llvm::RuntimeDyld::LoadedObjectInfo &loadedObjInfo) {
+            writePerfMapEntries(obj, loadedObjInfo);
+          });
+    if (lazyCompilation)
+      setupLazyCompilation();
     loadLibraries(sharedLibPaths);
   }
 
-  // Create a JIT engine for the current host.
+  // Create a JIT engine for the current host. If `fastCodegen` is set, the
+  // target machine is configured for minimal codegen effort, trading code
+  // quality for compile time.
   static Expected<std::unique_ptr<OrcJIT>>
-  createDefault(IRTransformer transformer, ArrayRef<StringRef> sharedLibPaths) {
+  createDefault(IRTransformer transformer, ArrayRef<StringRef> sharedLibPaths,
+                StringRef cacheObjectPath = "", bool lazyCompilation = false,
+                bool fastCodegen = false, bool perfMapNotifications = false) {
     auto machineBuilder = llvm::orc::JITTargetMachineBuilder::detectHost();
     if (!machineBuilder)
       return machineBuilder.takeError();
+    if (fastCodegen)
+      machineBuilder->setCodeGenOptLevel(llvm::CodeGenOpt::None);
 
     auto dataLayout = machineBuilder->getDefaultDataLayoutForTarget();
     if (!dataLayout)
       return dataLayout.takeError();
 
-    return llvm::make_unique<OrcJIT>(std::move(*machineBuilder),
-                                     std::move(*dataLayout), transformer,
-                                     sharedLibPaths);
+    return llvm::make_unique<OrcJIT>(
+        std::move(*machineBuilder), std::move(*dataLayout), transformer,
+        sharedLibPaths, cacheObjectPath, lazyCompilation, perfMapNotifications);
   }
 
-  // Add an LLVM module to the main library managed by the JIT engine.
+  // Add an LLVM module to the main library managed by the JIT engine.  When
+  // lazy compilation is enabled, the module goes through the on-demand layer
+  // and only extract-and-compile-per-function work happens at lookup time.
   Error addModule(std::unique_ptr<llvm::Module> M) {
-    return transformLayer.add(
-        session.getMainJITDylib(),
-        llvm::orc::ThreadSafeModule(std::move(M), threadSafeCtx));
+    auto module = llvm::orc::ThreadSafeModule(std::move(M), threadSafeCtx);
+    if (onDemandLayer)
+      return onDemandLayer->add(session.getMainJITDylib(), std::move(module));
+    return transformLayer.add(session.getMainJITDylib(), std::move(module));
+  }
+
+  // Parse the given bitcode into this JIT's context and add the resulting
+  // module to the main library.
+  Error addModuleFromBitcode(StringRef bitcode) {
+    auto buffer = llvm::MemoryBuffer::getMemBuffer(
+        bitcode, "tiered-bitcode", /*RequiresNullTerminator=*/false);
+    auto module = llvm::parseBitcodeFile(buffer->getMemBufferRef(),
+                                         *threadSafeCtx.getContext());
+    if (!module)
+      return module.takeError();
+    return addModule(std::move(*module));
   }
 
-  // Lookup a symbol in the main library managed by the JIT engine.
+  // Add a precompiled object file to the main library managed by the JIT
+  // engine, bypassing IR transformation and compilation.
+  Error addObjectFile(std::unique_ptr<llvm::MemoryBuffer> obj) {
+    return objectLayer.add(session.getMainJITDylib(), std::move(obj));
+  }
+
+  // Add an LLVM module in its own library, layered in front of the libraries
+  // added before it. References of the new module resolve against the earlier
+  // libraries (and the process), while its own definitions take precedence in
+  // `lookup`, so re-adding an updated module swaps the code without
+  // recompiling anything else. Orc does not support unloading materialized
+  // code, so superseded definitions stay resident until the session is
+  // destroyed.
+  Error addShadowingModule(std::unique_ptr<llvm::Module> M) {
+    std::string libName =
+        ("incremental." + llvm::Twine(incrementalLibs.size())).str();
+    auto &lib = session.createJITDylib(libName);
+    for (auto it = incrementalLibs.rbegin(), e = incrementalLibs.rend();
+         it != e; ++it)
+      lib.addToSearchOrder(**it);
+    lib.addToSearchOrder(session.getMainJITDylib());
+    incrementalLibs.push_back(&lib);
+
+    auto module = llvm::orc::ThreadSafeModule(std::move(M), threadSafeCtx);
+    return transformLayer.add(lib, std::move(module));
+  }
+
+  // Lookup a symbol across the libraries managed by the JIT engine, searching
+  // the incrementally added libraries from newest to oldest before the main
+  // library so that re-added definitions shadow the ones they replace.
   Expected<llvm::JITEvaluatedSymbol> lookup(StringRef Name) {
-    return session.lookup({&session.getMainJITDylib()}, mangler(Name.str()));
+    if (incrementalLibs.empty())
+      return session.lookup({&session.getMainJITDylib()}, mangler(Name.str()));
+    llvm::SmallVector<llvm::orc::JITDylib *, 4> searchOrder(
+        incrementalLibs.rbegin(), incrementalLibs.rend());
+    searchOrder.push_back(&session.getMainJITDylib());
+    return session.lookup(searchOrder, mangler(Name.str()));
   }
 
 private:
@@ -189,15 +333,68 @@ private:
     };
   }
 
+  // Wrap the IR compiler into a function that also writes the produced object
+  // file to `cacheObjectPath` when one was configured, so byte-identical
+  // modules can skip compilation in later runs.
+  llvm::orc::IRCompileLayer::CompileFunction
+  makeCachingCompileFunction(llvm::orc::JITTargetMachineBuilder machineBuilder) {
+    auto compiler = std::make_shared<llvm::orc::ConcurrentIRCompiler>(
+        std::move(machineBuilder));
+    return [this, compiler](llvm::Module &module)
+               -> Expected<std::unique_ptr<llvm::MemoryBuffer>> {
+      std::unique_ptr<llvm::MemoryBuffer> object = (*compiler)(module);
+      if (object && !cacheObjectPath.empty()) {
+        std::error_code ec;
+        llvm::raw_fd_ostream os(cacheObjectPath, ec, llvm::sys::fs::F_None);
+        if (ec)
+          llvm::errs() << "Could not write cached object " << cacheObjectPath
+                       << ": " << ec.message() << "\n";
+        else
+          os << object->getBuffer();
+      }
+      return std::move(object);
+    };
+  }
+
+  // Set up the lazy call-through manager and the compile-on-demand layer for
+  // the target.  On targets without call-through support, report the error
+  // and fall back to eager compilation.
+  void setupLazyCompilation() {
+    auto callThroughManager = llvm::orc::createLocalLazyCallThroughManager(
+        targetTriple, session,
+        reinterpret_cast<llvm::JITTargetAddress>(&handleLazyCompileFailure));
+    if (!callThroughManager) {
+      llvm::errs() << "Could not set up lazy compilation: "
+                   << callThroughManager.takeError()
+                   << "; falling back to eager compilation\n";
+      return;
+    }
+    lazyCallThroughManager = std::move(*callThroughManager);
+    onDemandLayer = llvm::make_unique<llvm::orc::CompileOnDemandLayer>(
+        session, transformLayer, *lazyCallThroughManager,
+        llvm::orc::createLocalIndirectStubsManagerBuilder(targetTriple));
+  }
+
   // Iterate over shareLibPaths and load the corresponding libraries for symbol
   // resolution.
   void loadLibraries(ArrayRef<StringRef> sharedLibPaths);
 
   IRTransformer irTransformer;
+  // Path of the file the compiled object is written to and looked up from;
+  // empty when object caching is disabled.
+  std::string cacheObjectPath;
+  llvm::Triple targetTriple;
   llvm::orc::ExecutionSession session;
   llvm::orc::RTDyldObjectLinkingLayer objectLayer;
   llvm::orc::IRCompileLayer compileLayer;
   llvm::orc::IRTransformLayer transformLayer;
+  // Set up only when lazy compilation was requested and is supported on the
+  // target.
+  std::unique_ptr<llvm::orc::LazyCallThroughManager> lazyCallThroughManager;
+  std::unique_ptr<llvm::orc::CompileOnDemandLayer> onDemandLayer;
+  // Libraries holding incrementally added modules, oldest first. The
+  // JITDylibs are owned by the session.
+  std::vector<llvm::orc::JITDylib *> incrementalLibs;
   llvm::DataLayout dataLayout;
   llvm::orc::MangleAndInterner mangler;
   llvm::orc::ThreadSafeContext threadSafeCtx;
@@ -318,18 +515,126 @@ void packFunctionArguments(llvm::Module *module) {
   }
 }
 
-// Out of line for PIMPL unique_ptr.
-ExecutionEngine::~ExecutionEngine() = default;
+// Inject invocation and cycle counters into every defined function of the
+// module. For a function `foo`, creates the i64 globals
+// `__mlir_prof_count_foo` and `__mlir_prof_cycles_foo`; the entry block
+// increments the former and reads the cycle counter, and every return adds
+// the elapsed cycles to the latter. The updates are not atomic: under
+// concurrent callers the counters are statistical, which is acceptable for
+// profiling.
+static void instrumentProfileCounters(llvm::Module *module) {
+  auto &ctx = module->getContext();
+  llvm::IRBuilder<> builder(ctx);
+  auto *i64Ty = builder.getInt64Ty();
+  auto *readCycles = llvm::Intrinsic::getDeclaration(
+      module, llvm::Intrinsic::readcyclecounter);
+
+  for (auto &func : module->getFunctionList()) {
+    // Skip declarations and the packed interface wrappers, which only forward
+    // to the functions being counted.
+    if (func.isDeclaration() || func.getName().startswith("_mlir_"))
+      continue;
+
+    auto *countVar = new llvm::GlobalVariable(
+        *module, i64Ty, /*isConstant=*/false,
+        llvm::GlobalValue::ExternalLinkage, builder.getInt64(0),
+        "__mlir_prof_count_" + func.getName().str());
+    auto *cyclesVar = new llvm::GlobalVariable(
+        *module, i64Ty, /*isConstant=*/false,
+        llvm::GlobalValue::ExternalLinkage, builder.getInt64(0),
+        "__mlir_prof_cycles_" + func.getName().str());
+
+    // Count the invocation and read the cycle counter on entry.
+    auto &entryBlock = func.getEntryBlock();
+    builder.SetInsertPoint(&entryBlock, entryBlock.getFirstInsertionPt());
+    llvm::Value *count = builder.CreateLoad(countVar);
+    builder.CreateStore(builder.CreateAdd(count, builder.getInt64(1)),
+                        countVar);
+    llvm::Value *entryCycles = builder.CreateCall(readCycles);
+
+    // Accumulate the elapsed cycles before every return. The entry block
+    // dominates all returns, so `entryCycles` is always available.
+    for (auto &block : func) {
+      auto *ret = llvm::dyn_cast<llvm::ReturnInst>(block.getTerminator());
+      if (!ret)
+        continue;
+      builder.SetInsertPoint(ret);
+      llvm::Value *exitCycles = builder.CreateCall(readCycles);
+      llvm::Value *cycles = builder.CreateLoad(cyclesVar);
+      builder.CreateStore(
+          builder.CreateAdd(cycles,
+                            builder.CreateSub(exitCycles, entryCycles)),
+          cyclesVar);
+    }
+  }
+}
+
+ExecutionEngine::~ExecutionEngine() {
+  // Wait for in-flight asynchronous lookups; they use the JIT that is about
+  // to be destroyed.
+  for (auto &thread : asyncLookupThreads)
+    thread.join();
+  if (recompileThread.joinable())
+    recompileThread.join();
+}
+
+// Returns the path of the cached object file for `m` inside `cacheDir`. The
+// key is an MD5 hash of the module's textual form; printing is deterministic,
+// so byte-identical modules map to the same object file across processes.
+static std::string getCachedObjectPath(Module &m, StringRef cacheDir) {
+  std::string printed;
+  llvm::raw_string_ostream os(printed);
+  m.print(os);
+  llvm::MD5 hash;
+  llvm::MD5::MD5Result result;
+  hash.update(os.str());
+  hash.final(result);
+  llvm::SmallString<128> path(cacheDir);
+  llvm::sys::path::append(path, result.digest());
+  path += ".o";
+  return path.str().str();
+}
 
 Expected<std::unique_ptr<ExecutionEngine>>
 ExecutionEngine::create(Module *m,
                         std::function<llvm::Error(llvm::Module *)> transformer,
-                        ArrayRef<StringRef> sharedLibPaths) {
+                        ArrayRef<StringRef> sharedLibPaths,
+                        StringRef objectCacheDir, bool enableLazyCompilation,
+                        unsigned tieredRecompileThreshold, bool enablePerfMap,
+                        bool enableProfileCounters) {
+  std::string cacheObjectPath;
+  if (!objectCacheDir.empty())
+    cacheObjectPath = getCachedObjectPath(*m, objectCacheDir);
+
   auto engine = llvm::make_unique<ExecutionEngine>();
-  auto expectedJIT = impl::OrcJIT::createDefault(transformer, sharedLibPaths);
+  // In the tiered mode, the first tier skips the transformer entirely and
+  // uses quick codegen; the transformer is applied by the background
+  // recompile instead.
+  bool tiered = tieredRecompileThreshold != 0;
+  // Lazy compilation produces one object per function, so the per-module
+  // cache key does not apply to what gets compiled; keep reading existing
+  // whole-module cache entries below but do not write new ones.
+  auto expectedJIT = impl::OrcJIT::createDefault(
+      tiered ? impl::OrcJIT::IRTransformer() : transformer, sharedLibPaths,
+      enableLazyCompilation ? StringRef() : StringRef(cacheObjectPath),
+      enableLazyCompilation, /*fastCodegen=*/tiered, enablePerfMap);
   if (!expectedJIT)
     return expectedJIT.takeError();
 
+  // On a cache hit, load the precompiled object and skip translation,
+  // optimization and codegen entirely.
+  if (!cacheObjectPath.empty()) {
+    if (auto buffer = llvm::MemoryBuffer::getFile(cacheObjectPath)) {
+      if (auto err = (*expectedJIT)->addObjectFile(std::move(*buffer)))
+        return std::move(err);
+      engine->jit = std::move(*expectedJIT);
+      return std::move(engine);
+    }
+    // Cache miss: make sure the directory exists so the compiled object can
+    // be written once codegen runs.
+    llvm::sys::fs::create_directories(objectCacheDir);
+  }
+
   auto llvmModule = translateModuleToLLVMIR(*m);
   if (!llvmModule)
     return make_string_error("could not convert to LLVM IR");
@@ -338,6 +643,21 @@ ExecutionEngine::create(Module *m,
   // associated with it.
   setupTargetTriple(llvmModule.get());
   packFunctionArguments(llvmModule.get());
+  if (enableProfileCounters)
+    instrumentProfileCounters(llvmModule.get());
+
+  // Capture the unoptimized bitcode for the tiered mode, so the optimized
+  // tier can be rebuilt later without the MLIR module, which the caller may
+  // have destroyed by then.
+  if (tiered) {
+    llvm::raw_string_ostream os(engine->tieredBitcode);
+    llvm::WriteBitcodeToFile(*llvmModule, os);
+    os.flush();
+    engine->tieredRecompileThreshold = tieredRecompileThreshold;
+    engine->optimizedTransformer = transformer;
+    for (StringRef path : sharedLibPaths)
+      engine->tieredSharedLibPaths.push_back(path.str());
+  }
 
   if (auto err = (*expectedJIT)->addModule(std::move(llvmModule)))
     return std::move(err);
@@ -346,8 +666,49 @@ ExecutionEngine::create(Module *m,
   return std::move(engine);
 }
 
+llvm::Error ExecutionEngine::addModule(Module *m) {
+  auto llvmModule = translateModuleToLLVMIR(*m);
+  if (!llvmModule)
+    return make_string_error("could not convert to LLVM IR");
+  setupTargetTriple(llvmModule.get());
+  packFunctionArguments(llvmModule.get());
+
+  // Remember which functions the module (re)defines: lookups of these must
+  // not be answered from the optimized tier, which was built from the
+  // creation module and would return the superseded definition.
+  {
+    llvm::sys::SmartScopedLock<true> lock(incrementalNamesMutex);
+    for (llvm::Function &func : llvmModule->getFunctionList())
+      if (!func.isDeclaration() && !func.getName().startswith("_mlir_"))
+        incrementalNames.insert(func.getName());
+  }
+
+  return jit->addShadowingModule(std::move(llvmModule));
+}
+
 Expected<void (*)(void **)> ExecutionEngine::lookup(StringRef name) const {
-  auto expectedSymbol = jit->lookup(makePackedFunctionName(name));
+  std::string packedName = makePackedFunctionName(name);
+
+  // Functions defined by incrementally added modules live in the base tier
+  // only; see addModule.
+  bool incremental = false;
+  {
+    llvm::sys::SmartScopedLock<true> lock(incrementalNamesMutex);
+    incremental = incrementalNames.count(name) != 0;
+  }
+
+  // Prefer the optimized tier once the background recompile has published it.
+  if (!incremental && optimizedReady.load(std::memory_order_acquire)) {
+    if (auto expectedSymbol = optimizedJit->lookup(packedName)) {
+      if (auto fptr =
+              reinterpret_cast<void (*)(void **)>(expectedSymbol->getAddress()))
+        return fptr;
+    } else {
+      llvm::consumeError(expectedSymbol.takeError());
+    }
+  }
+
+  auto expectedSymbol = jit->lookup(packedName);
   if (!expectedSymbol)
     return expectedSymbol.takeError();
   auto rawFPtr = expectedSymbol->getAddress();
@@ -357,8 +718,96 @@ Expected<void (*)(void **)> ExecutionEngine::lookup(StringRef name) const {
   return fptr;
 }
 
+void ExecutionEngine::lookupAsync(
+    StringRef name,
+    std::function<void(Expected<void (*)(void **)>)> callback) {
+  // Concurrent lookups are safe: the execution session serializes its own
+  // state, and the compiler used by the compile layer supports concurrent
+  // compilation.
+  std::string ownedName = name.str();
+  asyncLookupThreads.emplace_back(
+      [this, ownedName, callback] { callback(lookup(ownedName)); });
+}
+
+void ExecutionEngine::recordInvocation(StringRef name) {
+  // Tiering is off, the recompile has already been kicked off, or there is no
+  // captured bitcode to recompile (e.g. the engine was loaded from a cached
+  // object).
+  if (tieredRecompileThreshold == 0 || tieredBitcode.empty() ||
+      recompileStarted.load(std::memory_order_relaxed))
+    return;
+
+  {
+    llvm::sys::SmartScopedLock<true> lock(invocationCountMutex);
+    if (++invocationCounts[name] < tieredRecompileThreshold)
+      return;
+  }
+
+  // Only the thread that wins the exchange starts the background recompile.
+  if (recompileStarted.exchange(true))
+    return;
+  recompileThread = std::thread([this] { buildOptimizedTier(); });
+}
+
+void ExecutionEngine::buildOptimizedTier() {
+  SmallVector<StringRef, 4> libs(tieredSharedLibPaths.begin(),
+                                 tieredSharedLibPaths.end());
+  auto expectedJIT = impl::OrcJIT::createDefault(optimizedTransformer, libs);
+  if (!expectedJIT) {
+    llvm::errs() << "tiered recompilation failed: " << expectedJIT.takeError()
+                 << "\n";
+    return;
+  }
+  if (auto err = (*expectedJIT)->addModuleFromBitcode(tieredBitcode)) {
+    llvm::errs() << "tiered recompilation failed: " << err << "\n";
+    llvm::consumeError(std::move(err));
+    return;
+  }
+
+  // Force materialization of every function invoked so far on this thread, so
+  // callers never pay the optimized tier's compile time.
+  SmallVector<std::string, 4> names;
+  {
+    llvm::sys::SmartScopedLock<true> lock(invocationCountMutex);
+    for (const auto &entry : invocationCounts)
+      names.push_back(entry.first().str());
+  }
+  for (const std::string &name : names) {
+    if (auto symbol = (*expectedJIT)->lookup(makePackedFunctionName(name)))
+      (void)*symbol;
+    else
+      llvm::consumeError(symbol.takeError());
+  }
+
+  optimizedJit = std::move(*expectedJIT);
+  optimizedReady.store(true, std::memory_order_release);
+}
+
+Expected<uint64_t> ExecutionEngine::readProfileCounter(StringRef symbol) const {
+  // Read from the optimized tier when it is live, since that is where new
+  // invocations are counted.
+  auto &activeJit =
+      optimizedReady.load(std::memory_order_acquire) ? optimizedJit : jit;
+  auto expectedSymbol = activeJit->lookup(symbol);
+  if (!expectedSymbol)
+    return expectedSymbol.takeError();
+  auto *counter = reinterpret_cast<uint64_t *>(expectedSymbol->getAddress());
+  if (!counter)
+    return make_string_error("profile counter symbol is null");
+  return *counter;
+}
+
+Expected<uint64_t> ExecutionEngine::getInvocationCount(StringRef name) const {
+  return readProfileCounter(("__mlir_prof_count_" + name).str());
+}
+
+Expected<uint64_t> ExecutionEngine::getCycleCount(StringRef name) const {
+  return readProfileCounter(("__mlir_prof_cycles_" + name).str());
+}
+
 llvm::Error ExecutionEngine::invoke(StringRef name,
                                     MutableArrayRef<void *> args) {
+  recordInvocation(name);
   auto expectedFPtr = lookup(name);
   if (!expectedFPtr)
     return expectedFPtr.takeError();
@@ -368,3 +817,23 @@ llvm::Error ExecutionEngine::invoke(StringRef name,
 
   return llvm::Error::success();
 }
+
+void ExecutionEngine::PreparedCall::invokeBatch(
+    ArrayRef<MutableArrayRef<void *>> argSets) {
+  for (MutableArrayRef<void *> set : argSets) {
+    assert(set.size() == args.size() &&
+           "argument set size does not match the prepared call arity");
+    (*fptr)(set.data());
+  }
+}
+
+Expected<ExecutionEngine::PreparedCall>
+ExecutionEngine::prepare(StringRef name, ArrayRef<void *> args) {
+  // Count the preparation as one invocation so that hot prepared functions
+  // still contribute to triggering the tiered recompile.
+  recordInvocation(name);
+  auto expectedFPtr = lookup(name);
+  if (!expectedFPtr)
+    return expectedFPtr.takeError();
+  return PreparedCall(*expectedFPtr, args);
+}
@@ -92,6 +92,58 @@ mlir::allocateMemRefArguments(Function *func, float initialValue) {
   return args;
 }
 
+llvm::Expected<SmallVector<void *, 8>>
+mlir::bindMemRefArguments(Function *func, ArrayRef<float *> buffers) {
+  if (buffers.size() != func->getNumArguments())
+    return make_string_error("expected one buffer per function argument");
+
+  SmallVector<void *, 8> args;
+  args.reserve(func->getNumArguments());
+  for (const auto &arg : func->getArguments()) {
+    auto descriptor =
+        allocMemRefDescriptor(arg->getType(), /*allocateData=*/false);
+    if (!descriptor)
+      return descriptor.takeError();
+    // Alias the caller-owned buffer instead of allocating and copying.
+    (*descriptor)->data = buffers[args.size()];
+    args.push_back(*descriptor);
+  }
+
+  if (func->getType().getNumResults() > 1)
+    return make_string_error("functions with more than 1 result not supported");
+
+  for (Type resType : func->getType().getResults()) {
+    auto descriptor = allocMemRefDescriptor(resType, /*allocateData=*/false);
+    if (!descriptor)
+      return descriptor.takeError();
+    args.push_back(*descriptor);
+  }
+
+  return args;
+}
+
+void mlir::freeMemRefDescriptors(ArrayRef<void *> args) {
+  for (void *arg : args)
+    free(arg);
+}
+
+llvm::Expected<MemRefArgumentPack>
+mlir::MemRefArgumentPack::create(Function *func, ArrayRef<float *> buffers) {
+  auto args = bindMemRefArguments(func, buffers);
+  if (!args)
+    return args.takeError();
+  MemRefArgumentPack pack;
+  pack.args = std::move(*args);
+  return std::move(pack);
+}
+
+mlir::MemRefArgumentPack::~MemRefArgumentPack() { freeMemRefDescriptors(args); }
+
+void mlir::MemRefArgumentPack::rebind(unsigned index, float *buffer) {
+  assert(index < args.size() && "argument index out of range");
+  reinterpret_cast<StaticFloatMemRef *>(args[index])->data = buffer;
+}
+
 // Because the function can return the same descriptor as passed in arguments,
 // we check that we don't attempt to free the underlying data twice.
 void mlir::freeMemRefArguments(ArrayRef<void *> args) {
@@ -0,0 +1,331 @@
+//===- SharedMemoryStaging.cpp - Stage memref regions in shared memory ----===//
+//
+// Copyright 2019 The MLIR Authors.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+// =============================================================================
+//
+// This file implements a pass to stage memref regions that are reused inside
+// `gpu.launch` bodies through buffers in workgroup-shared memory - the GPU
+// analogue of DMA generation. Accessed read-only regions are copied into a
+// shared buffer ahead of the loop nest using them, the workgroup is
+// synchronized with a barrier, and the accesses are rewritten to read from the
+// buffer.
+//
+//===----------------------------------------------------------------------===//
+
+#include "mlir/AffineOps/AffineOps.h"
+#include "mlir/Analysis/AffineStructures.h"
+#include "mlir/Analysis/Utils.h"
+#include "mlir/GPU/GPUDialect.h"
+#include "mlir/GPU/Passes.h"
+#include "mlir/IR/Builders.h"
+#include "mlir/Pass/Pass.h"
+#include "mlir/StandardOps/Ops.h"
+#include "mlir/Transforms/Utils.h"
+#include "llvm/ADT/MapVector.h"
+#include "llvm/ADT/SmallPtrSet.h"
+#include "llvm/Support/CommandLine.h"
+#include "llvm/Support/Debug.h"
+
+#define DEBUG_TYPE "gpu-stage-shared-memory"
+
+using namespace mlir;
+using llvm::SmallMapVector;
+
+static llvm::cl::OptionCategory clOptionsCategory(DEBUG_TYPE " options");
+
+static llvm::cl::opt<unsigned> clSharedMemorySpace(
+    "gpu-shared-mem-space", llvm::cl::init(3),
+    llvm::cl::desc(
+        "Memory space identifier for workgroup-shared buffers (default: 3)"),
+    llvm::cl::cat(clOptionsCategory));
+
+static llvm::cl::opt<unsigned long long> clSharedMemCapacity(
+    "gpu-shared-mem-capacity", llvm::cl::init(48),
+    llvm::cl::desc(
+        "Workgroup-shared memory capacity in KiB (default: 48)"),
+    llvm::cl::cat(clOptionsCategory));
+
+namespace {
+
+/// Stages global memory regions accessed inside `gpu.launch` bodies through
+/// buffers in the workgroup-shared memory space. For each loop nest directly
+/// in a launch body, the regions read under it (and not written to) are
+/// copied into a shared buffer before the nest, all threads of the workgroup
+/// are synchronized, and the loads under the nest are rewritten to read from
+/// the buffer. The copies are what makes the elements reused across the
+/// threads of a workgroup (e.g. stencil halos) travel over the global memory
+/// interface only once per workgroup.
+struct GpuSharedMemoryStaging
+    : public FunctionPass<GpuSharedMemoryStaging> {
+  void runOnFunction() override;
+  void runOnLaunchOp(gpu::LaunchOp launchOp);
+  void runOnLoopNest(AffineForOp forOp);
+  bool stageRegion(const MemRefRegion &region, AffineForOp forOp);
+
+  // Shared memory still available for buffers in the launch being processed.
+  uint64_t remainingCapacityBytes;
+};
+
+} // end anonymous namespace
+
+FunctionPassBase *mlir::createGpuSharedMemoryStagingPass() {
+  return new GpuSharedMemoryStaging();
+}
+
+/// Constructs a region spanning the entire memref accessed by `opInst`.
+/// Returns false for dynamically shaped memref's, whose extents are unknown.
+/// This is the fallback when the access functions are not affine - typically
+/// because they involve workgroup/thread id values.
+static bool getFullMemRefAsRegion(Operation *opInst, MemRefRegion *region) {
+  auto loadOp = cast<LoadOp>(opInst);
+  auto memRefType = loadOp.getMemRefType();
+  if (!memRefType.hasStaticShape())
+    return false;
+  region->memref = loadOp.getMemRef();
+  region->setWrite(false);
+
+  unsigned rank = memRefType.getRank();
+  auto *regionCst = region->getConstraints();
+  regionCst->reset(rank, /*numSymbols=*/0, /*numLocals=*/0);
+
+  // Memref dim sizes provide the bounds.
+  for (unsigned d = 0; d < rank; d++) {
+    regionCst->addConstantLowerBound(d, 0);
+    regionCst->addConstantUpperBound(d, memRefType.getDimSize(d) - 1);
+  }
+  return true;
+}
+
+/// Creates a buffer in the workgroup-shared memory space for the specified
+/// region, generates a loop nest performing the copy from the original memref
+/// into it followed by a workgroup barrier, and replaces all loads under
+/// `forOp` to load from the buffer instead. The copy nest is executed
+/// redundantly by every thread of the workgroup; this is always correct since
+/// all threads store identical values.
+// TODO: distribute the copy iterations over the threads of the workgroup once
+// loops with workgroup/thread id bounds can be expressed.
+bool GpuSharedMemoryStaging::stageRegion(const MemRefRegion &region,
+                                         AffineForOp forOp) {
+  auto loc = region.loc;
+  auto *memref = region.memref;
+  auto memRefType = memref->getType().cast<MemRefType>();
+
+  auto layoutMaps = memRefType.getAffineMaps();
+  if (layoutMaps.size() > 1 ||
+      (layoutMaps.size() == 1 && !layoutMaps[0].isIdentity())) {
+    LLVM_DEBUG(llvm::dbgs() << "Non-identity layout map not yet supported\n");
+    return false;
+  }
+
+  // Compute the extents of the buffer.
+  unsigned rank = memRefType.getRank();
+  SmallVector<int64_t, 4> bufferShape;
+  std::vector<SmallVector<int64_t, 4>> lbs;
+  SmallVector<int64_t, 8> lbDivisors;
+  lbs.reserve(rank);
+  Optional<int64_t> numElements =
+      region.getConstantBoundingSizeAndShape(&bufferShape, &lbs, &lbDivisors);
+  if (!numElements.hasValue() || numElements.getValue() == 0) {
+    LLVM_DEBUG(llvm::dbgs() << "Non-constant or empty region\n");
+    return false;
+  }
+
+  auto *forInst = forOp.getOperation();
+  OpBuilder prologue(forInst);
+
+  auto bufferType = prologue.getMemRefType(
+      bufferShape, memRefType.getElementType(), {}, clSharedMemorySpace);
+  uint64_t sizeInBytes = getMemRefSizeInBytes(bufferType).getValue();
+  if (sizeInBytes > remainingCapacityBytes) {
+    LLVM_DEBUG(llvm::dbgs() << "Buffer exceeds remaining shared memory\n");
+    return false;
+  }
+
+  const FlatAffineConstraints *cst = region.getConstraints();
+  // Values the memory region is symbolic/parametric on; these are the IVs of
+  // the loops surrounding `forOp` within the launch body.
+  SmallVector<Value *, 8> regionSymbols;
+  cst->getIdValues(rank, cst->getNumIds(), &regionSymbols);
+
+  // Index start offsets of the region relative to the original memref, used
+  // both as the copy source origin and to remap the staged accesses.
+  SmallVector<AffineExpr, 4> offsets;
+  offsets.reserve(rank);
+  for (unsigned d = 0; d < rank; d++) {
+    AffineExpr offset = prologue.getAffineConstantExpr(0);
+    for (unsigned j = 0, e = cst->getNumCols() - rank - 1; j < e; j++)
+      offset = offset + lbs[d][j] * prologue.getAffineDimExpr(j);
+    assert(lbDivisors[d] > 0);
+    offset =
+        (offset + lbs[d][cst->getNumCols() - 1 - rank]).floorDiv(lbDivisors[d]);
+    offsets.push_back(offset);
+  }
+
+  // Allocate the workgroup-shared buffer.
+  Value *buffer = prologue.create<AllocOp>(loc, bufferType).getResult();
+
+  // Generate the copy loop nest over the buffer shape.
+  OpBuilder b = prologue;
+  SmallVector<Value *, 4> copyIvs;
+  copyIvs.reserve(rank);
+  for (unsigned d = 0; d < rank; d++) {
+    auto copyLoop = b.create<AffineForOp>(loc, 0, bufferShape[d]);
+    copyIvs.push_back(copyLoop.getInductionVar());
+    b = OpBuilder(copyLoop.getBody(), copyLoop.getBody()->begin());
+  }
+
+  // Copy source index along each dimension is the region's lower bound offset
+  // plus the copy IV; the buffer is written at the plain IVs.
+  unsigned numSymbols = regionSymbols.size();
+  SmallVector<Value *, 4> srcIndices;
+  srcIndices.reserve(rank);
+  for (unsigned d = 0; d < rank; d++) {
+    auto indexExpr = offsets[d] + b.getAffineDimExpr(numSymbols);
+    if (auto caf = indexExpr.dyn_cast<AffineConstantExpr>()) {
+      srcIndices.push_back(
+          b.create<ConstantIndexOp>(loc, caf.getValue()).getResult());
+      continue;
+    }
+    if (indexExpr == b.getAffineDimExpr(numSymbols) && numSymbols == 0) {
+      srcIndices.push_back(copyIvs[d]);
+      continue;
+    }
+    auto map = b.getAffineMap(numSymbols + 1, 0, indexExpr);
+    SmallVector<Value *, 8> applyOperands(regionSymbols.begin(),
+                                          regionSymbols.end());
+    applyOperands.push_back(copyIvs[d]);
+    srcIndices.push_back(b.create<AffineApplyOp>(loc, map, applyOperands));
+  }
+  auto elt = b.create<LoadOp>(loc, memref, srcIndices);
+  b.create<StoreOp>(loc, elt.getResult(), buffer, copyIvs);
+
+  // All copies must have completed before any thread reads from the buffer.
+  prologue.create<gpu::Barrier>(loc);
+
+  // Free the buffer once the loop nest computing out of it is done.
+  OpBuilder epilogue(forInst->getBlock(),
+                     std::next(Block::iterator(forInst)));
+  epilogue.create<DeallocOp>(loc, buffer);
+
+  // Replace the loads under `forOp` while remapping access indices
+  // (subtracting out the region's lower bound offsets for each dimension).
+  SmallVector<AffineExpr, 4> remapExprs;
+  remapExprs.reserve(rank);
+  for (unsigned i = 0; i < rank; i++) {
+    auto dimExpr = prologue.getAffineDimExpr(numSymbols + i);
+    remapExprs.push_back(dimExpr - offsets[i]);
+  }
+  auto indexRemap = prologue.getAffineMap(numSymbols + rank, 0, remapExprs);
+
+  // `forOp` both dominates and postdominates exactly the operations enclosed
+  // in it, so the copy loops and any other uses outside the nest are left
+  // untouched.
+  replaceAllMemRefUsesWith(memref, buffer,
+                           /*extraIndices=*/{}, indexRemap,
+                           /*extraOperands=*/regionSymbols,
+                           /*domInstFilter=*/forInst,
+                           /*postDomInstFilter=*/forInst);
+
+  remainingCapacityBytes -= sizeInBytes;
+  return true;
+}
+
+/// Gathers the memref regions read under `forOp` and stages the profitable
+/// ones through shared memory.
+void GpuSharedMemoryStaging::runOnLoopNest(AffineForOp forOp) {
+  unsigned depth = getNestingDepth(*forOp.getOperation());
+
+  // Memrefs stored to under the nest; staging them would require writing the
+  // buffer back out and synchronizing the stores across the workgroup.
+  // TODO: handle write regions the way DMA generation handles outgoing DMAs.
+  llvm::SmallPtrSet<Value *, 4> writtenMemRefs;
+  forOp.getOperation()->walk<StoreOp>([&](StoreOp storeOp) {
+    writtenMemRefs.insert(storeOp.getMemRef());
+  });
+
+  // Gather the read regions, merging the accesses to each memref into a
+  // single bounding region as DMA generation does.
+  SmallMapVector<Value *, std::unique_ptr<MemRefRegion>, 4> readRegions;
+  forOp.getOperation()->walk<LoadOp>([&](LoadOp loadOp) {
+    if (loadOp.getMemRefType().getMemorySpace() != 0)
+      return;
+    if (writtenMemRefs.count(loadOp.getMemRef()))
+      return;
+
+    auto *opInst = loadOp.getOperation();
+    auto region = llvm::make_unique<MemRefRegion>(opInst->getLoc());
+    if (failed(region->compute(opInst, depth))) {
+      // The access function is not affine in the surrounding IVs - it
+      // typically involves workgroup/thread ids. Over-approximate to the
+      // entire memref when its shape is static.
+      LLVM_DEBUG(llvm::dbgs()
+                 << "over-approximating to the entire memref\n");
+      if (!getFullMemRefAsRegion(opInst, region.get()))
+        return;
+    }
+
+    auto it = readRegions.find(region->memref);
+    if (it == readRegions.end()) {
+      readRegions[region->memref] = std::move(region);
+      return;
+    }
+    if (failed(it->second->unionBoundingBox(*region))) {
+      LLVM_DEBUG(llvm::dbgs()
+                 << "Memory region bounding box failed; "
+                    "over-approximating to the entire memref\n");
+      if (getFullMemRefAsRegion(opInst, region.get()))
+        it->second->getConstraints()->clearAndCopyFrom(
+            *region->getConstraints());
+      else
+        readRegions.erase(it);
+    }
+  });
+
+  for (const auto &regionEntry : readRegions)
+    stageRegion(*regionEntry.second, forOp);
+}
+
+void GpuSharedMemoryStaging::runOnLaunchOp(gpu::LaunchOp launchOp) {
+  // A region computed relative to loops surrounding the launch would have to
+  // refer to their IVs from within the launch body, which is isolated from
+  // above.
+  if (getNestingDepth(*launchOp.getOperation()) > 0) {
+    LLVM_DEBUG(llvm::dbgs()
+               << "not staging: launch is nested inside loops\n");
+    return;
+  }
+
+  remainingCapacityBytes = clSharedMemCapacity * 1024;
+
+  // Stage the regions accessed by each loop nest directly in the launch body.
+  // Collect the nests first since staging inserts ops around them.
+  SmallVector<AffineForOp, 4> loopNests;
+  for (auto &block : launchOp.getBody())
+    for (auto &op : block)
+      if (auto forOp = dyn_cast<AffineForOp>(&op))
+        loopNests.push_back(forOp);
+  for (auto forOp : loopNests)
+    runOnLoopNest(forOp);
+}
+
+void GpuSharedMemoryStaging::runOnFunction() {
+  getFunction().walk<gpu::LaunchOp>(
+      [&](gpu::LaunchOp launchOp) { runOnLaunchOp(launchOp); });
+}
+
+static PassRegistration<GpuSharedMemoryStaging>
+    pass("gpu-stage-shared-memory",
+         "Stage reused memref regions accessed in gpu.launch bodies through "
+         "workgroup-shared buffers");
@@ -821,14 +821,23 @@ AffineExpr mlir::simplifyAffineExpr(AffineExpr expr, unsigned numDims,
   if (!expr.isPureAffine())
     return expr;
 
+  // Expressions are uniqued in the context, so each unique expression only
+  // needs to be simplified once per context lifetime for a given
+  // dimension/symbol signature; reuse a memoized result when available.
+  MLIRContext *context = expr.getContext();
+  if (auto memoized =
+          context->lookupSimplifiedAffineExpr(expr, numDims, numSymbols))
+    return memoized;
+
   SimpleAffineExprFlattener flattener(numDims, numSymbols);
   flattener.walkPostOrder(expr);
   ArrayRef<int64_t> flattenedExpr = flattener.operandExprStack.back();
   auto simplifiedExpr = toAffineExpr(flattenedExpr, numDims, numSymbols,
-                                     flattener.localExprs, expr.getContext());
+                                     flattener.localExprs, context);
   flattener.operandExprStack.pop_back();
   assert(flattener.operandExprStack.empty());
 
+  context->cacheSimplifiedAffineExpr(expr, numDims, numSymbols, simplifiedExpr);
   return simplifiedExpr;
 }
 
@@ -842,6 +851,26 @@ static bool getFlattenedAffineExprs(
     return true;
   }
 
+  // Fast path: when every expression has a memoized local-free row for this
+  // signature, the rows are independent of each other and can be reused
+  // directly. Expressions are uniqued DAGs, so subscripts shared across maps
+  // hit the cache.
+  MLIRContext *context = exprs.front().getContext();
+  flattenedExprs->clear();
+  flattenedExprs->reserve(exprs.size());
+  bool allCached = true;
+  for (auto expr : exprs) {
+    SmallVector<int64_t, 8> row;
+    if (!context->lookupFlattenedAffineExpr(expr, numDims, numSymbols, row)) {
+      allCached = false;
+      break;
+    }
+    flattenedExprs->push_back(std::move(row));
+  }
+  if (allCached)
+    return true;
+  flattenedExprs->clear();
+
   SimpleAffineExprFlattener flattener(numDims, numSymbols);
   // Use the same flattener to simplify each expression successively. This way
   // local identifiers / expressions are shared.
@@ -852,11 +881,17 @@ static bool getFlattenedAffineExprs(
     flattener.walkPostOrder(expr);
   }
 
-  flattenedExprs->clear();
   assert(flattener.operandExprStack.size() == exprs.size());
   flattenedExprs->assign(flattener.operandExprStack.begin(),
                          flattener.operandExprStack.end());
 
+  // Rows that involve local identifiers depend on the numbering introduced by
+  // this flattener instance, so only local-free flattenings are memoized.
+  if (flattener.localExprs.empty())
+    for (unsigned i = 0, e = exprs.size(); i != e; ++i)
+      context->cacheFlattenedAffineExpr(exprs[i], numDims, numSymbols,
+                                        (*flattenedExprs)[i]);
+
   return true;
 }
 
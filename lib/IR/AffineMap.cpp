@@ -106,14 +106,9 @@ AffineMap AffineMap::getConstantMap(int64_t val, MLIRContext *context) {
              {getAffineConstantExpr(val, context)});
 }
 
-AffineMap AffineMap::getMultiDimIdentityMap(unsigned numDims,
-                                            MLIRContext *context) {
-  SmallVector<AffineExpr, 4> dimExprs;
-  dimExprs.reserve(numDims);
-  for (unsigned i = 0; i < numDims; ++i)
-    dimExprs.push_back(mlir::getAffineDimExpr(i, context));
-  return get(/*dimCount=*/numDims, /*symbolCount=*/0, dimExprs);
-}
+// Note: AffineMap::getMultiDimIdentityMap is defined in MLIRContext.cpp next
+// to the uniquing machinery, since it maintains the per-context cache of
+// canonical identity maps.
 
 MLIRContext *AffineMap::getContext() const { return getResult(0).getContext(); }
 
@@ -164,6 +159,11 @@ AffineExpr AffineMap::getResult(unsigned idx) const {
   return map->results[idx];
 }
 
+unsigned AffineMap::getUniquingHash() const {
+  assert(map && "uninitialized map storage");
+  return map->hashValue;
+}
+
 /// Folds the results of the application of an affine map on the provided
 /// operands to a constant if possible. Returns false if the folding happens,
 /// true otherwise.
@@ -30,12 +30,25 @@ namespace mlir {
 namespace detail {
 
 struct AffineMapStorage {
+  /// The number of results stored inline, see `inlineResults`.
+  enum { kInlineResults = 2 };
+
   unsigned numDims;
   unsigned numSymbols;
 
+  /// The hash of the uniquing key of this map, precomputed at creation time.
+  /// Storing it means growing the context's uniquing table does not rehash
+  /// every result expression array.
+  unsigned hashValue;
+
   /// The affine expressions for this (multi-dimensional) map.
   /// TODO: use trailing objects for this.
   ArrayRef<AffineExpr> results;
+
+  /// Inline storage for the results of small maps. Most maps have one or two
+  /// results and skip the separate array allocation; `results` then points
+  /// into this array.
+  AffineExpr inlineResults[kInlineResults];
 };
 
 } // end namespace detail
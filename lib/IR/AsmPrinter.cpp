@@ -42,6 +42,7 @@
 #include "llvm/ADT/StringExtras.h"
 #include "llvm/ADT/StringSet.h"
 #include "llvm/Support/CommandLine.h"
+#include "llvm/Support/Parallel.h"
 #include "llvm/Support/Regex.h"
 using namespace mlir;
 
@@ -78,6 +79,32 @@ static llvm::cl::opt<bool>
                        llvm::cl::desc("Print the generic op form"),
                        llvm::cl::init(false), llvm::cl::Hidden);
 
+static llvm::cl::opt<int64_t> printElementsAttrWithHexIfLarger(
+    "mlir-print-elementsattrs-with-hex-if-larger",
+    llvm::cl::desc("Print DenseElementsAttrs with more elements than the "
+                   "given limit as a hex string of the raw storage (use -1 "
+                   "to disable)"),
+    llvm::cl::init(1024));
+
+static llvm::cl::opt<bool> parallelFunctionPrinting(
+    "mlir-parallel-function-printing",
+    llvm::cl::desc("Print the functions of a module on multiple threads and "
+                   "emit the results in order"),
+    llvm::cl::init(false));
+
+static llvm::cl::opt<unsigned> attrAliasThreshold(
+    "mlir-attr-alias-threshold",
+    llvm::cl::desc("Generate an alias definition for attributes that appear "
+                   "at least this many times in the printed module (0 to "
+                   "disable automatic aliases)"),
+    llvm::cl::init(4));
+
+static llvm::cl::opt<unsigned> attrAliasMinSize(
+    "mlir-attr-alias-min-size",
+    llvm::cl::desc("Only generate automatic aliases for attributes whose "
+                   "printed form is at least this many characters"),
+    llvm::cl::init(32));
+
 namespace {
 /// A special index constant used for non-kind attribute aliases.
 static constexpr int kNonAttrKindAlias = -1;
@@ -142,6 +169,9 @@ public:
 
 private:
   void recordAttributeReference(Attribute attr) {
+    // Count every reference for the automatic aliasing heuristic.
+    ++attrUseCounts[attr];
+
     // Don't recheck attributes that have already been seen or those that
     // already have an alias.
     if (!usedAttributes.insert(attr) || attrToAlias.count(attr))
@@ -167,9 +197,20 @@ private:
   // Initialize symbol aliases.
   void initializeSymbolAliases();
 
+  // Generate aliases for repeated attributes once the module has been walked.
+  void initializeAutoAliases();
+
   /// Set of attributes known to be used within the module.
   llvm::SetVector<Attribute> usedAttributes;
 
+  /// Number of times each attribute was referenced while walking the module,
+  /// used to decide which attributes are worth aliasing automatically.
+  DenseMap<Attribute, unsigned> attrUseCounts;
+
+  /// Storage for automatically generated alias names, which must outlive the
+  /// StringRefs held in 'attrToAlias'.
+  llvm::StringSet<> autoAliasNames;
+
   /// Mapping between attribute and a pair comprised of a base alias name and a
   /// count suffix. If the suffix is set to -1, it is not displayed.
   llvm::MapVector<Attribute, std::pair<StringRef, int>> attrToAlias;
@@ -300,6 +341,42 @@ void ModuleState::initializeSymbolAliases() {
       typeToAlias.insert(typeAliasPair);
 }
 
+void ModuleState::initializeAutoAliases() {
+  if (attrAliasThreshold == 0)
+    return;
+
+  // Automatic alias names carry a counter suffix, so they can only collide
+  // with the indexed names generated for an attribute kind alias with the
+  // same base. Dialect provided aliases are already rejected if they end in a
+  // digit. Pick a different base in the unlikely event a kind alias took it.
+  StringRef aliasBase = "attr";
+  for (auto &kindAlias : attrKindToAlias)
+    if (kindAlias.second.first == aliasBase)
+      aliasBase = "alias";
+
+  unsigned nextId = 0;
+  for (Attribute attr : usedAttributes) {
+    // Skip attributes that already have an alias and those not repeated
+    // enough to be worth one.
+    if (attrToAlias.count(attr) ||
+        attrUseCounts.lookup(attr) < attrAliasThreshold)
+      continue;
+
+    // Measure the attribute's printed form; aliasing short attributes would
+    // add a definition line without shrinking the output.
+    SmallString<128> textForm;
+    llvm::raw_svector_ostream textOs(textForm);
+    textOs << attr;
+    if (textForm.size() < attrAliasMinSize)
+      continue;
+
+    StringRef name = autoAliasNames
+                         .insert((aliasBase + Twine(nextId++)).str())
+                         .first->getKey();
+    attrToAlias.insert({attr, {name, kNonAttrKindAlias}});
+  }
+}
+
 // Initializes module state, populating affine map and integer set state.
 void ModuleState::initialize(Module *module) {
   // Initialize the symbol aliases.
@@ -316,6 +393,9 @@ void ModuleState::initialize(Module *module) {
 
     fn.walk([&](Operation *op) { ModuleState::visitOperation(op); });
   }
+
+  // Now that reference counts are known, alias heavily repeated attributes.
+  initializeAutoAliases();
 }
 
 //===----------------------------------------------------------------------===//
@@ -459,6 +539,26 @@ void ModulePrinter::print(Module *module) {
   state.printAttributeAliases(os);
   state.printTypeAliases(os);
 
+  // When requested, render each function into its own buffer on a thread pool
+  // and emit the buffers in order. The alias state was computed once up front
+  // and is only read during printing, so it can be shared between the threads.
+  if (parallelFunctionPrinting && std::next(module->begin()) != module->end()) {
+    std::vector<Function *> functions;
+    for (auto &fn : *module)
+      functions.push_back(&fn);
+    std::vector<std::string> buffers(functions.size());
+    llvm::parallel::for_each_n(llvm::parallel::par, size_t(0),
+                               functions.size(), [&](size_t i) {
+                                 llvm::raw_string_ostream bufferOS(buffers[i]);
+                                 ModulePrinter printer(bufferOS, state);
+                                 printer.print(functions[i]);
+                                 bufferOS.flush();
+                               });
+    for (auto &buffer : buffers)
+      os << buffer;
+    return;
+  }
+
   // Print the module.
   for (auto &fn : *module)
     print(&fn);
@@ -768,6 +868,17 @@ void ModulePrinter::printDenseElementsAttr(DenseElementsAttr attr) {
     return;
   }
 
+  // Emit large attributes as a hex string of the raw storage, so that
+  // round-tripping them costs a copy per side instead of per-element
+  // formatting and parsing.
+  if (printElementsAttrWithHexIfLarger != -1 &&
+      numElements > printElementsAttrWithHexIfLarger) {
+    ArrayRef<char> rawData = attr.getRawData();
+    os << "\"0x" << llvm::toHex(StringRef(rawData.data(), rawData.size()))
+       << '"';
+    return;
+  }
+
   // We use a mixed-radix counter to iterate through the shape. When we bump a
   // non-least-significant digit, we emit a close bracket. When we next emit an
   // element we re-open all closed brackets.
@@ -1226,8 +1337,8 @@ public:
   }
 
   unsigned getBlockID(Block *block) {
-    auto it = blockIDs.find(block);
-    return it != blockIDs.end() ? it->second : ~0U;
+    auto it = numbering->blockIDs.find(block);
+    return it != numbering->blockIDs.end() ? it->second : ~0U;
   }
 
   void printSuccessorAndUseList(Operation *term, unsigned index) override;
@@ -1277,17 +1388,10 @@ protected:
 private:
   Function *function;
 
-  /// This is the value ID for each SSA value in the current function.  If this
-  /// returns ~0, then the valueID has an entry in valueNames.
-  DenseMap<Value *, unsigned> valueIDs;
-  DenseMap<Value *, StringRef> valueNames;
-
-  /// This is the block ID for each  block in the current function.
-  DenseMap<Block *, unsigned> blockIDs;
-
-  /// This keeps track of all of the non-numeric names that are in flight,
-  /// allowing us to check for duplicates.
-  llvm::StringSet<> usedNames;
+  /// The value, name and block numbering for the current function. This is
+  /// cached on the function and reused verbatim when the function body has not
+  /// changed since the numbering was computed.
+  detail::FunctionPrintNumbering *numbering;
 
   // This is the current indentation level for nested structures.
   unsigned currentIndent = 0;
@@ -1307,6 +1411,15 @@ private:
 
 FunctionPrinter::FunctionPrinter(Function *function, ModulePrinter &other)
     : ModulePrinter(other), function(function) {
+  // Reuse the numbering cached on the function if the body is unchanged since
+  // it was computed; otherwise renumber and install a fresh cache.
+  numbering = function->getValidPrintNumbering();
+  if (numbering)
+    return;
+
+  auto freshNumbering = llvm::make_unique<detail::FunctionPrintNumbering>();
+  numbering = freshNumbering.get();
+  function->setPrintNumbering(std::move(freshNumbering));
 
   for (auto &block : *function)
     numberValuesInBlock(block);
@@ -1318,7 +1431,7 @@ FunctionPrinter::FunctionPrinter(Function *function, ModulePrinter &other)
 void FunctionPrinter::numberValuesInBlock(Block &block) {
   // Each block gets a unique ID, and all of the operations within it get
   // numbered as well.
-  blockIDs[&block] = nextBlockID++;
+  numbering->blockIDs[&block] = nextBlockID++;
 
   for (auto *arg : block.getArguments())
     numberValueID(arg);
@@ -1335,7 +1448,7 @@ void FunctionPrinter::numberValuesInBlock(Block &block) {
 }
 
 void FunctionPrinter::numberValueID(Value *value) {
-  assert(!valueIDs.count(value) && "Value numbered multiple times");
+  assert(!numbering->valueIDs.count(value) && "Value numbered multiple times");
 
   SmallString<32> specialNameBuffer;
   llvm::raw_svector_ostream specialName(specialNameBuffer);
@@ -1379,24 +1492,24 @@ void FunctionPrinter::numberValueID(Value *value) {
         }
       }
       // Otherwise number it normally.
-      valueIDs[value] = nextValueID++;
+      numbering->valueIDs[value] = nextValueID++;
       return;
     case Value::Kind::OpResult:
       // This is an uninteresting result, give it a boring number and be
       // done with it.
-      valueIDs[value] = nextValueID++;
+      numbering->valueIDs[value] = nextValueID++;
       return;
     }
   }
 
   // Ok, this value had an interesting name.  Remember it with a sentinel.
-  valueIDs[value] = nameSentinel;
+  numbering->valueIDs[value] = nameSentinel;
 
   // Remember that we've used this name, checking to see if we had a conflict.
-  auto insertRes = usedNames.insert(specialName.str());
+  auto insertRes = numbering->usedNames.insert(specialName.str());
   if (insertRes.second) {
     // If this is the first use of the name, then we're successful!
-    valueNames[value] = insertRes.first->first();
+    numbering->valueNames[value] = insertRes.first->first();
     return;
   }
 
@@ -1406,10 +1519,10 @@ void FunctionPrinter::numberValueID(Value *value) {
   while (1) {
     std::string probeName =
         specialName.str().str() + "_" + llvm::utostr(nextConflictID++);
-    insertRes = usedNames.insert(probeName);
+    insertRes = numbering->usedNames.insert(probeName);
     if (insertRes.second) {
       // If this is the first use of the name, then we're successful!
-      valueNames[value] = insertRes.first->first();
+      numbering->valueNames[value] = insertRes.first->first();
       return;
     }
   }
@@ -1556,8 +1669,8 @@ void FunctionPrinter::printValueID(Value *value, bool printResultNo) const {
     }
   }
 
-  auto it = valueIDs.find(lookupValue);
-  if (it == valueIDs.end()) {
+  auto it = numbering->valueIDs.find(lookupValue);
+  if (it == numbering->valueIDs.end()) {
     os << "<<INVALID SSA VALUE>>";
     return;
   }
@@ -1566,8 +1679,8 @@ void FunctionPrinter::printValueID(Value *value, bool printResultNo) const {
   if (it->second != nameSentinel) {
     os << it->second;
   } else {
-    auto nameIt = valueNames.find(lookupValue);
-    assert(nameIt != valueNames.end() && "Didn't have a name entry?");
+    auto nameIt = numbering->valueNames.find(lookupValue);
+    assert(nameIt != numbering->valueNames.end() && "Didn't have a name entry?");
     os << nameIt->second;
   }
 
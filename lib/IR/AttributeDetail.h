@@ -297,24 +297,50 @@ struct OpaqueAttributeStorage : public AttributeStorage {
 
 /// An attribute representing a string value.
 struct StringAttributeStorage : public AttributeStorage {
-  using KeyTy = std::pair<StringRef, Type>;
+  /// The uniquing key: the string, its type, the string's precomputed hash,
+  /// and whether the string is permanently interned in the context (and thus
+  /// does not need to be copied into the allocator).
+  struct KeyTy {
+    StringRef value;
+    Type type;
+    unsigned hashValue;
+    bool isInterned;
+  };
 
-  StringAttributeStorage(StringRef value, Type type)
-      : AttributeStorage(type), value(value) {}
+  StringAttributeStorage(StringRef value, Type type, unsigned hashValue)
+      : AttributeStorage(type), value(value), hashValue(hashValue) {}
 
-  /// Key equality function.
+  /// Build the key for the given string, computing its hash once up front.
+  static KeyTy getKey(StringRef bytes, Type type, bool isInterned = false) {
+    return KeyTy{bytes, type, unsigned(llvm::hash_value(bytes)), isInterned};
+  }
+
+  /// Key equality function. Comparing the stored hash first rejects
+  /// hash-bucket collisions without touching the string data.
   bool operator==(const KeyTy &key) const {
-    return key == KeyTy(value, getType());
+    return key.hashValue == hashValue && key.type == getType() &&
+           key.value == value;
   }
 
-  /// Construct a new storage instance.
+  /// Hash the precomputed string hash together with the type.
+  static unsigned hashKey(const KeyTy &key) {
+    return llvm::hash_combine(key.hashValue, mlir::hash_value(key.type));
+  }
+
+  /// Construct a new storage instance. Interned strings live as long as the
+  /// context, so they are referenced in place instead of being copied.
   static StringAttributeStorage *construct(AttributeStorageAllocator &allocator,
                                            const KeyTy &key) {
+    auto value = key.isInterned ? key.value : allocator.copyInto(key.value);
     return new (allocator.allocate<StringAttributeStorage>())
-        StringAttributeStorage(allocator.copyInto(key.first), key.second);
+        StringAttributeStorage(value, key.type, key.hashValue);
   }
 
   StringRef value;
+
+  /// The hash of the string, stored so that lookups can reject non-matching
+  /// storage instances without comparing string contents.
+  unsigned hashValue;
 };
 
 /// An attribute representing a reference to a type.
@@ -358,6 +384,11 @@ struct DenseElementsAttributeStorage : public AttributeStorage {
 
     /// A boolean that indicates if this data is a splat or not.
     bool isSplat;
+
+    /// A boolean that indicates if the data buffer is owned by the caller and
+    /// guaranteed to outlive the context, in which case the storage references
+    /// it instead of copying it.
+    bool isUnmanaged = false;
   };
 
   DenseElementsAttributeStorage(ShapedType ty, ArrayRef<char> data,
@@ -387,8 +418,16 @@ struct DenseElementsAttributeStorage : public AttributeStorage {
   /// Construct a key from a shaped type, raw data buffer, and a flag that
   /// signals if the data is already known to be a splat. Callers to this
   /// function are expected to tag preknown splat values when possible, e.g. one
-  /// element shapes.
-  static KeyTy getKey(ShapedType ty, ArrayRef<char> data, bool isKnownSplat) {
+  /// element shapes. If `isUnmanaged` is set, the data buffer is guaranteed by
+  /// the caller to outlive the context and is referenced rather than copied.
+  static KeyTy getKey(ShapedType ty, ArrayRef<char> data, bool isKnownSplat,
+                      bool isUnmanaged = false) {
+    KeyTy key = buildKey(ty, data, isKnownSplat);
+    key.isUnmanaged = isUnmanaged;
+    return key;
+  }
+
+  static KeyTy buildKey(ShapedType ty, ArrayRef<char> data, bool isKnownSplat) {
     // Handle an empty storage instance.
     if (data.empty())
       return KeyTy(ty, data, 0);
@@ -476,8 +515,13 @@ struct DenseElementsAttributeStorage : public AttributeStorage {
   /// Construct a new storage instance.
   static DenseElementsAttributeStorage *
   construct(AttributeStorageAllocator &allocator, KeyTy key) {
-    // If the data buffer is non-empty, we copy it into the allocator.
-    ArrayRef<char> data = allocator.copyInto(key.data);
+    // If the data buffer is non-empty, we copy it into the allocator, unless
+    // the caller guarantees its lifetime. Splat buffers hold a single element
+    // and are always copied, both because they are tiny and because the
+    // boolean masking below must not write through to caller memory.
+    ArrayRef<char> data = (key.isUnmanaged && !key.isSplat)
+                              ? key.data
+                              : allocator.copyInto(key.data);
 
     // If this is a boolean splat, make sure only the first bit is used.
     if (key.isSplat && key.type.getElementTypeBitWidth() == 1)
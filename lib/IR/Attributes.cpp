@@ -155,16 +155,40 @@ ArrayRef<NamedAttribute> DictionaryAttr::getValue() const {
 
 /// Return the specified attribute if present, null otherwise.
 Attribute DictionaryAttr::get(StringRef name) const {
-  for (auto elt : getValue())
-    if (elt.first.is(name))
-      return elt.second;
-  return nullptr;
+  ArrayRef<NamedAttribute> values = getValue();
+
+  // Small lists are cheaper to scan than to binary search.
+  if (values.size() <= 4) {
+    for (auto elt : values)
+      if (elt.first.is(name))
+        return elt.second;
+    return nullptr;
+  }
+
+  // Otherwise, binary search; the elements are sorted by name.
+  auto it = std::lower_bound(
+      values.begin(), values.end(), name,
+      [](NamedAttribute lhs, StringRef rhs) { return lhs.first.strref() < rhs; });
+  return (it != values.end() && it->first.is(name)) ? it->second : nullptr;
 }
 Attribute DictionaryAttr::get(Identifier name) const {
-  for (auto elt : getValue())
-    if (elt.first == name)
-      return elt.second;
-  return nullptr;
+  ArrayRef<NamedAttribute> values = getValue();
+
+  // Small lists are cheaper to scan than to binary search, and identifier
+  // comparisons are simple pointer equality checks.
+  if (values.size() <= 4) {
+    for (auto elt : values)
+      if (elt.first == name)
+        return elt.second;
+    return nullptr;
+  }
+
+  // Otherwise, binary search; the elements are sorted by name.
+  StringRef nameRef = name.strref();
+  auto it = std::lower_bound(
+      values.begin(), values.end(), nameRef,
+      [](NamedAttribute lhs, StringRef rhs) { return lhs.first.strref() < rhs; });
+  return (it != values.end() && it->first == name) ? it->second : nullptr;
 }
 
 DictionaryAttr::iterator DictionaryAttr::begin() const {
@@ -251,7 +275,12 @@ FloatAttr::verifyConstructionInvariants(llvm::Optional<Location> loc,
 
 FunctionAttr FunctionAttr::get(Function *value) {
   assert(value && "Cannot get FunctionAttr for a null function");
-  return get(value->getName(), value->getContext());
+  // Function names are context-interned identifiers; reference them in place
+  // instead of copying them into the attribute allocator.
+  auto *ctx = value->getContext();
+  return Base::get(ctx, StandardAttributes::Function,
+                   value->getName().strref(), NoneType::get(ctx),
+                   /*isInterned=*/true);
 }
 
 FunctionAttr FunctionAttr::get(StringRef value, MLIRContext *ctx) {
@@ -341,6 +370,13 @@ StringAttr StringAttr::get(StringRef bytes, Type type) {
   return Base::get(type.getContext(), StandardAttributes::String, bytes, type);
 }
 
+StringAttr StringAttr::getInterned(Identifier str, MLIRContext *context) {
+  // The identifier's string is interned for the lifetime of the context, so
+  // the storage can reference it directly.
+  return Base::get(context, StandardAttributes::String, str.strref(),
+                   NoneType::get(context), /*isInterned=*/true);
+}
+
 StringRef StringAttr::getValue() const { return getImpl()->value; }
 
 //===----------------------------------------------------------------------===//
@@ -466,6 +502,33 @@ static bool hasSameElementsOrSplat(ShapedType type, const Values &values) {
          (type.getNumElements() == static_cast<int64_t>(values.size()));
 }
 
+/// Detects if the fully expanded buffer 'data', holding one entry per element
+/// of 'type' in dense storage layout, consists of a single repeated element
+/// value. If so, narrows 'data' to the bytes of that one element and returns
+/// true. Uniform buffers are common in practice, e.g. zero or one filled
+/// initializers, and collapsing them to splat storage keeps a single element
+/// in the context independently of the element count of 'type'. Only
+/// byte-aligned element storage is examined; sub-byte (i1) buffers are left
+/// expanded.
+static bool detectSplatBuffer(ShapedType type, ArrayRef<char> &data) {
+  int64_t numElements = type.getNumElements();
+  if (numElements < 2)
+    return false;
+  size_t storageWidth = getDenseElementStorageWidth(
+      getDenseElementBitwidth(type.getElementType()));
+  if ((storageWidth % CHAR_BIT) != 0)
+    return false;
+  size_t eltSize = storageWidth / CHAR_BIT;
+  if (data.size() != eltSize * static_cast<size_t>(numElements))
+    return false;
+  ArrayRef<char> first = data.take_front(eltSize);
+  for (int64_t i = 1; i < numElements; ++i)
+    if (data.slice(i * eltSize, eltSize) != first)
+      return false;
+  data = first;
+  return true;
+}
+
 //===----------------------------------------------------------------------===//
 // DenseElementAttr Iterators
 //===----------------------------------------------------------------------===//
@@ -611,10 +674,57 @@ DenseElementsAttr DenseElementsAttr::getRaw(ShapedType type,
   assert((type.isa<RankedTensorType>() || type.isa<VectorType>()) &&
          "type must be ranked tensor or vector");
   assert(type.hasStaticShape() && "type must have static shape");
+
+  // Collapse buffers where every element holds the same value to splat
+  // storage before the data reaches the uniquer.
+  if (!isSplat)
+    isSplat = detectSplatBuffer(type, data);
   return Base::get(type.getContext(), StandardAttributes::DenseElements, type,
                    data, isSplat);
 }
 
+DenseElementsAttr DenseElementsAttr::getFromBuffer(ShapedType type,
+                                                   ArrayRef<char> data) {
+  assert((type.isa<RankedTensorType>() || type.isa<VectorType>()) &&
+         "type must be ranked tensor or vector");
+  assert(type.hasStaticShape() && "type must have static shape");
+
+  // A uniform unmanaged buffer collapses to splat storage as well. Splats are
+  // always copied into the context, but that copy is a single element.
+  bool isSplat =
+      type.getNumElements() == 1 || detectSplatBuffer(type, data);
+  return Base::get(type.getContext(), StandardAttributes::DenseElements, type,
+                   data, /*isKnownSplat=*/isSplat,
+                   /*isUnmanaged=*/true);
+}
+
+/// Returns the number of raw-buffer bytes that dense storage of 'type' uses
+/// for the given number of elements.
+static size_t getRawBufferSizeInBytes(ShapedType type, int64_t numElements) {
+  size_t storageWidth = getDenseElementStorageWidth(
+      getDenseElementBitwidth(type.getElementType()));
+  return llvm::divideCeil(storageWidth * numElements, CHAR_BIT);
+}
+
+bool DenseElementsAttr::isValidRawBuffer(ShapedType type,
+                                         ArrayRef<char> rawBuffer) {
+  if (rawBuffer.size() == getRawBufferSizeInBytes(type, type.getNumElements()))
+    return true;
+  return rawBuffer.size() == getRawBufferSizeInBytes(type, /*numElements=*/1);
+}
+
+DenseElementsAttr DenseElementsAttr::getFromRawBuffer(ShapedType type,
+                                                      ArrayRef<char> rawBuffer) {
+  assert(isValidRawBuffer(type, rawBuffer));
+
+  // A buffer that is not fully expanded holds the storage of one element and
+  // encodes a splat. Full-sized buffers take precedence when the sizes
+  // coincide, e.g. a single-element type.
+  bool isSplat =
+      rawBuffer.size() != getRawBufferSizeInBytes(type, type.getNumElements());
+  return getRaw(type, rawBuffer, isSplat);
+}
+
 /// Check the information for a c++ data type, check if this type is valid for
 /// the current attribute. This method is used to verify specific type
 /// invariants that the templatized 'getValues' method cannot.
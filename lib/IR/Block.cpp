@@ -17,6 +17,7 @@
 
 #include "mlir/IR/Block.h"
 #include "mlir/IR/Builders.h"
+#include "mlir/IR/Function.h"
 #include "mlir/IR/Operation.h"
 using namespace mlir;
 
@@ -131,8 +132,10 @@ bool Block::verifyInstOrder() {
   Operation *prev = nullptr;
   for (auto &i : *this) {
     // The previous operation must have a smaller order index than the next as
-    // it appears earlier in the list.
-    if (prev && prev->orderIndex >= i.orderIndex)
+    // it appears earlier in the list. Operations pending a lazy index
+    // assignment are ignored.
+    if (prev && prev->orderIndex != Operation::kInvalidOrderIdx &&
+        prev->orderIndex >= i.orderIndex)
       return true;
     prev = &i;
   }
@@ -143,11 +146,67 @@ bool Block::verifyInstOrder() {
 void Block::recomputeInstOrder() {
   parentValidInstOrderPair.setInt(true);
 
-  // TODO(riverriddle) Have non-congruent indices to reduce the number of times
-  // an insert invalidates the list.
+  // Assign non-congruent indices so that operations inserted later can claim
+  // an index in the gap between their neighbors without invalidating the
+  // ordering of the whole block.
   unsigned orderIndex = 0;
   for (auto &op : *this)
-    op.orderIndex = orderIndex++;
+    op.orderIndex = (orderIndex += Operation::kOrderStride);
+}
+
+/// Reassigns order indices to a local neighborhood of operations around the
+/// inclusive range ['first', 'last'].
+void Block::redistributeInstOrder(Operation *first, Operation *last) {
+  assert(first->getBlock() == this && last->getBlock() == this &&
+         "expected operations of this block");
+
+  // Count the operations initially in the window.
+  uint64_t count = 1;
+  for (Operation *op = first; op != last; op = op->getNextNode())
+    ++count;
+
+  Operation *lo = first, *hi = last;
+  for (;;) {
+    Operation *below = lo->getPrevNode();
+    Operation *above = hi->getNextNode();
+
+    // If a window boundary has no assigned index, local information is
+    // insufficient; renumber the whole block.
+    if ((below && !below->hasValidOrder()) ||
+        (above && !above->hasValidOrder()))
+      return recomputeInstOrder();
+
+    // The index range available to the window, bounded by the neighbors just
+    // outside of it. Leave the maximum index for the invalid-order sentinel.
+    uint64_t lower = below ? uint64_t(below->orderIndex) : 0;
+    uint64_t upper =
+        above ? above->orderIndex : uint64_t(Operation::kInvalidOrderIdx);
+
+    // If the range can hold stride-spaced indices for every operation in the
+    // window, renumber the window evenly and finish.
+    uint64_t step = (upper - lower) / (count + 1);
+    if (step >= Operation::kOrderStride) {
+      uint64_t orderIndex = lower;
+      for (Operation *op = lo;; op = op->getNextNode()) {
+        op->orderIndex = unsigned(orderIndex += step);
+        if (op == hi)
+          break;
+      }
+      return;
+    }
+
+    // Otherwise, grow the window in both directions and retry.
+    if (!below && !above)
+      return recomputeInstOrder();
+    if (below) {
+      lo = below;
+      ++count;
+    }
+    if (above) {
+      hi = above;
+      ++count;
+    }
+  }
 }
 
 //===----------------------------------------------------------------------===//
@@ -157,6 +216,8 @@ void Block::recomputeInstOrder() {
 BlockArgument *Block::addArgument(Type type) {
   auto *arg = new BlockArgument(type, this);
   arguments.push_back(arg);
+  if (Function *fn = getFunction())
+    fn->markBodyModified();
   return arg;
 }
 
@@ -173,6 +234,8 @@ auto Block::addArguments(ArrayRef<Type> types)
 
 void Block::eraseArgument(unsigned index, bool updatePredTerms) {
   assert(index < arguments.size());
+  if (Function *fn = getFunction())
+    fn->markBodyModified();
 
   // Delete the argument.
   delete arguments[index];
@@ -190,6 +253,34 @@ void Block::eraseArgument(unsigned index, bool updatePredTerms) {
   }
 }
 
+/// Erase 'num' arguments starting at 'start' in a single batch.
+void Block::eraseArguments(unsigned start, unsigned num,
+                           bool updatePredTerms) {
+  assert(start + num <= arguments.size());
+  if (num == 0)
+    return;
+  if (Function *fn = getFunction())
+    fn->markBodyModified();
+
+  // Delete the arguments and close the gap in the list with one shift.
+  for (unsigned i = start, e = start + num; i != e; ++i)
+    delete arguments[i];
+  arguments.erase(arguments.begin() + start, arguments.begin() + start + num);
+
+  // If we aren't updating predecessors, there is nothing left to do.
+  if (!updatePredTerms)
+    return;
+
+  // Erase the arguments from each of the predecessor's terminator in one
+  // batch per predecessor.
+  for (auto predIt = pred_begin(), predE = pred_end(); predIt != predE;
+       ++predIt) {
+    auto *predTerminator = (*predIt)->getTerminator();
+    predTerminator->eraseSuccessorOperands(predIt.getSuccessorIndex(), start,
+                                           num);
+  }
+}
+
 //===----------------------------------------------------------------------===//
 // Terminator management
 //===----------------------------------------------------------------------===//
@@ -0,0 +1,38 @@
+//===- BlockAndValueMapping.cpp - MLIR BlockAndValueMapping Class ---------===//
+//
+// Copyright 2019 The MLIR Authors.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+// =============================================================================
+
+#include "mlir/IR/BlockAndValueMapping.h"
+#include "mlir/IR/Operation.h"
+using namespace mlir;
+
+/// Number every value defined within 'block' as a dense source.
+void BlockAndValueMapping::numberDenseSources(Block *block) {
+  assert(valueMap.empty() &&
+         "dense sources must be numbered before inserting mappings");
+  for (auto *arg : block->getArguments())
+    numberDenseSource(arg);
+  for (auto &op : *block) {
+    for (auto *result : op.getResults())
+      numberDenseSource(result);
+    for (auto &region : op.getRegions()) {
+      for (auto &nestedBlock : region) {
+        numberDenseSource(&nestedBlock);
+        numberDenseSources(&nestedBlock);
+      }
+    }
+  }
+}
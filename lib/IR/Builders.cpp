@@ -352,14 +352,18 @@ Block *OpBuilder::createBlock(Block *insertBefore) {
   return b;
 }
 
-/// Create an operation given the fields represented as an OperationState.
-Operation *OpBuilder::createOperation(const OperationState &state) {
-  assert(block && "createOperation() called without setting builder's block");
-  auto *op = Operation::create(state);
+/// Insert the given operation at the current insertion point.
+Operation *OpBuilder::insert(Operation *op) {
+  assert(block && "insert() called without setting builder's block");
   block->getOperations().insert(insertPoint, op);
   return op;
 }
 
+/// Create an operation given the fields represented as an OperationState.
+Operation *OpBuilder::createOperation(const OperationState &state) {
+  return insert(Operation::create(state));
+}
+
 /// Attempts to fold the given operation and places new results within
 /// 'results'.
 void OpBuilder::tryFold(Operation *op, SmallVectorImpl<Value *> &results) {
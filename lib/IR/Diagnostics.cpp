@@ -24,6 +24,9 @@
 #include "mlir/IR/Types.h"
 #include "llvm/ADT/SmallString.h"
 #include "llvm/ADT/StringMap.h"
+#include "llvm/Support/CommandLine.h"
+#include "llvm/Support/FileSystem.h"
+#include "llvm/Support/ManagedStatic.h"
 #include "llvm/Support/Mutex.h"
 #include "llvm/Support/PrettyStackTrace.h"
 #include "llvm/Support/Regex.h"
@@ -92,17 +95,17 @@ void DiagnosticArgument::print(raw_ostream &os) const {
 //===----------------------------------------------------------------------===//
 
 /// Convert a Twine to a StringRef. Memory used for generating the StringRef is
-/// stored in 'strings'.
+/// allocated from 'strings'.
 static StringRef twineToStrRef(const Twine &val,
-                               std::vector<std::unique_ptr<char[]>> &strings) {
+                               llvm::BumpPtrAllocator &strings) {
   // Allocate memory to hold this string.
   llvm::SmallString<64> data;
   auto strRef = val.toStringRef(data);
-  strings.push_back(std::unique_ptr<char[]>(new char[strRef.size()]));
-  memcpy(&strings.back()[0], strRef.data(), strRef.size());
+  if (strRef.empty())
+    return strRef;
 
-  // Return a reference to the new string.
-  return StringRef(&strings.back()[0], strRef.size());
+  // Return a reference to the arena-owned copy.
+  return strRef.copy(strings);
 }
 
 /// Stream in a Twine argument.
@@ -299,6 +302,93 @@ InFlightDiagnostic mlir::emitRemark(Location loc, const Twine &message) {
   return emitDiag(loc, DiagnosticSeverity::Remark, message);
 }
 
+//===----------------------------------------------------------------------===//
+// OptRemark
+//===----------------------------------------------------------------------===//
+
+static llvm::cl::opt<bool> clEnableRemarks(
+    "mlir-remarks",
+    llvm::cl::desc("Emit optimization remarks from transformation passes"),
+    llvm::cl::init(false));
+
+static llvm::cl::opt<std::string> clRemarksFilter(
+    "mlir-remarks-filter",
+    llvm::cl::desc("Only emit optimization remarks from passes whose name "
+                   "contains this string"));
+
+static llvm::cl::opt<std::string> clRemarksFile(
+    "mlir-remarks-file",
+    llvm::cl::desc("Append optimization remarks as YAML records to the given "
+                   "file"));
+
+namespace {
+/// Lazily opened stream for the machine-readable remark file, shared by all
+/// contexts in the process and guarded by a mutex since function passes run
+/// concurrently.
+struct RemarkFileStream {
+  RemarkFileStream() {
+    if (clRemarksFile.empty())
+      return;
+    std::error_code error;
+    os.reset(new llvm::raw_fd_ostream(clRemarksFile, error,
+                                      llvm::sys::fs::F_Append));
+    if (error) {
+      llvm::errs() << "error opening remark file '" << clRemarksFile
+                   << "': " << error.message() << "\n";
+      os.reset();
+    }
+  }
+
+  std::unique_ptr<llvm::raw_fd_ostream> os;
+  llvm::sys::SmartMutex<true> mutex;
+};
+} // end anonymous namespace
+
+static llvm::ManagedStatic<RemarkFileStream> remarkFileStream;
+
+/// Emit a single optimization remark to the enabled sinks.
+static void emitOptRemark(Location loc, StringRef passName,
+                          StringRef remarkName, const Twine &message,
+                          bool wasApplied) {
+  std::string messageStr = message.str();
+
+  // Report through the diagnostic engine so remarks interleave with other
+  // diagnostics and reach whatever handler the tool installed.
+  if (clEnableRemarks)
+    emitRemark(loc, Twine("[") + passName + "] " +
+                        (wasApplied ? "" : "missed ") + remarkName + ": " +
+                        messageStr);
+
+  // Mirror the remark as a YAML record in the style of LLVM's serialized
+  // optimization remarks so it can be post-processed by tools.
+  if (remarkFileStream->os) {
+    llvm::sys::SmartScopedLock<true> lock(remarkFileStream->mutex);
+    auto &os = *remarkFileStream->os;
+    os << "--- !" << (wasApplied ? "Passed" : "Missed") << "\n";
+    os << "Pass:     " << passName << "\n";
+    os << "Name:     " << remarkName << "\n";
+    os << "Loc:      " << loc << "\n";
+    os << "Message:  '" << messageStr << "'\n";
+    os << "...\n";
+  }
+}
+
+bool OptRemark::isEnabled(StringRef passName) {
+  if (!clEnableRemarks && clRemarksFile.empty())
+    return false;
+  return clRemarksFilter.empty() || passName.contains(clRemarksFilter);
+}
+
+void OptRemark::passed(Location loc, StringRef passName, StringRef remarkName,
+                       const Twine &message) {
+  emitOptRemark(loc, passName, remarkName, message, /*wasApplied=*/true);
+}
+
+void OptRemark::missed(Location loc, StringRef passName, StringRef remarkName,
+                       const Twine &message) {
+  emitOptRemark(loc, passName, remarkName, message, /*wasApplied=*/false);
+}
+
 //===----------------------------------------------------------------------===//
 // ScopedDiagnosticHandler
 //===----------------------------------------------------------------------===//
@@ -343,8 +433,48 @@ struct SourceMgrDiagnosticHandlerImpl {
     return filenameToBuf[filename] = newBuf;
   }
 
+  /// Returns the offsets of the line starts within the given buffer,
+  /// computing and memoizing the table on first use. Lines are counted the
+  /// same way the diagnostic printer counts them: "\r\n" and "\n\r" pairs are
+  /// a single line break.
+  ArrayRef<unsigned> getLineOffsets(const llvm::MemoryBuffer *buf) {
+    auto it = lineOffsets.find(buf);
+    if (it != lineOffsets.end())
+      return it->second;
+
+    std::vector<unsigned> &offsets = lineOffsets[buf];
+    const char *start = buf->getBufferStart();
+    const char *end = buf->getBufferEnd();
+    offsets.push_back(0);
+    for (const char *position = start; position < end;) {
+      auto curChar = *position++;
+
+      // Scan for newlines.  If this isn't one, ignore it.
+      if (curChar != '\r' && curChar != '\n')
+        continue;
+
+      // Check for \r\n and \n\r and treat it as a single escape.  We know
+      // that looking past one character is safe because MemoryBuffer's are
+      // always nul terminated.
+      if (*position != curChar && (*position == '\r' || *position == '\n'))
+        ++position;
+      offsets.push_back(position - start);
+    }
+    return offsets;
+  }
+
   /// Mapping between file name and buffer pointer.
   llvm::StringMap<const llvm::MemoryBuffer *> filenameToBuf;
+
+  /// Per-buffer tables of line start offsets, built once per buffer instead
+  /// of re-scanning it for every diagnostic.
+  llvm::DenseMap<const llvm::MemoryBuffer *, std::vector<unsigned>>
+      lineOffsets;
+
+  /// Memoized conversions of file locations to source manager locations.
+  /// Locations are uniqued, and call-site chains re-emit the same caller
+  /// locations for every diagnostic they appear in.
+  llvm::DenseMap<Attribute, llvm::SMLoc> locToSMLoc;
 };
 } // end namespace detail
 } // end namespace mlir
@@ -456,47 +586,42 @@ SourceMgrDiagnosticHandler::getBufferForFile(StringRef filename) {
 /// Get a memory buffer for the given file, or the main file of the source
 /// manager if one doesn't exist. This always returns non-null.
 llvm::SMLoc SourceMgrDiagnosticHandler::convertLocToSMLoc(FileLineColLoc loc) {
+  // Check for a memoized conversion. Locations are uniqued, so repeated
+  // diagnostics at the same position resolve to the same entry.
+  auto cacheIt = impl->locToSMLoc.find(loc);
+  if (cacheIt != impl->locToSMLoc.end())
+    return cacheIt->second;
+  llvm::SMLoc result = computeLocToSMLoc(loc);
+  impl->locToSMLoc.try_emplace(loc, result);
+  return result;
+}
+
+llvm::SMLoc SourceMgrDiagnosticHandler::computeLocToSMLoc(FileLineColLoc loc) {
   // Get the buffer for this filename.
   auto *membuf = getBufferForFile(loc.getFilename());
   if (!membuf)
     return llvm::SMLoc();
 
-  // TODO: This should really be upstreamed to be a method on llvm::SourceMgr.
-  // Doing so would allow it to use the offset cache that is already maintained
-  // by SrcBuffer, making this more efficient.
   unsigned lineNo = loc.getLine();
   unsigned columnNo = loc.getColumn();
 
-  // Scan for the correct line number.
-  const char *position = membuf->getBufferStart();
-  const char *end = membuf->getBufferEnd();
-
   // We start counting line and column numbers from 1.
   if (lineNo != 0)
     --lineNo;
   if (columnNo != 0)
     --columnNo;
 
-  while (position < end && lineNo) {
-    auto curChar = *position++;
-
-    // Scan for newlines.  If this isn't one, ignore it.
-    if (curChar != '\r' && curChar != '\n')
-      continue;
-
-    // We saw a line break, decrement our counter.
-    --lineNo;
-
-    // Check for \r\n and \n\r and treat it as a single escape.  We know that
-    // looking past one character is safe because MemoryBuffer's are always nul
-    // terminated.
-    if (*position != curChar && (*position == '\r' || *position == '\n'))
-      ++position;
-  }
+  // Look the line offset up in the buffer's line table, which is built once
+  // per buffer rather than re-scanning it for every diagnostic.
+  ArrayRef<unsigned> lineStarts = impl->getLineOffsets(membuf);
+  const char *end = membuf->getBufferEnd();
 
-  // If the line/column counter was invalid, return a pointer to the start of
-  // the buffer.
-  if (lineNo || position + columnNo > end)
+  // If the line/column is invalid, return a pointer to the start of the
+  // buffer.
+  if (lineNo >= lineStarts.size())
+    return llvm::SMLoc::getFromPointer(membuf->getBufferStart());
+  const char *position = membuf->getBufferStart() + lineStarts[lineNo];
+  if (position + columnNo > end)
     return llvm::SMLoc::getFromPointer(membuf->getBufferStart());
 
   // If the column is zero, try to skip to the first non-whitespace character.
@@ -753,16 +878,28 @@ struct ParallelDiagnosticHandlerImpl : public llvm::PrettyStackTraceEntry {
     Diagnostic diag;
   };
 
+  /// State local to one worker thread. Both the order id and the diagnostic
+  /// buffer are written without synchronization; the handler only takes the
+  /// registration mutex the first time a thread touches it, and merges the
+  /// buffers once the parallel section has quiesced.
+  struct ThreadState {
+    /// The handler this state is currently registered with, used to detect
+    /// reuse of the thread by a later handler instance.
+    ParallelDiagnosticHandlerImpl *owner = nullptr;
+
+    /// The current order id of this thread, see setOrderIDForThread.
+    size_t orderID = 0;
+
+    /// The diagnostics emitted by this thread.
+    std::vector<ThreadDiagnostic> diagnostics;
+  };
+
   ParallelDiagnosticHandlerImpl(MLIRContext *ctx)
       : prevHandler(ctx->getDiagEngine().getHandler()), context(ctx) {
     ctx->getDiagEngine().setHandler([this](Diagnostic diag) {
-      uint64_t tid = llvm::get_threadid();
-      llvm::sys::SmartScopedLock<true> lock(mutex);
-      assert(threadToOrderID.count(tid) &&
-             "current thread does not have a valid orderID");
-
-      // Append a new diagnostic.
-      diagnostics.emplace_back(threadToOrderID[tid], std::move(diag));
+      // Append to the thread-local buffer; no synchronization is needed.
+      ThreadState &state = getThreadState();
+      state.diagnostics.emplace_back(state.orderID, std::move(diag));
     });
   }
 
@@ -770,6 +907,10 @@ struct ParallelDiagnosticHandlerImpl : public llvm::PrettyStackTraceEntry {
     // Restore the previous diagnostic handler.
     context->getDiagEngine().setHandler(prevHandler);
 
+    // Merge the per-thread buffers. The parallel section has completed by the
+    // time the handler is destroyed, so the thread states are quiescent.
+    mergeThreadDiagnostics();
+
     // Early exit if there are no diagnostics, this is the common case.
     if (diagnostics.empty())
       return;
@@ -780,6 +921,36 @@ struct ParallelDiagnosticHandlerImpl : public llvm::PrettyStackTraceEntry {
     });
   }
 
+  /// Returns the state of the current thread, registering it with this
+  /// handler first if necessary.
+  ThreadState &getThreadState() {
+    static thread_local ThreadState state;
+    if (state.owner != this) {
+      state.owner = this;
+      state.orderID = 0;
+      state.diagnostics.clear();
+
+      llvm::sys::SmartScopedLock<true> lock(mutex);
+      threadStates.push_back(&state);
+    }
+    return state;
+  }
+
+  /// Move the diagnostics of all registered threads into the merged list. All
+  /// diagnostics for one order id come from a single thread, so sorting the
+  /// concatenation by order id reproduces the sequential emission order.
+  void mergeThreadDiagnostics() {
+    llvm::sys::SmartScopedLock<true> lock(mutex);
+    for (ThreadState *state : threadStates) {
+      diagnostics.insert(diagnostics.end(),
+                         std::make_move_iterator(state->diagnostics.begin()),
+                         std::make_move_iterator(state->diagnostics.end()));
+      state->diagnostics.clear();
+      state->owner = nullptr;
+    }
+    threadStates.clear();
+  }
+
   /// Utility method to emit any held diagnostics.
   void emitDiagnostics(std::function<void(Diagnostic)> emitFn) {
     // Stable sort all of the diagnostics that were emitted. This creates a
@@ -794,13 +965,15 @@ struct ParallelDiagnosticHandlerImpl : public llvm::PrettyStackTraceEntry {
 
   /// Set the order id for the current thread.
   void setOrderIDForThread(size_t orderID) {
-    uint64_t tid = llvm::get_threadid();
-    llvm::sys::SmartScopedLock<true> lock(mutex);
-    threadToOrderID[tid] = orderID;
+    getThreadState().orderID = orderID;
   }
 
   /// Dump the current diagnostics that were inflight.
   void print(raw_ostream &os) const override {
+    // Pull in any buffered per-thread diagnostics. This is only reached on the
+    // crash path, so the destructive merge is acceptable.
+    const_cast<ParallelDiagnosticHandlerImpl *>(this)->mergeThreadDiagnostics();
+
     // Early exit if there are no diagnostics, this is the common case.
     if (diagnostics.empty())
       return;
@@ -835,13 +1008,14 @@ struct ParallelDiagnosticHandlerImpl : public llvm::PrettyStackTraceEntry {
   /// The previous context diagnostic handler.
   DiagnosticEngine::HandlerTy prevHandler;
 
-  /// A smart mutex to lock access to the internal state.
+  /// A smart mutex guarding the thread registration list.
   llvm::sys::SmartMutex<true> mutex;
 
-  /// A mapping between the thread id and the current order id.
-  DenseMap<uint64_t, size_t> threadToOrderID;
+  /// The states of the threads that have emitted through this handler or set
+  /// an order id, registered on first use.
+  std::vector<ThreadState *> threadStates;
 
-  /// An unordered list of diagnostics that were emitted.
+  /// The merged, unordered list of diagnostics that were emitted.
   std::vector<ThreadDiagnostic> diagnostics;
 
   /// The context to emit the diagnostics to.
@@ -68,6 +68,35 @@ Dialect::Dialect(StringRef name, MLIRContext *context)
 
 Dialect::~Dialect() {}
 
+void Dialect::addDenseFoldKernel(StringRef opName, Type elementType,
+                                 DialectDenseFoldKernel kernel) {
+  assert(opName.startswith(getNamespace()) &&
+         "expected operation name to start with the dialect namespace");
+  denseFoldKernels[{OperationName(opName, getContext()), elementType}] =
+      std::move(kernel);
+}
+
+Attribute Dialect::foldDenseElements(OperationName opName,
+                                     DenseElementsAttr lhs,
+                                     DenseElementsAttr rhs) {
+  if (denseFoldKernels.empty())
+    return Attribute();
+
+  // Kernels fold matching non-splat operands elementwise into a result of the
+  // same type; anything else is left to the elementwise fold hooks.
+  auto type = lhs.getType();
+  if (type != rhs.getType() || lhs.isSplat() || rhs.isSplat())
+    return Attribute();
+  auto it = denseFoldKernels.find({opName, type.getElementType()});
+  if (it == denseFoldKernels.end())
+    return Attribute();
+
+  ArrayRef<char> lhsData = lhs.getRawData();
+  std::vector<char> resultData(lhsData.size());
+  it->second(lhsData, rhs.getRawData(), resultData);
+  return DenseElementsAttr::getFromRawBuffer(type, resultData);
+}
+
 /// Parse an attribute registered to this dialect.
 Attribute Dialect::parseAttribute(StringRef attrData, Location loc) const {
   emitError(loc) << "dialect '" << getNamespace()
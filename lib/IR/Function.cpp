@@ -22,7 +22,10 @@
 #include "mlir/IR/MLIRContext.h"
 #include "mlir/IR/Module.h"
 #include "mlir/IR/OpImplementation.h"
+#include "llvm/ADT/DenseMap.h"
+#include "llvm/ADT/Hashing.h"
 #include "llvm/ADT/MapVector.h"
+#include "llvm/ADT/STLExtras.h"
 #include "llvm/ADT/SmallString.h"
 #include "llvm/ADT/Twine.h"
 
@@ -192,6 +195,108 @@ void Function::walk(const std::function<void(Operation *)> &callback) {
   getBody().walk(callback);
 }
 
+/// Returns the number of operations in the body, recounting only when the
+/// body changed since the last query.
+uint64_t Function::getCachedOpCount() {
+  if (cachedOpCountModCount != modificationCount) {
+    uint64_t count = 0;
+    getBody().walk([&](Operation *) { ++count; });
+    cachedOpCount = count;
+    cachedOpCountModCount = modificationCount;
+  }
+  return cachedOpCount;
+}
+
+ArrayRef<Operation *> Function::getWalkSnapshot() {
+  // Rebuild the snapshot if the body changed since it was last built.
+  if (walkSnapshotModCount != modificationCount) {
+    walkSnapshot.clear();
+    getBody().walk([&](Operation *op) { walkSnapshot.push_back(op); });
+    walkSnapshotModCount = modificationCount;
+
+    // The snapshot provides the operation count of the body for free.
+    cachedOpCount = walkSnapshot.size();
+    cachedOpCountModCount = walkSnapshotModCount;
+  }
+  return walkSnapshot;
+}
+
+/// Returns a structural fingerprint of the body, recomputing only when the
+/// body changed since the last query.
+uint64_t Function::getFingerprint() {
+  if (fingerprintModCount == modificationCount)
+    return cachedFingerprint;
+
+  // Values and blocks are numbered in the order they are first encountered,
+  // so the fingerprint captures operand and successor topology without
+  // depending on memory layout.
+  llvm::DenseMap<Value *, unsigned> valueIds;
+  llvm::DenseMap<Block *, unsigned> blockIds;
+  auto getValueId = [&](Value *value) {
+    return valueIds.insert({value, valueIds.size()}).first->second;
+  };
+  auto getBlockId = [&](Block *block) {
+    return blockIds.insert({block, blockIds.size()}).first->second;
+  };
+
+  // Hash the signature, then every block and operation in preorder. Operation
+  // names, attribute dictionaries and types are uniqued, so hashing their
+  // identities covers their contents.
+  llvm::hash_code hash = hash_value(type);
+  SmallVector<Region *, 8> regions = {&getBody()};
+  while (!regions.empty()) {
+    Region *region = regions.pop_back_val();
+    for (auto &block : *region) {
+      hash = llvm::hash_combine(hash, getBlockId(&block),
+                                block.getNumArguments());
+      for (auto *arg : block.getArguments())
+        hash = llvm::hash_combine(hash, getValueId(arg), arg->getType());
+      for (auto &op : block) {
+        hash = llvm::hash_combine(hash, op.getName(),
+                                  op.getAttrList().getDictionary());
+        for (auto *result : op.getResults())
+          hash = llvm::hash_combine(hash, getValueId(result),
+                                    result->getType());
+        for (auto *operand : op.getOperands())
+          hash = llvm::hash_combine(hash, getValueId(operand));
+        for (unsigned i = 0, e = op.getNumSuccessors(); i != e; ++i)
+          hash = llvm::hash_combine(hash, getBlockId(op.getSuccessor(i)));
+        for (auto &nested : op.getRegions())
+          regions.push_back(&nested);
+      }
+    }
+  }
+
+  cachedFingerprint = uint64_t(hash);
+  fingerprintModCount = modificationCount;
+  return cachedFingerprint;
+}
+
+/// Walk only the operations with the given name, in the same postorder as
+/// walk().
+void Function::walk(OperationName name,
+                    const std::function<void(Operation *)> &callback) {
+  // Rebuild the operation kind index if the body changed since it was built.
+  if (!opKindIndex || opKindIndexCount != modificationCount) {
+    auto index = llvm::make_unique<detail::FunctionOpKindIndex>();
+    getBody().walk([&](Operation *op) {
+      index->opsByName[op->getName()].push_back(op);
+    });
+    opKindIndex = std::move(index);
+    opKindIndexCount = modificationCount;
+  }
+
+  auto it = opKindIndex->opsByName.find(name);
+  if (it == opKindIndex->opsByName.end())
+    return;
+
+  // Copy the matching operations so that the callback may mutate the body,
+  // and thereby invalidate or rebuild the index, while we iterate.
+  SmallVector<Operation *, 16> ops(it->second.begin(), it->second.end());
+  for (Operation *op : ops)
+    callback(op);
+}
+
 //===----------------------------------------------------------------------===//
 // Function Operation.
 //===----------------------------------------------------------------------===//
@@ -59,6 +59,8 @@ AffineExpr IntegerSet::getConstraint(unsigned idx) const {
   return getConstraints()[idx];
 }
 
+unsigned IntegerSet::getUniquingHash() const { return set->hashValue; }
+
 /// Returns the equality bits, which specify whether each of the constraints
 /// is an equality or inequality.
 ArrayRef<bool> IntegerSet::getEqFlags() const { return set->eqFlags; }
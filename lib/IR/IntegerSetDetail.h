@@ -32,6 +32,11 @@ struct IntegerSetStorage {
   unsigned dimCount;
   unsigned symbolCount;
 
+  /// The hash of the uniquing key of this set, precomputed at creation time
+  /// so that growing the context's uniquing table does not rehash the
+  /// constraint arrays.
+  unsigned hashValue;
+
   /// Array of affine constraints: a constraint is either an equality
   /// (affine_expr == 0) or an inequality (affine_expr >= 0).
   ArrayRef<AffineExpr> constraints;
@@ -17,6 +17,7 @@
 
 #include "mlir/IR/Location.h"
 #include "LocationDetail.h"
+#include "mlir/IR/MLIRContext.h"
 #include "llvm/ADT/SetVector.h"
 
 using namespace mlir;
@@ -28,6 +29,8 @@ using namespace mlir::detail;
 
 Location CallSiteLoc::get(Location callee, Location caller,
                           MLIRContext *context) {
+  if (context->shouldDiscardLocations())
+    return UnknownLoc::get(context);
   return Base::get(context, StandardAttributes::CallSiteLocation, callee,
                    caller);
 }
@@ -51,6 +54,8 @@ Location CallSiteLoc::getCaller() const { return getImpl()->caller; }
 
 Location FileLineColLoc::get(Identifier filename, unsigned line,
                              unsigned column, MLIRContext *context) {
+  if (context->shouldDiscardLocations())
+    return UnknownLoc::get(context);
   return Base::get(context, StandardAttributes::FileLineColLocation, filename,
                    line, column);
 }
@@ -71,6 +76,15 @@ unsigned FileLineColLoc::getColumn() const { return getImpl()->column; }
 
 Location FusedLoc::get(ArrayRef<Location> locs, Attribute metadata,
                        MLIRContext *context) {
+  if (context->shouldDiscardLocations())
+    return UnknownLoc::get(context);
+
+  // Frontends commonly fuse the same child lists over and over; check for a
+  // memoized result before decomposing the list.
+  ArrayRef<Location> rawLocs = locs;
+  if (auto memoized = context->lookupFusedLocation(rawLocs, metadata))
+    return memoized;
+
   // Unique the set of locations to be fused.
   llvm::SmallSetVector<Location, 4> decomposedLocs;
   for (auto loc : locs) {
@@ -92,11 +106,14 @@ Location FusedLoc::get(ArrayRef<Location> locs, Attribute metadata,
   locs = decomposedLocs.getArrayRef();
 
   // Handle the simple cases of less than two locations.
-  if (locs.empty())
-    return UnknownLoc::get(context);
+  Location result = UnknownLoc::get(context);
   if (locs.size() == 1)
-    return locs.front();
-  return Base::get(context, StandardAttributes::FusedLocation, locs, metadata);
+    result = locs.front();
+  else if (locs.size() > 1)
+    result =
+        Base::get(context, StandardAttributes::FusedLocation, locs, metadata);
+  context->cacheFusedLocation(rawLocs, metadata, result);
+  return result;
 }
 
 ArrayRef<Location> FusedLoc::getLocations() const {
@@ -112,6 +129,8 @@ Attribute FusedLoc::getMetadata() const { return getImpl()->metadata; }
 Location NameLoc::get(Identifier name, Location child, MLIRContext *context) {
   assert(!child.isa<NameLoc>() &&
          "a NameLoc cannot be used as a child of another NameLoc");
+  if (context->shouldDiscardLocations())
+    return UnknownLoc::get(context);
   return Base::get(context, StandardAttributes::NameLocation, name, child);
 }
 
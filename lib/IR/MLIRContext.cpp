@@ -38,8 +38,13 @@
 #include "llvm/ADT/StringMap.h"
 #include "llvm/ADT/Twine.h"
 #include "llvm/Support/Allocator.h"
+#include "llvm/Support/Compiler.h"
+#include "llvm/Support/Mutex.h"
 #include "llvm/Support/RWMutex.h"
 #include "llvm/Support/raw_ostream.h"
+#include <algorithm>
+#include <atomic>
+#include <cstring>
 #include <memory>
 
 using namespace mlir;
@@ -103,8 +108,9 @@ struct AffineMapKeyInfo : DenseMapInfo<AffineMap> {
   using DenseMapInfo<AffineMap>::isEqual;
 
   static unsigned getHashValue(const AffineMap &key) {
-    return getHashValue(
-        KeyTy(key.getNumDims(), key.getNumSymbols(), key.getResults()));
+    // The key hash is precomputed when the map is created, so growing the
+    // uniquing table does not rehash every result expression array.
+    return key.getUniquingHash();
   }
 
   static unsigned getHashValue(KeyTy key) {
@@ -129,8 +135,8 @@ struct IntegerSetKeyInfo : DenseMapInfo<IntegerSet> {
   using DenseMapInfo<IntegerSet>::isEqual;
 
   static unsigned getHashValue(const IntegerSet &key) {
-    return getHashValue(KeyTy(key.getNumDims(), key.getNumSymbols(),
-                              key.getConstraints(), key.getEqFlags()));
+    // The key hash is precomputed when the set is created, see above.
+    return key.getUniquingHash();
   }
 
   static unsigned getHashValue(KeyTy key) {
@@ -147,20 +153,96 @@ struct IntegerSetKeyInfo : DenseMapInfo<IntegerSet> {
                                   rhs.getConstraints(), rhs.getEqFlags());
   }
 };
+
+struct FusedLocationKeyInfo {
+  // Memoized fused locations are keyed by the raw (pre-decomposition) child
+  // location list and the fusion metadata.
+  using KeyTy = std::pair<ArrayRef<Location>, Attribute>;
+
+  static KeyTy getEmptyKey() {
+    return {ArrayRef<Location>(), DenseMapInfo<Attribute>::getEmptyKey()};
+  }
+
+  static KeyTy getTombstoneKey() {
+    return {ArrayRef<Location>(), DenseMapInfo<Attribute>::getTombstoneKey()};
+  }
+
+  static unsigned getHashValue(const KeyTy &key) {
+    return hash_combine(
+        hash_combine_range(key.first.begin(), key.first.end()),
+        DenseMapInfo<Attribute>::getHashValue(key.second));
+  }
+
+  static bool isEqual(const KeyTy &lhs, const KeyTy &rhs) {
+    return lhs.first == rhs.first && lhs.second == rhs.second;
+  }
+};
 } // end anonymous namespace.
 
+/// A process-wide counter used to hand out unique context identifiers.
+static std::atomic<uint64_t> nextContextID(0);
+
 namespace mlir {
 /// This is the implementation of the MLIRContext class, using the pImpl idiom.
 /// This class is completely private to this file, so everything is public.
 class MLIRContextImpl {
 public:
+  /// A process-unique identifier for this context. See
+  /// MLIRContext::getContextID.
+  const uint64_t contextID = ++nextContextID;
+
   //===--------------------------------------------------------------------===//
   // Identifier uniquing
   //===--------------------------------------------------------------------===//
 
-  // Identifier allocator and mutex for thread safety.
-  llvm::BumpPtrAllocator identifierAllocator;
-  llvm::sys::SmartRWMutex<true> identifierMutex;
+  /// The number of shards the identifier table is partitioned into. Strings
+  /// are distributed across the shards by hash value so that threads interning
+  /// unrelated identifiers do not contend on a single lock. Must be a power of
+  /// two.
+  enum { NumIdentifierShards = 16 };
+
+  /// A single hash-partitioned slice of the identifier table. Each shard owns
+  /// its own allocator and lock.
+  struct IdentifierShard {
+    IdentifierShard() : identifiers(allocator) {}
+
+    /// The allocator that owns the bytes of the identifiers in this shard.
+    llvm::BumpPtrAllocator allocator;
+
+    /// A mutex guarding this shard's table and allocator.
+    llvm::sys::SmartRWMutex<true> mutex;
+
+    /// The identifiers uniqued into this shard.
+    llvm::StringMap<char, llvm::BumpPtrAllocator &> identifiers;
+  };
+  IdentifierShard identifierShards[NumIdentifierShards];
+
+  /// Return the identifier shard used for the given string hash. The shard
+  /// index is taken from the upper bits of the hash as StringMap consumes the
+  /// lower bits for bucket selection.
+  IdentifierShard &getIdentifierShard(unsigned hashValue) {
+    return identifierShards[(hashValue >> (32 - 4)) &
+                            (NumIdentifierShards - 1)];
+  }
+
+  //===--------------------------------------------------------------------===//
+  // Operation memory attribution
+  //===--------------------------------------------------------------------===//
+
+  /// Per-dialect operation memory counters, keyed by dialect namespace. Only
+  /// populated when -mlir-track-op-memory is set. Guarded by opMemoryMutex.
+  struct OpMemoryCounters {
+    /// The number of operations created for this dialect.
+    uint64_t numCreated = 0;
+
+    /// The total bytes ever allocated for this dialect's operations.
+    uint64_t allocatedBytes = 0;
+
+    /// The bytes of this dialect's operations that are currently live.
+    uint64_t liveBytes = 0;
+  };
+  llvm::StringMap<OpMemoryCounters> opMemoryByDialect;
+  llvm::sys::SmartMutex<true> opMemoryMutex;
 
   //===--------------------------------------------------------------------===//
   // Diagnostics
@@ -183,13 +265,23 @@ public:
   /// operations.
   llvm::StringMap<AbstractOperation> registeredOperations;
 
+  /// A lock-free lookup view of 'registeredOperations': entries sorted by
+  /// operation name, published through an atomic pointer. The registered op
+  /// set is frozen in practice once dialect registration completes, so the
+  /// snapshot is built on first lookup and invalidated by any later
+  /// registration. Superseded snapshots are retired to 'operationSnapshots'
+  /// rather than freed, since readers may still be scanning them; the names
+  /// reference the StringMap entries, whose storage is stable.
+  using OperationLookupEntry = std::pair<StringRef, const AbstractOperation *>;
+  std::atomic<const std::vector<OperationLookupEntry> *>
+      operationLookupSnapshot{nullptr};
+  std::vector<std::unique_ptr<std::vector<OperationLookupEntry>>>
+      operationSnapshots;
+
   /// This is a mapping from class identifier to Dialect for registered
   /// attributes and types.
   DenseMap<const ClassID *, Dialect *> registeredDialectSymbols;
 
-  /// These are identifiers uniqued into this MLIRContext.
-  llvm::StringMap<char, llvm::BumpPtrAllocator &> identifiers;
-
   //===--------------------------------------------------------------------===//
   // Affine uniquing
   //===--------------------------------------------------------------------===//
@@ -202,6 +294,11 @@ public:
   using AffineMapSet = DenseSet<AffineMap, AffineMapKeyInfo>;
   AffineMapSet affineMaps;
 
+  // Canonical identity maps, indexed by dimension count. Identity maps are by
+  // far the most frequently requested maps, so they bypass the uniquing table
+  // entirely. Guarded by affineMutex.
+  std::vector<AffineMap> identityAffineMaps;
+
   // Integer set uniquing.
   using IntegerSets = DenseSet<IntegerSet, IntegerSetKeyInfo>;
   IntegerSets integerSets;
@@ -209,6 +306,16 @@ public:
   // Affine expression uniqui'ing.
   StorageUniquer affineUniquer;
 
+  // Memoized results of affine expression simplification, keyed by the
+  // uniqued expression and the packed dimension/symbol counts it was
+  // simplified with. Guarded by affineMutex.
+  DenseMap<std::pair<AffineExpr, uint64_t>, AffineExpr> simplifiedAffineExprs;
+
+  // Memoized local-free flattened coefficient rows, keyed like
+  // simplifiedAffineExprs. Guarded by affineMutex.
+  DenseMap<std::pair<AffineExpr, uint64_t>, std::vector<int64_t>>
+      flattenedAffineExprs;
+
   //===--------------------------------------------------------------------===//
   // Type uniquing
   //===--------------------------------------------------------------------===//
@@ -230,8 +337,25 @@ public:
   UnitAttr unitAttr;
   UnknownLoc unknownLocAttr;
 
+  /// A mutex guarding the memoized fused location results.
+  llvm::sys::SmartRWMutex<true> fusedLocMutex;
+
+  /// Backing storage for the raw child location lists used as keys in
+  /// 'fusedLocations'. Guarded by fusedLocMutex.
+  llvm::BumpPtrAllocator fusedLocAllocator;
+
+  /// Memoized results of FusedLoc::get, keyed by the raw (pre-decomposition)
+  /// child location list and the fusion metadata. Guarded by fusedLocMutex.
+  DenseMap<std::pair<ArrayRef<Location>, Attribute>, LocationAttr,
+           FusedLocationKeyInfo>
+      fusedLocations;
+
+  /// When set, newly constructed locations collapse to UnknownLoc. This is
+  /// only expected to be toggled before the context is shared across threads.
+  bool discardLocations = false;
+
 public:
-  MLIRContextImpl() : identifiers(identifierAllocator) {}
+  MLIRContextImpl() {}
 };
 } // end namespace mlir
 
@@ -281,7 +405,17 @@ MLIRContext::MLIRContext() : impl(new MLIRContextImpl()) {
       this, StandardAttributes::UnknownLocation);
 }
 
-MLIRContext::~MLIRContext() {}
+/// A monotonically increasing counter bumped whenever an MLIRContext is
+/// destroyed. Each thread-local identifier cache is flushed when it observes a
+/// new epoch, so cached entries never match a later context allocated at the
+/// same address. See getIdentifierThreadCache() below.
+static std::atomic<uint64_t> contextDestructionEpoch(0);
+
+MLIRContext::~MLIRContext() {
+  // The thread-local identifier caches hold pointers into this context's
+  // identifier tables; invalidate them.
+  contextDestructionEpoch.fetch_add(1, std::memory_order_release);
+}
 
 /// Copy the specified array of elements into memory managed by the provided
 /// bump pointer allocator.  This assumes the elements are all PODs.
@@ -388,6 +522,9 @@ void Dialect::addOperation(AbstractOperation opInfo) {
                  << "' is already registered.\n";
     abort();
   }
+  // Invalidate the lookup snapshot; it is rebuilt on the next lookup. The
+  // superseded snapshot stays in 'operationSnapshots' for concurrent readers.
+  impl.operationLookupSnapshot.store(nullptr, std::memory_order_release);
 }
 
 /// Register a dialect-specific symbol(e.g. type) with the current context.
@@ -408,11 +545,37 @@ const AbstractOperation *AbstractOperation::lookup(StringRef opName,
                                                    MLIRContext *context) {
   auto &impl = context->getImpl();
 
-  // Lock access to the context registry.
-  llvm::sys::SmartScopedReader<true> registryLock(impl.contextMutex);
-  auto it = impl.registeredOperations.find(opName);
-  if (it != impl.registeredOperations.end())
-    return &it->second;
+  // Op name resolution is hot in parsing and in Operation::create, and the
+  // registered op set does not change once dialect registration completes.
+  // Steady-state lookups binary search a sorted snapshot without taking the
+  // registry lock; the snapshot is built here on first use.
+  const auto *snapshot =
+      impl.operationLookupSnapshot.load(std::memory_order_acquire);
+  if (!snapshot) {
+    // Lock access to the context registry and publish a fresh snapshot,
+    // unless another thread won the race.
+    llvm::sys::SmartScopedWriter<true> registryLock(impl.contextMutex);
+    snapshot = impl.operationLookupSnapshot.load(std::memory_order_relaxed);
+    if (!snapshot) {
+      auto newSnapshot = llvm::make_unique<
+          std::vector<MLIRContextImpl::OperationLookupEntry>>();
+      newSnapshot->reserve(impl.registeredOperations.size());
+      for (auto &entry : impl.registeredOperations)
+        newSnapshot->push_back({entry.first(), &entry.second});
+      llvm::array_pod_sort(newSnapshot->begin(), newSnapshot->end());
+      snapshot = newSnapshot.get();
+      impl.operationSnapshots.push_back(std::move(newSnapshot));
+      impl.operationLookupSnapshot.store(snapshot, std::memory_order_release);
+    }
+  }
+
+  auto it = std::lower_bound(
+      snapshot->begin(), snapshot->end(), opName,
+      [](const MLIRContextImpl::OperationLookupEntry &entry, StringRef name) {
+        return entry.first < name;
+      });
+  if (it != snapshot->end() && it->first == opName)
+    return it->second;
   return nullptr;
 }
 
@@ -420,25 +583,216 @@ const AbstractOperation *AbstractOperation::lookup(StringRef opName,
 // Identifier uniquing
 //===----------------------------------------------------------------------===//
 
+namespace {
+/// A small thread-local direct-mapped cache of recently interned identifiers.
+/// Identifiers are create-once/read-forever, so a cached pointer can be
+/// returned without touching the shared tables or their locks.
+struct IdentifierThreadCache {
+  struct Entry {
+    MLIRContext *context;
+    const char *pointer;
+    unsigned size;
+  };
+
+  /// The number of cache entries. Must be a power of two.
+  enum { NumEntries = 64 };
+
+  Entry &getEntry(unsigned hashValue) {
+    return entries[(hashValue >> 4) & (NumEntries - 1)];
+  }
+
+  Entry entries[NumEntries] = {};
+
+  /// The context destruction epoch this cache was last validated against. See
+  /// getIdentifierThreadCache() below.
+  uint64_t destructionEpoch = 0;
+};
+} // end anonymous namespace
+
+static IdentifierThreadCache &getIdentifierThreadCache() {
+  static LLVM_THREAD_LOCAL IdentifierThreadCache *cache = nullptr;
+  if (!cache)
+    cache = new IdentifierThreadCache();
+
+  // Flush the cache if any context was destroyed since the last use. Entries
+  // from a destroyed context dangle, and a later context allocated at the same
+  // address would otherwise match them.
+  uint64_t epoch = contextDestructionEpoch.load(std::memory_order_acquire);
+  if (LLVM_UNLIKELY(cache->destructionEpoch != epoch)) {
+    *cache = IdentifierThreadCache();
+    cache->destructionEpoch = epoch;
+  }
+  return *cache;
+}
+
 /// Return an identifier for the specified string.
 Identifier Identifier::get(StringRef str, MLIRContext *context) {
   assert(!str.empty() && "Cannot create an empty identifier");
   assert(str.find('\0') == StringRef::npos &&
          "Cannot create an identifier with a nul character");
 
+  // Consult the thread-local cache first; hits are lock-free. Identifiers are
+  // never erased, so cached pointers stay valid until the context itself is
+  // destroyed, at which point the cache is flushed wholesale.
+  unsigned hashValue = unsigned(llvm::hash_value(str));
+  IdentifierThreadCache::Entry &entry =
+      getIdentifierThreadCache().getEntry(hashValue);
+  if (entry.context == context && entry.size == str.size() &&
+      memcmp(entry.pointer, str.data(), str.size()) == 0)
+    return Identifier(entry.pointer);
+
   auto &impl = context->getImpl();
+  auto &shard = impl.getIdentifierShard(hashValue);
 
+  const char *pointer;
   { // Check for an existing identifier in read-only mode.
-    llvm::sys::SmartScopedReader<true> contextLock(impl.identifierMutex);
-    auto it = impl.identifiers.find(str);
-    if (it != impl.identifiers.end())
-      return Identifier(it->getKeyData());
+    llvm::sys::SmartScopedReader<true> contextLock(shard.mutex);
+    auto it = shard.identifiers.find(str);
+    if (it != shard.identifiers.end())
+      pointer = it->getKeyData();
+    else
+      pointer = nullptr;
   }
 
-  // Aquire a writer-lock so that we can safely create the new instance.
-  llvm::sys::SmartScopedWriter<true> contextLock(impl.identifierMutex);
-  auto it = impl.identifiers.insert({str, char()}).first;
-  return Identifier(it->getKeyData());
+  if (!pointer) {
+    // Aquire a writer-lock so that we can safely create the new instance.
+    llvm::sys::SmartScopedWriter<true> contextLock(shard.mutex);
+    pointer = shard.identifiers.insert({str, char()}).first->getKeyData();
+  }
+
+  entry = IdentifierThreadCache::Entry{context, pointer, unsigned(str.size())};
+  return Identifier(pointer);
+}
+
+//===----------------------------------------------------------------------===//
+// Storage Statistics
+//===----------------------------------------------------------------------===//
+
+/// Returns an identifier for this context that is unique within the process
+/// lifetime.
+uint64_t MLIRContext::getContextID() { return getImpl().contextID; }
+
+/// Returns the name of the dialect symbol range that defines the given kind,
+/// where 'firstRangeKind' is the kind value that begins the first range
+/// reserved through DialectSymbolRegistry.def. Kinds below the first range
+/// belong to the builtin dialect.
+static StringRef getDialectForSymKind(unsigned kind, unsigned firstRangeKind) {
+  static const char *const rangeNames[] = {
+#define DEFINE_SYM_KIND_RANGE(Dialect) #Dialect,
+#include "mlir/IR/DialectSymbolRegistry.def"
+  };
+  if (kind < firstRangeKind)
+    return "BUILTIN";
+  // Each range reserves 0x100 kind values.
+  unsigned rangeIndex = (kind - firstRangeKind) >> 8;
+  if (rangeIndex < llvm::array_lengthof(rangeNames))
+    return rangeNames[rangeIndex];
+  return "UNKNOWN";
+}
+
+/// Prints statistics about the memory held by this context to 'os'.
+void MLIRContext::printStorageStatistics(raw_ostream &os) {
+  auto &impl = getImpl();
+
+  // Print the instance counts and allocator byte totals for the provided
+  // uniquer, attributed per dialect symbol range when a grouping function is
+  // provided.
+  auto printUniquer = [&](StringRef name, StorageUniquer &uniquer,
+                          llvm::function_ref<StringRef(unsigned)> getGroup) {
+    DenseMap<unsigned, unsigned> numInstancesByKind;
+    DenseMap<unsigned, size_t> bytesByKind;
+    size_t allocatedBytes = 0;
+    uniquer.getStatistics(numInstancesByKind, bytesByKind, allocatedBytes);
+
+    size_t numInstances = 0;
+    for (const auto &entry : numInstancesByKind)
+      numInstances += entry.second;
+    os << name << ": " << numInstances << " instances, " << allocatedBytes
+       << " bytes\n";
+    if (!getGroup)
+      return;
+
+    // Accumulate the per-dialect breakdown and print it in name order.
+    llvm::StringMap<std::pair<unsigned, size_t>> groups;
+    for (const auto &entry : numInstancesByKind) {
+      auto &group = groups[getGroup(entry.first)];
+      group.first += entry.second;
+      group.second += bytesByKind.lookup(entry.first);
+    }
+    SmallVector<StringRef, 8> groupNames;
+    for (const auto &entry : groups)
+      groupNames.push_back(entry.first());
+    llvm::sort(groupNames.begin(), groupNames.end());
+    for (StringRef groupName : groupNames) {
+      const auto &group = groups[groupName];
+      os << "  " << groupName << ": " << group.first << " instances, "
+         << group.second << " bytes\n";
+    }
+  };
+
+  os << "MLIRContext storage statistics:\n";
+  printUniquer("types", impl.typeUniquer, [](unsigned kind) {
+    return getDialectForSymKind(kind, Type::Kind::FIRST_STANDARD_TYPE);
+  });
+  printUniquer("attributes", impl.attributeUniquer, [](unsigned kind) {
+    return getDialectForSymKind(kind, Attribute::Kind::FIRST_STANDARD_ATTR);
+  });
+  printUniquer("affine expressions", impl.affineUniquer,
+               /*getGroup=*/nullptr);
+
+  { // The affine map and integer set tables share one allocator.
+    llvm::sys::SmartScopedReader<true> affineLock(impl.affineMutex);
+    os << "affine maps: " << impl.affineMaps.size() << " instances\n"
+       << "integer sets: " << impl.integerSets.size() << " instances\n"
+       << "affine allocator: " << impl.affineAllocator.getBytesAllocated()
+       << " bytes\n";
+  }
+
+  {
+    size_t numIdentifiers = 0, identifierBytes = 0;
+    for (auto &shard : impl.identifierShards) {
+      llvm::sys::SmartScopedReader<true> identifierLock(shard.mutex);
+      numIdentifiers += shard.identifiers.size();
+      identifierBytes += shard.allocator.getBytesAllocated();
+    }
+    os << "identifiers: " << numIdentifiers << " instances, "
+       << identifierBytes << " bytes\n";
+  }
+
+  { // Print the per-dialect operation memory counters. These are only
+    // populated when -mlir-track-op-memory is set.
+    llvm::sys::SmartScopedLock<true> opMemoryLock(impl.opMemoryMutex);
+    if (!impl.opMemoryByDialect.empty()) {
+      os << "operations:\n";
+      SmallVector<StringRef, 8> dialectNames;
+      for (const auto &entry : impl.opMemoryByDialect)
+        dialectNames.push_back(entry.first());
+      llvm::sort(dialectNames.begin(), dialectNames.end());
+      for (StringRef dialectName : dialectNames) {
+        const auto &counters = impl.opMemoryByDialect[dialectName];
+        os << "  " << (dialectName.empty() ? "<builtin>" : dialectName) << ": "
+           << counters.numCreated << " created, " << counters.liveBytes
+           << " live bytes, " << counters.allocatedBytes
+           << " allocated bytes\n";
+      }
+    }
+  }
+}
+
+/// Adjusts the number of operation bytes attributed to the dialect with the
+/// given namespace; negative values record freed operations.
+void MLIRContext::recordOperationMemory(StringRef dialectNamespace,
+                                        int64_t bytes) {
+  auto &impl = getImpl();
+  llvm::sys::SmartScopedLock<true> opMemoryLock(impl.opMemoryMutex);
+  auto &counters = impl.opMemoryByDialect[dialectNamespace];
+  if (bytes >= 0) {
+    ++counters.numCreated;
+    counters.allocatedBytes += bytes;
+    counters.liveBytes += bytes;
+  } else {
+    counters.liveBytes -= uint64_t(-bytes);
+  }
 }
 
 //===----------------------------------------------------------------------===//
@@ -558,6 +912,37 @@ Location UnknownLoc::get(MLIRContext *context) {
   return context->getImpl().unknownLocAttr;
 }
 
+LocationAttr MLIRContext::lookupFusedLocation(ArrayRef<Location> locs,
+                                              Attribute metadata) {
+  auto &impl = getImpl();
+  llvm::sys::SmartScopedReader<true> locLock(impl.fusedLocMutex);
+  auto it = impl.fusedLocations.find({locs, metadata});
+  return it == impl.fusedLocations.end() ? LocationAttr() : it->second;
+}
+
+void MLIRContext::cacheFusedLocation(ArrayRef<Location> locs,
+                                     Attribute metadata, Location fused) {
+  auto &impl = getImpl();
+  llvm::sys::SmartScopedWriter<true> locLock(impl.fusedLocMutex);
+  if (impl.fusedLocations.count({locs, metadata}))
+    return;
+
+  // Copy the child list into context-owned storage so the key outlives the
+  // caller's buffer.
+  auto *data = impl.fusedLocAllocator.Allocate<Location>(locs.size());
+  std::uninitialized_copy(locs.begin(), locs.end(), data);
+  impl.fusedLocations.insert(
+      {{ArrayRef<Location>(data, locs.size()), metadata}, LocationAttr(fused)});
+}
+
+void MLIRContext::setDiscardLocations(bool discard) {
+  getImpl().discardLocations = discard;
+}
+
+bool MLIRContext::shouldDiscardLocations() {
+  return getImpl().discardLocations;
+}
+
 //===----------------------------------------------------------------------===//
 // AffineMap uniquing
 //===----------------------------------------------------------------------===//
@@ -566,6 +951,47 @@ StorageUniquer &MLIRContext::getAffineUniquer() {
   return getImpl().affineUniquer;
 }
 
+AffineExpr MLIRContext::lookupSimplifiedAffineExpr(AffineExpr expr,
+                                                   unsigned numDims,
+                                                   unsigned numSymbols) {
+  auto &impl = getImpl();
+  auto key = std::make_pair(expr, (uint64_t(numDims) << 32) | numSymbols);
+  llvm::sys::SmartScopedReader<true> affineLock(impl.affineMutex);
+  return impl.simplifiedAffineExprs.lookup(key);
+}
+
+void MLIRContext::cacheSimplifiedAffineExpr(AffineExpr expr, unsigned numDims,
+                                            unsigned numSymbols,
+                                            AffineExpr simplified) {
+  auto &impl = getImpl();
+  auto key = std::make_pair(expr, (uint64_t(numDims) << 32) | numSymbols);
+  llvm::sys::SmartScopedWriter<true> affineLock(impl.affineMutex);
+  impl.simplifiedAffineExprs.insert({key, simplified});
+}
+
+bool MLIRContext::lookupFlattenedAffineExpr(AffineExpr expr, unsigned numDims,
+                                            unsigned numSymbols,
+                                            SmallVectorImpl<int64_t> &row) {
+  auto &impl = getImpl();
+  auto key = std::make_pair(expr, (uint64_t(numDims) << 32) | numSymbols);
+  llvm::sys::SmartScopedReader<true> affineLock(impl.affineMutex);
+  auto it = impl.flattenedAffineExprs.find(key);
+  if (it == impl.flattenedAffineExprs.end())
+    return false;
+  row.assign(it->second.begin(), it->second.end());
+  return true;
+}
+
+void MLIRContext::cacheFlattenedAffineExpr(AffineExpr expr, unsigned numDims,
+                                           unsigned numSymbols,
+                                           ArrayRef<int64_t> row) {
+  auto &impl = getImpl();
+  auto key = std::make_pair(expr, (uint64_t(numDims) << 32) | numSymbols);
+  llvm::sys::SmartScopedWriter<true> affineLock(impl.affineMutex);
+  impl.flattenedAffineExprs.insert(
+      {key, std::vector<int64_t>(row.begin(), row.end())});
+}
+
 AffineMap AffineMap::get(unsigned dimCount, unsigned symbolCount,
                          ArrayRef<AffineExpr> results) {
   // The number of results can't be zero.
@@ -578,15 +1004,49 @@ AffineMap AffineMap::get(unsigned dimCount, unsigned symbolCount,
   return safeGetOrCreate(impl.affineMaps, key, impl.affineMutex, [&] {
     auto *res = impl.affineAllocator.Allocate<detail::AffineMapStorage>();
 
-    // Copy the results into the bump pointer.
-    results = copyArrayRefInto(impl.affineAllocator, results);
-
     // Initialize the memory using placement new.
-    new (res) detail::AffineMapStorage{dimCount, symbolCount, results};
+    new (res) detail::AffineMapStorage();
+    res->numDims = dimCount;
+    res->numSymbols = symbolCount;
+    res->hashValue = AffineMapKeyInfo::getHashValue(key);
+
+    // Store small result arrays inline, otherwise copy them into the bump
+    // pointer.
+    if (results.size() <= detail::AffineMapStorage::kInlineResults) {
+      std::copy(results.begin(), results.end(), res->inlineResults);
+      res->results = llvm::makeArrayRef(res->inlineResults, results.size());
+    } else {
+      res->results = copyArrayRefInto(impl.affineAllocator, results);
+    }
     return AffineMap(res);
   });
 }
 
+AffineMap AffineMap::getMultiDimIdentityMap(unsigned numDims,
+                                            MLIRContext *context) {
+  auto &impl = context->getImpl();
+
+  { // Check for an existing canonical identity map in read-only mode.
+    llvm::sys::SmartScopedReader<true> affineLock(impl.affineMutex);
+    if (numDims < impl.identityAffineMaps.size())
+      if (auto existing = impl.identityAffineMaps[numDims])
+        return existing;
+  }
+
+  SmallVector<AffineExpr, 4> dimExprs;
+  dimExprs.reserve(numDims);
+  for (unsigned i = 0; i < numDims; ++i)
+    dimExprs.push_back(getAffineDimExpr(i, context));
+  auto map = get(/*dimCount=*/numDims, /*symbolCount=*/0, dimExprs);
+
+  // Record the canonical map so later requests are a vector index away.
+  llvm::sys::SmartScopedWriter<true> affineLock(impl.affineMutex);
+  if (numDims >= impl.identityAffineMaps.size())
+    impl.identityAffineMaps.resize(numDims + 1);
+  impl.identityAffineMaps[numDims] = map;
+  return map;
+}
+
 //===----------------------------------------------------------------------===//
 // Integer Sets: these are allocated into the bump pointer, and are immutable.
 // Unlike AffineMap's, these are uniqued only if they are small.
@@ -605,13 +1065,18 @@ IntegerSet IntegerSet::get(unsigned dimCount, unsigned symbolCount,
   auto constructorFn = [&] {
     auto *res = impl.affineAllocator.Allocate<detail::IntegerSetStorage>();
 
+    // Precompute the key hash before the arrays are rebased onto the bump
+    // pointer, see IntegerSetKeyInfo.
+    unsigned hashValue = IntegerSetKeyInfo::getHashValue(
+        std::make_tuple(dimCount, symbolCount, constraints, eqFlags));
+
     // Copy the results and equality flags into the bump pointer.
     constraints = copyArrayRefInto(impl.affineAllocator, constraints);
     eqFlags = copyArrayRefInto(impl.affineAllocator, eqFlags);
 
     // Initialize the memory using placement new.
-    new (res)
-        detail::IntegerSetStorage{dimCount, symbolCount, constraints, eqFlags};
+    new (res) detail::IntegerSetStorage{dimCount, symbolCount, hashValue,
+                                        constraints, eqFlags};
     return IntegerSet(res);
   };
 
@@ -18,9 +18,36 @@
 #include "mlir/IR/Module.h"
 #include "mlir/IR/Builders.h"
 #include "mlir/IR/OpImplementation.h"
+#include "llvm/ADT/Hashing.h"
+#include "llvm/Support/Parallel.h"
+#include "llvm/Support/Threading.h"
 
 using namespace mlir;
 
+//===----------------------------------------------------------------------===//
+// Module
+//===----------------------------------------------------------------------===//
+
+/// Returns a structural fingerprint of the module, combining the fingerprints
+/// of all functions in order.
+uint64_t Module::getFingerprint() {
+  std::vector<Function *> fns;
+  for (auto &fn : *this)
+    fns.push_back(&fn);
+
+  // Functions are independent, so compute (and cache) their fingerprints in
+  // parallel when multi-threading is available.
+  if (llvm::llvm_is_multithreaded() && fns.size() > 1)
+    llvm::parallel::for_each(llvm::parallel::par, fns.begin(), fns.end(),
+                             [](Function *fn) { (void)fn->getFingerprint(); });
+
+  llvm::hash_code hash = llvm::hash_value(fns.size());
+  for (auto *fn : fns)
+    hash = llvm::hash_combine(hash, fn->getName().strref(),
+                              fn->getFingerprint());
+  return uint64_t(hash);
+}
+
 //===----------------------------------------------------------------------===//
 // Module Operation.
 //===----------------------------------------------------------------------===//
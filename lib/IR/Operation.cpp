@@ -25,9 +25,100 @@
 #include "mlir/IR/OpImplementation.h"
 #include "mlir/IR/PatternMatch.h"
 #include "mlir/IR/StandardTypes.h"
+#include "llvm/Support/CommandLine.h"
+#include "llvm/Support/MathExtras.h"
+#include <cstdlib>
 #include <numeric>
 using namespace mlir;
 
+static llvm::cl::opt<bool> trackOpMemory(
+    "mlir-track-op-memory",
+    llvm::cl::desc("Attribute operation allocations to their dialect in the "
+                   "context memory statistics"),
+    llvm::cl::init(false));
+
+namespace {
+/// A thread-local recycler for the trailing-object allocations backing
+/// Operation instances. Op-churn-heavy transformations (unrolling, inlining,
+/// dialect conversion) create and destroy large numbers of similarly sized
+/// operations; recycling the allocations keeps that traffic out of
+/// malloc/free. Allocations are rounded up to a size-class granularity and
+/// freed blocks are kept on per-class free lists, capped so that a burst of
+/// destroyed operations cannot pin an unbounded amount of memory.
+class OperationMemoryRecycler {
+public:
+  ~OperationMemoryRecycler() {
+    for (FreeNode *&head : buckets) {
+      while (FreeNode *node = head) {
+        head = node->next;
+        std::free(node);
+      }
+    }
+  }
+
+  /// Allocate at least `byteSize` bytes of storage for an operation. The
+  /// size is rounded up to the owning size class (or left untouched for
+  /// allocations too large to recycle) and must be passed back unchanged to
+  /// deallocate().
+  void *allocate(size_t &byteSize) {
+    size_t bucket = getBucket(byteSize);
+    if (bucket >= NumBuckets)
+      return std::malloc(byteSize);
+    byteSize = (bucket + 1) * Granularity;
+    FreeNode *&head = buckets[bucket];
+    if (!head)
+      return std::malloc(byteSize);
+    FreeNode *node = head;
+    head = node->next;
+    --bucketSizes[bucket];
+    return node;
+  }
+
+  /// Return the storage of a destroyed operation to the recycler.
+  void deallocate(void *ptr, size_t byteSize) {
+    size_t bucket = getBucket(byteSize);
+    if (bucket >= NumBuckets || bucketSizes[bucket] >= MaxFreePerBucket)
+      return std::free(ptr);
+    FreeNode *node = static_cast<FreeNode *>(ptr);
+    node->next = buckets[bucket];
+    buckets[bucket] = node;
+    ++bucketSizes[bucket];
+  }
+
+private:
+  struct FreeNode {
+    FreeNode *next;
+  };
+
+  /// Size classes are multiples of Granularity bytes; allocations above
+  /// NumBuckets * Granularity bytes fall through to malloc/free directly.
+  enum : size_t { Granularity = 64, NumBuckets = 32, MaxFreePerBucket = 64 };
+
+  static size_t getBucket(size_t byteSize) {
+    return (byteSize - 1) / Granularity;
+  }
+
+  FreeNode *buckets[NumBuckets] = {};
+  unsigned bucketSizes[NumBuckets] = {};
+};
+
+/// Returns the operation memory recycler for the current thread.
+static OperationMemoryRecycler &getOperationRecycler() {
+  static thread_local OperationMemoryRecycler recycler;
+  return recycler;
+}
+
+/// Each operation allocation is prefixed with a header recording the size of
+/// the allocation, so that destroy() can hand the memory back to the
+/// recycler. The header preserves the alignment malloc guarantees for the
+/// operation and its trailing objects.
+enum : size_t {
+  OperationAllocHeaderSize =
+      (sizeof(size_t) + alignof(std::max_align_t) - 1) /
+      alignof(std::max_align_t) * alignof(std::max_align_t)
+};
+} // end anonymous namespace
+
 /// Form the OperationName for an op with the specified string.  This either is
 /// a reference to an AbstractOperation if one is known, or a uniqued Identifier
 /// if not.
@@ -132,6 +223,9 @@ Operation *Operation::create(Location location, OperationName name,
                              ArrayRef<Block *> successors, unsigned numRegions,
                              bool resizableOperandList, MLIRContext *context) {
   unsigned numSuccessors = successors.size();
+  assert(resultTypes.size() <= kMaxResults && "too many results");
+  assert(numSuccessors <= kMaxSuccessors && "too many successors");
+  assert(numRegions <= kMaxRegions && "too many regions");
 
   // Input operands are nullptr-separated for each successor, the null operands
   // aren't actually stored.
@@ -145,12 +239,23 @@ Operation *Operation::create(Location location, OperationName name,
   byteSize += llvm::alignTo(detail::OperandStorage::additionalAllocSize(
                                 numOperands, resizableOperandList),
                             alignof(Operation));
-  void *rawMem = malloc(byteSize);
+
+  // Allocate from the thread-local recycler, prefixing the operation with a
+  // header recording the allocation size for destroy().
+  size_t allocSize = byteSize + OperationAllocHeaderSize;
+  char *rawMem =
+      static_cast<char *>(getOperationRecycler().allocate(allocSize));
+  *reinterpret_cast<size_t *>(rawMem) = allocSize;
+
+  // Attribute the allocation to the operation's dialect when memory tracking
+  // is enabled.
+  if (trackOpMemory)
+    context->recordOperationMemory(name.getDialect(), allocSize);
 
   // Create the new Operation.
-  auto op =
-      ::new (rawMem) Operation(location, name, resultTypes.size(),
-                               numSuccessors, numRegions, attributes, context);
+  auto op = ::new (rawMem + OperationAllocHeaderSize)
+      Operation(location, name, resultTypes.size(), numSuccessors, numRegions,
+                attributes, context);
 
   assert((numSuccessors == 0 || !op->isKnownNonTerminator()) &&
          "unexpected successors in a non-terminator operation");
@@ -234,7 +339,7 @@ Operation::Operation(Location location, OperationName name, unsigned numResults,
       numRegions(numRegions), name(name), attrs(attributes) {}
 
 // Operations are deleted through the destroy() member because they are
-// allocated via malloc.
+// allocated via the thread-local operation recycler.
 Operation::~Operation() {
   assert(block == nullptr && "operation destroyed but still in a block");
 
@@ -255,8 +360,18 @@ Operation::~Operation() {
 
 /// Destroy this operation or one of its subclasses.
 void Operation::destroy() {
+  char *rawMem = reinterpret_cast<char *>(this) - OperationAllocHeaderSize;
+  size_t allocSize = *reinterpret_cast<size_t *>(rawMem);
+
+  // Credit the freed bytes back to the operation's dialect when memory
+  // tracking is enabled. This must happen before the destructor runs, as it
+  // reads the operation's name and location.
+  if (trackOpMemory)
+    getContext()->recordOperationMemory(getName().getDialect(),
+                                        -int64_t(allocSize));
+
   this->~Operation();
-  free(this);
+  getOperationRecycler().deallocate(rawMem, allocSize);
 }
 
 /// Return the context this operation is associated with.
@@ -285,6 +400,13 @@ Function *Operation::getFunction() {
   return block ? block->getFunction() : nullptr;
 }
 
+void Operation::markFunctionModified() {
+  if (Function *fn = getFunction())
+    fn->markBodyModified();
+}
+
+void IROperand::notifyOwnerBodyModified() { owner->markFunctionModified(); }
+
 /// Replace any uses of 'from' with 'to' within this operation.
 void Operation::replaceUsesOfWith(Value *from, Value *to) {
   if (from == to)
@@ -334,16 +456,74 @@ InFlightDiagnostic Operation::emitRemark(const Twine &message) {
 /// of the parent block.
 /// Note: This function has an average complexity of O(1), but worst case may
 /// take O(N) where N is the number of operations within the parent block.
+constexpr unsigned Operation::kInvalidOrderIdx;
+constexpr unsigned Operation::kOrderStride;
+
 bool Operation::isBeforeInBlock(Operation *other) {
   assert(block && "Operations without parent blocks have no order.");
   assert(other && other->block == block &&
          "Expected other operation to have the same parent block.");
-  // Recompute the parent ordering if necessary.
-  if (!block->isInstOrderValid())
+  // If the order of the block is known to be invalid, recompute the whole
+  // parent ordering; otherwise only the operations with unassigned indices
+  // need to be updated.
+  if (!block->isInstOrderValid()) {
     block->recomputeInstOrder();
+  } else {
+    updateOrderIfNecessary();
+    other->updateOrderIfNecessary();
+  }
   return orderIndex < other->orderIndex;
 }
 
+void Operation::updateOrderIfNecessary() {
+  assert(block && "expected valid parent");
+
+  // If the order index is already assigned, there is nothing to do.
+  if (hasValidOrder())
+    return;
+  Operation *blockFront = &block->front();
+  Operation *blockBack = &block->back();
+
+  // This method is expected to only be invoked on blocks with more than one
+  // operation.
+  assert(blockFront != blockBack && "expected more than one operation");
+
+  // If the operation is at the end of the block, extend past the index of the
+  // previous operation.
+  if (this == blockBack) {
+    Operation *prevNode = getPrevNode();
+    if (!prevNode->hasValidOrder())
+      return block->recomputeInstOrder();
+    if (prevNode->orderIndex >= kInvalidOrderIdx - kOrderStride)
+      return block->redistributeInstOrder(prevNode, this);
+    orderIndex = prevNode->orderIndex + kOrderStride;
+    return;
+  }
+
+  // If the operation is at the beginning of the block, place it below the
+  // index of the next operation if there is room.
+  if (this == blockFront) {
+    Operation *nextNode = getNextNode();
+    if (!nextNode->hasValidOrder())
+      return block->recomputeInstOrder();
+    if (nextNode->orderIndex == 0)
+      return block->redistributeInstOrder(this, nextNode);
+    orderIndex = nextNode->orderIndex / 2;
+    return;
+  }
+
+  // Otherwise, the operation is between two others; take the middle of the
+  // gap between them if one exists, and renumber a local neighborhood
+  // otherwise.
+  Operation *prevNode = getPrevNode(), *nextNode = getNextNode();
+  if (!prevNode->hasValidOrder() || !nextNode->hasValidOrder())
+    return block->recomputeInstOrder();
+  unsigned prevOrder = prevNode->orderIndex, nextOrder = nextNode->orderIndex;
+  if (prevOrder + 1 == nextOrder)
+    return block->redistributeInstOrder(prevNode, nextNode);
+  orderIndex = prevOrder + (nextOrder - prevOrder) / 2;
+}
+
 //===----------------------------------------------------------------------===//
 // ilist_traits for Operation
 //===----------------------------------------------------------------------===//
@@ -390,14 +570,22 @@ void llvm::ilist_traits<::mlir::Operation>::addNodeToList(Operation *op) {
   assert(!op->getBlock() && "already in a operation block!");
   op->block = getContainingBlock();
 
-  // Invalidate the block ordering.
-  op->block->invalidateInstOrder();
+  // Mark the operation as needing an order index; the ordering of the rest of
+  // the block stays valid and the index is assigned lazily on the first local
+  // order query.
+  op->orderIndex = Operation::kInvalidOrderIdx;
+
+  // Invalidate any cached verification result of the containing function.
+  if (Function *fn = op->block->getFunction())
+    fn->markBodyModified();
 }
 
 /// This is a trait method invoked when a operation is removed from a block.
 /// We keep the block pointer up to date.
 void llvm::ilist_traits<::mlir::Operation>::removeNodeFromList(Operation *op) {
   assert(op->block && "not already in a operation block!");
+  if (Function *fn = op->block->getFunction())
+    fn->markBodyModified();
   op->block = nullptr;
 }
 
@@ -410,11 +598,18 @@ void llvm::ilist_traits<::mlir::Operation>::transferNodesFromList(
   // Invalidate the ordering of the parent block.
   curParent->invalidateInstOrder();
 
+  // Invalidate cached verification results on both functions involved.
+  if (Function *fn = curParent->getFunction())
+    fn->markBodyModified();
+
   // If we are transferring operations within the same block, the block
   // pointer doesn't need to be updated.
   if (curParent == otherList.getContainingBlock())
     return;
 
+  if (Function *otherFn = otherList.getContainingBlock()->getFunction())
+    otherFn->markBodyModified();
+
   // Update the 'block' member of each operation.
   for (; first != last; ++first)
     first->block = curParent;
@@ -503,6 +698,25 @@ unsigned Operation::getSuccessorOperandIndex(unsigned index) {
   return getNumOperands() - postSuccessorOpCount;
 }
 
+/// Fill 'offsets' with the index of the first operand of each successor,
+/// computed in a single pass over the successor operand count table.
+void Operation::getSuccessorOperandIndices(SmallVectorImpl<unsigned> &offsets) {
+  assert(!isKnownNonTerminator() && "only terminators may have successors");
+  unsigned numSuccessors = getNumSuccessors();
+  auto *successorOpCounts = getTrailingObjects<unsigned>();
+
+  // All non successor operands are placed at the beginning of the operand
+  // list, so the first successor's operands start past them.
+  unsigned offset = getNumOperands() -
+                    std::accumulate(successorOpCounts,
+                                    successorOpCounts + numSuccessors, 0u);
+  offsets.reserve(offsets.size() + numSuccessors);
+  for (unsigned i = 0; i != numSuccessors; ++i) {
+    offsets.push_back(offset);
+    offset += successorOpCounts[i];
+  }
+}
+
 auto Operation::getSuccessorOperands(unsigned index) -> operand_range {
   unsigned succOperandIndex = getSuccessorOperandIndex(index);
   return {operand_iterator(this, succOperandIndex),
@@ -513,6 +727,21 @@ auto Operation::getSuccessorOperands(unsigned index) -> operand_range {
 /// Attempt to fold this operation using the Op's registered foldHook.
 LogicalResult Operation::fold(ArrayRef<Attribute> operands,
                               SmallVectorImpl<OpFoldResult> &results) {
+  // If both operands are dense elements constants, try any bulk folding
+  // kernel the dialect registered for this operation first; these fold large
+  // constants in one pass over the raw element data instead of an elementwise
+  // APInt/APFloat round-trip.
+  Dialect *dialect = getDialect();
+  if (dialect && operands.size() == 2 && getNumResults() == 1) {
+    auto lhs = operands[0].dyn_cast_or_null<DenseElementsAttr>();
+    auto rhs = operands[1].dyn_cast_or_null<DenseElementsAttr>();
+    if (lhs && rhs)
+      if (auto folded = dialect->foldDenseElements(getName(), lhs, rhs)) {
+        results.push_back(folded);
+        return success();
+      }
+  }
+
   // If we have a registered operation definition matching this one, use it to
   // try to constant fold the operation.
   auto *abstractOp = getAbstractOperation();
@@ -520,7 +749,6 @@ LogicalResult Operation::fold(ArrayRef<Attribute> operands,
     return success();
 
   // Otherwise, fall back on the dialect hook to handle it.
-  Dialect *dialect = getDialect();
   if (!dialect)
     return failure();
 
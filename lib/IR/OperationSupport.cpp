@@ -22,6 +22,7 @@
 
 #include "mlir/IR/OperationSupport.h"
 #include "mlir/IR/Block.h"
+#include "mlir/IR/Function.h"
 #include "mlir/IR/Operation.h"
 using namespace mlir;
 
@@ -70,6 +71,11 @@ void OperationState::addRegion(std::unique_ptr<Region> &&region) {
 /// 'operands'.
 void detail::OperandStorage::setOperands(Operation *owner,
                                          ArrayRef<Value *> operands) {
+  // Operand updates can change dominance relationships; invalidate any cached
+  // verification result of the containing function.
+  if (Function *fn = owner->getFunction())
+    fn->markBodyModified();
+
   // If the number of operands is less than or equal to the current amount, we
   // can just update in place.
   if (operands.size() <= numOperands) {
@@ -115,6 +121,22 @@ void detail::OperandStorage::eraseOperand(unsigned index) {
   operands[numOperands].~OpOperand();
 }
 
+/// Erase a range of operands held by the storage.
+void detail::OperandStorage::eraseOperands(unsigned index, unsigned count) {
+  assert(index + count <= size());
+  if (count == 0)
+    return;
+  auto operands = getOperands();
+  numOperands -= count;
+
+  // Shift the trailing operands down over the erased range in one rotate.
+  if (index != numOperands)
+    std::rotate(&operands[index], &operands[index + count],
+                &operands[numOperands + count]);
+  for (unsigned i = 0; i != count; ++i)
+    operands[numOperands + i].~OpOperand();
+}
+
 /// Grow the internal operand storage.
 void detail::OperandStorage::grow(ResizableStorage &resizeUtil,
                                   size_t minSize) {
@@ -18,8 +18,29 @@
 #include "mlir/IR/PatternMatch.h"
 #include "mlir/IR/Operation.h"
 #include "mlir/IR/Value.h"
+#include "llvm/ADT/Hashing.h"
+#include "llvm/ADT/StringMap.h"
+#include "llvm/Support/CommandLine.h"
+#include "llvm/Support/Format.h"
+#include "llvm/Support/ManagedStatic.h"
+#include "llvm/Support/Mutex.h"
+#include "llvm/Support/raw_ostream.h"
+#include <chrono>
 using namespace mlir;
 
+static llvm::cl::opt<bool> patternMatchStats(
+    "mlir-pattern-match-stats",
+    llvm::cl::desc("Collect per-pattern statistics (match attempts, matches, "
+                   "time spent) and print a report at program exit"),
+    llvm::cl::init(false));
+
+static llvm::cl::opt<unsigned> patternMatchStatsThresholdMs(
+    "mlir-pattern-match-stats-threshold-ms",
+    llvm::cl::desc("Threshold, in milliseconds of failed match time, above "
+                   "which a pattern with a low fire rate is called out in the "
+                   "-mlir-pattern-match-stats report"),
+    llvm::cl::init(10));
+
 PatternBenefit::PatternBenefit(unsigned benefit) : representation(benefit) {
   assert(representation == benefit && benefit != ImpossibleToMatchSentinel &&
          "This pattern match benefit is too large to represent");
@@ -144,6 +165,112 @@ void PatternRewriter::updatedRootInPlace(
   // the notifyOperationRemoved hook in the process.
 }
 
+//===----------------------------------------------------------------------===//
+// Pattern application statistics
+//===----------------------------------------------------------------------===//
+
+namespace {
+/// Process-wide accumulator for per-pattern match statistics, enabled with
+/// -mlir-pattern-match-stats. Patterns have no names, so they are identified
+/// by their root operation kind and their benefit-ordered position within that
+/// kind's bucket; identical pattern sets aggregate onto the same entries
+/// across matcher instances. The report is printed when the registry is torn
+/// down at llvm_shutdown.
+struct PatternStatsRegistry {
+  struct Entry {
+    uint64_t attempts = 0;
+    uint64_t matches = 0;
+    /// Total time spent in matchAndRewrite, and the portion spent in attempts
+    /// that did not match, in nanoseconds.
+    uint64_t totalNanos = 0;
+    uint64_t failedNanos = 0;
+  };
+
+  ~PatternStatsRegistry() {
+    if (patternMatchStats)
+      print(llvm::errs());
+  }
+
+  void record(StringRef rootKind, unsigned patternIndex, bool matched,
+              uint64_t nanos) {
+    llvm::sys::SmartScopedLock<true> lock(mutex);
+    auto &bucket = entries[rootKind];
+    if (bucket.size() <= patternIndex)
+      bucket.resize(patternIndex + 1);
+    Entry &entry = bucket[patternIndex];
+    ++entry.attempts;
+    entry.totalNanos += nanos;
+    if (matched)
+      ++entry.matches;
+    else
+      entry.failedNanos += nanos;
+  }
+
+  void print(raw_ostream &os);
+
+  /// The statistics entries, bucketed by pattern root kind. Guarded by mutex.
+  llvm::StringMap<std::vector<Entry>> entries;
+  llvm::sys::SmartMutex<true> mutex;
+};
+} // end anonymous namespace
+
+static llvm::ManagedStatic<PatternStatsRegistry> patternStatsRegistry;
+
+void PatternStatsRegistry::print(raw_ostream &os) {
+  // Flatten the entries and sort by total time, descending, for the report.
+  struct Row {
+    StringRef rootKind;
+    unsigned index;
+    const Entry *entry;
+  };
+  std::vector<Row> rows;
+  for (const auto &bucket : entries)
+    for (unsigned i = 0, e = bucket.second.size(); i != e; ++i)
+      if (bucket.second[i].attempts != 0)
+        rows.push_back({bucket.first(), i, &bucket.second[i]});
+  std::stable_sort(rows.begin(), rows.end(), [](const Row &l, const Row &r) {
+    return l.entry->totalNanos > r.entry->totalNanos;
+  });
+
+  os << "===" << std::string(73, '-') << "===\n";
+  os << "                        Rewrite Pattern Statistics\n";
+  os << "===" << std::string(73, '-') << "===\n";
+  os << llvm::format("  %-32s %8s %10s %9s %11s %11s\n", "root kind", "pattern",
+                     "attempts", "matches", "total (ms)", "failed (ms)");
+  for (const Row &row : rows) {
+    const Entry &entry = *row.entry;
+    os << llvm::format("  %-32s %8u %10llu %9llu %11.3f %11.3f\n",
+                       row.rootKind.str().c_str(), row.index,
+                       (unsigned long long)entry.attempts,
+                       (unsigned long long)entry.matches,
+                       entry.totalNanos / 1e6, entry.failedNanos / 1e6);
+  }
+
+  // Call out the patterns whose attempt cost vastly exceeds their fire rate:
+  // at least the threshold worth of failed match time, with under 1% of
+  // attempts matching.
+  uint64_t thresholdNanos = uint64_t(patternMatchStatsThresholdMs) * 1000000;
+  bool printedHeader = false;
+  for (const Row &row : rows) {
+    const Entry &entry = *row.entry;
+    if (entry.failedNanos < thresholdNanos ||
+        entry.matches * 100 >= entry.attempts)
+      continue;
+    if (!printedHeader) {
+      os << "\n  Patterns with high attempt cost and low fire rate (>= "
+         << patternMatchStatsThresholdMs << "ms spent on failed matches, < 1% "
+         << "of attempts matching):\n";
+      printedHeader = true;
+    }
+    os << llvm::format("    %s pattern #%u: %llu attempts, %llu matches, "
+                       "%.3fms wasted\n",
+                       row.rootKind.str().c_str(), row.index,
+                       (unsigned long long)entry.attempts,
+                       (unsigned long long)entry.matches,
+                       entry.failedNanos / 1e6);
+  }
+}
+
 //===----------------------------------------------------------------------===//
 // PatternMatcher implementation
 //===----------------------------------------------------------------------===//
@@ -157,16 +284,54 @@ RewritePatternMatcher::RewritePatternMatcher(
                       const std::unique_ptr<RewritePattern> &r) {
                      return r->getBenefit() < l->getBenefit();
                    });
+
+  // Bucket the patterns by root kind so that matching an operation only has to
+  // consider the patterns that can possibly apply to it. The buckets inherit
+  // the benefit order from the sort above.
+  for (auto &pattern : this->patterns) {
+    if (pattern->getBenefit().isImpossibleToMatch())
+      continue;
+    patternsByRootKind[pattern->getRootKind()].push_back(pattern.get());
+  }
+
+  // Fingerprint the pattern set from the root kinds and benefits in sorted
+  // order, so that drivers can recognize repeated invocations of the same
+  // rewrite. Reserve zero to mean "no fingerprint".
+  llvm::hash_code hash = llvm::hash_value(this->patterns.size());
+  for (auto &pattern : this->patterns) {
+    auto benefit = pattern->getBenefit();
+    hash = llvm::hash_combine(
+        hash, pattern->getRootKind().getStringRef(),
+        benefit.isImpossibleToMatch() ? ~0u : unsigned(benefit.getBenefit()));
+  }
+  fingerprint = uint64_t(hash) ? uint64_t(hash) : 1;
 }
 
 /// Try to match the given operation to a pattern and rewrite it.
 bool RewritePatternMatcher::matchAndRewrite(Operation *op,
                                             PatternRewriter &rewriter) {
-  for (auto &pattern : patterns) {
-    // Ignore patterns that are for the wrong root or are impossible to match.
-    if (pattern->getRootKind() != op->getName() ||
-        pattern->getBenefit().isImpossibleToMatch())
-      continue;
+  auto it = patternsByRootKind.find(op->getName());
+  if (it == patternsByRootKind.end())
+    return false;
+
+  // When collecting statistics, time each attempt and record it against the
+  // pattern's position in the bucket.
+  if (patternMatchStats) {
+    StringRef rootKind = op->getName().getStringRef();
+    for (unsigned i = 0, e = it->second.size(); i != e; ++i) {
+      auto startTime = std::chrono::steady_clock::now();
+      bool matched = it->second[i]->matchAndRewrite(op, rewriter);
+      auto nanos = std::chrono::duration_cast<std::chrono::nanoseconds>(
+                       std::chrono::steady_clock::now() - startTime)
+                       .count();
+      patternStatsRegistry->record(rootKind, i, matched, nanos);
+      if (matched)
+        return true;
+    }
+    return false;
+  }
+
+  for (auto *pattern : it->second) {
 
     // Try to match and rewrite this pattern. The patterns are sorted by
     // benefit, so if we match we can immediately rewrite and return.
@@ -178,6 +178,16 @@ void Region::walk(const std::function<void(Operation *)> &callback) {
     block.walk(callback);
 }
 
+/// Returns the function enclosing the given region, walking through any
+/// nested operation regions, or nullptr if the region is detached.
+static Function *getEnclosingFunction(Region *region) {
+  if (Function *fn = region->getContainingFunction())
+    return fn;
+  if (Operation *op = region->getContainingOp())
+    return op->getFunction();
+  return nullptr;
+}
+
 Region *llvm::ilist_traits<::mlir::Block>::getContainingRegion() {
   size_t Offset(
       size_t(&((Region *)nullptr->*Region::getSublistAccess(nullptr))));
@@ -190,12 +200,18 @@ Region *llvm::ilist_traits<::mlir::Block>::getContainingRegion() {
 void llvm::ilist_traits<::mlir::Block>::addNodeToList(Block *block) {
   assert(!block->getParent() && "already in a region!");
   block->parentValidInstOrderPair.setPointer(getContainingRegion());
+
+  // Invalidate any cached verification result of the containing function.
+  if (Function *fn = block->getFunction())
+    fn->markBodyModified();
 }
 
 /// This is a trait method invoked when an operation is removed from a
 /// region.  We keep the region pointer up to date.
 void llvm::ilist_traits<::mlir::Block>::removeNodeFromList(Block *block) {
   assert(block->getParent() && "not already in a region!");
+  if (Function *fn = block->getFunction())
+    fn->markBodyModified();
   block->parentValidInstOrderPair.setPointer(nullptr);
 }
 
@@ -206,8 +222,12 @@ void llvm::ilist_traits<::mlir::Block>::transferNodesFromList(
   // If we are transferring operations within the same function, the parent
   // pointer doesn't need to be updated.
   auto *curParent = getContainingRegion();
+  if (Function *fn = getEnclosingFunction(curParent))
+    fn->markBodyModified();
   if (curParent == otherList.getContainingRegion())
     return;
+  if (Function *otherFn = getEnclosingFunction(otherList.getContainingRegion()))
+    otherFn->markBodyModified();
 
   // Update the 'parent' member of each Block.
   for (; first != last; ++first)
@@ -21,6 +21,34 @@
 #include "mlir/IR/Operation.h"
 using namespace mlir;
 
+/// Replace all uses of 'this' value with the new value, updating anything in
+/// the IR that uses 'this' to use the other value instead.  When this returns
+/// there are zero uses of 'this'.
+void Value::replaceAllUsesWith(Value *newValue) {
+  // Rewriting the use-list can change dominance relationships, so invalidate
+  // any cached verification result of the containing function.
+  if (Function *fn = getFunction())
+    fn->markBodyModified();
+  IRObjectWithUseList::replaceAllUsesWith(newValue);
+}
+
+/// Replace all uses of each value in 'replacements' with its paired
+/// replacement value, processing the pairs in order.
+void Value::replaceAllUses(
+    ArrayRef<std::pair<Value *, Value *>> replacements) {
+  // Invalidate the cached state of each containing function once per run of
+  // replaced values from the same function, rather than per value.
+  Function *lastFn = nullptr;
+  for (const auto &repl : replacements) {
+    Function *fn = repl.first->getFunction();
+    if (fn && fn != lastFn) {
+      fn->markBodyModified();
+      lastFn = fn;
+    }
+    repl.first->IRObjectWithUseList::replaceAllUsesWith(repl.second);
+  }
+}
+
 /// If this value is the result of an Operation, return the operation that
 /// defines it.
 Operation *Value::getDefiningOp() {
@@ -67,16 +95,42 @@ Region *Value::getContainingRegion() {
 /// there are zero uses of 'this'.
 void IRObjectWithUseList::replaceAllUsesWith(IRObjectWithUseList *newValue) {
   assert(this != newValue && "cannot RAUW a value with itself");
-  while (!use_empty()) {
-    use_begin()->set(newValue);
+  if (use_empty())
+    return;
+
+  // Walk the use chain once, retargeting every operand at the new value and
+  // finding the tail of the chain.
+  IROperand *tail = firstUse;
+  tail->value = newValue;
+  while (IROperand *next = tail->nextUse) {
+    next->value = newValue;
+    tail = next;
   }
+
+  // Splice the entire chain onto the front of the new value's use list. The
+  // back pointers of the interior operands remain valid as the chain is moved
+  // in order.
+  IROperand *newHead = newValue->firstUse;
+  tail->nextUse = newHead;
+  if (newHead)
+    newHead->back = &tail->nextUse;
+  newValue->firstUse = firstUse;
+  firstUse->back = &newValue->firstUse;
+  firstUse = nullptr;
 }
 
 /// Drop all uses of this object from their respective owners.
 void IRObjectWithUseList::dropAllUses() {
-  while (!use_empty()) {
-    use_begin()->drop();
+  // Detach every use in one pass. No back pointer fixups are needed since the
+  // entire chain is being discarded.
+  for (IROperand *use = firstUse; use;) {
+    IROperand *next = use->nextUse;
+    use->value = nullptr;
+    use->nextUse = nullptr;
+    use->back = nullptr;
+    use = next;
   }
+  firstUse = nullptr;
 }
 
 //===----------------------------------------------------------------------===//
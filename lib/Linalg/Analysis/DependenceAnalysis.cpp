@@ -22,8 +22,11 @@
 #include "mlir/Linalg/Analysis/DependenceAnalysis.h"
 #include "mlir/Linalg/IR/LinalgOps.h"
 
+#include "llvm/ADT/DenseSet.h"
+#include "llvm/ADT/STLExtras.h"
 #include "llvm/Support/CommandLine.h"
 #include "llvm/Support/Debug.h"
+#include <algorithm>
 
 #define DEBUG_TYPE "linalg-dependence-analysis"
 
@@ -62,10 +65,35 @@ LinalgDependenceGraph::LinalgDependenceGraph(Aliases &aliases,
     assert(isa<LinalgOp>(en.value()) && "Expected value for LinalgOp");
     linalgOpPositions.insert(std::make_pair(en.value(), en.index()));
   }
-  for (unsigned i = 0, e = ops.size(); i < e; ++i) {
-    for (unsigned j = i + 1; j < e; ++j) {
-      addDependencesBetween(cast<LinalgOp>(ops[i]), cast<LinalgOp>(ops[j]));
+  // Bucket the ops by the base (buffer or block argument) of each view they
+  // access: only ops sharing a base can be in a dependence. This keeps graph
+  // construction proportional to the accesses per base instead of considering
+  // all pairs of ops. Ops are processed in order and candidates sorted, so
+  // the graphs are filled in the same order an all-pairs scan would produce.
+  DenseMap<Value *, SmallVector<unsigned, 4>> opsByBase;
+  SmallVector<Value *, 8> bases;
+  SmallVector<unsigned, 8> candidates;
+  llvm::SmallDenseSet<unsigned, 8> seen;
+  for (unsigned j = 0, e = linalgOps.size(); j < e; ++j) {
+    auto dstOp = cast<LinalgOp>(linalgOps[j]);
+    bases.clear();
+    for (auto *view : dstOp.getInputsAndOutputs()) {
+      Value *base = aliases.getBase(view);
+      if (!llvm::is_contained(bases, base))
+        bases.push_back(base);
     }
+    candidates.clear();
+    seen.clear();
+    for (Value *base : bases) {
+      auto &bucket = opsByBase[base];
+      for (unsigned i : bucket)
+        if (seen.insert(i).second)
+          candidates.push_back(i);
+      bucket.push_back(j);
+    }
+    std::sort(candidates.begin(), candidates.end());
+    for (unsigned i : candidates)
+      addDependencesBetween(cast<LinalgOp>(linalgOps[i]), dstOp);
   }
 }
 
@@ -179,6 +207,15 @@ LinalgDependenceGraph::findOperationsWithCoveringDependences(
   auto dstPos = linalgOpPositions[dst];
   assert(srcPos < dstPos && "expected dst after src in IR traversal order");
 
+  // Return the memoized result when this query has been answered before.
+  unsigned typeMask = 0;
+  for (auto dt : types)
+    typeMask |= 1u << dt;
+  CoveringKey key{{src, dst}, {view, typeMask}};
+  auto cached = coveringDependences.find(key);
+  if (cached != coveringDependences.end())
+    return cached->second;
+
   SmallVector<Operation *, 8> res;
   // Consider an intermediate interleaved `interim` op, look for any dependence
   // to an aliasing view on a src -> op -> dst path.
@@ -198,5 +235,6 @@ LinalgDependenceGraph::findOperationsWithCoveringDependences(
       res.push_back(op);
     }
   }
+  coveringDependences.insert(std::make_pair(key, res));
   return res;
 }
@@ -1016,9 +1016,9 @@ void mlir::linalg::emitScalarImplementation(
   ScopedContext scope(b, loc);
   auto *op = linalgOp.getOperation();
   if (auto copyOp = dyn_cast<CopyOp>(op)) {
-    OperationFolder state;
-    auto inputIvs = permuteIvs(parallelIvs, copyOp.inputPermutation(), state);
-    auto outputIvs = permuteIvs(parallelIvs, copyOp.outputPermutation(), state);
+    auto inputIvs = permuteIvs(parallelIvs, copyOp.inputPermutation(), folder);
+    auto outputIvs =
+        permuteIvs(parallelIvs, copyOp.outputPermutation(), folder);
     SmallVector<IndexHandle, 8> iivs(inputIvs.begin(), inputIvs.end());
     SmallVector<IndexHandle, 8> oivs(outputIvs.begin(), outputIvs.end());
     // clang-format off
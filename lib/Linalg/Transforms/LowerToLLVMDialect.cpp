@@ -156,6 +156,37 @@ static ArrayAttr positionAttr(Builder &builder, ArrayRef<int> position) {
   return builder.getArrayAttr(attrs);
 }
 
+// Walks the chain of llvm.insertvalue operations that built 'descriptor' and
+// returns the value inserted at 'position', or nullptr if the field cannot be
+// traced statically (e.g. the descriptor is a block argument). Position
+// attributes are uniqued, so they compare by identity.
+static Value *getInsertedValue(Value *descriptor, ArrayAttr position) {
+  while (auto *def = descriptor->getDefiningOp()) {
+    auto insert = dyn_cast<InsertValueOp>(def);
+    if (!insert)
+      break;
+    if (insert.position() == position)
+      return insert.value();
+    descriptor = insert.container();
+  }
+  return nullptr;
+}
+
+// Reads field 'position' of 'descriptor', reusing the inserted value directly
+// when the construction of the descriptor is statically visible and emitting
+// an llvm.extractvalue otherwise. This forwards the fields of range and view
+// descriptors built in the same function straight to their consumers: the
+// base, offset and stride arithmetic is composed at compile time, and the
+// descriptor construction of a single-use view is left as dead code for DCE
+// instead of surviving as runtime churn. Must be called under an
+// edsc::ScopedContext.
+static Value *extractOrForwardValue(Type type, Value *descriptor,
+                                    ArrayAttr position) {
+  if (Value *inserted = getInsertedValue(descriptor, position))
+    return inserted;
+  return extractvalue(type, descriptor, position);
+}
+
 // BufferAllocOp creates a new `!linalg.buffer` value.
 class BufferAllocOpConversion : public LLVMOpLowering {
 public:
@@ -310,10 +341,14 @@ public:
 
     // Linearize subscripts as:
     //   base_offset + SUM_i index_i * stride_i.
-    Value *base = extractvalue(elementTy, viewDescriptor, pos(0));
-    Value *offset = extractvalue(int64Ty, viewDescriptor, pos(1));
+    // Forward the descriptor fields when their construction is visible so
+    // that views only consumed by loads and stores need no runtime
+    // descriptor at all.
+    Value *base = extractOrForwardValue(elementTy, viewDescriptor, pos(0));
+    Value *offset = extractOrForwardValue(int64Ty, viewDescriptor, pos(1));
     for (int i = 0, e = loadOp.getRank(); i < e; ++i) {
-      Value *stride = extractvalue(int64Ty, viewDescriptor, pos({3, i}));
+      Value *stride =
+          extractOrForwardValue(int64Ty, viewDescriptor, pos({3, i}));
       Value *additionalOffset = mul(indices[i], stride);
       offset = add(offset, additionalOffset);
     }
@@ -431,11 +466,15 @@ public:
     // Helper function to obtain the ptr of the given `view`.
     auto getViewPtr = [pos, this](ViewType type, Value *view) -> Value * {
       auto elementPtrTy = getPtrToElementType(type, lowering);
-      return extractvalue(elementPtrTy, view, pos(0));
+      return extractOrForwardValue(elementPtrTy, view, pos(0));
     };
 
     edsc::ScopedContext context(rewriter, op->getLoc());
-    // Declare the view descriptor and insert data ptr.
+    // Declare the view descriptor and insert data ptr. Reads of the base view
+    // and range descriptors go through extractOrForwardValue, so slicing a
+    // view built in the same function composes the base, offset and stride
+    // arithmetic directly over the underlying values and leaves the view's
+    // own descriptor construction dead when the slice was its only use.
     Value *desc = undef(viewDescriptorTy);
     desc = insertvalue(viewDescriptorTy, desc,
                        getViewPtr(viewType, operands[0]), pos(0));
@@ -443,17 +482,16 @@ public:
     // TODO(ntv): extract sizes and emit asserts.
     SmallVector<Value *, 4> strides(viewType.getRank());
     for (int dim = 0, e = viewType.getRank(); dim < e; ++dim) {
-      strides[dim] = extractvalue(int64Ty, operands[0], pos({3, dim}));
+      strides[dim] = extractOrForwardValue(int64Ty, operands[0], pos({3, dim}));
     }
 
     // Compute and insert base offset.
-    Value *baseOffset = extractvalue(int64Ty, operands[0], pos(1));
+    Value *baseOffset = extractOrForwardValue(int64Ty, operands[0], pos(1));
     for (int j = 0, e = viewType.getRank(); j < e; ++j) {
       Value *indexing = operands[1 + j];
-      Value *min =
-          sliceOp.getIndexing(j)->getType().isa<RangeType>()
-              ? static_cast<Value *>(extractvalue(int64Ty, indexing, pos(0)))
-              : indexing;
+      Value *min = sliceOp.getIndexing(j)->getType().isa<RangeType>()
+                       ? extractOrForwardValue(int64Ty, indexing, pos(0))
+                       : indexing;
       Value *product = mul(min, strides[j]);
       baseOffset = add(baseOffset, product);
     }
@@ -467,8 +505,8 @@ public:
         continue;
 
       Value *rangeDescriptor = operands[1 + i];
-      Value *min = extractvalue(int64Ty, rangeDescriptor, pos(0));
-      Value *max = extractvalue(int64Ty, rangeDescriptor, pos(1));
+      Value *min = extractOrForwardValue(int64Ty, rangeDescriptor, pos(0));
+      Value *max = extractOrForwardValue(int64Ty, rangeDescriptor, pos(1));
       Value *size = sub(max, min);
 
       desc = insertvalue(viewDescriptorTy, desc, size, pos({2, i}));
@@ -481,7 +519,7 @@ public:
     for (int j = 0, e = strides.size(); j < e; ++j) {
       if (!sliceOp.getIndexing(j)->getType().isa<RangeType>())
         continue;
-      Value *step = extractvalue(int64Ty, operands[1 + j], pos(2));
+      Value *step = extractOrForwardValue(int64Ty, operands[1 + j], pos(2));
       Value *stride = mul(strides[j], step);
       desc = insertvalue(viewDescriptorTy, desc, stride, pos({3, i}));
       ++i;
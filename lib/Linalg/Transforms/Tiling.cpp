@@ -49,6 +49,11 @@ static llvm::cl::list<unsigned>
                 llvm::cl::desc("Tile sizes by which to tile linalg operations"),
                 llvm::cl::ZeroOrMore, llvm::cl::MiscFlags::CommaSeparated,
                 llvm::cl::cat(clOptionsCategory));
+static llvm::cl::opt<bool> clPromoteViews(
+    "linalg-tile-promote-views",
+    llvm::cl::desc("Promote the tiled views into tile-local buffers with "
+                   "copy-in/copy-out around the tile body"),
+    llvm::cl::init(false), llvm::cl::cat(clOptionsCategory));
 
 static bool isZero(Value *v) {
   return isa_and_nonnull<ConstantIndexOp>(v->getDefiningOp()) &&
@@ -184,9 +189,66 @@ static SmallVector<Value *, 4> makeTiledViews(OpBuilder &b, Location loc,
   return res;
 }
 
+namespace {
+// A tiled view promoted into a tile-local buffer. The buffer and the
+// full-tile view over it are created once, before the tile loop nest, and
+// reused across tile iterations; the tile body copies the current tile in
+// (and back out for outputs).
+struct PromotedView {
+  unsigned viewIndex;
+  Value *buffer;
+  Value *localView;
+  // The subview of the current tile, recorded while emitting the tile body.
+  Value *tileView;
+};
+} // namespace
+
+// Allocates a tile-local buffer and a full-tile view over it for each tiled
+// view of `linalgOp`, at the current builder position, i.e. before the tile
+// loop nest. The buffer of a view is sized to the product of its tile
+// extents; untiled dimensions keep their full size.
+static SmallVector<PromotedView, 4>
+promoteTiledViews(OpBuilder &b, Location loc, LinalgOp linalgOp,
+                  ArrayRef<Value *> tileSizes, OperationFolder &state) {
+  SmallVector<PromotedView, 4> res;
+  Value *zero = state.create<ConstantIndexOp>(b, loc, 0);
+  Value *one = state.create<ConstantIndexOp>(b, loc, 1);
+  auto viewIteratorBegin = linalgOp.getInputsAndOutputs().begin();
+  for (unsigned viewIndex = 0; viewIndex < linalgOp.getNumInputsAndOutputs();
+       ++viewIndex) {
+    Value *view = *(viewIteratorBegin + viewIndex);
+    if (!isTiledView(linalgOp, viewIndex, tileSizes))
+      continue;
+    auto viewType = view->getType().cast<ViewType>();
+    unsigned viewRank = viewType.getRank();
+
+    SmallVector<Value *, 4> ranges;
+    ranges.reserve(viewRank);
+    Value *numElements = nullptr;
+    for (unsigned r = 0; r < viewRank; ++r) {
+      auto pos = getPosInDomain(linalgOp, viewIndex, r);
+      Value *extent = tileSizes[pos];
+      if (isZero(extent)) {
+        ScopedContext scope(b, loc);
+        extent = linalg::intrinsics::dim(view, r);
+      }
+      ranges.push_back(b.create<RangeOp>(loc, zero, extent, one));
+      numElements =
+          numElements ? b.create<MulIOp>(loc, numElements, extent).getResult()
+                      : extent;
+    }
+
+    auto bufferType = BufferType::get(b.getContext(), viewType.getElementType());
+    Value *buffer = b.create<BufferAllocOp>(loc, bufferType, numElements);
+    Value *localView = b.create<ViewOp>(loc, buffer, ranges);
+    res.push_back(PromotedView{viewIndex, buffer, localView, nullptr});
+  }
+  return res;
+}
+
 llvm::Optional<TiledLinalgOp>
 mlir::linalg::tileLinalgOp(LinalgOp op, ArrayRef<Value *> tileSizes,
-                           OperationFolder &state) {
+                           OperationFolder &state, bool promoteViews) {
   // Enforce the convention that "tiling by zero" skips tiling a particular
   // dimension. This convention is significantly simpler to handle instead of
   // adjusting affine maps to account for missing dimensions.
@@ -204,10 +266,19 @@ mlir::linalg::tileLinalgOp(LinalgOp op, ArrayRef<Value *> tileSizes,
       inversePermutation(concatAffineMaps(loopToOperandRangesMaps(op))),
       getViewSizes(op), tileSizes, state);
 
+  // If requested, promote the tiled views into tile-local buffers. The
+  // buffers and their full-tile views are created here, before the loop nest,
+  // so they are reused across tile iterations.
+  SmallVector<PromotedView, 4> promotedViews;
+  if (promoteViews)
+    promotedViews = promoteTiledViews(scope.getBuilder(), scope.getLocation(),
+                                      op, tileSizes, state);
+
   LinalgOp res = op;
   SmallVector<IndexHandle, 4> ivs(loopRanges.size());
   auto pivs = IndexHandle::makeIndexHandlePointers(ivs);
-  LoopNestRangeBuilder(pivs, loopRanges)([&op, &tileSizes, &ivs, &res, &state] {
+  LoopNestRangeBuilder(pivs, loopRanges)([&op, &tileSizes, &ivs, &res, &state,
+                                          &promotedViews] {
     auto b = ScopedContext::getBuilder();
     auto loc = ScopedContext::getLocation();
     SmallVector<Value *, 4> ivValues(ivs.begin(), ivs.end());
@@ -215,19 +286,39 @@ mlir::linalg::tileLinalgOp(LinalgOp op, ArrayRef<Value *> tileSizes,
     // `makeTiledViews`.
     assert(op.getNumInputsAndOutputs() == op.getOperation()->getNumOperands());
     auto views = makeTiledViews(b, loc, op, ivValues, tileSizes, state);
+    // Copy the current tile of each promoted view into its local buffer and
+    // substitute the full-tile local view into the tiled op.
+    for (auto &promoted : promotedViews) {
+      promoted.tileView = views[promoted.viewIndex];
+      b.create<CopyOp>(loc, promoted.tileView, promoted.localView);
+      views[promoted.viewIndex] = promoted.localView;
+    }
     res = op.create(b, loc, views);
+    // Copy the output tiles back out of their local buffers.
+    for (auto &promoted : promotedViews)
+      if (promoted.viewIndex >= op.getNumInputs())
+        b.create<CopyOp>(loc, promoted.localView, promoted.tileView);
   });
 
   SmallVector<ForOp, 8> loops;
   loops.reserve(ivs.size());
   for (auto iv : ivs)
     loops.push_back(linalg::getForInductionVarOwner(iv));
+
+  // Free the promoted buffers after the tile loop nest.
+  if (!promotedViews.empty()) {
+    Operation *outermostLoop = loops.front().getOperation();
+    OpBuilder deallocBuilder(outermostLoop->getBlock(),
+                             std::next(Block::iterator(outermostLoop)));
+    for (auto &promoted : promotedViews)
+      deallocBuilder.create<BufferDeallocOp>(op.getLoc(), promoted.buffer);
+  }
   return TiledLinalgOp{res, loops};
 }
 
 llvm::Optional<TiledLinalgOp>
 mlir::linalg::tileLinalgOp(LinalgOp op, ArrayRef<int64_t> tileSizes,
-                           OperationFolder &state) {
+                           OperationFolder &state, bool promoteViews) {
   if (tileSizes.empty())
     return llvm::None;
 
@@ -256,13 +347,14 @@ mlir::linalg::tileLinalgOp(LinalgOp op, ArrayRef<int64_t> tileSizes,
       tileSizeValues.push_back(state.create<ConstantIndexOp>(builder, loc, 0));
   }
 
-  return tileLinalgOp(op, tileSizeValues, state);
+  return tileLinalgOp(op, tileSizeValues, state, promoteViews);
 }
 
-static void tileLinalgOps(Function &f, ArrayRef<int64_t> tileSizes) {
+static void tileLinalgOps(Function &f, ArrayRef<int64_t> tileSizes,
+                          bool promoteViews) {
   OperationFolder state;
-  f.walk<LinalgOp>([tileSizes, &state](LinalgOp op) {
-    auto opLoopsPair = tileLinalgOp(op, tileSizes, state);
+  f.walk<LinalgOp>([tileSizes, promoteViews, &state](LinalgOp op) {
+    auto opLoopsPair = tileLinalgOp(op, tileSizes, state, promoteViews);
     // If tiling occurred successfully, erase old op.
     if (opLoopsPair)
       op.erase();
@@ -272,26 +364,33 @@ static void tileLinalgOps(Function &f, ArrayRef<int64_t> tileSizes) {
 namespace {
 struct LinalgTilingPass : public FunctionPass<LinalgTilingPass> {
   LinalgTilingPass();
-  LinalgTilingPass(ArrayRef<int64_t> sizes);
+  LinalgTilingPass(ArrayRef<int64_t> sizes, bool promoteViews);
 
-  void runOnFunction() { tileLinalgOps(getFunction(), tileSizes); }
+  void runOnFunction() {
+    tileLinalgOps(getFunction(), tileSizes, promoteViews);
+  }
 
   SmallVector<int64_t, 8> tileSizes;
+  bool promoteViews;
 };
 } // namespace
 
 LinalgTilingPass::LinalgTilingPass()
-    : tileSizes(clTileSizes.begin(), clTileSizes.end()) {}
+    : tileSizes(clTileSizes.begin(), clTileSizes.end()),
+      promoteViews(clPromoteViews) {}
 
-LinalgTilingPass::LinalgTilingPass(ArrayRef<int64_t> sizes)
+LinalgTilingPass::LinalgTilingPass(ArrayRef<int64_t> sizes, bool promoteViews)
     : LinalgTilingPass() {
   if (!sizes.empty())
     this->tileSizes.assign(sizes.begin(), sizes.end());
+  if (promoteViews)
+    this->promoteViews = promoteViews;
 }
 
 FunctionPassBase *
-mlir::linalg::createLinalgTilingPass(ArrayRef<int64_t> tileSizes) {
-  return new LinalgTilingPass(tileSizes);
+mlir::linalg::createLinalgTilingPass(ArrayRef<int64_t> tileSizes,
+                                     bool promoteViews) {
+  return new LinalgTilingPass(tileSizes, promoteViews);
 }
 
 static PassRegistration<LinalgTilingPass>
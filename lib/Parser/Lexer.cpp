@@ -25,6 +25,7 @@
 #include "mlir/IR/Location.h"
 #include "mlir/IR/MLIRContext.h"
 #include "llvm/Support/SourceMgr.h"
+#include <cstring>
 using namespace mlir;
 
 using llvm::SMLoc;
@@ -36,6 +37,56 @@ static bool isPunct(char c) {
   return c == '$' || c == '.' || c == '_' || c == '-';
 }
 
+namespace {
+/// Character class bits for the table-driven scanning loops below.
+enum CharClass : unsigned char {
+  /// Whitespace: [ \t\n\r].
+  CC_Space = 1,
+  /// Decimal digits: [0-9].
+  CC_Digit = 2,
+  /// Hexadecimal digits: [0-9a-fA-F].
+  CC_HexDigit = 4,
+  /// Bare identifier continuation: [0-9a-zA-Z_$.].
+  CC_BareIdent = 8,
+  /// Suffix-id continuation: [0-9a-zA-Z$._-].
+  CC_SuffixIdent = 16,
+};
+
+/// A 256-entry table mapping each byte to its character class bits. Scanning
+/// runs of identifier/digit/whitespace bytes through a single indexed load
+/// and mask keeps the hot loops branch-free (and vectorizable), instead of
+/// chaining several comparisons per byte. Indexing by unsigned char also
+/// makes bytes >= 128 well defined, unlike isalpha/isdigit on plain char.
+struct CharClassTable {
+  unsigned char classes[256];
+
+  CharClassTable() {
+    memset(classes, 0, sizeof(classes));
+    for (unsigned char c : {' ', '\t', '\n', '\r'})
+      classes[c] |= CC_Space;
+    for (int c = '0'; c <= '9'; ++c)
+      classes[c] |= CC_Digit | CC_HexDigit | CC_BareIdent | CC_SuffixIdent;
+    for (int c = 'a'; c <= 'z'; ++c)
+      classes[c] |= CC_BareIdent | CC_SuffixIdent;
+    for (int c = 'A'; c <= 'Z'; ++c)
+      classes[c] |= CC_BareIdent | CC_SuffixIdent;
+    for (int c = 'a'; c <= 'f'; ++c)
+      classes[c] |= CC_HexDigit;
+    for (int c = 'A'; c <= 'F'; ++c)
+      classes[c] |= CC_HexDigit;
+    for (unsigned char c : {'_', '$', '.'})
+      classes[c] |= CC_BareIdent | CC_SuffixIdent;
+    classes[static_cast<unsigned char>('-')] |= CC_SuffixIdent;
+  }
+};
+} // namespace
+
+static const CharClassTable charClassTable;
+
+static inline bool isCharClass(char c, unsigned char mask) {
+  return charClassTable.classes[static_cast<unsigned char>(c)] & mask;
+}
+
 Lexer::Lexer(const llvm::SourceMgr &sourceMgr, MLIRContext *context)
     : sourceMgr(sourceMgr), context(context) {
   auto bufferID = sourceMgr.getMainFileID();
@@ -63,23 +114,12 @@ Token Lexer::emitError(const char *loc, const Twine &message) {
 }
 
 Token Lexer::lexToken() {
-  // Ignore whitespace.
-  while (true) {
-    switch (*curPtr) {
-    case ' ':
-    case '\t':
-    case '\n':
-    case '\r':
-      ++curPtr;
-      continue;
-    default:
-      // Terminate loop on non-whitespace, including either an embedded or
-      // final terminating nul character that llvm::MemoryBuffer guarantees
-      // will be there.
-      break;
-    }
-    break;
-  }
+  // Skip the whitespace run in one tight scan. This terminates on any
+  // non-whitespace character, including either an embedded or final
+  // terminating nul character that llvm::MemoryBuffer guarantees will be
+  // there.
+  while (isCharClass(*curPtr, CC_Space))
+    ++curPtr;
 
   const char *tokStart = curPtr;
   switch (*curPtr++) {
@@ -188,8 +228,7 @@ Token Lexer::lexComment() {
 ///
 Token Lexer::lexBareIdentifierOrKeyword(const char *tokStart) {
   // Match the rest of the identifier regex: [0-9a-zA-Z_.$]*
-  while (isalpha(*curPtr) || isdigit(*curPtr) || *curPtr == '_' ||
-         *curPtr == '$' || *curPtr == '.')
+  while (isCharClass(*curPtr, CC_BareIdent))
     ++curPtr;
 
   // Check to see if this identifier is a keyword.
@@ -199,7 +238,7 @@ Token Lexer::lexBareIdentifierOrKeyword(const char *tokStart) {
   if (tokStart[0] == 'i') {
     bool allDigits = true;
     for (auto c : spelling.drop_front())
-      allDigits &= isdigit(c) != 0;
+      allDigits &= isCharClass(c, CC_Digit);
     if (allDigits && spelling.size() != 1)
       return Token(Token::inttype, spelling);
   }
@@ -224,8 +263,7 @@ Token Lexer::lexAtIdentifier(const char *tokStart) {
     return emitError(curPtr - 1,
                      "@ identifier expected to start with letter or '_'");
 
-  while (isalpha(*curPtr) || isdigit(*curPtr) || *curPtr == '_' ||
-         *curPtr == '$' || *curPtr == '.')
+  while (isCharClass(*curPtr, CC_BareIdent))
     ++curPtr;
   return formToken(Token::at_identifier, tokStart);
 }
@@ -265,13 +303,13 @@ Token Lexer::lexPrefixedIdentifier(const char *tokStart) {
   // Parse suffix-id.
   if (isdigit(*curPtr)) {
     // If suffix-id starts with a digit, the rest must be digits.
-    while (isdigit(*curPtr)) {
+    while (isCharClass(*curPtr, CC_Digit)) {
       ++curPtr;
     }
   } else if (isalpha(*curPtr) || isPunct(*curPtr)) {
     do  {
       ++curPtr;
-    } while (isalpha(*curPtr) || isdigit(*curPtr) || isPunct(*curPtr));
+    } while (isCharClass(*curPtr, CC_SuffixIdent));
   } else {
     return emitError(curPtr - 1, errorKind);
   }
@@ -295,14 +333,14 @@ Token Lexer::lexNumber(const char *tokStart) {
       return formToken(Token::integer, tokStart);
 
     curPtr += 2;
-    while (isxdigit(*curPtr))
+    while (isCharClass(*curPtr, CC_HexDigit))
       ++curPtr;
 
     return formToken(Token::integer, tokStart);
   }
 
   // Handle the normal decimal case.
-  while (isdigit(*curPtr))
+  while (isCharClass(*curPtr, CC_Digit))
     ++curPtr;
 
   if (*curPtr != '.')
@@ -310,14 +348,16 @@ Token Lexer::lexNumber(const char *tokStart) {
   ++curPtr;
 
   // Skip over [0-9]*([eE][-+]?[0-9]+)?
-  while (isdigit(*curPtr)) ++curPtr;
+  while (isCharClass(*curPtr, CC_Digit))
+    ++curPtr;
 
   if (*curPtr == 'e' || *curPtr == 'E') {
     if (isdigit(static_cast<unsigned char>(curPtr[1])) ||
         ((curPtr[1] == '-' || curPtr[1] == '+') &&
          isdigit(static_cast<unsigned char>(curPtr[2])))) {
       curPtr += 2;
-      while (isdigit(*curPtr)) ++curPtr;
+      while (isCharClass(*curPtr, CC_Digit))
+        ++curPtr;
     }
   }
   return formToken(Token::floatliteral, tokStart);
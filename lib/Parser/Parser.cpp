@@ -37,11 +37,14 @@
 #include "llvm/ADT/DenseMap.h"
 #include "llvm/ADT/StringSet.h"
 #include "llvm/ADT/bit.h"
+#include "llvm/Support/CommandLine.h"
 #include "llvm/Support/MemoryBuffer.h"
+#include "llvm/Support/Parallel.h"
 #include "llvm/Support/PrettyStackTrace.h"
 #include "llvm/Support/SMLoc.h"
 #include "llvm/Support/SourceMgr.h"
 #include <algorithm>
+#include <atomic>
 using namespace mlir;
 using llvm::MemoryBuffer;
 using llvm::SMLoc;
@@ -62,6 +65,14 @@ public:
   ParserState(const llvm::SourceMgr &sourceMgr, MLIRContext *ctx)
       : context(ctx), lex(sourceMgr, ctx), curToken(lex.lexToken()) {}
 
+  /// Create a parser state whose lexer starts at the given position within
+  /// the source buffer. This is used when parsing independent regions of the
+  /// buffer on multiple threads.
+  ParserState(const llvm::SourceMgr &sourceMgr, MLIRContext *ctx,
+              const char *startPtr)
+      : context(ctx), lex(sourceMgr, ctx),
+        curToken((lex.resetPointer(startPtr), lex.lexToken())) {}
+
   // A map from attribute alias identifier to Attribute.
   llvm::StringMap<Attribute> attributeAliasDefinitions;
 
@@ -1253,6 +1264,11 @@ private:
   DenseElementsAttr getIntAttr(llvm::SMLoc loc, ShapedType type,
                                IntegerType eltTy);
 
+  /// Build a Dense Integer attribute by packing the parsed elements into a
+  /// buffer of the native type `T`, which must have the same width as the
+  /// element type.
+  template <typename T> DenseElementsAttr getTypedIntAttr(ShapedType type);
+
   /// Build a Dense Float attribute for the given type.
   DenseElementsAttr getFloatAttr(llvm::SMLoc loc, ShapedType type,
                                  FloatType eltTy);
@@ -1323,6 +1339,27 @@ DenseElementsAttr TensorLiteralParser::getAttr(llvm::SMLoc loc,
   return getFloatAttr(loc, type, floatTy);
 }
 
+/// Build a Dense Integer attribute by packing the parsed elements into a
+/// buffer of the native type `T`, which must have the same width as the
+/// element type. This avoids materializing an APInt per element on the hot
+/// path through large weight literals.
+template <typename T>
+DenseElementsAttr TensorLiteralParser::getTypedIntAttr(ShapedType type) {
+  size_t width = sizeof(T) * 8;
+  std::vector<T> elements;
+  elements.reserve(intStorage.size());
+  for (auto &signAndValue : intStorage) {
+    // As in the APInt path, the magnitude must round-trip through the element
+    // width when zero-extended.
+    if (width < 64 && (signAndValue.second >> width) != 0)
+      return (p.emitError("integer constant out of range for type"), nullptr);
+    uint64_t value =
+        signAndValue.first ? -signAndValue.second : signAndValue.second;
+    elements.push_back(static_cast<T>(value));
+  }
+  return DenseElementsAttr::get(type, llvm::makeArrayRef(elements));
+}
+
 /// Build a Dense Integer attribute for the given type.
 DenseElementsAttr TensorLiteralParser::getIntAttr(llvm::SMLoc loc,
                                                   ShapedType type,
@@ -1333,6 +1370,21 @@ DenseElementsAttr TensorLiteralParser::getIntAttr(llvm::SMLoc loc,
     return nullptr;
   }
 
+  // For the standard widths, pack the raw storage into a typed buffer and
+  // build the attribute in one shot.
+  switch (eltTy.getWidth()) {
+  case 8:
+    return getTypedIntAttr<uint8_t>(type);
+  case 16:
+    return getTypedIntAttr<uint16_t>(type);
+  case 32:
+    return getTypedIntAttr<uint32_t>(type);
+  case 64:
+    return getTypedIntAttr<uint64_t>(type);
+  default:
+    break;
+  }
+
   // Create APInt values for each element with the correct bitwidth.
   std::vector<APInt> intElements;
   intElements.reserve(intStorage.size());
@@ -1355,6 +1407,16 @@ DenseElementsAttr TensorLiteralParser::getFloatAttr(llvm::SMLoc loc,
     return nullptr;
   }
 
+  // The parsed values are already in native double form, so for f32/f64 pack
+  // them into a typed buffer and build the attribute in one shot rather than
+  // uniquing a FloatAttr per element.
+  if (eltTy.isF64())
+    return DenseElementsAttr::get(type, llvm::makeArrayRef(floatStorage));
+  if (eltTy.isF32()) {
+    std::vector<float> floatElements(floatStorage.begin(), floatStorage.end());
+    return DenseElementsAttr::get(type, llvm::makeArrayRef(floatElements));
+  }
+
   // Build the float values from the raw integer storage.
   std::vector<Attribute> floatValues;
   floatValues.reserve(floatStorage.size());
@@ -1508,6 +1570,40 @@ Attribute Parser::parseDenseElementsAttr() {
   if (parseToken(Token::less, "expected '<' after 'dense'"))
     return nullptr;
 
+  // Check for a hex string encoding the raw storage of the attribute, as
+  // emitted by the printer for large attributes. This decodes straight into
+  // the dense storage layout with no per-element work.
+  if (getToken().is(Token::string)) {
+    auto hexLoc = getToken().getLoc();
+    auto val = getToken().getStringValue();
+    if (val.size() < 2 || val[0] != '0' || val[1] != 'x')
+      return (emitError("elements hex string should start with '0x'"),
+              nullptr);
+
+    val = val.substr(2);
+    if (!llvm::all_of(val, llvm::isHexDigit))
+      return (emitError("elements hex string only contains hex digits"),
+              nullptr);
+
+    consumeToken(Token::string);
+    if (parseToken(Token::greater, "expected '>'") ||
+        parseToken(Token::colon, "expected ':'"))
+      return nullptr;
+
+    auto type = parseElementsLiteralType();
+    if (!type)
+      return nullptr;
+
+    std::string data = llvm::fromHex(val);
+    ArrayRef<char> rawData(data.data(), data.size());
+    if (!DenseElementsAttr::isValidRawBuffer(type, rawData))
+      return (emitError(hexLoc,
+                        "elements hex data size does not match the expected "
+                        "storage size of the type"),
+              nullptr);
+    return DenseElementsAttr::getFromRawBuffer(type, rawData);
+  }
+
   // Parse the literal data.
   TensorLiteralParser literalParser(*this);
   if (literalParser.parse())
@@ -3091,6 +3187,11 @@ Operation *OperationParser::parseGenericOperation() {
       return emitError("successors in non-terminator"), nullptr;
     if (parseSuccessors(successors, successorOperands))
       return nullptr;
+    // The successor count is stored in a packed bitfield on the operation.
+    if (successors.size() > Operation::kMaxSuccessors)
+      return (emitError("operation cannot have more than ")
+                  << Operation::kMaxSuccessors << " successors",
+              nullptr);
   }
 
   // Parse the region list.
@@ -3105,6 +3206,11 @@ Operation *OperationParser::parseGenericOperation() {
     } while (consumeIf(Token::comma));
     if (parseToken(Token::r_paren, "expected ')' to end region list"))
       return nullptr;
+    // The region count is stored in a packed bitfield on the operation.
+    if (result.regions.size() > Operation::kMaxRegions)
+      return (emitError("operation cannot have more than ")
+                  << Operation::kMaxRegions << " regions",
+              nullptr);
   }
 
   if (getToken().is(Token::l_brace)) {
@@ -3123,6 +3229,11 @@ Operation *OperationParser::parseGenericOperation() {
   if (!fnType)
     return (emitError(typeLoc, "expected function type"), nullptr);
 
+  // The result count is stored in a packed bitfield on the operation.
+  if (fnType.getResults().size() > Operation::kMaxResults)
+    return (emitError(typeLoc, "operation cannot have more than ")
+                << Operation::kMaxResults << " results",
+            nullptr);
   result.addTypes(fnType.getResults());
 
   // Check that we have the right number of types for the operands.
@@ -3849,6 +3960,10 @@ public:
 
   ParseResult parseModule(Module *module);
 
+  /// Parse a single function definition or declaration starting at the
+  /// current token, which must be 'func'.
+  ParseResult parseFunc(Module *module);
+
 private:
   /// Parse an attribute alias declaration.
   ParseResult parseAttributeAliasDef();
@@ -3865,7 +3980,6 @@ private:
       StringRef &name, FunctionType &type,
       SmallVectorImpl<std::pair<SMLoc, StringRef>> &argNames,
       SmallVectorImpl<SmallVector<NamedAttribute, 2>> &argAttrs);
-  ParseResult parseFunc(Module *module);
 };
 } // end anonymous namespace
 
@@ -4130,6 +4244,101 @@ ParseResult ModuleParser::parseModule(Module *module) {
 
 //===----------------------------------------------------------------------===//
 
+/// An experimental mode that parses the top-level functions of a module on
+/// multiple threads. Modules using top-level attribute or type aliases fall
+/// back to the sequential parser.
+static llvm::cl::opt<bool> parallelFunctionParsing(
+    "mlir-parallel-function-parsing", llvm::cl::init(false),
+    llvm::cl::desc("Parse top-level functions on multiple threads "
+                   "(experimental)"));
+
+/// Attempt to parse the module in two phases: a sequential lex that splits
+/// the buffer into per-function regions, followed by a parallel parse of
+/// those regions that merges the resulting functions into 'module' in source
+/// order. Returns None if the buffer contains top-level entities this mode
+/// does not support, in which case the caller should use the sequential
+/// parser instead.
+static Optional<ParseResult>
+parseModuleFunctionsParallel(const llvm::SourceMgr &sourceMgr, Module *module,
+                             MLIRContext *context) {
+  // Phase one: lex the buffer to find the start of each top-level function.
+  // Function references are by-name, so function bodies are independent of
+  // each other once the region boundaries are known.
+  SmallVector<const char *, 32> functionStarts;
+  {
+    Lexer lexer(sourceMgr, context);
+    unsigned braceDepth = 0;
+    for (Token token = lexer.lexToken(); token.isNot(Token::eof);
+         token = lexer.lexToken()) {
+      switch (token.getKind()) {
+      case Token::error:
+        // The lexer already emitted an error.
+        return ParseResult(failure());
+      case Token::l_brace:
+        ++braceDepth;
+        break;
+      case Token::r_brace:
+        // Unbalanced braces; let the sequential parser emit the error.
+        if (braceDepth == 0)
+          return llvm::None;
+        --braceDepth;
+        break;
+      case Token::kw_func:
+        if (braceDepth == 0)
+          functionStarts.push_back(token.getLoc().getPointer());
+        break;
+      case Token::equal:
+        // A top-level '=' only occurs in attribute/type alias definitions,
+        // which must be parsed sequentially.
+        if (braceDepth == 0)
+          return llvm::None;
+        break;
+      default:
+        break;
+      }
+    }
+  }
+  if (functionStarts.empty())
+    return ParseResult(success());
+
+  // Phase two: parse each function region with its own parser state. Each
+  // worker parses into a local module so that the function lists can be
+  // merged in source order afterwards.
+  std::vector<std::unique_ptr<Module>> shards(functionStarts.size());
+  std::atomic<bool> anyFailed(false);
+  llvm::parallel::for_each_n(
+      llvm::parallel::par, size_t(0), functionStarts.size(), [&](size_t i) {
+        if (anyFailed)
+          return;
+        shards[i].reset(new Module(context));
+        ParserState state(sourceMgr, context, functionStarts[i]);
+        if (ModuleParser(state).parseFunc(shards[i].get()))
+          anyFailed = true;
+      });
+  if (anyFailed)
+    return ParseResult(failure());
+
+  // Merge the functions into the module in source order. The module symbol
+  // table renames on conflict, so a changed name after the transfer signals a
+  // redefinition that the per-shard parsers could not see.
+  auto &functions = module->getFunctions();
+  for (auto &shard : shards) {
+    auto &shardFunctions = shard->getFunctions();
+    while (!shardFunctions.empty()) {
+      Function &fn = shardFunctions.front();
+      Identifier name = fn.getName();
+      functions.splice(functions.end(), shardFunctions,
+                       shardFunctions.begin());
+      if (fn.getName() != name) {
+        emitError(fn.getLoc(), "redefinition of function named '")
+            << name.strref() << "'";
+        return ParseResult(failure());
+      }
+    }
+  }
+  return ParseResult(success());
+}
+
 /// This parses the file specified by the indicated SourceMgr and returns an
 /// MLIR module if it was valid.  If not, it emits diagnostics and returns
 /// null.
@@ -4139,6 +4348,19 @@ Module *mlir::parseSourceFile(const llvm::SourceMgr &sourceMgr,
   // This is the result module we are parsing into.
   std::unique_ptr<Module> module(new Module(context));
 
+  // Try the parallel parsing mode if it was requested; it declines modules
+  // with top-level entities it cannot handle.
+  if (parallelFunctionParsing) {
+    if (auto result =
+            parseModuleFunctionsParallel(sourceMgr, module.get(), context)) {
+      if (*result)
+        return nullptr;
+      if (failed(module->verify()))
+        return nullptr;
+      return module.release();
+    }
+  }
+
   ParserState state(sourceMgr, context);
   if (ModuleParser(state).parseModule(module.get())) {
     return nullptr;
@@ -20,6 +20,7 @@
 #include "mlir/Pass/PassManager.h"
 #include "llvm/Support/Format.h"
 #include "llvm/Support/FormatVariadic.h"
+#include "llvm/Support/Mutex.h"
 
 using namespace mlir;
 using namespace mlir::detail;
@@ -33,10 +34,14 @@ public:
 
   IRPrinterInstrumentation(ShouldPrintFn &&shouldPrintBeforePass,
                            ShouldPrintFn &&shouldPrintAfterPass,
-                           bool printModuleScope, raw_ostream &out)
+                           bool printModuleScope, bool printDiffOnly,
+                           ArrayRef<std::string> functionFilter,
+                           ArrayRef<std::string> opFilter, raw_ostream &out)
       : shouldPrintBeforePass(shouldPrintBeforePass),
         shouldPrintAfterPass(shouldPrintAfterPass),
-        printModuleScope(printModuleScope), out(out) {
+        printModuleScope(printModuleScope), printDiffOnly(printDiffOnly),
+        functionFilter(functionFilter.begin(), functionFilter.end()),
+        opFilter(opFilter.begin(), opFilter.end()), out(out) {
     assert((shouldPrintBeforePass || shouldPrintAfterPass) &&
            "expected atleast one valid filter function");
   }
@@ -47,51 +52,185 @@ private:
   void runAfterPass(Pass *pass, const llvm::Any &ir) override;
   void runAfterPassFailed(Pass *pass, const llvm::Any &ir) override;
 
+  /// Returns true if the given function passes the name and op-kind scope
+  /// filters.
+  bool shouldPrintFunction(Function &fn);
+
+  /// Print the given IR unit to 'out', prefixed with 'banner' and restricted
+  /// to the configured scope filters.
+  void printIR(const llvm::Any &ir, StringRef banner);
+
+  /// Record a rendered snapshot of each in-scope function of 'ir', keyed by
+  /// 'pass', for later comparison in the diff mode.
+  void takeSnapshots(Pass *pass, const llvm::Any &ir);
+
+  /// Print only the in-scope functions of 'ir' that changed since the
+  /// snapshot taken before 'pass' ran, prefixed with 'banner'.
+  void printDiff(Pass *pass, const llvm::Any &ir, StringRef banner);
+
   /// Filter functions for before and after pass execution.
   ShouldPrintFn shouldPrintBeforePass, shouldPrintAfterPass;
 
   /// Flag to toggle if the printer should always print at module scope.
   bool printModuleScope;
 
+  /// Flag to toggle if only functions that changed during pass execution
+  /// should be printed after the pass.
+  bool printDiffOnly;
+
+  /// If non-empty, only functions with one of these names are printed.
+  std::vector<std::string> functionFilter;
+
+  /// If non-empty, only functions containing at least one operation with one
+  /// of these names are printed.
+  std::vector<std::string> opFilter;
+
+  /// Rendered snapshots of each in-scope function, taken before the
+  /// corresponding pass ran. Guarded by snapshotMutex.
+  DenseMap<std::pair<Pass *, Function *>, std::string> snapshots;
+
+  /// A mutex guarding the snapshot map, as function passes may run in
+  /// parallel.
+  llvm::sys::SmartMutex<true> snapshotMutex;
+
   /// The stream to output to.
   raw_ostream &out;
 };
 } // end anonymous namespace
 
-static void printIR(const llvm::Any &ir, bool printModuleScope,
-                    raw_ostream &out) {
+/// Returns true if 'name' is contained in the given filter list.
+static bool filterContains(ArrayRef<std::string> filter, StringRef name) {
+  return llvm::any_of(
+      filter, [&](const std::string &entry) { return name.equals(entry); });
+}
+
+/// Render the IR of the given function into a string.
+static std::string renderFunction(Function &fn) {
+  std::string str;
+  llvm::raw_string_ostream os(str);
+  fn.print(os);
+  return os.str();
+}
+
+bool IRPrinterInstrumentation::shouldPrintFunction(Function &fn) {
+  // Check the function name filter.
+  if (!functionFilter.empty() &&
+      !filterContains(functionFilter, fn.getName().strref()))
+    return false;
+
+  // Check that the function contains an operation matching the op filter.
+  if (!opFilter.empty()) {
+    bool hasMatch = false;
+    fn.walk([&](Operation *op) {
+      if (!hasMatch && filterContains(opFilter, op->getName().getStringRef()))
+        hasMatch = true;
+    });
+    if (!hasMatch)
+      return false;
+  }
+  return true;
+}
+
+void IRPrinterInstrumentation::printIR(const llvm::Any &ir, StringRef banner) {
   // Check for printing at module scope.
   if (printModuleScope && llvm::any_isa<Function *>(ir)) {
     Function *function = llvm::any_cast<Function *>(ir);
 
     // Print the function name and a newline before the Module.
-    out << " (function: " << function->getName() << ")\n";
+    out << banner << " (function: " << function->getName() << ")\n";
     function->getModule()->print(out);
     return;
   }
 
-  // Print a newline before the IR.
-  out << "\n";
-
-  // Print the given function.
+  // Print the given function if it is in scope.
   if (llvm::any_isa<Function *>(ir)) {
-    llvm::any_cast<Function *>(ir)->print(out);
+    Function *function = llvm::any_cast<Function *>(ir);
+    if (!shouldPrintFunction(*function))
+      return;
+    out << banner << "\n";
+    function->print(out);
     return;
   }
 
-  // Print the given module.
+  // Print the given module, restricted to the in-scope functions when scope
+  // filters are set.
   assert(llvm::any_isa<Module *>(ir) && "unexpected IR unit");
-  llvm::any_cast<Module *>(ir)->print(out);
+  Module *module = llvm::any_cast<Module *>(ir);
+  out << banner << "\n";
+  if (functionFilter.empty() && opFilter.empty()) {
+    module->print(out);
+    return;
+  }
+  for (Function &fn : *module)
+    if (shouldPrintFunction(fn))
+      fn.print(out);
+}
+
+void IRPrinterInstrumentation::takeSnapshots(Pass *pass, const llvm::Any &ir) {
+  llvm::sys::SmartScopedLock<true> lock(snapshotMutex);
+  if (llvm::any_isa<Function *>(ir)) {
+    Function *function = llvm::any_cast<Function *>(ir);
+    if (shouldPrintFunction(*function))
+      snapshots[{pass, function}] = renderFunction(*function);
+    return;
+  }
+  Module *module = llvm::any_cast<Module *>(ir);
+  for (Function &fn : *module)
+    if (shouldPrintFunction(fn))
+      snapshots[{pass, &fn}] = renderFunction(fn);
+}
+
+void IRPrinterInstrumentation::printDiff(Pass *pass, const llvm::Any &ir,
+                                         StringRef banner) {
+  // Collect the in-scope functions of this IR unit.
+  SmallVector<Function *, 4> functions;
+  if (llvm::any_isa<Function *>(ir)) {
+    Function *function = llvm::any_cast<Function *>(ir);
+    if (shouldPrintFunction(*function))
+      functions.push_back(function);
+  } else {
+    Module *module = llvm::any_cast<Module *>(ir);
+    for (Function &fn : *module)
+      if (shouldPrintFunction(fn))
+        functions.push_back(&fn);
+  }
+
+  // Print only the functions whose rendered form changed since the snapshot
+  // taken before the pass ran. Functions without a snapshot (e.g. created by
+  // the pass) are always printed.
+  bool printedAny = false;
+  llvm::sys::SmartScopedLock<true> lock(snapshotMutex);
+  for (Function *fn : functions) {
+    std::string current = renderFunction(*fn);
+    auto it = snapshots.find({pass, fn});
+    bool changed = it == snapshots.end() || it->second != current;
+    if (it != snapshots.end())
+      snapshots.erase(it);
+    if (!changed)
+      continue;
+    if (!printedAny)
+      out << banner << "\n";
+    printedAny = true;
+    out << current;
+  }
+  if (!printedAny)
+    out << banner << " (no changes)\n";
 }
 
 /// Instrumentation hooks.
 void IRPrinterInstrumentation::runBeforePass(Pass *pass, const llvm::Any &ir) {
-  // Skip adaptor passes and passes that the user filtered out.
-  if (!shouldPrintBeforePass || isAdaptorPass(pass) ||
-      !shouldPrintBeforePass(pass))
+  if (isAdaptorPass(pass))
+    return;
+
+  // In the diff mode, snapshot the IR before the pass runs so the after-pass
+  // hook can print only what changed.
+  if (printDiffOnly && shouldPrintAfterPass && shouldPrintAfterPass(pass))
+    takeSnapshots(pass, ir);
+
+  // Skip passes that the user filtered out.
+  if (!shouldPrintBeforePass || !shouldPrintBeforePass(pass))
     return;
-  out << formatv("*** IR Dump Before {0} ***", pass->getName());
-  printIR(ir, printModuleScope, out);
+  printIR(ir, formatv("*** IR Dump Before {0} ***", pass->getName()).str());
 }
 
 void IRPrinterInstrumentation::runAfterPass(Pass *pass, const llvm::Any &ir) {
@@ -99,8 +238,11 @@ void IRPrinterInstrumentation::runAfterPass(Pass *pass, const llvm::Any &ir) {
   if (!shouldPrintAfterPass || isAdaptorPass(pass) ||
       !shouldPrintAfterPass(pass))
     return;
-  out << formatv("*** IR Dump After {0} ***", pass->getName());
-  printIR(ir, printModuleScope, out);
+  std::string banner = formatv("*** IR Dump After {0} ***", pass->getName());
+  if (printDiffOnly)
+    printDiff(pass, ir, banner);
+  else
+    printIR(ir, banner);
 }
 
 void IRPrinterInstrumentation::runAfterPassFailed(Pass *pass,
@@ -109,8 +251,9 @@ void IRPrinterInstrumentation::runAfterPassFailed(Pass *pass,
   if (!shouldPrintAfterPass || isAdaptorPass(pass) ||
       !shouldPrintAfterPass(pass))
     return;
-  out << formatv("*** IR Dump After {0} Failed ***", pass->getName());
-  printIR(ir, printModuleScope, out);
+  // Always print the full IR on failure, even in the diff mode.
+  printIR(ir,
+          formatv("*** IR Dump After {0} Failed ***", pass->getName()).str());
 }
 
 //===----------------------------------------------------------------------===//
@@ -121,8 +264,9 @@ void IRPrinterInstrumentation::runAfterPassFailed(Pass *pass,
 void PassManager::enableIRPrinting(
     std::function<bool(Pass *)> shouldPrintBeforePass,
     std::function<bool(Pass *)> shouldPrintAfterPass, bool printModuleScope,
-    raw_ostream &out) {
+    bool printDiffOnly, ArrayRef<std::string> functionFilter,
+    ArrayRef<std::string> opFilter, raw_ostream &out) {
   addInstrumentation(new IRPrinterInstrumentation(
       std::move(shouldPrintBeforePass), std::move(shouldPrintAfterPass),
-      printModuleScope, out));
+      printModuleScope, printDiffOnly, functionFilter, opFilter, out));
 }
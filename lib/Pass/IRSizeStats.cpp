@@ -0,0 +1,140 @@
+//===- IRSizeStats.cpp ----------------------------------------------------===//
+//
+// Copyright 2019 The MLIR Authors.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+// =============================================================================
+//
+// This file implements an instrumentation that records how much each pass
+// grows or shrinks the IR it runs on, so IR-bloat regressions (e.g. overeager
+// unrolling) show up directly instead of as slowdowns in downstream passes.
+//
+//===----------------------------------------------------------------------===//
+
+#include "PassDetail.h"
+#include "mlir/IR/Function.h"
+#include "mlir/IR/Module.h"
+#include "mlir/Pass/PassManager.h"
+#include "llvm/ADT/StringMap.h"
+#include "llvm/Support/Format.h"
+#include "llvm/Support/Mutex.h"
+#include "llvm/Support/Threading.h"
+
+using namespace mlir;
+using namespace mlir::detail;
+
+constexpr llvm::StringLiteral kIRSizeDescription =
+    "... Pass IR size delta report ...";
+
+/// Returns the number of operations in the IR unit held by `ir`. Function
+/// counts are cached on the function and only recomputed after mutations, so
+/// measuring a pass that did not touch a function costs nothing.
+static uint64_t getOpCount(const llvm::Any &ir) {
+  if (auto *const *func = llvm::any_cast<Function *>(&ir))
+    return (*func)->getCachedOpCount();
+  if (auto *const *module = llvm::any_cast<Module *>(&ir)) {
+    uint64_t count = 0;
+    for (Function &func : **module)
+      count += func.getCachedOpCount();
+    return count;
+  }
+  return 0;
+}
+
+namespace {
+struct IRSizeStats : public PassInstrumentation {
+  /// Accumulated op-count delta for one pass name.
+  struct SizeEntry {
+    int64_t delta = 0;
+    uint64_t runs = 0;
+  };
+
+  ~IRSizeStats() { print(); }
+
+  void runBeforePass(Pass *pass, const llvm::Any &ir) override {
+    // Adaptor passes aggregate the deltas of the passes they hold.
+    if (isAdaptorPass(pass))
+      return;
+    uint64_t count = getOpCount(ir);
+    llvm::sys::SmartScopedLock<true> lock(mutex);
+    activeCounts[llvm::get_threadid()].push_back(count);
+  }
+
+  void runAfterPass(Pass *pass, const llvm::Any &ir) override {
+    if (isAdaptorPass(pass))
+      return;
+    uint64_t count = getOpCount(ir);
+    llvm::sys::SmartScopedLock<true> lock(mutex);
+    auto &counts = activeCounts[llvm::get_threadid()];
+    assert(!counts.empty() && "expected recorded op count");
+    auto &entry = stats[pass->getName()];
+    entry.delta += int64_t(count) - int64_t(counts.pop_back_val());
+    ++entry.runs;
+  }
+
+  void runAfterPassFailed(Pass *pass, const llvm::Any &ir) override {
+    runAfterPass(pass, ir);
+  }
+
+  /// Print and clear the recorded deltas.
+  void print() {
+    if (stats.empty())
+      return;
+    auto os = llvm::CreateInfoOutputFile();
+
+    *os << "===" << std::string(73, '-') << "===\n";
+    unsigned padding = (80 - kIRSizeDescription.size()) / 2;
+    os->indent(padding) << kIRSizeDescription << '\n';
+    *os << "===" << std::string(73, '-') << "===\n";
+    *os << "  ---Op Delta---  ---Runs---  --- Name ---\n";
+
+    // Sort by delta, largest growth first.
+    std::vector<std::pair<StringRef, SizeEntry>> sorted;
+    for (auto &it : stats)
+      sorted.emplace_back(it.first(), it.second);
+    llvm::array_pod_sort(sorted.begin(), sorted.end(),
+                         [](const std::pair<StringRef, SizeEntry> *lhs,
+                            const std::pair<StringRef, SizeEntry> *rhs) {
+                           return llvm::array_pod_sort_comparator<int64_t>(
+                               &rhs->second.delta, &lhs->second.delta);
+                         });
+
+    for (auto &it : sorted)
+      *os << llvm::format("  %+14lld  %10llu  ",
+                          static_cast<long long>(it.second.delta),
+                          static_cast<unsigned long long>(it.second.runs))
+          << it.first << '\n';
+    os->flush();
+    stats.clear();
+    activeCounts.clear();
+  }
+
+  /// Accumulated op-count deltas keyed by pass name.
+  llvm::StringMap<SizeEntry> stats;
+
+  /// Op counts recorded before the passes currently running on each thread.
+  DenseMap<uint64_t, SmallVector<uint64_t, 4>> activeCounts;
+
+  /// Guards the maps above; function passes run concurrently.
+  llvm::sys::SmartMutex<true> mutex;
+};
+} // end anonymous namespace
+
+//===----------------------------------------------------------------------===//
+// PassManager
+//===----------------------------------------------------------------------===//
+
+/// Add an instrumentation that reports per-pass op-count deltas.
+void PassManager::enableIRSizeStats() {
+  addInstrumentation(new IRSizeStats());
+}
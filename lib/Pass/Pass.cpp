@@ -24,10 +24,13 @@
 #include "mlir/IR/Diagnostics.h"
 #include "mlir/IR/Module.h"
 #include "mlir/Pass/PassManager.h"
+#include "llvm/ADT/Hashing.h"
 #include "llvm/Support/CommandLine.h"
 #include "llvm/Support/Mutex.h"
 #include "llvm/Support/Parallel.h"
 #include "llvm/Support/Threading.h"
+#include <atomic>
+#include <numeric>
 
 using namespace mlir;
 using namespace mlir::detail;
@@ -37,6 +40,12 @@ static llvm::cl::opt<bool>
                    llvm::cl::desc("Disable multithreading in the pass manager"),
                    llvm::cl::init(false));
 
+static llvm::cl::opt<bool> disablePipelineCaching(
+    "mlir-disable-pipeline-caching",
+    llvm::cl::desc("Disable skipping function pipelines that already ran on "
+                   "an unchanged function without modifying it"),
+    llvm::cl::init(false));
+
 //===----------------------------------------------------------------------===//
 // Pass
 //===----------------------------------------------------------------------===//
@@ -108,12 +117,32 @@ LogicalResult ModulePassBase::run(Module *module, ModuleAnalysisManager &mam) {
 // PassExecutor
 //===----------------------------------------------------------------------===//
 
+/// A monotonically increasing counter handing out process-unique pipeline
+/// identifiers to function pass executors.
+static std::atomic<uint64_t> nextPipelineID(1);
+
+FunctionPassExecutor::FunctionPassExecutor()
+    : PassExecutor(Kind::FunctionExecutor),
+      pipelineID(nextPipelineID.fetch_add(1, std::memory_order_relaxed)) {}
+
 FunctionPassExecutor::FunctionPassExecutor(const FunctionPassExecutor &rhs)
-    : PassExecutor(Kind::FunctionExecutor) {
+    : PassExecutor(Kind::FunctionExecutor), pipelineID(rhs.pipelineID) {
   for (auto &pass : rhs.passes)
     addPass(pass->clone());
 }
 
+/// Fingerprint the pipeline. Reserve zero to mean "no fingerprint".
+uint64_t detail::FunctionPassExecutor::getFingerprint() const {
+  // Seed with the pipeline identifier so that two differently configured
+  // pipelines built from the same pass classes never collide, and hash in the
+  // ordered pass identities so that an executor extended with more passes
+  // after a run fingerprints differently.
+  llvm::hash_code hash = llvm::hash_value(pipelineID);
+  for (auto &pass : passes)
+    hash = llvm::hash_combine(hash, pass->getPassID());
+  return uint64_t(hash) ? uint64_t(hash) : 1;
+}
+
 /// Run all of the passes in this manager over the current function.
 LogicalResult detail::FunctionPassExecutor::run(Function *function,
                                                 FunctionAnalysisManager &fam) {
@@ -124,13 +153,62 @@ LogicalResult detail::FunctionPassExecutor::run(Function *function,
   return success();
 }
 
+/// Run a contiguous group of read-only module passes concurrently. Read-only
+/// passes never mutate the module, so they may all inspect it at once. Each
+/// pass gets a scratch analysis manager so that concurrent analysis caching
+/// does not race; read-only passes preserve all analyses, so the primary
+/// manager is unaffected either way.
+LogicalResult detail::ModulePassExecutor::runReadOnlyPassesInParallel(
+    MutableArrayRef<std::unique_ptr<ModulePassBase>> groupPasses,
+    Module *module, ModuleAnalysisManager &mam) {
+  std::vector<unsigned> indices(groupPasses.size());
+  std::iota(indices.begin(), indices.end(), 0u);
+
+  // A parallel diagnostic handler that provides deterministic diagnostic
+  // ordering.
+  ParallelDiagnosticHandler diagHandler(module->getContext());
+
+  std::atomic<bool> passFailed(false);
+  llvm::parallel::for_each(
+      llvm::parallel::par, indices.begin(), indices.end(), [&](unsigned index) {
+        if (passFailed)
+          return;
+        diagHandler.setOrderIDForThread(index);
+        ModuleAnalysisManager scratchMAM(module, mam.getPassInstrumentor());
+        if (failed(groupPasses[index]->run(module, scratchMAM)))
+          passFailed = true;
+      });
+  return failure(passFailed);
+}
+
 /// Run all of the passes in this manager over the current module.
 LogicalResult detail::ModulePassExecutor::run(Module *module,
                                               ModuleAnalysisManager &mam) {
-  // Run each of the held passes.
-  for (auto &pass : passes)
-    if (failed(pass->run(module, mam)))
+  bool canRunInParallel = !disableThreads && llvm::llvm_is_multithreaded();
+
+  // Run each of the held passes, overlapping adjacent read-only passes when
+  // multi-threading is available.
+  for (unsigned i = 0, e = passes.size(); i != e;) {
+    // Collect the maximal run of adjacent read-only passes.
+    unsigned groupEnd = i;
+    if (canRunInParallel)
+      while (groupEnd != e && passes[groupEnd]->isReadOnly())
+        ++groupEnd;
+
+    // A group of at least two read-only passes can execute concurrently.
+    if (groupEnd - i >= 2) {
+      auto group = MutableArrayRef<std::unique_ptr<ModulePassBase>>(passes)
+                       .slice(i, groupEnd - i);
+      if (failed(runReadOnlyPassesInParallel(group, module, mam)))
+        return failure();
+      i = groupEnd;
+      continue;
+    }
+
+    if (failed(passes[i]->run(module, mam)))
       return failure();
+    ++i;
+  }
   return success();
 }
 
@@ -143,9 +221,21 @@ LogicalResult detail::ModulePassExecutor::run(Module *module,
 static LogicalResult runFunctionPipeline(FunctionPassExecutor &fpe,
                                          Function *func,
                                          FunctionAnalysisManager &fam) {
+  // Skip the pipeline if it already ran to completion on the body in its
+  // current state without changing it; re-running it cannot do anything.
+  uint64_t pipelineFingerprint = fpe.getFingerprint();
+  if (!disablePipelineCaching && func->hasPipelineConverged(pipelineFingerprint))
+    return success();
+
   // Run the function pipeline over the provided function.
+  uint64_t modCountBefore = func->getBodyModificationCount();
   auto result = fpe.run(func, fam);
 
+  // If the pipeline succeeded without modifying the body, remember that so
+  // identical re-runs can be skipped.
+  if (succeeded(result) && func->getBodyModificationCount() == modCountBefore)
+    func->markPipelineConverged(pipelineFingerprint);
+
   // Clear out any computed function analyses. These analyses won't be used
   // any more in this pipeline, and this helps reduce the current working set
   // of memory. If preserving these analyses becomes important in the future
@@ -194,6 +284,24 @@ void ModuleToFunctionPassAdaptorParallel::runOnModule() {
     if (!func.isExternal())
       funcAMPairs.emplace_back(&func, mam.slice(&func));
 
+  // Hand the functions out in decreasing size order. The executors below pull
+  // work from a shared index, so the distribution is already dynamic, but with
+  // a skewed module the wall time is dominated by whichever large function is
+  // scheduled last. Starting with the largest functions keeps all executors
+  // busy until the tail of small ones. The diagnostic order ids keep using the
+  // module order so that diagnostic output remains deterministic.
+  std::vector<unsigned> scheduleOrder(funcAMPairs.size());
+  std::iota(scheduleOrder.begin(), scheduleOrder.end(), 0u);
+  std::vector<uint64_t> opCounts(funcAMPairs.size());
+  for (unsigned i = 0, e = funcAMPairs.size(); i != e; ++i) {
+    uint64_t count = 0;
+    funcAMPairs[i].first->walk([&](Operation *) { ++count; });
+    opCounts[i] = count;
+  }
+  std::stable_sort(
+      scheduleOrder.begin(), scheduleOrder.end(),
+      [&](unsigned lhs, unsigned rhs) { return opCounts[lhs] > opCounts[rhs]; });
+
   // A parallel diagnostic handler that provides deterministic diagnostic
   // ordering.
   ParallelDiagnosticHandler diagHandler(&getContext());
@@ -210,9 +318,10 @@ void ModuleToFunctionPassAdaptorParallel::runOnModule() {
       [&](FunctionPassExecutor &executor) {
         for (auto e = funcAMPairs.size(); !passFailed && funcIt < e;) {
           // Get the next available function index.
-          unsigned nextID = funcIt++;
-          if (nextID >= e)
+          unsigned nextIt = funcIt++;
+          if (nextIt >= e)
             break;
+          unsigned nextID = scheduleOrder[nextIt];
 
           // Set the function id for this thread in the diagnostic handler.
           diagHandler.setOrderIDForThread(nextID);
@@ -247,11 +356,46 @@ class FunctionVerifier : public FunctionPass<FunctionVerifier> {
 
 /// Pass to verify a module and signal failure if necessary.
 class ModuleVerifier : public ModulePass<ModuleVerifier> {
+  // Note: the verifier inspects the module without mutating it, but is not
+  // marked read-only as it parallelizes internally and installs its own
+  // diagnostic handler; overlapping it with other passes would nest parallel
+  // regions and race on the handler.
+
   void runOnModule() {
-    if (failed(getModule().verify()))
+    if (failed(verifyModule()))
       signalPassFailure();
     markAllAnalysesPreserved();
   }
+
+  /// Verify the module, checking the functions in parallel when
+  /// multi-threading is available. The functions are independent of each
+  /// other, so this only requires numbering diagnostics by module order to
+  /// keep the output identical to a serial walk.
+  LogicalResult verifyModule() {
+    if (disableThreads || !llvm::llvm_is_multithreaded())
+      return getModule().verify();
+
+    std::vector<Function *> funcs;
+    for (auto &func : getModule())
+      funcs.push_back(&func);
+    std::vector<unsigned> indices(funcs.size());
+    std::iota(indices.begin(), indices.end(), 0u);
+
+    // A parallel diagnostic handler that provides deterministic diagnostic
+    // ordering.
+    ParallelDiagnosticHandler diagHandler(&getContext());
+
+    std::atomic<bool> verifyFailed(false);
+    llvm::parallel::for_each(llvm::parallel::par, indices.begin(),
+                             indices.end(), [&](unsigned index) {
+                               if (verifyFailed)
+                                 return;
+                               diagHandler.setOrderIDForThread(index);
+                               if (failed(funcs[index]->verify()))
+                                 verifyFailed = true;
+                             });
+    return failure(verifyFailed);
+  }
 };
 } // end anonymous namespace
 
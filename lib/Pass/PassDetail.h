@@ -43,7 +43,7 @@ private:
 /// A pass executor that contains a list of passes over a function.
 class FunctionPassExecutor : public PassExecutor {
 public:
-  FunctionPassExecutor() : PassExecutor(Kind::FunctionExecutor) {}
+  FunctionPassExecutor();
   FunctionPassExecutor(FunctionPassExecutor &&) = default;
   FunctionPassExecutor(const FunctionPassExecutor &rhs);
 
@@ -57,12 +57,23 @@ public:
   /// Returns the number of passes held by this executor.
   size_t size() const { return passes.size(); }
 
+  /// Returns a non-zero fingerprint identifying this pipeline. An executor
+  /// and its clones share a fingerprint; independently built executors never
+  /// do, even when they hold the same pass classes in the same order, since
+  /// pass instances of the same class may be configured differently. The
+  /// fingerprint is only meaningful within a single process.
+  uint64_t getFingerprint() const;
+
   static bool classof(const PassExecutor *pe) {
     return pe->getKind() == Kind::FunctionExecutor;
   }
 
 private:
   std::vector<std::unique_ptr<FunctionPassBase>> passes;
+
+  /// A process-unique identifier for the pipeline this executor runs. Clones
+  /// inherit the identifier of the executor they were copied from.
+  uint64_t pipelineID;
 };
 
 /// A pass executor that contains a list of passes over a module unit.
@@ -87,6 +98,12 @@ public:
   }
 
 private:
+  /// Run a contiguous group of read-only passes concurrently over the given
+  /// module.
+  LogicalResult runReadOnlyPassesInParallel(
+      MutableArrayRef<std::unique_ptr<ModulePassBase>> groupPasses,
+      Module *module, ModuleAnalysisManager &mam);
+
   /// Set of passes to run on the given module.
   std::vector<std::unique_ptr<ModulePassBase>> passes;
 };
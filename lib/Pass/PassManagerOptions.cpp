@@ -38,6 +38,9 @@ struct PassManagerOptions {
   llvm::cl::opt<bool> printBeforeAll;
   llvm::cl::opt<bool> printAfterAll;
   llvm::cl::opt<bool> printModuleScope;
+  llvm::cl::opt<bool> printDiffOnly;
+  llvm::cl::list<std::string> printFunctionFilter;
+  llvm::cl::list<std::string> printOpFilter;
 
   /// Add an IR printing instrumentation if enabled by any 'print-ir' flags.
   void addPrinterInstrumentation(PassManager &pm);
@@ -47,6 +50,8 @@ struct PassManagerOptions {
   //===--------------------------------------------------------------------===//
   llvm::cl::opt<bool> passTiming;
   llvm::cl::opt<PassTimingDisplayMode> passTimingDisplayMode;
+  llvm::cl::opt<std::string> passTraceFile;
+  llvm::cl::opt<bool> passIRSizeStats;
 
   /// Add a pass timing instrumentation if enabled by 'pass-timing' flags.
   void addTimingInstrumentation(PassManager &pm);
@@ -75,6 +80,20 @@ PassManagerOptions::PassManagerOptions()
                          "always print "
                          "a module IR"),
           llvm::cl::init(false)),
+      printDiffOnly(
+          "print-ir-diff",
+          llvm::cl::desc("When printing IR after a pass, only print the "
+                         "functions whose IR changed during the pass"),
+          llvm::cl::init(false)),
+      printFunctionFilter(
+          "print-ir-function-filter",
+          llvm::cl::desc("Only print IR for functions with the given names"),
+          llvm::cl::CommaSeparated),
+      printOpFilter(
+          "print-ir-op-filter",
+          llvm::cl::desc("Only print IR for functions containing an operation "
+                         "with one of the given names"),
+          llvm::cl::CommaSeparated),
 
       //===----------------------------------------------------------------===//
       // Pass Timing
@@ -89,7 +108,15 @@ PassManagerOptions::PassManagerOptions()
               clEnumValN(PassTimingDisplayMode::List, "list",
                          "display the results in a list sorted by total time"),
               clEnumValN(PassTimingDisplayMode::Pipeline, "pipeline",
-                         "display the results with a nested pipeline view"))) {}
+                         "display the results with a nested pipeline view"))),
+      passTraceFile(
+          "pass-trace-json",
+          llvm::cl::desc("Write a chrome://tracing compatible JSON trace of "
+                         "all pass and analysis executions to the given "
+                         "file")),
+      passIRSizeStats(
+          "pass-ir-size",
+          llvm::cl::desc("Display the op-count delta of each pass")) {}
 
 /// Add an IR printing instrumentation if enabled by any 'print-ir' flags.
 void PassManagerOptions::addPrinterInstrumentation(PassManager &pm) {
@@ -126,12 +153,21 @@ void PassManagerOptions::addPrinterInstrumentation(PassManager &pm) {
     return;
 
   // Otherwise, add the IR printing instrumentation.
-  pm.enableIRPrinting(shouldPrintBeforePass, shouldPrintAfterPass,
-                      printModuleScope, llvm::errs());
+  pm.enableIRPrinting(
+      shouldPrintBeforePass, shouldPrintAfterPass, printModuleScope,
+      printDiffOnly,
+      std::vector<std::string>(printFunctionFilter.begin(),
+                               printFunctionFilter.end()),
+      std::vector<std::string>(printOpFilter.begin(), printOpFilter.end()),
+      llvm::errs());
 }
 
 /// Add a pass timing instrumentation if enabled by 'pass-timing' flags.
 void PassManagerOptions::addTimingInstrumentation(PassManager &pm) {
+  if (passIRSizeStats)
+    pm.enableIRSizeStats();
+  if (!passTraceFile.empty())
+    pm.enableChromeTracing(passTraceFile);
   if (passTiming)
     pm.enableTiming(passTimingDisplayMode);
 }
@@ -19,6 +19,7 @@
 #include "mlir/Pass/Pass.h"
 #include "mlir/Pass/PassManager.h"
 #include "llvm/ADT/DenseMap.h"
+#include "llvm/ADT/StringExtras.h"
 #include "llvm/Support/ManagedStatic.h"
 
 using namespace mlir;
@@ -82,6 +83,56 @@ const PassInfo *mlir::Pass::lookupPassInfo(const PassID *passID) {
   return &it->getSecond();
 }
 
+//===----------------------------------------------------------------------===//
+// CompiledPassPipeline
+//===----------------------------------------------------------------------===//
+
+/// Returns the registered pass or pass pipeline entry invocable with 'arg',
+/// or null if there is none.
+static const PassRegistryEntry *lookupRegistryEntry(StringRef arg) {
+  for (const auto &kv : *passRegistry)
+    if (kv.second.getPassArgument() == arg)
+      return &kv.second;
+  auto pipelineIt = passPipelineRegistry->find(arg);
+  if (pipelineIt != passPipelineRegistry->end())
+    return &pipelineIt->second;
+  return nullptr;
+}
+
+CompiledPassPipeline::CompiledPassPipeline(
+    ArrayRef<const PassRegistryEntry *> entries) {
+  builders.reserve(entries.size());
+  args.reserve(entries.size());
+  for (const auto *entry : entries) {
+    builders.push_back(entry->getPipelineBuilder());
+    args.push_back(entry->getPassArgument());
+  }
+}
+
+llvm::Optional<CompiledPassPipeline>
+CompiledPassPipeline::fromDescriptor(StringRef descriptor) {
+  CompiledPassPipeline pipeline;
+  SmallVector<StringRef, 8> entryArgs;
+  descriptor.split(entryArgs, ',', /*MaxSplit=*/-1, /*KeepEmpty=*/false);
+  for (auto arg : entryArgs) {
+    const auto *entry = lookupRegistryEntry(arg);
+    if (!entry)
+      return llvm::None;
+    pipeline.builders.push_back(entry->getPipelineBuilder());
+    pipeline.args.push_back(entry->getPassArgument());
+  }
+  return pipeline;
+}
+
+std::string CompiledPassPipeline::getDescriptor() const {
+  return llvm::join(args.begin(), args.end(), ",");
+}
+
+void CompiledPassPipeline::populate(PassManager &pm) const {
+  for (const auto &builder : builders)
+    builder(pm);
+}
+
 //===----------------------------------------------------------------------===//
 // PassNameParser
 //===----------------------------------------------------------------------===//
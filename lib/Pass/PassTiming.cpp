@@ -16,12 +16,15 @@
 // =============================================================================
 
 #include "PassDetail.h"
+#include "mlir/IR/Function.h"
 #include "mlir/Pass/PassManager.h"
 #include "llvm/ADT/MapVector.h"
 #include "llvm/ADT/SmallVector.h"
 #include "llvm/ADT/Statistic.h"
+#include "llvm/Support/FileSystem.h"
 #include "llvm/Support/Format.h"
 #include "llvm/Support/FormatVariadic.h"
+#include "llvm/Support/Mutex.h"
 #include "llvm/Support/Threading.h"
 #include <chrono>
 
@@ -386,6 +389,118 @@ void PassTiming::printResultsAsPipeline(raw_ostream &os, Timer *root,
     printTimer(0, topLevelTimer.second.get());
 }
 
+//===----------------------------------------------------------------------===//
+// PassTracing
+//===----------------------------------------------------------------------===//
+
+namespace {
+/// Instrumentation that streams one chrome://tracing complete event per pass
+/// and analysis execution to a JSON file. Unlike PassTiming, which aggregates
+/// durations, every execution is recorded individually with its thread id and
+/// the name of the function it ran on, so the trace viewer shows pipeline
+/// skew and idle threads of the asynchronous executors.
+struct PassTracing : public PassInstrumentation {
+  PassTracing(StringRef traceFilePath) {
+    std::error_code ec;
+    os.reset(new llvm::raw_fd_ostream(traceFilePath, ec, llvm::sys::fs::F_None));
+    if (ec) {
+      llvm::errs() << "could not open pass trace file " << traceFilePath
+                   << ": " << ec.message() << "\n";
+      os.reset();
+      return;
+    }
+    startTime = std::chrono::steady_clock::now();
+    *os << "[";
+  }
+
+  ~PassTracing() {
+    if (!os)
+      return;
+    *os << "\n]\n";
+    os->flush();
+  }
+
+  void runBeforePass(Pass *, const llvm::Any &) override { pushStartTime(); }
+  void runAfterPass(Pass *pass, const llvm::Any &ir) override {
+    StringRef name = isModuleToFunctionAdaptorPass(pass)
+                         ? StringRef("Function Pipeline")
+                         : pass->getName();
+    recordEvent(name, "pass", ir);
+  }
+  void runAfterPassFailed(Pass *pass, const llvm::Any &ir) override {
+    runAfterPass(pass, ir);
+  }
+  void runBeforeAnalysis(llvm::StringRef, AnalysisID *,
+                         const llvm::Any &) override {
+    pushStartTime();
+  }
+  void runAfterAnalysis(llvm::StringRef name, AnalysisID *,
+                        const llvm::Any &ir) override {
+    recordEvent(name, "analysis", ir);
+  }
+
+private:
+  /// Push the current time onto this thread's stack of pending events.
+  void pushStartTime() {
+    if (!os)
+      return;
+    auto now = std::chrono::steady_clock::now();
+    llvm::sys::SmartScopedLock<true> lock(mutex);
+    activeStartTimes[llvm::get_threadid()].push_back(now);
+  }
+
+  /// Pop this thread's pending start time and write a complete event covering
+  /// the elapsed interval.
+  void recordEvent(StringRef name, StringRef category, const llvm::Any &ir) {
+    if (!os)
+      return;
+    auto now = std::chrono::steady_clock::now();
+    auto tid = llvm::get_threadid();
+
+    // Resolve the function being transformed, if any, for attribution.
+    StringRef functionName;
+    if (auto *const *func = llvm::any_cast<Function *>(&ir))
+      functionName = (*func)->getName().strref();
+
+    llvm::sys::SmartScopedLock<true> lock(mutex);
+    auto &startTimes = activeStartTimes[tid];
+    assert(!startTimes.empty() && "expected pending trace event");
+    auto toMicros = [&](std::chrono::steady_clock::time_point point) {
+      return std::chrono::duration_cast<std::chrono::microseconds>(point -
+                                                                   startTime)
+          .count();
+    };
+    auto startUs = toMicros(startTimes.pop_back_val());
+    if (hasEvents)
+      *os << ",";
+    hasEvents = true;
+    *os << "\n{\"name\": \"" << name << "\", \"cat\": \"" << category
+        << "\", \"ph\": \"X\", \"ts\": " << startUs
+        << ", \"dur\": " << (toMicros(now) - startUs)
+        << ", \"pid\": 0, \"tid\": " << tid << ", \"args\": {\"function\": \""
+        << functionName << "\"}}";
+  }
+
+  /// The stream the trace is written to; null when the file could not be
+  /// opened.
+  std::unique_ptr<llvm::raw_fd_ostream> os;
+
+  /// The time origin all event timestamps are relative to.
+  std::chrono::steady_clock::time_point startTime;
+
+  /// Stacks of start times for the events currently open on each thread.
+  DenseMap<uint64_t, SmallVector<std::chrono::steady_clock::time_point, 4>>
+      activeStartTimes;
+
+  /// Whether an event was already emitted, to manage JSON separators.
+  bool hasEvents = false;
+
+  /// Guards the stream and the per-thread start time stacks; passes run
+  /// concurrently on the asynchronous executors.
+  llvm::sys::SmartMutex<true> mutex;
+};
+} // end anonymous namespace
+
 //===----------------------------------------------------------------------===//
 // PassManager
 //===----------------------------------------------------------------------===//
@@ -399,3 +514,9 @@ void PassManager::enableTiming(PassTimingDisplayMode displayMode) {
   addInstrumentation(new PassTiming(displayMode));
   passTiming = true;
 }
+
+/// Add an instrumentation that writes a chrome://tracing compatible JSON trace
+/// of all pass and analysis executions to `traceFilePath`.
+void PassManager::enableChromeTracing(StringRef traceFilePath) {
+  addInstrumentation(new PassTracing(traceFilePath));
+}
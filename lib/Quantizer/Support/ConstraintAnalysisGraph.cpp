@@ -19,11 +19,18 @@
 
 #include "mlir/IR/MLIRContext.h"
 #include "mlir/Quantizer/Support/Configuration.h"
+#include "llvm/Support/CommandLine.h"
+#include "llvm/Support/ThreadPool.h"
 #include "llvm/Support/raw_ostream.h"
 
 using namespace mlir;
 using namespace mlir::quantizer;
 
+static llvm::cl::opt<bool> clParallelCAGPropagation(
+    "mlir-parallel-quantizer-propagation", llvm::cl::init(false),
+    llvm::cl::desc("Solve independent connected components of the quantizer "
+                   "constraint analysis graph on multiple threads"));
+
 void CAGNode::replaceIncoming(CAGNode *otherNode) {
   if (this == otherNode)
     return;
@@ -142,6 +149,109 @@ unsigned CAGSlice::propagate(const TargetConfiguration &config) {
   return dirtyNodes.size();
 }
 
+bool CAGSlice::propagateComponentToFixpoint(const node_vector &component,
+                                            const TargetConfiguration &config,
+                                            unsigned maxRounds) {
+  std::vector<CAGNode *> dirtyNodes;
+  dirtyNodes.reserve(component.size());
+  for (unsigned round = 0; round != maxRounds; ++round) {
+    // Components are bucketed in nodeId order, so dirty nodes are visited in
+    // the same order as a whole-slice propagate() round and the result stays
+    // deterministic.
+    dirtyNodes.clear();
+    for (CAGNode *node : component) {
+      if (node->isDirty()) {
+        dirtyNodes.push_back(node);
+      }
+    }
+    if (dirtyNodes.empty()) {
+      return true;
+    }
+    for (auto dirtyNode : dirtyNodes) {
+      dirtyNode->clearDirty();
+      dirtyNode->propagate(context, config);
+    }
+  }
+  return false;
+}
+
+LogicalResult CAGSlice::propagateToFixpoint(const TargetConfiguration &config,
+                                            unsigned maxRounds) {
+  // Partition the slice into weakly-connected components with a union-find
+  // over the edges. Every incoming edge is some node's outgoing edge, so
+  // walking outgoing edges covers the whole edge set.
+  std::vector<unsigned> parent(allNodes.size());
+  for (unsigned i = 0, e = parent.size(); i != e; ++i)
+    parent[i] = i;
+  auto find = [&parent](unsigned id) -> unsigned {
+    while (parent[id] != id) {
+      parent[id] = parent[parent[id]];
+      id = parent[id];
+    }
+    return id;
+  };
+  for (CAGNode *node : allNodes) {
+    unsigned root = find(node->nodeId);
+    for (CAGNode *child : *node) {
+      unsigned childRoot = find(child->nodeId);
+      if (childRoot != root)
+        parent[childRoot] = root;
+    }
+  }
+
+  // Bucket nodes by component, in nodeId order within each component.
+  llvm::DenseMap<unsigned, unsigned> componentIndex;
+  std::vector<node_vector> components;
+  for (CAGNode *node : allNodes) {
+    unsigned root = find(node->nodeId);
+    auto insertion =
+        componentIndex.insert(std::make_pair(root, components.size()));
+    if (insertion.second)
+      components.push_back(node_vector());
+    components[insertion.first->second].push_back(node);
+  }
+
+  // Only components containing a dirty node need solving; the rest are
+  // already at fixpoint.
+  std::vector<node_vector *> dirtyComponents;
+  for (auto &component : components) {
+    for (CAGNode *node : component) {
+      if (node->isDirty()) {
+        dirtyComponents.push_back(&component);
+        break;
+      }
+    }
+  }
+
+  // Solve each dirty component to fixpoint. Components share no nodes and
+  // propagation only creates uniqued types/attributes through the context,
+  // which is thread-safe, so independent components can be solved
+  // concurrently when requested.
+  std::vector<char> converged(dirtyComponents.size(), 1);
+  if (clParallelCAGPropagation && dirtyComponents.size() > 1) {
+    llvm::ThreadPool pool;
+    for (unsigned i = 0, e = dirtyComponents.size(); i != e; ++i) {
+      node_vector *component = dirtyComponents[i];
+      char *convergedFlag = &converged[i];
+      pool.async([this, &config, component, convergedFlag, maxRounds] {
+        *convergedFlag =
+            propagateComponentToFixpoint(*component, config, maxRounds);
+      });
+    }
+    pool.wait();
+  } else {
+    for (unsigned i = 0, e = dirtyComponents.size(); i != e; ++i)
+      converged[i] =
+          propagateComponentToFixpoint(*dirtyComponents[i], config, maxRounds);
+  }
+
+  for (char componentConverged : converged) {
+    if (!componentConverged)
+      return failure();
+  }
+  return success();
+}
+
 void CAGAnchorNode::propagate(SolverContext &solverContext,
                               const TargetConfiguration &config) {
   for (CAGNode *child : *this) {
@@ -19,30 +19,66 @@
 
 #include "mlir/IR/Attributes.h"
 #include "mlir/IR/StandardTypes.h"
+#include "llvm/ADT/APFloat.h"
 #include "llvm/Support/raw_ostream.h"
 
 using namespace mlir;
 using namespace mlir::quantizer;
 
+/// Converts an arbitrary-semantics APFloat element to double.
+static double convertFloatToDouble(APFloat value) {
+  bool losesInfo = false;
+  value.convert(APFloat::IEEEdouble(), APFloat::rmNearestTiesToEven,
+                &losesInfo);
+  return value.convertToDouble();
+}
+
 //===----------------------------------------------------------------------===//
-// AttributeTensorStatistics implementation
+// TensorStatisticsAccumulator implementation
 //===----------------------------------------------------------------------===//
 
-static void
-collectElementsStatisticsDim(ElementsAttr attr, unsigned numElements,
-                             ArrayRef<int64_t> shape,
-                             llvm::SmallVector<uint64_t, 4> &indices,
-                             uint64_t dim, TensorAxisStatistics &statistics) {
-  // Recursive terminating condition.
-  if (dim >= shape.size())
+void TensorStatisticsAccumulator::observe(double value) {
+  ++sampleSize;
+  minValue = std::min(minValue, value);
+  maxValue = std::max(maxValue, value);
+  double delta = value - mean;
+  mean += delta / sampleSize;
+  m2 += delta * (value - mean);
+}
+
+void TensorStatisticsAccumulator::observe(ArrayRef<float> values) {
+  for (float value : values)
+    observe(static_cast<double>(value));
+}
+
+void TensorStatisticsAccumulator::observe(ArrayRef<double> values) {
+  for (double value : values)
+    observe(value);
+}
+
+void TensorStatisticsAccumulator::observeSplat(double value, int64_t count) {
+  if (count <= 0)
     return;
+  // Equivalent to merging an accumulator holding `count` samples of `value`
+  // (which has zero squared deviation).
+  TensorStatisticsAccumulator splat;
+  splat.sampleSize = count;
+  splat.minValue = splat.maxValue = value;
+  splat.mean = value;
+  merge(splat);
+}
 
+/// Recursively walks the index space of a (non-dense) elements attribute,
+/// feeding each element to the accumulator.
+static void observeElementsDim(ElementsAttr attr, ArrayRef<int64_t> shape,
+                               llvm::SmallVector<uint64_t, 4> &indices,
+                               uint64_t dim,
+                               TensorStatisticsAccumulator &accumulator) {
   if (dim < (shape.size() - 1)) {
     // Recurse past dim.
     for (uint64_t i = 0, s = shape[dim]; i < s; ++i) {
       indices[dim] = i;
-      collectElementsStatisticsDim(attr, numElements, shape, indices, dim + 1,
-                                   statistics);
+      observeElementsDim(attr, shape, indices, dim + 1, accumulator);
     }
     return;
   }
@@ -50,50 +86,95 @@ collectElementsStatisticsDim(ElementsAttr attr, unsigned numElements,
   // Collection dim.
   for (uint64_t i = 0, s = shape[dim]; i < s; ++i) {
     indices[dim] = i;
-    double value = attr.getValue(llvm::makeArrayRef(indices))
-                       .cast<FloatAttr>()
-                       .getValueAsDouble();
-    statistics.minValue = std::min(statistics.minValue, value);
-    statistics.maxValue = std::max(statistics.maxValue, value);
-    statistics.mean += value / numElements;
-    // TODO: Calculate a running variance.
+    accumulator.observe(attr.getValue(llvm::makeArrayRef(indices))
+                            .cast<FloatAttr>()
+                            .getValueAsDouble());
   }
 }
 
-static bool getElementsStatistics(ElementsAttr attr,
-                                  TensorAxisStatistics &statistics) {
-  statistics.clear();
-  statistics.minValue = std::numeric_limits<double>::infinity();
-  statistics.maxValue = -std::numeric_limits<double>::infinity();
+bool TensorStatisticsAccumulator::observe(Attribute attr) {
+  if (FloatAttr floatAttr = attr.dyn_cast<FloatAttr>()) {
+    observe(floatAttr.getValueAsDouble());
+    return true;
+  }
 
-  ShapedType sType = attr.getType();
-  if (!sType.hasStaticShape())
+  auto eltAttr = attr.dyn_cast<ElementsAttr>();
+  if (!eltAttr)
     return false;
-  Type elementTy = sType.getElementType();
-  if (!elementTy.isa<FloatType>())
+  ShapedType sType = eltAttr.getType();
+  if (!sType.hasStaticShape() || !sType.getElementType().isa<FloatType>())
     return false;
 
+  if (auto denseAttr = attr.dyn_cast<DenseFPElementsAttr>()) {
+    if (denseAttr.isSplat()) {
+      observeSplat(
+          denseAttr.getSplatValue().cast<FloatAttr>().getValueAsDouble(),
+          sType.getNumElements());
+      return true;
+    }
+    // Read standard widths directly out of the raw data; other float types
+    // go through APFloat conversion.
+    if (sType.getElementType().isF32()) {
+      observe(denseAttr.getValues<float>());
+      return true;
+    }
+    if (sType.getElementType().isF64()) {
+      observe(denseAttr.getValues<double>());
+      return true;
+    }
+    for (APFloat value : denseAttr.getFloatValues())
+      observe(convertFloatToDouble(value));
+    return true;
+  }
+
+  if (sType.getRank() == 0) {
+    observe(eltAttr.getValue({}).cast<FloatAttr>().getValueAsDouble());
+    return true;
+  }
   llvm::SmallVector<uint64_t, 4> indices;
   indices.resize(sType.getRank());
-  ArrayRef<int64_t> shape = sType.getShape();
+  observeElementsDim(eltAttr, sType.getShape(), indices, 0, *this);
+  return true;
+}
 
-  auto numElements = sType.getNumElements();
-  collectElementsStatisticsDim(attr, numElements, shape, indices, 0,
-                               statistics);
-  statistics.sampleSize = numElements;
+void TensorStatisticsAccumulator::merge(
+    const TensorStatisticsAccumulator &other) {
+  if (other.sampleSize == 0)
+    return;
+  if (sampleSize == 0) {
+    *this = other;
+    return;
+  }
+  // Chan et al. parallel merge of mean and squared deviations.
+  int64_t combinedSize = sampleSize + other.sampleSize;
+  double delta = other.mean - mean;
+  mean += delta * other.sampleSize / combinedSize;
+  m2 += other.m2 +
+        delta * delta * sampleSize * other.sampleSize / combinedSize;
+  minValue = std::min(minValue, other.minValue);
+  maxValue = std::max(maxValue, other.maxValue);
+  sampleSize = combinedSize;
+}
 
+bool TensorStatisticsAccumulator::get(TensorAxisStatistics &stats) const {
+  if (sampleSize == 0) {
+    stats.clear();
+    return false;
+  }
+  stats = TensorAxisStatistics(sampleSize, minValue, maxValue, mean,
+                               m2 / sampleSize);
   return true;
 }
 
+//===----------------------------------------------------------------------===//
+// AttributeTensorStatistics implementation
+//===----------------------------------------------------------------------===//
+
 bool AttributeTensorStatistics::get(TensorAxisStatistics &stats) const {
-  if (FloatAttr floatAttr = attr.dyn_cast<FloatAttr>()) {
-    double value = floatAttr.getValueAsDouble();
-    stats = TensorAxisStatistics(1, value, value, value, 0);
-    return true;
-  } else if (auto eltAttr = attr.dyn_cast<ElementsAttr>()) {
-    return getElementsStatistics(eltAttr, stats);
-  }
-  return false;
+  TensorStatisticsAccumulator accumulator;
+  if (!accumulator.observe(attr))
+    return false;
+  return accumulator.get(stats);
 }
 
 namespace mlir {
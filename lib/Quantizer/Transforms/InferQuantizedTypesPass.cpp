@@ -101,8 +101,8 @@ private:
 
 } // end anonymous namespace
 
-/// Maximum number of propagation rounds to run to converge the CAG before
-/// signalling an error.
+/// Maximum number of propagation rounds to run to converge each connected
+/// component of the CAG before signalling an error.
 static const int kMaximumPropagationRounds = 1000;
 
 static LogicalResult validateTypeConversion(Type newType, Type origType,
@@ -134,14 +134,9 @@ void InferQuantizedTypesPass::runWithConfig(SolverContext &solverContext,
   }
   config.finalizeAnchors(cag);
 
-  // Propagate.
-  int propRound;
-  for (propRound = kMaximumPropagationRounds; propRound > 0; --propRound) {
-    auto propCount = cag.propagate(config);
-    if (propCount == 0)
-      break;
-  }
-  if (propRound == 0) {
+  // Propagate. Each weakly-connected component of the CAG is solved to
+  // fixpoint independently.
+  if (failed(cag.propagateToFixpoint(config, kMaximumPropagationRounds))) {
     emitError(UnknownLoc::get(&getContext()),
               "exceeded maximum number of solver iterations (infinite loop?)");
     return;
@@ -302,9 +302,12 @@ SDBM SDBM::get(ArrayRef<SDBMExpr> inequalities, ArrayRef<SDBMExpr> equalities) {
   // TODO(zinenko): we may want to reconsider this once we have canonicalization
   // or simplification in place
   auto updateMatrix = [](SDBM &sdbm, const SDBMBuilderResult &r) {
-    for (auto positivePos : r.positivePos) {
-      for (auto negativePos : r.negativePos) {
-        auto &m = sdbm.at(negativePos, positivePos);
+    for (auto negativePos : r.negativePos) {
+      // Hoist the row base address out of the inner loop so the cross product
+      // of positions updates a row in one sweep.
+      IntInfty *row = &sdbm.at(negativePos, 0);
+      for (auto positivePos : r.positivePos) {
+        auto &m = row[positivePos];
         m = m < -r.value ? m : -r.value;
       }
     }
@@ -347,6 +350,34 @@ SDBM SDBM::get(ArrayRef<SDBMExpr> inequalities, ArrayRef<SDBMExpr> equalities) {
   return result;
 }
 
+void SDBM::closure() {
+  unsigned n = getNumVariables();
+  for (unsigned k = 0; k < n; ++k) {
+    IntInfty *rowK = &at(k, 0);
+    for (unsigned i = 0; i < n; ++i) {
+      // If the path from i to k is unconstrained, it cannot tighten any bound
+      // through k; skip the whole row.
+      IntInfty ik = at(i, k);
+      if (!ik.isFinite())
+        continue;
+      int64_t ikValue = ik.getValue();
+      // Walk the rows contiguously with the infinity checks reduced to simple
+      // integer compares so the inner loop stays branch-light and amenable to
+      // vectorization; the matrices are small enough that further tiling does
+      // not pay off.
+      IntInfty *rowI = &at(i, 0);
+      for (unsigned j = 0; j < n; ++j) {
+        IntInfty kj = rowK[j];
+        if (!kj.isFinite())
+          continue;
+        int64_t candidate = ikValue + kj.getValue();
+        if (candidate < rowI[j].getValue())
+          rowI[j] = candidate;
+      }
+    }
+  }
+}
+
 // Given a row and a column position in the square DBM, insert one equality
 // or up to two inequalities that correspond the entries (col, row) and (row,
 // col) in the DBM.  `rowExpr` and `colExpr` contain the expressions such that
@@ -17,4 +17,27 @@
 
 #include "mlir/SDBM/SDBMDialect.h"
 
+#include "llvm/Support/Compiler.h"
+
+using namespace mlir;
+
 static mlir::DialectRegistration<mlir::SDBMDialect> SDBMDialect;
+
+/// The uniquing arena installed by the innermost SDBMLocalUniquingScope
+/// active on the current thread, if any.
+static LLVM_THREAD_LOCAL StorageUniquer *localSDBMUniquer = nullptr;
+
+StorageUniquer &mlir::SDBMDialect::getUniquer() {
+  if (StorageUniquer *local = localSDBMUniquer)
+    return *local;
+  return uniquer;
+}
+
+SDBMLocalUniquingScope::SDBMLocalUniquingScope()
+    : previousUniquer(localSDBMUniquer) {
+  localSDBMUniquer = &arena;
+}
+
+SDBMLocalUniquingScope::~SDBMLocalUniquingScope() {
+  localSDBMUniquer = previousUniquer;
+}
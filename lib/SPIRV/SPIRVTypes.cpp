@@ -20,6 +20,7 @@
 //===----------------------------------------------------------------------===//
 
 #include "mlir/SPIRV/SPIRVTypes.h"
+#include "mlir/IR/StandardTypes.h"
 #include "llvm/ADT/StringSwitch.h"
 
 using namespace mlir;
@@ -32,6 +33,22 @@ using namespace mlir::spirv;
 // ArrayType
 //===----------------------------------------------------------------------===//
 
+/// Returns the number of bytes the given type occupies assuming tight scalar
+/// packing, or -1 if the type has no static size. Array sizes are served from
+/// the cache on their uniqued storage, so nested arrays do not recompute the
+/// layout of their elements.
+static int64_t getTypeSizeInBytes(Type type) {
+  if (type.isIntOrFloat())
+    return (type.getIntOrFloatBitWidth() + 7) / 8;
+  if (auto vectorType = type.dyn_cast<VectorType>()) {
+    auto elementSize = getTypeSizeInBytes(vectorType.getElementType());
+    return elementSize < 0 ? -1 : vectorType.getNumElements() * elementSize;
+  }
+  if (auto arrayType = type.dyn_cast<ArrayType>())
+    return arrayType.getSizeInBytes();
+  return -1;
+}
+
 struct spirv::detail::ArrayTypeStorage : public TypeStorage {
   using KeyTy = std::pair<Type, int64_t>;
 
@@ -45,10 +62,16 @@ struct spirv::detail::ArrayTypeStorage : public TypeStorage {
   }
 
   ArrayTypeStorage(const KeyTy &key)
-      : elementType(key.first), elementCount(key.second) {}
+      : elementType(key.first), elementCount(key.second) {
+    // Compute the array size once at uniquing time; all later queries are
+    // then constant-time, including for arrays of arrays.
+    auto elementSize = getTypeSizeInBytes(elementType);
+    sizeInBytes = elementSize < 0 ? -1 : elementCount * elementSize;
+  }
 
   Type elementType;
   int64_t elementCount;
+  int64_t sizeInBytes;
 };
 
 ArrayType ArrayType::get(Type elementType, int64_t elementCount) {
@@ -60,6 +83,8 @@ Type ArrayType::getElementType() { return getImpl()->elementType; }
 
 int64_t ArrayType::getElementCount() { return getImpl()->elementCount; }
 
+int64_t ArrayType::getSizeInBytes() { return getImpl()->sizeInBytes; }
+
 //===----------------------------------------------------------------------===//
 // ImageType
 //===----------------------------------------------------------------------===//
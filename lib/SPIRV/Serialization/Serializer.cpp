@@ -25,6 +25,7 @@
 #include "mlir/SPIRV/SPIRVOps.h"
 #include "mlir/SPIRV/SPIRVTypes.h"
 #include "mlir/Support/LogicalResult.h"
+#include "llvm/ADT/DenseMap.h"
 #include "llvm/ADT/SmallVector.h"
 
 using namespace mlir;
@@ -65,12 +66,46 @@ private:
 
   void processMemoryModel();
 
+  /// Consumes the next unused result <id>.
+  uint32_t getNextID() { return nextID++; }
+
+  /// Returns the result <id> previously assigned to `type`, or 0 if it has
+  /// none yet. 0 is never a valid SPIR-V result <id>.
+  uint32_t findTypeID(Type type) const { return typeIDMap.lookup(type); }
+
+  /// Assigns a fresh result <id> to `type` and returns it. The interning
+  /// keeps <id> lookup a hash table probe instead of a scan over the
+  /// types-and-constants section.
+  uint32_t assignTypeID(Type type) {
+    assert(!typeIDMap.count(type) && "type already has an <id>");
+    return typeIDMap[type] = getNextID();
+  }
+
+  /// Returns the result <id> previously assigned to the constant `value`, or
+  /// 0 if it has none yet.
+  uint32_t findConstantID(Attribute value) const {
+    return constIDMap.lookup(value);
+  }
+
+  /// Assigns a fresh result <id> to the constant `value` and returns it.
+  uint32_t assignConstantID(Attribute value) {
+    assert(!constIDMap.count(value) && "constant already has an <id>");
+    return constIDMap[value] = getNextID();
+  }
+
 private:
   /// The SPIR-V module to be serialized.
   spirv::ModuleOp module;
 
-  /// The next available result <id>.
-  uint32_t nextID = 0;
+  /// The next available result <id>. <id>s are 1-based; the module header
+  /// advertises this value as the <id> bound.
+  uint32_t nextID = 1;
+
+  /// Result <id>s already assigned to serialized types and constants. Both
+  /// are uniqued in the binary, so each is emitted once and every later use
+  /// resolves to its <id> through these maps.
+  DenseMap<Type, uint32_t> typeIDMap;
+  DenseMap<Attribute, uint32_t> constIDMap;
 
   // The following are for different SPIR-V instruction sections. They follow
   // the logical layout of a SPIR-V module.
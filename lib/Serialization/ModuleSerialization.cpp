@@ -0,0 +1,297 @@
+//===- ModuleSerialization.cpp - Binary module container format -----------===//
+//
+// Copyright 2019 The MLIR Authors.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+// =============================================================================
+//
+// This file implements the binary module container format:
+//
+//   magic:     the 8 bytes "MLIRBIN\x01", the last byte being the version.
+//   numFuncs:  ULEB128 count of function records.
+//   records:   numFuncs records, each a ULEB128 byte length followed by the
+//              function in its textual form and a nul terminator.
+//
+// Storing each function as an independent nul-terminated record lets a
+// reader memory-map the container and materialize individual functions
+// without touching (or re-lexing) the rest of the module.
+//
+//===----------------------------------------------------------------------===//
+
+#include "mlir/Serialization.h"
+#include "mlir/IR/Diagnostics.h"
+#include "mlir/IR/Function.h"
+#include "mlir/IR/Identifier.h"
+#include "mlir/IR/Location.h"
+#include "mlir/IR/Module.h"
+#include "mlir/Parser.h"
+#include "mlir/Support/FileUtilities.h"
+#include "mlir/Support/LogicalResult.h"
+#include "mlir/Translation.h"
+#include "llvm/ADT/SmallString.h"
+#include "llvm/Support/LEB128.h"
+#include "llvm/Support/MemoryBuffer.h"
+#include "llvm/Support/SourceMgr.h"
+#include "llvm/Support/ToolOutputFile.h"
+#include "llvm/Support/raw_ostream.h"
+
+using namespace mlir;
+
+/// The magic number prefixing every binary module container, including the
+/// format version as the final byte.
+static const char binaryModuleMagic[] = "MLIRBIN\x01";
+static const size_t binaryModuleMagicSize = 8;
+
+//===----------------------------------------------------------------------===//
+// Writer
+//===----------------------------------------------------------------------===//
+
+void mlir::writeBinaryModule(Module *module, llvm::raw_ostream &os) {
+  os.write(binaryModuleMagic, binaryModuleMagicSize);
+  llvm::encodeULEB128(
+      std::distance(module->getFunctions().begin(), module->getFunctions().end()),
+      os);
+
+  // Emit each function as a length-prefixed, nul-terminated record. The
+  // functions are printed individually so that each record is self-contained.
+  SmallString<512> record;
+  for (Function &fn : *module) {
+    record.clear();
+    llvm::raw_svector_ostream recordOS(record);
+    fn.print(recordOS);
+    llvm::encodeULEB128(record.size(), os);
+    os << record << '\0';
+  }
+}
+
+//===----------------------------------------------------------------------===//
+// Reader
+//===----------------------------------------------------------------------===//
+
+bool mlir::isBinaryModuleBuffer(StringRef buffer) {
+  return buffer.size() >= binaryModuleMagicSize &&
+         buffer.startswith(StringRef(binaryModuleMagic, binaryModuleMagicSize));
+}
+
+/// Emit an error for a structurally malformed container.
+static Module *emitMalformedError(MLIRContext *context, const Twine &message) {
+  emitError(UnknownLoc::get(context), "malformed binary module: ") << message;
+  return nullptr;
+}
+
+/// Find the byte offset of the opening brace of the function body within the
+/// textual record, skipping string literals and comments. Returns npos for a
+/// record holding an external function declaration. The body brace is the
+/// last top-level brace group in the record; an 'attributes' dictionary
+/// opens and closes before it.
+static size_t findBodyStart(StringRef record) {
+  size_t bodyStart = StringRef::npos;
+  unsigned braceDepth = 0;
+  for (size_t i = 0, e = record.size(); i != e; ++i) {
+    switch (record[i]) {
+    case '{':
+      if (braceDepth == 0)
+        bodyStart = i;
+      ++braceDepth;
+      break;
+    case '}':
+      if (braceDepth != 0)
+        --braceDepth;
+      break;
+    case '"':
+      // Skip over the string literal.
+      for (++i; i != e && record[i] != '"'; ++i)
+        if (record[i] == '\\')
+          ++i;
+      break;
+    case '/':
+      // Skip over a line comment.
+      if (i + 1 != e && record[i + 1] == '/') {
+        i = record.find('\n', i);
+        if (i == StringRef::npos)
+          return bodyStart;
+      }
+      break;
+    default:
+      break;
+    }
+  }
+  return bodyStart;
+}
+
+/// Parse the given textual record as a standalone module and move its
+/// functions into 'functions', diagnosing redefinitions. The record must be
+/// nul-terminated at record.end().
+static LogicalResult parseRecordInto(StringRef record, StringRef name,
+                                     Module::FunctionListType &functions,
+                                     MLIRContext *context) {
+  llvm::SourceMgr sourceMgr;
+  sourceMgr.AddNewSourceBuffer(llvm::MemoryBuffer::getMemBuffer(record, name),
+                               llvm::SMLoc());
+  std::unique_ptr<Module> recordModule(parseSourceFile(sourceMgr, context));
+  if (!recordModule)
+    return failure();
+
+  // Move the parsed functions over. The symbol table renames on conflict,
+  // so a changed name signals a function redefinition.
+  auto &recordFunctions = recordModule->getFunctions();
+  while (!recordFunctions.empty()) {
+    Function &fn = recordFunctions.front();
+    Identifier fnName = fn.getName();
+    functions.splice(functions.end(), recordFunctions,
+                     recordFunctions.begin());
+    if (fn.getName() != fnName) {
+      emitError(fn.getLoc(), "redefinition of function named '")
+          << fnName.strref() << "'";
+      return failure();
+    }
+  }
+  return success();
+}
+
+/// Implementation of the container reader. When 'lazyBuffer' is non-null,
+/// only function signatures are parsed eagerly and bodies are materialized
+/// from the shared buffer on first access.
+static Module *
+parseBinaryBufferImpl(StringRef buffer, MLIRContext *context,
+                      const std::shared_ptr<llvm::MemoryBuffer> *lazyBuffer) {
+  if (!isBinaryModuleBuffer(buffer))
+    return emitMalformedError(context, "bad magic number");
+
+  const auto *ptr =
+      reinterpret_cast<const uint8_t *>(buffer.data()) + binaryModuleMagicSize;
+  const auto *end = reinterpret_cast<const uint8_t *>(buffer.end());
+  const char *error = nullptr;
+  unsigned numRead = 0;
+
+  uint64_t numFunctions = llvm::decodeULEB128(ptr, &numRead, end, &error);
+  if (error)
+    return emitMalformedError(context, "truncated function count");
+  ptr += numRead;
+
+  std::unique_ptr<Module> module(new Module(context));
+  auto &functions = module->getFunctions();
+  for (uint64_t i = 0; i != numFunctions; ++i) {
+    uint64_t length = llvm::decodeULEB128(ptr, &numRead, end, &error);
+    if (error)
+      return emitMalformedError(context, "truncated record length");
+    ptr += numRead;
+
+    // Each record must be followed by its nul terminator, which lets the
+    // lexer run directly over the memory-mapped record. The comparison leaves
+    // room for the terminator without an addition that could overflow on a
+    // crafted length.
+    if (length >= uint64_t(end - ptr) || ptr[length] != '\0')
+      return emitMalformedError(context, "truncated function record");
+    StringRef record(reinterpret_cast<const char *>(ptr), length);
+    ptr += length + 1;
+
+    size_t bodyStart = lazyBuffer ? findBodyStart(record) : StringRef::npos;
+    if (!lazyBuffer || bodyStart == StringRef::npos) {
+      // Eager mode, or an external declaration: parse the whole record.
+      if (failed(parseRecordInto(record, "<binary module record>", functions,
+                                 context)))
+        return nullptr;
+      continue;
+    }
+
+    // Lazy mode: parse only the signature as an external declaration now.
+    // The copy restores the nul terminator the parser requires.
+    std::string signature = record.take_front(bodyStart).rtrim().str();
+    size_t numFunctionsBefore =
+        std::distance(functions.begin(), functions.end());
+    if (failed(parseRecordInto(signature, "<binary module record>", functions,
+                               context)))
+      return nullptr;
+    if (std::distance(functions.begin(), functions.end()) !=
+        numFunctionsBefore + 1)
+      return emitMalformedError(context, "expected one function per record");
+
+    // Hook the unparsed body range up to the new declaration; it is parsed
+    // from the shared buffer when the function is first visited.
+    std::shared_ptr<llvm::MemoryBuffer> sharedBuffer = *lazyBuffer;
+    functions.back().setLazyBodySource([sharedBuffer, record](Function *fn) {
+      MLIRContext *context = fn->getContext();
+      // Parse into a temporary module and steal the body of the parsed
+      // definition; the signature is already in place on 'fn'.
+      Module tempModule(context);
+      if (failed(parseRecordInto(record, "<lazy function body>",
+                                 tempModule.getFunctions(), context)) ||
+          tempModule.getFunctions().empty()) {
+        emitError(fn->getLoc(), "failed to materialize lazy function body");
+        return;
+      }
+      fn->getBody().takeBody(tempModule.getFunctions().front().getBody());
+    });
+  }
+
+  if (ptr != end)
+    return emitMalformedError(context, "trailing bytes after last record");
+  return module.release();
+}
+
+Module *mlir::parseBinaryBuffer(StringRef buffer, MLIRContext *context) {
+  return parseBinaryBufferImpl(buffer, context, /*lazyBuffer=*/nullptr);
+}
+
+Module *mlir::parseBinaryBufferLazily(std::unique_ptr<llvm::MemoryBuffer> buffer,
+                                      MLIRContext *context) {
+  std::shared_ptr<llvm::MemoryBuffer> sharedBuffer = std::move(buffer);
+  return parseBinaryBufferImpl(sharedBuffer->getBuffer(), context,
+                               &sharedBuffer);
+}
+
+Module *mlir::parseBinaryFileLazily(StringRef filename, MLIRContext *context) {
+  std::string errorMessage;
+  auto file = openInputFile(filename, &errorMessage);
+  if (!file) {
+    emitError(UnknownLoc::get(context)) << errorMessage;
+    return nullptr;
+  }
+  return parseBinaryBufferLazily(std::move(file), context);
+}
+
+Module *mlir::parseBinaryFile(StringRef filename, MLIRContext *context) {
+  std::string errorMessage;
+  auto file = openInputFile(filename, &errorMessage);
+  if (!file) {
+    emitError(UnknownLoc::get(context)) << errorMessage;
+    return nullptr;
+  }
+  // Keep the buffer alive for the duration of the parse; the records are
+  // copied into the context/IR as they are materialized.
+  return parseBinaryBuffer(file->getBuffer(), context);
+}
+
+//===----------------------------------------------------------------------===//
+// Translation registration
+//===----------------------------------------------------------------------===//
+
+static TranslateFromMLIRRegistration
+    serializeRegistration("mlir-to-bin", [](Module *module,
+                                            StringRef outputFilename) {
+      if (!module)
+        return true;
+      auto file = openOutputFile(outputFilename);
+      if (!file)
+        return true;
+      writeBinaryModule(module, file->os());
+      file->keep();
+      return false;
+    });
+
+static TranslateToMLIRRegistration
+    deserializeRegistration("bin-to-mlir", [](StringRef inputFilename,
+                                              MLIRContext *context) {
+      return std::unique_ptr<Module>(parseBinaryFile(inputFilename, context));
+    });
@@ -30,6 +30,7 @@
 #include "mlir/Support/STLExtras.h"
 #include "llvm/ADT/StringSwitch.h"
 #include "llvm/Support/FormatVariadic.h"
+#include "llvm/Support/MathExtras.h"
 #include "llvm/Support/raw_ostream.h"
 using namespace mlir;
 
@@ -79,12 +80,93 @@ template <typename T> static LogicalResult verifyCastOp(T op) {
   return success();
 }
 
+namespace {
+/// Elementwise arithmetic functors used for the bulk dense folding kernels; a
+/// templated call operator lets one functor cover every registered element
+/// width.
+struct FoldAdd {
+  template <typename T> T operator()(T a, T b) const { return a + b; }
+};
+struct FoldSub {
+  template <typename T> T operator()(T a, T b) const { return a - b; }
+};
+struct FoldMul {
+  template <typename T> T operator()(T a, T b) const { return a * b; }
+};
+struct FoldAnd {
+  template <typename T> T operator()(T a, T b) const { return a & b; }
+};
+struct FoldOr {
+  template <typename T> T operator()(T a, T b) const { return a | b; }
+};
+struct FoldXor {
+  template <typename T> T operator()(T a, T b) const { return a ^ b; }
+};
+} // end anonymous namespace
+
+/// Builds a bulk folding kernel that applies `fn` to buffers of T. The loop
+/// runs over contiguous native host values, so it compiles down to a
+/// vectorized pass over the raw data instead of an APInt/APFloat round-trip
+/// per element.
+template <typename T, typename BinaryFn>
+static DialectDenseFoldKernel makeDenseFoldKernel(BinaryFn fn) {
+  return [fn](ArrayRef<char> lhs, ArrayRef<char> rhs,
+              MutableArrayRef<char> result) {
+    auto *lhsData = reinterpret_cast<const T *>(lhs.data());
+    auto *rhsData = reinterpret_cast<const T *>(rhs.data());
+    auto *resultData = reinterpret_cast<T *>(result.data());
+    for (size_t i = 0, e = result.size() / sizeof(T); i != e; ++i)
+      resultData[i] = fn(lhsData[i], rhsData[i]);
+  };
+}
+
+/// Registers bulk folding kernels for a pointwise float operation on f32 and
+/// f64 constants.
+template <typename BinaryFn>
+static void addDenseFPFoldKernels(StandardOpsDialect *dialect,
+                                  StringRef opName, BinaryFn fn) {
+  auto *context = dialect->getContext();
+  dialect->addDenseFoldKernel(opName, FloatType::getF32(context),
+                              makeDenseFoldKernel<float>(fn));
+  dialect->addDenseFoldKernel(opName, FloatType::getF64(context),
+                              makeDenseFoldKernel<double>(fn));
+}
+
+/// Integer flavor of the above. Unsigned host types wrap on overflow,
+/// matching APInt's two's complement semantics.
+template <typename BinaryFn>
+static void addDenseIntFoldKernels(StandardOpsDialect *dialect,
+                                   StringRef opName, BinaryFn fn) {
+  auto *context = dialect->getContext();
+  dialect->addDenseFoldKernel(opName, IntegerType::get(8, context),
+                              makeDenseFoldKernel<uint8_t>(fn));
+  dialect->addDenseFoldKernel(opName, IntegerType::get(16, context),
+                              makeDenseFoldKernel<uint16_t>(fn));
+  dialect->addDenseFoldKernel(opName, IntegerType::get(32, context),
+                              makeDenseFoldKernel<uint32_t>(fn));
+  dialect->addDenseFoldKernel(opName, IntegerType::get(64, context),
+                              makeDenseFoldKernel<uint64_t>(fn));
+}
+
 StandardOpsDialect::StandardOpsDialect(MLIRContext *context)
     : Dialect(getDialectNamespace(), context) {
   addOperations<DmaStartOp, DmaWaitOp,
 #define GET_OP_LIST
 #include "mlir/StandardOps/Ops.cpp.inc"
                 >();
+
+  // Bulk folding kernels for the pointwise arithmetic operations: pairs of
+  // non-splat dense elements constants fold in one pass over their raw data.
+  // Splats and scalars keep going through the elementwise fold hooks.
+  addDenseFPFoldKernels(this, "std.addf", FoldAdd());
+  addDenseFPFoldKernels(this, "std.subf", FoldSub());
+  addDenseFPFoldKernels(this, "std.mulf", FoldMul());
+  addDenseIntFoldKernels(this, "std.addi", FoldAdd());
+  addDenseIntFoldKernels(this, "std.subi", FoldSub());
+  addDenseIntFoldKernels(this, "std.muli", FoldMul());
+  addDenseIntFoldKernels(this, "std.and", FoldAnd());
+  addDenseIntFoldKernels(this, "std.or", FoldOr());
+  addDenseIntFoldKernels(this, "std.xor", FoldXor());
 }
 
 void mlir::printDimAndSymbolList(Operation::operand_iterator begin,
@@ -286,6 +368,14 @@ static LogicalResult verify(AllocOp op) {
   for (auto operandType : op.getOperandTypes())
     if (!operandType.isIndex())
       return op.emitOpError("requires operands to be of type Index");
+
+  // Verify the optional requested alignment.
+  if (auto alignAttr = op.getAttr(AllocOp::getAlignmentAttrName())) {
+    auto align = alignAttr.dyn_cast<IntegerAttr>();
+    if (!align || align.getValue().getZExtValue() == 0 ||
+        !llvm::isPowerOf2_64(align.getValue().getZExtValue()))
+      return op.emitOpError("alignment must be a positive power of two");
+  }
   return success();
 }
 
@@ -1767,6 +1857,126 @@ OpFoldResult MulIOp::fold(ArrayRef<Attribute> operands) {
                                         [](APInt a, APInt b) { return a * b; });
 }
 
+//===----------------------------------------------------------------------===//
+// ParallelCallOp
+//===----------------------------------------------------------------------===//
+
+static ParseResult parseParallelCallOp(OpAsmParser *parser,
+                                       OperationState *result) {
+  FunctionAttr calleeAttr;
+  FunctionType calleeType;
+  SmallVector<OpAsmParser::OperandType, 4> operands;
+  auto calleeLoc = parser->getNameLoc();
+  if (parser->parseAttribute(calleeAttr, "callee", result->attributes) ||
+      parser->parseOperandList(operands, OpAsmParser::Delimiter::Paren) ||
+      parser->parseOptionalAttributeDict(result->attributes) ||
+      parser->parseColonType(calleeType) ||
+      parser->resolveOperands(operands, calleeType.getInputs(), calleeLoc,
+                              result->operands))
+    return failure();
+
+  return success();
+}
+
+static void print(OpAsmPrinter *p, ParallelCallOp op) {
+  *p << "parallel_call " << op.getAttr("callee") << '(';
+  p->printOperands(op.getOperands());
+  *p << ')';
+  p->printOptionalAttrDict(op.getAttrs(), /*elidedAttrs=*/{"callee"});
+  *p << " : ";
+  SmallVector<Type, 8> argTypes(op.getOperandTypes());
+  p->printType(FunctionType::get(argTypes, {}, op.getContext()));
+}
+
+// Returns true if 'type' can be forwarded to a parallel callee through a
+// word-sized register: 'index', integers of at most 64 bits, and statically
+// shaped default-layout memrefs (which lower to a bare data pointer).
+static bool isValidParallelCallOperandType(Type type) {
+  if (type.isIndex())
+    return true;
+  if (auto intType = type.dyn_cast<IntegerType>())
+    return intType.getWidth() <= 64;
+  if (auto memrefType = type.dyn_cast<MemRefType>())
+    return memrefType.hasStaticShape() && memrefType.getAffineMaps().empty() &&
+           memrefType.getMemorySpace() == 0;
+  return false;
+}
+
+static LogicalResult verify(ParallelCallOp op) {
+  auto fnAttr = op.getAttrOfType<FunctionAttr>("callee");
+  if (!fnAttr)
+    return op.emitOpError("requires a 'callee' function attribute");
+  auto *fn = op.getOperation()->getFunction()->getModule()->getNamedFunction(
+      fnAttr.getValue());
+  if (!fn)
+    return op.emitOpError() << "'" << fnAttr.getValue()
+                            << "' does not reference a valid function";
+
+  auto fnType = fn->getType();
+  if (fnType.getNumResults() != 0)
+    return op.emitOpError("callee must not return any results");
+  if (fnType.getNumInputs() < 2 || !fnType.getInput(0).isIndex() ||
+      !fnType.getInput(1).isIndex())
+    return op.emitOpError(
+        "callee must take the chunk bounds as two leading index arguments");
+
+  if (fnType.getNumInputs() != op.getNumOperands())
+    return op.emitOpError("incorrect number of operands for callee");
+
+  for (unsigned i = 0, e = fnType.getNumInputs(); i != e; ++i) {
+    if (op.getOperand(i)->getType() != fnType.getInput(i))
+      return op.emitOpError("operand type mismatch");
+    if (!isValidParallelCallOperandType(fnType.getInput(i)))
+      return op.emitOpError("operand ")
+             << i << " has a type unsupported by the parallel runtime ABI";
+  }
+
+  return success();
+}
+
+//===----------------------------------------------------------------------===//
+// PrefetchOp
+//===----------------------------------------------------------------------===//
+
+static void print(OpAsmPrinter *p, PrefetchOp op) {
+  *p << "prefetch " << *op.getMemRef() << '[';
+  p->printOperands(op.getIndices());
+  *p << ']';
+  p->printOptionalAttrDict(op.getAttrs());
+  *p << " : " << op.getMemRefType();
+}
+
+static ParseResult parsePrefetchOp(OpAsmParser *parser,
+                                   OperationState *result) {
+  OpAsmParser::OperandType memrefInfo;
+  SmallVector<OpAsmParser::OperandType, 4> indexInfo;
+  MemRefType type;
+
+  auto indexTy = parser->getBuilder().getIndexType();
+  return failure(
+      parser->parseOperand(memrefInfo) ||
+      parser->parseOperandList(indexInfo, OpAsmParser::Delimiter::Square) ||
+      parser->parseOptionalAttributeDict(result->attributes) ||
+      parser->parseColonType(type) ||
+      parser->resolveOperand(memrefInfo, type, result->operands) ||
+      parser->resolveOperands(indexInfo, indexTy, result->operands));
+}
+
+static LogicalResult verify(PrefetchOp op) {
+  if (op.getMemRefType().getRank() != op.getNumOperands() - 1)
+    return op.emitOpError("incorrect number of indices for prefetch");
+
+  if (!op.getAttrOfType<BoolAttr>(PrefetchOp::getIsWriteAttrName()))
+    return op.emitOpError("requires a boolean 'isWrite' attribute");
+
+  auto localityHint =
+      op.getAttrOfType<IntegerAttr>(PrefetchOp::getLocalityHintAttrName());
+  if (!localityHint || localityHint.getValue().ugt(3))
+    return op.emitOpError("requires a 'localityHint' attribute between 0 and 3");
+
+  return success();
+}
+
 //===----------------------------------------------------------------------===//
 // RankOp
 //===----------------------------------------------------------------------===//
@@ -31,8 +31,11 @@
 #include "mlir/Parser.h"
 #include "mlir/Pass/Pass.h"
 #include "mlir/Pass/PassManager.h"
+#include "mlir/Pass/PassRegistry.h"
 #include "mlir/Transforms/Passes.h"
+#include "llvm/Support/CommandLine.h"
 #include "llvm/Support/FileUtilities.h"
+#include "llvm/Support/Parallel.h"
 #include "llvm/Support/Regex.h"
 #include "llvm/Support/SourceMgr.h"
 
@@ -40,6 +43,17 @@ using namespace mlir;
 using namespace llvm;
 using llvm::SMLoc;
 
+static cl::opt<bool> printContextStatistics(
+    "mlir-print-context-stats",
+    cl::desc("Print storage statistics for the MLIRContext after processing"),
+    cl::init(false));
+
+static cl::opt<bool> parallelSplitProcessing(
+    "mlir-parallel-split-processing",
+    cl::desc("Process the chunks of a -split-input-file input on multiple "
+             "threads"),
+    cl::init(false));
+
 /// Perform the actions on the input file indicated by the command line flags
 /// within the specified context.
 ///
@@ -49,15 +63,14 @@ using llvm::SMLoc;
 static LogicalResult
 performActions(raw_ostream &os, bool verifyDiagnostics, bool verifyPasses,
                SourceMgr &sourceMgr, MLIRContext *context,
-               const std::vector<const mlir::PassRegistryEntry *> &passList) {
+               const CompiledPassPipeline &pipeline) {
   std::unique_ptr<Module> module(parseSourceFile(sourceMgr, context));
   if (!module)
     return failure();
 
-  // Run each of the passes that were selected.
+  // Instantiate the pre-compiled pipeline of selected passes.
   PassManager pm(verifyPasses);
-  for (const auto *passEntry : passList)
-    passEntry->addToPipeline(pm);
+  pipeline.populate(pm);
 
   // Apply any pass manager command line options.
   applyPassManagerCLOptions(pm);
@@ -68,6 +81,10 @@ performActions(raw_ostream &os, bool verifyDiagnostics, bool verifyPasses,
 
   // Print the output.
   module->print(os);
+
+  // Print context storage statistics if requested.
+  if (printContextStatistics)
+    context->printStorageStatistics(llvm::errs());
   return success();
 }
 
@@ -76,7 +93,7 @@ performActions(raw_ostream &os, bool verifyDiagnostics, bool verifyPasses,
 static LogicalResult
 processBuffer(raw_ostream &os, std::unique_ptr<MemoryBuffer> ownedBuffer,
               bool verifyDiagnostics, bool verifyPasses,
-              const std::vector<const mlir::PassRegistryEntry *> &passList) {
+              const CompiledPassPipeline &pipeline) {
   // Tell sourceMgr about this buffer, which is what the parser will pick up.
   SourceMgr sourceMgr;
   sourceMgr.AddNewSourceBuffer(std::move(ownedBuffer), SMLoc());
@@ -89,7 +106,7 @@ processBuffer(raw_ostream &os, std::unique_ptr<MemoryBuffer> ownedBuffer,
   if (!verifyDiagnostics) {
     SourceMgrDiagnosticHandler sourceMgrHandler(sourceMgr, &context);
     return performActions(os, verifyDiagnostics, verifyPasses, sourceMgr,
-                          &context, passList);
+                          &context, pipeline);
   }
 
   SourceMgrDiagnosticVerifierHandler sourceMgrHandler(sourceMgr, &context);
@@ -98,7 +115,7 @@ processBuffer(raw_ostream &os, std::unique_ptr<MemoryBuffer> ownedBuffer,
   // these actions succeed or fail, we only care what diagnostics they produce
   // and whether they match our expectations.
   performActions(os, verifyDiagnostics, verifyPasses, sourceMgr, &context,
-                 passList);
+                 pipeline);
 
   // Verify the diagnostic handler to make sure that each of the diagnostics
   // matched.
@@ -112,7 +129,7 @@ processBuffer(raw_ostream &os, std::unique_ptr<MemoryBuffer> ownedBuffer,
 static LogicalResult splitAndProcessFile(
     raw_ostream &os, std::unique_ptr<MemoryBuffer> originalBuffer,
     bool verifyDiagnostics, bool verifyPasses,
-    const std::vector<const mlir::PassRegistryEntry *> &passList) {
+    const CompiledPassPipeline &pipeline) {
   const char marker[] = "// -----";
   auto *origMemBuffer = originalBuffer.get();
   SmallVector<StringRef, 8> sourceBuffers;
@@ -122,22 +139,36 @@ static LogicalResult splitAndProcessFile(
   SourceMgr fileSourceMgr;
   fileSourceMgr.AddNewSourceBuffer(std::move(originalBuffer), SMLoc());
 
-  bool hadUnexpectedResult = false;
-
-  // Process each chunk in turn.  If any fails, then return a failure of the
-  // tool.
-  for (auto &subBuffer : sourceBuffers) {
+  // Each chunk is processed into its own context and output buffer, so the
+  // chunks are independent and may run on multiple threads; the outputs are
+  // assembled in input order afterwards.
+  std::vector<LogicalResult> results(sourceBuffers.size(), success());
+  std::vector<std::string> chunkOutputs(sourceBuffers.size());
+  auto processChunk = [&](size_t i) {
+    auto &subBuffer = sourceBuffers[i];
     auto splitLoc = SMLoc::getFromPointer(subBuffer.data());
     unsigned splitLine = fileSourceMgr.getLineAndColumn(splitLoc).first;
     auto subMemBuffer = MemoryBuffer::getMemBufferCopy(
         subBuffer, origMemBuffer->getBufferIdentifier() +
                        Twine(" split at line #") + Twine(splitLine));
-    if (failed(processBuffer(os, std::move(subMemBuffer), verifyDiagnostics,
-                             verifyPasses, passList)))
-      hadUnexpectedResult = true;
-  }
-
-  return failure(hadUnexpectedResult);
+    llvm::raw_string_ostream chunkOs(chunkOutputs[i]);
+    results[i] = processBuffer(chunkOs, std::move(subMemBuffer),
+                               verifyDiagnostics, verifyPasses, pipeline);
+  };
+
+  if (parallelSplitProcessing)
+    llvm::parallel::for_each_n(llvm::parallel::par, size_t(0),
+                               sourceBuffers.size(), processChunk);
+  else
+    for (size_t i = 0, e = sourceBuffers.size(); i != e; ++i)
+      processChunk(i);
+
+  // Assemble the per-chunk outputs in input order. If any chunk failed, then
+  // return a failure of the tool.
+  for (auto &chunkOutput : chunkOutputs)
+    os << chunkOutput;
+  return failure(llvm::any_of(
+      results, [](LogicalResult result) { return failed(result); }));
 }
 
 LogicalResult
@@ -145,12 +176,16 @@ mlir::MlirOptMain(raw_ostream &os, std::unique_ptr<MemoryBuffer> buffer,
                   const std::vector<const mlir::PassRegistryEntry *> &passList,
                   bool splitInputFile, bool verifyDiagnostics,
                   bool verifyPasses) {
+  // Compile the selected pass list once; each processed buffer instantiates
+  // its passes from the compiled form.
+  CompiledPassPipeline pipeline(passList);
+
   // The split-input-file mode is a very specific mode that slices the file
   // up into small pieces and checks each independently.
   if (splitInputFile)
     return splitAndProcessFile(os, std::move(buffer), verifyDiagnostics,
-                               verifyPasses, passList);
+                               verifyPasses, pipeline);
 
   return processBuffer(os, std::move(buffer), verifyDiagnostics, verifyPasses,
-                       passList);
+                       pipeline);
 }
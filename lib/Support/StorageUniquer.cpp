@@ -18,11 +18,65 @@
 #include "mlir/Support/StorageUniquer.h"
 #include "mlir/Support/LLVM.h"
 #include "llvm/Support/Allocator.h"
+#include "llvm/Support/Compiler.h"
 #include "llvm/Support/RWMutex.h"
+#include <atomic>
 
 using namespace mlir;
 using namespace mlir::detail;
 
+namespace {
+/// A small thread-local direct-mapped cache of recently uniqued storage
+/// instances. Rewrite-heavy passes re-unique the same handful of keys (e.g.
+/// the storage behind builder.getIntegerType(32)) millions of times; hitting
+/// this cache turns those calls into a few loads without touching the shared
+/// tables or their locks.
+///
+/// An entry is keyed by the owning uniquer, the storage kind, and the full
+/// hash value; the equality function is still consulted on a hit so hash
+/// collisions only cost a missed cache lookup, never a wrong result.
+struct ThreadLocalCache {
+  struct Entry {
+    const void *owner;
+    unsigned kind;
+    unsigned hashValue;
+    StorageUniquer::BaseStorage *storage;
+  };
+
+  /// The number of direct-mapped entries. Must be a power of two.
+  enum { NumEntries = 256 };
+
+  Entry &getEntry(unsigned hashValue) {
+    return entries[hashValue & (NumEntries - 1)];
+  }
+
+  Entry entries[NumEntries] = {};
+
+  /// The erase epoch this cache was last validated against. See
+  /// getEraseEpoch() below.
+  uint64_t eraseEpoch = 0;
+};
+
+/// A monotonically increasing counter bumped on every storage erasure. Each
+/// thread-local cache is flushed when it observes a new epoch, so cached
+/// pointers never outlive the storage they reference.
+static std::atomic<uint64_t> storageEraseEpoch(0);
+
+static ThreadLocalCache &getThreadLocalCache() {
+  static LLVM_THREAD_LOCAL ThreadLocalCache *cache = nullptr;
+  if (!cache)
+    cache = new ThreadLocalCache();
+
+  // Flush the cache if any storage instance was erased since the last use.
+  uint64_t epoch = storageEraseEpoch.load(std::memory_order_acquire);
+  if (LLVM_UNLIKELY(cache->eraseEpoch != epoch)) {
+    *cache = ThreadLocalCache();
+    cache->eraseEpoch = epoch;
+  }
+  return *cache;
+}
+} // end anonymous namespace
+
 namespace mlir {
 namespace detail {
 /// This is the implementation of the StorageUniquer class.
@@ -49,33 +103,113 @@ struct StorageUniquerImpl {
     BaseStorage *storage;
   };
 
+  /// Storage info for derived TypeStorage objects.
+  struct StorageKeyInfo : DenseMapInfo<HashedStorage> {
+    static HashedStorage getEmptyKey() {
+      return HashedStorage{0, DenseMapInfo<BaseStorage *>::getEmptyKey()};
+    }
+    static HashedStorage getTombstoneKey() {
+      return HashedStorage{0, DenseMapInfo<BaseStorage *>::getTombstoneKey()};
+    }
+
+    static unsigned getHashValue(const HashedStorage &key) {
+      return key.hashValue;
+    }
+    static unsigned getHashValue(LookupKey key) { return key.hashValue; }
+
+    static bool isEqual(const HashedStorage &lhs, const HashedStorage &rhs) {
+      return lhs.storage == rhs.storage;
+    }
+    static bool isEqual(const LookupKey &lhs, const HashedStorage &rhs) {
+      if (isEqual(rhs, getEmptyKey()) || isEqual(rhs, getTombstoneKey()))
+        return false;
+      // If the lookup kind matches the kind of the storage, then invoke the
+      // equality function on the lookup key.
+      return lhs.kind == rhs.storage->getKind() && lhs.isEqual(rhs.storage);
+    }
+  };
+
+  // Unique types with specific hashing or storage constraints.
+  using StorageTypeSet = llvm::DenseSet<HashedStorage, StorageKeyInfo>;
+
+  /// The number of shards the parametric storage set is partitioned into.
+  /// Keys are distributed across the shards by hash value, so concurrent
+  /// get()/erase() calls for unrelated keys proceed without contending on a
+  /// single lock. Must be a power of two.
+  enum { NumShards = 16 };
+
+  /// A single hash-partitioned slice of the parametric storage set. Each
+  /// shard owns its own lock and allocator so that threads inserting into
+  /// different shards never serialize on shared state.
+  struct Shard {
+    /// The uniqued storage instances owned by this shard.
+    StorageTypeSet storageTypes;
+
+    /// Allocator used when constructing storage instances in this shard.
+    StorageAllocator allocator;
+
+    /// Bytes allocated by this shard's allocator for each storage kind, used
+    /// for memory attribution. Guarded by the shard mutex.
+    DenseMap<unsigned, size_t> bytesByKind;
+
+    /// A mutex guarding this shard's set and allocator.
+    llvm::sys::SmartRWMutex<true> mutex;
+  };
+
+  /// Return the shard used for the provided hash value. The shard index is
+  /// taken from the upper bits of the hash as DenseSet consumes the lower
+  /// bits for bucket selection.
+  Shard &getShard(unsigned hashValue) {
+    return shards[(hashValue >> (32 - 4)) & (NumShards - 1)];
+  }
+
   /// Get or create an instance of a complex derived type.
   BaseStorage *
   getOrCreate(unsigned kind, unsigned hashValue,
               llvm::function_ref<bool(const BaseStorage *)> isEqual,
               llvm::function_ref<BaseStorage *(StorageAllocator &)> ctorFn) {
+    // Consult the thread-local cache before touching the shared tables.
+    ThreadLocalCache &cache = getThreadLocalCache();
+    ThreadLocalCache::Entry &entry = cache.getEntry(hashValue);
+    if (entry.owner == this && entry.kind == kind &&
+        entry.hashValue == hashValue && isEqual(entry.storage))
+      return entry.storage;
+
+    BaseStorage *result = getOrCreateImpl(kind, hashValue, isEqual, ctorFn);
+    entry = ThreadLocalCache::Entry{this, kind, hashValue, result};
+    return result;
+  }
+
+  /// Slow path of getOrCreate that consults the shared shard tables.
+  BaseStorage *getOrCreateImpl(
+      unsigned kind, unsigned hashValue,
+      llvm::function_ref<bool(const BaseStorage *)> isEqual,
+      llvm::function_ref<BaseStorage *(StorageAllocator &)> ctorFn) {
     LookupKey lookupKey{kind, hashValue, isEqual};
+    Shard &shard = getShard(hashValue);
 
     // Check for an existing instance in read-only mode.
     {
-      llvm::sys::SmartScopedReader<true> typeLock(mutex);
-      auto it = storageTypes.find_as(lookupKey);
-      if (it != storageTypes.end())
+      llvm::sys::SmartScopedReader<true> typeLock(shard.mutex);
+      auto it = shard.storageTypes.find_as(lookupKey);
+      if (it != shard.storageTypes.end())
         return it->storage;
     }
 
     // Acquire a writer-lock so that we can safely create the new type instance.
-    llvm::sys::SmartScopedWriter<true> typeLock(mutex);
+    llvm::sys::SmartScopedWriter<true> typeLock(shard.mutex);
 
     // Check for an existing instance again here, because another writer thread
     // may have already created one.
-    auto existing = storageTypes.insert_as({}, lookupKey);
+    auto existing = shard.storageTypes.insert_as({}, lookupKey);
     if (!existing.second)
       return existing.first->storage;
 
     // Otherwise, construct and initialize the derived storage for this type
-    // instance.
-    BaseStorage *storage = initializeStorage(kind, ctorFn);
+    // instance, attributing the bytes it allocates to its kind.
+    size_t bytesBefore = shard.allocator.getAllocatedBytes();
+    BaseStorage *storage = initializeStorage(kind, shard.allocator, ctorFn);
+    shard.bytesByKind[kind] += shard.allocator.getAllocatedBytes() - bytesBefore;
     *existing.first = HashedStorage{hashValue, storage};
     return storage;
   }
@@ -86,14 +220,14 @@ struct StorageUniquerImpl {
               llvm::function_ref<BaseStorage *(StorageAllocator &)> ctorFn) {
     // Check for an existing instance in read-only mode.
     {
-      llvm::sys::SmartScopedReader<true> typeLock(mutex);
+      llvm::sys::SmartScopedReader<true> typeLock(simpleMutex);
       auto it = simpleTypes.find(kind);
       if (it != simpleTypes.end())
         return it->second;
     }
 
     // Acquire a writer-lock so that we can safely create the new type instance.
-    llvm::sys::SmartScopedWriter<true> typeLock(mutex);
+    llvm::sys::SmartScopedWriter<true> typeLock(simpleMutex);
 
     // Check for an existing instance again here, because another writer thread
     // may have already created one.
@@ -101,8 +235,13 @@ struct StorageUniquerImpl {
     if (result)
       return result;
 
-    // Otherwise, create and return a new storage instance.
-    return result = initializeStorage(kind, ctorFn);
+    // Otherwise, create and return a new storage instance, attributing the
+    // bytes it allocates to its kind.
+    size_t bytesBefore = simpleAllocator.getAllocatedBytes();
+    result = initializeStorage(kind, simpleAllocator, ctorFn);
+    simpleBytesByKind[kind] +=
+        simpleAllocator.getAllocatedBytes() - bytesBefore;
+    return result;
   }
 
   /// Erase an instance of a complex derived type.
@@ -110,16 +249,41 @@ struct StorageUniquerImpl {
              llvm::function_ref<bool(const BaseStorage *)> isEqual,
              llvm::function_ref<void(BaseStorage *)> cleanupFn) {
     LookupKey lookupKey{kind, hashValue, isEqual};
+    Shard &shard = getShard(hashValue);
 
     // Acquire a writer-lock so that we can safely erase the type instance.
-    llvm::sys::SmartScopedWriter<true> typeLock(mutex);
-    auto existing = storageTypes.find_as(lookupKey);
-    if (existing == storageTypes.end())
+    llvm::sys::SmartScopedWriter<true> typeLock(shard.mutex);
+    auto existing = shard.storageTypes.find_as(lookupKey);
+    if (existing == shard.storageTypes.end())
       return;
 
-    // Cleanup the storage and remove it from the map.
+    // Cleanup the storage and remove it from the map. Bump the erase epoch so
+    // that stale pointers are flushed from the thread-local caches.
     cleanupFn(existing->storage);
-    storageTypes.erase(existing);
+    shard.storageTypes.erase(existing);
+    storageEraseEpoch.fetch_add(1, std::memory_order_release);
+  }
+
+  /// Accumulate per-kind instance counts and allocator byte totals from all
+  /// of the shards and the simple type table.
+  void getStatistics(DenseMap<unsigned, unsigned> &numInstancesByKind,
+                     DenseMap<unsigned, size_t> &bytesByKind,
+                     size_t &allocatedBytes) {
+    for (Shard &shard : shards) {
+      llvm::sys::SmartScopedReader<true> typeLock(shard.mutex);
+      for (const HashedStorage &entry : shard.storageTypes)
+        ++numInstancesByKind[entry.storage->getKind()];
+      for (const auto &entry : shard.bytesByKind)
+        bytesByKind[entry.first] += entry.second;
+      allocatedBytes += shard.allocator.getAllocatedBytes();
+    }
+
+    llvm::sys::SmartScopedReader<true> typeLock(simpleMutex);
+    for (const auto &entry : simpleTypes)
+      ++numInstancesByKind[entry.first];
+    for (const auto &entry : simpleBytesByKind)
+      bytesByKind[entry.first] += entry.second;
+    allocatedBytes += simpleAllocator.getAllocatedBytes();
   }
 
   //===--------------------------------------------------------------------===//
@@ -128,57 +292,38 @@ struct StorageUniquerImpl {
 
   /// Utility to create and initialize a storage instance.
   BaseStorage *initializeStorage(
-      unsigned kind,
+      unsigned kind, StorageAllocator &allocator,
       llvm::function_ref<BaseStorage *(StorageAllocator &)> ctorFn) {
     BaseStorage *storage = ctorFn(allocator);
     storage->kind = kind;
     return storage;
   }
 
-  /// Storage info for derived TypeStorage objects.
-  struct StorageKeyInfo : DenseMapInfo<HashedStorage> {
-    static HashedStorage getEmptyKey() {
-      return HashedStorage{0, DenseMapInfo<BaseStorage *>::getEmptyKey()};
-    }
-    static HashedStorage getTombstoneKey() {
-      return HashedStorage{0, DenseMapInfo<BaseStorage *>::getTombstoneKey()};
-    }
-
-    static unsigned getHashValue(const HashedStorage &key) {
-      return key.hashValue;
-    }
-    static unsigned getHashValue(LookupKey key) { return key.hashValue; }
-
-    static bool isEqual(const HashedStorage &lhs, const HashedStorage &rhs) {
-      return lhs.storage == rhs.storage;
-    }
-    static bool isEqual(const LookupKey &lhs, const HashedStorage &rhs) {
-      if (isEqual(rhs, getEmptyKey()) || isEqual(rhs, getTombstoneKey()))
-        return false;
-      // If the lookup kind matches the kind of the storage, then invoke the
-      // equality function on the lookup key.
-      return lhs.kind == rhs.storage->getKind() && lhs.isEqual(rhs.storage);
-    }
-  };
-
-  // Unique types with specific hashing or storage constraints.
-  using StorageTypeSet = llvm::DenseSet<HashedStorage, StorageKeyInfo>;
-  StorageTypeSet storageTypes;
+  // The hash-partitioned shards holding the parametric storage instances.
+  Shard shards[NumShards];
 
   // Unique types with just the kind.
   DenseMap<unsigned, BaseStorage *> simpleTypes;
 
-  // Allocator to use when constructing derived type instances.
-  StorageUniquer::StorageAllocator allocator;
+  // Allocator to use when constructing simple derived type instances.
+  StorageUniquer::StorageAllocator simpleAllocator;
+
+  // Bytes allocated by the simple allocator for each storage kind. Guarded by
+  // simpleMutex.
+  DenseMap<unsigned, size_t> simpleBytesByKind;
 
-  // A mutex to keep type uniquing thread-safe.
-  llvm::sys::SmartRWMutex<true> mutex;
+  // A mutex to keep simple type uniquing thread-safe.
+  llvm::sys::SmartRWMutex<true> simpleMutex;
 };
 } // end namespace detail
 } // namespace mlir
 
 StorageUniquer::StorageUniquer() : impl(new StorageUniquerImpl()) {}
-StorageUniquer::~StorageUniquer() {}
+StorageUniquer::~StorageUniquer() {
+  // Flush the thread-local caches so that entries referencing this uniquer
+  // cannot alias a uniquer later allocated at the same address.
+  storageEraseEpoch.fetch_add(1, std::memory_order_release);
+}
 
 /// Implementation for getting/creating an instance of a derived type with
 /// complex storage.
@@ -197,6 +342,13 @@ auto StorageUniquer::getImpl(
   return impl->getOrCreate(kind, ctorFn);
 }
 
+/// Accumulates uniquing statistics into the provided outputs.
+void StorageUniquer::getStatistics(
+    llvm::DenseMap<unsigned, unsigned> &numInstancesByKind,
+    llvm::DenseMap<unsigned, size_t> &bytesByKind, size_t &allocatedBytes) {
+  impl->getStatistics(numInstancesByKind, bytesByKind, allocatedBytes);
+}
+
 /// Implementation for erasing an instance of a derived type with complex
 /// storage.
 void StorageUniquer::eraseImpl(
@@ -33,6 +33,7 @@
 #include "llvm/IR/Constants.h"
 #include "llvm/IR/DerivedTypes.h"
 #include "llvm/IR/IRBuilder.h"
+#include "llvm/IR/Intrinsics.h"
 #include "llvm/IR/LLVMContext.h"
 #include "llvm/IR/Module.h"
 #include "llvm/Transforms/Utils/Cloning.h"
@@ -93,6 +94,35 @@ llvm::Constant *ModuleTranslation::getLLVMConstant(llvm::Type *llvmType,
   }
   if (auto denseAttr = attr.dyn_cast<DenseElementsAttr>()) {
     auto *vectorType = cast<llvm::VectorType>(llvmType);
+    // When the element width matches a ConstantDataVector element type, emit
+    // the constant directly from the raw data buffer instead of creating one
+    // Attribute per element.
+    auto elementType = denseAttr.getType().getElementType();
+    auto &llvmContext = llvmModule->getContext();
+    if (elementType.isF32())
+      return llvm::ConstantDataVector::get(llvmContext,
+                                           denseAttr.getValues<float>());
+    if (elementType.isF64())
+      return llvm::ConstantDataVector::get(llvmContext,
+                                           denseAttr.getValues<double>());
+    if (auto intType = elementType.dyn_cast<IntegerType>()) {
+      switch (intType.getWidth()) {
+      case 8:
+        return llvm::ConstantDataVector::get(llvmContext,
+                                             denseAttr.getValues<uint8_t>());
+      case 16:
+        return llvm::ConstantDataVector::get(llvmContext,
+                                             denseAttr.getValues<uint16_t>());
+      case 32:
+        return llvm::ConstantDataVector::get(llvmContext,
+                                             denseAttr.getValues<uint32_t>());
+      case 64:
+        return llvm::ConstantDataVector::get(llvmContext,
+                                             denseAttr.getValues<uint64_t>());
+      default:
+        break;
+      }
+    }
     SmallVector<llvm::Constant *, 8> constants;
     uint64_t numElements = vectorType->getNumElements();
     constants.reserve(numElements);
@@ -147,7 +177,7 @@ SmallVector<llvm::Value *, 8> ModuleTranslation::lookupValues(Range &&values) {
   SmallVector<llvm::Value *, 8> remapped;
   remapped.reserve(llvm::size(values));
   for (Value *v : values) {
-    remapped.push_back(valueMapping.lookup(v));
+    remapped.push_back(lookupValue(v));
   }
   return remapped;
 }
@@ -189,7 +219,7 @@ bool ModuleTranslation::convertOperation(Operation &opInst,
   if (isa<LLVM::CallOp>(opInst)) {
     llvm::Value *result = convertCall(opInst);
     if (opInst.getNumResults() != 0) {
-      valueMapping[opInst.getResult(0)] = result;
+      mapValue(opInst.getResult(0)) = result;
       return false;
     }
     // Check that LLVM call returns void for 0-result functions.
@@ -203,7 +233,7 @@ bool ModuleTranslation::convertOperation(Operation &opInst,
     return false;
   }
   if (auto condbrOp = dyn_cast<LLVM::CondBrOp>(opInst)) {
-    builder.CreateCondBr(valueMapping.lookup(condbrOp.getOperand(0)),
+    builder.CreateCondBr(lookupValue(condbrOp.getOperand(0)),
                          blockMapping[condbrOp.getSuccessor(0)],
                          blockMapping[condbrOp.getSuccessor(1)]);
     return false;
@@ -238,7 +268,7 @@ bool ModuleTranslation::convertBlock(Block &bb, bool ignoreArguments) {
       }
       llvm::Type *type = wrappedType.getUnderlyingType();
       llvm::PHINode *phi = builder.CreatePHI(type, numPredecessors);
-      valueMapping[arg] = phi;
+      mapValue(arg) = phi;
     }
   }
 
@@ -288,8 +318,8 @@ void ModuleTranslation::connectPHINodes(Function &func) {
       auto &phiNode = numberedPhiNode.value();
       unsigned index = numberedPhiNode.index();
       for (auto *pred : bb->getPredecessors()) {
-        phiNode.addIncoming(valueMapping.lookup(getPHISourceValue(
-                                bb, pred, numArguments, index)),
+        phiNode.addIncoming(lookupValue(getPHISourceValue(bb, pred,
+                                                          numArguments, index)),
                             blockMapping.lookup(pred));
       }
     }
@@ -320,11 +350,27 @@ static llvm::SetVector<Block *> topologicalSort(Function &f) {
   return blocks;
 }
 
+// Number every value defined within 'func' - its arguments, then the results
+// of its operations in block order - and size the flat translated value table
+// accordingly. The numbering is read-only during body emission.
+void ModuleTranslation::numberValuesInFunction(Function &func) {
+  valueNumbering.clear();
+  unsigned nextValueNumber = 0;
+  for (auto &bb : func) {
+    for (auto *arg : bb.getArguments())
+      valueNumbering[arg] = nextValueNumber++;
+    for (auto &op : bb)
+      for (auto *result : op.getResults())
+        valueNumbering[result] = nextValueNumber++;
+  }
+  valueTable.assign(nextValueNumber, nullptr);
+}
+
 bool ModuleTranslation::convertOneFunction(Function &func) {
-  // Clear the block and value mappings, they are only relevant within one
-  // function.
+  // Clear the block mapping, it is only relevant within one function, and
+  // renumber the function's values.
   blockMapping.clear();
-  valueMapping.clear();
+  numberValuesInFunction(func);
   llvm::Function *llvmFunc = functionMapping.lookup(func.getName());
   // Add function arguments to the value remapping table.
   // If there was noalias info then we decorate each argument accordingly.
@@ -345,7 +391,7 @@ bool ModuleTranslation::convertOneFunction(Function &func) {
       if (attr.getValue())
         llvmArg.addAttr(llvm::Attribute::AttrKind::NoAlias);
     }
-    valueMapping[mlirArg] = &llvmArg;
+    mapValue(mlirArg) = &llvmArg;
     argIdx++;
   }
 
@@ -391,7 +437,12 @@ bool ModuleTranslation::convertFunctions() {
         cast<llvm::Function>(llvmFuncCst.getCallee());
   }
 
-  // Convert functions.
+  // Convert functions. This loop is intentionally serial: all functions are
+  // emitted into a single llvm::Module whose LLVMContext uniques types and
+  // constants without locking, and the LLVM dialect's types wrap llvm::Type
+  // pointers from that same context, so translating function batches into
+  // per-thread modules would require per-thread contexts and a cross-context
+  // type mapping.
   for (Function &function : mlirModule) {
     // Ignore external functions.
     if (function.isExternal())
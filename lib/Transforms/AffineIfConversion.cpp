@@ -0,0 +1,184 @@
+//===- AffineIfConversion.cpp - Predicate affine.if bodies --------------*-===//
+//
+// Copyright 2019 The MLIR Authors.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+// =============================================================================
+//
+// This file implements a pass that if-converts 'affine.if' operations with
+// simple bodies into straight-line code. The condition is materialized as an
+// i1 value, the operations of both branches are hoisted out, and each guarded
+// store is rewritten to store a 'select' between its value and the value
+// already in memory, so the write is a no-op when the branch would not have
+// run. This removes the control flow that makes the vectorizer bail on loop
+// nests with boundary-condition guards, and trades hard-to-predict branches
+// in scalar code for predicated data flow.
+//
+// After conversion both branches execute unconditionally, so a branch may
+// only contain operations that are safe to speculate: side-effect-free
+// operations, and loads and stores whose accesses are provably in bounds for
+// every iteration of the enclosing loops, not just the ones satisfying the
+// condition (checked with the same machinery as -memref-bound-check).
+//
+//===----------------------------------------------------------------------===//
+
+#include "mlir/AffineOps/AffineOps.h"
+#include "mlir/Analysis/Utils.h"
+#include "mlir/IR/Builders.h"
+#include "mlir/IR/IntegerSet.h"
+#include "mlir/Pass/Pass.h"
+#include "mlir/StandardOps/Ops.h"
+#include "mlir/Transforms/Passes.h"
+
+#define DEBUG_TYPE "affine-if-conversion"
+
+using namespace mlir;
+
+namespace {
+
+struct AffineIfConversion : public FunctionPass<AffineIfConversion> {
+  void runOnFunction() override;
+
+  bool convertIf(AffineIfOp ifOp);
+};
+
+} // end anonymous namespace
+
+/// Creates a pass that if-converts simple affine.if bodies into select-based
+/// straight-line code.
+FunctionPassBase *mlir::createAffineIfConversionPass() {
+  return new AffineIfConversion();
+}
+
+/// Returns true if every operation in 'block' may execute when the condition
+/// it was guarded by does not hold: side-effect-free operations always may,
+/// loads and stores only when they are in bounds for all values of the
+/// enclosing loop induction variables. Guarded stores are made harmless
+/// separately by storing back the value already in memory.
+static bool isSpeculatableBlock(Block &block) {
+  for (auto &op : block) {
+    if (op.isKnownTerminator())
+      continue;
+    // Operations with regions would need their own recursive predication.
+    if (op.getNumRegions() != 0)
+      return false;
+    if (auto loadOp = dyn_cast<LoadOp>(op)) {
+      if (!loadOp.getMemRefType().hasStaticShape() ||
+          failed(boundCheckLoadOrStoreOp(loadOp, /*emitError=*/false)))
+        return false;
+      continue;
+    }
+    if (auto storeOp = dyn_cast<StoreOp>(op)) {
+      if (!storeOp.getMemRefType().hasStaticShape() ||
+          failed(boundCheckLoadOrStoreOp(storeOp, /*emitError=*/false)))
+        return false;
+      continue;
+    }
+    // Integer division and remainder are side-effect free but trap on a zero
+    // divisor (and INT_MIN / -1); the condition being converted away may be
+    // exactly what guards against those divisors.
+    if (isa<DivISOp>(op) || isa<DivIUOp>(op) || isa<RemISOp>(op) ||
+        isa<RemIUOp>(op))
+      return false;
+    if (!op.hasNoSideEffect())
+      return false;
+  }
+  return true;
+}
+
+/// Moves the operations of 'block' before 'ifOperation' and predicates its
+/// stores on 'condition': each store is rewritten to store a select between
+/// the value it would have written and the value already in memory, keeping
+/// memory unchanged when the branch is not taken. 'isThen' selects the
+/// polarity of the condition.
+static void predicateBlock(Block *block, Operation *ifOperation,
+                           Value *condition, bool isThen) {
+  SmallVector<StoreOp, 4> stores;
+  for (auto &op : *block)
+    if (auto storeOp = dyn_cast<StoreOp>(op))
+      stores.push_back(storeOp);
+
+  auto *destBlock = ifOperation->getBlock();
+  destBlock->getOperations().splice(Block::iterator(ifOperation),
+                                    block->getOperations(), block->begin(),
+                                    std::prev(block->end()));
+
+  for (auto storeOp : stores) {
+    OpBuilder b(storeOp.getOperation());
+    auto loc = storeOp.getLoc();
+    SmallVector<Value *, 4> indices(storeOp.getIndices());
+    Value *current = b.create<LoadOp>(loc, storeOp.getMemRef(), indices);
+    Value *value =
+        isThen ? b.create<SelectOp>(loc, condition, storeOp.getValueToStore(),
+                                    current)
+               : b.create<SelectOp>(loc, condition, current,
+                                    storeOp.getValueToStore());
+    b.create<StoreOp>(loc, value, storeOp.getMemRef(), indices);
+    storeOp.getOperation()->erase();
+  }
+}
+
+/// If-converts 'ifOp' when both branches are speculatable single blocks.
+/// Returns true on success, leaving the operation untouched otherwise.
+bool AffineIfConversion::convertIf(AffineIfOp ifOp) {
+  auto &thenRegion = ifOp.getThenBlocks();
+  auto &elseRegion = ifOp.getElseBlocks();
+  if (&thenRegion.front() != &thenRegion.back() ||
+      !isSpeculatableBlock(thenRegion.front()))
+    return false;
+  if (!elseRegion.empty() && (&elseRegion.front() != &elseRegion.back() ||
+                              !isSpeculatableBlock(elseRegion.front())))
+    return false;
+
+  // Materialize the condition as an i1 value: one affine.apply and compare
+  // with zero per constraint of the integer set, conjoined with 'and'.
+  OpBuilder b(ifOp.getOperation());
+  auto loc = ifOp.getLoc();
+  auto set = ifOp.getIntegerSet();
+  SmallVector<Value *, 4> operands(ifOp.getOperation()->getOperands());
+  Value *zero = b.create<ConstantIndexOp>(loc, 0);
+  Value *condition = nullptr;
+  for (unsigned i = 0, e = set.getNumConstraints(); i != e; ++i) {
+    auto map = AffineMap::get(set.getNumDims(), set.getNumSymbols(),
+                              set.getConstraint(i));
+    Value *constraint = b.create<AffineApplyOp>(loc, map, operands);
+    Value *cmp = b.create<CmpIOp>(
+        loc, set.isEq(i) ? CmpIPredicate::EQ : CmpIPredicate::SGE, constraint,
+        zero);
+    condition = condition ? b.create<AndOp>(loc, condition, cmp) : cmp;
+  }
+
+  predicateBlock(&thenRegion.front(), ifOp.getOperation(), condition,
+                 /*isThen=*/true);
+  if (!elseRegion.empty())
+    predicateBlock(&elseRegion.front(), ifOp.getOperation(), condition,
+                   /*isThen=*/false);
+  ifOp.getOperation()->erase();
+  return true;
+}
+
+void AffineIfConversion::runOnFunction() {
+  // The walk is post-order, so converted inner 'affine.if' bodies have
+  // already been flattened into straight-line code by the time the enclosing
+  // operation is considered.
+  SmallVector<AffineIfOp, 8> ifOps;
+  getFunction().walk<AffineIfOp>(
+      [&](AffineIfOp ifOp) { ifOps.push_back(ifOp); });
+  for (auto ifOp : ifOps)
+    convertIf(ifOp);
+}
+
+static PassRegistration<AffineIfConversion>
+    pass("affine-if-conversion",
+         "If-convert side-effect-free affine.if bodies into select-based "
+         "straight-line code");
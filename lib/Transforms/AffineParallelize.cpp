@@ -0,0 +1,364 @@
+//===- AffineParallelize.cpp - Parallel loop outlining pass -------------*-===//
+//
+// Copyright 2019 The MLIR Authors.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+// =============================================================================
+//
+// This file implements a pass that turns parallel affine loops into
+// multi-threaded dispatches. Each outermost loop proven parallel by the
+// dependence analysis is outlined into a function taking the chunk bounds as
+// two leading index arguments plus one argument per value captured from the
+// enclosing scope, and the loop is replaced by a std.parallel_call that hands
+// the outlined body to the thread-pool runtime for statically chunked
+// execution.
+//
+// Loops whose only cross-iteration dependences are recognized reductions over
+// loop-carried values are dispatched as well: each chunk accumulates a
+// private partial result starting from the identity of the combining
+// operation, and merges it into a shared cell under the runtime's critical
+// section; the caller seeds the cell with the initial value and reads the
+// final one back after the dispatch. Associativity and commutativity of the
+// combiner make the chunked evaluation order legal.
+//
+//===----------------------------------------------------------------------===//
+
+#include "mlir/AffineOps/AffineOps.h"
+#include "mlir/Analysis/Utils.h"
+#include "mlir/IR/BlockAndValueMapping.h"
+#include "mlir/IR/Builders.h"
+#include "mlir/IR/Module.h"
+#include "mlir/Pass/Pass.h"
+#include "mlir/StandardOps/Ops.h"
+#include "mlir/Transforms/Passes.h"
+#include "llvm/ADT/SetVector.h"
+#include "llvm/ADT/Twine.h"
+
+using namespace mlir;
+
+#define DEBUG_TYPE "affine-parallelize"
+
+// The runtime dispatches outlined bodies through fixed all-word-sized
+// trampolines; loops capturing more values than the widest trampoline are
+// left sequential.
+static constexpr unsigned kMaxRuntimeArgs = 6;
+
+namespace {
+
+/// Outlines outermost parallel affine loops into per-loop body functions and
+/// replaces them with std.parallel_call dispatches to the thread-pool
+/// runtime. This is a module pass because it creates the outlined functions.
+struct AffineParallelize : public ModulePass<AffineParallelize> {
+  void runOnModule() override;
+
+  void processBlock(Block &block, Function *parentFunc, Module *module);
+  bool parallelizeLoop(AffineForOp forOp, Function *parentFunc, Module *module,
+                       ArrayRef<LoopReduction> reductions);
+
+  /// Number of bodies outlined from the current function, used for naming.
+  unsigned outlinedCount = 0;
+};
+
+} // end anonymous namespace
+
+/// Returns true if 'value' is defined outside the body of 'forOp' and thus
+/// must be passed into the outlined function as an explicit argument.
+static bool isDefinedOutsideLoop(Value *value, AffineForOp forOp) {
+  Block *block;
+  if (auto *defOp = value->getDefiningOp())
+    block = defOp->getBlock();
+  else
+    block = cast<BlockArgument>(value)->getOwner();
+  while (block) {
+    Operation *container = block->getContainingOp();
+    if (!container)
+      return true;
+    if (container == forOp.getOperation())
+      return false;
+    block = container->getBlock();
+  }
+  return true;
+}
+
+/// Returns true if 'type' can be passed through the word-sized runtime
+/// dispatch ABI. This must match the operand restriction enforced by the
+/// std.parallel_call verifier.
+static bool isSupportedCaptureType(Type type) {
+  if (type.isIndex())
+    return true;
+  if (auto intType = type.dyn_cast<IntegerType>())
+    return intType.getWidth() <= 64;
+  if (auto memRefType = type.dyn_cast<MemRefType>())
+    return memRefType.hasStaticShape() && memRefType.getAffineMaps().empty() &&
+           memRefType.getMemorySpace() == 0;
+  return false;
+}
+
+/// Materializes the value of a single-result loop bound at the position of
+/// 'b', either as a constant or by applying the bound map.
+static Value *materializeBound(OpBuilder &b, Location loc, AffineMap map,
+                               ArrayRef<Value *> operands) {
+  if (map.isSingleConstant())
+    return b.create<ConstantIndexOp>(loc, map.getSingleConstantResult())
+        .getResult();
+  return b.create<AffineApplyOp>(loc, map, operands);
+}
+
+/// Materializes the identity value of a reduction: zero for additions, one
+/// for multiplications.
+static Value *createIdentityValue(OpBuilder &b, Location loc,
+                                  LoopReduction::Kind kind, Type type) {
+  bool isMul = kind == LoopReduction::Kind::MulF ||
+               kind == LoopReduction::Kind::MulI;
+  if (type.isa<FloatType>())
+    return b.create<ConstantOp>(loc, type,
+                                b.getFloatAttr(type, isMul ? 1.0 : 0.0))
+        .getResult();
+  if (type.isIndex())
+    return b.create<ConstantIndexOp>(loc, isMul ? 1 : 0).getResult();
+  return b.create<ConstantIntOp>(loc, isMul ? 1 : 0, type).getResult();
+}
+
+/// Combines two partial reduction values with the combining operation of
+/// 'kind'.
+static Value *createCombine(OpBuilder &b, Location loc,
+                            LoopReduction::Kind kind, Value *lhs, Value *rhs) {
+  switch (kind) {
+  case LoopReduction::Kind::AddF:
+    return b.create<AddFOp>(loc, lhs, rhs);
+  case LoopReduction::Kind::MulF:
+    return b.create<MulFOp>(loc, lhs, rhs);
+  case LoopReduction::Kind::AddI:
+    return b.create<AddIOp>(loc, lhs, rhs);
+  case LoopReduction::Kind::MulI:
+    return b.create<MulIOp>(loc, lhs, rhs);
+  }
+  llvm_unreachable("unknown reduction kind");
+}
+
+/// Returns the declaration of the named nullary runtime helper, inserting it
+/// into the module if it is not present yet.
+static Function *getOrInsertRuntimeHelper(Module *module, StringRef name,
+                                          Location loc) {
+  if (Function *func = module->getNamedFunction(name))
+    return func;
+  Builder builder(module->getContext());
+  auto *func = new Function(loc, name, builder.getFunctionType({}, {}));
+  module->getFunctions().push_back(func);
+  return func;
+}
+
+/// Outlines 'forOp' into a new function and replaces it with a parallel_call.
+/// Returns false if the loop does not fit the runtime dispatch ABI, in which
+/// case it is left untouched.
+bool AffineParallelize::parallelizeLoop(AffineForOp forOp, Function *parentFunc,
+                                        Module *module,
+                                        ArrayRef<LoopReduction> reductions) {
+  // The runtime chunks the iteration space as a half-open interval of unit
+  // strides; non-unit steps and multi-result (min/max) bounds would need
+  // their own normalization first.
+  if (forOp.getStep() != 1 || forOp.getLowerBoundMap().getNumResults() != 1 ||
+      forOp.getUpperBoundMap().getNumResults() != 1)
+    return false;
+
+  // Collect the values the loop body reads from the enclosing scope; they
+  // become trailing arguments of the outlined function. The initial values of
+  // reduced loop-carried values are not captured: they are seeded into the
+  // shared result cells instead.
+  llvm::SetVector<Value *> captures;
+  forOp.getOperation()->walk([&](Operation *op) {
+    if (op == forOp.getOperation())
+      return;
+    for (Value *operand : op->getOperands())
+      if (isDefinedOutsideLoop(operand, forOp))
+        captures.insert(operand);
+  });
+  if (captures.size() + reductions.size() > kMaxRuntimeArgs)
+    return false;
+  for (Value *capture : captures)
+    if (!isSupportedCaptureType(capture->getType()))
+      return false;
+
+  // Each reduction gets a single-element cell shared by all chunks; partial
+  // results are merged into it under the runtime's critical section.
+  SmallVector<Type, 2> cellTypes;
+  Builder builder(module->getContext());
+  for (const LoopReduction &red : reductions) {
+    auto type = forOp.getResult(red.position)->getType();
+    if (!type.isa<FloatType>() && !type.isIndex() &&
+        !type.isa<IntegerType>())
+      return false;
+    cellTypes.push_back(builder.getMemRefType({1}, type));
+  }
+
+  // Create the body function: (index lb, index ub, cells..., captures...)
+  // -> ().
+  SmallVector<Type, 8> argTypes(2, builder.getIndexType());
+  argTypes.append(cellTypes.begin(), cellTypes.end());
+  for (Value *capture : captures)
+    argTypes.push_back(capture->getType());
+  std::string name;
+  do {
+    name = (parentFunc->getName().str() + llvm::Twine("_parallel_body") +
+            llvm::Twine(outlinedCount))
+               .str();
+    ++outlinedCount;
+  } while (module->getNamedFunction(name));
+  auto *body = new Function(forOp.getLoc(), name,
+                            builder.getFunctionType(argTypes, {}));
+  module->getFunctions().push_back(body);
+  body->addEntryBlock();
+
+  // The outlined loop runs from the first argument to the second; the clone
+  // of the original body sees the new induction variable and the captured
+  // values through the entry arguments. Reduced loop-carried values restart
+  // from the identity of their combiner so that each chunk computes a private
+  // partial result.
+  auto loc = forOp.getLoc();
+  OpBuilder bodyFuncBuilder(&body->front());
+  auto boundMap = builder.getSymbolIdentityMap();
+  unsigned numCells = reductions.size();
+  SmallVector<Value *, 2> identities;
+  for (const LoopReduction &red : reductions)
+    identities.push_back(createIdentityValue(
+        bodyFuncBuilder, loc, red.kind,
+        forOp.getResult(red.position)->getType()));
+  auto outlinedLoop = bodyFuncBuilder.create<AffineForOp>(
+      loc, ArrayRef<Value *>(body->getArgument(0)), boundMap,
+      ArrayRef<Value *>(body->getArgument(1)), boundMap, /*step=*/1,
+      identities);
+  BlockAndValueMapping mapper;
+  mapper.map(forOp.getInductionVar(), outlinedLoop.getInductionVar());
+  for (unsigned i = 0, e = numCells; i != e; ++i)
+    mapper.map(forOp.getRegionIterArgs()[reductions[i].position],
+               outlinedLoop.getRegionIterArgs()[i]);
+  for (unsigned i = 0, e = captures.size(); i != e; ++i)
+    mapper.map(captures[i], body->getArgument(i + 2 + numCells));
+  OpBuilder loopBodyBuilder = outlinedLoop.getBodyBuilder();
+  for (auto &op : *forOp.getBody())
+    if (!op.isKnownTerminator())
+      loopBodyBuilder.clone(op, mapper);
+
+  // Carry the mapped next-iteration values through the cloned loop, replacing
+  // the placeholder terminator the builder created.
+  if (numCells != 0) {
+    auto oldTerminator =
+        cast<AffineTerminatorOp>(forOp.getBody()->getTerminator());
+    SmallVector<Value *, 2> nextIterValues;
+    for (const LoopReduction &red : reductions)
+      nextIterValues.push_back(
+          mapper.lookupOrDefault(oldTerminator.getOperand(red.position)));
+    Operation *placeholder = outlinedLoop.getBody()->getTerminator();
+    OpBuilder(outlinedLoop.getBody(), Block::iterator(placeholder))
+        .create<AffineTerminatorOp>(loc, nextIterValues);
+    placeholder->erase();
+
+    // Merge the chunk-private partial results into the shared cells under the
+    // runtime's critical section.
+    auto *criticalBegin =
+        getOrInsertRuntimeHelper(module, "mlir_parallel_critical_begin", loc);
+    auto *criticalEnd =
+        getOrInsertRuntimeHelper(module, "mlir_parallel_critical_end", loc);
+    Value *zero = bodyFuncBuilder.create<ConstantIndexOp>(loc, 0);
+    bodyFuncBuilder.create<CallOp>(loc, criticalBegin);
+    for (unsigned i = 0, e = numCells; i != e; ++i) {
+      Value *cell = body->getArgument(i + 2);
+      Value *current =
+          bodyFuncBuilder.create<LoadOp>(loc, cell, ArrayRef<Value *>(zero));
+      Value *merged = createCombine(bodyFuncBuilder, loc, reductions[i].kind,
+                                    current, outlinedLoop.getResult(i));
+      bodyFuncBuilder.create<StoreOp>(loc, merged, cell,
+                                      ArrayRef<Value *>(zero));
+    }
+    bodyFuncBuilder.create<CallOp>(loc, criticalEnd);
+  }
+  bodyFuncBuilder.create<ReturnOp>(loc);
+
+  // Replace the loop with the runtime dispatch. The cells are seeded with the
+  // initial values of the carried loop variables before the call and hold the
+  // final ones after it.
+  OpBuilder callBuilder(forOp.getOperation());
+  SmallVector<Value *, 4> lbOperands(forOp.getLowerBoundOperands());
+  SmallVector<Value *, 4> ubOperands(forOp.getUpperBoundOperands());
+  SmallVector<Value *, 8> callOperands;
+  callOperands.push_back(
+      materializeBound(callBuilder, loc, forOp.getLowerBoundMap(), lbOperands));
+  callOperands.push_back(
+      materializeBound(callBuilder, loc, forOp.getUpperBoundMap(), ubOperands));
+  SmallVector<Value *, 2> cells;
+  Value *callerZero = nullptr;
+  if (numCells != 0)
+    callerZero = callBuilder.create<ConstantIndexOp>(loc, 0);
+  for (unsigned i = 0, e = numCells; i != e; ++i) {
+    Value *cell = callBuilder.create<AllocOp>(
+        loc, cellTypes[i].cast<MemRefType>());
+    callBuilder.create<StoreOp>(loc,
+                                forOp.getIterOperand(reductions[i].position),
+                                cell, ArrayRef<Value *>(callerZero));
+    cells.push_back(cell);
+    callOperands.push_back(cell);
+  }
+  callOperands.append(captures.begin(), captures.end());
+  callBuilder.create<ParallelCallOp>(loc, body, callOperands);
+  for (unsigned i = 0, e = numCells; i != e; ++i) {
+    Value *finalValue = callBuilder.create<LoadOp>(
+        loc, cells[i], ArrayRef<Value *>(callerZero));
+    forOp.getResult(reductions[i].position)->replaceAllUsesWith(finalValue);
+    callBuilder.create<DeallocOp>(loc, cells[i]);
+  }
+  forOp.getOperation()->erase();
+  return true;
+}
+
+/// Walks 'block' top-down, outlining the outermost parallel loops and
+/// descending into loops that cannot be dispatched.
+void AffineParallelize::processBlock(Block &block, Function *parentFunc,
+                                     Module *module) {
+  for (auto it = block.begin(), e = block.end(); it != e;) {
+    Operation *op = &*it++;
+    if (auto forOp = dyn_cast<AffineForOp>(op)) {
+      SmallVector<LoopReduction, 2> reductions;
+      if (isLoopParallel(forOp, &reductions) &&
+          parallelizeLoop(forOp, parentFunc, module, reductions))
+        continue;
+    }
+    for (auto &region : op->getRegions())
+      for (auto &nested : region)
+        processBlock(nested, parentFunc, module);
+  }
+}
+
+void AffineParallelize::runOnModule() {
+  Module &module = getModule();
+  // Snapshot the function list: outlined bodies are appended to the module
+  // and must not be re-examined.
+  SmallVector<Function *, 8> funcs;
+  for (auto &func : module)
+    funcs.push_back(&func);
+  for (Function *func : funcs) {
+    if (func->isExternal())
+      continue;
+    outlinedCount = 0;
+    for (auto &block : *func)
+      processBlock(block, func, &module);
+  }
+}
+
+ModulePassBase *mlir::createAffineParallelizePass() {
+  return new AffineParallelize();
+}
+
+static PassRegistration<AffineParallelize>
+    pass("affine-parallelize",
+         "Outline parallel affine loops and dispatch them to the thread-pool "
+         "runtime");
@@ -0,0 +1,232 @@
+//===- AffineScalarReplacement.cpp - Promote memref elements to SSA -----*-===//
+//
+// Copyright 2019 The MLIR Authors.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+// =============================================================================
+//
+// This file implements a pass that promotes memref elements repeatedly
+// accessed inside an affine loop at loop-invariant indices to loop-carried
+// SSA values: the element is loaded once before the loop, carried through the
+// iterations, and stored back once after the loop. This removes the
+// per-iteration load/store traffic that 'memref-dataflow-opt' cannot touch
+// because the forwarded value would have to live out of the loop, and is what
+// lets reduction accumulators stay in registers.
+//
+//===----------------------------------------------------------------------===//
+
+#include "mlir/AffineOps/AffineOps.h"
+#include "mlir/Analysis/LoopAnalysis.h"
+#include "mlir/IR/Builders.h"
+#include "mlir/Pass/Pass.h"
+#include "mlir/StandardOps/Ops.h"
+#include "mlir/Transforms/Passes.h"
+#include "llvm/ADT/DenseMap.h"
+#include "llvm/ADT/SmallPtrSet.h"
+
+#define DEBUG_TYPE "affine-scalrep"
+
+using namespace mlir;
+
+namespace {
+
+// The promotion relies on three conditions:
+//
+// 1) every access to the memref inside the loop is a load or store in the
+// loop body block itself (not under an inner loop or an 'affine.if', where it
+// would execute a different number of times) with the same index operands,
+// so all of them touch one element,
+//
+// 2) the index operands are defined outside the loop, so the element does not
+// move between iterations,
+//
+// 3) the loop has a known constant trip count of at least one, so the load
+// hoisted before the loop and the store sunk after it are not speculative.
+//
+// Under these conditions the element behaves like a single scalar variable:
+// its value at the top of each iteration can be carried through the loop as
+// an SSA value, loads of it replaced by that value, and stores into it folded
+// into the value carried to the next iteration.
+
+/// All accesses to one memref element inside the loop body.
+struct ElementAccesses {
+  // The loop-invariant index operands, fixed by the first access seen.
+  SmallVector<Value *, 4> indices;
+  // The loads and stores on the element, in program order.
+  SmallVector<Operation *, 4> accesses;
+  bool hasStore = false;
+  // Set when the memref cannot be promoted (mismatching or variant indices).
+  bool invalid = false;
+};
+
+struct AffineScalarReplacement
+    : public FunctionPass<AffineScalarReplacement> {
+  void runOnFunction() override;
+
+  void promoteLoop(AffineForOp forOp);
+};
+
+} // end anonymous namespace
+
+/// Creates a pass that promotes repeatedly accessed single memref elements in
+/// affine loops to loop-carried SSA values.
+FunctionPassBase *mlir::createAffineScalarReplacementPass() {
+  return new AffineScalarReplacement();
+}
+
+/// Returns true if 'value' is defined outside the body of 'forOp'.
+static bool isDefinedOutsideLoop(Value *value, AffineForOp forOp) {
+  return !forOp.getRegion().isAncestor(value->getContainingRegion());
+}
+
+void AffineScalarReplacement::promoteLoop(AffineForOp forOp) {
+  // The hoisted load and the sunk store execute unconditionally; only promote
+  // when the loop body is known to execute so neither is speculative.
+  auto tripCount = getConstantTripCount(forOp);
+  if (!tripCount.hasValue() || tripCount.getValue() == 0)
+    return;
+
+  // Collect the loads and stores appearing directly in the loop body,
+  // bucketed by memref, checking that each memref is only ever accessed at
+  // one loop-invariant index list.
+  auto *body = forOp.getBody();
+  SmallVector<Value *, 4> memrefs;
+  DenseMap<Value *, ElementAccesses> elements;
+  for (auto &op : *body) {
+    Value *memref;
+    SmallVector<Value *, 4> indices;
+    if (auto loadOp = dyn_cast<LoadOp>(op)) {
+      memref = loadOp.getMemRef();
+      indices.append(loadOp.getIndices().begin(), loadOp.getIndices().end());
+    } else if (auto storeOp = dyn_cast<StoreOp>(op)) {
+      memref = storeOp.getMemRef();
+      indices.append(storeOp.getIndices().begin(), storeOp.getIndices().end());
+    } else {
+      continue;
+    }
+
+    auto it = elements.find(memref);
+    if (it == elements.end()) {
+      memrefs.push_back(memref);
+      it = elements.try_emplace(memref).first;
+      it->second.indices = indices;
+      // The element only stays fixed if its indices are loop-invariant.
+      for (auto *index : indices)
+        if (!isDefinedOutsideLoop(index, forOp))
+          it->second.invalid = true;
+    } else if (it->second.indices != indices) {
+      it->second.invalid = true;
+    }
+    it->second.accesses.push_back(&op);
+    it->second.hasStore |= isa<StoreOp>(op);
+  }
+
+  // Discard memrefs with any other use inside the loop: an access under an
+  // inner loop or 'affine.if', or an escaping use such as a call, may touch
+  // the element an unknown number of times.
+  for (auto *memref : memrefs) {
+    auto &element = elements[memref];
+    if (element.invalid)
+      continue;
+    SmallPtrSet<Operation *, 8> accessSet(element.accesses.begin(),
+                                          element.accesses.end());
+    for (auto *user : memref->getUsers()) {
+      if (accessSet.count(user))
+        continue;
+      if (forOp.getRegion().isAncestor(user->getContainingRegion())) {
+        element.invalid = true;
+        break;
+      }
+    }
+  }
+
+  // Hoist one load of each promotable element before the loop. Elements that
+  // are never written are a plain hoist; written ones become loop-carried.
+  OpBuilder b(forOp.getOperation());
+  auto loc = forOp.getLoc();
+  SmallVector<Value *, 4> carriedMemRefs, initValues;
+  for (auto *memref : memrefs) {
+    auto &element = elements[memref];
+    if (element.invalid)
+      continue;
+    auto initLoad = b.create<LoadOp>(loc, memref, element.indices);
+    if (!element.hasStore) {
+      for (auto *access : element.accesses) {
+        cast<LoadOp>(access).getResult()->replaceAllUsesWith(
+            initLoad.getResult());
+        access->erase();
+      }
+      continue;
+    }
+    carriedMemRefs.push_back(memref);
+    initValues.push_back(initLoad.getResult());
+  }
+  if (carriedMemRefs.empty())
+    return;
+
+  // Rebuild the loop with one loop-carried value per written element and
+  // splice the body over; operations are moved, not cloned, so handles into
+  // the body (including inner loops) stay valid.
+  SmallVector<Value *, 4> lbOperands(forOp.getLowerBoundOperands());
+  SmallVector<Value *, 4> ubOperands(forOp.getUpperBoundOperands());
+  auto newForOp = b.create<AffineForOp>(
+      loc, lbOperands, forOp.getLowerBoundMap(), ubOperands,
+      forOp.getUpperBoundMap(), forOp.getStep(), initValues);
+  auto *newBody = newForOp.getBody();
+  newBody->getOperations().splice(newBody->begin(), body->getOperations(),
+                                  body->begin(), std::prev(body->end()));
+  body->getArgument(0)->replaceAllUsesWith(newForOp.getInductionVar());
+
+  // Thread the carried value through the accesses in program order: a load
+  // sees the current value, a store becomes the new current value. The value
+  // after the last access is carried to the next iteration.
+  SmallVector<Value *, 4> nextIterValues;
+  for (unsigned i = 0, e = carriedMemRefs.size(); i != e; ++i) {
+    Value *current = newForOp.getRegionIterArgs()[i];
+    for (auto *access : elements[carriedMemRefs[i]].accesses) {
+      if (auto loadOp = dyn_cast<LoadOp>(access)) {
+        loadOp.getResult()->replaceAllUsesWith(current);
+      } else {
+        current = cast<StoreOp>(access).getValueToStore();
+      }
+      access->erase();
+    }
+    nextIterValues.push_back(current);
+  }
+
+  // Replace the placeholder terminator with one carrying the next-iteration
+  // values, and store the final values back after the loop.
+  auto *oldTerminator = &newBody->back();
+  OpBuilder(newBody, Block::iterator(oldTerminator))
+      .create<AffineTerminatorOp>(loc, nextIterValues);
+  oldTerminator->erase();
+  for (unsigned i = 0, e = carriedMemRefs.size(); i != e; ++i)
+    b.create<StoreOp>(loc, newForOp.getResult(i), carriedMemRefs[i],
+                      elements[carriedMemRefs[i]].indices);
+  forOp.erase();
+}
+
+void AffineScalarReplacement::runOnFunction() {
+  // Collect the loops first: promotion rebuilds a loop in place but moves the
+  // body operations, so handles to the other collected loops stay valid.
+  SmallVector<AffineForOp, 8> loops;
+  getFunction().walk<AffineForOp>(
+      [&](AffineForOp forOp) { loops.push_back(forOp); });
+  for (auto forOp : loops)
+    promoteLoop(forOp);
+}
+
+static PassRegistration<AffineScalarReplacement>
+    pass("affine-scalrep",
+         "Promote single memref elements accessed in affine loops to "
+         "loop-carried SSA values");
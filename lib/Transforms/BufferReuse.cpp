@@ -0,0 +1,157 @@
+//===- BufferReuse.cpp - Share allocations of disjoint lifetimes ----------===//
+//
+// Copyright 2019 The MLIR Authors.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// =============================================================================
+//
+// This pass shares the buffers of locally allocated memrefs whose lifetimes
+// do not overlap. Lowering turns every alloc into a separate malloc, so
+// without reuse the peak memory of a function is the sum of all its
+// intermediates even when they are live one after the other. For each block,
+// the pass computes the live range of every non-escaping alloc/dealloc pair
+// from the positions of its uses and greedily colors ranges of the same
+// memref type: a buffer whose dealloc precedes another buffer's alloc is
+// reused for it, the earlier dealloc is removed and the later alloc is
+// forwarded to the shared allocation. Greedy assignment on intervals uses the
+// minimum number of buffers per type.
+//
+//===----------------------------------------------------------------------===//
+
+#include "mlir/IR/Function.h"
+#include "mlir/IR/StandardTypes.h"
+#include "mlir/Pass/Pass.h"
+#include "mlir/StandardOps/Ops.h"
+#include "mlir/Transforms/Passes.h"
+#include "llvm/ADT/DenseMap.h"
+#include "llvm/ADT/STLExtras.h"
+
+using namespace mlir;
+
+namespace {
+/// A locally allocated buffer with a fully known live range.
+struct BufferInfo {
+  /// The allocation currently providing the storage.
+  Operation *alloc;
+  /// Position of the allocation in its block.
+  unsigned start;
+  /// Position of the last use; this is always the dealloc.
+  unsigned end;
+  /// The dealloc ending the live range.
+  Operation *dealloc;
+};
+
+/// Shares allocations of same-typed buffers with disjoint live ranges.
+struct BufferReuse : public FunctionPass<BufferReuse> {
+  void runOnFunction() override;
+};
+} // end anonymous namespace
+
+/// Computes the live range of 'alloc' within 'block' from the positions of
+/// the ancestors of its uses. Returns false if the buffer escapes - it is
+/// used other than as the memref of a load or store or by its dealloc, has a
+/// dynamic shape, or is not deallocated in 'block' after all other uses.
+static bool computeLiveRange(AllocOp alloc, Block *block,
+                             const llvm::DenseMap<Operation *, unsigned> &pos,
+                             BufferInfo &info) {
+  if (!alloc.getType().hasStaticShape())
+    return false;
+
+  info.alloc = alloc.getOperation();
+  info.start = pos.lookup(info.alloc);
+  info.end = info.start;
+  info.dealloc = nullptr;
+  for (auto &use : alloc.getResult()->getUses()) {
+    Operation *owner = use.getOwner();
+    // The buffer must not be captured: loads and stores address it, a store
+    // must not store the memref value itself.
+    if (isa<DeallocOp>(owner)) {
+      if (info.dealloc)
+        return false;
+      info.dealloc = owner;
+    } else if (isa<LoadOp>(owner)) {
+      // Always addresses the memref.
+    } else if (isa<StoreOp>(owner)) {
+      if (use.getOperandNumber() != 1)
+        return false;
+    } else {
+      return false;
+    }
+    Operation *ancestor = block->findAncestorInstInBlock(*owner);
+    if (!ancestor)
+      return false;
+    info.end = std::max(info.end, pos.lookup(ancestor));
+  }
+  // The dealloc must exist, be at the top level of the block and come last,
+  // otherwise the end of the live range is not known exactly.
+  return info.dealloc && info.dealloc->getBlock() == block &&
+         pos.lookup(info.dealloc) == info.end;
+}
+
+/// Colors the eligible buffers of 'block' and rewrites each reuse.
+static void reuseBuffersInBlock(Block *block) {
+  llvm::DenseMap<Operation *, unsigned> pos;
+  unsigned nextPos = 0;
+  for (auto &op : *block)
+    pos[&op] = nextPos++;
+
+  // Buffers indexed by type; block order gives ranges sorted by start, for
+  // which greedy reuse of any expired buffer is optimal.
+  llvm::DenseMap<Type, SmallVector<BufferInfo, 4>> buffersByType;
+  for (auto &op : llvm::make_early_inc_range(*block)) {
+    auto alloc = dyn_cast<AllocOp>(&op);
+    if (!alloc)
+      continue;
+    BufferInfo info;
+    if (!computeLiveRange(alloc, block, pos, info))
+      continue;
+
+    // Reuse a buffer of the same type whose live range has ended: its
+    // dealloc is removed, extending its storage over this range, and this
+    // alloc is forwarded to it. The new dealloc now frees the shared buffer.
+    auto &candidates = buffersByType[alloc.getType()];
+    auto it = llvm::find_if(candidates, [&](const BufferInfo &buffer) {
+      return buffer.end < info.start;
+    });
+    if (it == candidates.end()) {
+      candidates.push_back(info);
+      continue;
+    }
+    it->dealloc->erase();
+    it->dealloc = info.dealloc;
+    it->end = info.end;
+    alloc.getResult()->replaceAllUsesWith(it->alloc->getResult(0));
+    alloc.erase();
+  }
+}
+
+void BufferReuse::runOnFunction() {
+  for (Block &block : getFunction())
+    reuseBuffersInBlock(&block);
+  // Blocks inside loop bodies re-run their ops per iteration; an alloc and
+  // dealloc pair local to such a block still forms a disjoint range within
+  // one iteration, so nested blocks are processed the same way.
+  getFunction().walk([&](Operation *op) {
+    for (auto &region : op->getRegions())
+      for (Block &block : region)
+        reuseBuffersInBlock(&block);
+  });
+}
+
+FunctionPassBase *mlir::createBufferReusePass() { return new BufferReuse(); }
+
+static PassRegistration<BufferReuse>
+    pass("buffer-reuse",
+         "Share the allocations of same-typed memrefs with disjoint live "
+         "ranges");
@@ -32,12 +32,19 @@
 #include "llvm/ADT/Hashing.h"
 #include "llvm/ADT/ScopedHashTable.h"
 #include "llvm/Support/Allocator.h"
+#include "llvm/Support/CommandLine.h"
+#include "llvm/Support/Parallel.h"
 #include "llvm/Support/RecyclingAllocator.h"
 #include <deque>
 using namespace mlir;
 
+static llvm::cl::opt<bool> parallelIsolatedRegionCSE(
+    "mlir-parallel-isolated-region-cse",
+    llvm::cl::desc("Process isolated-from-above regions of a function on "
+                   "multiple threads during CSE"),
+    llvm::cl::init(false));
+
 namespace {
-// TODO(riverriddle) Handle commutative operations.
 struct SimpleOperationInfo : public llvm::DenseMapInfo<Operation *> {
   static unsigned getHashValue(const Operation *opC) {
     auto *op = const_cast<Operation *>(opC);
@@ -45,11 +52,21 @@ struct SimpleOperationInfo : public llvm::DenseMapInfo<Operation *> {
     //   - Operation Name
     //   - Attributes
     //   - Result Types
-    //   - Operands
-    return hash_combine(
+    auto hash = hash_combine(
         op->getName(), op->getAttrs(),
-        hash_combine_range(op->result_type_begin(), op->result_type_end()),
-        hash_combine_range(op->operand_begin(), op->operand_end()));
+        hash_combine_range(op->result_type_begin(), op->result_type_end()));
+
+    //   - Operands. Commutative operations hash their operands in a canonical
+    //     order so that `addf %a, %b` and `addf %b, %a` land in the same
+    //     bucket, without relying on canonicalization to reorder them first.
+    if (op->isCommutative()) {
+      SmallVector<Value *, 8> operands(op->operand_begin(), op->operand_end());
+      llvm::sort(operands);
+      return hash_combine(
+          hash, hash_combine_range(operands.begin(), operands.end()));
+    }
+    return hash_combine(
+        hash, hash_combine_range(op->operand_begin(), op->operand_end()));
   }
   static bool isEqual(const Operation *lhsC, const Operation *rhsC) {
     auto *lhs = const_cast<Operation *>(lhsC);
@@ -70,15 +87,52 @@ struct SimpleOperationInfo : public llvm::DenseMapInfo<Operation *> {
     // Compare attributes.
     if (lhs->getAttrs() != rhs->getAttrs())
       return false;
-    // Compare operands.
-    if (!std::equal(lhs->operand_begin(), lhs->operand_end(),
-                    rhs->operand_begin()))
+    // Compare operands. Commutative operations are compared with their
+    // operands in canonical order, matching the hash above.
+    if (lhs->isCommutative()) {
+      SmallVector<Value *, 8> lhsOperands(lhs->operand_begin(),
+                                          lhs->operand_end());
+      SmallVector<Value *, 8> rhsOperands(rhs->operand_begin(),
+                                          rhs->operand_end());
+      llvm::sort(lhsOperands);
+      llvm::sort(rhsOperands);
+      if (lhsOperands != rhsOperands)
+        return false;
+    } else if (!std::equal(lhs->operand_begin(), lhs->operand_end(),
+                           rhs->operand_begin())) {
       return false;
+    }
     // Compare result types.
     return std::equal(lhs->result_type_begin(), lhs->result_type_end(),
                       rhs->result_type_begin());
   }
 };
+
+/// An operation paired with its precomputed hash, used as the scoped map key.
+/// The hash visits the operation name, attributes, operand values and result
+/// types; computing it once per operation halves the hashing work since every
+/// visited operation is both looked up and potentially inserted.
+struct HashedOperation {
+  HashedOperation(Operation *op)
+      : op(op), hash(SimpleOperationInfo::getHashValue(op)) {}
+  HashedOperation(Operation *op, unsigned hash) : op(op), hash(hash) {}
+
+  Operation *op;
+  unsigned hash;
+};
+
+struct HashedOperationInfo {
+  static HashedOperation getEmptyKey() {
+    return {SimpleOperationInfo::getEmptyKey(), 0};
+  }
+  static HashedOperation getTombstoneKey() {
+    return {SimpleOperationInfo::getTombstoneKey(), 0};
+  }
+  static unsigned getHashValue(const HashedOperation &key) { return key.hash; }
+  static bool isEqual(const HashedOperation &lhs, const HashedOperation &rhs) {
+    return SimpleOperationInfo::isEqual(lhs.op, rhs.op);
+  }
+};
 } // end anonymous namespace
 
 namespace {
@@ -90,9 +144,9 @@ struct CSE : public FunctionPass<CSE> {
   /// Shared implementation of operation elimination and scoped map definitions.
   using AllocatorTy = llvm::RecyclingAllocator<
       llvm::BumpPtrAllocator,
-      llvm::ScopedHashTableVal<Operation *, Operation *>>;
-  using ScopedMapTy = llvm::ScopedHashTable<Operation *, Operation *,
-                                            SimpleOperationInfo, AllocatorTy>;
+      llvm::ScopedHashTableVal<HashedOperation, Operation *>>;
+  using ScopedMapTy = llvm::ScopedHashTable<HashedOperation, Operation *,
+                                            HashedOperationInfo, AllocatorTy>;
 
   /// Represents a single entry in the depth first traversal of a CFG.
   struct CFGStackNode {
@@ -112,23 +166,34 @@ struct CSE : public FunctionPass<CSE> {
 
   /// Attempt to eliminate a redundant operation. Returns success if the
   /// operation was marked for removal, failure otherwise.
-  LogicalResult simplifyOperation(ScopedMapTy &knownValues, Operation *op);
+  LogicalResult simplifyOperation(ScopedMapTy &knownValues, Operation *op,
+                                  std::vector<Operation *> &opsToErase);
 
+  /// The simplification walk. When `deferIsolated` is true, operations with
+  /// isolated-from-above regions are queued on `isolatedOps` for parallel
+  /// processing instead of being recursed into.
   void simplifyBlock(ScopedMapTy &knownValues, DominanceInfo &domInfo,
-                     Block *bb);
+                     Block *bb, std::vector<Operation *> &opsToErase,
+                     bool deferIsolated);
   void simplifyRegion(ScopedMapTy &knownValues, DominanceInfo &domInfo,
-                      Region &region);
+                      Region &region, std::vector<Operation *> &opsToErase,
+                      bool deferIsolated);
 
   void runOnFunction() override;
 
 private:
   /// Operations marked as dead and to be erased.
   std::vector<Operation *> opsToErase;
+
+  /// Operations with isolated-from-above regions whose processing was
+  /// deferred to the parallel phase.
+  std::vector<Operation *> isolatedOps;
 };
 } // end anonymous namespace
 
 /// Attempt to eliminate a redundant operation.
-LogicalResult CSE::simplifyOperation(ScopedMapTy &knownValues, Operation *op) {
+LogicalResult CSE::simplifyOperation(ScopedMapTy &knownValues, Operation *op,
+                                     std::vector<Operation *> &opsToErase) {
   // Don't simplify operations with nested blocks. We don't currently model
   // equality comparisons correctly among other things. It is also unclear
   // whether we would want to CSE such operations.
@@ -146,8 +211,10 @@ LogicalResult CSE::simplifyOperation(ScopedMapTy &knownValues, Operation *op) {
     return success();
   }
 
-  // Look for an existing definition for the operation.
-  if (auto *existing = knownValues.lookup(op)) {
+  // Look for an existing definition for the operation. The key is hashed once
+  // and reused for the insertion below.
+  HashedOperation key(op);
+  if (auto *existing = knownValues.lookup(key)) {
     // If we find one then replace all uses of the current operation with the
     // existing one and mark it for deletion.
     for (unsigned i = 0, e = existing->getNumResults(); i != e; ++i)
@@ -165,35 +232,47 @@ LogicalResult CSE::simplifyOperation(ScopedMapTy &knownValues, Operation *op) {
   }
 
   // Otherwise, we add this operation to the known values map.
-  knownValues.insert(op, op);
+  knownValues.insert(key, op);
   return failure();
 }
 
 void CSE::simplifyBlock(ScopedMapTy &knownValues, DominanceInfo &domInfo,
-                        Block *bb) {
+                        Block *bb, std::vector<Operation *> &opsToErase,
+                        bool deferIsolated) {
   for (auto &inst : *bb) {
     // If the operation is simplified, we don't process any held regions.
-    if (succeeded(simplifyOperation(knownValues, &inst)))
+    if (succeeded(simplifyOperation(knownValues, &inst, opsToErase)))
       continue;
 
     // If this operation is isolated above, we can't process nested regions with
     // the given 'knownValues' map. This would cause the insertion of implicit
-    // captures in explicit capture only regions.
+    // captures in explicit capture only regions. Unregistered operations are
+    // conservatively treated the same way. Regions known to be isolated also
+    // reference no values defined outside of them, which makes them safe to
+    // process on another thread; queue them when the parallel phase is
+    // enabled. Unregistered operations provide no such guarantee, so their
+    // regions are always processed in place.
     if (!inst.isRegistered() || inst.isKnownIsolatedFromAbove()) {
+      if (deferIsolated && inst.isKnownIsolatedFromAbove()) {
+        isolatedOps.push_back(&inst);
+        continue;
+      }
       ScopedMapTy nestedKnownValues;
       for (auto &region : inst.getRegions())
-        simplifyRegion(nestedKnownValues, domInfo, region);
+        simplifyRegion(nestedKnownValues, domInfo, region, opsToErase,
+                       /*deferIsolated=*/false);
       continue;
     }
 
     // Otherwise, process nested regions normally.
     for (auto &region : inst.getRegions())
-      simplifyRegion(knownValues, domInfo, region);
+      simplifyRegion(knownValues, domInfo, region, opsToErase, deferIsolated);
   }
 }
 
 void CSE::simplifyRegion(ScopedMapTy &knownValues, DominanceInfo &domInfo,
-                         Region &region) {
+                         Region &region, std::vector<Operation *> &opsToErase,
+                         bool deferIsolated) {
   // If the region is empty there is nothing to do.
   if (region.empty())
     return;
@@ -201,7 +280,8 @@ void CSE::simplifyRegion(ScopedMapTy &knownValues, DominanceInfo &domInfo,
   // If the region only contains one block, then simplify it directly.
   if (std::next(region.begin()) == region.end()) {
     ScopedMapTy::ScopeTy scope(knownValues);
-    simplifyBlock(knownValues, domInfo, &region.front());
+    simplifyBlock(knownValues, domInfo, &region.front(), opsToErase,
+                  deferIsolated);
     return;
   }
 
@@ -223,7 +303,8 @@ void CSE::simplifyRegion(ScopedMapTy &knownValues, DominanceInfo &domInfo,
     // Check to see if we need to process this node.
     if (!currentNode->processed) {
       currentNode->processed = true;
-      simplifyBlock(knownValues, domInfo, currentNode->node->getBlock());
+      simplifyBlock(knownValues, domInfo, currentNode->node->getBlock(),
+                    opsToErase, deferIsolated);
     }
 
     // Otherwise, check to see if we need to process a child node.
@@ -242,8 +323,27 @@ void CSE::simplifyRegion(ScopedMapTy &knownValues, DominanceInfo &domInfo,
 void CSE::runOnFunction() {
   /// A scoped hash table of defining operations within a function.
   ScopedMapTy knownValues;
-  simplifyRegion(knownValues, getAnalysis<DominanceInfo>(),
-                 getFunction().getBody());
+  auto &domInfo = getAnalysis<DominanceInfo>();
+  simplifyRegion(knownValues, domInfo, getFunction().getBody(), opsToErase,
+                 /*deferIsolated=*/parallelIsolatedRegionCSE);
+
+  // Process any deferred isolated-from-above operations on the thread pool.
+  // Each worker uses its own scoped map and erase list; isolated regions hold
+  // no references to outside values, so the workers never touch shared
+  // use lists.
+  if (!isolatedOps.empty()) {
+    std::vector<std::vector<Operation *>> workerOpsToErase(isolatedOps.size());
+    llvm::parallel::for_each_n(
+        llvm::parallel::par, size_t(0), isolatedOps.size(), [&](size_t i) {
+          ScopedMapTy nestedKnownValues;
+          for (auto &region : isolatedOps[i]->getRegions())
+            simplifyRegion(nestedKnownValues, domInfo, region,
+                           workerOpsToErase[i], /*deferIsolated=*/false);
+        });
+    for (auto &workerOps : workerOpsToErase)
+      opsToErase.insert(opsToErase.end(), workerOps.begin(), workerOps.end());
+    isolatedOps.clear();
+  }
 
   // If no operations were erased, then we mark all analyses as preserved.
   if (opsToErase.empty())
@@ -0,0 +1,115 @@
+//===- ConstantPooling.cpp - Pool duplicate constants ---------------------===//
+//
+// Copyright 2019 The MLIR Authors.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// =============================================================================
+//
+// This module pass pools duplicate elements-valued constants. FoldUtils and
+// inlining materialize constants at their point of use, so a large weight
+// tensor can end up as many identical ConstantOps. Within each function, one
+// copy is hoisted to the entry block and the duplicates are forwarded to it.
+// Constants cannot outlive functions in the standard dialect, so pooling is
+// per function; across functions the identical payloads already share a
+// single uniqued attribute in the MLIRContext, and it is the per-function
+// duplicates that multiply both IR size and the constants emitted when each
+// function is lowered.
+//
+//===----------------------------------------------------------------------===//
+
+#include "mlir/IR/Attributes.h"
+#include "mlir/IR/Function.h"
+#include "mlir/IR/Module.h"
+#include "mlir/Pass/Pass.h"
+#include "mlir/StandardOps/Ops.h"
+#include "mlir/Transforms/Passes.h"
+#include "llvm/Support/CommandLine.h"
+#include "llvm/Support/Parallel.h"
+
+using namespace mlir;
+
+static llvm::cl::opt<bool> parallelConstantPooling(
+    "mlir-parallel-constant-pooling",
+    llvm::cl::desc("Pool the constants of different functions on multiple "
+                   "threads"),
+    llvm::cl::init(false));
+
+static llvm::cl::opt<unsigned> clMinPooledElements(
+    "constant-pooling-min-elements",
+    llvm::cl::desc("Only pool elements-valued constants with at least this "
+                   "many elements"),
+    llvm::cl::init(1));
+
+namespace {
+/// Pools duplicate big constants: one ConstantOp per unique elements
+/// attribute and result type per function, hoisted to the entry block.
+struct ConstantPooling : public ModulePass<ConstantPooling> {
+  void runOnModule() override;
+};
+} // end anonymous namespace
+
+/// Pools the elements-valued constants of 'func'. Mutates only this function,
+/// so different functions can be processed concurrently.
+static void poolFunctionConstants(Function &func) {
+  if (func.empty())
+    return;
+
+  // Gather the pooling candidates first; hoisting while walking would
+  // disturb the traversal.
+  SmallVector<Operation *, 16> candidates;
+  func.walkOps<ConstantOp>([&](ConstantOp constOp) {
+    auto elements = constOp.getValue().dyn_cast<ElementsAttr>();
+    if (elements && elements.getType().getNumElements() >= clMinPooledElements)
+      candidates.push_back(constOp.getOperation());
+  });
+
+  Block &entryBlock = func.front();
+  llvm::DenseMap<std::pair<Attribute, Type>, Operation *> pool;
+  for (auto *op : candidates) {
+    auto constOp = cast<ConstantOp>(op);
+    auto key = std::make_pair(constOp.getValue(), constOp.getType());
+    auto inserted = pool.insert({key, op});
+    if (inserted.second) {
+      // First occurrence: hoist it to the start of the entry block so that it
+      // dominates every duplicate's uses.
+      op->moveBefore(&entryBlock, entryBlock.begin());
+      continue;
+    }
+    op->getResult(0)->replaceAllUsesWith(inserted.first->second->getResult(0));
+    op->erase();
+  }
+}
+
+void ConstantPooling::runOnModule() {
+  Module &module = getModule();
+  if (!parallelConstantPooling) {
+    for (auto &func : module)
+      poolFunctionConstants(func);
+    return;
+  }
+
+  SmallVector<Function *, 16> functions;
+  for (auto &func : module)
+    functions.push_back(&func);
+  llvm::parallel::for_each_n(
+      llvm::parallel::par, size_t(0), functions.size(),
+      [&](size_t i) { poolFunctionConstants(*functions[i]); });
+}
+
+ModulePassBase *mlir::createConstantPoolingPass() {
+  return new ConstantPooling();
+}
+
+static PassRegistration<ConstantPooling>
+    pass("constant-pooling", "Pool duplicate elements-valued constants");
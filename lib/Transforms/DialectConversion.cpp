@@ -24,13 +24,23 @@
 #include "mlir/Transforms/Utils.h"
 #include "llvm/ADT/SetVector.h"
 #include "llvm/ADT/SmallPtrSet.h"
+#include "llvm/Support/CommandLine.h"
 #include "llvm/Support/Debug.h"
+#include "llvm/Support/Parallel.h"
 #include "llvm/Support/raw_ostream.h"
+#include <atomic>
 
 using namespace mlir;
 
 #define DEBUG_TYPE "dialect-conversion"
 
+static llvm::cl::opt<bool> clParallelDialectConversion(
+    "mlir-parallel-dialect-conversion",
+    llvm::cl::desc("Convert the functions of a module to the target dialect "
+                   "on multiple threads, sharing one immutable legalization "
+                   "pattern set"),
+    llvm::cl::init(false));
+
 //===----------------------------------------------------------------------===//
 // ArgConverter
 //===----------------------------------------------------------------------===//
@@ -211,9 +221,8 @@ void ArgConverter::convertSignature(
     newArgMapping.push_back(convertArgument(arg, remappedValues, mapping));
   }
 
-  // Erase all of the original arguments.
-  for (unsigned i = 0; i != origArgCount; ++i)
-    block->eraseArgument(0, /*updatePredTerms=*/false);
+  // Erase all of the original arguments in one batch.
+  block->eraseArguments(0, origArgCount, /*updatePredTerms=*/false);
 }
 
 /// Converts the arguments of the given block.
@@ -241,9 +250,8 @@ LogicalResult ArgConverter::convertArguments(Block *block,
         convertArgument(block->getArgument(i), newArgs, mapping));
   }
 
-  // Erase all of the original arguments.
-  for (unsigned i = 0; i != origArgCount; ++i)
-    block->eraseArgument(0, /*updatePredTerms=*/false);
+  // Erase all of the original arguments in one batch.
+  block->eraseArguments(0, origArgCount, /*updatePredTerms=*/false);
   return success();
 }
 
@@ -321,7 +329,7 @@ struct DialectConversionRewriter final : public PatternRewriter {
 
   /// The kind of the block action performed during the rewrite.  Actions can be
   /// undone if the conversion fails.
-  enum class BlockActionKind { Split, Move };
+  enum class BlockActionKind { Create, Split, Move };
 
   /// Original position of the given block in its parent region.  We cannot use
   /// a region iterator because it could have been invalidated by other region
@@ -382,6 +390,14 @@ struct DialectConversionRewriter final : public PatternRewriter {
     for (auto &action :
          llvm::reverse(llvm::drop_begin(blockActions, numActionsToKeep))) {
       switch (action.kind) {
+      // Erase the block that was created. Any operations that were created
+      // within it have already been erased as part of popping the created
+      // operations.
+      case BlockActionKind::Create: {
+        assert(action.block->empty() && "expected created block to be empty");
+        action.block->erase();
+        break;
+      }
       // Merge back the block that was split out.
       case BlockActionKind::Split: {
         action.originalBlock->getOperations().splice(
@@ -419,11 +435,16 @@ struct DialectConversionRewriter final : public PatternRewriter {
   /// Apply all requested operation rewrites. This method is invoked when the
   /// conversion process succeeds.
   void applyRewrites() {
-    // Apply all of the rewrites replacements requested during conversion.
-    for (auto &repl : replacements) {
+    // Apply all of the value replacements requested during conversion in one
+    // batch.
+    SmallVector<std::pair<Value *, Value *>, 8> valueReplacements;
+    for (auto &repl : replacements)
       for (unsigned i = 0, e = repl.newValues.size(); i != e; ++i)
-        repl.op->getResult(i)->replaceAllUsesWith(repl.newValues[i]);
+        valueReplacements.push_back(
+            {repl.op->getResult(i), repl.newValues[i]});
+    Value::replaceAllUses(valueReplacements);
 
+    for (auto &repl : replacements) {
       // if this operation defines any regions, drop any pending argument
       // rewrites.
       if (repl.op->getNumRegions() && !argConverter.argMapping.empty()) {
@@ -454,6 +475,15 @@ struct DialectConversionRewriter final : public PatternRewriter {
     replacements.emplace_back(op, newValues);
   }
 
+  /// PatternRewriter hook notifying of a block created within a pattern, so
+  /// that it can be erased if the rewrites are rolled back.
+  void notifyBlockCreated(Block *block) override {
+    BlockAction action;
+    action.kind = BlockActionKind::Create;
+    action.block = block;
+    blockActions.push_back(action);
+  }
+
   /// PatternRewriter hook for splitting a block into two parts.
   Block *splitBlock(Block *block, Block::iterator before) override {
     auto *continuation = PatternRewriter::splitBlock(block, before);
@@ -480,11 +510,11 @@ struct DialectConversionRewriter final : public PatternRewriter {
     PatternRewriter::inlineRegionBefore(region, parent, before);
   }
 
-  /// PatternRewriter hook for creating a new operation.
-  Operation *createOperation(const OperationState &state) override {
-    auto *result = OpBuilder::createOperation(state);
-    createdOps.push_back(result);
-    return result;
+  /// PatternRewriter hook for inserting a newly created operation.
+  Operation *insert(Operation *op) override {
+    OpBuilder::insert(op);
+    createdOps.push_back(op);
+    return op;
   }
 
   /// PatternRewriter hook for updating the root operation in-place.
@@ -499,6 +529,13 @@ struct DialectConversionRewriter final : public PatternRewriter {
   void remapValues(Operation::operand_range operands,
                    SmallVectorImpl<Value *> &remapped) {
     remapped.reserve(llvm::size(operands));
+
+    // Until the first replacement is queued every lookup misses, so skip the
+    // per-operand hashing entirely.
+    if (mapping.empty()) {
+      remapped.assign(operands.begin(), operands.end());
+      return;
+    }
     for (Value *operand : operands)
       remapped.push_back(mapping.lookupOrDefault(operand));
   }
@@ -518,6 +555,12 @@ struct DialectConversionRewriter final : public PatternRewriter {
 
   /// Ordered list of block operations (creations, splits, motions).
   SmallVector<BlockAction, 4> blockActions;
+
+  /// The set of patterns currently applied on the legalization recursion
+  /// stack of this rewriter, used to detect cycles. This lives on the
+  /// rewriter rather than the legalizer so that one immutable legalizer can
+  /// drive the conversion of several functions concurrently.
+  llvm::SmallPtrSet<RewritePattern *, 8> appliedPatterns;
 };
 } // end anonymous namespace
 
@@ -580,14 +623,17 @@ public:
   }
 
   /// Attempt to legalize the given operation. Returns success if the operation
-  /// was legalized, failure otherwise.
-  LogicalResult legalize(Operation *op, DialectConversionRewriter &rewriter);
+  /// was legalized, failure otherwise. This is const: after construction the
+  /// legalizer is immutable and may be shared by conversions running on
+  /// several threads, with per-conversion state living on the rewriter.
+  LogicalResult legalize(Operation *op,
+                         DialectConversionRewriter &rewriter) const;
 
 private:
   /// Attempt to legalize the given operation by applying the provided pattern.
   /// Returns success if the operation was legalized, failure otherwise.
   LogicalResult legalizePattern(Operation *op, RewritePattern *pattern,
-                                DialectConversionRewriter &rewriter);
+                                DialectConversionRewriter &rewriter) const;
 
   /// Build an optimistic legalization graph given the provided patterns. This
   /// function populates 'legalizerPatterns' with the operations that are not
@@ -605,9 +651,6 @@ private:
   ///     prefer specific legalizations over others.
   void computeLegalizationGraphBenefit();
 
-  /// The current set of patterns that have been applied.
-  llvm::SmallPtrSet<RewritePattern *, 8> appliedPatterns;
-
   /// The set of legality information for operations transitively supported by
   /// the target.
   DenseMap<OperationName, LegalizationPatterns> legalizerPatterns;
@@ -619,7 +662,7 @@ private:
 
 LogicalResult
 OperationLegalizer::legalize(Operation *op,
-                             DialectConversionRewriter &rewriter) {
+                             DialectConversionRewriter &rewriter) const {
   LLVM_DEBUG(llvm::dbgs() << "Legalizing operation : " << op->getName()
                           << "\n");
 
@@ -656,7 +699,7 @@ OperationLegalizer::legalize(Operation *op,
 
 LogicalResult
 OperationLegalizer::legalizePattern(Operation *op, RewritePattern *pattern,
-                                    DialectConversionRewriter &rewriter) {
+                                    DialectConversionRewriter &rewriter) const {
   LLVM_DEBUG({
     llvm::dbgs() << "-* Applying rewrite pattern '" << op->getName() << " -> (";
     interleaveComma(pattern->getGeneratedOps(), llvm::dbgs());
@@ -667,7 +710,7 @@ OperationLegalizer::legalizePattern(Operation *op, RewritePattern *pattern,
   // applied twice in the same recursion stack.
   // TODO(riverriddle) We could eventually converge, but that requires more
   // complicated analysis.
-  if (!appliedPatterns.insert(pattern).second) {
+  if (!rewriter.appliedPatterns.insert(pattern).second) {
     LLVM_DEBUG(llvm::dbgs() << "-- FAIL: Pattern was already applied.\n");
     return failure();
   }
@@ -676,7 +719,7 @@ OperationLegalizer::legalizePattern(Operation *op, RewritePattern *pattern,
   auto cleanupFailure = [&] {
     // Reset the rewriter state and pop this pattern.
     rewriter.resetState(curState);
-    appliedPatterns.erase(pattern);
+    rewriter.appliedPatterns.erase(pattern);
     return failure();
   };
 
@@ -697,7 +740,7 @@ OperationLegalizer::legalizePattern(Operation *op, RewritePattern *pattern,
     }
   }
 
-  appliedPatterns.erase(pattern);
+  rewriter.appliedPatterns.erase(pattern);
   return success();
 }
 
@@ -955,6 +998,15 @@ LogicalResult FunctionConverter::convertFunction(
 
   DialectConversionRewriter rewriter(f->getBody(), typeConverter);
 
+  // Pre-size the remapping table and rewrite logs from the operation count of
+  // the function, so a full-function conversion does not pay for incremental
+  // re-hashing and re-allocation as it queues one replacement per operation.
+  // The count is cached on the function and only recomputed after mutations.
+  unsigned opCount = f->getCachedOpCount();
+  rewriter.mapping.reserve(opCount);
+  rewriter.createdOps.reserve(opCount);
+  rewriter.replacements.reserve(opCount);
+
   // Update the signature of the entry block.
   if (signatureConversion) {
     rewriter.argConverter.convertSignature(
@@ -1155,28 +1207,60 @@ LogicalResult mlir::applyConversionPatterns(
   if (fns.empty())
     return success();
 
-  // Build the function converter.
+  // Build the function converter. The legalization pattern set it compiles
+  // (including the per-op-kind dispatch index) is immutable afterwards and is
+  // shared by all function conversions below.
   FunctionConverter funcConverter(fns.front()->getContext(), target, patterns,
                                   &converter);
 
-  // Try to convert each of the functions within the module.
+  // Convert the signature and body of a single function.
   auto *ctx = fns.front()->getContext();
-  for (auto *func : fns) {
+  auto convertFn = [&](Function *func) -> LogicalResult {
     // Convert the function type using the type converter.
     auto conversion =
         converter.convertSignature(func->getType(), func->getAllArgAttrs());
     if (!conversion)
       return failure();
 
-    // Update the function signature.
+    // Update the function signature, remembering the original one so that it
+    // can be restored if the body fails to convert.
+    auto origType = func->getType();
+    SmallVector<NamedAttributeList, 4> origArgAttrs(
+        func->getAllArgAttrs().begin(), func->getAllArgAttrs().end());
     func->setType(conversion->getConvertedType(ctx));
     func->setAllArgAttrs(conversion->getConvertedArgAttrs());
 
-    // Convert the body of this function.
-    if (failed(funcConverter.convertFunction(func, &*conversion)))
+    // Convert the body of this function. The converter rolls back all of the
+    // rewrites it performed on failure, so to leave the function unmodified we
+    // only need to reinstate the original signature.
+    if (failed(funcConverter.convertFunction(func, &*conversion))) {
+      func->setType(origType);
+      func->setAllArgAttrs(origArgAttrs);
       return failure();
+    }
+    return success();
+  };
+
+  // Functions are converted independently, so with the parallel driver
+  // enabled each worker converts its own function against the shared frozen
+  // pattern set. All rewriter and cycle-detection state is per function.
+  if (clParallelDialectConversion && fns.size() > 1) {
+    std::atomic<bool> anyFailed(false);
+    llvm::parallel::for_each_n(llvm::parallel::par, size_t(0), fns.size(),
+                               [&](size_t i) {
+                                 if (anyFailed)
+                                   return;
+                                 if (failed(convertFn(fns[i])))
+                                   anyFailed = true;
+                               });
+    return failure(anyFailed);
   }
 
+  // Otherwise, try to convert each of the functions sequentially.
+  for (auto *func : fns)
+    if (failed(convertFn(func)))
+      return failure();
+
   return success();
 }
 
@@ -27,9 +27,11 @@
 #include "mlir/IR/Builders.h"
 #include "mlir/Pass/Pass.h"
 #include "mlir/StandardOps/Ops.h"
+#include "mlir/Transforms/LoopUtils.h"
 #include "mlir/Transforms/Passes.h"
 #include "mlir/Transforms/Utils.h"
 #include "llvm/ADT/MapVector.h"
+#include "llvm/ADT/SmallPtrSet.h"
 #include "llvm/Support/CommandLine.h"
 #include "llvm/Support/Debug.h"
 #include <algorithm>
@@ -53,6 +55,12 @@ static llvm::cl::opt<unsigned> clFastMemorySpace(
         "Fast memory space identifier for DMA generation (default: 1)"),
     llvm::cl::cat(clOptionsCategory));
 
+static llvm::cl::opt<bool> clDoubleBuffer(
+    "dma-double-buffer", llvm::cl::init(false),
+    llvm::cl::desc("Overlap the generated DMAs with computation by double "
+                   "buffering them (pipelines the loops they are placed in)"),
+    llvm::cl::cat(clOptionsCategory));
+
 static llvm::cl::opt<bool> clSkipNonUnitStrideLoop(
     "dma-skip-non-unit-stride-loops", llvm::cl::Hidden, llvm::cl::init(false),
     llvm::cl::desc("Testing purposes: avoid non-unit stride loop choice depths "
@@ -103,10 +111,19 @@ struct DmaGeneration : public FunctionPass<DmaGeneration> {
   SmallMapVector<Value *, std::unique_ptr<MemRefRegion>, 4> readRegions;
   SmallMapVector<Value *, std::unique_ptr<MemRefRegion>, 4> writeRegions;
 
+  // Memoizes region computation across accesses sharing the same footprint
+  // shape within a block; cleared before each block is processed since the
+  // DMA rewriting mutates the IR.
+  MemRefRegionCache regionCache;
+
   // Map from original memref's to the DMA buffers that their accesses are
   // replaced with.
   DenseMap<Value *, Value *> fastBufferMap;
 
+  // Loops into whose bodies DMA transfers were generated; these are pipelined
+  // at the end of the pass when double buffering is enabled.
+  llvm::SmallPtrSet<Operation *, 4> dmaLoopNests;
+
   // Slow memory space associated with DMAs.
   const unsigned slowMemorySpace;
   // Fast memory space associated with DMAs.
@@ -455,6 +472,14 @@ bool DmaGeneration::generateDma(const MemRefRegion &region, Block *block,
 
   *nBegin = wasAtStartOfBlock ? block->begin() : std::next(prev);
 
+  // If the transfer was placed in a loop body (i.e., the region varies with
+  // the surrounding IVs), remember that loop so it can be pipelined once the
+  // whole function has been processed.
+  if (clDoubleBuffer)
+    if (auto *placementOp = block->getContainingOp())
+      if (isa<AffineForOp>(placementOp))
+        dmaLoopNests.insert(placementOp);
+
   return true;
 }
 
@@ -600,6 +625,7 @@ uint64_t DmaGeneration::runOnBlock(Block::iterator begin, Block::iterator end) {
   readRegions.clear();
   writeRegions.clear();
   fastBufferMap.clear();
+  regionCache.clear();
 
   // To check for errors when walking the block.
   bool error = false;
@@ -620,7 +646,7 @@ uint64_t DmaGeneration::runOnBlock(Block::iterator begin, Block::iterator end) {
 
     // Compute the MemRefRegion accessed.
     auto region = llvm::make_unique<MemRefRegion>(opInst->getLoc());
-    if (failed(region->compute(opInst, dmaDepth))) {
+    if (failed(regionCache.compute(region.get(), opInst, dmaDepth))) {
       LLVM_DEBUG(llvm::dbgs()
                  << "Error obtaining memory region: semi-affine maps?\n");
       LLVM_DEBUG(llvm::dbgs() << "over-approximating to the entire memref\n");
@@ -767,8 +793,27 @@ void DmaGeneration::runOnFunction() {
     fastMemCapacityBytes = clFastMemoryCapacity * 1024;
   }
 
+  dmaLoopNests.clear();
   for (auto &block : f)
     runOnBlock(&block);
+
+  if (dmaLoopNests.empty())
+    return;
+
+  // Overlap the DMAs generated into loop bodies with the computation in them:
+  // double buffer the fast buffers and shift the waits by one iteration. The
+  // DMAs in such loop bodies were just generated by this pass, so the matching
+  // start/wait pairs that pipelining relies on are guaranteed to be present.
+  // Post order so that inner loop DMAs are pipelined first - pipelining a loop
+  // erases the loops nested within it.
+  SmallVector<AffineForOp, 4> dmaLoops;
+  f.walk<AffineForOp>([&](AffineForOp forOp) {
+    if (dmaLoopNests.count(forOp.getOperation()))
+      dmaLoops.push_back(forOp);
+  });
+  for (auto forOp : dmaLoops)
+    if (failed(pipelineDmaTransfer(forOp)))
+      LLVM_DEBUG(forOp.emitRemark("DMA double buffering failed"));
 }
 
 static PassRegistration<DmaGeneration>
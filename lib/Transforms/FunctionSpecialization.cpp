@@ -0,0 +1,283 @@
+//===- FunctionSpecialization.cpp - Specialize functions on shapes --------===//
+//
+// Copyright 2019 The MLIR Authors.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// =============================================================================
+//
+// This module pass clones functions per distinct static-shape signature
+// observed at their call sites. Shared subroutines are typically written
+// against dynamically shaped memrefs and tensors, so call sites cast their
+// statically shaped values to the generic signature and every caller pays for
+// genericity at runtime. Where a call operand is produced by a memref_cast or
+// tensor_cast that erases static shape information, the pass clones the
+// callee with the operand's original static type, rewrites the call to bypass
+// the cast, and leaves it to shape-dependent folding to collapse the
+// specialized body. Clones are deduplicated per (function, signature) pair
+// and themselves rescanned, so specialization propagates down call chains.
+//
+//===----------------------------------------------------------------------===//
+
+#include "mlir/IR/BlockAndValueMapping.h"
+#include "mlir/IR/Builders.h"
+#include "mlir/IR/Function.h"
+#include "mlir/IR/Module.h"
+#include "mlir/IR/StandardTypes.h"
+#include "mlir/Pass/Pass.h"
+#include "mlir/StandardOps/Ops.h"
+#include "mlir/Transforms/Passes.h"
+#include "llvm/ADT/Twine.h"
+#include "llvm/Support/CommandLine.h"
+
+using namespace mlir;
+
+static llvm::cl::opt<unsigned> clMaxClonesPerFunction(
+    "specialize-max-clones",
+    llvm::cl::desc("Maximum number of specialized clones of one function"),
+    llvm::cl::init(8));
+
+namespace {
+/// Clones functions per distinct static-shape signature at their call sites
+/// and rewrites the calls to target the clones.
+struct FunctionSpecialization : public ModulePass<FunctionSpecialization> {
+  void runOnModule() override;
+
+  /// Returns a clone of 'callee' with the argument types of 'specializedType',
+  /// reusing an existing clone for the same signature. Returns nullptr if
+  /// 'callee' has reached its clone budget.
+  Function *getOrCreateSpecialization(Function *callee,
+                                      FunctionType specializedType);
+
+  /// Rewrites the eligible calls in the body of 'func'.
+  void specializeCallsInFunction(Function &func);
+
+  /// Specialized clones not yet scanned for further opportunities.
+  std::vector<Function *> worklist;
+
+  /// Existing clones, keyed by the original function and the specialized
+  /// signature. Signatures are uniqued types, so the key is a cheap pair.
+  llvm::DenseMap<std::pair<Function *, Type>, Function *> specializations;
+
+  /// Number of clones created per original function.
+  llvm::DenseMap<Function *, unsigned> numClones;
+};
+} // end anonymous namespace
+
+/// Returns true if 'refined' carries strictly more static shape information
+/// than 'generic'. Both types stem from the two sides of a shape cast, so
+/// element types and ranks are already known to be compatible.
+static bool isShapeRefinement(Type refined, Type generic) {
+  auto refinedShape = refined.dyn_cast<ShapedType>();
+  auto genericShape = generic.dyn_cast<ShapedType>();
+  if (!refinedShape || !genericShape || !refinedShape.hasRank())
+    return false;
+  if (!genericShape.hasRank())
+    return true;
+  return refinedShape.getNumDynamicDims() < genericShape.getNumDynamicDims();
+}
+
+/// If 'value' is produced by a shape cast that erased static shape
+/// information, returns the cast's source, otherwise nullptr.
+static Value *getRefinedSource(Value *value) {
+  auto *defOp = value->getDefiningOp();
+  if (!defOp)
+    return nullptr;
+  Value *source = nullptr;
+  if (auto memRefCast = dyn_cast<MemRefCastOp>(defOp))
+    source = memRefCast.getOperand();
+  else if (auto tensorCast = dyn_cast<TensorCastOp>(defOp))
+    source = tensorCast.getOperand();
+  if (source && isShapeRefinement(source->getType(), value->getType()))
+    return source;
+  return nullptr;
+}
+
+/// Casts 'value' back to 'expectedType' right before 'op' and makes operand
+/// 'operandIdx' of 'op' use the cast. The cast direction is static to dynamic
+/// and therefore always valid.
+static void castOperandBack(Operation *op, unsigned operandIdx,
+                            Type expectedType) {
+  Value *value = op->getOperand(operandIdx);
+  OpBuilder builder(op);
+  Value *cast;
+  if (value->getType().isa<MemRefType>())
+    cast =
+        builder.create<MemRefCastOp>(op->getLoc(), value, expectedType)
+            .getResult();
+  else
+    cast = builder.create<TensorCastOp>(op->getLoc(), value, expectedType)
+               .getResult();
+  op->setOperand(operandIdx, cast);
+}
+
+/// Restores the typing contracts of the body of 'func' after its arguments
+/// were given more static types. Most standard and affine operations are
+/// shape polymorphic in their memref and tensor operands; the exceptions are
+/// operations whose operand types are coupled to an external signature -
+/// calls, returns and successor arguments - which get an explicit cast back
+/// to the generic type.
+static void restoreTypeContracts(Function &func) {
+  Module *module = func.getModule();
+  func.walk([&](Operation *op) {
+    if (auto call = dyn_cast<CallOp>(op)) {
+      auto calleeType = module->getNamedFunction(call.getCallee())->getType();
+      for (unsigned i = 0, e = op->getNumOperands(); i != e; ++i)
+        if (op->getOperand(i)->getType() != calleeType.getInput(i))
+          castOperandBack(op, i, calleeType.getInput(i));
+      return;
+    }
+    if (auto call = dyn_cast<CallIndirectOp>(op)) {
+      auto calleeType =
+          call.getCallee()->getType().cast<FunctionType>();
+      for (unsigned i = 0, e = calleeType.getNumInputs(); i != e; ++i)
+        if (op->getOperand(i + 1)->getType() != calleeType.getInput(i))
+          castOperandBack(op, i + 1, calleeType.getInput(i));
+      return;
+    }
+    if (isa<ReturnOp>(op)) {
+      auto resultTypes = func.getType().getResults();
+      for (unsigned i = 0, e = op->getNumOperands(); i != e; ++i)
+        if (op->getOperand(i)->getType() != resultTypes[i])
+          castOperandBack(op, i, resultTypes[i]);
+      return;
+    }
+    SmallVector<unsigned, 4> succOperandIndices;
+    if (op->getNumSuccessors() != 0)
+      op->getSuccessorOperandIndices(succOperandIndices);
+    for (unsigned succ = 0, e = op->getNumSuccessors(); succ != e; ++succ) {
+      Block *dest = op->getSuccessor(succ);
+      unsigned firstOperand = succOperandIndices[succ];
+      for (unsigned i = 0, n = op->getNumSuccessorOperands(succ); i != n; ++i) {
+        Type expected = dest->getArgument(i)->getType();
+        if (op->getOperand(firstOperand + i)->getType() != expected)
+          castOperandBack(op, firstOperand + i, expected);
+      }
+    }
+  });
+}
+
+Function *
+FunctionSpecialization::getOrCreateSpecialization(Function *callee,
+                                                  FunctionType specializedType) {
+  auto existing = specializations.find({callee, specializedType});
+  if (existing != specializations.end())
+    return existing->second;
+  unsigned &cloneCount = numClones[callee];
+  if (cloneCount >= clMaxClonesPerFunction)
+    return nullptr;
+
+  // Pick an unused name derived from the callee's.
+  Module *module = callee->getModule();
+  std::string name;
+  do {
+    name = (callee->getName().str() + llvm::Twine("_spec") + llvm::Twine(cloneCount))
+               .str();
+    ++cloneCount;
+  } while (module->getNamedFunction(name));
+
+  auto *specialized = new Function(callee->getLoc(), name, specializedType);
+  for (unsigned i = 0, e = callee->getNumArguments(); i != e; ++i)
+    specialized->setArgAttrs(i, callee->getArgAttrs(i));
+  module->getFunctions().push_back(specialized);
+
+  // Clone the body onto the specialized arguments. Blocks are created up
+  // front so that successors of cloned terminators can be remapped.
+  specialized->addEntryBlock();
+  BlockAndValueMapping mapper;
+  Block &oldEntry = callee->front();
+  Block &newEntry = specialized->front();
+  mapper.map(&oldEntry, &newEntry);
+  for (unsigned i = 0, e = callee->getNumArguments(); i != e; ++i)
+    mapper.map(oldEntry.getArgument(i), newEntry.getArgument(i));
+  for (auto it = std::next(callee->begin()); it != callee->end(); ++it) {
+    auto *newBlock = new Block();
+    specialized->push_back(newBlock);
+    mapper.map(&*it, newBlock);
+    for (auto *arg : it->getArguments())
+      mapper.map(arg, newBlock->addArgument(arg->getType()));
+  }
+  for (auto &oldBlock : *callee) {
+    OpBuilder builder(mapper.lookup(&oldBlock));
+    for (auto &op : oldBlock)
+      builder.clone(op, mapper);
+  }
+
+  restoreTypeContracts(*specialized);
+  specializations[{callee, specializedType}] = specialized;
+  worklist.push_back(specialized);
+  return specialized;
+}
+
+void FunctionSpecialization::specializeCallsInFunction(Function &func) {
+  // Gather the calls first; rewriting splices new operations into the walk.
+  SmallVector<Operation *, 8> calls;
+  func.walkOps<CallOp>(
+      [&](CallOp callOp) { calls.push_back(callOp.getOperation()); });
+
+  Module *module = func.getModule();
+  for (auto *op : calls) {
+    auto call = cast<CallOp>(op);
+    Function *callee = module->getNamedFunction(call.getCallee());
+    if (!callee || callee->empty())
+      continue;
+
+    // Compute the specialized signature from the operands that look through
+    // a shape-erasing cast.
+    SmallVector<Value *, 8> newOperands;
+    SmallVector<Type, 8> newInputTypes;
+    bool anyRefined = false;
+    for (auto *operand : op->getOperands()) {
+      if (Value *source = getRefinedSource(operand)) {
+        operand = source;
+        anyRefined = true;
+      }
+      newOperands.push_back(operand);
+      newInputTypes.push_back(operand->getType());
+    }
+    if (!anyRefined)
+      continue;
+
+    auto specializedType = FunctionType::get(
+        newInputTypes, callee->getType().getResults(), callee->getContext());
+    Function *specialized = getOrCreateSpecialization(callee, specializedType);
+    if (!specialized)
+      continue;
+
+    OpBuilder builder(op);
+    auto newCall =
+        builder.create<CallOp>(op->getLoc(), specialized, newOperands);
+    for (unsigned i = 0, e = op->getNumResults(); i != e; ++i)
+      op->getResult(i)->replaceAllUsesWith(
+          newCall.getOperation()->getResult(i));
+    op->erase();
+  }
+}
+
+void FunctionSpecialization::runOnModule() {
+  for (auto &func : getModule())
+    worklist.push_back(&func);
+  while (!worklist.empty()) {
+    Function *func = worklist.back();
+    worklist.pop_back();
+    specializeCallsInFunction(*func);
+  }
+}
+
+ModulePassBase *mlir::createFunctionSpecializationPass() {
+  return new FunctionSpecialization();
+}
+
+static PassRegistration<FunctionSpecialization>
+    pass("specialize-functions",
+         "Clone functions per static-shape signature at their call sites");
@@ -0,0 +1,246 @@
+//===- Inliner.cpp - Inline calls to small functions ----------------------===//
+//
+// Copyright 2019 The MLIR Authors.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// =============================================================================
+//
+// This module pass inlines direct calls to small functions. Call-heavy
+// modules otherwise run every pass over many tiny functions and pay call
+// overhead in the generated code. The call graph is taken from the
+// CallGraphIndex analysis and traversed bottom-up in strongly connected
+// component order, so a callee reaches its final size before its callers
+// decide whether to absorb it. Callee size is measured with the same op-count
+// estimator that bounds unrolling, keeping the two code growth budgets
+// comparable. Functions whose callees all lie in lower SCC levels can be
+// processed independently, so each level is optionally inlined in parallel.
+//
+//===----------------------------------------------------------------------===//
+
+#include "mlir/Analysis/CallGraphIndex.h"
+#include "mlir/Analysis/LoopAnalysis.h"
+#include "mlir/IR/BlockAndValueMapping.h"
+#include "mlir/IR/Builders.h"
+#include "mlir/IR/Function.h"
+#include "mlir/IR/Module.h"
+#include "mlir/Pass/Pass.h"
+#include "mlir/StandardOps/Ops.h"
+#include "mlir/Transforms/Passes.h"
+#include "llvm/ADT/DenseSet.h"
+#include "llvm/Support/CommandLine.h"
+#include "llvm/Support/Parallel.h"
+
+using namespace mlir;
+
+static llvm::cl::opt<unsigned> clInlineMaxCalleeSize(
+    "inline-max-callee-size",
+    llvm::cl::desc("Only inline callees whose estimated body size, in the "
+                   "units of the unroll cost model, is at most this"),
+    llvm::cl::init(32));
+
+static llvm::cl::opt<bool> parallelInlining(
+    "mlir-parallel-inlining",
+    llvm::cl::desc("Inline into independent functions of the same call graph "
+                   "level on multiple threads"),
+    llvm::cl::init(false));
+
+namespace {
+/// Inlines direct calls to small single-block functions, visiting callees
+/// before their callers.
+struct Inliner : public ModulePass<Inliner> {
+  void runOnModule() override;
+};
+} // end anonymous namespace
+
+/// Returns true if the body of 'callee' can be spliced into a caller: it must
+/// be defined and consist of a single block ending in a std.return. Inlining
+/// a multi-block body would require splitting the caller's block, which the
+/// affine dialect does not permit inside loops.
+static bool isInlinableCallee(Function *callee) {
+  if (callee->empty() ||
+      std::next(callee->getBlocks().begin()) != callee->getBlocks().end())
+    return false;
+  return isa<ReturnOp>(callee->front().back());
+}
+
+/// Inlines the single-block body of 'callee' before 'call' and erases the
+/// call. The callee must satisfy isInlinableCallee.
+static void inlineCallBody(CallOp call, Function *callee) {
+  Operation *callOp = call.getOperation();
+  Block &calleeBlock = callee->front();
+
+  // Wire the callee's formal arguments to the actual operands of the call.
+  BlockAndValueMapping mapping;
+  for (unsigned i = 0, e = callOp->getNumOperands(); i != e; ++i)
+    mapping.map(calleeBlock.getArgument(i), callOp->getOperand(i));
+
+  // Clone the body before the call; cloning through the mapping rewires the
+  // cloned operations to each other and to the call operands.
+  OpBuilder builder(callOp);
+  for (auto it = calleeBlock.begin(), e = std::prev(calleeBlock.end()); it != e;
+       ++it)
+    builder.clone(*it, mapping);
+
+  // Forward the returned values to the uses of the call results.
+  auto returnOp = cast<ReturnOp>(calleeBlock.back());
+  for (unsigned i = 0, e = callOp->getNumResults(); i != e; ++i)
+    callOp->getResult(i)->replaceAllUsesWith(
+        mapping.lookupOrDefault(returnOp.getOperand(i)));
+  callOp->erase();
+}
+
+/// Computes the strongly connected components of the callee graph of 'module'
+/// with an iterative Tarjan walk. Components are appended to 'sccs' bottom-up:
+/// every callee outside a function's own component belongs to a component
+/// with a smaller index. 'sccIds' maps each function to its component index.
+static void
+computeBottomUpSCCs(Module &module, const CallGraphIndex &index,
+                    llvm::DenseMap<Function *, unsigned> &sccIds,
+                    std::vector<SmallVector<Function *, 4>> &sccs) {
+  unsigned nextDfsIndex = 0;
+  llvm::DenseMap<Function *, unsigned> dfsIndex, lowLink;
+  SmallVector<Function *, 16> sccStack;
+  llvm::DenseSet<Function *> onSccStack;
+
+  struct Frame {
+    Function *func;
+    SmallVector<Function *, 8> callees;
+    unsigned nextCallee;
+  };
+  SmallVector<Frame, 16> dfsStack;
+
+  auto openNode = [&](Function *func) {
+    dfsIndex[func] = lowLink[func] = nextDfsIndex++;
+    sccStack.push_back(func);
+    onSccStack.insert(func);
+    dfsStack.push_back({func, index.getCallees(func), 0});
+  };
+
+  for (auto &rootFunc : module) {
+    if (dfsIndex.count(&rootFunc))
+      continue;
+    openNode(&rootFunc);
+    while (!dfsStack.empty()) {
+      Frame &frame = dfsStack.back();
+      if (frame.nextCallee != frame.callees.size()) {
+        Function *callee = frame.callees[frame.nextCallee++];
+        auto it = dfsIndex.find(callee);
+        if (it == dfsIndex.end())
+          openNode(callee);
+        else if (onSccStack.count(callee))
+          lowLink[frame.func] = std::min(lowLink[frame.func], it->second);
+        continue;
+      }
+
+      // All callees visited: propagate the low link to the parent and pop a
+      // component if this node is its root.
+      Function *func = frame.func;
+      dfsStack.pop_back();
+      if (!dfsStack.empty())
+        lowLink[dfsStack.back().func] =
+            std::min(lowLink[dfsStack.back().func], lowLink[func]);
+      if (lowLink[func] != dfsIndex[func])
+        continue;
+      sccs.emplace_back();
+      Function *member;
+      do {
+        member = sccStack.pop_back_val();
+        onSccStack.erase(member);
+        sccIds[member] = sccs.size() - 1;
+        sccs.back().push_back(member);
+      } while (member != func);
+    }
+  }
+}
+
+/// Inlines eligible calls in the body of 'func'. A call is inlined if its
+/// callee is a different component of the call graph (inlining within a
+/// component would chase recursion), is inlinable and fits the size budget.
+/// Mutates only this function, so functions whose callees have all reached
+/// their final size can be processed concurrently.
+static void
+inlineCallsInFunction(Function &func, Module &module,
+                      const llvm::DenseMap<Function *, unsigned> &sccIds,
+                      const llvm::DenseMap<Function *, uint64_t> &calleeSizes) {
+  // Gather the calls first; inlining splices new operations - including new
+  // calls, which were already weighed inside the callee - into the walk.
+  SmallVector<Operation *, 8> calls;
+  func.walkOps<CallOp>(
+      [&](CallOp callOp) { calls.push_back(callOp.getOperation()); });
+
+  unsigned funcSCC = sccIds.lookup(&func);
+  for (auto *op : calls) {
+    auto call = cast<CallOp>(op);
+    Function *callee = module.getNamedFunction(call.getCallee());
+    if (!callee || sccIds.lookup(callee) == funcSCC ||
+        !isInlinableCallee(callee))
+      continue;
+    if (calleeSizes.lookup(callee) > clInlineMaxCalleeSize)
+      continue;
+    inlineCallBody(call, callee);
+  }
+}
+
+void Inliner::runOnModule() {
+  Module &module = getModule();
+  CallGraphIndex index(module);
+
+  llvm::DenseMap<Function *, unsigned> sccIds;
+  std::vector<SmallVector<Function *, 4>> sccs;
+  computeBottomUpSCCs(module, index, sccIds, sccs);
+
+  // Assign each component a level such that every callee component of its
+  // members lies on a strictly lower level. Components on the same level do
+  // not call into each other, so their functions are independent.
+  std::vector<unsigned> sccLevel(sccs.size(), 0);
+  unsigned numLevels = 1;
+  for (unsigned i = 0, e = sccs.size(); i != e; ++i) {
+    for (Function *func : sccs[i])
+      for (Function *callee : index.getCallees(func)) {
+        unsigned calleeSCC = sccIds.lookup(callee);
+        if (calleeSCC != i)
+          sccLevel[i] = std::max(sccLevel[i], sccLevel[calleeSCC] + 1);
+      }
+    numLevels = std::max(numLevels, sccLevel[i] + 1);
+  }
+
+  std::vector<SmallVector<Function *, 8>> levels(numLevels);
+  for (unsigned i = 0, e = sccs.size(); i != e; ++i)
+    for (Function *func : sccs[i])
+      levels[sccLevel[i]].push_back(func);
+
+  // Process the levels bottom-up. Callee sizes are recorded after a level is
+  // done, so callers always see the size a callee grew to, and the parallel
+  // path only reads sizes of lower, already finalized levels.
+  llvm::DenseMap<Function *, uint64_t> calleeSizes;
+  for (auto &level : levels) {
+    if (!parallelInlining) {
+      for (Function *func : level)
+        inlineCallsInFunction(*func, module, sccIds, calleeSizes);
+    } else {
+      llvm::parallel::for_each_n(llvm::parallel::par, size_t(0), level.size(),
+                                 [&](size_t i) {
+                                   inlineCallsInFunction(*level[i], module,
+                                                         sccIds, calleeSizes);
+                                 });
+    }
+    for (Function *func : level)
+      calleeSizes[func] = getApproximateOpCount(*func);
+  }
+}
+
+ModulePassBase *mlir::createInlinerPass() { return new Inliner(); }
+
+static PassRegistration<Inliner> pass("inline",
+                                      "Inline calls to small functions");
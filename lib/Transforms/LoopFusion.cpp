@@ -27,6 +27,7 @@
 #include "mlir/IR/AffineExpr.h"
 #include "mlir/IR/AffineMap.h"
 #include "mlir/IR/Builders.h"
+#include "mlir/IR/Diagnostics.h"
 #include "mlir/Pass/Pass.h"
 #include "mlir/StandardOps/Ops.h"
 #include "mlir/Transforms/LoopFusionUtils.h"
@@ -168,6 +169,10 @@ public:
     SmallVector<Operation *, 4> loads;
     // List of store op insts.
     SmallVector<Operation *, 4> stores;
+    // Incremented whenever the node's load/store lists or adjacent edges
+    // change. Used by GreedyFusion to invalidate memoized fusion rejections
+    // involving this node.
+    unsigned stateCount = 0;
     Node(unsigned id, Operation *op) : id(id), op(op) {}
 
     // Returns the load op count for 'memref'.
@@ -255,6 +260,15 @@ public:
 
   MemRefDependenceGraph() {}
 
+  /// Analysis constructor: builds the dependence graph for the given
+  /// function so that it can be cached by the pass analysis manager. Check
+  /// 'initialized' before use; initialization fails on functions this graph
+  /// cannot represent (e.g. multi-block functions).
+  explicit MemRefDependenceGraph(Function *f) { initialized = init(*f); }
+
+  // Whether the analysis constructor successfully initialized the graph.
+  bool initialized = false;
+
   // Initializes the dependence graph based on operations in 'f'.
   // Returns true on success, false otherwise.
   bool init(Function &f);
@@ -355,6 +369,13 @@ public:
     return hasOutEdge && hasInEdge;
   }
 
+  // Bumps the state count of node 'id' if it is still in the graph.
+  void bumpNodeState(unsigned id) {
+    auto it = nodes.find(id);
+    if (it != nodes.end())
+      ++it->second.stateCount;
+  }
+
   // Adds an edge from node 'srcId' to node 'dstId' for 'value'.
   void addEdge(unsigned srcId, unsigned dstId, Value *value) {
     if (!hasEdge(srcId, dstId, value)) {
@@ -362,6 +383,8 @@ public:
       inEdges[dstId].push_back({srcId, value});
       if (value->getType().isa<MemRefType>())
         memrefEdgeCount[value]++;
+      bumpNodeState(srcId);
+      bumpNodeState(dstId);
     }
   }
 
@@ -387,6 +410,8 @@ public:
         break;
       }
     }
+    bumpNodeState(srcId);
+    bumpNodeState(dstId);
   }
 
   // Returns true if there is a path in the dependence graph from node 'srcId'
@@ -572,12 +597,14 @@ public:
       node->loads.push_back(loadOpInst);
     for (auto *storeOpInst : stores)
       node->stores.push_back(storeOpInst);
+    ++node->stateCount;
   }
 
   void clearNodeLoadAndStores(unsigned id) {
     Node *node = getNode(id);
     node->loads.clear();
     node->stores.clear();
+    ++node->stateCount;
   }
 
   // Calls 'callback' for each input edge incident to node 'id' which carries a
@@ -1403,6 +1430,32 @@ public:
 
   using Node = MemRefDependenceGraph::Node;
 
+  // Memoized fusion rejections: maps a ((srcId, dstId), memref) candidate
+  // pair to the state counts of both nodes when profitability or slice
+  // computation rejected it. The pair is re-evaluated only after one of its
+  // endpoints changes, so the worklist passes stop re-running the expensive
+  // slice computation for pairs they have already rejected.
+  DenseMap<std::pair<std::pair<unsigned, unsigned>, Value *>,
+           std::pair<unsigned, unsigned>>
+      rejectedPairs;
+
+  // Returns true if the (srcId, dstId, memref) candidate was rejected and
+  // neither endpoint has changed since.
+  bool isRejectedPair(unsigned srcId, unsigned dstId, Value *memref) {
+    auto it = rejectedPairs.find({{srcId, dstId}, memref});
+    if (it == rejectedPairs.end())
+      return false;
+    return it->second == std::make_pair(mdg->getNode(srcId)->stateCount,
+                                        mdg->getNode(dstId)->stateCount);
+  }
+
+  // Records that the (srcId, dstId, memref) candidate was rejected in the
+  // current state of both nodes.
+  void markRejectedPair(unsigned srcId, unsigned dstId, Value *memref) {
+    rejectedPairs[{{srcId, dstId}, memref}] = {
+        mdg->getNode(srcId)->stateCount, mdg->getNode(dstId)->stateCount};
+  }
+
   GreedyFusion(MemRefDependenceGraph *mdg, unsigned localBufSizeThreshold,
                Optional<unsigned> fastMemorySpace, bool maximalFusion)
       : mdg(mdg), localBufSizeThreshold(localBufSizeThreshold),
@@ -1498,8 +1551,15 @@ public:
           bool writesToLiveInOrOut =
               mdg->writesToLiveInOrEscapingMemrefs(srcNode->id);
           if (writesToLiveInOrOut &&
-              !canFuseSrcWhichWritesToLiveOut(srcId, dstId, memref, mdg))
+              !canFuseSrcWhichWritesToLiveOut(srcId, dstId, memref, mdg)) {
+            if (OptRemark::isEnabled("affine-loop-fusion"))
+              OptRemark::missed(srcNode->op->getLoc(), "affine-loop-fusion",
+                                "fuse",
+                                "source loop nest writes to a live-out or "
+                                "escaping memref that the consumer does not "
+                                "fully cover");
             continue;
+          }
 
           // Skip if 'srcNode' out edge count on 'memref' > 'maxSrcUserCount'.
           if (mdg->getOutEdgeCount(srcNode->id, memref) > maxSrcUserCount)
@@ -1512,6 +1572,11 @@ public:
           if (insertPointInst == nullptr)
             continue;
 
+          // Skip if this pair was rejected before and neither endpoint has
+          // changed since.
+          if (isRejectedPair(srcId, dstId, memref))
+            continue;
+
           // Get unique 'srcNode' store op.
           auto *srcStoreOpInst = srcNode->stores.front();
           // Gather 'dstNode' store ops to 'memref'.
@@ -1525,8 +1590,16 @@ public:
           // Check if fusion would be profitable.
           if (!isFusionProfitable(srcStoreOpInst, srcStoreOpInst,
                                   dstLoadOpInsts, dstStoreOpInsts, &sliceState,
-                                  &bestDstLoopDepth, maximalFusion))
+                                  &bestDstLoopDepth, maximalFusion)) {
+            if (OptRemark::isEnabled("affine-loop-fusion"))
+              OptRemark::missed(srcNode->op->getLoc(), "affine-loop-fusion",
+                                "fuse",
+                                "rejected by the fusion cost model: redundant "
+                                "computation or memory footprint growth "
+                                "outweighs locality benefit");
+            markRejectedPair(srcId, dstId, memref);
             continue;
+          }
           // TODO(andydavis) Remove the following test code when canFuseLoops
           // is fully functional.
           mlir::ComputationSliceState sliceUnion;
@@ -1540,9 +1613,23 @@ public:
           // Fuse computation slice of 'srcLoopNest' into 'dstLoopNest'.
           auto sliceLoopNest = mlir::insertBackwardComputationSlice(
               srcStoreOpInst, dstLoadOpInsts[0], bestDstLoopDepth, &sliceState);
+          if (!sliceLoopNest) {
+            if (OptRemark::isEnabled("affine-loop-fusion"))
+              OptRemark::missed(srcNode->op->getLoc(), "affine-loop-fusion",
+                                "fuse",
+                                "failed to insert the backward computation "
+                                "slice into the consumer loop nest");
+            markRejectedPair(srcId, dstId, memref);
+          }
           if (sliceLoopNest) {
             LLVM_DEBUG(llvm::dbgs() << "\tslice loop nest:\n"
                                     << *sliceLoopNest.getOperation() << "\n");
+            if (OptRemark::isEnabled("affine-loop-fusion"))
+              OptRemark::passed(srcNode->op->getLoc(), "affine-loop-fusion",
+                                "fuse",
+                                "fused producer loop nest into its consumer "
+                                "at depth " +
+                                    Twine(bestDstLoopDepth));
             // Move 'dstAffineForOp' before 'insertPointInst' if needed.
             auto dstAffineForOp = cast<AffineForOp>(dstNode->op);
             if (insertPointInst != dstAffineForOp.getOperation()) {
@@ -1654,6 +1741,10 @@ public:
     while (findSiblingNodeToFuse(dstNode, &visitedSibNodeIds, &idAndMemref)) {
       unsigned sibId = idAndMemref.first;
       Value *memref = idAndMemref.second;
+      // Skip if this pair was rejected before and neither endpoint has
+      // changed since.
+      if (isRejectedPair(sibId, dstNode->id, memref))
+        continue;
       // TODO(andydavis) Check that 'sibStoreOpInst' post-dominates all other
       // stores to the same memref in 'sibNode' loop nest.
       auto *sibNode = mdg->getNode(sibId);
@@ -1693,13 +1784,27 @@ public:
       // Check if fusion would be profitable.
       if (!isFusionProfitable(sibLoadOpInst, sibStoreOpInst, dstLoadOpInsts,
                               dstStoreOpInsts, &sliceState, &bestDstLoopDepth,
-                              maximalFusion))
+                              maximalFusion)) {
+        if (OptRemark::isEnabled("affine-loop-fusion"))
+          OptRemark::missed(sibNode->op->getLoc(), "affine-loop-fusion",
+                            "fuse-sibling",
+                            "rejected by the fusion cost model");
+        markRejectedPair(sibId, dstNode->id, memref);
         continue;
+      }
 
       // Fuse computation slice of 'sibLoopNest' into 'dstLoopNest'.
       auto sliceLoopNest = mlir::insertBackwardComputationSlice(
           sibLoadOpInst, dstLoadOpInsts[0], bestDstLoopDepth, &sliceState);
+      if (sliceLoopNest == nullptr)
+        markRejectedPair(sibId, dstNode->id, memref);
       if (sliceLoopNest != nullptr) {
+        if (OptRemark::isEnabled("affine-loop-fusion"))
+          OptRemark::passed(sibNode->op->getLoc(), "affine-loop-fusion",
+                            "fuse-sibling",
+                            "fused sibling loop nest for input reuse at "
+                            "depth " +
+                                Twine(bestDstLoopDepth));
         auto dstForInst = cast<AffineForOp>(dstNode->op);
         // Update operation position of fused loop nest (if needed).
         if (insertPointInst != dstForInst.getOperation()) {
@@ -1891,8 +1996,10 @@ void LoopFusion::runOnFunction() {
   if (clMaximalLoopFusion.getNumOccurrences() > 0)
     maximalFusion = clMaximalLoopFusion;
 
-  MemRefDependenceGraph g;
-  if (g.init(getFunction()))
+  // Fetch the dependence graph through the analysis manager so that a graph
+  // preserved by earlier passes is reused instead of rebuilt.
+  auto &g = getAnalysis<MemRefDependenceGraph>();
+  if (g.initialized)
     GreedyFusion(&g, localBufSizeThreshold, fastMemorySpace, maximalFusion)
         .run();
 }
@@ -0,0 +1,205 @@
+//===- LoopInterchange.cpp - Loop interchange pass ----------------------*-===//
+//
+// Copyright 2019 The MLIR Authors.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+// =============================================================================
+//
+// This file implements a pass that permutes perfectly nested affine loops to
+// improve cache locality. Each loop gets a cost reflecting the memory stride
+// its induction variable induces on the accesses in the nest; permutations
+// are ranked so that large-stride loops end up outermost and stride-1 loops
+// innermost, and the best permutation that preserves all dependences is
+// applied.
+//
+//===----------------------------------------------------------------------===//
+
+#include "mlir/AffineOps/AffineOps.h"
+#include "mlir/Analysis/AffineAnalysis.h"
+#include "mlir/Analysis/AffineStructures.h"
+#include "mlir/Pass/Pass.h"
+#include "mlir/StandardOps/Ops.h"
+#include "mlir/Transforms/LoopUtils.h"
+#include "mlir/Transforms/Passes.h"
+#include "llvm/Support/Debug.h"
+#include <algorithm>
+
+using namespace mlir;
+
+#define DEBUG_TYPE "affine-loop-interchange"
+
+// Bound on the size of bands considered for interchange; the number of
+// candidate permutations is factorial in the band size.
+static constexpr unsigned kMaxBandSize = 6;
+
+// Extent assumed for dynamic memref dimensions when computing strides; only
+// the relative order of the per-loop costs matters, so any value large enough
+// to dominate typical inner dimensions works.
+static constexpr int64_t kDynamicDimExtent = 1024;
+
+namespace {
+
+/// A pass that permutes perfectly nested affine loop bands for cache locality.
+struct LoopInterchange : public FunctionPass<LoopInterchange> {
+  void runOnFunction() override;
+
+  void runOnBand(MutableArrayRef<AffineForOp> band);
+};
+
+} // end anonymous namespace
+
+FunctionPassBase *mlir::createLoopInterchangePass() {
+  return new LoopInterchange();
+}
+
+/// Identifies maximal perfect nests of 'affine.for' ops in 'f'.
+static void getInterchangeableBands(
+    Function &f, std::vector<SmallVector<AffineForOp, 6>> *bands) {
+  for (auto &block : f) {
+    for (auto &op : block) {
+      if (auto forOp = dyn_cast<AffineForOp>(op)) {
+        SmallVector<AffineForOp, 6> band;
+        getPerfectlyNestedLoops(band, forOp);
+        bands->push_back(band);
+      }
+    }
+  }
+}
+
+/// Computes, for each loop in 'band', the sum over all accesses in the nest of
+/// the absolute linearized stride that stepping the loop's induction variable
+/// induces on the access. Loop-invariant accesses contribute zero. Returns
+/// failure if an access map could not be flattened.
+static LogicalResult
+computeLoopStrideCosts(ArrayRef<AffineForOp> band,
+                       SmallVectorImpl<int64_t> *loopCosts) {
+  loopCosts->assign(band.size(), 0);
+
+  SmallVector<Operation *, 8> accesses;
+  band[0].getOperation()->walk([&](Operation *op) {
+    if (isa<LoadOp>(op) || isa<StoreOp>(op))
+      accesses.push_back(op);
+  });
+
+  for (Operation *op : accesses) {
+    MemRefAccess access(op);
+    AffineValueMap accessMap;
+    access.getAccessMap(&accessMap);
+    AffineMap map = accessMap.getAffineMap();
+
+    std::vector<SmallVector<int64_t, 8>> flattenedExprs;
+    if (failed(getFlattenedAffineExprs(map, &flattenedExprs)))
+      return failure();
+
+    // Element strides of the memref dimensions, innermost dimension last.
+    auto memrefType = access.memref->getType().cast<MemRefType>();
+    unsigned rank = memrefType.getRank();
+    SmallVector<int64_t, 4> dimStrides(rank);
+    int64_t stride = 1;
+    for (unsigned d = rank; d > 0; --d) {
+      dimStrides[d - 1] = stride;
+      int64_t extent = memrefType.getDimSize(d - 1);
+      stride *= extent == -1 ? kDynamicDimExtent : extent;
+    }
+
+    for (unsigned l = 0, e = band.size(); l < e; ++l) {
+      Value *iv = band[l].getInductionVar();
+      // Find the dimensional position the induction variable is bound to.
+      Optional<unsigned> dimPos;
+      for (unsigned d = 0, numDims = accessMap.getNumDims(); d < numDims; ++d) {
+        if (accessMap.getOperand(d) == iv) {
+          dimPos = d;
+          break;
+        }
+      }
+      if (!dimPos)
+        continue;
+
+      int64_t linearizedCoeff = 0;
+      for (unsigned r = 0; r < rank; ++r)
+        linearizedCoeff += flattenedExprs[r][*dimPos] * dimStrides[r];
+      (*loopCosts)[l] += std::abs(linearizedCoeff) * band[l].getStep();
+    }
+  }
+  return success();
+}
+
+/// Permutes the loops of 'band' into the valid permutation with the lowest
+/// locality cost, if that permutation is not the identity.
+void LoopInterchange::runOnBand(MutableArrayRef<AffineForOp> band) {
+  // Loops carrying values cannot be interchanged.
+  for (AffineForOp loop : band)
+    if (loop.getNumIterOperands() != 0)
+      return;
+
+  SmallVector<int64_t, 6> loopCosts;
+  if (failed(computeLoopStrideCosts(band, &loopCosts)))
+    return;
+
+  // Rank permutations by position-weighted stride cost. Weights double per
+  // nesting level towards the innermost position, modelling that the stride
+  // of the fastest-varying loop dominates the traffic of the nest.
+  auto permutationCost = [&](ArrayRef<unsigned> permMap) {
+    int64_t cost = 0;
+    for (unsigned i = 0, e = band.size(); i < e; ++i)
+      cost += loopCosts[i] * (int64_t(1) << permMap[i]);
+    return cost;
+  };
+
+  SmallVector<unsigned, 6> permMap(band.size());
+  for (unsigned i = 0, e = band.size(); i < e; ++i)
+    permMap[i] = i;
+
+  // The identity is enumerated first, so on ties the nest is left unchanged.
+  SmallVector<unsigned, 6> bestPermMap(permMap.begin(), permMap.end());
+  int64_t bestCost = permutationCost(permMap);
+  SmallVector<AffineForOp, 6> loops(band.begin(), band.end());
+  while (std::next_permutation(permMap.begin(), permMap.end())) {
+    int64_t cost = permutationCost(permMap);
+    if (cost >= bestCost)
+      continue;
+    if (!isValidLoopInterchangePermutation(loops, permMap))
+      continue;
+    bestCost = cost;
+    bestPermMap.assign(permMap.begin(), permMap.end());
+  }
+
+  bool isIdentity = true;
+  for (unsigned i = 0, e = band.size(); i < e; ++i)
+    isIdentity &= bestPermMap[i] == i;
+  if (isIdentity)
+    return;
+
+  LLVM_DEBUG({
+    auto diag = band[0].emitRemark("interchanging band with permutation [");
+    for (unsigned pos : bestPermMap)
+      diag << pos << " ";
+    diag << "]\n";
+  });
+  interchangeLoops(loops, bestPermMap);
+}
+
+void LoopInterchange::runOnFunction() {
+  std::vector<SmallVector<AffineForOp, 6>> bands;
+  getInterchangeableBands(getFunction(), &bands);
+
+  for (auto &band : bands) {
+    if (band.size() < 2 || band.size() > kMaxBandSize)
+      continue;
+    runOnBand(band);
+  }
+}
+
+static PassRegistration<LoopInterchange>
+    pass("affine-loop-interchange",
+         "Permute perfectly nested affine loops for cache locality");
@@ -0,0 +1,127 @@
+//===- LoopSkewing.cpp - Loop skewing pass ------------------------------*-===//
+//
+// Copyright 2019 The MLIR Authors.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+// =============================================================================
+//
+// This file implements a pass that rewrites two-deep affine loop nests whose
+// inner loop carries dependences into wavefront form. The skew factor is the
+// smallest one that moves every dependence onto the wavefront loop, leaving
+// the inner loop parallel for vectorization and GPU mapping.
+//
+//===----------------------------------------------------------------------===//
+
+#include "mlir/AffineOps/AffineOps.h"
+#include "mlir/Analysis/AffineAnalysis.h"
+#include "mlir/Pass/Pass.h"
+#include "mlir/Support/MathExtras.h"
+#include "mlir/Transforms/LoopUtils.h"
+#include "mlir/Transforms/Passes.h"
+#include "llvm/Support/Debug.h"
+
+using namespace mlir;
+
+#define DEBUG_TYPE "affine-loop-skew"
+
+// Bound on acceptable skew factors; larger factors come from pathological
+// dependence distances and yield wavefronts too lopsided to be profitable.
+static constexpr uint64_t kMaxSkewFactor = 16;
+
+namespace {
+
+/// A pass that wavefronts two-deep affine loop nests with inner-carried
+/// dependences.
+struct LoopSkewing : public FunctionPass<LoopSkewing> {
+  void runOnFunction() override;
+
+  void runOnNest(AffineForOp outerForOp);
+};
+
+} // end anonymous namespace
+
+FunctionPassBase *mlir::createLoopSkewingPass() { return new LoopSkewing(); }
+
+/// Computes the smallest skew factor that makes the wavefront component
+/// skewFactor * di + dj of every dependence positive, so that the skewed
+/// inner loop carries no dependence. Returns None if the nest should be left
+/// alone: dependence distances are unknown, no dependence is carried by the
+/// inner loop, or the required factor is unreasonably large.
+static Optional<uint64_t> computeSkewFactor(AffineForOp outerForOp) {
+  std::vector<llvm::SmallVector<DependenceComponent, 2>> depCompsVec;
+  getDependenceComponents(outerForOp, /*maxLoopDepth=*/2, &depCompsVec);
+
+  bool innerCarriesDependence = false;
+  int64_t factor = 1;
+  for (auto &depComps : depCompsVec) {
+    assert(depComps.size() >= 2);
+    const DependenceComponent &c0 = depComps[0];
+    const DependenceComponent &c1 = depComps[1];
+    // Skewing is only provably legal for constant dependence distances.
+    if (!c0.lb.hasValue() || !c0.ub.hasValue() || *c0.lb != *c0.ub ||
+        !c1.lb.hasValue() || !c1.ub.hasValue() || *c1.lb != *c1.ub)
+      return llvm::None;
+    int64_t di = *c0.lb, dj = *c1.lb;
+    if (di == 0 && dj == 0)
+      continue;
+    if (di < 0)
+      return llvm::None;
+    if (di == 0) {
+      // Inner-carried dependence; any factor moves it onto the wavefront.
+      innerCarriesDependence = true;
+      continue;
+    }
+    // Outer-carried; the factor must keep skewFactor * di + dj positive.
+    factor = std::max(factor, ceilDiv(1 - dj, di));
+  }
+
+  if (!innerCarriesDependence)
+    return llvm::None;
+  if (static_cast<uint64_t>(factor) > kMaxSkewFactor)
+    return llvm::None;
+  return static_cast<uint64_t>(factor);
+}
+
+void LoopSkewing::runOnNest(AffineForOp outerForOp) {
+  Optional<uint64_t> factor = computeSkewFactor(outerForOp);
+  if (!factor)
+    return;
+  LLVM_DEBUG(llvm::dbgs() << "skewing nest with factor " << *factor << "\n");
+  // loopSkewByFactor rejects nests it cannot handle (non-constant bounds,
+  // non-unit steps) without modifying them.
+  (void)loopSkewByFactor(outerForOp, *factor);
+}
+
+void LoopSkewing::runOnFunction() {
+  // Gather two-deep maximal perfect nests first; skewing replaces the nest,
+  // which would invalidate a walk.
+  SmallVector<AffineForOp, 4> nests;
+  for (auto &block : getFunction()) {
+    for (auto &op : block) {
+      if (auto forOp = dyn_cast<AffineForOp>(op)) {
+        SmallVector<AffineForOp, 6> band;
+        getPerfectlyNestedLoops(band, forOp);
+        if (band.size() == 2)
+          nests.push_back(forOp);
+      }
+    }
+  }
+
+  for (AffineForOp outerForOp : nests)
+    runOnNest(outerForOp);
+}
+
+static PassRegistration<LoopSkewing>
+    pass("affine-loop-skew",
+         "Skew two-deep affine loop nests into wavefronts to expose inner "
+         "parallelism");
@@ -25,12 +25,15 @@
 #include "mlir/Analysis/LoopAnalysis.h"
 #include "mlir/Analysis/Utils.h"
 #include "mlir/IR/Builders.h"
+#include "mlir/IR/Diagnostics.h"
 #include "mlir/Pass/Pass.h"
+#include "mlir/Support/STLExtras.h"
 #include "mlir/Transforms/LoopUtils.h"
 #include "mlir/Transforms/Passes.h"
 #include "mlir/Transforms/Utils.h"
 #include "llvm/Support/CommandLine.h"
 #include "llvm/Support/Debug.h"
+#include "llvm/Support/raw_ostream.h"
 using namespace mlir;
 
 #define DEBUG_TYPE "affine-loop-tile"
@@ -42,6 +45,14 @@ static llvm::cl::opt<unsigned long long>
                    llvm::cl::desc("Set size of cache to tile for in KiB"),
                    llvm::cl::cat(clOptionsCategory));
 
+// When provided, bands are tiled at two levels: an outer level whose tiles fit
+// this capacity, and an inner level whose tiles fit -tile-cache-size.
+static llvm::cl::opt<unsigned long long> clL2CacheSizeKiB(
+    "tile-l2-cache-size",
+    llvm::cl::desc("Set size of second-level cache to tile for in KiB; "
+                   "enables two-level tiling"),
+    llvm::cl::cat(clOptionsCategory));
+
 // Tile size to use for all loops (overrides -tile-sizes if provided).
 static llvm::cl::opt<unsigned>
     clTileSize("tile-size", llvm::cl::desc("Use this tile size for all loops"),
@@ -60,11 +71,13 @@ namespace {
 /// A pass to perform loop tiling on all suitable loop nests of a Function.
 struct LoopTiling : public FunctionPass<LoopTiling> {
   explicit LoopTiling(uint64_t cacheSizeBytes = kDefaultCacheMemCapacity,
+                      uint64_t l2CacheSizeBytes = 0,
                       bool avoidMaxMinBounds = true)
-      : cacheSizeBytes(cacheSizeBytes), avoidMaxMinBounds(avoidMaxMinBounds) {}
+      : cacheSizeBytes(cacheSizeBytes), l2CacheSizeBytes(l2CacheSizeBytes),
+        avoidMaxMinBounds(avoidMaxMinBounds) {}
 
   void runOnFunction() override;
-  void getTileSizes(ArrayRef<AffineForOp> band,
+  void getTileSizes(ArrayRef<AffineForOp> band, uint64_t cacheBudgetBytes,
                     SmallVectorImpl<unsigned> *tileSizes);
 
   // Default tile size if nothing is provided.
@@ -73,6 +86,9 @@ struct LoopTiling : public FunctionPass<LoopTiling> {
 
   // Capacity of the cache to tile for.
   uint64_t cacheSizeBytes;
+  // Capacity of the second-level cache; two-level tiling is performed when
+  // non-zero and no explicit tile sizes were provided.
+  uint64_t l2CacheSizeBytes;
   // If true, tile sizes are set to avoid max/min in bounds if possible.
   bool avoidMaxMinBounds;
 };
@@ -81,8 +97,9 @@ struct LoopTiling : public FunctionPass<LoopTiling> {
 
 /// Creates a pass to perform loop tiling on all suitable loop nests of a
 /// Function.
-FunctionPassBase *mlir::createLoopTilingPass(uint64_t cacheSizeBytes) {
-  return new LoopTiling(cacheSizeBytes);
+FunctionPassBase *mlir::createLoopTilingPass(uint64_t cacheSizeBytes,
+                                             uint64_t l2CacheSizeBytes) {
+  return new LoopTiling(cacheSizeBytes, l2CacheSizeBytes);
 }
 
 // Move the loop body of AffineForOp 'src' from 'src' into the specified
@@ -125,10 +142,13 @@ constructTiledIndexSetHyperRect(MutableArrayRef<AffineForOp> origLoops,
     newLoops[i].setUpperBound(newUbOperands, origLoops[i].getUpperBoundMap());
     newLoops[i].setStep(tileSizes[i]);
   }
-  // Bounds for intra-tile loops.
+  // Bounds for intra-tile loops. Each original loop is queried for its trip
+  // count divisor and its constant trip count; the cache derives the trip
+  // count map once per loop and serves both.
+  AffineForTripCountCache tripCounts;
   for (unsigned i = 0; i < width; i++) {
-    int64_t largestDiv = getLargestDivisorOfTripCount(origLoops[i]);
-    auto mayBeConstantCount = getConstantTripCount(origLoops[i]);
+    int64_t largestDiv = tripCounts.getLargestDivisorOfTripCount(origLoops[i]);
+    auto mayBeConstantCount = tripCounts.getConstantTripCount(origLoops[i]);
     // The lower bound is just the tile-space loop.
     AffineMap lbMap = b.getDimIdentityMap();
     newLoops[width + i].setLowerBound(
@@ -183,7 +203,8 @@ constructTiledIndexSetHyperRect(MutableArrayRef<AffineForOp> origLoops,
 /// and intra-tile loops. A band is a contiguous set of loops.
 //  TODO(bondhugula): handle non hyper-rectangular spaces.
 LogicalResult mlir::tileCodeGen(MutableArrayRef<AffineForOp> band,
-                                ArrayRef<unsigned> tileSizes) {
+                                ArrayRef<unsigned> tileSizes,
+                                SmallVectorImpl<AffineForOp> *tiledNest) {
   assert(!band.empty());
   assert(band.size() == tileSizes.size() && "Incorrect number of tile sizes");
 
@@ -192,6 +213,12 @@ LogicalResult mlir::tileCodeGen(MutableArrayRef<AffineForOp> band,
     assert(band[i].getOperation()->getParentOp() == band[i - 1].getOperation());
   }
 
+  // Loops carrying values are not tiled: the rebuilt nest cannot preserve the
+  // carried chains.
+  for (AffineForOp loop : band)
+    if (loop.getNumIterOperands() != 0)
+      return failure();
+
   auto origLoops = band;
 
   AffineForOp rootAffineForOp = origLoops[0];
@@ -255,6 +282,9 @@ LogicalResult mlir::tileCodeGen(MutableArrayRef<AffineForOp> band,
   // Erase the old loop nest.
   rootAffineForOp.erase();
 
+  if (tiledNest)
+    tiledNest->assign(newLoops.begin(), newLoops.end());
+
   return success();
 }
 
@@ -304,6 +334,7 @@ static void adjustToDivisorsOfTripCounts(ArrayRef<AffineForOp> band,
 // TODO(mlir-team): evolve this model. Tile size determination is a large area
 // to play with in general.
 void LoopTiling::getTileSizes(ArrayRef<AffineForOp> band,
+                              uint64_t cacheBudgetBytes,
                               SmallVectorImpl<unsigned> *tileSizes) {
   if (band.empty())
     return;
@@ -328,7 +359,6 @@ void LoopTiling::getTileSizes(ArrayRef<AffineForOp> band,
 
   // The first loop in the band.
   auto rootForOp = band[0];
-  (void)rootForOp;
 
   // Obtain memory footprint and set tile sizes so that a tile fits in
   // the cache size. This is an approximation with the assumption that the
@@ -344,14 +374,23 @@ void LoopTiling::getTileSizes(ArrayRef<AffineForOp> band,
     LLVM_DEBUG(
         rootForOp.emitWarning("memory footprint unknown: using default tile "
                               "sizes adjusted to trip count divisors"));
+    if (OptRemark::isEnabled("affine-loop-tile"))
+      OptRemark::missed(rootForOp.getLoc(), "affine-loop-tile", "tile-sizes",
+                        "memory footprint could not be computed; falling back "
+                        "to default tile sizes");
     return;
   }
 
   // Check how many times larger the cache size is when compared to footprint.
-  uint64_t excessFactor = llvm::divideCeil(fp.getValue(), cacheSizeBytes);
+  uint64_t excessFactor = llvm::divideCeil(fp.getValue(), cacheBudgetBytes);
   if (excessFactor <= 1) {
     // No need of any tiling - set tile size to 1.
     std::fill(tileSizes->begin(), tileSizes->end(), 1);
+    if (OptRemark::isEnabled("affine-loop-tile"))
+      OptRemark::missed(rootForOp.getLoc(), "affine-loop-tile", "tile-sizes",
+                        "footprint of " + Twine(fp.getValue()) +
+                            " bytes already fits the cache budget; not "
+                            "tiling");
     return;
   }
 
@@ -380,9 +419,16 @@ void LoopTiling::getTileSizes(ArrayRef<AffineForOp> band,
 }
 
 void LoopTiling::runOnFunction() {
-  // Override cache size if provided on command line.
+  // Override cache sizes if provided on command line.
   if (clCacheSizeKiB.getNumOccurrences() > 0)
     cacheSizeBytes = clCacheSizeKiB * 1024;
+  if (clL2CacheSizeKiB.getNumOccurrences() > 0)
+    l2CacheSizeBytes = clL2CacheSizeKiB * 1024;
+
+  // Explicit tile sizes fix a single level of tiling; the two-level scheme
+  // only applies when tile sizes are being derived from memory footprints.
+  bool twoLevel = l2CacheSizeBytes > 0 &&
+                  clTileSize.getNumOccurrences() == 0 && clTileSizes.empty();
 
   // Bands of loops to tile.
   std::vector<SmallVector<AffineForOp, 6>> bands;
@@ -392,15 +438,61 @@ void LoopTiling::runOnFunction() {
     // Set up tile sizes; fill missing tile sizes at the end with default tile
     // size or clTileSize if one was provided.
     SmallVector<unsigned, 6> tileSizes;
-    getTileSizes(band, &tileSizes);
+    getTileSizes(band, twoLevel ? l2CacheSizeBytes : cacheSizeBytes,
+                 &tileSizes);
     if (llvm::DebugFlag) {
       auto diag = band[0].emitRemark("using tile sizes [");
       for (auto tSize : tileSizes)
         diag << tSize << " ";
       diag << "]\n";
     }
-    if (failed(tileCodeGen(band, tileSizes)))
+    // Capture the band's location now; tiling replaces the original loops.
+    Location bandLoc = band[0].getLoc();
+    if (!twoLevel) {
+      if (failed(tileCodeGen(band, tileSizes)))
+        return signalPassFailure();
+      if (OptRemark::isEnabled("affine-loop-tile")) {
+        std::string sizes;
+        llvm::raw_string_ostream sizesOs(sizes);
+        interleaveComma(tileSizes, sizesOs);
+        OptRemark::passed(bandLoc, "affine-loop-tile", "tile",
+                          "tiled band of depth " + Twine(band.size()) +
+                              " with tile sizes [" + sizesOs.str() + "]");
+      }
+      continue;
+    }
+
+    // Two-level tiling: tile for the L2 budget first, then tile the resulting
+    // intra-tile band so that each of its tiles fits the L1 budget. The
+    // footprint of the intra-tile band is that of a single L2 tile since the
+    // regions are computed symbolic in the enclosing tile-space IVs.
+    SmallVector<AffineForOp, 12> tiledNest;
+    if (failed(tileCodeGen(band, tileSizes, &tiledNest)))
+      return signalPassFailure();
+    MutableArrayRef<AffineForOp> intraTileBand =
+        MutableArrayRef<AffineForOp>(tiledNest).take_back(band.size());
+    SmallVector<unsigned, 6> innerTileSizes;
+    getTileSizes(intraTileBand, cacheSizeBytes, &innerTileSizes);
+    // An L2 tile already fitting in L1 leaves nothing to tile at this level.
+    if (llvm::all_of(innerTileSizes, [](unsigned s) { return s == 1; }))
+      continue;
+    if (llvm::DebugFlag) {
+      auto diag = intraTileBand[0].emitRemark("using inner tile sizes [");
+      for (auto tSize : innerTileSizes)
+        diag << tSize << " ";
+      diag << "]\n";
+    }
+    if (failed(tileCodeGen(intraTileBand, innerTileSizes)))
       return signalPassFailure();
+    if (OptRemark::isEnabled("affine-loop-tile")) {
+      std::string sizes;
+      llvm::raw_string_ostream sizesOs(sizes);
+      interleaveComma(innerTileSizes, sizesOs);
+      OptRemark::passed(bandLoc, "affine-loop-tile", "tile",
+                        "tiled band of depth " + Twine(band.size()) +
+                            " at two levels; inner tile sizes [" +
+                            sizesOs.str() + "]");
+    }
   }
 }
 
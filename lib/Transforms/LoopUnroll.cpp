@@ -48,6 +48,15 @@ static llvm::cl::opt<bool> clUnrollFull("unroll-full",
                                         llvm::cl::desc("Fully unroll loops"),
                                         llvm::cl::cat(clOptionsCategory));
 
+// Target size for the unrolled loop body, in estimated operations. When
+// provided, per-loop unroll factors are derived from the body size and the
+// constant trip count (if known) instead of a uniform factor.
+static llvm::cl::opt<unsigned> clUnrollOpBudget(
+    "unroll-op-budget",
+    llvm::cl::desc("Choose per-loop unroll factors so that the unrolled body "
+                   "stays within this many operations"),
+    llvm::cl::cat(clOptionsCategory));
+
 static llvm::cl::opt<unsigned> clUnrollNumRepetitions(
     "unroll-num-reps",
     llvm::cl::desc("Unroll innermost loops repeatedly this many times"),
@@ -158,6 +167,25 @@ void LoopUnroll::runOnFunction() {
   }
 }
 
+// Returns an unroll factor for 'forOp' such that the unrolled body stays
+// within 'opBudget' estimated operations. When the trip count is a known
+// constant, the factor is capped by it (yielding a full unroll when the whole
+// loop fits the budget) and shrunk to one of its divisors so that no cleanup
+// loop is needed.
+static uint64_t getBudgetedUnrollFactor(AffineForOp forOp, unsigned opBudget) {
+  uint64_t bodySize = std::max<uint64_t>(getApproximateBodyOpCount(forOp), 1);
+  uint64_t factor = std::max<uint64_t>(opBudget / bodySize, 1);
+  auto mayBeConstantCount = getConstantTripCount(forOp);
+  if (mayBeConstantCount.hasValue()) {
+    uint64_t tripCount = mayBeConstantCount.getValue();
+    if (factor >= tripCount)
+      return tripCount;
+    while (tripCount % factor != 0)
+      factor--;
+  }
+  return factor;
+}
+
 /// Unrolls a 'affine.for' op. Returns success if the loop was unrolled,
 /// failure otherwise. The default unroll factor is 4.
 LogicalResult LoopUnroll::runOnAffineForOp(AffineForOp forOp) {
@@ -171,6 +199,14 @@ LogicalResult LoopUnroll::runOnAffineForOp(AffineForOp forOp) {
   // Unroll by the command line factor if one was specified.
   if (clUnrollFactor.getNumOccurrences() > 0)
     return loopUnrollByFactor(forOp, clUnrollFactor);
+  // Derive a per-loop factor from the op budget if one was specified.
+  if (clUnrollOpBudget.getNumOccurrences() > 0) {
+    uint64_t factor = getBudgetedUnrollFactor(forOp, clUnrollOpBudget);
+    if (factor <= 1)
+      // The body alone exhausts the budget; leave the loop rolled.
+      return failure();
+    return loopUnrollByFactor(forOp, factor);
+  }
   // Unroll completely if full loop unroll was specified.
   if (clUnrollFull.getNumOccurrences() > 0 ||
       (unrollFull.hasValue() && unrollFull.getValue()))
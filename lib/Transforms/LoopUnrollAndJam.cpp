@@ -67,6 +67,15 @@ static llvm::cl::opt<unsigned>
                                      " (default 4)"),
                       llvm::cl::cat(clOptionsCategory));
 
+// Target size for the unroll-jammed nest, in estimated operations. When
+// provided, the jam factor is derived from the nest's body size instead of
+// being uniform.
+static llvm::cl::opt<unsigned> clUnrollJamOpBudget(
+    "unroll-jam-op-budget", llvm::cl::Hidden,
+    llvm::cl::desc("Choose the unroll jam factor so that the jammed nest "
+                   "stays within this many operations"),
+    llvm::cl::cat(clOptionsCategory));
+
 namespace {
 /// Loop unroll jam pass. Currently, this just unroll jams the first
 /// outer loop in a Function.
@@ -105,6 +114,17 @@ LogicalResult LoopUnrollAndJam::runOnAffineForOp(AffineForOp forOp) {
   // Otherwise, unroll jam by the command-line factor if one was specified.
   if (clUnrollJamFactor.getNumOccurrences() > 0)
     return loopUnrollJamByFactor(forOp, clUnrollJamFactor);
+  // Derive the factor from the op budget if one was specified; the factor is
+  // clamped to the trip count by loopUnrollJamUpToFactor.
+  if (clUnrollJamOpBudget.getNumOccurrences() > 0) {
+    uint64_t bodySize =
+        std::max<uint64_t>(getApproximateBodyOpCount(forOp), 1);
+    uint64_t factor = std::max<uint64_t>(clUnrollJamOpBudget / bodySize, 1);
+    if (factor <= 1)
+      // The nest alone exhausts the budget; leave the loop rolled.
+      return failure();
+    return loopUnrollJamUpToFactor(forOp, factor);
+  }
 
   // Unroll and jam by four otherwise.
   return loopUnrollJamByFactor(forOp, kDefaultUnrollJamFactor);
@@ -168,7 +188,25 @@ LogicalResult mlir::loopUnrollJamByFactor(AffineForOp forOp,
   if (forOp.getLowerBoundMap().getNumResults() != 1)
     return failure();
 
-  Optional<uint64_t> mayBeConstantTripCount = getConstantTripCount(forOp);
+  // Loops carrying values anywhere in the nest are not unroll-jammed: jamming
+  // duplicates sub-blocks within the bodies of inner loops, and a duplicated
+  // computation feeding a carried value would be disconnected from the chain
+  // its copy is supposed to extend.
+  bool hasIterArgs = false;
+  forOp.getOperation()->walk([&](Operation *op) {
+    if (auto loop = dyn_cast<AffineForOp>(op))
+      if (loop.getNumIterOperands() != 0)
+        hasIterArgs = true;
+  });
+  if (hasIterArgs)
+    return failure();
+
+  // The trip count map is derived once and shared by the constant trip count
+  // and divisor queries below.
+  AffineForTripCountCache tripCounts;
+
+  Optional<uint64_t> mayBeConstantTripCount =
+      tripCounts.getConstantTripCount(forOp);
   // If the trip count is lower than the unroll jam factor, no unroll jam.
   if (mayBeConstantTripCount.hasValue() &&
       mayBeConstantTripCount.getValue() < unrollJamFactor)
@@ -183,7 +221,7 @@ LogicalResult mlir::loopUnrollJamByFactor(AffineForOp forOp,
 
   // Generate the cleanup loop if trip count isn't a multiple of
   // unrollJamFactor.
-  if (getLargestDivisorOfTripCount(forOp) % unrollJamFactor != 0) {
+  if (tripCounts.getLargestDivisorOfTripCount(forOp) % unrollJamFactor != 0) {
     // Insert the cleanup loop right after 'forOp'.
     OpBuilder builder(forInst->getBlock(), std::next(Block::iterator(forInst)));
     auto cleanupAffineForOp = cast<AffineForOp>(builder.clone(*forInst));
@@ -207,6 +245,12 @@ LogicalResult mlir::loopUnrollJamByFactor(AffineForOp forOp,
   int64_t step = forOp.getStep();
   forOp.setStep(step * unrollJamFactor);
 
+  // Number the values defined in the original loop body once, so that each
+  // jammed copy remaps through a flat dense table instead of growing a fresh
+  // hash map.
+  BlockAndValueMapping operandMapping;
+  operandMapping.numberDenseSources(forOp.getBody());
+
   auto *forOpIV = forOp.getInductionVar();
   for (auto &subBlock : subBlocks) {
     // Builder to insert unroll-jammed bodies. Insert right at the end of
@@ -215,7 +259,7 @@ LogicalResult mlir::loopUnrollJamByFactor(AffineForOp forOp,
 
     // Unroll and jam (appends unrollJamFactor-1 additional copies).
     for (unsigned i = 1; i < unrollJamFactor; i++) {
-      BlockAndValueMapping operandMapping;
+      operandMapping.resetDenseMappings();
 
       // If the induction variable is used, create a remapping to the value for
       // this unrolled instance.
@@ -39,6 +39,13 @@ namespace {
 // Visit affine expressions recursively and build the sequence of operations
 // that correspond to it.  Visitation functions return an Value of the
 // expression subtree they visited or `nullptr` on error.
+//
+// Expansion is subexpression-aware: affine expressions are uniqued, so every
+// subtree materialized through one expander instance is numbered in a local
+// table and re-emitted as the already-created value instead of a fresh op
+// chain. One expander instance must therefore keep inserting at the same
+// point; expanding all results of a map through a single instance shares
+// their common subexpressions.
 class AffineApplyExpander
     : public AffineExprVisitor<AffineApplyExpander, Value *> {
 public:
@@ -49,9 +56,21 @@ public:
       : builder(builder), dimValues(dimValues), symbolValues(symbolValues),
         loc(loc) {}
 
+  /// Memoizing entry point: returns the value already materialized for `expr`
+  /// if there is one, and records the expansion otherwise.
+  Value *expand(AffineExpr expr) {
+    auto existing = memo.find(expr);
+    if (existing != memo.end())
+      return existing->second;
+    Value *result = visit(expr);
+    if (result)
+      memo.insert({expr, result});
+    return result;
+  }
+
   template <typename OpTy> Value *buildBinaryExpr(AffineBinaryOpExpr expr) {
-    auto lhs = visit(expr.getLHS());
-    auto rhs = visit(expr.getRHS());
+    auto lhs = expand(expr.getLHS());
+    auto rhs = expand(expr.getRHS());
     if (!lhs || !rhs)
       return nullptr;
     auto op = builder.create<OpTy>(loc, lhs, rhs);
@@ -88,12 +107,12 @@ public:
       return nullptr;
     }
 
-    auto lhs = visit(expr.getLHS());
-    auto rhs = visit(expr.getRHS());
+    auto lhs = expand(expr.getLHS());
+    auto rhs = expand(expr.getRHS());
     assert(lhs && rhs && "unexpected affine expr lowering failure");
 
     Value *remainder = builder.create<RemISOp>(loc, lhs, rhs);
-    Value *zeroCst = builder.create<ConstantIndexOp>(loc, 0);
+    Value *zeroCst = getConstantIndex(0);
     Value *isRemainderNegative =
         builder.create<CmpIOp>(loc, CmpIPredicate::SLT, remainder, zeroCst);
     Value *correctedRemainder = builder.create<AddIOp>(loc, remainder, rhs);
@@ -125,12 +144,12 @@ public:
       return nullptr;
     }
 
-    auto lhs = visit(expr.getLHS());
-    auto rhs = visit(expr.getRHS());
+    auto lhs = expand(expr.getLHS());
+    auto rhs = expand(expr.getRHS());
     assert(lhs && rhs && "unexpected affine expr lowering failure");
 
-    Value *zeroCst = builder.create<ConstantIndexOp>(loc, 0);
-    Value *noneCst = builder.create<ConstantIndexOp>(loc, -1);
+    Value *zeroCst = getConstantIndex(0);
+    Value *noneCst = getConstantIndex(-1);
     Value *negative =
         builder.create<CmpIOp>(loc, CmpIPredicate::SLT, lhs, zeroCst);
     Value *negatedDecremented = builder.create<SubIOp>(loc, noneCst, lhs);
@@ -164,12 +183,12 @@ public:
       emitError(loc, "division by non-positive value is not supported");
       return nullptr;
     }
-    auto lhs = visit(expr.getLHS());
-    auto rhs = visit(expr.getRHS());
+    auto lhs = expand(expr.getLHS());
+    auto rhs = expand(expr.getRHS());
     assert(lhs && rhs && "unexpected affine expr lowering failure");
 
-    Value *zeroCst = builder.create<ConstantIndexOp>(loc, 0);
-    Value *oneCst = builder.create<ConstantIndexOp>(loc, 1);
+    Value *zeroCst = getConstantIndex(0);
+    Value *oneCst = getConstantIndex(1);
     Value *nonPositive =
         builder.create<CmpIOp>(loc, CmpIPredicate::SLE, lhs, zeroCst);
     Value *negated = builder.create<SubIOp>(loc, zeroCst, lhs);
@@ -185,11 +204,7 @@ public:
   }
 
   Value *visitConstantExpr(AffineConstantExpr expr) {
-    auto valueAttr =
-        builder.getIntegerAttr(builder.getIndexType(), expr.getValue());
-    auto op =
-        builder.create<ConstantOp>(loc, builder.getIndexType(), valueAttr);
-    return op.getResult();
+    return getConstantIndex(expr.getValue());
   }
 
   Value *visitDimExpr(AffineDimExpr expr) {
@@ -205,10 +220,25 @@ public:
   }
 
 private:
+  /// Returns an index constant, materializing it on first use. The helper ops
+  /// of mod/floordiv/ceildiv expansions mostly need the same few constants.
+  Value *getConstantIndex(int64_t value) {
+    auto &constant = constants[value];
+    if (!constant)
+      constant = builder.create<ConstantIndexOp>(loc, value);
+    return constant;
+  }
+
   OpBuilder &builder;
   ArrayRef<Value *> dimValues;
   ArrayRef<Value *> symbolValues;
 
+  /// Local value numbering of already-expanded subexpressions.
+  DenseMap<AffineExpr, Value *> memo;
+
+  /// Already-materialized index constants.
+  DenseMap<int64_t, Value *> constants;
+
   Location loc;
 };
 } // namespace
@@ -219,22 +249,24 @@ mlir::Value *mlir::expandAffineExpr(OpBuilder &builder, Location loc,
                                     AffineExpr expr,
                                     ArrayRef<Value *> dimValues,
                                     ArrayRef<Value *> symbolValues) {
-  return AffineApplyExpander(builder, dimValues, symbolValues, loc).visit(expr);
+  return AffineApplyExpander(builder, dimValues, symbolValues, loc)
+      .expand(expr);
 }
 
 // Create a sequence of operations that implement the `affineMap` applied to
-// the given `operands` (as it it were an AffineApplyOp).
+// the given `operands` (as it it were an AffineApplyOp). All results are
+// expanded through one expander so that subexpressions common to several
+// results are materialized only once.
 Optional<SmallVector<Value *, 8>> static expandAffineMap(
     OpBuilder &builder, Location loc, AffineMap affineMap,
     ArrayRef<Value *> operands) {
   auto numDims = affineMap.getNumDims();
-  auto expanded = functional::map(
-      [numDims, &builder, loc, operands](AffineExpr expr) {
-        return expandAffineExpr(builder, loc, expr,
-                                operands.take_front(numDims),
-                                operands.drop_front(numDims));
-      },
-      affineMap.getResults());
+  AffineApplyExpander expander(builder, operands.take_front(numDims),
+                               operands.drop_front(numDims), loc);
+  SmallVector<Value *, 8> expanded;
+  expanded.reserve(affineMap.getNumResults());
+  for (auto expr : affineMap.getResults())
+    expanded.push_back(expander.expand(expr));
   if (llvm::all_of(expanded, [](Value *v) { return v; }))
     return expanded;
   return None;
@@ -390,27 +422,43 @@ public:
     auto *firstBodyBlock =
         rewriter.splitBlock(conditionBlock, conditionBlock->begin());
     auto *lastBodyBlock = &forOp.getRegion().back();
+    // The terminator carries the next-iteration values of the loop-carried
+    // values; capture it before appending the latch to its block.
+    auto terminator = cast<AffineTerminatorOp>(lastBodyBlock->getTerminator());
     rewriter.inlineRegionBefore(forOp.getRegion(), endBlock);
     auto *iv = conditionBlock->getArgument(0);
 
+    // The remaining condition block arguments hold the loop-carried values for
+    // the iteration about to execute.
+    auto carriedArgs = conditionBlock->getArguments().drop_front();
+
     // Append the induction variable stepping logic to the last body block and
-    // branch back to the condition block.  Construct an affine expression f :
-    // (x -> x+step) and apply this expression to the induction variable.
+    // branch back to the condition block, passing the next values of the
+    // loop-carried values.  Construct an affine expression f : (x -> x+step)
+    // and apply this expression to the induction variable.
     rewriter.setInsertionPointToEnd(lastBodyBlock);
     auto affStep = rewriter.getAffineConstantExpr(forOp.getStep());
     auto affDim = rewriter.getAffineDimExpr(0);
     auto stepped = expandAffineExpr(rewriter, loc, affDim + affStep, iv, {});
     if (!stepped)
       return matchFailure();
-    rewriter.create<BranchOp>(loc, conditionBlock, stepped);
+    SmallVector<Value *, 8> latchArgs;
+    latchArgs.push_back(stepped);
+    latchArgs.append(terminator.operand_begin(), terminator.operand_end());
+    rewriter.create<BranchOp>(loc, conditionBlock, latchArgs);
 
-    // Compute loop bounds before branching to the condition.
+    // Compute loop bounds before branching to the condition, and pass the
+    // initial values of the loop-carried values.
     rewriter.setInsertionPointToEnd(initBlock);
     Value *lowerBound = lowerAffineLowerBound(forOp, rewriter);
     Value *upperBound = lowerAffineUpperBound(forOp, rewriter);
     if (!lowerBound || !upperBound)
       return matchFailure();
-    rewriter.create<BranchOp>(loc, conditionBlock, lowerBound);
+    SmallVector<Value *, 8> initArgs;
+    initArgs.push_back(lowerBound);
+    auto iterOperands = forOp.getIterOperands();
+    initArgs.append(iterOperands.begin(), iterOperands.end());
+    rewriter.create<BranchOp>(loc, conditionBlock, initArgs);
 
     // With the body block done, we can fill in the condition block.
     rewriter.setInsertionPointToEnd(conditionBlock);
@@ -419,8 +467,10 @@ public:
     rewriter.create<CondBranchOp>(loc, comparison, firstBodyBlock,
                                   ArrayRef<Value *>(), endBlock,
                                   ArrayRef<Value *>());
-    // Ok, we're done!
-    rewriter.replaceOp(op, {});
+    // Ok, we're done!  The results of the loop are the values the carried
+    // arguments hold when the condition fails.
+    rewriter.replaceOp(op, SmallVector<Value *, 4>(carriedArgs.begin(),
+                                                   carriedArgs.end()));
     return matchSuccess();
   }
 };
@@ -121,6 +121,41 @@ struct VectorTransferRewriter : public RewritePattern {
                                      PatternRewriter &rewriter) const override;
 };
 
+/// Returns true if `transfer` provably accesses the entire remote MemRef
+/// contiguously and in element order: the MemRef has the default (contiguous,
+/// row-major) layout and is statically shaped to exactly the vector shape,
+/// all indices are known zero, and the permutation map is the identity. Such
+/// a transfer needs neither the staging buffer nor clipping and lowers to a
+/// single wide vector access through a vector view of the MemRef. This is the
+/// common shape for the full-tile local buffers created by tiling and DMA
+/// generation.
+template <typename VectorTransferOpTy>
+static bool isContiguousFullTransfer(VectorTransferOpTy transfer) {
+  auto memRefType = transfer.getMemRefType();
+  auto vectorType = transfer.getVectorType();
+  // Only the default layout is contiguous by construction; any affine layout
+  // map may reorder or space out elements.
+  if (!memRefType.getAffineMaps().empty())
+    return false;
+  // The memref must be statically shaped to exactly the vector shape; a
+  // dynamic dimension never compares equal to a vector dimension.
+  if (memRefType.getShape() != vectorType.getShape())
+    return false;
+  // Element order in the vector must match memory order.
+  if (!transfer.getPermutationMap().isIdentity())
+    return false;
+  // All indices must be known zero so the transfer is exactly in bounds.
+  for (auto *index : transfer.getIndices()) {
+    auto *defOp = index->getDefiningOp();
+    if (!defOp)
+      return false;
+    auto constOp = dyn_cast<ConstantIndexOp>(defOp);
+    if (!constOp || constOp.getValue() != 0)
+      return false;
+  }
+  return true;
+}
+
 /// Analyzes the `transfer` to find an access dimension along the fastest remote
 /// MemRef dimension. If such a dimension with coalescing properties is found,
 /// `pivs` and `vectorView` are swapped so that the invocation of
@@ -266,6 +301,18 @@ VectorTransferRewriter<VectorTransferReadOp>::matchAndRewrite(
 
   VectorTransferReadOp transfer = cast<VectorTransferReadOp>(op);
 
+  // 0. Fast path: a provably contiguous full transfer is a single wide load
+  // through a vector view of the remote memref - no staging buffer, no
+  // clipped scalar copy loop.
+  if (isContiguousFullTransfer(transfer)) {
+    ScopedContext scope(rewriter, transfer.getLoc());
+    ValueHandle vec = vector_type_cast(ValueHandle(transfer.getMemRef()),
+                                       vectorMemRefType(transfer));
+    ValueHandle vectorValue = load(vec, {constant_index(0)});
+    rewriter.replaceOp(op, vectorValue.getValue());
+    return matchSuccess();
+  }
+
   // 1. Setup all the captures.
   ScopedContext scope(rewriter, transfer.getLoc());
   IndexedValue remote(transfer.getMemRef());
@@ -325,6 +372,17 @@ VectorTransferRewriter<VectorTransferWriteOp>::matchAndRewrite(
 
   VectorTransferWriteOp transfer = cast<VectorTransferWriteOp>(op);
 
+  // 0. Fast path: a provably contiguous full transfer is a single wide store
+  // through a vector view of the remote memref.
+  if (isContiguousFullTransfer(transfer)) {
+    ScopedContext scope(rewriter, transfer.getLoc());
+    ValueHandle vec = vector_type_cast(ValueHandle(transfer.getMemRef()),
+                                       vectorMemRefType(transfer));
+    store(ValueHandle(transfer.getVector()), vec, {constant_index(0)});
+    rewriter.replaceOp(op, llvm::None);
+    return matchSuccess();
+  }
+
   // 1. Setup all the captures.
   ScopedContext scope(rewriter, transfer.getLoc());
   IndexedValue remote(transfer.getMemRef());
@@ -668,9 +668,8 @@ static bool emitSlice(MaterializationState *state,
 /// scope.
 /// TODO(ntv): please document return value.
 static bool materialize(Function *f, const SetVector<Operation *> &terminators,
-                        MaterializationState *state) {
+                        MaterializationState *state, DominanceInfo &domInfo) {
   DenseSet<Operation *> seen;
-  DominanceInfo domInfo(f);
   for (auto *term : terminators) {
     // Short-circuit test, a given terminator may have been reached by some
     // other previous transitive use-def chains.
@@ -761,7 +760,7 @@ void MaterializeVectorsPass::runOnFunction() {
     terminators.insert(m.getMatchedOperation());
   }
 
-  if (materialize(f, terminators, &state))
+  if (materialize(f, terminators, &state, getAnalysis<DominanceInfo>()))
     signalPassFailure();
 }
 
@@ -23,11 +23,13 @@
 //===----------------------------------------------------------------------===//
 
 #include "mlir/Analysis/AffineAnalysis.h"
+#include "mlir/Analysis/AliasAnalysis.h"
 #include "mlir/Analysis/Dominance.h"
 #include "mlir/Analysis/Utils.h"
 #include "mlir/Pass/Pass.h"
 #include "mlir/StandardOps/Ops.h"
 #include "mlir/Transforms/Passes.h"
+#include "llvm/ADT/DenseMap.h"
 #include "llvm/ADT/SmallPtrSet.h"
 #include <algorithm>
 
@@ -69,11 +71,29 @@ namespace {
 // currently only eliminates the stores only if no other loads/uses (other
 // than dealloc) remain.
 //
+// A store op in the per-memref access index, with its access and nesting
+// depth precomputed once instead of once per load examining it.
+struct StoreAccess {
+  explicit StoreAccess(Operation *opInst)
+      : access(opInst), depth(getNestingDepth(*opInst)) {}
+
+  MemRefAccess access;
+  unsigned depth;
+};
+
 struct MemRefDataFlowOpt : public FunctionPass<MemRefDataFlowOpt> {
   void runOnFunction() override;
 
   void forwardStoreToLoad(LoadOp loadOp);
 
+  // An index of the store ops in the function, bucketed by the underlying
+  // memref they write to, so that stores and loads related through
+  // 'memref_cast' land in the same bucket. Each load only examines the stores
+  // on its own memref instead of scanning the memref's use list; the index
+  // stays valid during the walk since no store is erased until the final
+  // sweep.
+  DenseMap<Value *, SmallVector<StoreAccess, 4>> storesByMemRef;
+
   // A list of memref's that are potentially dead / could be eliminated.
   SmallPtrSet<Value *, 4> memrefsToErase;
   // Load op's whose results were replaced by those forwarded from stores.
@@ -91,29 +111,32 @@ FunctionPassBase *mlir::createMemRefDataFlowOptPass() {
   return new MemRefDataFlowOpt();
 }
 
-// This is a straightforward implementation not optimized for speed. Optimize
-// this in the future if needed.
 void MemRefDataFlowOpt::forwardStoreToLoad(LoadOp loadOp) {
   Operation *lastWriteStoreOp = nullptr;
   Operation *loadOpInst = loadOp.getOperation();
 
-  // First pass over the use list to get minimum number of surrounding
+  // Look up the stores on this memref in the access index; a memref that is
+  // never stored to has nothing to forward.
+  auto storesIt = storesByMemRef.find(getUnderlyingMemRef(loadOp.getMemRef()));
+  if (storesIt == storesByMemRef.end())
+    return;
+  ArrayRef<StoreAccess> storeAccesses = storesIt->second;
+
+  unsigned loadOpDepth = getNestingDepth(*loadOpInst);
+
+  // First pass over the stores to get minimum number of surrounding
   // loops common between the load op and the store op, with min taken across
-  // all store ops.
-  SmallVector<Operation *, 8> storeOps;
-  unsigned minSurroundingLoops = getNestingDepth(*loadOpInst);
-  for (auto *user : loadOp.getMemRef()->getUsers()) {
-    auto storeOp = dyn_cast<StoreOp>(user);
-    if (!storeOp)
-      continue;
-    auto *storeOpInst = storeOp.getOperation();
-    unsigned nsLoops = getNumCommonSurroundingLoops(*loadOpInst, *storeOpInst);
+  // all store ops. The per-store counts are kept for reuse below.
+  SmallVector<unsigned, 8> commonLoopCounts;
+  commonLoopCounts.reserve(storeAccesses.size());
+  unsigned minSurroundingLoops = loadOpDepth;
+  for (const auto &store : storeAccesses) {
+    unsigned nsLoops =
+        getNumCommonSurroundingLoops(*loadOpInst, *store.access.opInst);
     minSurroundingLoops = std::min(nsLoops, minSurroundingLoops);
-    storeOps.push_back(storeOpInst);
+    commonLoopCounts.push_back(nsLoops);
   }
 
-  unsigned loadOpDepth = getNestingDepth(*loadOpInst);
-
   // 1. Check if there is a dependence satisfied at depth equal to the depth
   // of the loop body of the innermost common surrounding loop of the storeOp
   // and loadOp.
@@ -124,11 +147,13 @@ void MemRefDataFlowOpt::forwardStoreToLoad(LoadOp loadOp) {
   // forwarding candidates). Each forwarding candidate will be checked for a
   // post-dominance on these. 'fwdingCandidates' are a subset of depSrcStores.
   SmallVector<Operation *, 8> depSrcStores;
-  for (auto *storeOpInst : storeOps) {
-    MemRefAccess srcAccess(storeOpInst);
-    MemRefAccess destAccess(loadOpInst);
+  MemRefAccess destAccess(loadOpInst);
+  for (unsigned storeIdx = 0, e = storeAccesses.size(); storeIdx != e;
+       ++storeIdx) {
+    const MemRefAccess &srcAccess = storeAccesses[storeIdx].access;
+    Operation *storeOpInst = srcAccess.opInst;
     FlatAffineConstraints dependenceConstraints;
-    unsigned nsLoops = getNumCommonSurroundingLoops(*loadOpInst, *storeOpInst);
+    unsigned nsLoops = commonLoopCounts[storeIdx];
     // Dependences at loop depth <= minSurroundingLoops do NOT matter.
     for (unsigned d = nsLoops + 1; d > minSurroundingLoops; d--) {
       DependenceResult result = checkMemrefAccessDependence(
@@ -166,7 +191,7 @@ void MemRefDataFlowOpt::forwardStoreToLoad(LoadOp loadOp) {
       // If storeOpInst and loadOpDepth at the same nesting depth, the load Op
       // is trivially loading from a single location at that depth; so there
       // isn't a need to call isRangeOneToOne.
-      if (getNestingDepth(*storeOpInst) < loadOpDepth) {
+      if (storeAccesses[storeIdx].depth < loadOpDepth) {
         MemRefRegion region(loadOpInst->getLoc());
         region.compute(loadOpInst, nsLoops);
         if (!region.getConstraints()->isRangeOneToOne(
@@ -223,6 +248,14 @@ void MemRefDataFlowOpt::runOnFunction() {
 
   loadOpsToErase.clear();
   memrefsToErase.clear();
+  storesByMemRef.clear();
+
+  // Build the per-memref store index, precomputing each store's access and
+  // nesting depth once rather than once per load examining it.
+  f.walk<StoreOp>([&](StoreOp storeOp) {
+    storesByMemRef[getUnderlyingMemRef(storeOp.getMemRef())].push_back(
+        StoreAccess(storeOp.getOperation()));
+  });
 
   // Walk all load's and perform load/store forwarding.
   f.walk<LoadOp>([&](LoadOp loadOp) { forwardStoreToLoad(loadOp); });
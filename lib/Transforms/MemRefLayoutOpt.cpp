@@ -0,0 +1,219 @@
+//===- MemRefLayoutOpt.cpp - MemRef data layout optimization pass -------*-===//
+//
+// Copyright 2019 The MLIR Authors.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+// =============================================================================
+//
+// This file implements a pass that rewrites the layout of function-local
+// memrefs to match their dominant access order: the dimension that varies in
+// the innermost loops around the accesses is moved to the last position so
+// those accesses become stride-1, and the innermost dimension is padded when
+// a row would otherwise sit at a large power-of-two stride and alias itself
+// in the cache.
+//
+//===----------------------------------------------------------------------===//
+
+#include "mlir/AffineOps/AffineOps.h"
+#include "mlir/Analysis/AffineAnalysis.h"
+#include "mlir/Analysis/AffineStructures.h"
+#include "mlir/Analysis/LoopAnalysis.h"
+#include "mlir/Analysis/Utils.h"
+#include "mlir/IR/Builders.h"
+#include "mlir/Pass/Pass.h"
+#include "mlir/StandardOps/Ops.h"
+#include "mlir/Transforms/Passes.h"
+#include "mlir/Transforms/Utils.h"
+#include "llvm/Support/Debug.h"
+
+using namespace mlir;
+
+#define DEBUG_TYPE "memref-layout-opt"
+
+// Rows whose byte stride is a multiple of this alias in the cache and TLB;
+// such rows get padded.
+static constexpr uint64_t kConflictStrideBytes = 4096;
+
+// Number of bytes of padding used to break a conflicting stride, one cache
+// line.
+static constexpr uint64_t kPadBytes = 64;
+
+// Trip count assumed for loops without a constant trip count when weighting
+// accesses by execution frequency.
+static constexpr uint64_t kDefaultTripCount = 64;
+
+// Bound on access weights so that deeply nested accesses cannot overflow the
+// per-dimension vote counters.
+static constexpr uint64_t kMaxWeight = 1ull << 40;
+
+namespace {
+
+/// A pass that permutes and pads the layout of function-local memrefs to make
+/// the dominant accesses stride-1.
+struct MemRefLayoutOpt : public FunctionPass<MemRefLayoutOpt> {
+  void runOnFunction() override;
+};
+
+} // end anonymous namespace
+
+FunctionPassBase *mlir::createMemRefLayoutOptPass() {
+  return new MemRefLayoutOpt();
+}
+
+/// Returns the innermost 'affine.for' enclosing 'op', if any.
+static AffineForOp getInnermostEnclosingFor(Operation *op) {
+  for (auto *parent = op->getParentOp(); parent;
+       parent = parent->getParentOp())
+    if (auto forOp = dyn_cast<AffineForOp>(parent))
+      return forOp;
+  return AffineForOp();
+}
+
+/// Returns an estimate of how often 'op' executes: the product of the trip
+/// counts of its enclosing affine loops, assuming a default extent for loops
+/// without a constant trip count.
+static uint64_t getAccessWeight(Operation *op) {
+  uint64_t weight = 1;
+  for (auto *parent = op->getParentOp(); parent;
+       parent = parent->getParentOp()) {
+    auto forOp = dyn_cast<AffineForOp>(parent);
+    if (!forOp)
+      continue;
+    auto tripCount = getConstantTripCount(forOp);
+    weight *= tripCount.hasValue() ? tripCount.getValue() : kDefaultTripCount;
+    if (weight >= kMaxWeight)
+      return kMaxWeight;
+  }
+  return weight;
+}
+
+/// Rewrites the layout of the buffer defined by 'allocOp' to match the
+/// dominant access order of its loads and stores. Returns true if the alloc
+/// and its accesses were rewritten.
+static bool optimizeLayout(AllocOp allocOp) {
+  auto memRefType = allocOp.getType();
+  unsigned rank = memRefType.getRank();
+  if (rank < 2 || !memRefType.hasStaticShape() ||
+      !memRefType.getAffineMaps().empty())
+    return false;
+
+  // Every user must be a load, store or dealloc so that all accesses can be
+  // remapped; any other use (a call, a DMA, a return) pins the layout.
+  Value *oldMemRef = allocOp.getResult();
+  SmallVector<Operation *, 8> accesses;
+  for (auto &use : oldMemRef->getUses()) {
+    auto *op = use.getOwner();
+    if (isa<DeallocOp>(op))
+      continue;
+    if (!isa<LoadOp>(op) && !isa<StoreOp>(op))
+      return false;
+    accesses.push_back(op);
+  }
+  if (accesses.empty())
+    return false;
+
+  // Vote for each dimension by how often it varies with the innermost loop
+  // around an access, weighting each access by its estimated execution
+  // frequency. The winning dimension is the one that should carry stride 1.
+  SmallVector<uint64_t, 4> votes(rank, 0);
+  for (auto *op : accesses) {
+    auto forOp = getInnermostEnclosingFor(op);
+    if (!forOp)
+      continue;
+    MemRefAccess access(op);
+    AffineValueMap accessMap;
+    access.getAccessMap(&accessMap);
+    uint64_t weight = getAccessWeight(op);
+    for (unsigned d = 0; d < rank; ++d)
+      if (accessMap.isFunctionOf(d, forOp.getInductionVar()))
+        votes[d] += weight;
+  }
+
+  // Prefer the later dimension on ties so an already stride-1 layout is left
+  // alone.
+  unsigned hotDim = 0;
+  for (unsigned d = 1; d < rank; ++d)
+    if (votes[d] >= votes[hotDim])
+      hotDim = d;
+  if (votes[hotDim] == 0)
+    return false;
+
+  // Move the winning dimension last, keeping the relative order of the
+  // others; perm[j] holds the old position of the dimension at new position
+  // 'j'.
+  SmallVector<unsigned, 4> perm;
+  perm.reserve(rank);
+  for (unsigned d = 0; d < rank; ++d)
+    if (d != hotDim)
+      perm.push_back(d);
+  perm.push_back(hotDim);
+
+  auto shape = memRefType.getShape();
+  SmallVector<int64_t, 4> newShape;
+  newShape.reserve(rank);
+  for (unsigned j = 0; j < rank; ++j)
+    newShape.push_back(shape[perm[j]]);
+
+  // Pad the innermost dimension when a row would land on a conflicting
+  // power-of-two stride; the padding shifts consecutive rows into different
+  // cache sets and is never accessed.
+  uint64_t eltBytes = getMemRefEltSizeInBytes(memRefType);
+  bool padded = false;
+  if (eltBytes != 0 &&
+      (uint64_t(newShape.back()) * eltBytes) % kConflictStrideBytes == 0) {
+    newShape.back() += (kPadBytes + eltBytes - 1) / eltBytes;
+    padded = true;
+  }
+  bool permuted = hotDim != rank - 1;
+  if (!permuted && !padded)
+    return false;
+
+  // Create the new buffer and remap every access through the permutation.
+  OpBuilder b(allocOp);
+  auto newMemRefType = b.getMemRefType(newShape, memRefType.getElementType(),
+                                       {}, memRefType.getMemorySpace());
+  auto newAlloc = b.create<AllocOp>(allocOp.getLoc(), newMemRefType);
+  AffineMap indexRemap;
+  if (permuted) {
+    SmallVector<AffineExpr, 4> remapExprs;
+    remapExprs.reserve(rank);
+    for (unsigned j = 0; j < rank; ++j)
+      remapExprs.push_back(b.getAffineDimExpr(perm[j]));
+    indexRemap = b.getAffineMap(rank, 0, remapExprs);
+  }
+  if (!replaceAllMemRefUsesWith(oldMemRef, newAlloc.getResult(), {},
+                                indexRemap)) {
+    newAlloc.erase();
+    return false;
+  }
+
+  // Only deallocs are left on the old buffer; point them at the new one and
+  // drop the old alloc.
+  oldMemRef->replaceAllUsesWith(newAlloc.getResult());
+  allocOp.erase();
+  return true;
+}
+
+void MemRefLayoutOpt::runOnFunction() {
+  SmallVector<AllocOp, 8> allocOps;
+  getFunction().walk<AllocOp>([&](AllocOp allocOp) {
+    allocOps.push_back(allocOp);
+  });
+  for (auto allocOp : allocOps)
+    optimizeLayout(allocOp);
+}
+
+static PassRegistration<MemRefLayoutOpt>
+    pass("memref-layout-opt",
+         "Permute and pad the layout of local memrefs to make the dominant "
+         "accesses stride-1");
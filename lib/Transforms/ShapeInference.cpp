@@ -0,0 +1,193 @@
+//===- ShapeInference.cpp - Propagate static shapes forward ---------------===//
+//
+// Copyright 2019 The MLIR Authors.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// =============================================================================
+//
+// This pass propagates static shape information forward through a function.
+// Dynamic dimensions otherwise survive even when deducible - an alloc sized
+// by constants still produces a memref<?x...>, and a memref_cast that erases
+// a static shape hides it from every consumer - which blocks unrolling,
+// vectorization and static buffer allocation downstream. Three refinements
+// feed each other over a worklist: allocs with constant dimension operands
+// are rebuilt with a static type, shape-erasing casts are bypassed at
+// consumers that are polymorphic in their operand's shape, and dim operations
+// whose dimension has become static are replaced by the constant. Only
+// operations whose operands actually changed are revisited, so the pass
+// scales to very large functions.
+//
+//===----------------------------------------------------------------------===//
+
+#include "mlir/IR/Builders.h"
+#include "mlir/IR/Function.h"
+#include "mlir/IR/StandardTypes.h"
+#include "mlir/Pass/Pass.h"
+#include "mlir/StandardOps/Ops.h"
+#include "mlir/Transforms/Passes.h"
+#include "llvm/ADT/DenseSet.h"
+
+using namespace mlir;
+
+namespace {
+/// Forward dataflow pass refining memref and tensor types where provably
+/// static.
+struct ShapeInference : public FunctionPass<ShapeInference> {
+  void runOnFunction() override;
+
+  /// Adds 'op' to the worklist if it is not already pending.
+  void enqueue(Operation *op) {
+    if (pending.insert(op).second)
+      worklist.push_back(op);
+  }
+
+  /// Adds the users of 'value' to the worklist.
+  void enqueueUsers(Value *value) {
+    for (auto &use : value->getUses())
+      enqueue(use.getOwner());
+  }
+
+  /// Applies the refinement appropriate for 'op', if any.
+  void visit(Operation *op);
+
+  std::vector<Operation *> worklist;
+  llvm::DenseSet<Operation *> pending;
+};
+} // end anonymous namespace
+
+/// Returns true if 'op' places no constraint on the shapes of its memref and
+/// tensor operands and hence can use a value of a more static type directly.
+/// Operand types coupled to an external signature - calls, returns, successor
+/// arguments - must keep the type they were built with.
+static bool isShapePolymorphicUser(Operation *op) {
+  return isa<LoadOp>(op) || isa<StoreOp>(op) || isa<DeallocOp>(op) ||
+         isa<DimOp>(op) || isa<ExtractElementOp>(op);
+}
+
+/// Returns true if 'refined' carries strictly more static shape information
+/// than 'generic'.
+static bool isShapeRefinement(Type refined, Type generic) {
+  auto refinedShape = refined.dyn_cast<ShapedType>();
+  auto genericShape = generic.dyn_cast<ShapedType>();
+  if (!refinedShape || !genericShape || !refinedShape.hasRank())
+    return false;
+  if (!genericShape.hasRank())
+    return true;
+  return refinedShape.getNumDynamicDims() < genericShape.getNumDynamicDims();
+}
+
+/// Rebuilds 'alloc' with the dimension operands that are defined by constants
+/// folded into a static type, casting the result back to the original type
+/// for the benefit of users that are not shape polymorphic. Returns the cast
+/// whose users should be revisited, or nullptr if no operand is constant.
+static Operation *refineAlloc(AllocOp alloc) {
+  auto memrefType = alloc.getType();
+  SmallVector<int64_t, 4> newShape;
+  SmallVector<Value *, 4> newOperands;
+  bool anyFolded = false;
+  unsigned dynamicDimPos = 0;
+  for (unsigned dim = 0, e = memrefType.getRank(); dim != e; ++dim) {
+    int64_t dimSize = memrefType.getDimSize(dim);
+    if (dimSize != -1) {
+      newShape.push_back(dimSize);
+      continue;
+    }
+    auto *defOp = alloc.getOperand(dynamicDimPos++)->getDefiningOp();
+    if (auto constantIndexOp = dyn_cast_or_null<ConstantIndexOp>(defOp)) {
+      newShape.push_back(constantIndexOp.getValue());
+      anyFolded = true;
+    } else {
+      newShape.push_back(-1);
+      newOperands.push_back(alloc.getOperand(dynamicDimPos - 1));
+    }
+  }
+  if (!anyFolded)
+    return nullptr;
+
+  auto newMemRefType =
+      MemRefType::get(newShape, memrefType.getElementType(),
+                      memrefType.getAffineMaps(), memrefType.getMemorySpace());
+  OpBuilder builder(alloc.getOperation());
+  auto newAlloc =
+      builder.create<AllocOp>(alloc.getLoc(), newMemRefType, newOperands);
+  auto cast = builder.create<MemRefCastOp>(alloc.getLoc(), newAlloc.getResult(),
+                                           memrefType);
+  alloc.getResult()->replaceAllUsesWith(cast.getResult());
+  alloc.erase();
+  return cast.getOperation();
+}
+
+void ShapeInference::visit(Operation *op) {
+  if (auto alloc = dyn_cast<AllocOp>(op)) {
+    if (Operation *cast = refineAlloc(alloc))
+      enqueue(cast);
+    return;
+  }
+
+  // Bypass a shape-erasing cast at every consumer that is polymorphic in its
+  // operand's shape; those consumers then see the static type.
+  if (isa<MemRefCastOp>(op) || isa<TensorCastOp>(op)) {
+    Value *source = op->getOperand(0);
+    Value *result = op->getResult(0);
+    if (!isShapeRefinement(source->getType(), result->getType()))
+      return;
+    SmallVector<std::pair<Operation *, unsigned>, 8> targets;
+    for (auto &use : result->getUses())
+      if (isShapePolymorphicUser(use.getOwner()))
+        targets.emplace_back(use.getOwner(), use.getOperandNumber());
+    for (auto &target : targets) {
+      target.first->setOperand(target.second, source);
+      enqueue(target.first);
+    }
+    if (result->use_empty()) {
+      pending.erase(op);
+      op->erase();
+    }
+    return;
+  }
+
+  // Replace a dim whose dimension has become static by the constant.
+  if (auto dim = dyn_cast<DimOp>(op)) {
+    auto type = dim.getOperand()->getType().dyn_cast<ShapedType>();
+    if (!type || !type.hasRank())
+      return;
+    int64_t size = type.getDimSize(dim.getIndex());
+    if (size < 0)
+      return;
+    OpBuilder builder(op);
+    auto constant = builder.create<ConstantIndexOp>(op->getLoc(), size);
+    enqueueUsers(dim.getResult());
+    dim.getResult()->replaceAllUsesWith(constant.getResult());
+    op->erase();
+  }
+}
+
+void ShapeInference::runOnFunction() {
+  getFunction().walk([&](Operation *op) { enqueue(op); });
+  while (!worklist.empty()) {
+    Operation *op = worklist.back();
+    worklist.pop_back();
+    if (!pending.erase(op))
+      continue;
+    visit(op);
+  }
+}
+
+FunctionPassBase *mlir::createShapeInferencePass() {
+  return new ShapeInference();
+}
+
+static PassRegistration<ShapeInference>
+    pass("shape-inference",
+         "Propagate static memref/tensor shapes forward through a function");
@@ -0,0 +1,142 @@
+//===- SimplifyControlFlow.cpp - CFG simplification pass ------------------===//
+//
+// Copyright 2019 The MLIR Authors.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+// =============================================================================
+//
+// This file implements a pass that simplifies the control flow graph of a
+// function. Lowering passes tend to leave behind long chains of blocks joined
+// by unconditional branches; this pass merges blocks linked by such branches,
+// forwards branches through blocks that only re-branch, and erases blocks
+// that become unreachable, shrinking the CFG for every subsequent pass.
+//
+//===----------------------------------------------------------------------===//
+
+#include "mlir/IR/Block.h"
+#include "mlir/IR/Operation.h"
+#include "mlir/Pass/Pass.h"
+#include "mlir/StandardOps/Ops.h"
+#include "mlir/Transforms/Passes.h"
+#include "mlir/Transforms/RegionUtils.h"
+using namespace mlir;
+
+/// Merge each block that unconditionally branches to a block with no other
+/// predecessors into that branch's destination. Returns true if any blocks
+/// were merged.
+static bool mergeTriviallyLinkedBlocks(Region &region) {
+  bool changed = false;
+  for (Block &block : region) {
+    // Keep absorbing successors into 'block' as long as it ends with an
+    // unconditional branch to a block it solely owns.
+    while (!block.empty()) {
+      auto br = dyn_cast<BranchOp>(block.getTerminator());
+      if (!br)
+        break;
+      Block *dest = br.getDest();
+      if (dest == &block || dest->getSinglePredecessor() != &block)
+        break;
+
+      // Replace the destination's arguments with the branch operands, then
+      // splice its operations in place of the branch.
+      for (unsigned i = 0, e = dest->getNumArguments(); i != e; ++i)
+        dest->getArgument(i)->replaceAllUsesWith(br.getOperand(i));
+      br.erase();
+      block.getOperations().splice(block.end(), dest->getOperations());
+      dest->erase();
+      changed = true;
+    }
+  }
+  return changed;
+}
+
+/// Retarget the predecessors of blocks that contain nothing but an
+/// unconditional branch forwarding the block's own arguments, so that control
+/// flows directly to the branch's destination. The forwarding blocks are left
+/// without predecessors and are erased as unreachable afterwards. Returns
+/// true if any edges were retargeted.
+static bool threadTrivialBranches(Region &region) {
+  bool changed = false;
+  for (Block &block : region) {
+    if (std::next(block.begin()) != block.end())
+      continue;
+    auto br = dyn_cast<BranchOp>(block.front());
+    if (!br || br.getDest() == &block)
+      continue;
+
+    // The branch must pass the block's arguments through in order; any other
+    // operand list would need to be rewritten per predecessor edge.
+    if (br.getNumOperands() != block.getNumArguments())
+      continue;
+    bool forwardsArguments = true;
+    for (unsigned i = 0, e = br.getNumOperands(); i != e; ++i) {
+      if (br.getOperand(i) != block.getArgument(i)) {
+        forwardsArguments = false;
+        break;
+      }
+    }
+    if (!forwardsArguments)
+      continue;
+
+    // Collect the predecessor edges first; retargeting an edge unlinks it
+    // from this block's use list and would invalidate the iteration.
+    SmallVector<std::pair<Operation *, unsigned>, 4> predEdges;
+    for (auto it = block.pred_begin(), e = block.pred_end(); it != e; ++it)
+      predEdges.push_back({(*it)->getTerminator(), it.getSuccessorIndex()});
+    for (auto &edge : predEdges)
+      edge.first->setSuccessor(br.getDest(), edge.second);
+    changed |= !predEdges.empty();
+  }
+  return changed;
+}
+
+/// Simplify the CFG of `region` and of the regions nested within it. Returns
+/// true if any IR was changed.
+static bool simplifyRegion(Region &region) {
+  bool anyChanged = false;
+
+  // The transformations feed each other: threading a branch leaves the
+  // forwarding block unreachable, and erasing dead blocks can give a merge
+  // candidate a single predecessor. Iterate until none of them applies.
+  bool changed;
+  do {
+    changed = eraseUnreachableBlocks(region);
+    changed |= mergeTriviallyLinkedBlocks(region);
+    changed |= threadTrivialBranches(region);
+    anyChanged |= changed;
+  } while (changed);
+
+  for (Block &block : region)
+    for (Operation &op : block)
+      for (Region &nested : op.getRegions())
+        anyChanged |= simplifyRegion(nested);
+  return anyChanged;
+}
+
+namespace {
+struct SimplifyControlFlow : public FunctionPass<SimplifyControlFlow> {
+  void runOnFunction() override {
+    if (!simplifyRegion(getFunction().getBody()))
+      markAllAnalysesPreserved();
+  }
+};
+} // end anonymous namespace
+
+/// Creates a pass to simplify the control flow graph of functions.
+FunctionPassBase *mlir::createSimplifyControlFlowPass() {
+  return new SimplifyControlFlow();
+}
+
+static PassRegistration<SimplifyControlFlow>
+    pass("simplify-cfg",
+         "Merge and remove redundant blocks in the control flow graph");
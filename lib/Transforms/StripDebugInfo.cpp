@@ -35,6 +35,9 @@ void StripDebugInfo::runOnFunction() {
   // Strip the debug info from the function and its operations.
   func.setLoc(unknownLoc);
   func.walk([&](Operation *op) { op->setLoc(unknownLoc); });
+
+  // Location updates do not affect any analysis results.
+  markAllAnalysesPreserved();
 }
 
 /// Creates a pass to strip debug information from a function.
@@ -23,9 +23,11 @@
 #include "mlir/Transforms/FoldUtils.h"
 
 #include "mlir/IR/Builders.h"
+#include "mlir/IR/MLIRContext.h"
 #include "mlir/IR/Matchers.h"
 #include "mlir/IR/Operation.h"
 #include "mlir/StandardOps/Ops.h"
+#include "llvm/ADT/STLExtras.h"
 
 using namespace mlir;
 
@@ -70,6 +72,98 @@ static Operation *materializeConstant(Dialect *dialect, OpBuilder &builder,
   return nullptr;
 }
 
+//===----------------------------------------------------------------------===//
+// Fold result memoization
+//===----------------------------------------------------------------------===//
+
+namespace {
+/// A process-wide memoization cache for constant folding results. Identical
+/// fold queries, i.e. the same operation name, attributes, constant operands,
+/// and result types, recur across functions and modules; when every operand is
+/// a known constant the answer is a pure function of the uniqued objects in
+/// the key, so it can be shared by every OperationFolder in the process. Each
+/// entry embeds the unique ID of the context its key objects belong to, so an
+/// entry can never alias the objects of a context created later at the same
+/// addresses. Entries from destroyed contexts linger until the size cap
+/// flushes the cache, but are never returned.
+struct FoldCache {
+  struct Entry {
+    /// The unique ID of the context the key objects belong to.
+    uint64_t contextID;
+
+    /// The uniqued objects identifying this query, see buildFoldCacheKey.
+    SmallVector<const void *, 8> key;
+
+    /// Whether the fold hook succeeded for this query.
+    bool succeeded;
+
+    /// The attribute results produced on success.
+    SmallVector<Attribute, 2> results;
+  };
+
+  /// A map from key hash to the entries sharing that hash.
+  DenseMap<unsigned, SmallVector<Entry, 1>> entries;
+
+  /// A mutex protecting 'entries'.
+  llvm::sys::SmartMutex<true> mutex;
+
+  /// An upper bound on the number of hash buckets held; the cache is dropped
+  /// wholesale when it is exceeded.
+  enum { MaxNumBuckets = 16384 };
+};
+} // end anonymous namespace
+
+/// Returns the process-wide fold result cache.
+static FoldCache &getFoldCache() {
+  static FoldCache cache;
+  return cache;
+}
+
+/// Builds the cache key identifying a fold query on 'op' with the given
+/// constant operands: the operation name, operand count, operand constants,
+/// attributes, and result types. All components are uniqued in the context,
+/// so their addresses identify their values.
+static void buildFoldCacheKey(Operation *op,
+                              ArrayRef<Attribute> operandConstants,
+                              SmallVectorImpl<const void *> &key) {
+  key.push_back(op->getName().getAsOpaquePointer());
+  key.push_back(reinterpret_cast<const void *>(
+      static_cast<uintptr_t>(op->getNumOperands())));
+  for (Attribute attr : operandConstants)
+    key.push_back(attr.getAsOpaquePointer());
+  for (const NamedAttribute &namedAttr : op->getAttrs()) {
+    key.push_back(namedAttr.first.getAsOpaquePointer());
+    key.push_back(namedAttr.second.getAsOpaquePointer());
+  }
+  for (unsigned i = 0, e = op->getNumResults(); i != e; ++i)
+    key.push_back(op->getResult(i)->getType().getAsOpaquePointer());
+}
+
+/// Records the outcome of a fold query in the cache.
+static void recordFoldResult(unsigned hash, uint64_t contextID,
+                             ArrayRef<const void *> key, bool succeeded,
+                             ArrayRef<Attribute> results) {
+  FoldCache &cache = getFoldCache();
+  llvm::sys::SmartScopedLock<true> lock(cache.mutex);
+
+  // Drop the cache wholesale once it grows past the size cap.
+  if (cache.entries.size() >= FoldCache::MaxNumBuckets)
+    cache.entries.clear();
+
+  // Another thread may have recorded this query in the meantime.
+  auto &bucket = cache.entries[hash];
+  for (FoldCache::Entry &entry : bucket)
+    if (entry.contextID == contextID && llvm::makeArrayRef(entry.key) == key)
+      return;
+
+  FoldCache::Entry entry;
+  entry.contextID = contextID;
+  entry.key.assign(key.begin(), key.end());
+  entry.succeeded = succeeded;
+  entry.results.assign(results.begin(), results.end());
+  bucket.push_back(std::move(entry));
+}
+
 //===----------------------------------------------------------------------===//
 // OperationFolder
 //===----------------------------------------------------------------------===//
@@ -120,7 +214,9 @@ void OperationFolder::notifyRemoval(Operation *op) {
   assert(constValue);
 
   // Get the constant map that this operation was uniqued in.
-  auto &uniquedConstants = foldScopes[getInsertionRegion(op)];
+  auto &uniquedConstants = constructionMode
+                               ? constructionScopes[op->getBlock()]
+                               : foldScopes[getInsertionRegion(op)];
 
   // Erase all of the references to this operation.
   auto type = op->getResult(0)->getType();
@@ -151,23 +247,102 @@ LogicalResult OperationFolder::tryToFold(
     std::swap(operandConstants[0], operandConstants[1]);
   }
 
+  // A fold query where every operand is a known constant is a pure function
+  // of uniqued objects and is eligible for memoization. Folds with
+  // non-constant operands may inspect the operands' defining operations and
+  // are always re-evaluated.
+  bool isCacheable = op->getNumRegions() == 0 && op->getNumResults() != 0 &&
+                     llvm::all_of(operandConstants,
+                                  [](Attribute attr) { return bool(attr); });
+  SmallVector<const void *, 8> cacheKey;
+  unsigned cacheHash = 0;
+  uint64_t contextID = 0;
+  bool foldedFromCache = false;
+  if (isCacheable) {
+    buildFoldCacheKey(op, operandConstants, cacheKey);
+    contextID = op->getContext()->getContextID();
+    cacheHash = llvm::hash_combine(
+        contextID, llvm::hash_combine_range(cacheKey.begin(), cacheKey.end()));
+
+    // Consult the cache before invoking the fold hook.
+    FoldCache &cache = getFoldCache();
+    llvm::sys::SmartScopedLock<true> lock(cache.mutex);
+    auto it = cache.entries.find(cacheHash);
+    if (it != cache.entries.end()) {
+      for (FoldCache::Entry &entry : it->second) {
+        if (entry.contextID != contextID ||
+            llvm::makeArrayRef(entry.key) != llvm::makeArrayRef(cacheKey))
+          continue;
+        if (!entry.succeeded)
+          return failure();
+        foldResults.append(entry.results.begin(), entry.results.end());
+        foldedFromCache = true;
+        break;
+      }
+    }
+  }
+
   // Attempt to constant fold the operation.
-  if (failed(op->fold(operandConstants, foldResults)))
-    return failure();
+  if (!foldedFromCache) {
+    if (failed(op->fold(operandConstants, foldResults))) {
+      if (isCacheable)
+        recordFoldResult(cacheHash, contextID, cacheKey, /*succeeded=*/false,
+                         /*results=*/llvm::None);
+      return failure();
+    }
+
+    // Record successful folds whose results are all attributes. Successes
+    // that update the operation in place or forward existing SSA values are
+    // tied to this specific operation and are not memoized.
+    if (isCacheable && !foldResults.empty() &&
+        llvm::all_of(foldResults,
+                     [](OpFoldResult result) { return result.is<Attribute>(); })) {
+      SmallVector<Attribute, 2> resultAttrs;
+      for (OpFoldResult result : foldResults)
+        resultAttrs.push_back(result.get<Attribute>());
+      recordFoldResult(cacheHash, contextID, cacheKey, /*succeeded=*/true,
+                       resultAttrs);
+    }
+  }
 
   // Check to see if the operation was just updated in place.
   if (foldResults.empty())
     return success();
   assert(foldResults.size() == op->getNumResults());
 
-  // Create a builder to insert new operations into the entry block of the
-  // insertion region.
-  auto *insertionRegion = getInsertionRegion(op);
-  auto &entry = insertionRegion->front();
-  OpBuilder builder(&entry, entry.begin());
-
-  // Get the constant map for the insertion region of this operation.
-  auto &uniquedConstants = foldScopes[insertionRegion];
+  // Create a builder to insert new operations. In construction mode the IR is
+  // being built in topological order, so constants are materialized directly
+  // before the operation being folded and everything stays append-only.
+  // Otherwise they are hoisted into the entry block of the insertion region;
+  // when rewriting runs on multiple threads that block is shared between the
+  // workers, so materialization is serialized.
+  llvm::Optional<llvm::sys::SmartScopedLock<true>> guard;
+  if (insertionLock)
+    guard.emplace(*insertionLock);
+  Block *insertBlock;
+  Block::iterator insertPt;
+  if (constructionMode) {
+    insertBlock = op->getBlock();
+    insertPt = Block::iterator(op);
+  } else {
+    insertBlock = &getInsertionRegion(op)->front();
+    insertPt = insertBlock->begin();
+  }
+  OpBuilder builder(insertBlock, insertPt);
+
+  // Remember the operation preceding the insertion point, if any, so that the
+  // range of generated constants can be recovered after materialization.
+  Operation *opBeforeGenerated =
+      insertPt == insertBlock->begin() ? nullptr : &*std::prev(insertPt);
+  auto getGeneratedBegin = [&] {
+    return opBeforeGenerated ? std::next(Block::iterator(opBeforeGenerated))
+                             : insertBlock->begin();
+  };
+
+  // Get the constant map for the insertion scope of this operation.
+  auto &uniquedConstants = constructionMode
+                               ? constructionScopes[insertBlock]
+                               : foldScopes[insertBlock->getParent()];
 
   // Create the result constants and replace the results.
   auto *dialect = op->getDialect();
@@ -191,8 +366,8 @@ LogicalResult OperationFolder::tryToFold(
     }
     // If materialization fails, cleanup any operations generated for the
     // previous results and return failure.
-    for (Operation &op : llvm::make_early_inc_range(
-             llvm::make_range(entry.begin(), builder.getInsertionPoint()))) {
+    for (Operation &op : llvm::make_early_inc_range(llvm::make_range(
+             getGeneratedBegin(), builder.getInsertionPoint()))) {
       notifyRemoval(&op);
       op.erase();
     }
@@ -201,7 +376,8 @@ LogicalResult OperationFolder::tryToFold(
 
   // Process any newly generated operations.
   if (processGeneratedConstants) {
-    for (auto i = entry.begin(), e = builder.getInsertionPoint(); i != e; ++i)
+    for (auto i = getGeneratedBegin(), e = builder.getInsertionPoint(); i != e;
+         ++i)
       processGeneratedConstants(&*i);
   }
 
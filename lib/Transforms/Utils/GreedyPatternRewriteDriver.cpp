@@ -24,9 +24,15 @@
 #include "mlir/StandardOps/Ops.h"
 #include "mlir/Transforms/FoldUtils.h"
 #include "llvm/ADT/DenseMap.h"
+#include "llvm/ADT/DenseSet.h"
 #include "llvm/Support/CommandLine.h"
 #include "llvm/Support/Debug.h"
+#include "llvm/Support/Mutex.h"
+#include "llvm/Support/Parallel.h"
 #include "llvm/Support/raw_ostream.h"
+#include <algorithm>
+#include <chrono>
+#include <numeric>
 
 using namespace mlir;
 
@@ -38,15 +44,44 @@ static llvm::cl::opt<unsigned> maxPatternMatchIterations(
         "Max number of iterations scanning the functions for pattern match"),
     llvm::cl::init(10));
 
+static llvm::cl::opt<bool> parallelPatternRewrites(
+    "mlir-parallel-greedy-rewriter",
+    llvm::cl::desc("Rewrite independent top-level operation nests of a "
+                   "function on multiple threads before running the "
+                   "sequential convergence iterations"),
+    llvm::cl::init(false));
+
+static llvm::cl::opt<unsigned> greedyRewriteTimeBudget(
+    "mlir-greedy-time-budget-ms",
+    llvm::cl::desc("Time budget in milliseconds for one greedy pattern "
+                   "rewrite invocation; the driver processes operations in "
+                   "decreasing pattern-benefit order and stops between "
+                   "rewrites when the budget expires (0 = no budget)"),
+    llvm::cl::init(0));
+
+static llvm::cl::opt<unsigned> greedyRewriteCountBudget(
+    "mlir-greedy-rewrite-budget",
+    llvm::cl::desc("Maximum number of successful rewrites for one greedy "
+                   "pattern rewrite invocation (0 = no budget)"),
+    llvm::cl::init(0));
+
+static llvm::cl::opt<bool> changeTrackingRewrites(
+    "mlir-greedy-change-tracking",
+    llvm::cl::desc("Seed rewrite iterations from the operations touched by "
+                   "the previous iteration, and skip functions on which the "
+                   "same pattern set already converged"),
+    llvm::cl::init(true));
+
 namespace {
 
 /// This is a worklist-driven driver for the PatternMatcher, which repeatedly
 /// applies the locally optimal patterns in a roughly "bottom up" way.
 class GreedyPatternRewriteDriver : public PatternRewriter {
 public:
-  explicit GreedyPatternRewriteDriver(Function &fn,
-                                      OwningRewritePatternList &&patterns)
-      : PatternRewriter(fn.getBody()), matcher(std::move(patterns)) {
+  GreedyPatternRewriteDriver(Function &fn, RewritePatternMatcher &matcher,
+                             bool excludeTopLevel = false)
+      : PatternRewriter(fn.getBody()), matcher(matcher),
+        excludeTopLevel(excludeTopLevel) {
     worklist.reserve(64);
   }
 
@@ -54,7 +89,18 @@ public:
   /// `maxIterations`.
   bool simplifyFunction(int maxIterations);
 
+  /// Perform the rewrites on the operations nested under the given top-level
+  /// operations only, using the given folder. Return true if the rewrite
+  /// converges in `maxIterations`.
+  bool simplifyNests(ArrayRef<Operation *> roots, OperationFolder &helper,
+                     int maxIterations);
+
   void addToWorklist(Operation *op) {
+    // Record the touch so that the next iteration can be seeded from the
+    // operations this one affected.
+    if (recordTouchedOps && touchedSet.insert(op).second)
+      touchedOps.push_back(op);
+
     // Check to see if the worklist already contains this op.
     if (worklistMap.count(op))
       return;
@@ -85,12 +131,12 @@ public:
 
   // These are hooks implemented for PatternRewriter.
 protected:
-  // Implement the hook for creating operations, and make sure that newly
-  // created ops are added to the worklist for processing.
-  Operation *createOperation(const OperationState &state) override {
-    auto *result = OpBuilder::createOperation(state);
-    addToWorklist(result);
-    return result;
+  // Implement the hook for inserting operations, and make sure that newly
+  // inserted ops are added to the worklist for processing.
+  Operation *insert(Operation *op) override {
+    OpBuilder::insert(op);
+    addToWorklist(op);
+    return op;
   }
 
   // If an operation is about to be removed, make sure it is not in our
@@ -98,15 +144,28 @@ protected:
   void notifyOperationRemoved(Operation *op) override {
     addToWorklist(op->getOperands());
     removeFromWorklist(op);
+    touchedSet.erase(op);
+    pendingUserSet.erase(op);
   }
 
   // When the root of a pattern is about to be replaced, it can trigger
   // simplifications to its users - make sure to add them to the worklist
-  // before the root is changed.
+  // before the root is changed. While a pattern application is in flight the
+  // users are batched instead: cascading replacements inside one application
+  // hit the same users over and over, and deferring the enqueueing to the
+  // end of the batch records each user once and drops the ones the cascade
+  // itself erases.
   void notifyRootReplaced(Operation *op) override {
-    for (auto *result : op->getResults())
-      for (auto *user : result->getUsers())
-        addToWorklist(user);
+    for (auto *result : op->getResults()) {
+      for (auto *user : result->getUsers()) {
+        if (!batchingUserUpdates) {
+          addToWorklist(user);
+          continue;
+        }
+        if (pendingUserSet.insert(user).second)
+          pendingUsers.push_back(user);
+      }
+    }
   }
 
 private:
@@ -128,8 +187,35 @@ private:
     }
   }
 
-  /// The low-level pattern matcher.
-  RewritePatternMatcher matcher;
+  /// Run the rewrite loop, reseeding the worklist with `seedWorklist` at the
+  /// start of each iteration. Return true if the rewrite converges in
+  /// `maxIterations`.
+  bool simplify(llvm::function_ref<void()> seedWorklist,
+                OperationFolder &helper, int maxIterations);
+
+  /// Sort the worklist so that operations with the highest-benefit candidate
+  /// patterns are popped first, and rebuild the index map. Operations the
+  /// pattern set cannot match sort lowest; they are still visited for folding
+  /// and dead code elimination if the budget allows. Only called right after
+  /// seeding, when the worklist holds no erased (null) entries.
+  void prioritizeWorklistByBenefit() {
+    std::stable_sort(worklist.begin(), worklist.end(),
+                     [&](Operation *lhs, Operation *rhs) {
+                       return matcher.getMaxBenefit(lhs->getName()) <
+                              matcher.getMaxBenefit(rhs->getName());
+                     });
+    for (unsigned i = 0, e = worklist.size(); i != e; ++i)
+      worklistMap[worklist[i]] = i;
+  }
+
+  /// The low-level pattern matcher, shared between the drivers when rewriting
+  /// runs on multiple threads. Matching is read-only on the patterns.
+  RewritePatternMatcher &matcher;
+
+  /// If true, operations in the top-level blocks of the function are left
+  /// untouched. This is used by the parallel mode, where the function's own
+  /// block lists are shared between the workers.
+  bool excludeTopLevel;
 
   /// The worklist for this transformation keeps track of the operations that
   /// need to be revisited, plus their index in the worklist.  This allows us to
@@ -137,6 +223,30 @@ private:
   /// the function, even if they aren't the root of a pattern.
   std::vector<Operation *> worklist;
   DenseMap<Operation *, unsigned> worklistMap;
+
+  /// The operations touched by the rewriter hooks during the current
+  /// iteration, in touch order, plus a set for deduplication. When change
+  /// tracking is enabled these seed the next iteration instead of a full
+  /// region rescan. Erased operations are only dropped from the set; the
+  /// stale vector entries are skipped by consulting the set when seeding.
+  std::vector<Operation *> touchedOps;
+  DenseSet<Operation *> touchedSet;
+
+  /// Whether addToWorklist records touches. Disabled while seeding so that
+  /// the seeds themselves do not accumulate as touches again.
+  bool recordTouchedOps = false;
+
+  /// Users of replaced roots collected during the current pattern
+  /// application, in first-touch order, plus a set for deduplication. The
+  /// batch is flushed to the worklist when the application returns; users
+  /// erased mid-cascade are only dropped from the set and their stale vector
+  /// entries are skipped at flush time.
+  std::vector<Operation *> pendingUsers;
+  DenseSet<Operation *> pendingUserSet;
+
+  /// Whether notifyRootReplaced batches user updates instead of enqueueing
+  /// them immediately. Set for the duration of each pattern application.
+  bool batchingUserUpdates = false;
 };
 } // end anonymous namespace
 
@@ -144,21 +254,89 @@ private:
 bool GreedyPatternRewriteDriver::simplifyFunction(int maxIterations) {
   Region *region = getRegion();
   OperationFolder helper;
+  return simplify(
+      [&] { region->walk([this](Operation *op) { addToWorklist(op); }); },
+      helper, maxIterations);
+}
+
+bool GreedyPatternRewriteDriver::simplifyNests(ArrayRef<Operation *> roots,
+                                               OperationFolder &helper,
+                                               int maxIterations) {
+  return simplify(
+      [&] {
+        for (auto *root : roots)
+          for (auto &region : root->getRegions())
+            region.walk([this](Operation *op) { addToWorklist(op); });
+      },
+      helper, maxIterations);
+}
 
+bool GreedyPatternRewriteDriver::simplify(
+    llvm::function_ref<void()> seedWorklist, OperationFolder &helper,
+    int maxIterations) {
   // Add the given operation to the worklist.
   auto collectOps = [this](Operation *op) { addToWorklist(op); };
 
+  // When a budget is set, run in "anytime" mode: process the worklist in
+  // decreasing pattern-benefit order so that the most valuable rewrites land
+  // first, and stop as soon as the budget expires. The budget spans all
+  // convergence iterations of this invocation.
+  bool budgeted =
+      greedyRewriteCountBudget != 0 || greedyRewriteTimeBudget != 0;
+  unsigned numRewrites = 0;
+  std::chrono::steady_clock::time_point deadline;
+  if (greedyRewriteTimeBudget != 0)
+    deadline = std::chrono::steady_clock::now() +
+               std::chrono::milliseconds(unsigned(greedyRewriteTimeBudget));
+  auto budgetExhausted = [&] {
+    if (greedyRewriteCountBudget != 0 &&
+        numRewrites >= greedyRewriteCountBudget)
+      return true;
+    return greedyRewriteTimeBudget != 0 &&
+           std::chrono::steady_clock::now() >= deadline;
+  };
+
   bool changed = false;
   int i = 0;
   do {
-    // Add all operations to the worklist.
-    region->walk(collectOps);
+    // Seed the worklist. The first iteration scans every operation; once the
+    // rewriter hooks have recorded the operations touched by an iteration,
+    // the next one only needs to revisit those and the users of their
+    // results.
+    recordTouchedOps = false;
+    if (i == 0 || !changeTrackingRewrites) {
+      seedWorklist();
+    } else {
+      for (Operation *op : touchedOps) {
+        if (!touchedSet.count(op))
+          continue;
+        addToWorklist(op);
+        for (auto *result : op->getResults())
+          for (auto *user : result->getUsers())
+            addToWorklist(user);
+      }
+    }
+    touchedOps.clear();
+    touchedSet.clear();
+    recordTouchedOps = true;
+    if (budgeted)
+      prioritizeWorklistByBenefit();
 
     // These are scratch vectors used in the folding loop below.
     SmallVector<Value *, 8> originalOperands, resultValues;
 
     changed = false;
     while (!worklist.empty()) {
+      // In budgeted mode, stop rewriting as soon as the budget expires and
+      // report the rewrite as not converged. Erasures and replacements are
+      // fully materialized when each pattern application returns, so stopping
+      // between two applications leaves valid IR.
+      if (budgeted && budgetExhausted()) {
+        worklist.clear();
+        worklistMap.clear();
+        return false;
+      }
+
       auto *op = popFromWorklist();
 
       // Nulls get added to the worklist when operations are removed, ignore
@@ -166,12 +344,18 @@ bool GreedyPatternRewriteDriver::simplifyFunction(int maxIterations) {
       if (op == nullptr)
         continue;
 
+      // Leave operations in the shared top-level blocks to the sequential
+      // phase when running restricted to nests.
+      if (excludeTopLevel && !op->getParentOp())
+        continue;
+
       // If the operation has no side effects, and no users, then it is
       // trivially dead - remove it.
       if (op->hasNoSideEffect() && op->use_empty()) {
         // Be careful to update bookkeeping in OperationFolder to keep
         // consistency if this is a constant op.
         helper.notifyRemoval(op);
+        touchedSet.erase(op);
         op->erase();
         continue;
       }
@@ -193,6 +377,7 @@ bool GreedyPatternRewriteDriver::simplifyFunction(int maxIterations) {
       // Try to fold this op.
       if (succeeded(helper.tryToFold(op, collectOps, collectOperandsAndUses))) {
         changed |= true;
+        ++numRewrites;
         continue;
       }
 
@@ -201,22 +386,131 @@ bool GreedyPatternRewriteDriver::simplifyFunction(int maxIterations) {
 
       // Try to match one of the canonicalization patterns. The rewriter is
       // automatically notified of any necessary changes, so there is nothing
-      // else to do here.
-      changed |= matcher.matchAndRewrite(op, *this);
+      // else to do here. Users of roots replaced during the application are
+      // batched and flushed to the worklist once per application, so cascades
+      // of replacements enqueue each user only once.
+      batchingUserUpdates = true;
+      if (matcher.matchAndRewrite(op, *this)) {
+        changed = true;
+        ++numRewrites;
+      }
+      batchingUserUpdates = false;
+      for (auto *user : pendingUsers)
+        if (pendingUserSet.count(user))
+          addToWorklist(user);
+      pendingUsers.clear();
+      pendingUserSet.clear();
     }
   } while (changed && ++i < maxIterations);
   // Whether the rewrite converges, i.e. wasn't changed in the last iteration.
   return !changed;
 }
 
+/// Rewrite the operations nested under the independent top-level nests of the
+/// function on multiple threads. Two nests are independent when they do not
+/// reference a common value defined outside of them; rewriting such nests
+/// never touches the same def-use chains, so the workers only need to
+/// synchronize when materializing folded constants into the shared entry
+/// block. Top-level operations themselves are left to the sequential phase.
+static void simplifyNestsInParallel(Function &fn,
+                                    RewritePatternMatcher &matcher) {
+  if (fn.empty())
+    return;
+
+  // Collect the top-level operations that hold regions.
+  SmallVector<Operation *, 8> nests;
+  for (auto &block : fn)
+    for (auto &op : block)
+      if (op.getNumRegions() != 0)
+        nests.push_back(&op);
+  if (nests.size() < 2)
+    return;
+
+  // Returns the top-level ancestor operation of the given value, or nullptr
+  // for function-level block arguments.
+  auto getTopLevelAncestor = [](Value *value) -> Operation * {
+    Operation *op = value->getDefiningOp();
+    if (!op) {
+      Block *block = cast<BlockArgument>(value)->getOwner();
+      op = block->getContainingOp();
+    }
+    for (Operation *parent = op; parent; parent = parent->getParentOp())
+      op = parent;
+    return op;
+  };
+
+  // Union the nests that reference a common external value: their rewrites
+  // share use lists and must run on the same thread.
+  std::vector<unsigned> parent(nests.size());
+  std::iota(parent.begin(), parent.end(), 0u);
+  std::function<unsigned(unsigned)> find = [&](unsigned x) {
+    while (parent[x] != x)
+      x = parent[x] = parent[parent[x]];
+    return x;
+  };
+
+  DenseMap<Value *, unsigned> externalValueOwner;
+  for (unsigned i = 0, e = nests.size(); i != e; ++i) {
+    nests[i]->walk([&](Operation *op) {
+      for (auto *operand : op->getOperands()) {
+        if (getTopLevelAncestor(operand) == nests[i])
+          continue;
+        auto res = externalValueOwner.insert({operand, i});
+        if (!res.second)
+          parent[find(res.first->second)] = find(i);
+      }
+    });
+  }
+
+  // Bucket the nests into their groups.
+  DenseMap<unsigned, SmallVector<Operation *, 4>> groupMap;
+  for (unsigned i = 0, e = nests.size(); i != e; ++i)
+    groupMap[find(i)].push_back(nests[i]);
+  if (groupMap.size() < 2)
+    return;
+  std::vector<SmallVector<Operation *, 4>> groups;
+  groups.reserve(groupMap.size());
+  for (auto &entry : groupMap)
+    groups.push_back(std::move(entry.second));
+
+  // Rewrite each group on its own worker with its own worklist and folder.
+  llvm::sys::SmartMutex<true> entryInsertionLock;
+  llvm::parallel::for_each_n(llvm::parallel::par, size_t(0), groups.size(),
+                             [&](size_t i) {
+                               GreedyPatternRewriteDriver driver(
+                                   fn, matcher, /*excludeTopLevel=*/true);
+                               OperationFolder helper;
+                               helper.setInsertionLock(&entryInsertionLock);
+                               driver.simplifyNests(groups[i], helper,
+                                                    maxPatternMatchIterations);
+                             });
+}
+
 /// Rewrite the specified function by repeatedly applying the highest benefit
 /// patterns in a greedy work-list driven manner. Return true if no more
 /// patterns can be matched in the result function.
 ///
 bool mlir::applyPatternsGreedily(Function &fn,
                                  OwningRewritePatternList &&patterns) {
-  GreedyPatternRewriteDriver driver(fn, std::move(patterns));
+  RewritePatternMatcher matcher(std::move(patterns));
+
+  // If this pattern set already converged on the function and the body has
+  // not changed since, there is nothing left to match.
+  if (changeTrackingRewrites &&
+      fn.hasGreedyRewriteConverged(matcher.getFingerprint()))
+    return true;
+
+  // In the parallel mode, do the bulk of the rewriting within independent
+  // top-level nests on the thread pool first. The sequential driver below
+  // then handles the top-level operations and any cross-nest opportunities,
+  // and establishes convergence.
+  if (parallelPatternRewrites)
+    simplifyNestsInParallel(fn, matcher);
+
+  GreedyPatternRewriteDriver driver(fn, matcher);
   bool converged = driver.simplifyFunction(maxPatternMatchIterations);
+  if (converged && changeTrackingRewrites)
+    fn.markGreedyRewriteConverged(matcher.getFingerprint());
   LLVM_DEBUG(if (!converged) {
     llvm::dbgs()
         << "The pattern rewrite doesn't converge after scanning the function "
@@ -31,6 +31,7 @@
 #include "mlir/IR/Builders.h"
 #include "mlir/IR/Operation.h"
 #include "mlir/StandardOps/Ops.h"
+#include "mlir/Transforms/Utils.h"
 #include "llvm/ADT/DenseMap.h"
 #include "llvm/Support/Debug.h"
 
@@ -143,6 +144,17 @@ LogicalResult mlir::promoteIfSingleIteration(AffineForOp forOp) {
       }
     }
   }
+  // Thread the loop-carried values: the single iteration reads the initial
+  // iter operands, and the loop results are the values its terminator yields.
+  if (forOp.getNumIterOperands() != 0) {
+    auto regionIterArgs = forOp.getRegionIterArgs();
+    for (unsigned i = 0, e = forOp.getNumIterOperands(); i != e; ++i)
+      regionIterArgs[i]->replaceAllUsesWith(forOp.getIterOperand(i));
+    Operation &terminator = forOp.getBody()->getOperations().back();
+    for (unsigned i = 0, e = forOp.getNumIterOperands(); i != e; ++i)
+      forOp.getResult(i)->replaceAllUsesWith(terminator.getOperand(i));
+  }
+
   // Move the loop body operations, except for terminator, to the loop's
   // containing block.
   auto *block = op->getBlock();
@@ -168,14 +180,15 @@ void mlir::promoteSingleIterationLoops(Function *f) {
 /// the pair specifies the shift applied to that group of operations; note
 /// that the shift is multiplied by the loop step before being applied. Returns
 /// nullptr if the generated loop simplifies to a single iteration one.
+/// 'operandMap' is scratch state owned by the caller so that repeated calls
+/// reuse its allocations; it is cleared on entry.
 static AffineForOp
-generateLoop(AffineMap lbMap, AffineMap ubMap,
+generateLoop(AffineMap lbMap, AffineMap ubMap, ArrayRef<Value *> lbOperands,
+             ArrayRef<Value *> ubOperands,
              const std::vector<std::pair<uint64_t, ArrayRef<Operation *>>>
                  &instGroupQueue,
-             unsigned offset, AffineForOp srcForInst, OpBuilder b) {
-  SmallVector<Value *, 4> lbOperands(srcForInst.getLowerBoundOperands());
-  SmallVector<Value *, 4> ubOperands(srcForInst.getUpperBoundOperands());
-
+             unsigned offset, AffineForOp srcForInst, OpBuilder b,
+             BlockAndValueMapping &operandMap) {
   assert(lbMap.getNumInputs() == lbOperands.size());
   assert(ubMap.getNumInputs() == ubOperands.size());
 
@@ -185,7 +198,7 @@ generateLoop(AffineMap lbMap, AffineMap ubMap,
   auto *loopChunkIV = loopChunk.getInductionVar();
   auto *srcIV = srcForInst.getInductionVar();
 
-  BlockAndValueMapping operandMap;
+  operandMap.clear();
 
   OpBuilder bodyBuilder = loopChunk.getBodyBuilder();
   for (auto it = instGroupQueue.begin() + offset, e = instGroupQueue.end();
@@ -236,6 +249,11 @@ LogicalResult mlir::instBodySkew(AffineForOp forOp, ArrayRef<uint64_t> shifts,
   if (forOp.getBody()->begin() == std::prev(forOp.getBody()->end()))
     return success();
 
+  // Shifting redistributes the body over several loops, which cannot preserve
+  // the loop's carried values.
+  if (forOp.getNumIterOperands() != 0)
+    return failure();
+
   // If the trip counts aren't constant, we would need versioning and
   // conditional guards (or context information to prevent such versioning). The
   // better way to pipeline for such loops is to first tile them and extract
@@ -288,6 +306,12 @@ LogicalResult mlir::instBodySkew(AffineForOp forOp, ArrayRef<uint64_t> shifts,
   // of operations is paired with its shift.
   std::vector<std::pair<uint64_t, ArrayRef<Operation *>>> instGroupQueue;
 
+  // The generated loops all share the source loop's bound operands; gather
+  // them and the value remapping scratch once rather than per generated loop.
+  SmallVector<Value *, 4> lbOperands(forOp.getLowerBoundOperands());
+  SmallVector<Value *, 4> ubOperands(forOp.getUpperBoundOperands());
+  BlockAndValueMapping operandMap;
+
   auto origLbMap = forOp.getLowerBoundMap();
   uint64_t lbShift = 0;
   OpBuilder b(forOp.getOperation());
@@ -306,14 +330,14 @@ LogicalResult mlir::instBodySkew(AffineForOp forOp, ArrayRef<uint64_t> shifts,
         res = generateLoop(
             b.getShiftedAffineMap(origLbMap, lbShift),
             b.getShiftedAffineMap(origLbMap, lbShift + tripCount * step),
-            instGroupQueue, 0, forOp, b);
+            lbOperands, ubOperands, instGroupQueue, 0, forOp, b, operandMap);
         // Entire loop for the queued op groups generated, empty it.
         instGroupQueue.clear();
         lbShift += tripCount * step;
       } else {
         res = generateLoop(b.getShiftedAffineMap(origLbMap, lbShift),
-                           b.getShiftedAffineMap(origLbMap, d), instGroupQueue,
-                           0, forOp, b);
+                           b.getShiftedAffineMap(origLbMap, d), lbOperands,
+                           ubOperands, instGroupQueue, 0, forOp, b, operandMap);
         lbShift = d * step;
       }
       if (!prologue && res)
@@ -333,7 +357,8 @@ LogicalResult mlir::instBodySkew(AffineForOp forOp, ArrayRef<uint64_t> shifts,
     uint64_t ubShift = (instGroupQueue[i].first + tripCount) * step;
     epilogue = generateLoop(b.getShiftedAffineMap(origLbMap, lbShift),
                             b.getShiftedAffineMap(origLbMap, ubShift),
-                            instGroupQueue, i, forOp, b);
+                            lbOperands, ubOperands, instGroupQueue, i, forOp, b,
+                            operandMap);
     lbShift = ubShift;
     if (!prologue)
       prologue = epilogue;
@@ -413,16 +438,28 @@ LogicalResult mlir::loopUnrollByFactor(AffineForOp forOp,
   if (forOp.getLowerBoundMap().getNumResults() != 1)
     return failure();
 
+  // Loops carrying values are not unrolled: the carried block arguments of
+  // each extra body copy would have to read the previous copy's yielded
+  // values rather than the iteration-entry values the IV remapping provides.
+  // TODO(mlir-team): thread iter_args through the unrolled copies.
+  if (forOp.getNumIterOperands() != 0)
+    return failure();
+
+  // The trip count map is derived once and shared by the constant trip count
+  // and divisor queries below.
+  AffineForTripCountCache tripCounts;
+
   // If the trip count is lower than the unroll factor, no unrolled body.
   // TODO(bondhugula): option to specify cleanup loop unrolling.
-  Optional<uint64_t> mayBeConstantTripCount = getConstantTripCount(forOp);
+  Optional<uint64_t> mayBeConstantTripCount =
+      tripCounts.getConstantTripCount(forOp);
   if (mayBeConstantTripCount.hasValue() &&
       mayBeConstantTripCount.getValue() < unrollFactor)
     return failure();
 
   // Generate the cleanup loop if trip count isn't a multiple of unrollFactor.
   Operation *op = forOp.getOperation();
-  if (getLargestDivisorOfTripCount(forOp) % unrollFactor != 0) {
+  if (tripCounts.getLargestDivisorOfTripCount(forOp) % unrollFactor != 0) {
     OpBuilder builder(op->getBlock(), ++Block::iterator(op));
     auto cleanupForInst = cast<AffineForOp>(builder.clone(*op));
     AffineMap cleanupMap;
@@ -453,10 +490,15 @@ LogicalResult mlir::loopUnrollByFactor(AffineForOp forOp,
   // so that we know what to clone (since we are doing this in-place).
   Block::iterator srcBlockEnd = std::prev(forOp.getBody()->end(), 2);
 
+  // Number the values defined in the original body once, so that each copy
+  // remaps through a flat dense table instead of growing a fresh hash map.
+  BlockAndValueMapping operandMap;
+  operandMap.numberDenseSources(forOp.getBody());
+
   // Unroll the contents of 'forOp' (append unrollFactor-1 additional copies).
   auto *forOpIV = forOp.getInductionVar();
   for (unsigned i = 1; i < unrollFactor; i++) {
-    BlockAndValueMapping operandMap;
+    operandMap.resetDenseMappings();
 
     // If the induction variable is used, create a remapping to the value for
     // this unrolled instance.
@@ -487,6 +529,9 @@ void mlir::interchangeLoops(AffineForOp forOpA, AffineForOp forOpB) {
   auto *forOpAInst = forOpA.getOperation();
 
   assert(&*forOpA.getBody()->begin() == forOpB.getOperation());
+  assert(forOpA.getNumIterOperands() == 0 &&
+         forOpB.getNumIterOperands() == 0 &&
+         "loops carrying values cannot be interchanged");
   auto &forOpABody = forOpA.getBody()->getOperations();
   auto &forOpBBody = forOpB.getBody()->getOperations();
 
@@ -582,6 +627,11 @@ AffineForOp mlir::sinkSequentialLoops(AffineForOp forOp) {
   if (loops.size() < 2)
     return forOp;
 
+  // Loops carrying values cannot be interchanged.
+  for (AffineForOp loop : loops)
+    if (loop.getNumIterOperands() != 0)
+      return forOp;
+
   // Gather dependence components for dependences between all ops in loop nest
   // rooted at 'loops[0]', at loop depths in range [1, maxLoopDepth].
   unsigned maxLoopDepth = loops.size();
@@ -637,6 +687,84 @@ void mlir::sinkLoop(AffineForOp forOp, unsigned loopDepth) {
   }
 }
 
+/// Skews the two-loop nest rooted at 'outerForOp' into wavefront form: for a
+/// nest over (i, j), the result iterates a wavefront loop over w = factor * i
+/// + j with i as the inner loop and j recovered as w - factor * i. Dependences
+/// with distance (di, dj) become (factor * di + dj, di) in the new nest, so a
+/// factor making all outer components positive leaves the inner loop free of
+/// carried dependences.
+LogicalResult mlir::loopSkewByFactor(AffineForOp outerForOp,
+                                     uint64_t skewFactor) {
+  assert(skewFactor >= 1 && "expected positive skew factor");
+  // Expect a perfectly nested pair: the inner loop followed by the terminator.
+  auto &outerOps = outerForOp.getBody()->getOperations();
+  if (std::distance(outerOps.begin(), outerOps.end()) != 2)
+    return failure();
+  auto innerForOp = dyn_cast<AffineForOp>(outerOps.front());
+  if (!innerForOp)
+    return failure();
+  // The wavefront rewrite rebuilds both loops and cannot preserve carried
+  // values.
+  if (outerForOp.getNumIterOperands() != 0 ||
+      innerForOp.getNumIterOperands() != 0)
+    return failure();
+  // The closed-form wavefront bounds below assume unit steps and constant
+  // bounds.
+  if (!outerForOp.hasConstantBounds() || !innerForOp.hasConstantBounds() ||
+      outerForOp.getStep() != 1 || innerForOp.getStep() != 1)
+    return failure();
+
+  int64_t factor = skewFactor;
+  int64_t lbI = outerForOp.getConstantLowerBound();
+  int64_t ubI = outerForOp.getConstantUpperBound();
+  int64_t lbJ = innerForOp.getConstantLowerBound();
+  int64_t ubJ = innerForOp.getConstantUpperBound();
+  if (ubI <= lbI || ubJ <= lbJ)
+    return failure();
+
+  OpBuilder b(outerForOp.getOperation());
+  Location loc = outerForOp.getLoc();
+
+  // The wavefront loop covers w in [factor * lbI + lbJ, factor * (ubI - 1) +
+  // ubJ).
+  auto waveForOp = b.create<AffineForOp>(loc, factor * lbI + lbJ,
+                                         factor * (ubI - 1) + ubJ);
+  Value *wave = waveForOp.getInductionVar();
+
+  // Along the wavefront, i ranges over
+  //   [max(lbI, ceil((w - ubJ + 1) / factor)),
+  //    min(ubI, floor((w - lbJ) / factor) + 1)).
+  auto d0 = b.getAffineDimExpr(0);
+  auto lbMap = b.getAffineMap(
+      /*dimCount=*/1, /*symbolCount=*/0,
+      {b.getAffineConstantExpr(lbI), (d0 - ubJ + 1).ceilDiv(factor)});
+  auto ubMap = b.getAffineMap(
+      /*dimCount=*/1, /*symbolCount=*/0,
+      {b.getAffineConstantExpr(ubI), (d0 - lbJ).floorDiv(factor) + 1});
+  OpBuilder waveBodyBuilder = waveForOp.getBodyBuilder();
+  auto newInnerForOp = waveBodyBuilder.create<AffineForOp>(
+      loc, /*lbOperands=*/wave, lbMap, /*ubOperands=*/wave, ubMap);
+  Value *newI = newInnerForOp.getInductionVar();
+
+  // Recover j = w - factor * i.
+  OpBuilder bodyBuilder = newInnerForOp.getBodyBuilder();
+  auto jMap = b.getAffineMap(
+      /*dimCount=*/2, /*symbolCount=*/0,
+      b.getAffineDimExpr(0) - b.getAffineDimExpr(1) * factor);
+  auto newJ = bodyBuilder.create<AffineApplyOp>(
+      loc, jMap, ArrayRef<Value *>{wave, newI});
+
+  // Move the original body over and remap the induction variables.
+  Block *src = innerForOp.getBody();
+  Block *dst = newInnerForOp.getBody();
+  dst->getOperations().splice(std::prev(dst->end()), src->getOperations(),
+                              src->begin(), std::prev(src->end()));
+  innerForOp.getInductionVar()->replaceAllUsesWith(newJ);
+  outerForOp.getInductionVar()->replaceAllUsesWith(newI);
+  outerForOp.getOperation()->erase();
+  return success();
+}
+
 // Factors out common behavior to add a new `iv` (resp. `iv` + `offset`) to the
 // lower (resp. upper) loop bound. When called for both the lower and upper
 // bounds, the resulting IR resembles:
@@ -660,9 +788,11 @@ static void augmentMapAndBounds(OpBuilder &b, Value *iv, AffineMap *map,
 // substituting `oldIv` in place of
 // `forOp.getInductionVariable()` and ignoring the terminator.
 // Note: `newForOp` may be nested under `forOp`.
+// `map` is scratch state owned by the caller so that repeated calls reuse its
+// allocations; it is cleared on entry.
 static void cloneLoopBodyInto(AffineForOp forOp, Value *oldIv,
-                              AffineForOp newForOp) {
-  BlockAndValueMapping map;
+                              AffineForOp newForOp, BlockAndValueMapping &map) {
+  map.clear();
   map.map(oldIv, newForOp.getInductionVar());
   OpBuilder b = newForOp.getBodyBuilder();
   for (auto &op : *forOp.getBody()) {
@@ -690,10 +820,11 @@ static void cloneLoopBodyInto(AffineForOp forOp, Value *oldIv,
 // profitability or even structural correctness. It is the user's
 // responsibility to specify `targets` that are dominated by `forOp`.
 // Returns the new AffineForOps, one per `targets`, nested immediately under
-// each of the `targets`.
+// each of the `targets`. `cloneMap` is scratch state owned by the caller so
+// that the repeated calls made when tiling a deep nest reuse its allocations.
 static SmallVector<AffineForOp, 8>
-stripmineSink(AffineForOp forOp, uint64_t factor,
-              ArrayRef<AffineForOp> targets) {
+stripmineSink(AffineForOp forOp, uint64_t factor, ArrayRef<AffineForOp> targets,
+              BlockAndValueMapping &cloneMap) {
   // TODO(ntv): Use cheap structural assertions that targets are nested under
   // forOp and that targets are not nested under each other when DominanceInfo
   // exposes the capability. It seems overkill to construct a whole function
@@ -722,7 +853,7 @@ stripmineSink(AffineForOp forOp, uint64_t factor,
     OpBuilder b = t.getBodyBuilder();
     auto newForOp = b.create<AffineForOp>(t.getLoc(), lbOperands, lbMap,
                                           ubOperands, ubMap, originalStep);
-    cloneLoopBodyInto(t, forOp.getInductionVar(), newForOp);
+    cloneLoopBodyInto(t, forOp.getInductionVar(), newForOp, cloneMap);
     // Remove all operations from `t` except `newForOp`.
     auto rit = ++newForOp.getOperation()->getReverseIterator();
     auto re = t.getBody()->rend();
@@ -739,7 +870,9 @@ stripmineSink(AffineForOp forOp, uint64_t factor,
 // Returns the new AffineForOps, nested immediately under `target`.
 AffineForOp stripmineSink(AffineForOp forOp, uint64_t factor,
                           AffineForOp target) {
-  auto res = stripmineSink(forOp, factor, ArrayRef<AffineForOp>{target});
+  BlockAndValueMapping cloneMap;
+  auto res =
+      stripmineSink(forOp, factor, ArrayRef<AffineForOp>{target}, cloneMap);
   assert(res.size() == 1 && "Expected 1 inner forOp");
   return res[0];
 }
@@ -749,8 +882,11 @@ mlir::tile(ArrayRef<AffineForOp> forOps, ArrayRef<uint64_t> sizes,
            ArrayRef<AffineForOp> targets) {
   SmallVector<SmallVector<AffineForOp, 8>, 8> res;
   SmallVector<AffineForOp, 8> currentTargets(targets.begin(), targets.end());
+  // One value remapping scratch serves every stripmine step of the nest.
+  BlockAndValueMapping cloneMap;
   for (auto it : llvm::zip(forOps, sizes)) {
-    auto step = stripmineSink(std::get<0>(it), std::get<1>(it), currentTargets);
+    auto step = stripmineSink(std::get<0>(it), std::get<1>(it), currentTargets,
+                              cloneMap);
     res.push_back(step);
     currentTargets = step;
   }
@@ -762,3 +898,315 @@ SmallVector<AffineForOp, 8> mlir::tile(ArrayRef<AffineForOp> forOps,
                                        AffineForOp target) {
   return tile(forOps, sizes, ArrayRef<AffineForOp>{target})[0];
 }
+
+// Returns the position of the tag memref operand given a DMA operation.
+// Temporary utility: will be replaced when DmaStart/DmaFinish abstract op's are
+// added.  TODO(b/117228571)
+static unsigned getTagMemRefPos(Operation &dmaInst) {
+  assert(isa<DmaStartOp>(dmaInst) || isa<DmaWaitOp>(dmaInst));
+  if (isa<DmaStartOp>(dmaInst)) {
+    // Second to last operand.
+    return dmaInst.getNumOperands() - 2;
+  }
+  // First operand for a dma finish operation.
+  return 0;
+}
+
+/// Doubles the buffer of the supplied memref on the specified 'affine.for'
+/// operation by adding a leading dimension of size two to the memref.
+/// Replaces all uses of the old memref by the new one while indexing the newly
+/// added dimension by the loop IV of the specified 'affine.for' operation
+/// modulo 2. Returns false if such a replacement cannot be performed.
+static bool doubleBuffer(Value *oldMemRef, AffineForOp forOp) {
+  auto *forBody = forOp.getBody();
+  OpBuilder bInner(forBody, forBody->begin());
+  bInner.setInsertionPoint(forBody, forBody->begin());
+
+  // Doubles the shape with a leading dimension extent of 2.
+  auto doubleShape = [&](MemRefType oldMemRefType) -> MemRefType {
+    // Add the leading dimension in the shape for the double buffer.
+    ArrayRef<int64_t> oldShape = oldMemRefType.getShape();
+    SmallVector<int64_t, 4> newShape(1 + oldMemRefType.getRank());
+    newShape[0] = 2;
+    std::copy(oldShape.begin(), oldShape.end(), newShape.begin() + 1);
+    auto newMemRefType =
+        bInner.getMemRefType(newShape, oldMemRefType.getElementType(), {},
+                             oldMemRefType.getMemorySpace());
+    return newMemRefType;
+  };
+
+  auto oldMemRefType = oldMemRef->getType().cast<MemRefType>();
+  auto newMemRefType = doubleShape(oldMemRefType);
+
+  // The double buffer is allocated right before 'forInst'.
+  auto *forInst = forOp.getOperation();
+  OpBuilder bOuter(forInst);
+  // Put together alloc operands for any dynamic dimensions of the memref.
+  SmallVector<Value *, 4> allocOperands;
+  unsigned dynamicDimCount = 0;
+  for (auto dimSize : oldMemRefType.getShape()) {
+    if (dimSize == -1)
+      allocOperands.push_back(bOuter.create<DimOp>(forInst->getLoc(), oldMemRef,
+                                                   dynamicDimCount++));
+  }
+
+  // Create and place the alloc right before the 'affine.for' operation.
+  Value *newMemRef =
+      bOuter.create<AllocOp>(forInst->getLoc(), newMemRefType, allocOperands);
+
+  // Create 'iv mod 2' value to index the leading dimension.
+  auto d0 = bInner.getAffineDimExpr(0);
+  int64_t step = forOp.getStep();
+  auto modTwoMap = bInner.getAffineMap(/*dimCount=*/1, /*symbolCount=*/0,
+                                       {d0.floorDiv(step) % 2});
+  auto ivModTwoOp = bInner.create<AffineApplyOp>(forOp.getLoc(), modTwoMap,
+                                                 forOp.getInductionVar());
+
+  // replaceAllMemRefUsesWith will always succeed unless the forOp body has
+  // non-deferencing uses of the memref (dealloc's are fine though).
+  if (!replaceAllMemRefUsesWith(oldMemRef, newMemRef,
+                                /*extraIndices=*/{ivModTwoOp},
+                                /*indexRemap=*/AffineMap(),
+                                /*extraOperands=*/{},
+                                /*domInstFilter=*/&*forOp.getBody()->begin())) {
+    LLVM_DEBUG(
+        forOp.emitError("memref replacement for double buffering failed"));
+    ivModTwoOp.erase();
+    return false;
+  }
+  // Insert the dealloc op right after the for loop.
+  bOuter.setInsertionPoint(forInst->getBlock(),
+                           std::next(Block::iterator(forInst)));
+  bOuter.create<DeallocOp>(forInst->getLoc(), newMemRef);
+
+  return true;
+}
+
+// Check if tags of the dma start op and dma wait op match.
+static bool checkTagMatch(DmaStartOp startOp, DmaWaitOp waitOp) {
+  if (startOp.getTagMemRef() != waitOp.getTagMemRef())
+    return false;
+  auto startIndices = startOp.getTagIndices();
+  auto waitIndices = waitOp.getTagIndices();
+  // Both of these have the same number of indices since they correspond to the
+  // same tag memref.
+  for (auto it = startIndices.begin(), wIt = waitIndices.begin(),
+            e = startIndices.end();
+       it != e; ++it, ++wIt) {
+    // Keep it simple for now, just checking if indices match.
+    // TODO(mlir-team): this would in general need to check if there is no
+    // intervening write writing to the same tag location, i.e., memory last
+    // write/data flow analysis. This is however sufficient/powerful enough for
+    // now since the DMA generation pass or the input for it will always have
+    // start/wait with matching tags (same SSA operand indices).
+    if (*it != *wIt)
+      return false;
+  }
+  return true;
+}
+
+// Identify matching DMA start/finish operations to overlap computation with.
+static void findMatchingStartFinishInsts(
+    AffineForOp forOp,
+    SmallVectorImpl<std::pair<Operation *, Operation *>> &startWaitPairs) {
+
+  // Collect outgoing DMA operations - needed to check for dependences below.
+  SmallVector<DmaStartOp, 4> outgoingDmaOps;
+  for (auto &op : *forOp.getBody()) {
+    auto dmaStartOp = dyn_cast<DmaStartOp>(op);
+    if (dmaStartOp && dmaStartOp.isSrcMemorySpaceFaster())
+      outgoingDmaOps.push_back(dmaStartOp);
+  }
+
+  SmallVector<Operation *, 4> dmaStartInsts, dmaFinishInsts;
+  for (auto &op : *forOp.getBody()) {
+    // Collect DMA finish operations.
+    if (isa<DmaWaitOp>(op)) {
+      dmaFinishInsts.push_back(&op);
+      continue;
+    }
+    auto dmaStartOp = dyn_cast<DmaStartOp>(op);
+    if (!dmaStartOp)
+      continue;
+
+    // Only DMAs incoming into higher memory spaces are pipelined for now.
+    // TODO(bondhugula): handle outgoing DMA pipelining.
+    if (!dmaStartOp.isDestMemorySpaceFaster())
+      continue;
+
+    // Check for dependence with outgoing DMAs. Doing this conservatively.
+    // TODO(andydavis,bondhugula): use the dependence analysis to check for
+    // dependences between an incoming and outgoing DMA in the same iteration.
+    auto it = outgoingDmaOps.begin();
+    for (; it != outgoingDmaOps.end(); ++it) {
+      if (it->getDstMemRef() == dmaStartOp.getSrcMemRef())
+        break;
+    }
+    if (it != outgoingDmaOps.end())
+      continue;
+
+    // We only double buffer if the buffer is not live out of loop.
+    auto *memref = dmaStartOp.getOperand(dmaStartOp.getFasterMemPos());
+    bool escapingUses = false;
+    for (auto *user : memref->getUsers()) {
+      // We can double buffer regardless of dealloc's outside the loop.
+      if (isa<DeallocOp>(user))
+        continue;
+      if (!forOp.getBody()->findAncestorInstInBlock(*user)) {
+        LLVM_DEBUG(llvm::dbgs()
+                       << "can't pipeline: buffer is live out of loop\n";);
+        escapingUses = true;
+        break;
+      }
+    }
+    if (!escapingUses)
+      dmaStartInsts.push_back(&op);
+  }
+
+  // For each start operation, we look for a matching finish operation.
+  for (auto *dmaStartInst : dmaStartInsts) {
+    for (auto *dmaFinishInst : dmaFinishInsts) {
+      if (checkTagMatch(cast<DmaStartOp>(dmaStartInst),
+                        cast<DmaWaitOp>(dmaFinishInst))) {
+        startWaitPairs.push_back({dmaStartInst, dmaFinishInst});
+        break;
+      }
+    }
+  }
+}
+
+/// Overlaps DMA transfers with computation in this loop. If successful,
+/// 'forOp' is deleted, and a prologue, a new pipelined loop, and epilogue are
+/// inserted right before where it was.
+LogicalResult mlir::pipelineDmaTransfer(AffineForOp forOp) {
+  auto mayBeConstTripCount = getConstantTripCount(forOp);
+  if (!mayBeConstTripCount.hasValue()) {
+    LLVM_DEBUG(
+        forOp.emitRemark("won't pipeline due to unknown trip count loop"));
+    return failure();
+  }
+
+  SmallVector<std::pair<Operation *, Operation *>, 4> startWaitPairs;
+  findMatchingStartFinishInsts(forOp, startWaitPairs);
+
+  if (startWaitPairs.empty()) {
+    LLVM_DEBUG(forOp.emitRemark("No dma start/finish pairs\n"));
+    return failure();
+  }
+
+  // Double the buffers for the higher memory space memref's.
+  // Identify memref's to replace by scanning through all DMA start
+  // operations. A DMA start operation has two memref's - the one from the
+  // higher level of memory hierarchy is the one to double buffer.
+  // TODO(bondhugula): check whether double-buffering is even necessary.
+  // TODO(bondhugula): make this work with different layouts: assuming here that
+  // the dimension we are adding here for the double buffering is the outermost
+  // dimension.
+  for (auto &pair : startWaitPairs) {
+    auto *dmaStartInst = pair.first;
+    Value *oldMemRef = dmaStartInst->getOperand(
+        cast<DmaStartOp>(dmaStartInst).getFasterMemPos());
+    if (!doubleBuffer(oldMemRef, forOp)) {
+      // Normally, double buffering should not fail because we already checked
+      // that there are no uses outside.
+      LLVM_DEBUG(llvm::dbgs() << "double buffering failed for: \n";);
+      LLVM_DEBUG(dmaStartInst->dump());
+      // IR still in a valid state.
+      return failure();
+    }
+    // If the old memref has no more uses, remove its 'dead' alloc if it was
+    // alloc'ed. (note: DMA buffers are rarely function live-in; but a 'dim'
+    // operation could have been used on it if it was dynamically shaped in
+    // order to create the double buffer above.)
+    // '-canonicalize' does this in a more general way, but we'll anyway do the
+    // simple/common case so that the output / test cases looks clear.
+    if (auto *allocInst = oldMemRef->getDefiningOp()) {
+      if (oldMemRef->use_empty()) {
+        allocInst->erase();
+      } else if (oldMemRef->hasOneUse()) {
+        if (auto dealloc = dyn_cast<DeallocOp>(*oldMemRef->user_begin())) {
+          dealloc.erase();
+          oldMemRef->getDefiningOp()->erase();
+        }
+      }
+    }
+  }
+
+  // Double the buffers for tag memrefs.
+  for (auto &pair : startWaitPairs) {
+    auto *dmaFinishInst = pair.second;
+    Value *oldTagMemRef =
+        dmaFinishInst->getOperand(getTagMemRefPos(*dmaFinishInst));
+    if (!doubleBuffer(oldTagMemRef, forOp)) {
+      LLVM_DEBUG(llvm::dbgs() << "tag double buffering failed\n";);
+      return failure();
+    }
+    // If the old tag has no more uses, remove its 'dead' alloc if it was
+    // alloc'ed.
+    if (oldTagMemRef->use_empty())
+      if (auto *allocInst = oldTagMemRef->getDefiningOp())
+        allocInst->erase();
+  }
+
+  // Double buffering would have invalidated all the old DMA start/wait insts.
+  startWaitPairs.clear();
+  findMatchingStartFinishInsts(forOp, startWaitPairs);
+
+  // Store shift for operation for later lookup for AffineApplyOp's.
+  DenseMap<Operation *, unsigned> instShiftMap;
+  for (auto &pair : startWaitPairs) {
+    auto *dmaStartInst = pair.first;
+    assert(isa<DmaStartOp>(dmaStartInst));
+    instShiftMap[dmaStartInst] = 0;
+    // Set shifts for DMA start op's affine operand computation slices to 0.
+    SmallVector<AffineApplyOp, 4> sliceOps;
+    mlir::createAffineComputationSlice(dmaStartInst, &sliceOps);
+    if (!sliceOps.empty()) {
+      for (auto sliceOp : sliceOps) {
+        instShiftMap[sliceOp.getOperation()] = 0;
+      }
+    } else {
+      // If a slice wasn't created, the reachable affine.apply op's from its
+      // operands are the ones that go with it.
+      SmallVector<Operation *, 4> affineApplyInsts;
+      SmallVector<Value *, 4> operands(dmaStartInst->getOperands());
+      getReachableAffineApplyOps(operands, affineApplyInsts);
+      for (auto *op : affineApplyInsts) {
+        instShiftMap[op] = 0;
+      }
+    }
+  }
+  // Everything else (including compute ops and dma finish) are shifted by one.
+  for (auto &op : *forOp.getBody()) {
+    if (instShiftMap.find(&op) == instShiftMap.end()) {
+      instShiftMap[&op] = 1;
+    }
+  }
+
+  // Get shifts stored in map.
+  std::vector<uint64_t> shifts(forOp.getBody()->getOperations().size());
+  unsigned s = 0;
+  for (auto &op : *forOp.getBody()) {
+    assert(instShiftMap.find(&op) != instShiftMap.end());
+    shifts[s++] = instShiftMap[&op];
+
+    // Tagging operations with shifts for debugging purposes.
+    LLVM_DEBUG({
+      OpBuilder b(&op);
+      op.setAttr("shift", b.getI64IntegerAttr(shifts[s - 1]));
+    });
+  }
+
+  if (!isInstwiseShiftValid(forOp, shifts)) {
+    // Violates dependences.
+    LLVM_DEBUG(llvm::dbgs() << "Shifts invalid - unexpected\n";);
+    return failure();
+  }
+
+  if (failed(instBodySkew(forOp, shifts))) {
+    LLVM_DEBUG(llvm::dbgs() << "op body skewing failed - unexpected\n";);
+    return failure();
+  }
+
+  return success();
+}
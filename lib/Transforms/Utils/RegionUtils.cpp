@@ -20,6 +20,7 @@
 #include "mlir/IR/Operation.h"
 #include "mlir/IR/Value.h"
 
+#include "llvm/ADT/SmallPtrSet.h"
 #include "llvm/ADT/SmallSet.h"
 
 using namespace mlir;
@@ -53,3 +54,76 @@ void mlir::getUsedValuesDefinedAbove(Region &region, Region &limit,
         values.insert(operand);
   });
 }
+
+bool mlir::eraseUnreachableBlocks(Region &region) {
+  if (region.empty())
+    return false;
+
+  // Mark the blocks reachable from the entry block.
+  llvm::SmallPtrSet<Block *, 16> reachable;
+  SmallVector<Block *, 16> worklist;
+  reachable.insert(&region.front());
+  worklist.push_back(&region.front());
+  while (!worklist.empty()) {
+    Block *block = worklist.pop_back_val();
+    for (Block *succ : block->getSuccessors())
+      if (reachable.insert(succ).second)
+        worklist.push_back(succ);
+  }
+  if (reachable.size() == region.getBlocks().size())
+    return false;
+
+  SmallVector<Block *, 16> deadBlocks;
+  for (Block &block : region)
+    if (!reachable.count(&block))
+      deadBlocks.push_back(&block);
+
+  // Unreachable blocks may use values defined in other unreachable blocks,
+  // even in ways that do not respect dominance, so drop all references held
+  // by the dead blocks before erasing any of them.
+  for (Block *block : deadBlocks)
+    block->dropAllReferences();
+  for (Block *block : deadBlocks)
+    block->erase();
+  return true;
+}
+
+//===----------------------------------------------------------------------===//
+// InsertionTransaction
+//===----------------------------------------------------------------------===//
+
+InsertionTransaction::InsertionTransaction(Block *block,
+                                           Operation *insertionPoint)
+    : block(block), nextOp(insertionPoint) {
+  assert(block && "expected a valid block");
+  assert((!insertionPoint || insertionPoint->getBlock() == block) &&
+         "insertion point not in the given block");
+  auto point = insertionPoint ? Block::iterator(insertionPoint) : block->end();
+  prevOp = point == block->begin() ? nullptr : &*std::prev(point);
+}
+
+InsertionTransaction::~InsertionTransaction() {
+  if (!resolved)
+    rollback();
+}
+
+void InsertionTransaction::rollback() {
+  assert(!resolved && "transaction already rolled back or committed");
+  resolved = true;
+
+  auto begin = prevOp ? std::next(Block::iterator(prevOp)) : block->begin();
+  auto end = nextOp ? Block::iterator(nextOp) : block->end();
+
+  // Erase the inserted operations back to front so that operations using the
+  // results of earlier inserted operations are gone before their definitions.
+  SmallVector<Operation *, 8> inserted;
+  for (auto it = begin; it != end; ++it)
+    inserted.push_back(&*it);
+  for (auto *op : llvm::reverse(inserted))
+    op->erase();
+}
+
+void InsertionTransaction::commit() {
+  assert(!resolved && "transaction already rolled back or committed");
+  resolved = true;
+}
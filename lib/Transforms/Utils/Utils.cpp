@@ -282,3 +282,198 @@ void mlir::createAffineComputationSlice(
     opInst->setOperand(idx, newOperands[idx]);
   }
 }
+
+/// Replace all current uses of 'value' with 'replacement', excluding any use
+/// added after the uses were recorded in 'uses'. This lets a conversion
+/// operation consume 'value' without rewriting its own operand.
+static void replaceRecordedUses(ArrayRef<OpOperand *> uses,
+                                Value *replacement) {
+  for (OpOperand *use : uses)
+    use->set(replacement);
+}
+
+/// Record the current uses of 'value'.
+static void recordUses(Value *value, SmallVectorImpl<OpOperand *> &uses) {
+  for (OpOperand &use : value->getUses())
+    uses.push_back(&use);
+}
+
+LogicalResult mlir::rewriteFunctionSignature(
+    Function *fn, FunctionType newType,
+    llvm::function_ref<Value *(OpBuilder &, Location, Value *, Type)>
+        materializeConversion,
+    llvm::function_ref<Value *(OpBuilder &, Location, Type, Operation *)>
+        materializeExtraCallOperand) {
+  FunctionType oldType = fn->getType();
+  unsigned numOldInputs = oldType.getNumInputs();
+  if (newType.getNumInputs() < numOldInputs)
+    return emitError(fn->getLoc(),
+                     "signature rewrite cannot drop function inputs");
+  if (newType.getNumResults() != oldType.getNumResults())
+    return emitError(fn->getLoc(),
+                     "signature rewrite cannot change the result count");
+
+  // Determine which conversions will be needed so that missing callbacks are
+  // diagnosed before any IR is touched.
+  bool inputTypesChanged = false;
+  for (unsigned i = 0; i != numOldInputs; ++i)
+    inputTypesChanged |= oldType.getInput(i) != newType.getInput(i);
+  bool resultTypesChanged = false;
+  for (unsigned i = 0, e = oldType.getNumResults(); i != e; ++i)
+    resultTypesChanged |= oldType.getResult(i) != newType.getResult(i);
+  if ((inputTypesChanged || resultTypesChanged) && !materializeConversion)
+    return emitError(fn->getLoc(),
+                     "signature rewrite changes types but no conversion "
+                     "materializer was provided");
+  unsigned numExtraInputs = newType.getNumInputs() - numOldInputs;
+
+  // Reject the rewrite if the function is referenced by anything other than a
+  // direct call; such references (e.g. a function constant feeding indirect
+  // calls) would silently keep the old signature.
+  Module *module = fn->getModule();
+  auto refersToFn = [&](Attribute attr) {
+    auto fnAttr = attr.dyn_cast<FunctionAttr>();
+    return fnAttr && fnAttr.getValue() == fn->getName().strref();
+  };
+  if (module) {
+    for (Function &caller : *module) {
+      if (caller.isExternal())
+        continue;
+      for (Operation *op : caller.getWalkSnapshot()) {
+        if (isa<CallOp>(op))
+          continue;
+        for (auto namedAttr : op->getAttrs())
+          if (refersToFn(namedAttr.second))
+            return emitError(op->getLoc(),
+                             "cannot rewrite the signature of a function "
+                             "referenced outside of direct calls");
+      }
+    }
+  }
+
+  // Retype the entry block arguments in place and adapt their uses.
+  if (!fn->isExternal()) {
+    Block &entry = fn->front();
+    OpBuilder builder(fn->getBody());
+    for (unsigned i = 0; i != numOldInputs; ++i) {
+      Type oldArgType = oldType.getInput(i);
+      Type newArgType = newType.getInput(i);
+      if (oldArgType == newArgType)
+        continue;
+
+      // Record the uses before materializing the conversion so that the
+      // conversion operation itself keeps using the retyped argument.
+      BlockArgument *arg = entry.getArgument(i);
+      SmallVector<OpOperand *, 8> uses;
+      recordUses(arg, uses);
+      arg->setType(newArgType);
+      if (uses.empty())
+        continue;
+      builder.setInsertionPointToStart(&entry);
+      Value *repl =
+          materializeConversion(builder, fn->getLoc(), arg, oldArgType);
+      assert(repl && repl->getType() == oldArgType &&
+             "expected a value of the original argument type");
+      replaceRecordedUses(uses, repl);
+    }
+
+    // Append the extra arguments to the entry block.
+    if (numExtraInputs != 0)
+      entry.addArguments(newType.getInputs().take_back(numExtraInputs));
+
+    // Adapt return operands to any changed result types.
+    if (resultTypesChanged) {
+      auto returnName = OperationName(ReturnOp::getOperationName(),
+                                      fn->getContext());
+      fn->walk(returnName, [&](Operation *op) {
+        for (unsigned i = 0, e = op->getNumOperands(); i != e; ++i) {
+          Type expected = newType.getResult(i);
+          Value *operand = op->getOperand(i);
+          if (operand->getType() == expected)
+            continue;
+          builder.setInsertionPoint(op);
+          op->setOperand(i, materializeConversion(builder, op->getLoc(),
+                                                  operand, expected));
+        }
+      });
+    }
+
+    // Argument retyping does not go through the use-list infrastructure, so
+    // invalidate cached analyses explicitly.
+    fn->markBodyModified();
+  }
+
+  fn->setType(newType);
+  if (!module)
+    return success();
+
+  // Batch-update every direct call site, located through the per-function
+  // operation kind index rather than a full module walk.
+  auto callName = OperationName(CallOp::getOperationName(), fn->getContext());
+  StringRef fnName = fn->getName().strref();
+  for (Function &caller : *module) {
+    caller.walk(callName, [&](Operation *op) {
+      auto call = cast<CallOp>(op);
+      if (call.getCallee() != fnName)
+        return;
+      OpBuilder builder(op);
+
+      // Convert the existing operands in place.
+      SmallVector<Value *, 8> newOperands;
+      newOperands.reserve(newType.getNumInputs());
+      for (unsigned i = 0; i != numOldInputs; ++i) {
+        Value *operand = op->getOperand(i);
+        Type expected = newType.getInput(i);
+        if (operand->getType() != expected)
+          operand = materializeConversion(builder, op->getLoc(), operand,
+                                          expected);
+        newOperands.push_back(operand);
+      }
+      for (unsigned i = 0; i != numExtraInputs; ++i) {
+        assert(materializeExtraCallOperand &&
+               "appending inputs requires an extra-operand materializer");
+        newOperands.push_back(materializeExtraCallOperand(
+            builder, op->getLoc(), newType.getInput(numOldInputs + i), op));
+      }
+
+      // Without appended operands the call can be patched in place: update
+      // the operand list and retype the results, adapting any uses.
+      if (numExtraInputs == 0) {
+        for (unsigned i = 0, e = newOperands.size(); i != e; ++i)
+          op->setOperand(i, newOperands[i]);
+        for (unsigned i = 0, e = op->getNumResults(); i != e; ++i) {
+          Value *result = op->getResult(i);
+          Type oldResType = result->getType();
+          Type newResType = newType.getResult(i);
+          if (oldResType == newResType)
+            continue;
+          SmallVector<OpOperand *, 8> uses;
+          recordUses(result, uses);
+          result->setType(newResType);
+          if (uses.empty())
+            continue;
+          builder.setInsertionPoint(op->getBlock(),
+                                    std::next(Block::iterator(op)));
+          Value *repl = materializeConversion(builder, op->getLoc(), result,
+                                              oldResType);
+          replaceRecordedUses(uses, repl);
+        }
+        caller.markBodyModified();
+        return;
+      }
+
+      // Otherwise the operand list grows, which requires recreating the call.
+      auto newCall = builder.create<CallOp>(op->getLoc(), fn, newOperands);
+      for (unsigned i = 0, e = op->getNumResults(); i != e; ++i) {
+        Value *oldResult = op->getResult(i);
+        Value *newResult = newCall.getOperation()->getResult(i);
+        if (oldResult->getType() != newResult->getType())
+          newResult = materializeConversion(builder, op->getLoc(), newResult,
+                                            oldResult->getType());
+        oldResult->replaceAllUsesWith(newResult);
+      }
+      op->erase();
+    });
+  }
+  return success();
+}
@@ -28,12 +28,16 @@
 #include "mlir/Analysis/VectorAnalysis.h"
 #include "mlir/IR/AffineExpr.h"
 #include "mlir/IR/Builders.h"
+#include "mlir/IR/Diagnostics.h"
 #include "mlir/IR/Location.h"
+#include "mlir/IR/Module.h"
+#include "mlir/IR/StandardTypes.h"
 #include "mlir/IR/Types.h"
 #include "mlir/Pass/Pass.h"
 #include "mlir/StandardOps/Ops.h"
 #include "mlir/Support/Functional.h"
 #include "mlir/Support/LLVM.h"
+#include "mlir/Support/STLExtras.h"
 #include "mlir/Transforms/Passes.h"
 #include "mlir/VectorOps/VectorOps.h"
 
@@ -558,6 +562,37 @@ static llvm::cl::list<int> clFastestVaryingPattern(
         " description and examples. This is used for testing purposes"),
     llvm::cl::ZeroOrMore, llvm::cl::cat(clOptionsCategory));
 
+static llvm::cl::opt<bool> clVectorizeProfitability(
+    "vectorize-check-profitability",
+    llvm::cl::desc(
+        "Only vectorize nests deemed profitable: trip counts of vectorized "
+        "loops must be multiples of the vector size and virtual vectors must "
+        "not span too many native registers of the selected target"),
+    llvm::cl::cat(clOptionsCategory));
+
+static llvm::cl::opt<std::string> clVectorizeTarget(
+    "vectorize-target", llvm::cl::init("generic"),
+    llvm::cl::desc("Target whose native vector width profitability is checked "
+                   "against (generic, sse4, neon, avx2, avx512)"),
+    llvm::cl::cat(clOptionsCategory));
+
+static llvm::cl::list<int> clMultiVersionWidths(
+    "vectorize-multi-version-widths",
+    llvm::cl::desc(
+        "Generate one variant of each outermost vectorized nest per given "
+        "innermost vector width, dispatched at runtime on the width returned "
+        "by the capability function (see -vectorize-dispatch-function); the "
+        "original nest is kept as the scalar fallback"),
+    llvm::cl::ZeroOrMore, llvm::cl::cat(clOptionsCategory));
+
+static llvm::cl::opt<std::string> clVectorizeDispatchFunction(
+    "vectorize-dispatch-function",
+    llvm::cl::init("mlir_runtime_vector_width"),
+    llvm::cl::desc("Name of a '() -> index' function declared in the module "
+                   "that returns the native vector width of the host; called "
+                   "to dispatch between multi-versioned variants"),
+    llvm::cl::cat(clOptionsCategory));
+
 /// Forward declaration.
 static FilterFunctionType
 isVectorizableLoopPtrFactory(const llvm::DenseSet<Operation *> &parallelLoops,
@@ -678,6 +713,100 @@ static LogicalResult analyzeProfitability(ArrayRef<NestedMatch> matches,
   return success();
 }
 
+/// Returns the native vector register width in bits of the target selected
+/// with -vectorize-target, looked up in a small per-target registry.
+static unsigned getTargetVectorBitWidth() {
+  struct TargetVectorWidth {
+    const char *name;
+    unsigned bitWidth;
+  };
+  static const TargetVectorWidth registry[] = {{"generic", 128},
+                                               {"sse4", 128},
+                                               {"neon", 128},
+                                               {"avx2", 256},
+                                               {"avx512", 512}};
+  for (const auto &entry : registry)
+    if (clVectorizeTarget == entry.name)
+      return entry.bitWidth;
+  return 128;
+}
+
+/// Returns the widest element bitwidth among the memrefs loaded or stored
+/// under 'op', or 32 if none is found. This is used to estimate how many
+/// native registers a virtual vector expands to.
+static unsigned getMaxMemRefElementBitWidth(Operation *op) {
+  unsigned maxBitWidth = 0;
+  op->walk([&](Operation *opInst) {
+    MemRefType memRefType;
+    if (auto load = dyn_cast<LoadOp>(opInst))
+      memRefType = load.getMemRefType();
+    else if (auto store = dyn_cast<StoreOp>(opInst))
+      memRefType = store.getMemRefType();
+    else
+      return;
+    auto elementType = memRefType.getElementType();
+    if (elementType.isIntOrFloat())
+      maxBitWidth = std::max(maxBitWidth, elementType.getIntOrFloatBitWidth());
+  });
+  return maxBitWidth == 0 ? 32 : maxBitWidth;
+}
+
+/// Checks whether applying `strategy` to the nest rooted at `rootMatch` is
+/// expected to pay off on the selected target, logging each decision. The
+/// nest is deemed unprofitable (and left scalar) when:
+///   1. a loop mapped to a vector dimension has a trip count that is not a
+///      known multiple of the vector size along that dimension - the ragged
+///      edge then has to be materialized as scalar cleanup whose cost tends
+///      to exceed the vector payoff on short loops;
+///   2. the virtual vector expands to more native registers than
+///      kMaxRegistersPerVirtualVector - super-vectors are meant to span a few
+///      registers, not to spill.
+static bool isVectorizationProfitable(NestedMatch rootMatch,
+                                      const VectorizationStrategy *strategy) {
+  // Generous bound: super-vectors legitimately span multiple registers, but
+  // past this the materialization and spill cost dwarfs any payoff.
+  constexpr unsigned kMaxRegistersPerVirtualVector = 64;
+
+  // Each loop is queried for its constant trip count and its divisor; the
+  // cache derives the trip count map once per loop and serves both.
+  AffineForTripCountCache tripCounts;
+  for (auto &loopAndDim : strategy->loopToVectorDim) {
+    auto loop = cast<AffineForOp>(loopAndDim.first);
+    int64_t vectorSize = strategy->vectorSizes[loopAndDim.second];
+    auto mayBeConstantCount = tripCounts.getConstantTripCount(loop);
+    if (mayBeConstantCount.hasValue() &&
+        static_cast<int64_t>(mayBeConstantCount.getValue()) < vectorSize) {
+      LLVM_DEBUG(dbgs() << "\n[early-vect] unprofitable: trip count "
+                        << mayBeConstantCount.getValue()
+                        << " < vector size " << vectorSize);
+      return false;
+    }
+    if (tripCounts.getLargestDivisorOfTripCount(loop) % vectorSize != 0) {
+      LLVM_DEBUG(dbgs() << "\n[early-vect] unprofitable: trip count not known "
+                           "to be a multiple of vector size "
+                        << vectorSize);
+      return false;
+    }
+  }
+
+  int64_t numElements = 1;
+  for (auto vectorSize : strategy->vectorSizes)
+    numElements *= vectorSize;
+  uint64_t virtualVectorBits =
+      numElements * getMaxMemRefElementBitWidth(rootMatch.getMatchedOperation());
+  uint64_t numRegisters =
+      llvm::divideCeil(virtualVectorBits, getTargetVectorBitWidth());
+  if (numRegisters > kMaxRegistersPerVirtualVector) {
+    LLVM_DEBUG(dbgs() << "\n[early-vect] unprofitable: virtual vector spans "
+                      << numRegisters << " native registers");
+    return false;
+  }
+
+  LLVM_DEBUG(dbgs() << "\n[early-vect] profitable: virtual vector spans "
+                    << numRegisters << " native registers");
+  return true;
+}
+
 ///// end TODO(ntv): Hoist to a VectorizationStrategy.cpp when appropriate /////
 
 namespace {
@@ -1191,6 +1320,64 @@ static LogicalResult vectorizeRootMatch(NestedMatch m,
   return guard.success();
 }
 
+/// Multi-versions the vectorizable nest rooted at 'forInst'. The scalar nest
+/// is cloned once per requested width (widest first), each clone in its own
+/// block reached through a chain of comparisons of the runtime vector width -
+/// obtained by calling 'dispatchFn' - against that width; when no variant
+/// width is supported, control falls back to the original scalar nest. Each
+/// clone is recorded in 'variantWidths' with the innermost vector width it
+/// must be vectorized at; the original nest must be left scalar.
+static void multiVersionNest(Operation *forInst, Function *dispatchFn,
+                             ArrayRef<int64_t> widths,
+                             DenseMap<Operation *, int64_t> &variantWidths) {
+  auto loc = forInst->getLoc();
+  Block *prologue = forInst->getBlock();
+  Function *f = prologue->getFunction();
+
+  // Split off everything past the nest; all variants rejoin there.
+  Block *continuation =
+      prologue->splitBlock(std::next(Block::iterator(forInst)));
+
+  // Move the scalar nest into its own fallback block.
+  Block *fallback = new Block();
+  f->getBlocks().insert(Function::iterator(continuation), fallback);
+  fallback->getOperations().splice(fallback->end(), prologue->getOperations(),
+                                   Block::iterator(forInst));
+  OpBuilder builder(fallback);
+  builder.create<BranchOp>(loc, continuation);
+
+  // Query the runtime vector width once at the dispatch site.
+  builder.setInsertionPointToEnd(prologue);
+  auto *width = builder.create<CallOp>(loc, dispatchFn).getResult(0);
+
+  // Build the dispatch chain, widest variant first, so that the widest
+  // supported width wins. The check against the first width goes at the end
+  // of the prologue; every subsequent check gets its own block, and the last
+  // check branches to the scalar fallback when it fails.
+  Block *checkBlock = prologue;
+  for (unsigned i = 0, e = widths.size(); i < e; ++i) {
+    Block *variant = new Block();
+    f->getBlocks().insert(Function::iterator(fallback), variant);
+    auto *clonedNest = forInst->clone();
+    variant->push_back(clonedNest);
+    OpBuilder(variant).create<BranchOp>(loc, continuation);
+    variantWidths[clonedNest] = widths[i];
+
+    Block *elseBlock = fallback;
+    if (i + 1 != e) {
+      elseBlock = new Block();
+      f->getBlocks().insert(Function::iterator(fallback), elseBlock);
+    }
+    builder.setInsertionPointToEnd(checkBlock);
+    auto widthCst = builder.create<ConstantIndexOp>(loc, widths[i]);
+    auto cmp = builder.create<CmpIOp>(loc, CmpIPredicate::SGE, width, widthCst);
+    builder.create<CondBranchOp>(loc, cmp, variant,
+                                 /*trueArgs=*/ArrayRef<Value *>(), elseBlock,
+                                 /*falseArgs=*/ArrayRef<Value *>());
+    checkBlock = elseBlock;
+  }
+}
+
 /// Applies vectorization to the current Function by searching over a bunch of
 /// predetermined patterns.
 void Vectorize::runOnFunction() {
@@ -1211,6 +1398,52 @@ void Vectorize::runOnFunction() {
       parallelLoops.insert(loop);
   });
 
+  // When requested, multi-version the matched nests before vectorizing: each
+  // clone is vectorized at its own width below while the original nest stays
+  // scalar as the fallback of the runtime dispatch.
+  DenseMap<Operation *, int64_t> variantWidths;
+  llvm::DenseSet<Operation *> scalarFallbacks;
+  if (!clMultiVersionWidths.empty() && !vectorSizes.empty()) {
+    Function *dispatchFn =
+        f.getModule()->getNamedFunction(clVectorizeDispatchFunction);
+    auto indexType = IndexType::get(f.getContext());
+    if (!dispatchFn ||
+        dispatchFn->getType() != FunctionType::get({}, indexType,
+                                                   f.getContext())) {
+      f.emitRemark("Multi-version vectorization requires a '() -> index' "
+                   "capability function '" +
+                   clVectorizeDispatchFunction + "' in the module.");
+      return signalPassFailure();
+    }
+    // Widest first so that the dispatch selects the widest supported variant.
+    SmallVector<int64_t, 4> widths(clMultiVersionWidths.begin(),
+                                   clMultiVersionWidths.end());
+    std::sort(widths.begin(), widths.end(), std::greater<int64_t>());
+    widths.erase(std::unique(widths.begin(), widths.end()), widths.end());
+
+    for (auto &pat : makePatterns(parallelLoops, vectorSizes.size(),
+                                  fastestVaryingPattern)) {
+      SmallVector<NestedMatch, 8> matches;
+      pat.match(&f, &matches);
+      for (auto m : matches) {
+        auto *matchedInst = m.getMatchedOperation();
+        // The dispatch requires unstructured control flow around the nest, so
+        // only nests sitting directly in a function-level block qualify.
+        if (matchedInst->getBlock()->getContainingOp())
+          continue;
+        multiVersionNest(matchedInst, dispatchFn, widths, variantWidths);
+        scalarFallbacks.insert(matchedInst);
+      }
+    }
+    // The variant clones are new operations; refresh the parallel loop set
+    // that the patterns below filter on.
+    parallelLoops.clear();
+    f.walk<AffineForOp>([&parallelLoops](AffineForOp loop) {
+      if (isLoopParallel(loop))
+        parallelLoops.insert(loop);
+    });
+  }
+
   for (auto &pat :
        makePatterns(parallelLoops, vectorSizes.size(), fastestVaryingPattern)) {
     LLVM_DEBUG(dbgs() << "\n******************************************");
@@ -1224,19 +1457,54 @@ void Vectorize::runOnFunction() {
     // Iterate over all the top-level matches and vectorize eagerly.
     // This automatically prunes intersecting matches.
     for (auto m : matches) {
+      auto *matchedInst = m.getMatchedOperation();
+      // Scalar fallbacks of multi-versioned nests are deliberately left as is.
+      if (scalarFallbacks.count(matchedInst))
+        continue;
       VectorizationStrategy strategy;
       // TODO(ntv): depending on profitability, elect to reduce the vector size.
       strategy.vectorSizes.assign(vectorSizes.begin(), vectorSizes.end());
+      auto variantIt = variantWidths.find(matchedInst);
+      if (variantIt != variantWidths.end())
+        strategy.vectorSizes.back() = variantIt->second;
       if (failed(analyzeProfitability(m.getMatchedChildren(), 1, patternDepth,
                                       &strategy))) {
+        if (OptRemark::isEnabled("affine-vectorize"))
+          OptRemark::missed(matchedInst->getLoc(), "affine-vectorize",
+                            "vectorize",
+                            "profitability analysis failed for the pattern");
         continue;
       }
       vectorizeLoopIfProfitable(m.getMatchedOperation(), 0, patternDepth,
                                 &strategy);
+      // Leave the nest scalar if the profitability check rejects it.
+      if (clVectorizeProfitability &&
+          !isVectorizationProfitable(m, &strategy)) {
+        if (OptRemark::isEnabled("affine-vectorize"))
+          OptRemark::missed(matchedInst->getLoc(), "affine-vectorize",
+                            "vectorize",
+                            "rejected by the vectorization cost model; "
+                            "leaving the nest scalar");
+        continue;
+      }
       // TODO(ntv): if pattern does not apply, report it; alter the
       // cost/benefit.
-      vectorizeRootMatch(m, &strategy);
-      // TODO(ntv): some diagnostics if failure to vectorize occurs.
+      // Capture the location now; a failed application erases the loop.
+      Location matchLoc = matchedInst->getLoc();
+      if (succeeded(vectorizeRootMatch(m, &strategy))) {
+        if (OptRemark::isEnabled("affine-vectorize")) {
+          std::string sizes;
+          llvm::raw_string_ostream sizesOs(sizes);
+          interleaveComma(strategy.vectorSizes, sizesOs);
+          OptRemark::passed(matchLoc, "affine-vectorize", "vectorize",
+                            "vectorized loop nest with vector sizes [" +
+                                sizesOs.str() + "]");
+        }
+      } else if (OptRemark::isEnabled("affine-vectorize")) {
+        OptRemark::missed(matchLoc, "affine-vectorize", "vectorize",
+                          "pattern was no longer vectorizable when applied; "
+                          "nest left scalar");
+      }
     }
   }
   LLVM_DEBUG(dbgs() << "\n");
@@ -75,6 +75,9 @@ struct PrintCFGPass : public FunctionPass<PrintCFGPass> {
       : os(os), shortNames(shortNames), title(title) {}
   void runOnFunction() {
     mlir::writeGraph(os, getFunction(), shortNames, title);
+
+    // Printing the graph does not modify the IR.
+    markAllAnalysesPreserved();
   }
 
 private:
@@ -142,3 +142,24 @@ func @affine_if_invalid_dimop_dim(%arg0: index, %arg1: index, %arg2: index, %arg
   }
   return
 }
+
+// -----
+
+func @affine_for_missing_carried_value(%init : f32) {
+  // expected-error@+1 {{expected terminator to have one operand per loop-carried value}}
+  %0 = affine.for %i = 0 to 10 iter_args(%acc = %init) -> (f32) {
+    "affine.terminator"() : () -> ()
+  }
+  return
+}
+
+// -----
+
+func @affine_for_carried_value_type(%init : f32) {
+  // expected-error@+1 {{expected terminator operand 0 to have the same type as the matching result}}
+  %0 = affine.for %i = 0 to 10 iter_args(%acc = %init) -> (f32) {
+    %c = constant 0 : index
+    "affine.terminator"(%c) : (index) -> ()
+  }
+  return
+}
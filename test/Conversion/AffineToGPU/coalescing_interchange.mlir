@@ -0,0 +1,25 @@
+// RUN: mlir-opt -convert-affine-to-gpu -gpu-block-dims=1 -gpu-thread-dims=1 -gpu-coalescing-interchange %s | FileCheck %s
+
+// The accesses are contiguous along %i, so %i must be interchanged inwards
+// and mapped to the x thread dimension; %j becomes the block loop.
+// CHECK-LABEL: @transposed_copy
+func @transposed_copy(%A : memref<?x?xf32>, %B : memref<?x?xf32>) {
+  // The range of the outer (block) loop is now that of %j.
+  // CHECK: {{.*}} = subi %c10, %c0
+  // CHECK: {{.*}} = subi %c42, %c0_0
+  // CHECK: gpu.launch
+  //
+  // %i0 is the x block id, %i3 the x thread id; the first subscript must
+  // derive from the block id and the innermost one from the thread id.
+  // CHECK: %[[J:.*]] = addi %{{.*}}, %i0
+  // CHECK-NEXT: %[[I:.*]] = addi %{{.*}}, %i3
+  // CHECK: load %{{.*}}[%[[J]], %[[I]]]
+  // CHECK: store %{{.*}}[%[[J]], %[[I]]]
+  affine.for %i = 0 to 42 {
+    affine.for %j = 0 to 10 {
+      %v = load %A[%j, %i] : memref<?x?xf32>
+      store %v, %B[%j, %i] : memref<?x?xf32>
+    }
+  }
+  return
+}
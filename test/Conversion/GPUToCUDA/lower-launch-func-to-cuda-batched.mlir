@@ -0,0 +1,32 @@
+// RUN: mlir-opt %s --launch-func-to-cuda -cuda-batched-arg-staging | FileCheck %s
+
+func @cubin_getter() -> !llvm<"i8*">
+
+func @kernel(!llvm.float, !llvm<"float*">)
+    attributes { gpu.kernel, nvvm.cubingetter = @cubin_getter }
+
+
+func @foo() {
+  %0 = "op"() : () -> (!llvm.float)
+  %1 = "op"() : () -> (!llvm<"float*">)
+  %cst = constant 8 : index
+
+  // Both arguments are staged at aligned offsets into one pinned buffer from
+  // the runtime pool (float at 0, float* at 8, 16 bytes total) instead of one
+  // stack allocation each, and the params array points into that buffer.
+  // CHECK: %[[SIZE:.*]] = llvm.constant(16 : i32) : !llvm.i32
+  // CHECK: %[[BUF:.*]] = llvm.call @mcuGetPooledArgBuffer(%[[SIZE]]) : (!llvm.i32) -> !llvm<"i8*">
+  // CHECK: %[[OFF0:.*]] = llvm.constant(0 : i32) : !llvm.i32
+  // CHECK: %[[SLOT0:.*]] = llvm.getelementptr %[[BUF]][%[[OFF0]]]
+  // CHECK: %[[TYPED0:.*]] = llvm.bitcast %[[SLOT0]] : !llvm<"i8*"> to !llvm<"float*">
+  // CHECK: llvm.store {{.*}}, %[[TYPED0]]
+  // CHECK: %[[OFF1:.*]] = llvm.constant(8 : i32) : !llvm.i32
+  // CHECK: %[[SLOT1:.*]] = llvm.getelementptr %[[BUF]][%[[OFF1]]]
+  // CHECK: %[[TYPED1:.*]] = llvm.bitcast %[[SLOT1]] : !llvm<"i8*"> to !llvm<"float**">
+  // CHECK: llvm.store {{.*}}, %[[TYPED1]]
+  // CHECK: llvm.call @mcuLaunchKernel
+  "gpu.launch_func"(%cst, %cst, %cst, %cst, %cst, %cst, %0, %1) { kernel = @kernel }
+      : (index, index, index, index, index, index, !llvm.float, !llvm<"float*">) -> ()
+
+  return
+}
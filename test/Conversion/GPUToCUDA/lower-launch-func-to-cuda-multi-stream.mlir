@@ -0,0 +1,39 @@
+// RUN: mlir-opt %s --launch-func-to-cuda -cuda-multi-stream | FileCheck %s
+
+func @cubin_getter() -> !llvm<"i8*">
+
+func @kernel(!llvm<"float*">)
+    attributes { gpu.kernel, nvvm.cubingetter = @cubin_getter }
+
+func @multi_branch() {
+  %0 = "op"() : () -> (!llvm<"float*">)
+  %1 = "op"() : () -> (!llvm<"float*">)
+  %cst = constant 8 : index
+
+  // The two independent launches go to separate streams, the dependent third
+  // launch reuses the stream of its operand and waits on the other stream
+  // through an event, and each stream is synchronized once at the end.
+  // CHECK: %[[C0:.*]] = llvm.constant(0 : i32) : !llvm.i32
+  // CHECK: %[[S0:.*]] = llvm.call @mcuGetStreamForIndexHelper(%[[C0]]) : (!llvm.i32) -> !llvm<"i8*">
+  // CHECK: llvm.call @mcuLaunchKernel({{.*}}, %[[S0]], {{.*}})
+  // CHECK-NOT: llvm.call @mcuStreamSynchronize
+  // CHECK: %[[C1:.*]] = llvm.constant(1 : i32) : !llvm.i32
+  // CHECK: %[[S1:.*]] = llvm.call @mcuGetStreamForIndexHelper(%[[C1]]) : (!llvm.i32) -> !llvm<"i8*">
+  // CHECK: llvm.call @mcuLaunchKernel({{.*}}, %[[S1]], {{.*}})
+  // CHECK-NOT: llvm.call @mcuStreamSynchronize
+  // CHECK: llvm.call @mcuStreamWaitStreamHelper(%[[S0]], %[[S1]]) : (!llvm<"i8*">, !llvm<"i8*">) -> !llvm.i32
+  // CHECK: llvm.call @mcuLaunchKernel({{.*}}, %[[S0]], {{.*}})
+  // CHECK: llvm.call @mcuStreamSynchronize(%[[S0]]) : (!llvm<"i8*">) -> !llvm.i32
+  // CHECK: llvm.call @mcuStreamSynchronize(%[[S1]]) : (!llvm<"i8*">) -> !llvm.i32
+  "gpu.launch_func"(%cst, %cst, %cst, %cst, %cst, %cst, %0) { kernel = @kernel }
+      : (index, index, index, index, index, index, !llvm<"float*">) -> ()
+  "gpu.launch_func"(%cst, %cst, %cst, %cst, %cst, %cst, %1) { kernel = @kernel }
+      : (index, index, index, index, index, index, !llvm<"float*">) -> ()
+  "gpu.launch_func"(%cst, %cst, %cst, %cst, %cst, %cst, %0, %1) { kernel = @kernel_2 }
+      : (index, index, index, index, index, index, !llvm<"float*">, !llvm<"float*">) -> ()
+
+  return
+}
+
+func @kernel_2(!llvm<"float*">, !llvm<"float*">)
+    attributes { gpu.kernel, nvvm.cubingetter = @cubin_getter }
@@ -0,0 +1,26 @@
+// RUN: mlir-opt %s --launch-func-to-cuda -cuda-pooled-launch-resources | FileCheck %s
+
+func @cubin_getter() -> !llvm<"i8*">
+
+func @kernel(!llvm.float, !llvm<"float*">)
+    attributes { gpu.kernel, nvvm.cubingetter = @cubin_getter }
+
+
+func @foo() {
+  %0 = "op"() : () -> (!llvm.float)
+  %1 = "op"() : () -> (!llvm<"float*">)
+  %cst = constant 8 : index
+
+  // The module load and function resolution collapse into one cached call
+  // and both the stream and the parameter buffer come from runtime pools.
+  // CHECK: llvm.call @mcuModuleGetFunctionCached({{.*}}) : (!llvm<"i8**">, !llvm<"i8*">, !llvm<"i8*">) -> !llvm.i32
+  // CHECK-NOT: llvm.call @mcuModuleLoad
+  // CHECK: %[[STREAM:.*]] = llvm.call @mcuGetPooledStreamHelper() : () -> !llvm<"i8*">
+  // CHECK: %[[PARAMS:.*]] = llvm.call @mcuGetPooledParamsBuffer({{.*}}) : (!llvm.i32) -> !llvm<"i8**">
+  // CHECK: llvm.call @mcuLaunchKernel({{.*}}, %[[STREAM]], %[[PARAMS]], {{.*}}) : (!llvm<"i8*">, index, index, index, index, index, index, !llvm.i32, !llvm<"i8*">, !llvm<"i8**">, !llvm<"i8**">) -> !llvm.i32
+  // CHECK: llvm.call @mcuStreamSynchronize(%[[STREAM]]) : (!llvm<"i8*">) -> !llvm.i32
+  "gpu.launch_func"(%cst, %cst, %cst, %cst, %cst, %cst, %0, %1) { kernel = @kernel }
+      : (index, index, index, index, index, index, !llvm.float, !llvm<"float*">) -> ()
+
+  return
+}
@@ -0,0 +1,32 @@
+// RUN: mlir-opt -gpu-stage-shared-memory %s | FileCheck %s
+
+// CHECK-LABEL: func @stage_read_only
+func @stage_read_only(%input : memref<32x32xf32>, %output : memref<32x32xf32>,
+                      %sz : index) {
+  gpu.launch blocks(%bx, %by, %bz) in (%grid_x = %sz, %grid_y = %sz, %grid_z = %sz)
+             threads(%tx, %ty, %tz) in (%block_x = %sz, %block_y = %sz, %block_z = %sz)
+             args(%in = %input, %out = %output) : memref<32x32xf32>, memref<32x32xf32> {
+    // The read-only memref is staged: copy nest, barrier, then the compute
+    // nest reads from the shared buffer. The written memref is not staged.
+    // CHECK: %[[buf:.*]] = alloc() : memref<32x32xf32, 3>
+    // CHECK: affine.for %[[ci:.*]] = 0 to 32 {
+    // CHECK:   affine.for %[[cj:.*]] = 0 to 32 {
+    // CHECK:     %[[elt:.*]] = load %{{.*}}[%[[ci]], %[[cj]]] : memref<32x32xf32>
+    // CHECK:     store %[[elt]], %[[buf]][%[[ci]], %[[cj]]] : memref<32x32xf32, 3>
+    // CHECK: gpu.barrier
+    // CHECK: affine.for %{{.*}} = 0 to 32 {
+    // CHECK:   affine.for %{{.*}} = 0 to 32 {
+    // CHECK:     load %[[buf]][{{.*}}] : memref<32x32xf32, 3>
+    // CHECK:     store %{{.*}} : memref<32x32xf32>
+    // CHECK: dealloc %[[buf]] : memref<32x32xf32, 3>
+    affine.for %i = 0 to 32 {
+      affine.for %j = 0 to 32 {
+        %0 = load %in[%i, %j] : memref<32x32xf32>
+        store %0, %out[%i, %j] : memref<32x32xf32>
+      }
+    }
+    // CHECK: gpu.return
+    gpu.return
+  }
+  return
+}
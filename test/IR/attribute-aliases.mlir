@@ -0,0 +1,25 @@
+// RUN: mlir-opt %s | FileCheck %s
+// RUN: mlir-opt %s -mlir-attr-alias-threshold=0 | FileCheck %s --check-prefix=DISABLED
+
+// Attributes repeated at least as many times as the alias threshold are
+// printed once as an alias definition and referenced everywhere else.
+
+// CHECK: #attr0 = dense<[0, 1, 2, 3, 4, 5, 6, 7]> : tensor<8xi32>
+// DISABLED-NOT: #attr0
+
+// CHECK-LABEL: func @repeated_attrs
+func @repeated_attrs() {
+  // CHECK: "foo.op"() {vals = #attr0}
+  // CHECK: "foo.op"() {vals = #attr0}
+  // CHECK: "foo.op"() {vals = #attr0}
+  // CHECK: "foo.op"() {vals = #attr0}
+  "foo.op"() {vals = dense<[0, 1, 2, 3, 4, 5, 6, 7]> : tensor<8xi32>} : () -> ()
+  "foo.op"() {vals = dense<[0, 1, 2, 3, 4, 5, 6, 7]> : tensor<8xi32>} : () -> ()
+  "foo.op"() {vals = dense<[0, 1, 2, 3, 4, 5, 6, 7]> : tensor<8xi32>} : () -> ()
+  "foo.op"() {vals = dense<[0, 1, 2, 3, 4, 5, 6, 7]> : tensor<8xi32>} : () -> ()
+
+  // Attributes below the repetition threshold stay inline.
+  // CHECK: {other = dense<[7, 6, 5, 4, 3, 2, 1, 0]> : tensor<8xi32>}
+  "foo.op"() {other = dense<[7, 6, 5, 4, 3, 2, 1, 0]> : tensor<8xi32>} : () -> ()
+  return
+}
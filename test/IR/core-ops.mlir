@@ -354,6 +354,18 @@ func @calls(%arg0: i32) {
   return
 }
 
+// CHECK-LABEL: func @chunked_body(%arg0: index, %arg1: index, %arg2: memref<64xf32>) {
+func @chunked_body(%lb: index, %ub: index, %buf: memref<64xf32>) {
+  return
+}
+
+// CHECK-LABEL: func @parallel_calls(%arg0: memref<64xf32>, %arg1: index, %arg2: index) {
+func @parallel_calls(%arg0: memref<64xf32>, %arg1: index, %arg2: index) {
+  // CHECK: parallel_call @chunked_body(%arg1, %arg2, %arg0) : (index, index, memref<64xf32>) -> ()
+  parallel_call @chunked_body(%arg1, %arg2, %arg0) : (index, index, memref<64xf32>) -> ()
+  return
+}
+
 // CHECK-LABEL: func @extract_element(%arg0: tensor<*xi32>, %arg1: tensor<4x4xf32>) -> i32 {
 func @extract_element(%arg0: tensor<*xi32>, %arg1 : tensor<4x4xf32>) -> i32 {
   %c0 = "std.constant"() {value = 0: index} : () -> index
@@ -0,0 +1,18 @@
+// RUN: mlir-opt %s | FileCheck %s
+// RUN: mlir-opt -mlir-print-elementsattrs-with-hex-if-larger=1 %s | FileCheck %s --check-prefix=HEX
+
+// Hex strings decode straight into the dense storage and print back as
+// decimal below the hex threshold.
+// CHECK: dense<[2.000000e+00, 4.000000e+00, 6.000000e+00]> : tensor<3xf32>
+// HEX: dense<"0x00000040000080400000C040"> : tensor<3xf32>
+func @dense_float_hex() {
+  "foo.op"() {bar = dense<"0x00000040000080400000C040"> : tensor<3xf32>} : () -> ()
+  return
+}
+
+// CHECK: dense<[1, 2]> : tensor<2xi32>
+// HEX: dense<"0x0100000002000000"> : tensor<2xi32>
+func @dense_int_hex() {
+  "foo.op"() {bar = dense<"0x0100000002000000"> : tensor<2xi32>} : () -> ()
+  return
+}
@@ -119,6 +119,55 @@ func @bad_alloc_wrong_symbol_count() {
 
 // -----
 
+func @bad_alloc_alignment() {
+^bb0:
+  // Test alloc with an alignment that is not a power of two.
+  %0 = alloc() {alignment = 12 : i64} : memref<8xf32> // expected-error {{alignment must be a positive power of two}}
+  return
+}
+
+// -----
+
+func @bad_prefetch_locality(%arg0: memref<8xf32>, %i: index) {
+  // Test prefetch with an out-of-range locality hint.
+  prefetch %arg0[%i] {isWrite = false, localityHint = 5 : i32} : memref<8xf32> // expected-error {{requires a 'localityHint' attribute between 0 and 3}}
+  return
+}
+
+// -----
+
+func @bad_prefetch_indices(%arg0: memref<8x8xf32>, %i: index) {
+  // Test prefetch with too few indices for the memref rank.
+  prefetch %arg0[%i] {isWrite = false, localityHint = 3 : i32} : memref<8x8xf32> // expected-error {{incorrect number of indices for prefetch}}
+  return
+}
+
+// -----
+
+func @missing_bounds(%arg0: memref<16xf32>) {
+  return
+}
+
+func @bad_parallel_call_bounds(%arg0: memref<16xf32>) {
+  // Test parallel_call to a callee without leading index bounds.
+  parallel_call @missing_bounds(%arg0) : (memref<16xf32>) -> () // expected-error {{callee must take the chunk bounds as two leading index arguments}}
+  return
+}
+
+// -----
+
+func @float_capture(%lb: index, %ub: index, %arg0: f32) {
+  return
+}
+
+func @bad_parallel_call_abi(%lb: index, %ub: index, %arg0: f32) {
+  // Test parallel_call with an operand outside the word-sized runtime ABI.
+  parallel_call @float_capture(%lb, %ub, %arg0) : (index, index, f32) -> () // expected-error {{operand 2 has a type unsupported by the parallel runtime ABI}}
+  return
+}
+
+// -----
+
 func @test_store_zero_results() {
 ^bb0:
   %0 = alloc() : memref<1024x64xf32, (d0, d1) -> (d0, d1), 1>
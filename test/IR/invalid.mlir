@@ -1066,3 +1066,27 @@ func @invalid_region_dominance() {
   }) : () -> ()
   return
 }
+
+// -----
+
+func @elements_literal_hex_size() {
+  // expected-error@+1 {{elements hex data size does not match the expected storage size of the type}}
+  "foo.op"() {bar = dense<"0x00000040"> : tensor<3xf32>} : () -> ()
+  return
+}
+
+// -----
+
+func @elements_literal_hex_prefix() {
+  // expected-error@+1 {{elements hex string should start with '0x'}}
+  "foo.op"() {bar = dense<"00000040"> : tensor<1xf32>} : () -> ()
+  return
+}
+
+// -----
+
+func @too_many_regions() {
+  // expected-error@+1 {{operation cannot have more than 255 regions}}
+  "foo.op"() ({}, {}, {}, {}, {}, {}, {}, {}, {}, {}, {}, {}, {}, {}, {}, {}, {}, {}, {}, {}, {}, {}, {}, {}, {}, {}, {}, {}, {}, {}, {}, {}, {}, {}, {}, {}, {}, {}, {}, {}, {}, {}, {}, {}, {}, {}, {}, {}, {}, {}, {}, {}, {}, {}, {}, {}, {}, {}, {}, {}, {}, {}, {}, {}, {}, {}, {}, {}, {}, {}, {}, {}, {}, {}, {}, {}, {}, {}, {}, {}, {}, {}, {}, {}, {}, {}, {}, {}, {}, {}, {}, {}, {}, {}, {}, {}, {}, {}, {}, {}, {}, {}, {}, {}, {}, {}, {}, {}, {}, {}, {}, {}, {}, {}, {}, {}, {}, {}, {}, {}, {}, {}, {}, {}, {}, {}, {}, {}, {}, {}, {}, {}, {}, {}, {}, {}, {}, {}, {}, {}, {}, {}, {}, {}, {}, {}, {}, {}, {}, {}, {}, {}, {}, {}, {}, {}, {}, {}, {}, {}, {}, {}, {}, {}, {}, {}, {}, {}, {}, {}, {}, {}, {}, {}, {}, {}, {}, {}, {}, {}, {}, {}, {}, {}, {}, {}, {}, {}, {}, {}, {}, {}, {}, {}, {}, {}, {}, {}, {}, {}, {}, {}, {}, {}, {}, {}, {}, {}, {}, {}, {}, {}, {}, {}, {}, {}, {}, {}, {}, {}, {}, {}, {}, {}, {}, {}, {}, {}, {}, {}, {}, {}, {}, {}, {}, {}, {}, {}, {}, {}, {}, {}, {}, {}, {}, {}, {}, {}, {}, {}, {}, {}, {}, {}, {}, {}) : () -> ()
+  return
+}
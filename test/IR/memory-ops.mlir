@@ -29,6 +29,10 @@ func @alloc() {
   // CHECK: %4 = alloc() : memref<2xi32>
   %4 = alloc() : memref<2 x i32>
 
+  // Test alloc with an alignment request.
+  // CHECK: %5 = alloc() {alignment = 64 : i64} : memref<8x64xf32>
+  %5 = alloc() {alignment = 64 : i64} : memref<8x64xf32>
+
   // CHECK:   return
   return
 }
@@ -62,6 +66,24 @@ func @load_store() {
   return
 }
 
+// CHECK-LABEL: func @prefetch
+func @prefetch() {
+^bb0:
+  // CHECK: %0 = alloc() : memref<1024x64xf32>
+  %0 = alloc() : memref<1024x64xf32, (d0, d1) -> (d0, d1), 0>
+
+  %1 = constant 0 : index
+  %2 = constant 1 : index
+
+  // CHECK: prefetch %0[%c0, %c1] {isWrite = false, localityHint = 3 : i32} : memref<1024x64xf32>
+  prefetch %0[%1, %2] {isWrite = false, localityHint = 3 : i32} : memref<1024x64xf32, (d0, d1) -> (d0, d1), 0>
+
+  // CHECK: prefetch %0[%c1, %c0] {isWrite = true, localityHint = 0 : i32} : memref<1024x64xf32>
+  prefetch %0[%2, %1] {isWrite = true, localityHint = 0 : i32} : memref<1024x64xf32, (d0, d1) -> (d0, d1), 0>
+
+  return
+}
+
 // CHECK-LABEL: func @dma_ops()
 func @dma_ops() {
   %c0 = constant 0 : index
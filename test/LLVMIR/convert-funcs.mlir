@@ -50,3 +50,31 @@ func @indirect_call(%arg0: (f32) -> i32, %arg1: f32) -> i32 {
   return %0 : i32
 }
 
+// CHECK-LABEL: func @parallel_body(%arg0: !llvm.i64, %arg1: !llvm.i64, %arg2: !llvm<"float*">)
+func @parallel_body(%arg0: index, %arg1: index, %arg2: memref<16xf32>) {
+  return
+}
+
+// A parallel_call packs its captured operands into a word array on the stack
+// and hands the callee address, the bounds and the array to the runtime.
+// CHECK-LABEL: func @parallel_dispatch(%arg0: !llvm<"float*">)
+func @parallel_dispatch(%arg0: memref<16xf32>) {
+  // CHECK: %[[SZ:.*]] = llvm.constant(1 : index) : !llvm.i64
+  // CHECK: %[[ARR:.*]] = llvm.alloca %[[SZ]] x !llvm.i64 : (!llvm.i64) -> !llvm<"i64*">
+  // CHECK: %[[LB:.*]] = llvm.constant(0 : index) : !llvm.i64
+  // CHECK: %[[UB:.*]] = llvm.constant(16 : index) : !llvm.i64
+  // CHECK: %[[FN:.*]] = llvm.constant(@parallel_body) : !llvm<"void (i64, i64, float*)*">
+  // CHECK: %[[RAW:.*]] = llvm.bitcast %[[FN]] : !llvm<"void (i64, i64, float*)*"> to !llvm<"i8*">
+  // CHECK: %[[W0:.*]] = llvm.ptrtoint %arg0 : !llvm<"float*"> to !llvm.i64
+  // CHECK: %[[SLOT:.*]] = llvm.getelementptr %[[ARR]][%{{.*}}] : (!llvm<"i64*">, !llvm.i64) -> !llvm<"i64*">
+  // CHECK: llvm.store %[[W0]], %[[SLOT]] : !llvm<"i64*">
+  // CHECK: %[[N:.*]] = llvm.constant(1 : index) : !llvm.i64
+  // CHECK: llvm.call @mlir_parallel_for(%[[RAW]], %[[LB]], %[[UB]], %[[N]], %[[ARR]]) : (!llvm<"i8*">, !llvm.i64, !llvm.i64, !llvm.i64, !llvm<"i64*">) -> ()
+  %c0 = constant 0 : index
+  %c16 = constant 16 : index
+  parallel_call @parallel_body(%c0, %c16, %arg0) : (index, index, memref<16xf32>) -> ()
+  return
+}
+
+// CHECK: func @mlir_parallel_for(!llvm<"i8*">, !llvm.i64, !llvm.i64, !llvm.i64, !llvm<"i64*">)
+
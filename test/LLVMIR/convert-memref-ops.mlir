@@ -95,6 +95,20 @@ func @static_alloc() -> memref<32x18xf32> {
  return %0 : memref<32x18xf32>
 }
 
+// CHECK-LABEL: func @aligned_static_alloc() -> !llvm<"float*"> {
+func @aligned_static_alloc() -> memref<32x18xf32> {
+// The requested alignment routes the allocation to aligned_alloc, with the
+// size rounded up to a multiple of the alignment.
+// CHECK: %[[ALIGN:.*]] = llvm.constant(64 : index) : !llvm.i64
+// CHECK: %[[BUMPED:.*]] = llvm.add %{{.*}}, %{{.*}} : !llvm.i64
+// CHECK: %[[REM:.*]] = llvm.urem %[[BUMPED]], %[[ALIGN]] : !llvm.i64
+// CHECK: %[[SIZE:.*]] = llvm.sub %[[BUMPED]], %[[REM]] : !llvm.i64
+// CHECK: %{{.*}} = llvm.call @aligned_alloc(%[[ALIGN]], %[[SIZE]]) : (!llvm.i64, !llvm.i64) -> !llvm<"i8*">
+// CHECK: llvm.bitcast %{{.*}} : !llvm<"i8*"> to !llvm<"float*">
+ %0 = alloc() {alignment = 64 : i64} : memref<32x18xf32>
+ return %0 : memref<32x18xf32>
+}
+
 // CHECK-LABEL: func @static_dealloc(%arg0: !llvm<"float*">) {
 func @static_dealloc(%static: memref<10x8xf32>) {
 // CHECK-NEXT:  %0 = llvm.bitcast %arg0 : !llvm<"float*"> to !llvm<"i8*">
@@ -148,6 +162,22 @@ func @dynamic_load(%dynamic : memref<?x?xf32>, %i : index, %j : index) {
   return
 }
 
+// CHECK-LABEL: func @static_prefetch
+func @static_prefetch(%static : memref<10x42xf32>, %i : index, %j : index) {
+// CHECK-NEXT:  %0 = llvm.constant(10 : index) : !llvm.i64
+// CHECK-NEXT:  %1 = llvm.constant(42 : index) : !llvm.i64
+// CHECK-NEXT:  %2 = llvm.mul %arg1, %1 : !llvm.i64
+// CHECK-NEXT:  %3 = llvm.add %2, %arg2 : !llvm.i64
+// CHECK-NEXT:  %4 = llvm.getelementptr %arg0[%3] : (!llvm<"float*">, !llvm.i64) -> !llvm<"float*">
+// CHECK-NEXT:  %5 = llvm.bitcast %4 : !llvm<"float*"> to !llvm<"i8*">
+// CHECK-NEXT:  %6 = llvm.constant(0 : i32) : !llvm.i32
+// CHECK-NEXT:  %7 = llvm.constant(3 : i32) : !llvm.i32
+// CHECK-NEXT:  %8 = llvm.constant(1 : i32) : !llvm.i32
+// CHECK-NEXT:  "llvm.prefetch"(%5, %6, %7, %8) : (!llvm<"i8*">, !llvm.i32, !llvm.i32, !llvm.i32) -> ()
+  prefetch %static[%i, %j] {isWrite = false, localityHint = 3 : i32} : memref<10x42xf32>
+  return
+}
+
 // CHECK-LABEL: func @zero_d_store(%arg0: !llvm<"float*">, %arg1: !llvm.float) {
 func @zero_d_store(%arg0: memref<f32>, %arg1: f32) {
 // CHECK-NEXT:  llvm.store %arg1, %arg0 : !llvm<"float*">
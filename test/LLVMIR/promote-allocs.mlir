@@ -0,0 +1,37 @@
+// RUN: mlir-opt -lower-to-llvm -std-to-llvm-promote-alloc-bytes=128 %s | FileCheck %s
+
+// A small scratch buffer becomes an entry-block alloca and its dealloc
+// disappears.
+// CHECK-LABEL: func @promoted
+func @promoted(%v : f32) -> f32 {
+  // CHECK: %[[N:.*]] = llvm.constant(16 : index) : !llvm.i64
+  // CHECK: %{{.*}} = llvm.alloca %[[N]] x !llvm.float : (!llvm.i64) -> !llvm<"float*">
+  // CHECK-NOT: llvm.call @malloc
+  // CHECK-NOT: llvm.call @free
+  %c0 = constant 0 : index
+  %a = alloc() : memref<16xf32>
+  store %v, %a[%c0] : memref<16xf32>
+  %r = load %a[%c0] : memref<16xf32>
+  dealloc %a : memref<16xf32>
+  return %r : f32
+}
+
+// 4096 bytes exceed the bound, so the buffer stays on the heap.
+// CHECK-LABEL: func @too_large
+func @too_large(%v : f32) {
+  // CHECK: llvm.call @malloc
+  // CHECK: llvm.call @free
+  %c0 = constant 0 : index
+  %a = alloc() : memref<1024xf32>
+  store %v, %a[%c0] : memref<1024xf32>
+  dealloc %a : memref<1024xf32>
+  return
+}
+
+// A buffer that leaves the function must not live on its stack.
+// CHECK-LABEL: func @escapes
+func @escapes() -> memref<4xf32> {
+  // CHECK: llvm.call @malloc
+  %a = alloc() : memref<4xf32>
+  return %a : memref<4xf32>
+}
@@ -60,23 +60,23 @@ func @slice(%arg0: !linalg.buffer<?xf32>, %arg1: !linalg.range) {
   %1 = linalg.slice %0[%arg1] : !linalg.view<?xf32>, !linalg.range, !linalg.view<?xf32>
   return
 }
+// The slice reads no field of the view descriptor %12: the base pointer %1,
+// zero offset %3 and stride %7 it was built from are forwarded directly and
+// the view descriptor construction is left as dead code.
 // CHECK-LABEL: func @slice(%arg0: !llvm<"{ float*, i64 }">, %arg1: !llvm<"{ i64, i64, i64 }">) {
 //       CHECK:   %13 = llvm.undef : !llvm<"{ float*, i64, [1 x i64], [1 x i64] }">
-//  CHECK-NEXT:   %14 = llvm.extractvalue %12[0] : !llvm<"{ float*, i64, [1 x i64], [1 x i64] }">
-//  CHECK-NEXT:   %15 = llvm.insertvalue %14, %13[0] : !llvm<"{ float*, i64, [1 x i64], [1 x i64] }">
-//  CHECK-NEXT:   %16 = llvm.extractvalue %12[3, 0] : !llvm<"{ float*, i64, [1 x i64], [1 x i64] }">
-//  CHECK-NEXT:   %17 = llvm.extractvalue %12[1] : !llvm<"{ float*, i64, [1 x i64], [1 x i64] }">
-//  CHECK-NEXT:   %18 = llvm.extractvalue %arg1[0] : !llvm<"{ i64, i64, i64 }">
-//  CHECK-NEXT:   %19 = llvm.mul %18, %16 : !llvm.i64
-//  CHECK-NEXT:   %20 = llvm.add %17, %19 : !llvm.i64
-//  CHECK-NEXT:   %21 = llvm.insertvalue %20, %15[1] : !llvm<"{ float*, i64, [1 x i64], [1 x i64] }">
-//  CHECK-NEXT:   %22 = llvm.extractvalue %arg1[0] : !llvm<"{ i64, i64, i64 }">
-//  CHECK-NEXT:   %23 = llvm.extractvalue %arg1[1] : !llvm<"{ i64, i64, i64 }">
-//  CHECK-NEXT:   %24 = llvm.sub %23, %22 : !llvm.i64
-//  CHECK-NEXT:   %25 = llvm.insertvalue %24, %21[2, 0] : !llvm<"{ float*, i64, [1 x i64], [1 x i64] }">
-//  CHECK-NEXT:   %26 = llvm.extractvalue %arg1[2] : !llvm<"{ i64, i64, i64 }">
-//  CHECK-NEXT:   %27 = llvm.mul %16, %26 : !llvm.i64
-//  CHECK-NEXT:   %28 = llvm.insertvalue %27, %25[3, 0] : !llvm<"{ float*, i64, [1 x i64], [1 x i64] }">
+//  CHECK-NEXT:   %14 = llvm.insertvalue %1, %13[0] : !llvm<"{ float*, i64, [1 x i64], [1 x i64] }">
+//  CHECK-NEXT:   %15 = llvm.extractvalue %arg1[0] : !llvm<"{ i64, i64, i64 }">
+//  CHECK-NEXT:   %16 = llvm.mul %15, %7 : !llvm.i64
+//  CHECK-NEXT:   %17 = llvm.add %3, %16 : !llvm.i64
+//  CHECK-NEXT:   %18 = llvm.insertvalue %17, %14[1] : !llvm<"{ float*, i64, [1 x i64], [1 x i64] }">
+//  CHECK-NEXT:   %19 = llvm.extractvalue %arg1[0] : !llvm<"{ i64, i64, i64 }">
+//  CHECK-NEXT:   %20 = llvm.extractvalue %arg1[1] : !llvm<"{ i64, i64, i64 }">
+//  CHECK-NEXT:   %21 = llvm.sub %20, %19 : !llvm.i64
+//  CHECK-NEXT:   %22 = llvm.insertvalue %21, %18[2, 0] : !llvm<"{ float*, i64, [1 x i64], [1 x i64] }">
+//  CHECK-NEXT:   %23 = llvm.extractvalue %arg1[2] : !llvm<"{ i64, i64, i64 }">
+//  CHECK-NEXT:   %24 = llvm.mul %7, %23 : !llvm.i64
+//  CHECK-NEXT:   %25 = llvm.insertvalue %24, %22[3, 0] : !llvm<"{ float*, i64, [1 x i64], [1 x i64] }">
 
 func @dot(%arg0: !linalg.view<?xf32>, %arg1: !linalg.view<?xf32>, %arg2: !linalg.view<f32>) {
   linalg.dot(%arg0, %arg1, %arg2) : !linalg.view<?xf32>, !linalg.view<?xf32>, !linalg.view<f32>
@@ -200,3 +200,38 @@ func @materialize_write(%M: index, %N: index, %O: index, %P: index) {
   }
   return
 }
+
+// A transfer covering an exactly vector-shaped memref contiguously needs no
+// staging buffer or clipped copy loop: it is a single wide access through a
+// vector view of the memref.
+// CHECK-LABEL: func @materialize_full_contiguous_read
+func @materialize_full_contiguous_read(%A : memref<4x8xf32>) -> vector<4x8xf32> {
+  // CHECK-NOT: alloc
+  //     CHECK: %[[VIEW:.*]] = vector.type_cast %arg0 : memref<4x8xf32>, memref<1xvector<4x8xf32>>
+  //     CHECK: %[[V:.*]] = load %[[VIEW]][%{{.*}}] : memref<1xvector<4x8xf32>>
+  //     CHECK: return %[[V]] : vector<4x8xf32>
+  %c0 = constant 0 : index
+  %v = vector.transfer_read %A[%c0, %c0] {permutation_map = (d0, d1) -> (d0, d1)} : memref<4x8xf32>, vector<4x8xf32>
+  return %v : vector<4x8xf32>
+}
+
+// CHECK-LABEL: func @materialize_full_contiguous_write
+func @materialize_full_contiguous_write(%A : memref<4x8xf32>, %v : vector<4x8xf32>) {
+  // CHECK-NOT: alloc
+  //     CHECK: %[[VIEW:.*]] = vector.type_cast %arg0 : memref<4x8xf32>, memref<1xvector<4x8xf32>>
+  //     CHECK: store %arg1, %[[VIEW]][%{{.*}}] : memref<1xvector<4x8xf32>>
+  //     CHECK: return
+  %c0 = constant 0 : index
+  vector.transfer_write %v, %A[%c0, %c0] {permutation_map = (d0, d1) -> (d0, d1)} : vector<4x8xf32>, memref<4x8xf32>
+  return
+}
+
+// A transposing permutation map must keep the conservative lowering even when
+// the shapes line up.
+// CHECK-LABEL: func @materialize_transposed_read
+func @materialize_transposed_read(%A : memref<8x4xf32>) -> vector<4x8xf32> {
+  //     CHECK: alloc() : memref<4x8xf32>
+  %c0 = constant 0 : index
+  %v = vector.transfer_read %A[%c0, %c0] {permutation_map = (d0, d1) -> (d1, d0)} : memref<8x4xf32>, vector<4x8xf32>
+  return %v : vector<4x8xf32>
+}
@@ -0,0 +1,37 @@
+// RUN: mlir-opt %s -affine-vectorize -virtual-vector-size 128 --test-fastest-varying=0 -vectorize-multi-version-widths=256 -vectorize-multi-version-widths=128 | FileCheck %s
+
+func @mlir_runtime_vector_width() -> index
+
+// The dispatch chain selects the widest supported variant and falls back to
+// the original scalar nest.
+// CHECK-LABEL: func @multi_version_1d
+func @multi_version_1d(%A : memref<?xf32>) {
+// CHECK:      %[[W:.*]] = call @mlir_runtime_vector_width() : () -> index
+// CHECK:      %[[C256:.*]] = constant 256 : index
+// CHECK:      %[[CMP256:.*]] = cmpi "sge", %[[W]], %[[C256]] : index
+// CHECK:      cond_br %[[CMP256]], ^bb[[V256:[0-9]+]], ^bb[[CHECK128:[0-9]+]]
+// CHECK:    ^bb[[V256]]:
+// CHECK:      affine.for %{{.*}} = 0 to %{{.*}} step 256
+// CHECK:        vector.transfer_write {{.*}} : vector<256xf32>
+// CHECK:      br ^bb[[EXIT:[0-9]+]]
+// CHECK:    ^bb[[CHECK128]]:
+// CHECK:      %[[C128:.*]] = constant 128 : index
+// CHECK:      %[[CMP128:.*]] = cmpi "sge", %[[W]], %[[C128]] : index
+// CHECK:      cond_br %[[CMP128]], ^bb[[V128:[0-9]+]], ^bb[[SCALAR:[0-9]+]]
+// CHECK:    ^bb[[V128]]:
+// CHECK:      affine.for %{{.*}} = 0 to %{{.*}} step 128
+// CHECK:        vector.transfer_write {{.*}} : vector<128xf32>
+// CHECK:      br ^bb[[EXIT]]
+// CHECK:    ^bb[[SCALAR]]:
+// CHECK:      affine.for %{{.*}} = 0 to %{{.*}} {
+// CHECK:        store %{{.*}} : memref<?xf32>
+// CHECK:      br ^bb[[EXIT]]
+// CHECK:    ^bb[[EXIT]]:
+// CHECK:      return
+   %M = dim %A, 0 : memref<?xf32>
+   %f1 = constant 1.0 : f32
+   affine.for %i = 0 to %M {
+     store %f1, %A[%i] : memref<?xf32>
+   }
+   return
+}
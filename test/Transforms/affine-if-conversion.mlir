@@ -0,0 +1,96 @@
+// RUN: mlir-opt %s -affine-if-conversion | FileCheck %s
+
+#interior = (d0) : (d0 - 1 >= 0)
+
+// A boundary guard around in-bounds accesses is converted: the condition
+// becomes a cmpi, the body runs unconditionally, and the guarded store writes
+// back the old value when the condition does not hold.
+// CHECK-LABEL: func @guarded_store
+func @guarded_store(%arg0: memref<100xf32>, %arg1: memref<100xf32>) {
+  // CHECK:      affine.for %i0 = 0 to 100 {
+  // CHECK-NEXT:   %c0 = constant 0 : index
+  // CHECK-NEXT:   %0 = affine.apply {{#map[0-9]+}}(%i0)
+  // CHECK-NEXT:   %1 = cmpi "sge", %0, %c0 : index
+  // CHECK-NEXT:   %2 = load %arg0[%i0] : memref<100xf32>
+  // CHECK-NEXT:   %3 = addf %2, %2 : f32
+  // CHECK-NEXT:   %4 = load %arg1[%i0] : memref<100xf32>
+  // CHECK-NEXT:   %5 = select %1, %3, %4 : f32
+  // CHECK-NEXT:   store %5, %arg1[%i0] : memref<100xf32>
+  // CHECK-NEXT: }
+  affine.for %i = 0 to 100 {
+    affine.if #interior(%i) {
+      %0 = load %arg0[%i] : memref<100xf32>
+      %1 = addf %0, %0 : f32
+      store %1, %arg1[%i] : memref<100xf32>
+    }
+  }
+  return
+}
+
+// Both branches are predicated on the same condition with opposite select
+// polarity.
+// CHECK-LABEL: func @guarded_store_else
+func @guarded_store_else(%arg0: memref<100xf32>, %arg1: memref<100xf32>) {
+  // CHECK:      %1 = cmpi "sge", %0, %c0 : index
+  // CHECK-NEXT: %2 = load %arg0[%i0] : memref<100xf32>
+  // CHECK-NEXT: %3 = load %arg1[%i0] : memref<100xf32>
+  // CHECK-NEXT: %4 = select %1, %2, %3 : f32
+  // CHECK-NEXT: store %4, %arg1[%i0] : memref<100xf32>
+  // CHECK-NEXT: %5 = load %arg1[%i0] : memref<100xf32>
+  // CHECK-NEXT: %6 = load %arg0[%i0] : memref<100xf32>
+  // CHECK-NEXT: %7 = select %1, %6, %5 : f32
+  // CHECK-NEXT: store %7, %arg0[%i0] : memref<100xf32>
+  affine.for %i = 0 to 100 {
+    affine.if #interior(%i) {
+      %0 = load %arg0[%i] : memref<100xf32>
+      store %0, %arg1[%i] : memref<100xf32>
+    } else {
+      %1 = load %arg1[%i] : memref<100xf32>
+      store %1, %arg0[%i] : memref<100xf32>
+    }
+  }
+  return
+}
+
+// The guard makes the shifted access legal: speculating the load would read
+// A[-1], so the operation is left untouched.
+// CHECK-LABEL: func @bounds_guard
+func @bounds_guard(%arg0: memref<100xf32>, %arg1: memref<100xf32>) {
+  // CHECK: affine.if
+  affine.for %i = 0 to 100 {
+    affine.if #interior(%i) {
+      %0 = affine.apply (d0) -> (d0 - 1)(%i)
+      %1 = load %arg0[%0] : memref<100xf32>
+      store %1, %arg1[%i] : memref<100xf32>
+    }
+  }
+  return
+}
+
+// Operations with unknown side effects cannot be speculated.
+// CHECK-LABEL: func @side_effects
+func @side_effects() {
+  // CHECK: affine.if
+  affine.for %i = 0 to 100 {
+    affine.if #interior(%i) {
+      "foo"() : () -> ()
+    }
+  }
+  return
+}
+
+// Integer division traps on a zero divisor, and the guard may be exactly what
+// rules one out; the branch cannot be speculated.
+// CHECK-LABEL: func @trapping_division
+func @trapping_division(%arg0: memref<100xi32>, %arg1: memref<100xi32>) {
+  %c42 = constant 42 : i32
+  // CHECK: affine.if
+  affine.for %i = 0 to 100 {
+    affine.if #interior(%i) {
+      %0 = load %arg0[%i] : memref<100xi32>
+      %1 = divis %c42, %0 : i32
+      store %1, %arg1[%i] : memref<100xi32>
+    }
+  }
+  return
+}
@@ -0,0 +1,75 @@
+// RUN: mlir-opt %s -affine-scalrep | FileCheck %s
+
+// The accumulator cell %sum[%c0] is promoted to a loop-carried value: one
+// load before the loop, one store after it, and no memref traffic inside.
+// CHECK-LABEL: func @promote_accumulator
+func @promote_accumulator(%A : memref<128xf32>) -> f32 {
+  %sum = alloc() : memref<1xf32>
+  %c0 = constant 0 : index
+  %cst = constant 0.000000e+00 : f32
+  store %cst, %sum[%c0] : memref<1xf32>
+  // CHECK: %1 = load %0[%c0] : memref<1xf32>
+  // CHECK-NEXT: %2 = affine.for %i0 = 0 to 128 iter_args(%i1 = %1) -> (f32) {
+  // CHECK-NEXT:   %3 = load %arg0[%i0] : memref<128xf32>
+  // CHECK-NEXT:   %4 = addf %i1, %3 : f32
+  // CHECK-NEXT:   "affine.terminator"(%4) : (f32) -> ()
+  // CHECK-NEXT: }
+  // CHECK-NEXT: store %2, %0[%c0] : memref<1xf32>
+  affine.for %i = 0 to 128 {
+    %v = load %A[%i] : memref<128xf32>
+    %acc = load %sum[%c0] : memref<1xf32>
+    %next = addf %acc, %v : f32
+    store %next, %sum[%c0] : memref<1xf32>
+  }
+  %res = load %sum[%c0] : memref<1xf32>
+  return %res : f32
+}
+
+// A cell that is only ever read inside the loop is hoisted without a carried
+// value.
+// CHECK-LABEL: func @hoist_invariant_load
+func @hoist_invariant_load(%A : memref<128xf32>, %scale : memref<1xf32>) {
+  %c0 = constant 0 : index
+  // CHECK: %0 = load %arg1[%c0] : memref<1xf32>
+  // CHECK-NEXT: affine.for %i0 = 0 to 128 {
+  // CHECK-NEXT:   %1 = load %arg0[%i0] : memref<128xf32>
+  // CHECK-NEXT:   %2 = mulf %1, %0 : f32
+  // CHECK-NEXT:   store %2, %arg0[%i0] : memref<128xf32>
+  // CHECK-NEXT: }
+  affine.for %i = 0 to 128 {
+    %v = load %A[%i] : memref<128xf32>
+    %s = load %scale[%c0] : memref<1xf32>
+    %r = mulf %v, %s : f32
+    store %r, %A[%i] : memref<128xf32>
+  }
+  return
+}
+
+// Without a known constant trip count the hoisted load and the sunk store
+// would be speculative; the loop is left alone.
+// CHECK-LABEL: func @no_promotion_unknown_trip_count
+func @no_promotion_unknown_trip_count(%sum : memref<1xf32>, %n : index) {
+  %c0 = constant 0 : index
+  // CHECK-NOT: iter_args
+  affine.for %i = 0 to %n {
+    %v = load %sum[%c0] : memref<1xf32>
+    %next = "compute"(%v) : (f32) -> f32
+    store %next, %sum[%c0] : memref<1xf32>
+  }
+  return
+}
+
+// A use other than a same-element load or store inside the loop may touch the
+// cell; no promotion.
+// CHECK-LABEL: func @no_promotion_escaping_use
+func @no_promotion_escaping_use(%sum : memref<1xf32>) {
+  %c0 = constant 0 : index
+  // CHECK-NOT: iter_args
+  affine.for %i = 0 to 10 {
+    %v = load %sum[%c0] : memref<1xf32>
+    "escape"(%sum) : (memref<1xf32>) -> ()
+    %next = "compute"(%v) : (f32) -> f32
+    store %next, %sum[%c0] : memref<1xf32>
+  }
+  return
+}
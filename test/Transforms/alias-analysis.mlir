@@ -0,0 +1,76 @@
+// RUN: mlir-opt %s -test-alias-analysis -split-input-file -verify-diagnostics
+
+// Distinct allocations are disjoint.
+func @distinct_allocs() {
+  %c0 = constant 0 : index
+  %0 = alloc() : memref<10xf32>
+  %1 = alloc() : memref<10xf32>
+  %2 = load %0[%c0] : memref<10xf32>  // expected-remark {{alias from 0 to 1 = NoAlias}}
+  %3 = load %1[%c0] : memref<10xf32>
+  return
+}
+
+// -----
+
+// A memref_cast forwards the same storage.
+func @cast_chain() {
+  %c0 = constant 0 : index
+  %cst = constant 0.0 : f32
+  %0 = alloc() : memref<10xf32>
+  %1 = memref_cast %0 : memref<10xf32> to memref<?xf32>
+  store %cst, %1[%c0] : memref<?xf32>  // expected-remark {{alias from 0 to 1 = MustAlias}}
+  %2 = load %0[%c0] : memref<10xf32>
+  return
+}
+
+// -----
+
+// Two plain arguments may reference overlapping memory.
+func @arguments(%arg0: memref<10xf32>, %arg1: memref<10xf32>) {
+  %c0 = constant 0 : index
+  %0 = load %arg0[%c0] : memref<10xf32>  // expected-remark {{alias from 0 to 1 = MayAlias}}
+  %1 = load %arg1[%c0] : memref<10xf32>
+  return
+}
+
+// -----
+
+// An argument the frontend annotated 'noalias' is disjoint from every other
+// argument.
+func @noalias_argument(%arg0: memref<10xf32> {noalias = true},
+                       %arg1: memref<10xf32>) {
+  %c0 = constant 0 : index
+  %0 = load %arg0[%c0] : memref<10xf32>  // expected-remark {{alias from 0 to 1 = NoAlias}}
+  %1 = load %arg1[%c0] : memref<10xf32>
+  return
+}
+
+// -----
+
+// An allocation that never escapes cannot be reached through a call result.
+func @opaque() -> memref<10xf32>
+
+func @local_alloc_vs_call() {
+  %c0 = constant 0 : index
+  %0 = alloc() : memref<10xf32>
+  %1 = call @opaque() : () -> memref<10xf32>
+  %2 = load %0[%c0] : memref<10xf32>  // expected-remark {{alias from 0 to 1 = NoAlias}}
+  %3 = load %1[%c0] : memref<10xf32>
+  return
+}
+
+// -----
+
+// Once the allocation is passed to a call, a call result may be it.
+func @keep(memref<10xf32>)
+func @opaque() -> memref<10xf32>
+
+func @escaped_alloc_vs_call() {
+  %c0 = constant 0 : index
+  %0 = alloc() : memref<10xf32>
+  call @keep(%0) : (memref<10xf32>) -> ()
+  %1 = call @opaque() : () -> memref<10xf32>
+  %2 = load %0[%c0] : memref<10xf32>  // expected-remark {{alias from 0 to 1 = MayAlias}}
+  %3 = load %1[%c0] : memref<10xf32>
+  return
+}
@@ -0,0 +1,85 @@
+// RUN: mlir-opt %s -buffer-reuse | FileCheck %s
+
+// The second intermediate is only live after the first one is freed, so both
+// use one buffer and the intermediate dealloc disappears.
+// CHECK-LABEL: func @sequential
+func @sequential(%v : f32) {
+  // CHECK: %[[BUF:.*]] = alloc() : memref<16xf32>
+  // CHECK-NOT: alloc
+  // CHECK: store %{{.*}}, %[[BUF]][%c0] : memref<16xf32>
+  // CHECK-NEXT: store %{{.*}}, %[[BUF]][%c0] : memref<16xf32>
+  // CHECK-NEXT: dealloc %[[BUF]]
+  // CHECK-NOT: dealloc
+  %c0 = constant 0 : index
+  %a = alloc() : memref<16xf32>
+  store %v, %a[%c0] : memref<16xf32>
+  dealloc %a : memref<16xf32>
+  %b = alloc() : memref<16xf32>
+  store %v, %b[%c0] : memref<16xf32>
+  dealloc %b : memref<16xf32>
+  return
+}
+
+// Overlapping live ranges keep separate buffers.
+// CHECK-LABEL: func @overlapping
+func @overlapping(%v : f32) {
+  // CHECK: alloc() : memref<16xf32>
+  // CHECK: alloc() : memref<16xf32>
+  %c0 = constant 0 : index
+  %a = alloc() : memref<16xf32>
+  %b = alloc() : memref<16xf32>
+  store %v, %a[%c0] : memref<16xf32>
+  store %v, %b[%c0] : memref<16xf32>
+  dealloc %a : memref<16xf32>
+  dealloc %b : memref<16xf32>
+  return
+}
+
+// Different types never share storage.
+// CHECK-LABEL: func @mixed_types
+func @mixed_types(%v : f32) {
+  // CHECK: alloc() : memref<16xf32>
+  // CHECK: alloc() : memref<32xf32>
+  %c0 = constant 0 : index
+  %a = alloc() : memref<16xf32>
+  store %v, %a[%c0] : memref<16xf32>
+  dealloc %a : memref<16xf32>
+  %b = alloc() : memref<32xf32>
+  store %v, %b[%c0] : memref<32xf32>
+  dealloc %b : memref<32xf32>
+  return
+}
+
+func @escape(memref<16xf32>)
+
+// A buffer passed to a call escapes and must keep its own allocation.
+// CHECK-LABEL: func @escaping
+func @escaping(%v : f32) {
+  // CHECK: alloc() : memref<16xf32>
+  // CHECK: alloc() : memref<16xf32>
+  %a = alloc() : memref<16xf32>
+  call @escape(%a) : (memref<16xf32>) -> ()
+  dealloc %a : memref<16xf32>
+  %b = alloc() : memref<16xf32>
+  call @escape(%b) : (memref<16xf32>) -> ()
+  dealloc %b : memref<16xf32>
+  return
+}
+
+// A use inside a nested loop body extends the range to the loop.
+// CHECK-LABEL: func @nested_use
+func @nested_use(%v : f32) {
+  // CHECK: %[[BUF:.*]] = alloc() : memref<16xf32>
+  // CHECK-NOT: alloc
+  %a = alloc() : memref<16xf32>
+  affine.for %i = 0 to 16 {
+    store %v, %a[%i] : memref<16xf32>
+  }
+  dealloc %a : memref<16xf32>
+  %b = alloc() : memref<16xf32>
+  affine.for %i = 0 to 16 {
+    store %v, %b[%i] : memref<16xf32>
+  }
+  dealloc %b : memref<16xf32>
+  return
+}
@@ -77,6 +77,34 @@ func @addi_splat_vector() -> vector<8xi32> {
 
 // -----
 
+// CHECK-LABEL: func @addf_dense_tensor
+func @addf_dense_tensor() -> tensor<4xf32> {
+  %0 = constant dense<[1.5, 2.5, 3.5, 4.5]> : tensor<4xf32>
+  %1 = constant dense<[1.5, 1.5, 2.5, 2.5]> : tensor<4xf32>
+
+  // CHECK-NEXT: %cst = constant dense<[3.000000e+00, 4.000000e+00, 6.000000e+00, 7.000000e+00]> : tensor<4xf32>
+  %2 = addf %0, %1 : tensor<4xf32>
+
+  // CHECK-NEXT: return %cst
+  return %2 : tensor<4xf32>
+}
+
+// -----
+
+// CHECK-LABEL: func @addi_dense_vector
+func @addi_dense_vector() -> vector<4xi32> {
+  %0 = constant dense<[1, 2, 3, 4]> : vector<4xi32>
+  %1 = constant dense<[5, 6, 7, -8]> : vector<4xi32>
+
+  // CHECK-NEXT: %cst = constant dense<[6, 8, 10, -4]> : vector<4xi32>
+  %2 = addi %0, %1 : vector<4xi32>
+
+  // CHECK-NEXT: return %cst
+  return %2 : vector<4xi32>
+}
+
+// -----
+
 // CHECK-LABEL: func @simple_subf
 func @simple_subf() -> f32 {
   %0 = constant 4.5 : f32
@@ -0,0 +1,39 @@
+// RUN: mlir-opt %s -constant-pooling | FileCheck %s
+
+// CHECK-LABEL: func @pool_duplicates
+func @pool_duplicates() -> (tensor<4xf32>, tensor<4xf32>) {
+  // The duplicate is forwarded to a single copy hoisted to the entry block.
+  // CHECK:      %[[CST:.*]] = constant dense<1.000000e+00> : tensor<4xf32>
+  // CHECK-NOT:  constant dense<1.000000e+00>
+  // CHECK:      return %[[CST]], %[[CST]]
+  %0 = constant dense<1.0> : tensor<4xf32>
+  %1 = constant dense<1.0> : tensor<4xf32>
+  return %0, %1 : tensor<4xf32>, tensor<4xf32>
+}
+
+// CHECK-LABEL: func @pool_across_blocks
+func @pool_across_blocks(%cond: i1) -> tensor<2xi32> {
+  // CHECK:      %[[CST:.*]] = constant dense<7> : tensor<2xi32>
+  // CHECK-NOT:  constant dense<7>
+  cond_br %cond, ^bb1, ^bb2
+^bb1:
+  %0 = constant dense<7> : tensor<2xi32>
+  // CHECK: return %[[CST]]
+  return %0 : tensor<2xi32>
+^bb2:
+  %1 = constant dense<7> : tensor<2xi32>
+  // CHECK: return %[[CST]]
+  return %1 : tensor<2xi32>
+}
+
+// CHECK-LABEL: func @distinct_values_kept
+func @distinct_values_kept() -> (tensor<2xf32>, tensor<2xf32>, index) {
+  // Different values and scalar constants are left alone.
+  // CHECK: constant dense<1.000000e+00>
+  // CHECK: constant dense<2.000000e+00>
+  // CHECK: constant 42
+  %0 = constant dense<1.0> : tensor<2xf32>
+  %1 = constant dense<2.0> : tensor<2xf32>
+  %2 = constant 42 : index
+  return %0, %1, %2 : tensor<2xf32>, tensor<2xf32>, index
+}
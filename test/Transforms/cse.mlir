@@ -244,3 +244,14 @@ func @nested_isolated() -> i32 {
 
   return %0 : i32
 }
+
+/// Check that commutative operations are matched regardless of operand order.
+// CHECK-LABEL: @commutative_operands
+func @commutative_operands(%a : f32, %b : f32) -> (f32, f32) {
+  // CHECK-NEXT: %0 = addf %arg0, %arg1 : f32
+  %0 = addf %a, %b : f32
+  %1 = addf %b, %a : f32
+
+  // CHECK-NEXT: return %0, %0 : f32, f32
+  return %0, %1 : f32, f32
+}
@@ -0,0 +1,73 @@
+// RUN: mlir-opt %s -inline | FileCheck %s
+// RUN: mlir-opt %s -inline -inline-max-callee-size=1 | FileCheck %s --check-prefix=BUDGET
+
+// CHECK-LABEL: func @add_one
+func @add_one(%arg0 : f32) -> f32 {
+  %c = constant 1.0 : f32
+  %r = addf %arg0, %c : f32
+  return %r : f32
+}
+
+// CHECK-LABEL: func @caller
+// BUDGET-LABEL: func @caller
+func @caller(%arg0 : f32) -> f32 {
+  // CHECK-NOT: call
+  // CHECK: %[[C:.*]] = constant 1.0
+  // CHECK: %[[R:.*]] = addf %arg0, %[[C]]
+  // CHECK: return %[[R]]
+  //
+  // The callee is over the shrunken budget and must stay a call.
+  // BUDGET: call @add_one
+  %0 = call @add_one(%arg0) : (f32) -> f32
+  return %0 : f32
+}
+
+// The callers of @twice see the size it grew to, but it stays well within
+// the default budget, so @transitive ends up fully flat.
+// CHECK-LABEL: func @transitive
+func @transitive(%arg0 : f32) -> f32 {
+  // CHECK-NOT: call
+  // CHECK: addf
+  // CHECK: addf
+  // CHECK: return
+  %0 = call @twice(%arg0) : (f32) -> f32
+  return %0 : f32
+}
+
+func @twice(%arg0 : f32) -> f32 {
+  %0 = call @add_one(%arg0) : (f32) -> f32
+  %1 = call @add_one(%0) : (f32) -> f32
+  return %1 : f32
+}
+
+// Self-recursion forms a single-function component and is left alone.
+// CHECK-LABEL: func @recursive
+func @recursive(%arg0 : f32) -> f32 {
+  // CHECK: call @recursive
+  %0 = call @recursive(%arg0) : (f32) -> f32
+  return %0 : f32
+}
+
+// Mutually recursive functions share a component; neither absorbs the other.
+// CHECK-LABEL: func @ping
+func @ping(%arg0 : f32) -> f32 {
+  // CHECK: call @pong
+  %0 = call @pong(%arg0) : (f32) -> f32
+  return %0 : f32
+}
+
+// CHECK-LABEL: func @pong
+func @pong(%arg0 : f32) -> f32 {
+  // CHECK: call @ping
+  %0 = call @ping(%arg0) : (f32) -> f32
+  return %0 : f32
+}
+
+func @external(f32) -> f32
+
+// CHECK-LABEL: func @calls_external
+func @calls_external(%arg0 : f32) -> f32 {
+  // CHECK: call @external
+  %0 = call @external(%arg0) : (f32) -> f32
+  return %0 : f32
+}
@@ -0,0 +1,70 @@
+// RUN: mlir-opt %s -affine-loop-interchange | FileCheck %s
+
+// A column-major traversal is permuted into a row-major one.
+// CHECK-LABEL: func @interchange_to_stride_one
+func @interchange_to_stride_one(%arg0: memref<100x200xf32>) {
+  // CHECK:      affine.for %i0 = 0 to 100 {
+  // CHECK-NEXT:   affine.for %i1 = 0 to 200 {
+  // CHECK-NEXT:     %0 = load %arg0[%i0, %i1] : memref<100x200xf32>
+  affine.for %i = 0 to 200 {
+    affine.for %j = 0 to 100 {
+      %v = load %arg0[%j, %i] : memref<100x200xf32>
+    }
+  }
+  return
+}
+
+// A nest that already accesses memory stride-1 innermost is left unchanged.
+// CHECK-LABEL: func @already_optimal
+func @already_optimal(%arg0: memref<100x200xf32>) {
+  // CHECK:      affine.for %i0 = 0 to 100 {
+  // CHECK-NEXT:   affine.for %i1 = 0 to 200 {
+  // CHECK-NEXT:     %0 = load %arg0[%i0, %i1] : memref<100x200xf32>
+  affine.for %i = 0 to 100 {
+    affine.for %j = 0 to 200 {
+      %v = load %arg0[%i, %j] : memref<100x200xf32>
+    }
+  }
+  return
+}
+
+// The profitable interchange would flip the (1, -1) dependence between the
+// store and the load to (-1, 1); the nest must be left unchanged.
+// CHECK-LABEL: func @illegal_interchange
+func @illegal_interchange(%arg0: memref<100x100xf32>) {
+  // CHECK:      affine.for %i0 = 1 to 100 {
+  // CHECK-NEXT:   affine.for %i1 = 0 to 99 {
+  affine.for %i = 1 to 100 {
+    affine.for %j = 0 to 99 {
+      %0 = affine.apply (d0) -> (d0 + 1)(%j)
+      %1 = affine.apply (d0) -> (d0 - 1)(%i)
+      %v = load %arg0[%0, %1] : memref<100x100xf32>
+      store %v, %arg0[%j, %i] : memref<100x100xf32>
+    }
+  }
+  return
+}
+
+// A (j, k, i) matmul nest is permuted into the cache-friendly (i, k, j) order.
+// CHECK-LABEL: func @matmul
+func @matmul(%arg0: memref<100x100xf32>, %arg1: memref<100x100xf32>, %arg2: memref<100x100xf32>) {
+  // CHECK:      affine.for %i0 = 0 to 100 {
+  // CHECK-NEXT:   affine.for %i1 = 0 to 100 {
+  // CHECK-NEXT:     affine.for %i2 = 0 to 100 {
+  // CHECK-NEXT:       %0 = load %arg0[%i0, %i1] : memref<100x100xf32>
+  // CHECK-NEXT:       %1 = load %arg1[%i1, %i2] : memref<100x100xf32>
+  // CHECK-NEXT:       %2 = load %arg2[%i0, %i2] : memref<100x100xf32>
+  affine.for %j = 0 to 100 {
+    affine.for %k = 0 to 100 {
+      affine.for %i = 0 to 100 {
+        %a = load %arg0[%i, %k] : memref<100x100xf32>
+        %b = load %arg1[%k, %j] : memref<100x100xf32>
+        %c = load %arg2[%i, %j] : memref<100x100xf32>
+        %p = mulf %a, %b : f32
+        %s = addf %c, %p : f32
+        store %s, %arg2[%i, %j] : memref<100x100xf32>
+      }
+    }
+  }
+  return
+}
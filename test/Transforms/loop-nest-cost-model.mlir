@@ -0,0 +1,55 @@
+// RUN: mlir-opt %s -test-loop-nest-cost-model -verify-diagnostics
+
+// Two unit-stride streams of 64 f32's: 256 distinct bytes each, four 64-byte
+// lines each at every level, and one page each.
+func @copy(%A: memref<64xf32>, %B: memref<64xf32>) {
+  // expected-remark@+1 {{footprint = 512 bytes, cache lines accessed = [8, 8, 8], tlb pages accessed = 2}}
+  affine.for %i = 0 to 64 {
+    %0 = load %A[%i] : memref<64xf32>
+    store %0, %B[%i] : memref<64xf32>
+  }
+  return
+}
+
+// Each of the four accesses sweeps its whole 1 KiB matrix: everything fits in
+// L1, so every loop-carried reuse is realized and each access fetches its 16
+// lines once per invariant-loop iteration at most.
+func @matmul(%A: memref<16x16xf32>, %B: memref<16x16xf32>,
+             %C: memref<16x16xf32>) {
+  // expected-remark@+1 {{footprint = 4096 bytes, cache lines accessed = [64, 64, 64], tlb pages accessed = 4}}
+  affine.for %i = 0 to 16 {
+    affine.for %j = 0 to 16 {
+      affine.for %k = 0 to 16 {
+        %a = load %A[%i, %k] : memref<16x16xf32>
+        %b = load %B[%k, %j] : memref<16x16xf32>
+        %c = load %C[%i, %j] : memref<16x16xf32>
+        %p = mulf %a, %b : f32
+        %s = addf %c, %p : f32
+        store %s, %C[%i, %j] : memref<16x16xf32>
+      }
+    }
+  }
+  return
+}
+
+// The 64 KiB vector overflows the 32 KiB L1, so the outer loop re-fetches all
+// 1024 lines on each of its 128 iterations; in L2 and L3 (and the TLB) the
+// reuse is realized and one sweep's worth suffices.
+func @l1_capacity(%A: memref<16384xf32>) {
+  // expected-remark@+1 {{footprint = 65536 bytes, cache lines accessed = [131072, 1024, 1024], tlb pages accessed = 16}}
+  affine.for %i = 0 to 128 {
+    affine.for %j = 0 to 16384 {
+      %0 = load %A[%j] : memref<16384xf32>
+    }
+  }
+  return
+}
+
+// A dynamically shaped memref has no static stride profile.
+func @dynamic(%A: memref<?xf32>) {
+  // expected-remark@+1 {{unable to analyze loop nest}}
+  affine.for %i = 0 to 64 {
+    %0 = load %A[%i] : memref<?xf32>
+  }
+  return
+}
@@ -0,0 +1,70 @@
+// RUN: mlir-opt %s -affine-loop-skew | FileCheck %s
+// RUN: mlir-opt %s -affine-loop-skew -test-detect-parallel -verify-diagnostics
+
+// CHECK-DAG: [[JMAP:#map[0-9]+]] = (d0, d1) -> (d0 - d1)
+// CHECK-DAG: [[GSLB:#map[0-9]+]] = (d0) -> (1, d0 - 99)
+// CHECK-DAG: [[GSUB:#map[0-9]+]] = (d0) -> (100, d0)
+
+// A Gauss-Seidel style update carries dependences (1, 0) and (0, 1); a skew
+// factor of one suffices and the inner loop of the wavefront is parallel.
+// CHECK-LABEL: func @gauss_seidel
+func @gauss_seidel(%arg0: memref<100x100xf32>) {
+  // CHECK:      affine.for %i0 = 2 to 199 {
+  // CHECK-NEXT:   affine.for %i1 = max [[GSLB]](%i0) to min [[GSUB]](%i0) {
+  // CHECK-NEXT:     %0 = affine.apply [[JMAP]](%i0, %i1)
+  affine.for %i = 1 to 100 {
+    // expected-remark@-1 {{parallel loop}}
+    affine.for %j = 1 to 100 {
+      %0 = affine.apply (d0) -> (d0 - 1)(%i)
+      %v0 = load %arg0[%0, %j] : memref<100x100xf32>
+      %1 = affine.apply (d0) -> (d0 - 1)(%j)
+      %v1 = load %arg0[%i, %1] : memref<100x100xf32>
+      %s = addf %v0, %v1 : f32
+      store %s, %arg0[%i, %j] : memref<100x100xf32>
+    }
+  }
+  return
+}
+
+// All dependences are carried by the outer loop, so the inner loop is already
+// parallel and the nest is left unchanged.
+// CHECK-LABEL: func @inner_already_parallel
+func @inner_already_parallel(%arg0: memref<100x100xf32>) {
+  // CHECK:      affine.for %i0 = 1 to 100 {
+  // CHECK-NEXT:   affine.for %i1 = 0 to 100 {
+  // CHECK-NOT:  max
+  affine.for %i = 1 to 100 {
+    affine.for %j = 0 to 100 {
+      // expected-remark@-1 {{parallel loop}}
+      %0 = affine.apply (d0) -> (d0 - 1)(%i)
+      %v = load %arg0[%0, %j] : memref<100x100xf32>
+      store %v, %arg0[%i, %j] : memref<100x100xf32>
+    }
+  }
+  return
+}
+
+// CHECK-DAG: [[SFLB:#map[0-9]+]] = (d0) -> (1, (d0 - 97) ceildiv 3)
+// CHECK-DAG: [[SFUB:#map[0-9]+]] = (d0) -> (9, (d0 - 1) floordiv 3 + 1)
+
+// The (1, -2) dependence forces a skew factor of three to keep the wavefront
+// components positive.
+// CHECK-LABEL: func @skew_factor_three
+func @skew_factor_three(%arg0: memref<100x100xf32>) {
+  // CHECK:      affine.for %i0 = 4 to 122 {
+  // CHECK-NEXT:   affine.for %i1 = max [[SFLB]](%i0) to min [[SFUB]](%i0) {
+  // CHECK-NEXT:     %0 = affine.apply [[JMAP]](%i0, %i1)
+  affine.for %i = 1 to 9 {
+    // expected-remark@-1 {{parallel loop}}
+    affine.for %j = 1 to 98 {
+      %0 = affine.apply (d0) -> (d0 - 1)(%i)
+      %1 = affine.apply (d0) -> (d0 + 2)(%j)
+      %v0 = load %arg0[%0, %1] : memref<100x100xf32>
+      %2 = affine.apply (d0) -> (d0 - 1)(%j)
+      %v1 = load %arg0[%i, %2] : memref<100x100xf32>
+      %s = addf %v0, %v1 : f32
+      store %s, %arg0[%i, %j] : memref<100x100xf32>
+    }
+  }
+  return
+}
@@ -637,3 +637,54 @@ func @affine_apply_ceildiv(%arg0 : index) -> (index) {
   %0 = affine.apply #mapceildiv (%arg0)
   return %0 : index
 }
+
+#lbsharedmap = (d0) -> (d0 * 4, d0 * 4 + 2)
+
+// Check that a subexpression common to several results of a bound map is
+// materialized only once: the max reduction compares the muli value itself
+// against the addi built on top of it.
+// CHECK-LABEL: func @expansion_shares_subexpressions
+func @expansion_shares_subexpressions() {
+// CHECK:        %[[shared:[0-9]+]] = muli %{{[0-9]+}}, %c4 : index
+// CHECK-NEXT:   %c2 = constant 2 : index
+// CHECK-NEXT:   %[[second:[0-9]+]] = addi %[[shared]], %c2 : index
+// CHECK-NEXT:   %[[cmp:[0-9]+]] = cmpi "sgt", %[[shared]], %[[second]] : index
+// CHECK-NEXT:   %{{[0-9]+}} = select %[[cmp]], %[[shared]], %[[second]] : index
+  affine.for %i = 0 to 42 {
+    affine.for %j = max #lbsharedmap(%i) to 100 {
+      call @body(%j) : (index) -> ()
+    }
+  }
+  return
+}
+
+/////////////////////////////////////////////////////////////////////
+
+func @reduce(index, f32) -> f32
+
+// Loop-carried values become condition block arguments: the entry branch
+// passes the initial value, the latch branch passes the terminator operand,
+// and the loop result is the value the argument holds when the condition
+// fails.
+// CHECK-LABEL: func @loop_carried
+// CHECK-NEXT:   %c0 = constant 0 : index
+// CHECK-NEXT:   %c42 = constant 42 : index
+// CHECK-NEXT:   br ^bb1(%c0, %arg0 : index, f32)
+// CHECK-NEXT: ^bb1(%0: index, %1: f32):	// 2 preds: ^bb0, ^bb2
+// CHECK-NEXT:   %2 = cmpi "slt", %0, %c42 : index
+// CHECK-NEXT:   cond_br %2, ^bb2, ^bb3
+// CHECK-NEXT: ^bb2:	// pred: ^bb1
+// CHECK-NEXT:   %3 = call @reduce(%0, %1) : (index, f32) -> f32
+// CHECK-NEXT:   %c1 = constant 1 : index
+// CHECK-NEXT:   %4 = addi %0, %c1 : index
+// CHECK-NEXT:   br ^bb1(%4, %3 : index, f32)
+// CHECK-NEXT: ^bb3:	// pred: ^bb1
+// CHECK-NEXT:   return %1 : f32
+// CHECK-NEXT: }
+func @loop_carried(%init : f32) -> f32 {
+  %res = affine.for %i = 0 to 42 iter_args(%acc = %init) -> (f32) {
+    %next = call @reduce(%i, %acc) : (index, f32) -> f32
+    "affine.terminator"(%next) : (f32) -> ()
+  }
+  return %res : f32
+}
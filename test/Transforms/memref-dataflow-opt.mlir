@@ -247,3 +247,24 @@ func @store_load_store_nested_fwd(%N : index) -> f32 {
 // CHECK-NEXT:  %3 = load %0[%c1] : memref<10xf32>
 // CHECK-NEXT:  return %3 : f32
 }
+
+// Forwarding sees through memref_cast: the store writes through a cast of the
+// memref the load reads from.
+// CHECK-LABEL: func @store_load_through_cast() {
+func @store_load_through_cast() {
+  %cf7 = constant 7.0 : f32
+  %m = alloc() : memref<10xf32>
+  %c = memref_cast %m : memref<10xf32> to memref<?xf32>
+  affine.for %i0 = 0 to 10 {
+    store %cf7, %c[%i0] : memref<?xf32>
+    %v0 = load %m[%i0] : memref<10xf32>
+    %v1 = addf %v0, %v0 : f32
+  }
+  return
+// CHECK:       %1 = memref_cast %0 : memref<10xf32> to memref<?xf32>
+// CHECK-NEXT:  affine.for %i0 = 0 to 10 {
+// CHECK-NEXT:    store %cst, %1[%i0] : memref<?xf32>
+// CHECK-NEXT:    %2 = addf %cst, %cst : f32
+// CHECK-NEXT:  }
+// CHECK-NEXT:  return
+}
@@ -0,0 +1,57 @@
+// RUN: mlir-opt %s -memref-layout-opt | FileCheck %s
+
+// CHECK-DAG: [[MAP_D1:#map[0-9]+]] = (d0, d1) -> (d1)
+// CHECK-DAG: [[MAP_D0:#map[0-9]+]] = (d0, d1) -> (d0)
+
+// The buffer is accessed column-major in the inner loop, so its dimensions
+// get swapped and the accesses remapped through the permutation.
+// CHECK-LABEL: func @transpose_layout
+func @transpose_layout() {
+  %A = alloc() : memref<64x128xf32>
+  // CHECK: %0 = alloc() : memref<128x64xf32>
+  affine.for %i = 0 to 128 {
+    affine.for %j = 0 to 64 {
+      // CHECK: %1 = affine.apply [[MAP_D1]](%i1, %i0)
+      // CHECK: %2 = affine.apply [[MAP_D0]](%i1, %i0)
+      // CHECK: load %0[%1, %2] : memref<128x64xf32>
+      %v = load %A[%j, %i] : memref<64x128xf32>
+      "use"(%v) : (f32) -> ()
+    }
+  }
+  // CHECK: dealloc %0 : memref<128x64xf32>
+  dealloc %A : memref<64x128xf32>
+  return
+}
+
+// Rows of 1024 floats sit exactly 4K apart and alias in the cache; the
+// innermost dimension is padded by a cache line. The layout is already
+// stride-1, so the access indices are unchanged.
+// CHECK-LABEL: func @pad_conflicting_rows
+func @pad_conflicting_rows() {
+  %A = alloc() : memref<32x1024xf32>
+  // CHECK: %0 = alloc() : memref<32x1040xf32>
+  affine.for %i = 0 to 32 {
+    affine.for %j = 0 to 1024 {
+      // CHECK: load %0[%i0, %i1] : memref<32x1040xf32>
+      %v = load %A[%i, %j] : memref<32x1024xf32>
+      "use"(%v) : (f32) -> ()
+    }
+  }
+  dealloc %A : memref<32x1024xf32>
+  return
+}
+
+// A use other than load/store/dealloc pins the layout.
+// CHECK-LABEL: func @escaping_use
+func @escaping_use() {
+  %A = alloc() : memref<64x128xf32>
+  // CHECK: %0 = alloc() : memref<64x128xf32>
+  affine.for %i = 0 to 128 {
+    affine.for %j = 0 to 64 {
+      %v = load %A[%j, %i] : memref<64x128xf32>
+      "use"(%v) : (f32) -> ()
+    }
+  }
+  "escape"(%A) : (memref<64x128xf32>) -> ()
+  return
+}
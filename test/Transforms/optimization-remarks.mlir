@@ -0,0 +1,15 @@
+// RUN: mlir-opt %s -affine-loop-tile -tile-size=32 -mlir-remarks -verify-diagnostics
+
+// Check that transformation passes report their decisions through the
+// optimization remark stream when -mlir-remarks is set.
+func @tile_remark() {
+  %0 = alloc() : memref<256x512xf32>
+  // expected-remark@+1 {{[affine-loop-tile] tile: tiled band of depth 2 with tile sizes [32, 32]}}
+  affine.for %i = 0 to 256 {
+    affine.for %j = 0 to 512 {
+      %v = load %0[%i, %j] : memref<256x512xf32>
+      store %v, %0[%i, %j] : memref<256x512xf32>
+    }
+  }
+  return
+}
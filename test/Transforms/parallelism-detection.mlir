@@ -21,3 +21,32 @@ func @loop_nest_3d_outer_two_parallel(%N : index) {
   }
   return
 }
+
+// -----
+
+// A loop whose only cross-iteration dependence is an additive update of a
+// loop-carried value is parallel modulo the reduction.
+// CHECK-LABEL: func @loop_carried_reduction
+func @loop_carried_reduction(%in : memref<1024xf32>, %init : f32) -> f32 {
+  %res = affine.for %i = 0 to 1024 iter_args(%acc = %init) -> (f32) {
+    // expected-remark@-1 {{parallel loop with reduction}}
+    %0 = load %in[%i] : memref<1024xf32>
+    %1 = addf %acc, %0 : f32
+    "affine.terminator"(%1) : (f32) -> ()
+  }
+  return %res : f32
+}
+
+// -----
+
+// A loop-carried value updated by an unrecognized operation keeps the loop
+// sequential: no remark is emitted.
+// CHECK-LABEL: func @loop_carried_not_reduction
+func @loop_carried_not_reduction(%in : memref<1024xf32>, %init : f32) -> f32 {
+  %res = affine.for %i = 0 to 1024 iter_args(%acc = %init) -> (f32) {
+    %0 = load %in[%i] : memref<1024xf32>
+    %1 = "foo"(%acc, %0) : (f32, f32) -> f32
+    "affine.terminator"(%1) : (f32) -> ()
+  }
+  return %res : f32
+}
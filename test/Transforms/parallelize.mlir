@@ -0,0 +1,128 @@
+// RUN: mlir-opt %s -affine-parallelize | FileCheck %s
+
+// An elementwise loop is parallel: it is outlined into a body function and
+// replaced by a dispatch carrying the bounds and the captured memrefs.
+// CHECK-LABEL: func @axpy
+func @axpy(%arg0: memref<1024xf32>, %arg1: memref<1024xf32>) {
+  // CHECK-NOT: affine.for
+  // CHECK: parallel_call @axpy_parallel_body0(%c0, %c1024, %arg0, %arg1) : (index, index, memref<1024xf32>, memref<1024xf32>) -> ()
+  affine.for %i = 0 to 1024 {
+    %0 = load %arg0[%i] : memref<1024xf32>
+    %1 = load %arg1[%i] : memref<1024xf32>
+    %2 = addf %0, %1 : f32
+    store %2, %arg1[%i] : memref<1024xf32>
+  }
+  return
+}
+
+// Every iteration updates the same location, so the loop is not parallel and
+// must stay sequential.
+// CHECK-LABEL: func @reduction
+func @reduction(%arg0: memref<1024xf32>, %arg1: memref<1xf32>) {
+  // CHECK: affine.for
+  // CHECK-NOT: parallel_call
+  %c0 = constant 0 : index
+  affine.for %i = 0 to 1024 {
+    %0 = load %arg0[%i] : memref<1024xf32>
+    %1 = load %arg1[%c0] : memref<1xf32>
+    %2 = addf %0, %1 : f32
+    store %2, %arg1[%c0] : memref<1xf32>
+  }
+  return
+}
+
+// The loop is parallel but captures a float scalar, which does not fit the
+// word-sized runtime ABI; it is left untouched.
+// CHECK-LABEL: func @scalar_capture
+func @scalar_capture(%arg0: memref<1024xf32>, %arg1: f32) {
+  // CHECK: affine.for
+  // CHECK-NOT: parallel_call
+  affine.for %i = 0 to 1024 {
+    store %arg1, %arg0[%i] : memref<1024xf32>
+  }
+  return
+}
+
+// Only the outermost parallel loop is dispatched; the inner loop runs
+// sequentially inside the outlined body.
+// CHECK-LABEL: func @nest
+func @nest(%arg0: memref<64x64xf32>) {
+  // CHECK: parallel_call @nest_parallel_body0(%c0, %c64, %arg0) : (index, index, memref<64x64xf32>) -> ()
+  affine.for %i = 0 to 64 {
+    affine.for %j = 0 to 64 {
+      %0 = load %arg0[%i, %j] : memref<64x64xf32>
+      %1 = mulf %0, %0 : f32
+      store %1, %arg0[%i, %j] : memref<64x64xf32>
+    }
+  }
+  return
+}
+
+// A symbolic trip count is materialized with affine.apply at the call site;
+// the bound operand is not a body capture.
+// CHECK-LABEL: func @dynamic
+func @dynamic(%arg0: memref<1024xf32>, %arg1: index) {
+  // CHECK: %0 = affine.apply {{#map[0-9]+}}()[%arg1]
+  // CHECK: parallel_call @dynamic_parallel_body0(%c0, %0, %arg0) : (index, index, memref<1024xf32>) -> ()
+  affine.for %i = 0 to %arg1 {
+    %0 = load %arg0[%i] : memref<1024xf32>
+    %1 = addf %0, %0 : f32
+    store %1, %arg0[%i] : memref<1024xf32>
+  }
+  return
+}
+
+// A sum carried through iter_args is dispatched as a reduction: the initial
+// value is seeded into a single-element cell, each chunk merges its private
+// partial into the cell inside the outlined body, and the final value is read
+// back after the dispatch.
+// CHECK-LABEL: func @sum
+func @sum(%arg0: memref<1024xf32>, %arg1: f32) -> f32 {
+  // CHECK-NOT: affine.for
+  // CHECK: %0 = alloc() : memref<1xf32>
+  // CHECK-NEXT: store %arg1, %0[%c0_0] : memref<1xf32>
+  // CHECK-NEXT: parallel_call @sum_parallel_body0(%c0, %c1024, %0, %arg0) : (index, index, memref<1xf32>, memref<1024xf32>) -> ()
+  // CHECK-NEXT: %1 = load %0[%c0_0] : memref<1xf32>
+  // CHECK-NEXT: dealloc %0 : memref<1xf32>
+  // CHECK-NEXT: return %1 : f32
+  %res = affine.for %i = 0 to 1024 iter_args(%acc = %arg1) -> (f32) {
+    %0 = load %arg0[%i] : memref<1024xf32>
+    %1 = addf %acc, %0 : f32
+    "affine.terminator"(%1) : (f32) -> ()
+  }
+  return %res : f32
+}
+
+// CHECK-LABEL: func @axpy_parallel_body0(%arg0: index, %arg1: index, %arg2: memref<1024xf32>, %arg3: memref<1024xf32>)
+// CHECK-NEXT:    affine.for %i0 = %arg0 to %arg1 {
+// CHECK-NEXT:      %0 = load %arg2[%i0] : memref<1024xf32>
+// CHECK-NEXT:      %1 = load %arg3[%i0] : memref<1024xf32>
+// CHECK-NEXT:      %2 = addf %0, %1 : f32
+// CHECK-NEXT:      store %2, %arg3[%i0] : memref<1024xf32>
+// CHECK-NEXT:    }
+// CHECK-NEXT:    return
+
+// CHECK-LABEL: func @nest_parallel_body0(%arg0: index, %arg1: index, %arg2: memref<64x64xf32>)
+// CHECK-NEXT:    affine.for %i0 = %arg0 to %arg1 {
+// CHECK-NEXT:      affine.for %i1 = 0 to 64 {
+
+// CHECK-LABEL: func @dynamic_parallel_body0(%arg0: index, %arg1: index, %arg2: memref<1024xf32>)
+// CHECK-NEXT:    affine.for %i0 = %arg0 to %arg1 {
+
+// CHECK-LABEL: func @sum_parallel_body0(%arg0: index, %arg1: index, %arg2: memref<1xf32>, %arg3: memref<1024xf32>)
+// CHECK-NEXT:    %cst = constant 0.000000e+00 : f32
+// CHECK-NEXT:    %0 = affine.for %i0 = %arg0 to %arg1 iter_args(%i1 = %cst) -> (f32) {
+// CHECK-NEXT:      %1 = load %arg3[%i0] : memref<1024xf32>
+// CHECK-NEXT:      %2 = addf %i1, %1 : f32
+// CHECK-NEXT:      "affine.terminator"(%2) : (f32) -> ()
+// CHECK-NEXT:    }
+// CHECK-NEXT:    %c0 = constant 0 : index
+// CHECK-NEXT:    call @mlir_parallel_critical_begin() : () -> ()
+// CHECK-NEXT:    %3 = load %arg2[%c0] : memref<1xf32>
+// CHECK-NEXT:    %4 = addf %3, %0 : f32
+// CHECK-NEXT:    store %4, %arg2[%c0] : memref<1xf32>
+// CHECK-NEXT:    call @mlir_parallel_critical_end() : () -> ()
+// CHECK-NEXT:    return
+
+// CHECK: func @mlir_parallel_critical_begin()
+// CHECK: func @mlir_parallel_critical_end()
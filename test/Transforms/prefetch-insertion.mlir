@@ -0,0 +1,65 @@
+// RUN: mlir-opt %s -affine-prefetch | FileCheck %s
+
+// CHECK-DAG: [[MAP:#map[0-9]+]] = (d0) -> (d0 + 4)
+
+// CHECK-LABEL: func @streaming_load
+func @streaming_load(%arg0: memref<10000xf32>) {
+  // CHECK:      affine.for %i0 = 0 to 10000 {
+  // CHECK-NEXT:   %0 = affine.apply [[MAP]](%i0)
+  // CHECK-NEXT:   prefetch %arg0[%0] {isWrite = false, localityHint = 0 : i32} : memref<10000xf32>
+  // CHECK-NEXT:   %1 = load %arg0[%i0] : memref<10000xf32>
+  affine.for %i = 0 to 10000 {
+    %v = load %arg0[%i] : memref<10000xf32>
+  }
+  return
+}
+
+// CHECK-LABEL: func @streaming_store
+func @streaming_store(%arg0: memref<10000xf32>, %arg1: f32) {
+  // CHECK:      affine.for %i0 = 0 to 10000 {
+  // CHECK-NEXT:   %0 = affine.apply [[MAP]](%i0)
+  // CHECK-NEXT:   prefetch %arg0[%0] {isWrite = true, localityHint = 0 : i32} : memref<10000xf32>
+  // CHECK-NEXT:   store %arg1, %arg0[%i0] : memref<10000xf32>
+  affine.for %i = 0 to 10000 {
+    store %arg1, %arg0[%i] : memref<10000xf32>
+  }
+  return
+}
+
+// Only the innermost loop streams; its induction variable alone is advanced.
+// CHECK-LABEL: func @nested
+func @nested(%arg0: memref<100x10000xf32>) {
+  // CHECK:      affine.for %i0 = 0 to 100 {
+  // CHECK-NEXT:   affine.for %i1 = 0 to 10000 {
+  // CHECK-NEXT:     %0 = affine.apply [[MAP]](%i1)
+  // CHECK-NEXT:     prefetch %arg0[%i0, %0] {isWrite = false, localityHint = 0 : i32} : memref<100x10000xf32>
+  // CHECK-NEXT:     %1 = load %arg0[%i0, %i1]
+  affine.for %i = 0 to 100 {
+    affine.for %j = 0 to 10000 {
+      %v = load %arg0[%i, %j] : memref<100x10000xf32>
+    }
+  }
+  return
+}
+
+// Accesses that do not advance with the induction variable are not prefetched.
+// CHECK-LABEL: func @invariant_access
+func @invariant_access(%arg0: memref<10000xf32>, %arg1: memref<10000xf32>, %arg2: index) {
+  // CHECK:      prefetch %arg0
+  // CHECK-NOT:  prefetch %arg1
+  affine.for %i = 0 to 10000 {
+    %v0 = load %arg0[%i] : memref<10000xf32>
+    %v1 = load %arg1[%arg2] : memref<10000xf32>
+  }
+  return
+}
+
+// Loops whose footprint fits in cache are left alone.
+// CHECK-LABEL: func @small_footprint
+func @small_footprint(%arg0: memref<100xf32>) {
+  // CHECK-NOT: prefetch
+  affine.for %i = 0 to 100 {
+    %v = load %arg0[%i] : memref<100xf32>
+  }
+  return
+}
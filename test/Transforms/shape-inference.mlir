@@ -0,0 +1,52 @@
+// RUN: mlir-opt %s -shape-inference | FileCheck %s
+
+// CHECK-LABEL: func @static_alloc
+func @static_alloc() -> f32 {
+  // CHECK: %[[A:.*]] = alloc() : memref<4x8xf32>
+  // CHECK-NOT: memref_cast
+  // CHECK: load %[[A]][%c0, %c0] : memref<4x8xf32>
+  %c0 = constant 0 : index
+  %c4 = constant 4 : index
+  %c8 = constant 8 : index
+  %m = alloc(%c4, %c8) : memref<?x?xf32>
+  %v = load %m[%c0, %c0] : memref<?x?xf32>
+  return %v : f32
+}
+
+// The static size of the first alloc reaches the second one through the dim.
+// CHECK-LABEL: func @dim_chain
+func @dim_chain() -> memref<?xf32> {
+  // CHECK: alloc() : memref<16xf32>
+  // CHECK: %[[B:.*]] = alloc() : memref<16xf32>
+  // CHECK: %[[CAST:.*]] = memref_cast %[[B]] : memref<16xf32> to memref<?xf32>
+  // CHECK: return %[[CAST]]
+  %c16 = constant 16 : index
+  %a = alloc(%c16) : memref<?xf32>
+  %d = dim %a, 0 : memref<?xf32>
+  %b = alloc(%d) : memref<?xf32>
+  return %b : memref<?xf32>
+}
+
+// Only the constant dimension folds; the other keeps its operand.
+// CHECK-LABEL: func @partially_static
+func @partially_static(%n : index) {
+  // CHECK: %[[M:.*]] = alloc(%arg0) : memref<4x?xf32>
+  // CHECK: dealloc %[[M]] : memref<4x?xf32>
+  %c4 = constant 4 : index
+  %m = alloc(%c4, %n) : memref<?x?xf32>
+  dealloc %m : memref<?x?xf32>
+  return
+}
+
+func @callee(memref<?xf32>)
+
+// Calls are typed against the callee signature, so the cast must survive.
+// CHECK-LABEL: func @generic_call
+func @generic_call() {
+  // CHECK: memref_cast
+  // CHECK: call @callee
+  %a = alloc() : memref<8xf32>
+  %c = memref_cast %a : memref<8xf32> to memref<?xf32>
+  call @callee(%c) : (memref<?xf32>) -> ()
+  return
+}
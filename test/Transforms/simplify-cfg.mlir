@@ -0,0 +1,57 @@
+// RUN: mlir-opt %s -simplify-cfg | FileCheck %s
+
+/// Chains of unconditionally branching blocks are merged into one.
+// CHECK-LABEL: @merge_chain
+func @merge_chain(%arg0 : i32) -> i32 {
+  // CHECK-NEXT: %0 = addi %arg0, %arg0 : i32
+  // CHECK-NEXT: %1 = addi %0, %0 : i32
+  // CHECK-NEXT: return %1 : i32
+  br ^bb1(%arg0 : i32)
+^bb1(%0 : i32):
+  %1 = addi %0, %0 : i32
+  br ^bb2
+^bb2:
+  %2 = addi %1, %1 : i32
+  br ^bb3(%2 : i32)
+^bb3(%3 : i32):
+  return %3 : i32
+}
+
+/// A block that only forwards its arguments is bypassed, even with multiple
+/// predecessors.
+// CHECK-LABEL: @thread_forwarding_block
+func @thread_forwarding_block(%cond : i1, %a : i32, %b : i32) -> i32 {
+  // CHECK-NEXT: cond_br %arg0, ^bb1(%arg1 : i32), ^bb1(%arg2 : i32)
+  cond_br %cond, ^bb1(%a : i32), ^bb2(%b : i32)
+^bb1(%0 : i32):
+  br ^bb3(%0 : i32)
+^bb2(%1 : i32):
+  br ^bb3(%1 : i32)
+// CHECK: ^bb1(%0: i32):
+// CHECK-NEXT: return %0 : i32
+^bb3(%2 : i32):
+  return %2 : i32
+}
+
+/// Blocks not reachable from the entry block are erased.
+// CHECK-LABEL: @erase_unreachable
+func @erase_unreachable(%arg0 : f32) -> f32 {
+  // CHECK-NEXT: return %arg0 : f32
+  return %arg0 : f32
+^bb1:
+  %0 = addf %arg0, %arg0 : f32
+  br ^bb1
+}
+
+/// Blocks with multiple predecessors and non-forwarded arguments are kept.
+// CHECK-LABEL: @keep_join_block
+func @keep_join_block(%cond : i1, %a : i32, %b : i32) -> i32 {
+  // CHECK-NEXT: cond_br %arg0, ^bb1(%arg1 : i32), ^bb1(%arg2 : i32)
+  cond_br %cond, ^bb1(%a : i32), ^bb1(%b : i32)
+// CHECK: ^bb1(%0: i32):
+^bb1(%0 : i32):
+  // CHECK-NEXT: %1 = addi %0, %0 : i32
+  %1 = addi %0, %0 : i32
+  // CHECK-NEXT: return %1 : i32
+  return %1 : i32
+}
@@ -0,0 +1,67 @@
+// RUN: mlir-opt %s -specialize-functions | FileCheck %s
+
+// CHECK-LABEL: func @copy
+func @copy(%src : memref<?x?xf32>, %dst : memref<?x?xf32>) {
+  %c0 = constant 0 : index
+  %v = load %src[%c0, %c0] : memref<?x?xf32>
+  store %v, %dst[%c0, %c0] : memref<?x?xf32>
+  return
+}
+
+// Both calls have the same static signature and must share one clone.
+// CHECK-LABEL: func @caller_copy
+func @caller_copy(%arg0 : memref<4x8xf32>, %arg1 : memref<4x8xf32>) {
+  // CHECK: call @copy_spec0(%arg0, %arg1) : (memref<4x8xf32>, memref<4x8xf32>) -> ()
+  // CHECK: call @copy_spec0(%arg1, %arg0) : (memref<4x8xf32>, memref<4x8xf32>) -> ()
+  %0 = memref_cast %arg0 : memref<4x8xf32> to memref<?x?xf32>
+  %1 = memref_cast %arg1 : memref<4x8xf32> to memref<?x?xf32>
+  call @copy(%0, %1) : (memref<?x?xf32>, memref<?x?xf32>) -> ()
+  call @copy(%1, %0) : (memref<?x?xf32>, memref<?x?xf32>) -> ()
+  return
+}
+
+func @ident(%m : memref<?xf32>) -> memref<?xf32> {
+  return %m : memref<?xf32>
+}
+
+// CHECK-LABEL: func @caller_ident
+func @caller_ident(%arg0 : memref<8xf32>) -> memref<?xf32> {
+  // CHECK: %[[R:.*]] = call @ident_spec0(%arg0) : (memref<8xf32>) -> memref<?xf32>
+  // CHECK: return %[[R]]
+  %0 = memref_cast %arg0 : memref<8xf32> to memref<?xf32>
+  %1 = call @ident(%0) : (memref<?xf32>) -> memref<?xf32>
+  return %1 : memref<?xf32>
+}
+
+func @inner(%m : memref<?xf32>) {
+  return
+}
+
+func @outer(%m : memref<?xf32>) {
+  call @inner(%m) : (memref<?xf32>) -> ()
+  return
+}
+
+// CHECK-LABEL: func @caller_outer
+func @caller_outer(%arg0 : memref<8xf32>) {
+  // CHECK: call @outer_spec0(%arg0) : (memref<8xf32>) -> ()
+  %0 = memref_cast %arg0 : memref<8xf32> to memref<?xf32>
+  call @outer(%0) : (memref<?xf32>) -> ()
+  return
+}
+
+// The clone of @outer initially casts its argument back to call the generic
+// @inner; rescanning the clone propagates the specialization down the chain.
+// CHECK-LABEL: func @outer_spec0(%arg0: memref<8xf32>)
+// CHECK: call @inner_spec0(%arg0) : (memref<8xf32>) -> ()
+
+// CHECK-LABEL: func @inner_spec0(%arg0: memref<8xf32>)
+
+// The returned value must be cast back to the generic result type.
+// CHECK-LABEL: func @ident_spec0(%arg0: memref<8xf32>) -> memref<?xf32>
+// CHECK: %[[C:.*]] = memref_cast %arg0 : memref<8xf32> to memref<?xf32>
+// CHECK: return %[[C]]
+
+// CHECK-LABEL: func @copy_spec0(%arg0: memref<4x8xf32>, %arg1: memref<4x8xf32>)
+// CHECK: load %arg0[
+// CHECK: store %{{.*}}, %arg1[
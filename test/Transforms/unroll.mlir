@@ -568,3 +568,36 @@ func @unroll_by_one_should_promote_single_iteration_loop() {
 // UNROLL-BY-1-NEXT: %0 = "foo"(%c0) : (index) -> i32
 // UNROLL-BY-1-NEXT: return
 }
+
+// Loops carrying values are not unrolled: the carried chain cannot be
+// threaded through the extra body copies yet.
+// UNROLL-BY-4-LABEL: func @no_unroll_iter_args
+func @no_unroll_iter_args(%arg0: memref<1024xf32>, %arg1: f32) -> f32 {
+  // UNROLL-BY-4: affine.for %i0 = 0 to 1024 iter_args
+  // UNROLL-BY-4-NEXT: load
+  // UNROLL-BY-4-NEXT: addf
+  // UNROLL-BY-4-NOT: addf
+  %res = affine.for %i = 0 to 1024 iter_args(%acc = %arg1) -> (f32) {
+    %0 = load %arg0[%i] : memref<1024xf32>
+    %1 = addf %acc, %0 : f32
+    "affine.terminator"(%1) : (f32) -> ()
+  }
+  return %res : f32
+}
+
+// A single-iteration loop with iter_args is promoted by threading the carried
+// value: the body reads the initial operand and the result is the yielded
+// value.
+// UNROLL-BY-1-LABEL: func @promote_single_iteration_iter_args
+func @promote_single_iteration_iter_args(%arg0: memref<1024xf32>, %arg1: f32) -> f32 {
+  %res = affine.for %i = 0 to 1 iter_args(%acc = %arg1) -> (f32) {
+    %0 = load %arg0[%i] : memref<1024xf32>
+    %1 = addf %acc, %0 : f32
+    "affine.terminator"(%1) : (f32) -> ()
+  }
+  return %res : f32
+// UNROLL-BY-1-NEXT: %c0 = constant 0 : index
+// UNROLL-BY-1-NEXT: %0 = load %arg0[%c0] : memref<1024xf32>
+// UNROLL-BY-1-NEXT: %1 = addf %arg1, %0 : f32
+// UNROLL-BY-1-NEXT: return %1 : f32
+}
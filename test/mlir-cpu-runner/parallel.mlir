@@ -0,0 +1,16 @@
+// RUN: mlir-opt %s -affine-parallelize -lower-affine | mlir-cpu-runner -init-value 2.0 | FileCheck %s
+// RUN: mlir-opt %s -affine-parallelize -lower-affine | mlir-cpu-runner -init-value 2.0 -parallel-runtime-threads=2 | FileCheck %s
+
+// The elementwise loop is outlined by -affine-parallelize and executed on the
+// worker pool through the mlir_parallel_for runtime; the result must not
+// depend on the pool width.
+func @main(%a : memref<8xf32>, %b : memref<8xf32>) {
+  affine.for %i = 0 to 8 {
+    %0 = load %a[%i] : memref<8xf32>
+    %1 = addf %0, %0 : f32
+    store %1, %b[%i] : memref<8xf32>
+  }
+  return
+}
+// CHECK: 2.000000e+00 2.000000e+00 2.000000e+00 2.000000e+00 2.000000e+00 2.000000e+00 2.000000e+00 2.000000e+00
+// CHECK-NEXT: 4.000000e+00 4.000000e+00 4.000000e+00 4.000000e+00 4.000000e+00 4.000000e+00 4.000000e+00 4.000000e+00
@@ -0,0 +1,197 @@
+//===- mlir-bench.cpp - MLIR Compile-Time Benchmark Driver ---------------===//
+//
+// Copyright 2019 The MLIR Authors.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+// =============================================================================
+//
+// This utility runs .mlir input files through named pass pipelines and reports
+// per-pass wall and user time in CSV form, for tracking compile-time
+// regressions of the pass pipeline over representative corpora.
+//
+//===----------------------------------------------------------------------===//
+
+#include "mlir/Conversion/StandardToLLVM/ConvertStandardToLLVMPass.h"
+#include "mlir/IR/MLIRContext.h"
+#include "mlir/IR/Module.h"
+#include "mlir/Parser.h"
+#include "mlir/Pass/Pass.h"
+#include "mlir/Pass/PassInstrumentation.h"
+#include "mlir/Pass/PassManager.h"
+#include "mlir/Support/FileUtilities.h"
+#include "mlir/Transforms/Passes.h"
+
+#include "llvm/ADT/StringMap.h"
+#include "llvm/Support/CommandLine.h"
+#include "llvm/Support/Format.h"
+#include "llvm/Support/InitLLVM.h"
+#include "llvm/Support/Mutex.h"
+#include "llvm/Support/PrettyStackTrace.h"
+#include "llvm/Support/SourceMgr.h"
+#include "llvm/Support/Threading.h"
+#include "llvm/Support/Timer.h"
+
+using namespace mlir;
+
+static llvm::cl::list<std::string>
+    inputFilenames(llvm::cl::Positional, llvm::cl::desc("<input files>"),
+                   llvm::cl::OneOrMore);
+
+static llvm::cl::list<std::string> clPipelines(
+    "pipelines",
+    llvm::cl::desc("Comma-separated list of named pipelines to benchmark "
+                   "(canonicalize, cse, loop-fusion, std-to-llvm); all of "
+                   "them when empty"),
+    llvm::cl::ZeroOrMore, llvm::cl::MiscFlags::CommaSeparated);
+
+static llvm::cl::opt<unsigned>
+    clRepeat("repeat",
+             llvm::cl::desc("Number of times to run each pipeline; reported "
+                            "times are accumulated over all runs"),
+             llvm::cl::init(1));
+
+namespace {
+/// Pass instrumentation that accumulates per-pass wall and user time, keyed
+/// by pass name. Function passes may run on multiple threads, so both the
+/// accumulated timings and the per-thread timer stacks are guarded by a lock.
+struct BenchTiming : public PassInstrumentation {
+  struct TimeEntry {
+    double wall = 0.0, user = 0.0;
+  };
+
+  void runBeforePass(Pass *pass, const llvm::Any &) override {
+    auto start = llvm::TimeRecord::getCurrentTime(/*Start=*/true);
+    llvm::sys::SmartScopedLock<true> lock(mutex);
+    activeTimers[llvm::get_threadid()].push_back(start);
+  }
+
+  void runAfterPass(Pass *pass, const llvm::Any &) override {
+    auto end = llvm::TimeRecord::getCurrentTime(/*Start=*/false);
+    llvm::sys::SmartScopedLock<true> lock(mutex);
+    auto &stack = activeTimers[llvm::get_threadid()];
+    assert(!stack.empty() && "expected active timer");
+    auto start = stack.pop_back_val();
+    auto &entry = timings[pass->getName()];
+    entry.wall += end.getWallTime() - start.getWallTime();
+    entry.user += end.getUserTime() - start.getUserTime();
+  }
+
+  void runAfterPassFailed(Pass *pass, const llvm::Any &ir) override {
+    runAfterPass(pass, ir);
+  }
+
+  /// Accumulated timings per pass name.
+  llvm::StringMap<TimeEntry> timings;
+
+  /// A stack of start times per thread, mirroring the pass nesting.
+  DenseMap<uint64_t, SmallVector<llvm::TimeRecord, 4>> activeTimers;
+
+  llvm::sys::SmartMutex<true> mutex;
+};
+} // end anonymous namespace
+
+/// Populate `manager` with the passes of the pipeline named `name`. Returns
+/// failure for unknown pipeline names.
+static LogicalResult buildPipeline(StringRef name, PassManager &manager) {
+  if (name == "canonicalize") {
+    manager.addPass(createCanonicalizerPass());
+    return success();
+  }
+  if (name == "cse") {
+    manager.addPass(createCSEPass());
+    return success();
+  }
+  if (name == "loop-fusion") {
+    manager.addPass(createLoopFusionPass());
+    return success();
+  }
+  if (name == "std-to-llvm") {
+    manager.addPass(createLowerAffinePass());
+    manager.addPass(createConvertToLLVMIRPass());
+    return success();
+  }
+  return failure();
+}
+
+static std::unique_ptr<Module> parseMLIRInput(StringRef inputFilename,
+                                              MLIRContext *context) {
+  std::string errorMessage;
+  auto file = openInputFile(inputFilename, &errorMessage);
+  if (!file) {
+    llvm::errs() << errorMessage << "\n";
+    return nullptr;
+  }
+
+  llvm::SourceMgr sourceMgr;
+  sourceMgr.AddNewSourceBuffer(std::move(file), llvm::SMLoc());
+  return std::unique_ptr<Module>(parseSourceFile(sourceMgr, context));
+}
+
+/// Run `pipeline` on a freshly parsed copy of `inputFilename` and print one
+/// CSV row per pass, plus a TOTAL row for the whole pipeline. Returns failure
+/// if the input cannot be parsed or the pipeline fails.
+static LogicalResult benchmarkPipeline(StringRef inputFilename,
+                                       StringRef pipeline) {
+  PassManager manager;
+  if (failed(buildPipeline(pipeline, manager))) {
+    llvm::errs() << "unknown pipeline: " << pipeline << "\n";
+    return failure();
+  }
+  auto *timing = new BenchTiming();
+  manager.addInstrumentation(timing);
+
+  auto total = llvm::TimeRecord::getCurrentTime(/*Start=*/true);
+  for (unsigned i = 0, e = clRepeat; i < e; ++i) {
+    // Each run mutates the module, so parse a fresh copy per iteration.
+    MLIRContext context;
+    auto module = parseMLIRInput(inputFilename, &context);
+    if (!module) {
+      llvm::errs() << "could not parse the input IR: " << inputFilename
+                   << "\n";
+      return failure();
+    }
+    if (failed(manager.run(module.get())))
+      return failure();
+  }
+  auto end = llvm::TimeRecord::getCurrentTime(/*Start=*/false);
+
+  for (const auto &entry : timing->timings)
+    llvm::outs() << inputFilename << "," << pipeline << "," << entry.first()
+                 << ","
+                 << llvm::format("%.6f,%.6f\n", entry.second.wall,
+                                 entry.second.user);
+  llvm::outs() << inputFilename << "," << pipeline << ",TOTAL,"
+               << llvm::format("%.6f,%.6f\n",
+                               end.getWallTime() - total.getWallTime(),
+                               end.getUserTime() - total.getUserTime());
+  return success();
+}
+
+int main(int argc, char **argv) {
+  llvm::PrettyStackTraceProgram x(argc, argv);
+  llvm::InitLLVM y(argc, argv);
+
+  llvm::cl::ParseCommandLineOptions(argc, argv,
+                                    "MLIR compile-time benchmark driver\n");
+
+  SmallVector<StringRef, 4> pipelines(clPipelines.begin(), clPipelines.end());
+  if (pipelines.empty())
+    pipelines.assign({"canonicalize", "cse", "loop-fusion", "std-to-llvm"});
+
+  llvm::outs() << "file,pipeline,pass,wall_seconds,user_seconds\n";
+  for (const auto &inputFilename : inputFilenames)
+    for (StringRef pipeline : pipelines)
+      if (failed(benchmarkPipeline(inputFilename, pipeline)))
+        return 1;
+  return 0;
+}
@@ -39,18 +39,222 @@
 #include "llvm/IR/LegacyPassNameParser.h"
 #include "llvm/IR/Module.h"
 #include "llvm/Support/CommandLine.h"
+#include "llvm/Support/DynamicLibrary.h"
 #include "llvm/Support/FileUtilities.h"
+#include "llvm/Support/Format.h"
 #include "llvm/Support/InitLLVM.h"
 #include "llvm/Support/PrettyStackTrace.h"
 #include "llvm/Support/SourceMgr.h"
 #include "llvm/Support/StringSaver.h"
 #include "llvm/Support/TargetSelect.h"
 #include "llvm/Support/ToolOutputFile.h"
+#include <chrono>
+#include <cmath>
+#include <condition_variable>
+#include <cstring>
+#include <mutex>
 #include <numeric>
+#include <random>
+#include <thread>
+#include <vector>
+
+#ifdef __linux__
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
 
 using namespace mlir;
 using llvm::Error;
 
+//===----------------------------------------------------------------------===//
+// Thread-pool runtime backing std.parallel_call.
+//===----------------------------------------------------------------------===//
+
+// Outlined loop bodies take the chunk bounds as two leading index arguments
+// followed by the captured values, all passed as machine words. The dispatch
+// below recovers the concrete arity from the argument count; it must stay in
+// sync with the capture limit in the -affine-parallelize pass.
+static void dispatchParallelBody(void *fn, int64_t lo, int64_t hi,
+                                 int64_t numArgs, int64_t *args) {
+  using I = int64_t;
+  switch (numArgs) {
+  case 0:
+    return reinterpret_cast<void (*)(I, I)>(fn)(lo, hi);
+  case 1:
+    return reinterpret_cast<void (*)(I, I, I)>(fn)(lo, hi, args[0]);
+  case 2:
+    return reinterpret_cast<void (*)(I, I, I, I)>(fn)(lo, hi, args[0],
+                                                      args[1]);
+  case 3:
+    return reinterpret_cast<void (*)(I, I, I, I, I)>(fn)(lo, hi, args[0],
+                                                         args[1], args[2]);
+  case 4:
+    return reinterpret_cast<void (*)(I, I, I, I, I, I)>(fn)(
+        lo, hi, args[0], args[1], args[2], args[3]);
+  case 5:
+    return reinterpret_cast<void (*)(I, I, I, I, I, I, I)>(fn)(
+        lo, hi, args[0], args[1], args[2], args[3], args[4]);
+  case 6:
+    return reinterpret_cast<void (*)(I, I, I, I, I, I, I, I)>(fn)(
+        lo, hi, args[0], args[1], args[2], args[3], args[4], args[5]);
+  default:
+    llvm::report_fatal_error("mlir_parallel_for: unsupported argument count");
+  }
+}
+
+static llvm::cl::opt<unsigned> clParallelThreads(
+    "parallel-runtime-threads",
+    llvm::cl::desc("Number of threads in the parallel runtime worker pool "
+                   "(0 uses the hardware concurrency)"),
+    llvm::cl::init(0));
+
+// Set while a thread is executing a chunk of a parallel region; regions
+// dispatched from such a thread run inline instead of re-entering the pool.
+static thread_local bool inParallelRegion = false;
+
+namespace {
+
+/// Persistent fork-join worker pool behind `mlir_parallel_for`. Workers are
+/// spawned on the first dispatch and then parked on a condition variable
+/// between regions, so repeated kernel invocations pay no thread start-up
+/// cost. The calling thread executes the first chunk itself before joining
+/// the workers at the region barrier.
+class ParallelWorkerPool {
+public:
+  static ParallelWorkerPool &get() {
+    static ParallelWorkerPool pool;
+    return pool;
+  }
+
+  void parallelFor(void *fn, int64_t lb, int64_t ub, int64_t numArgs,
+                   int64_t *args);
+
+  ~ParallelWorkerPool() {
+    {
+      std::lock_guard<std::mutex> lock(mutex);
+      shuttingDown = true;
+    }
+    workAvailable.notify_all();
+    for (auto &worker : workers)
+      worker.join();
+  }
+
+private:
+  ParallelWorkerPool() {
+    numParticipants = clParallelThreads ? clParallelThreads.getValue()
+                                        : std::thread::hardware_concurrency();
+    if (numParticipants < 1)
+      numParticipants = 1;
+    for (unsigned id = 1; id < numParticipants; ++id)
+      workers.emplace_back(&ParallelWorkerPool::workerLoop, this, id);
+  }
+
+  /// Runs the chunk of the current region owned by participant 'id'.
+  void runChunk(unsigned id) {
+    int64_t chunkLb = work.lb + id * work.chunkSize;
+    int64_t chunkUb = chunkLb + work.chunkSize < work.ub
+                          ? chunkLb + work.chunkSize
+                          : work.ub;
+    if (chunkLb < chunkUb)
+      dispatchParallelBody(work.fn, chunkLb, chunkUb, work.numArgs, work.args);
+  }
+
+  void workerLoop(unsigned id) {
+    uint64_t lastGeneration = 0;
+    while (true) {
+      std::unique_lock<std::mutex> lock(mutex);
+      workAvailable.wait(lock, [&] {
+        return shuttingDown || generation != lastGeneration;
+      });
+      if (shuttingDown)
+        return;
+      lastGeneration = generation;
+      lock.unlock();
+
+      inParallelRegion = true;
+      runChunk(id);
+      inParallelRegion = false;
+
+      lock.lock();
+      if (--pendingWorkers == 0)
+        workDone.notify_one();
+    }
+  }
+
+  std::vector<std::thread> workers;
+  unsigned numParticipants;
+
+  std::mutex mutex;
+  std::condition_variable workAvailable;
+  std::condition_variable workDone;
+  bool shuttingDown = false;
+  uint64_t generation = 0;
+  unsigned pendingWorkers = 0;
+
+  /// The region currently being executed, published under 'mutex'.
+  struct {
+    void *fn;
+    int64_t lb, ub, chunkSize, numArgs;
+    int64_t *args;
+  } work;
+};
+
+} // end anonymous namespace
+
+void ParallelWorkerPool::parallelFor(void *fn, int64_t lb, int64_t ub,
+                                     int64_t numArgs, int64_t *args) {
+  // Regions dispatched from within a region - or with nothing to share - run
+  // inline on the calling thread.
+  int64_t numIterations = ub - lb;
+  if (numIterations <= 0)
+    return;
+  if (inParallelRegion || numParticipants == 1 || numIterations == 1)
+    return dispatchParallelBody(fn, lb, ub, numArgs, args);
+
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    work.fn = fn;
+    work.lb = lb;
+    work.ub = ub;
+    work.chunkSize = (numIterations + numParticipants - 1) / numParticipants;
+    work.numArgs = numArgs;
+    work.args = args;
+    pendingWorkers = workers.size();
+    ++generation;
+  }
+  workAvailable.notify_all();
+
+  inParallelRegion = true;
+  runChunk(0);
+  inParallelRegion = false;
+
+  std::unique_lock<std::mutex> lock(mutex);
+  workDone.wait(lock, [&] { return pendingWorkers == 0; });
+}
+
+// Runtime entry point resolved by the JIT for lowered std.parallel_call ops.
+// Splits [lb, ub) into one contiguous chunk per pool participant and runs the
+// outlined body on all of them concurrently, returning once every chunk has
+// finished.
+extern "C" void mlir_parallel_for(void *fn, int64_t lb, int64_t ub,
+                                  int64_t numArgs, int64_t *args) {
+  ParallelWorkerPool::get().parallelFor(fn, lb, ub, numArgs, args);
+}
+
+// Mutex guarding the critical sections outlined reduction bodies use to merge
+// their chunk-private partial results into the shared result cells.
+static std::mutex parallelCriticalMutex;
+
+extern "C" void mlir_parallel_critical_begin() {
+  parallelCriticalMutex.lock();
+}
+
+extern "C" void mlir_parallel_critical_end() {
+  parallelCriticalMutex.unlock();
+}
+
 static llvm::cl::opt<std::string> inputFilename(llvm::cl::Positional,
                                                 llvm::cl::desc("<input file>"),
                                                 llvm::cl::init("-"));
@@ -89,6 +293,35 @@ static llvm::cl::list<std::string>
                  llvm::cl::ZeroOrMore, llvm::cl::MiscFlags::CommaSeparated,
                  llvm::cl::cat(clOptionsCategory));
 
+static llvm::cl::opt<std::string> clObjectCacheDir(
+    "object-cache-dir",
+    llvm::cl::desc("Directory in which to cache compiled objects keyed by "
+                   "module content, reused across runs"),
+    llvm::cl::cat(clOptionsCategory));
+
+static llvm::cl::OptionCategory clBenchCategory("benchmarking options");
+static llvm::cl::opt<unsigned> clBenchIterations(
+    "bench-iterations",
+    llvm::cl::desc("Run the entry point this many timed iterations and report "
+                   "timing statistics instead of printing results"),
+    llvm::cl::init(0), llvm::cl::cat(clBenchCategory));
+static llvm::cl::opt<unsigned>
+    clBenchWarmup("bench-warmup",
+                  llvm::cl::desc("Untimed warmup iterations to run before the "
+                                 "timed ones"),
+                  llvm::cl::init(1), llvm::cl::cat(clBenchCategory));
+static llvm::cl::opt<unsigned> clBenchRandomSeed(
+    "bench-random-init",
+    llvm::cl::desc("Overwrite memref arguments with pseudo-random values "
+                   "derived from the given seed before running"),
+    llvm::cl::value_desc("<seed>"), llvm::cl::init(0),
+    llvm::cl::cat(clBenchCategory));
+static llvm::cl::opt<bool> clBenchPerfCounters(
+    "bench-perf-counters",
+    llvm::cl::desc("Also capture cycle, instruction, and cache-miss counters "
+                   "around each timed iteration (Linux perf_event)"),
+    llvm::cl::cat(clBenchCategory));
+
 static std::unique_ptr<Module> parseMLIRInput(StringRef inputFilename,
                                               MLIRContext *context) {
   // Set up the input file.
@@ -108,6 +341,17 @@ static std::unique_ptr<Module> parseMLIRInput(StringRef inputFilename,
 static void initializeLLVM() {
   llvm::InitializeNativeTarget();
   llvm::InitializeNativeTargetAsmPrinter();
+  // Register the parallel runtime entry point with the JIT symbol resolver so
+  // that lowered parallel_call ops link against it even when the host binary
+  // does not re-export its own symbols.
+  llvm::sys::DynamicLibrary::AddSymbol(
+      "mlir_parallel_for", reinterpret_cast<void *>(&mlir_parallel_for));
+  llvm::sys::DynamicLibrary::AddSymbol(
+      "mlir_parallel_critical_begin",
+      reinterpret_cast<void *>(&mlir_parallel_critical_begin));
+  llvm::sys::DynamicLibrary::AddSymbol(
+      "mlir_parallel_critical_end",
+      reinterpret_cast<void *>(&mlir_parallel_critical_end));
 }
 
 static inline Error make_string_error(const llvm::Twine &message) {
@@ -144,6 +388,174 @@ static void printMemRefArguments(ArrayRef<Type> argTypes,
   }
 }
 
+namespace {
+// Hardware cycle, instruction, and cache-miss counters captured around a
+// benchmarked call. Only implemented on Linux via perf_event; `available`
+// returns false elsewhere or when the kernel refuses to open the counters
+// (e.g. restricted perf_event_paranoid settings).
+class PerfCounters {
+public:
+  PerfCounters() {
+#ifdef __linux__
+    cyclesFd = openCounter(PERF_COUNT_HW_CPU_CYCLES);
+    instructionsFd = openCounter(PERF_COUNT_HW_INSTRUCTIONS);
+    cacheMissesFd = openCounter(PERF_COUNT_HW_CACHE_MISSES);
+#endif
+  }
+
+  ~PerfCounters() {
+#ifdef __linux__
+    if (cyclesFd != -1)
+      close(cyclesFd);
+    if (instructionsFd != -1)
+      close(instructionsFd);
+    if (cacheMissesFd != -1)
+      close(cacheMissesFd);
+#endif
+  }
+
+  bool available() const {
+    return cyclesFd != -1 && instructionsFd != -1 && cacheMissesFd != -1;
+  }
+
+  void start() {
+#ifdef __linux__
+    ioctl(cyclesFd, PERF_EVENT_IOC_RESET, 0);
+    ioctl(instructionsFd, PERF_EVENT_IOC_RESET, 0);
+    ioctl(cacheMissesFd, PERF_EVENT_IOC_RESET, 0);
+    ioctl(cyclesFd, PERF_EVENT_IOC_ENABLE, 0);
+    ioctl(instructionsFd, PERF_EVENT_IOC_ENABLE, 0);
+    ioctl(cacheMissesFd, PERF_EVENT_IOC_ENABLE, 0);
+#endif
+  }
+
+  void stop() {
+#ifdef __linux__
+    ioctl(cyclesFd, PERF_EVENT_IOC_DISABLE, 0);
+    ioctl(instructionsFd, PERF_EVENT_IOC_DISABLE, 0);
+    ioctl(cacheMissesFd, PERF_EVENT_IOC_DISABLE, 0);
+    if (read(cyclesFd, &cycles, sizeof(cycles)) != sizeof(cycles))
+      cycles = 0;
+    if (read(instructionsFd, &instructions, sizeof(instructions)) !=
+        sizeof(instructions))
+      instructions = 0;
+    if (read(cacheMissesFd, &cacheMisses, sizeof(cacheMisses)) !=
+        sizeof(cacheMisses))
+      cacheMisses = 0;
+#endif
+  }
+
+  uint64_t getCycles() const { return cycles; }
+  uint64_t getInstructions() const { return instructions; }
+  uint64_t getCacheMisses() const { return cacheMisses; }
+
+private:
+#ifdef __linux__
+  static int openCounter(uint64_t config) {
+    struct perf_event_attr attr;
+    memset(&attr, 0, sizeof(attr));
+    attr.type = PERF_TYPE_HARDWARE;
+    attr.size = sizeof(attr);
+    attr.config = config;
+    attr.disabled = 1;
+    attr.exclude_kernel = 1;
+    attr.exclude_hv = 1;
+    return syscall(__NR_perf_event_open, &attr, /*pid=*/0, /*cpu=*/-1,
+                   /*group_fd=*/-1, /*flags=*/0);
+  }
+#endif
+
+  int cyclesFd = -1;
+  int instructionsFd = -1;
+  int cacheMissesFd = -1;
+  uint64_t cycles = 0;
+  uint64_t instructions = 0;
+  uint64_t cacheMisses = 0;
+};
+} // end anonymous namespace
+
+// Returns the median of `values`; reorders them in the process.
+static double median(MutableArrayRef<double> values) {
+  auto *mid = values.begin() + values.size() / 2;
+  std::nth_element(values.begin(), mid, values.end());
+  return *mid;
+}
+
+// Returns the standard deviation of `values`.
+static double stddev(ArrayRef<double> values) {
+  double mean =
+      std::accumulate(values.begin(), values.end(), 0.0) / values.size();
+  double sumSquares = 0.0;
+  for (double v : values)
+    sumSquares += (v - mean) * (v - mean);
+  return std::sqrt(sumSquares / values.size());
+}
+
+// Overwrite the input memref arguments with pseudo-random values derived from
+// `seed`, so benchmarks do not run on all-identical data.
+static void randomizeMemRefArguments(ArrayRef<Type> argTypes,
+                                     ArrayRef<void *> args, unsigned seed) {
+  std::minstd_rand generator(seed);
+  std::uniform_real_distribution<float> distribution(0.0f, 1.0f);
+  for (const auto &kvp : llvm::zip(argTypes, args.take_front(argTypes.size()))) {
+    auto shape = std::get<0>(kvp).cast<MemRefType>().getShape();
+    int64_t size = std::accumulate(shape.begin(), shape.end(), 1,
+                                   std::multiplies<int64_t>());
+    auto *memRef = reinterpret_cast<StaticFloatMemRef *>(std::get<1>(kvp));
+    for (int64_t i = 0; i < size; ++i)
+      memRef->data[i] = distribution(generator);
+  }
+}
+
+// Run `fptr` on `args` for the configured number of warmup and timed
+// iterations and report median/stddev wall times, plus cycle, instruction,
+// and cache-miss counters when requested and available.
+static void runBenchmark(void (*fptr)(void **), void **args) {
+  for (unsigned i = 0, e = clBenchWarmup; i < e; ++i)
+    (*fptr)(args);
+
+  PerfCounters counters;
+  bool usePerfCounters = clBenchPerfCounters;
+  if (usePerfCounters && !counters.available()) {
+    llvm::errs() << "perf counters requested but unavailable on this system; "
+                    "reporting wall time only\n";
+    usePerfCounters = false;
+  }
+
+  unsigned iterations = clBenchIterations;
+  std::vector<double> timesMs, cycles, instructions, cacheMisses;
+  timesMs.reserve(iterations);
+  for (unsigned i = 0; i < iterations; ++i) {
+    if (usePerfCounters)
+      counters.start();
+    auto start = std::chrono::steady_clock::now();
+    (*fptr)(args);
+    auto end = std::chrono::steady_clock::now();
+    if (usePerfCounters) {
+      counters.stop();
+      cycles.push_back(static_cast<double>(counters.getCycles()));
+      instructions.push_back(static_cast<double>(counters.getInstructions()));
+      cacheMisses.push_back(static_cast<double>(counters.getCacheMisses()));
+    }
+    timesMs.push_back(
+        std::chrono::duration<double, std::milli>(end - start).count());
+  }
+
+  double medianMs = median(timesMs);
+  llvm::outs() << iterations << " iterations (" << clBenchWarmup
+               << " warmup)\n";
+  llvm::outs() << llvm::format("wall time: median %.6f ms, stddev %.6f ms\n",
+                               medianMs, stddev(timesMs));
+  if (usePerfCounters) {
+    llvm::outs() << llvm::format(
+        "cycles: median %.0f, stddev %.0f\n", median(cycles), stddev(cycles));
+    llvm::outs() << llvm::format("instructions: median %.0f, stddev %.0f\n",
+                                 median(instructions), stddev(instructions));
+    llvm::outs() << llvm::format("cache-misses: median %.0f, stddev %.0f\n",
+                                 median(cacheMisses), stddev(cacheMisses));
+  }
+}
+
 // Calls the passes necessary to convert affine and standard dialects to the
 // LLVM IR dialect.
 // Currently, these passes are:
@@ -187,7 +599,8 @@ static Error compileAndExecuteFunctionWithMemRefs(
 
   SmallVector<StringRef, 4> libs(clSharedLibs.begin(), clSharedLibs.end());
   auto expectedEngine =
-      mlir::ExecutionEngine::create(module, transformer, libs);
+      mlir::ExecutionEngine::create(module, transformer, libs,
+                                    clObjectCacheDir);
   if (!expectedEngine)
     return expectedEngine.takeError();
 
@@ -196,8 +609,16 @@ static Error compileAndExecuteFunctionWithMemRefs(
   if (!expectedFPtr)
     return expectedFPtr.takeError();
   void (*fptr)(void **) = *expectedFPtr;
-  (*fptr)(expectedArguments->data());
-  printMemRefArguments(argTypes, resTypes, *expectedArguments);
+
+  if (clBenchRandomSeed.getNumOccurrences() > 0)
+    randomizeMemRefArguments(argTypes, *expectedArguments, clBenchRandomSeed);
+
+  if (clBenchIterations > 0) {
+    runBenchmark(fptr, expectedArguments->data());
+  } else {
+    (*fptr)(expectedArguments->data());
+    printMemRefArguments(argTypes, resTypes, *expectedArguments);
+  }
   freeMemRefArguments(*expectedArguments);
 
   return Error::success();
@@ -226,7 +647,8 @@ static Error compileAndExecuteSingleFloatReturnFunction(
 
   SmallVector<StringRef, 4> libs(clSharedLibs.begin(), clSharedLibs.end());
   auto expectedEngine =
-      mlir::ExecutionEngine::create(module, transformer, libs);
+      mlir::ExecutionEngine::create(module, transformer, libs,
+                                    clObjectCacheDir);
   if (!expectedEngine)
     return expectedEngine.takeError();
 
@@ -241,6 +663,12 @@ static Error compileAndExecuteSingleFloatReturnFunction(
     void *data;
   } data;
   data.data = &res;
+
+  if (clBenchIterations > 0) {
+    runBenchmark(fptr, (void **)&data);
+    return Error::success();
+  }
+
   (*fptr)((void **)&data);
 
   // Intentional printing of the output so we can test.
@@ -26,6 +26,7 @@
 #include "mlir/Support/MlirOptMain.h"
 #include "llvm/Support/CommandLine.h"
 #include "llvm/Support/InitLLVM.h"
+#include "llvm/Support/Parallel.h"
 #include "llvm/Support/PrettyStackTrace.h"
 #include "llvm/Support/SourceMgr.h"
 #include "llvm/Support/ToolOutputFile.h"
@@ -33,13 +34,25 @@
 using namespace llvm;
 using namespace mlir;
 
-static cl::opt<std::string>
-    inputFilename(cl::Positional, cl::desc("<input file>"), cl::init("-"));
+static cl::list<std::string> inputFilenames(cl::Positional,
+                                            cl::desc("<input files>"),
+                                            cl::ZeroOrMore);
 
 static cl::opt<std::string> outputFilename("o", cl::desc("Output filename"),
                                            cl::value_desc("filename"),
                                            cl::init("-"));
 
+static cl::opt<std::string> batchOutputSuffix(
+    "batch-output-suffix",
+    cl::desc("Suffix appended to each input path to form its output path "
+             "when more than one input file is given"),
+    cl::init(".opt"));
+
+static cl::opt<bool> parallelBatchFiles(
+    "mlir-parallel-batch-files",
+    cl::desc("Process the input files of a batch on multiple threads"),
+    cl::init(false));
+
 static cl::opt<bool>
     splitInputFile("split-input-file",
                    cl::desc("Split the input file into pieces and process each "
@@ -72,20 +85,71 @@ int main(int argc, char **argv) {
   ::passList = &passList;
   cl::ParseCommandLineOptions(argc, argv, "MLIR modular optimizer driver\n");
 
-  // Set up the input file.
-  std::string errorMessage;
-  auto file = openInputFile(inputFilename, &errorMessage);
-  if (!file) {
-    llvm::errs() << errorMessage << "\n";
-    return 1;
+  // Single-file mode: read one input (stdin by default) and honor -o.
+  if (inputFilenames.size() <= 1) {
+    StringRef inputFilename = inputFilenames.empty()
+                                  ? StringRef("-")
+                                  : StringRef(inputFilenames.front());
+    std::string errorMessage;
+    auto file = openInputFile(inputFilename, &errorMessage);
+    if (!file) {
+      llvm::errs() << errorMessage << "\n";
+      return 1;
+    }
+
+    auto output = openOutputFile(outputFilename, &errorMessage);
+    if (!output) {
+      llvm::errs() << errorMessage << "\n";
+      exit(1);
+    }
+
+    return failed(MlirOptMain(output->os(), std::move(file), passList,
+                              splitInputFile, verifyDiagnostics, verifyPasses));
   }
 
-  auto output = openOutputFile(outputFilename, &errorMessage);
-  if (!output) {
-    llvm::errs() << errorMessage << "\n";
-    exit(1);
+  // Batch mode: process every input within this process, amortizing dialect
+  // and pass registration, and write each output next to its input.
+  if (outputFilename != "-") {
+    llvm::errs() << "-o is not supported with multiple input files; outputs "
+                    "are written to '<input>"
+                 << batchOutputSuffix << "'\n";
+    return 1;
   }
 
-  return failed(MlirOptMain(output->os(), std::move(file), passList,
-                            splitInputFile, verifyDiagnostics, verifyPasses));
+  std::vector<LogicalResult> results(inputFilenames.size(), success());
+  auto processFile = [&](size_t i) {
+    const std::string &filename = inputFilenames[i];
+    std::string errorMessage;
+    auto file = openInputFile(filename, &errorMessage);
+    if (!file) {
+      llvm::errs() << errorMessage << "\n";
+      results[i] = failure();
+      return;
+    }
+
+    auto output = openOutputFile(filename + batchOutputSuffix, &errorMessage);
+    if (!output) {
+      llvm::errs() << errorMessage << "\n";
+      results[i] = failure();
+      return;
+    }
+
+    results[i] = MlirOptMain(output->os(), std::move(file), passList,
+                             splitInputFile, verifyDiagnostics, verifyPasses);
+    if (succeeded(results[i]))
+      output->keep();
+  };
+
+  // Each file gets its own MLIRContext, so files are independent; the shared
+  // state is the process-level dialect and pass registries.
+  if (parallelBatchFiles)
+    llvm::parallel::for_each_n(llvm::parallel::par, size_t(0),
+                               inputFilenames.size(), processFile);
+  else
+    for (size_t i = 0, e = inputFilenames.size(); i != e; ++i)
+      processFile(i);
+
+  return llvm::any_of(results, [](LogicalResult res) { return failed(res); })
+             ? 1
+             : 0;
 }
@@ -135,12 +135,12 @@ static bool emitOneBuilder(const Record &record, raw_ostream &os) {
     if (isOperandName(op, name)) {
       auto result = isVariadicOperand
                         ? formatv("lookupValues(op.{0}())", name)
-                        : formatv("valueMapping.lookup(op.{0}())", name);
+                        : formatv("lookupValue(op.{0}())", name);
       bs << result;
     } else if (isAttributeName(op, name)) {
       bs << formatv("op.{0}()", name);
     } else if (isResultName(op, name)) {
-      bs << formatv("valueMapping[op.{0}()]", name);
+      bs << formatv("mapValue(op.{0}())", name);
     } else if (name == "_resultType") {
       bs << "op.getResult()->getType().cast<LLVM::LLVMType>()."
             "getUnderlyingType()";
@@ -25,7 +25,11 @@
 #include "mlir/TableGen/GenInfo.h"
 #include "mlir/TableGen/OpTrait.h"
 #include "mlir/TableGen/Operator.h"
+#include "llvm/ADT/STLExtras.h"
 #include "llvm/ADT/StringExtras.h"
+#include "llvm/ADT/StringMap.h"
+#include "llvm/Support/CommandLine.h"
+#include "llvm/Support/Format.h"
 #include "llvm/Support/Signals.h"
 #include "llvm/TableGen/Error.h"
 #include "llvm/TableGen/Record.h"
@@ -35,6 +39,21 @@ using namespace llvm;
 using namespace mlir;
 using namespace mlir::tblgen;
 
+static cl::OptionCategory opDefGenCat("Options for -gen-op-defs");
+
+static cl::opt<unsigned> opShardCount(
+    "op-shard-count",
+    cl::desc("The number of shards into which op definitions are partitioned "
+             "(1 disables sharding)"),
+    cl::init(1), cl::cat(opDefGenCat));
+
+static cl::opt<int> opShardIndex(
+    "op-shard-index",
+    cl::desc("Emit only the op definitions assigned to this shard; each shard "
+             "can then be included from its own translation unit and compiled "
+             "in parallel"),
+    cl::init(-1), cl::cat(opDefGenCat));
+
 static const char *const tblgenNamePrefix = "tblgen_";
 static const char *const generatedArgName = "tblgen_arg";
 static const char *const builderOpState = "tblgen_state";
@@ -443,6 +462,23 @@ void OpClass::writeDeclTo(raw_ostream &os) const {
   os << "};\n";
 }
 
+//===----------------------------------------------------------------------===//
+// Shared type constraint check emission
+//===----------------------------------------------------------------------===//
+
+// Map from a type constraint's key to the name of the shared check function
+// emitted for it into the definitions file. Op verifiers call these functions
+// instead of expanding the same predicate inline in every op, which
+// deduplicates the checks across all ops using a constraint.
+using SharedTypeConstraintMap = llvm::StringMap<std::string>;
+
+// Returns the map key identifying a type constraint: constraints with the
+// same predicate and description share one check function.
+static std::string getTypeConstraintKey(const tblgen::Constraint &constraint) {
+  return constraint.getConditionTemplate() + "\x01" +
+         constraint.getDescription().str();
+}
+
 //===----------------------------------------------------------------------===//
 // Op emitter
 //===----------------------------------------------------------------------===//
@@ -452,10 +488,13 @@ namespace {
 class OpEmitter {
 public:
   static void emitDecl(const Operator &op, raw_ostream &os);
-  static void emitDef(const Operator &op, raw_ostream &os);
+  static void
+  emitDef(const Operator &op, raw_ostream &os,
+          const SharedTypeConstraintMap *sharedTypeConstraints = nullptr);
 
 private:
-  OpEmitter(const Operator &op);
+  OpEmitter(const Operator &op,
+            const SharedTypeConstraintMap *sharedTypeConstraints = nullptr);
 
   void emitDecl(raw_ostream &os);
   void emitDef(raw_ostream &os);
@@ -472,6 +511,11 @@ private:
   // Generates builder method for the operation.
   void genBuilder();
 
+  // Generates the directBuild() method that constructs the operation without
+  // staging its components through an OperationState, for ops where the
+  // allocation layout is fully determined by the (fixed) arity.
+  void genDirectBuilder();
+
   // Generates canonicalizer declaration for the operation.
   void genCanonicalizerDecls();
 
@@ -522,12 +566,18 @@ private:
 
   // The format context for verification code generation.
   FmtContext verifyCtx;
+
+  // The shared type constraint check functions available to the verifier, if
+  // any. Only set when emitting definitions.
+  const SharedTypeConstraintMap *sharedTypeConstraints;
 };
 } // end anonymous namespace
 
-OpEmitter::OpEmitter(const Operator &op)
+OpEmitter::OpEmitter(const Operator &op,
+                     const SharedTypeConstraintMap *sharedTypeConstraints)
     : def(op.getDef()), op(op),
-      opClass(op.getCppClassName(), op.getExtraClassDeclaration()) {
+      opClass(op.getCppClassName(), op.getExtraClassDeclaration()),
+      sharedTypeConstraints(sharedTypeConstraints) {
   verifyCtx.withOp("(*this->getOperation())");
 
   genTraits();
@@ -538,6 +588,7 @@ OpEmitter::OpEmitter(const Operator &op)
   genNamedResultGetters();
   genAttrGetters();
   genBuilder();
+  genDirectBuilder();
   genParser();
   genPrinter();
   genVerifier();
@@ -549,8 +600,10 @@ void OpEmitter::emitDecl(const Operator &op, raw_ostream &os) {
   OpEmitter(op).emitDecl(os);
 }
 
-void OpEmitter::emitDef(const Operator &op, raw_ostream &os) {
-  OpEmitter(op).emitDef(os);
+void OpEmitter::emitDef(
+    const Operator &op, raw_ostream &os,
+    const SharedTypeConstraintMap *sharedTypeConstraints) {
+  OpEmitter(op, sharedTypeConstraints).emitDef(os);
 }
 
 void OpEmitter::emitDecl(raw_ostream &os) { opClass.writeDeclTo(os); }
@@ -575,13 +628,17 @@ void OpEmitter::genAttrGetters() {
 
     // Emit normal emitter.
 
-    // Return the queried attribute with the correct return type.
+    // Return the queried attribute with the correct return type. The name is
+    // interned so that the attribute list lookup compares uniqued identifier
+    // pointers instead of strings.
     auto attrVal =
         (attr.hasDefaultValueInitializer() || attr.isOptional())
-            ? formatv("this->getAttr(\"{0}\").dyn_cast_or_null<{1}>()", name,
-                      attr.getStorageType())
-            : formatv("this->getAttr(\"{0}\").cast<{1}>()", name,
-                      attr.getStorageType());
+            ? formatv("this->getAttr(mlir::Identifier::get(\"{0}\", "
+                      "this->getContext())).dyn_cast_or_null<{1}>()",
+                      name, attr.getStorageType())
+            : formatv("this->getAttr(mlir::Identifier::get(\"{0}\", "
+                      "this->getContext())).cast<{1}>()",
+                      name, attr.getStorageType());
     body << "  auto attr = " << attrVal << ";\n";
     if (attr.hasDefaultValueInitializer()) {
       // Returns the default value if not set.
@@ -939,6 +996,61 @@ void OpEmitter::genBuilder() {
     genStandaloneParamBuilder(useOperandType, useAttrType);
 }
 
+void OpEmitter::genDirectBuilder() {
+  // Only ops with a fixed number of operands and results, no attributes and
+  // no regions can be constructed without staging their components through an
+  // OperationState: their allocation layout is fully determined by the arity.
+  // OpBuilder::create selects this method over the build()-based path when
+  // the call site matches its signature.
+  if (op.getNumVariadicResults() != 0 || op.getNumVariadicOperands() != 0 ||
+      op.getNumRegions() != 0)
+    return;
+  for (const auto &namedAttr : op.getAttributes())
+    if (!namedAttr.attr.isDerivedAttr())
+      return;
+
+  int numResults = op.getNumResults();
+  int numOperands = op.getNumOperands();
+
+  llvm::SmallVector<std::string, 4> resultNames;
+  resultNames.reserve(numResults);
+
+  std::string paramList = "Builder *builder, Location location";
+  for (int i = 0; i != numResults; ++i) {
+    std::string resultName = op.getResult(i).name;
+    if (resultName.empty())
+      resultName = formatv("resultType{0}", i);
+    paramList.append(", Type ");
+    paramList.append(resultName);
+    resultNames.emplace_back(std::move(resultName));
+  }
+  for (int i = 0; i != numOperands; ++i) {
+    paramList.append(", Value *");
+    paramList.append(getArgumentName(op, i));
+  }
+
+  auto &m = opClass.newMethod("Operation *", "directBuild", paramList,
+                              OpMethod::MP_Static);
+  if (numResults > 0) {
+    m.body() << "  Type resultTypes[] = {" << resultNames[0];
+    for (int i = 1; i != numResults; ++i)
+      m.body() << ", " << resultNames[i];
+    m.body() << "};\n";
+  }
+  if (numOperands > 0) {
+    m.body() << "  Value *operands[] = {" << getArgumentName(op, 0);
+    for (int i = 1; i != numOperands; ++i)
+      m.body() << ", " << getArgumentName(op, i);
+    m.body() << "};\n";
+  }
+  m.body() << "  return Operation::create(location, "
+              "OperationName(getOperationName(), builder->getContext()), "
+           << (numOperands > 0 ? "operands" : "llvm::None") << ", "
+           << (numResults > 0 ? "resultTypes" : "llvm::None")
+           << ", NamedAttributeList(), /*successors=*/{}, /*numRegions=*/0, "
+              "/*resizableOperandList=*/false, builder->getContext());\n";
+}
+
 void OpEmitter::genCanonicalizerDecls() {
   if (!def.getValueAsBit("hasCanonicalizer"))
     return;
@@ -1003,7 +1115,9 @@ void OpEmitter::genVerifier() {
   // Populate substitutions for attributes and named operands and results.
   for (const auto &namedAttr : op.getAttributes())
     verifyCtx.addSubst(namedAttr.name,
-                       formatv("this->getAttr(\"{0}\")", namedAttr.name));
+                       formatv("this->getAttr(mlir::Identifier::get(\"{0}\", "
+                               "this->getContext()))",
+                               namedAttr.name));
   for (int i = 0, e = op.getNumOperands(); i < e; ++i) {
     auto &value = op.getOperand(i);
     // Skip from from first variadic operands for now. Else getOperand index
@@ -1034,8 +1148,9 @@ void OpEmitter::genVerifier() {
     auto attrName = namedAttr.name;
     // Prefix with `tblgen_` to avoid hiding the attribute accessor.
     auto varName = tblgenNamePrefix + attrName;
-    body << formatv("  auto {0} = this->getAttr(\"{1}\");\n", varName,
-                    attrName);
+    body << formatv("  auto {0} = this->getAttr(mlir::Identifier::get(\"{1}\", "
+                    "this->getContext()));\n",
+                    varName, attrName);
 
     bool allowMissingAttr =
         attr.hasDefaultValueInitializer() || attr.isOptional();
@@ -1103,6 +1218,24 @@ void OpEmitter::genOperandResultVerifier(OpMethodBody &body,
 
     auto constraint = staticValue.value().constraint;
 
+    // Call the shared check function for this constraint if one was emitted;
+    // otherwise expand the predicate inline.
+    const std::string *sharedFn = nullptr;
+    if (sharedTypeConstraints) {
+      auto it = sharedTypeConstraints->find(getTypeConstraintKey(constraint));
+      if (it != sharedTypeConstraints->end())
+        sharedFn = &it->second;
+    }
+    if (sharedFn) {
+      body << "      if (mlir::failed(" << *sharedFn
+           << "(this->getOperation(), v->getType(), \"" << valueKind
+           << "\", index)))\n"
+           << "        return mlir::failure();\n"
+           << "      ++index;\n"
+           << "    }\n"; // for
+      continue;
+    }
+
     body << "      (void)v;\n"
          << "      if (!("
          << tgfmt(constraint.getConditionTemplate(),
@@ -1251,21 +1384,85 @@ void OpOperandAdaptorEmitter::emitDef(const Operator &op, raw_ostream &os) {
   OpOperandAdaptorEmitter(op).adapterClass.writeDefTo(os);
 }
 
+// Returns a stable hash of 'content'. Position-independent, so it only
+// changes when the hashed bytes do.
+static unsigned hashContent(StringRef content) {
+  unsigned hash = 5381;
+  for (char c : content)
+    hash = hash * 33 + static_cast<unsigned char>(c);
+  return hash;
+}
+
+// Emits one shared check function per unique operand/result type constraint
+// used by 'defs', and records the function names in 'sharedTypeConstraints'.
+static void
+emitSharedTypeConstraintFns(const std::vector<Record *> &defs,
+                            SharedTypeConstraintMap &sharedTypeConstraints,
+                            raw_ostream &os) {
+  FmtContext fctx;
+  bool emittedHeader = false;
+  auto emitForValues = [&](Operator::value_range values) {
+    for (const auto &value : values) {
+      if (!value.hasPredicate())
+        continue;
+      auto &constraint = value.constraint;
+      std::string key = getTypeConstraintKey(constraint);
+      if (sharedTypeConstraints.count(key))
+        continue;
+      if (!emittedHeader) {
+        os << "// Shared operand/result type constraint checks, called from "
+              "the op\n// verifiers below.\n\n";
+        emittedHeader = true;
+      }
+      std::string fnName =
+          formatv("{0}type_constraint_{1}", tblgenNamePrefix,
+                  sharedTypeConstraints.size());
+      os << formatv("static LogicalResult {0}(Operation *op, Type type,\n"
+                    "    StringRef valueKind, unsigned valueIndex) {{\n",
+                    fnName)
+         << "  if (!("
+         << tgfmt(constraint.getConditionTemplate(), &fctx.withSelf("type"))
+         << "))\n"
+         << formatv("    return op->emitOpError(valueKind) << \" #\" << "
+                    "valueIndex\n           << \" must be {0}\";\n",
+                    constraint.getDescription())
+         << "  return mlir::success();\n}\n\n";
+      sharedTypeConstraints[key] = fnName;
+    }
+  };
+  for (auto *def : defs) {
+    Operator op(*def);
+    emitForValues(op.getOperands());
+    emitForValues(op.getResults());
+  }
+}
+
 // Emits the opcode enum and op classes.
 static void emitOpClasses(const std::vector<Record *> &defs, raw_ostream &os,
                           bool emitDecl) {
   IfDefScope scope("GET_OP_CLASSES", os);
+  SharedTypeConstraintMap sharedTypeConstraints;
+  if (!emitDecl)
+    emitSharedTypeConstraintFns(defs, sharedTypeConstraints, os);
   for (auto *def : defs) {
     Operator op(*def);
+    // Render each op's section separately so a content hash can be emitted
+    // under its comment header; tools comparing generated output can then
+    // localize a change to one op without parsing the C++.
+    std::string section;
+    llvm::raw_string_ostream sectionOs(section);
     if (emitDecl) {
-      os << formatv(opCommentHeader, op.getQualCppClassName(), "declarations");
-      OpOperandAdaptorEmitter::emitDecl(op, os);
-      OpEmitter::emitDecl(op, os);
+      OpOperandAdaptorEmitter::emitDecl(op, sectionOs);
+      OpEmitter::emitDecl(op, sectionOs);
     } else {
-      os << formatv(opCommentHeader, op.getQualCppClassName(), "definitions");
-      OpOperandAdaptorEmitter::emitDef(op, os);
-      OpEmitter::emitDef(op, os);
+      OpOperandAdaptorEmitter::emitDef(op, sectionOs);
+      OpEmitter::emitDef(op, sectionOs, &sharedTypeConstraints);
     }
+    os << formatv(opCommentHeader, op.getQualCppClassName(),
+                  emitDecl ? "declarations" : "definitions");
+    os << "// Section hash: " << format_hex(hashContent(sectionOs.str()), 10)
+       << "\n";
+    os << section;
   }
 }
 
@@ -1290,11 +1487,34 @@ static bool emitOpDecls(const RecordKeeper &recordKeeper, raw_ostream &os) {
   return false;
 }
 
+// Returns the shard the op with 'opName' is assigned to. The assignment
+// hashes the op name rather than its position in the record list, so it is
+// stable under insertion and removal of other ops: an op definition change
+// recompiles only the shard holding that op.
+static unsigned getOpShard(StringRef opName, unsigned shardCount) {
+  return hashContent(opName) % shardCount;
+}
+
 static bool emitOpDefs(const RecordKeeper &recordKeeper, raw_ostream &os) {
   emitSourceFileHeader("Op Definitions", os);
 
-  const auto &defs = recordKeeper.getAllDerivedDefinitions("Op");
-  emitOpList(defs, os);
+  auto defs = recordKeeper.getAllDerivedDefinitions("Op");
+  // The op list aggregating all ops for registration is only emitted into the
+  // first shard; the translation unit registering the dialect includes that
+  // one. Keeping it out of the other shards means an op addition or removal
+  // leaves their bytes untouched, so under --write-if-changed they are not
+  // rewritten and their translation units are not recompiled.
+  if (opShardIndex <= 0)
+    emitOpList(defs, os);
+  // When sharding, restrict the emitted definitions to the requested shard.
+  if (opShardIndex >= 0) {
+    if (static_cast<unsigned>(opShardIndex) >= opShardCount)
+      PrintFatalError("-op-shard-index must be less than -op-shard-count");
+    llvm::erase_if(defs, [](Record *def) {
+      return getOpShard(Operator(def).getOperationName(), opShardCount) !=
+             static_cast<unsigned>(opShardIndex);
+    });
+  }
   emitOpClasses(defs, os, /*emitDecl=*/false);
 
   return false;
@@ -405,11 +405,14 @@ void PatternEmitter::emitAttributeMatch(DagNode tree, int index, int depth,
 
 void PatternEmitter::emitMatchMethod(DagNode tree) {
   // Emit the heading.
+  // Stage the captured values on the stack so that failed match attempts do
+  // not allocate: the pattern driver tries every pattern bucketed under this
+  // root kind, so most calls to this method fail. The state is only moved to
+  // the heap once the whole pattern has matched.
   os << R"(
   PatternMatchResult match(Operation *op0) const override {
     auto ctx = op0->getContext(); (void)ctx;
-    auto state = llvm::make_unique<MatchedState>();
-    auto &s = *state;
+    MatchedState s;
     s.autogeneratedRewritePatternOps[0] = op0;
 )";
 
@@ -457,7 +460,9 @@ void PatternEmitter::emitMatchMethod(DagNode tree) {
     }
   }
 
-  os.indent(4) << "return matchSuccess(std::move(state));\n  }\n";
+  os.indent(4)
+      << "return matchSuccess(llvm::make_unique<MatchedState>(std::move(s)));"
+         "\n  }\n";
 }
 
 void PatternEmitter::collectOps(DagNode tree,
@@ -20,11 +20,18 @@
 //
 //===----------------------------------------------------------------------===//
 
+#include "mlir/IR/Diagnostics.h"
 #include "mlir/IR/MLIRContext.h"
+#include "mlir/IR/Module.h"
+#include "mlir/Parser.h"
 #include "mlir/Support/LogicalResult.h"
 #include "mlir/Support/TranslateClParser.h"
+#include "mlir/Translation.h"
 #include "llvm/Support/InitLLVM.h"
+#include "llvm/Support/Parallel.h"
 #include "llvm/Support/PrettyStackTrace.h"
+#include "llvm/Support/SourceMgr.h"
+#include <atomic>
 
 using namespace mlir;
 
@@ -36,17 +43,88 @@ static llvm::cl::opt<std::string>
     outputFilename("o", llvm::cl::desc("Output filename"),
                    llvm::cl::value_desc("filename"), llvm::cl::init("-"));
 
+static llvm::cl::list<std::string> emitTranslations(
+    "emit",
+    llvm::cl::desc("Run the named from-MLIR translation on the input module; "
+                   "may be given several times, in which case the input is "
+                   "parsed once and the translations run concurrently. The "
+                   "translations must treat the module as read-only. With "
+                   "more than one translation each output filename gets the "
+                   "translation name appended as a suffix"),
+    llvm::cl::value_desc("translation"));
+
+/// Parse the input once and run every translation requested via -emit against
+/// the shared module.
+static LogicalResult emitMultipleTranslations(MLIRContext *context) {
+  // Resolve the requested translations before doing any work.
+  const auto &registry = getTranslationFromMLIRRegistry();
+  std::vector<const TranslateFromMLIRFunction *> functions;
+  for (const auto &name : emitTranslations) {
+    auto it = registry.find(name);
+    if (it == registry.end()) {
+      llvm::errs() << "error: unknown translation '" << name << "'\n";
+      return failure();
+    }
+    functions.push_back(&it->second);
+  }
+
+  // Parse the source file once; each translation consumes the same module.
+  llvm::SourceMgr sourceMgr;
+  SourceMgrDiagnosticHandler sourceMgrHandler(sourceMgr, context);
+  std::unique_ptr<Module> module(
+      parseSourceFile(inputFilename, sourceMgr, context));
+  if (!module)
+    return failure();
+
+  // Derive a distinct output filename per translation unless there is only
+  // one; concurrent translations cannot share stdout.
+  if (emitTranslations.size() > 1 && outputFilename == "-") {
+    llvm::errs() << "error: multiple -emit translations require -o\n";
+    return failure();
+  }
+  auto getOutputFor = [&](StringRef name) -> std::string {
+    if (emitTranslations.size() == 1)
+      return outputFilename;
+    return outputFilename + "." + name.str();
+  };
+
+  // The translations only read the shared module, so they can run
+  // concurrently; each one streams into its own output file.
+  std::atomic<bool> anyFailed(false);
+  llvm::parallel::for_each_n(
+      llvm::parallel::par, size_t(0), functions.size(), [&](size_t i) {
+        if ((*functions[i])(module.get(), getOutputFor(emitTranslations[i])))
+          anyFailed = true;
+      });
+  return failure(anyFailed);
+}
+
 int main(int argc, char **argv) {
   llvm::PrettyStackTraceProgram x(argc, argv);
   llvm::InitLLVM y(argc, argv);
 
   // Add flags for all the registered translations.
   llvm::cl::opt<const TranslateFunction *, false, TranslationParser>
-      translationRequested("", llvm::cl::desc("Translation to perform"),
-                           llvm::cl::Required);
+      translationRequested("", llvm::cl::desc("Translation to perform"));
   llvm::cl::ParseCommandLineOptions(argc, argv, "MLIR translation driver\n");
 
   MLIRContext context;
+
+  // The multi-emission mode owns parsing; it is exclusive with requesting a
+  // single translation.
+  if (!emitTranslations.empty()) {
+    if (translationRequested) {
+      llvm::errs() << "error: -emit cannot be combined with requesting a "
+                      "single translation\n";
+      return 1;
+    }
+    return failed(emitMultipleTranslations(&context));
+  }
+
+  if (!translationRequested) {
+    llvm::errs() << "error: no translation requested\n";
+    return 1;
+  }
   return failed(
       (*translationRequested)(inputFilename, outputFilename, &context));
 }